@@ -18,6 +18,12 @@
 #import "GameOverScene.h"
 #import "BluetoothCommsManager.h"
 #import "GameState.h"
+#import "TopologyBenchmark.h"
+#import "SchedulerBenchmark.h"
+#import "PointerMapBenchmark.h"
+#import "ActionSteppingBenchmark.h"
+#import "BroadphaseBenchmark.h"
+#import "TransportBenchmark.h"
 
 @implementation AberFighterAppDelegate
 
@@ -85,9 +91,34 @@
 	//Prevents the device's screen from dimming when it isn't touched for a short time.
 	[[UIApplication sharedApplication] setIdleTimerDisabled:YES];
 	
+#if kSchedulerBenchmarkOnLaunch
+	[SchedulerBenchmark compareNumbersOfTimers];
+#endif
+	
+#if kPointerMapBenchmarkOnLaunch
+	[PointerMapBenchmark compareNumbersOfTargets];
+#endif
+	
+#if kActionSteppingBenchmarkOnLaunch
+	[ActionSteppingBenchmark compareNumbersOfNodes];
+#endif
+	
+#if kBroadphaseBenchmarkOnLaunch
+	[BroadphaseBenchmark compareNumbersOfSprites];
+#endif
+	
+#if kTransportBenchmarkOnLaunch
+	[TransportBenchmark compareTransports];
+#endif
+	
 	//Initializes and shows the loading scene which is the first scene shown in the app. 
 	[[CCDirector sharedDirector] runWithScene:[LoadingLayer scene]];
 	
+#if kTopologyBenchmarkOnLaunch
+	LoopbackConditions conditions = {0.02, 0.005, 0.02f, 0.01f};
+	[TopologyBenchmark compareTopologiesWithNumberOfPlayers:kMaximumNumberOfPlayers conditions:conditions duration:20.0];
+#endif
+	
 }
 
 /*
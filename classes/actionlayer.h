@@ -20,6 +20,14 @@
 #import "Projectile.h"
 #import "ReusableTargetPool.h"
 #import "TargetShip.h"
+#import "CollisionGrid.h"
+#import "ProjectileSystem.h"
+#import "EntityStore.h"
+#import "Simulation.h"
+
+#if CC_ENABLE_PROFILERS
+@class CCProfilingTimer;
+#endif
 
 //Defines the y position where the player starts.
 #define kPLAYER_START_POSITION	50
@@ -34,6 +42,18 @@
 #define kMaximumSpawnRate 0.5
 #define kSpawnRateModifier 1.5
 
+/*
+ Time in seconds taken by a projectile to travel across the screen. Projectiles expire after this time.
+ */
+#define kProjectileLifetime kGameProjectileLifetime
+
+/*
+ When kActionLayerLogActionAllocations is 1 the number of actions allocated and reused by the CCActionManager
+ is logged every second. Once the game is running no actions should be allocated, as the countdown actions
+ are given back to the CCActionManager to be reused and the reward labels use batched actions.
+ */
+#define kActionLayerLogActionAllocations 0
+
 #pragma mark -
 #pragma mark ActionLayer Interface Declaration
 
@@ -67,10 +87,10 @@
 	NSMutableArray *playerShips;
 	
 	/*
-	 This array stores all of the CollidableSprite instances which represent projectiles
-	 in the game. Used for collision detection.
+	 Owns the Projectile instances used in the game. Moves and expires them each frame and
+	 provides the active projectiles for collision detection.
 	 */
-	NSMutableArray *projectiles;
+	ProjectileSystem *projectileSystem;
 	
 	/*
 	 This array stores all of the TargetShip instances which are currently active in
@@ -91,6 +111,12 @@
 	 */
 	int countdown;
 	
+	/*
+	 The sequence fading out the countdown label, retained so it can be given back to the CCActionManager
+	 to be reused once it has called updateCountdown.
+	 */
+	CCSequence *countdownAction;
+	
 	/*
 	 This integer records the time remaining in the current game. When this number
 	 reaches 0 the game ends.
@@ -99,16 +125,65 @@
 	
 	/*
 	 This variable is used for spawning targets. It is used to determine if the difference
-	 between the current time and the previous time when a target was spawned is greater than the 
-	 spawn rate.
+	 between the current match time and the match time when a target was previously spawned is 
+	 greater than the spawn rate.
 	 */
 	double previousTimeTargetSpawned;
 	
+	/*
+	 Seconds of play since the game started, accumulated in nextFrame. Spawning is timed against this
+	 rather than the wall clock so that pausing the game doesn't affect it.
+	 */
+	double matchTime;
+	
+	/*
+	 Seedable random number generator used to decide the type, position and heading of spawned targets.
+	 The same rules are used by the headless Simulation.
+	 */
+	SimulationRandom spawnRandom;
+	
 	/*
 	 This variable is gameTimeRemaining/gameLength. It is used so that targets spawn more
 	 often as the game progresses, with the highest spawnrate being near the end of the game.
 	 */
 	float gameTimeRemainingRatio;
+	
+	/*
+	 Broadphase used during collision detection. The projectiles are added to the grid at the start of 
+	 each frame so that ships are only compared with the projectiles which are close to them.
+	 */
+	CollisionGrid *collisionGrid;
+	
+	/*
+	 Movement data for the TargetShip instances in activeTargets. Targets travel in straight lines, so they are
+	 moved in one loop over this store each frame and the sprites are then updated from it. Each TargetShip's
+	 entityIndex identifies it's entry.
+	 */
+	EntityStore *targetEntities;
+	
+	/*
+	 Movement data for the PlayerShip instances in playerShips, kept in the order they were created. The heading
+	 and speed set by the controls, and the positions peer players are placed at, are copied in at the start of
+	 each frame, then every ship is moved and kept on the screen in one pass over the store. Each PlayerShip's
+	 entityIndex identifies it's entry.
+	 */
+	EntityStore *playerEntities;
+	
+#if CC_ENABLE_PROFILERS
+	/*
+	 Measures the time taken by the collision detection in nextFrame. Changing kCollisionGridCellSize to a 
+	 value larger than the screen makes the grid compare every sprite, which allows the broadphase to be
+	 compared against the brute force algorithm for different numbers of projectiles. Setting 
+	 kCollisionKernelUseSIMD to 0 does the same for the vectorized bounding circle test.
+	 */
+	CCProfilingTimer *collisionProfilingTimer;
+#endif
+
+#if kActionLayerLogActionAllocations
+	//The CCActionManager's counts when they were last logged.
+	NSUInteger lastActionsAllocated;
+	NSUInteger lastActionsReused;
+#endif
 
 }
 
@@ -122,8 +197,9 @@
 @property (readonly) CCBitmapFontAtlas *countdownLabel;
 @property (readonly) PlayerShip *localPlayer;
 @property (nonatomic, retain) NSMutableArray *playerShips;
-@property (nonatomic, retain) NSMutableArray *projectiles;
+@property (readonly) ProjectileSystem *projectileSystem;
 @property (nonatomic, retain) NSMutableArray *activeTargets;
+@property (readonly) CollisionGrid *collisionGrid;
 @property (nonatomic, readwrite, assign) BOOL countdownFinished;
 @property (nonatomic, readwrite, assign) int countdown;
 @property (nonatomic, readwrite, assign) int gameTimeRemaining;
@@ -146,8 +222,8 @@
 - (void)clearUpGameComponents;
 
 /*
- Creates a Projectile instance at the specified location, initiates a CCAction sequence to move the projectile to
- the destination point and adds the projectile to the layer.
+ Activates a Projectile from the ProjectileSystem at the specified location which will travel by the destination point
+ over the lifetime of the projectile.
  */
 - (void)fireProjectileWithStartingPosition:(CGPoint)startingPosition destinationPoint:(CGPoint)destinationPoint ship:(PlayerShip *)ship;
 
@@ -163,6 +239,23 @@
  */
 - (TargetType)determineSpawnedTargetType;
 
+/*
+ Seeds the random number generator used when spawning targets.
+ */
+- (void)seedSpawnRandom:(uint32_t)seed;
+
+/*
+ Adds a TargetShip which has been acquired from the ReusableTargetPool and spawned to the activeTargets list,
+ the spritesheet and the targetEntities store. Returns NO if the store could not be grown, in which case the
+ target has been returned to the pool and must not be used.
+ */
+- (BOOL)addActiveTarget:(TargetShip *)target;
+
+/*
+ Called when the gameTimeRemaining reaches 0. Calls the gameOver method in the ApplicationDelegate to show the next view.
+ */
+- (void)endGame;
+
 /*
  Sets the GameState to GameStarting or GameRunning based on the countdownFinished boolean.
  */
@@ -183,6 +276,16 @@
  */
 - (void)nextFrame:(ccTime)timeSinceLastCall;
 
+/*
+ Called ten times a second while the game is running. Spawns targets and clears up the ones which have left the screen.
+ */
+- (void)gameLogic:(ccTime)timeSinceLastCall;
+
+/*
+ Called once a second while the game is running. Counts down the game time and ends the game when it runs out.
+ */
+- (void)timer:(ccTime)timeSinceLastCall;
+
 /*
  Called by the gameLogic loop to see if it's time to spawn a new TargetShip instance.
  */
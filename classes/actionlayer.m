@@ -10,6 +10,9 @@
 #import "MultilayerGameScene.h"
 #import "UserInterfaceLayer.h"
 #import "AberFighterAppDelegate.h"
+#if CC_ENABLE_PROFILERS
+#import "Support/CCProfiling.h"
+#endif
 
 #pragma mark -
 #pragma mark ActionLayer
@@ -23,8 +26,9 @@
 @synthesize countdownLabel;
 @synthesize localPlayer;
 @synthesize playerShips;
-@synthesize projectiles;
+@synthesize projectileSystem;
 @synthesize activeTargets;
+@synthesize collisionGrid;
 @synthesize countdownFinished;
 @synthesize countdown;
 @synthesize gameTimeRemaining;
@@ -72,6 +76,9 @@
 		
 		CGSize winSize = [CCDirector sharedDirector].winSize;
 		
+		NSAssert(winSize.width == kGameScreenWidth && winSize.height == kGameScreenHeight,
+				 @"ActionLayer: the screen isn't the size in GameConstants.h, which the Simulation uses");
+		
 		/*
 		 Add the background image to the spritesheet.
 		 */
@@ -85,12 +92,40 @@
 		[self setUpLabels];
 		
 		/*
-		 Initialize the projectiles and activeTargets arrays, which are used for collision detection.
-		 They are empty when the game starts.
+		 Initialize the activeTargets array, which is used for collision detection. It is empty when 
+		 the game starts.
 		 */
-		self.projectiles = [[NSMutableArray alloc] init];
 		self.activeTargets = [[NSMutableArray alloc] init];
 		
+		/*
+		 Every projectile sprite is created now and added to the spritesheet hidden, so firing doesn't 
+		 allocate anything during the game.
+		 */
+		projectileSystem = [[ProjectileSystem alloc] initWithSpriteSheet:spriteSheet 
+																capacity:kProjectileSystemCapacity 
+																lifetime:kProjectileLifetime];
+		
+		/*
+		 The collision grid covers the whole layer. It is filled with projectiles each frame in nextFrame.
+		 */
+		collisionGrid = [[CollisionGrid alloc] initWithSize:winSize cellSize:kCollisionGridCellSize];
+		
+		/*
+		 The ReusableTargetPool rarely has more than 20 targets active, so this is enough room for a
+		 normal game. The store grows if more are added.
+		 */
+		targetEntities = EntityStoreNew(20);
+		playerEntities = EntityStoreNew(kMaximumNumberOfPlayers);
+		
+		/*
+		 The pool's hit, miss and peak counters describe a single game.
+		 */
+		[[ReusableTargetPool sharedInstance] resetStatistics];
+		
+#if CC_ENABLE_PROFILERS
+		collisionProfilingTimer = [[CCProfiler timerWithName:@"collision detection" andInstance:self] retain];
+#endif
+		
 		/*
 		 Set the game time remaining to the game length selected in the GameOptionsLayer.
 		 */
@@ -102,6 +137,9 @@
 		self.countdown = 3;
 		//No targets have been spawned yet.
 		self.previousTimeTargetSpawned = 0;
+		matchTime = 0;
+		//Each game is different unless the generator is seeded with a known value.
+		[self seedSpawnRandom:arc4random()];
 		//gameTimeRemainingRatio is initially 1 so that the game will startup with the minimum spawn rate.
 		self.gameTimeRemainingRatio = 1;
 		
@@ -111,15 +149,32 @@
 }
 
 /*
- Method which initializes and returns a PlayerShip instance based on the parameters passed to it.
+ Method which initializes and returns a PlayerShip instance based on the parameters passed to it. The ship is
+ given an entry in the playerEntities store, which moves it from then on.
  */
 - (PlayerShip *)createPlayerShipWithSpriteFrameName:(NSString *)frameName position:(CGPoint)position heading:(float)heading maximumSpeed:(float)maximumSpeed {
 	
 	PlayerShip *newPlayerShip = [PlayerShip spriteWithSpriteFrameName:frameName];
+	
+	NSAssert(newPlayerShip.contentSize.width == kGamePlayerShipImageSize,
+			 @"ActionLayer: %@ isn't the size in GameConstants.h, which the Simulation uses", frameName);
+	
 	newPlayerShip.position = position;
 	newPlayerShip.currentHeading = heading;
 	newPlayerShip.rotation = heading;
 	newPlayerShip.maximumSpeed = maximumSpeed;
+	newPlayerShip.entityIndex = EntityStoreAdd(playerEntities, 
+											   position.x, 
+											   position.y, 
+											   heading, 
+											   0.0f, 
+											   newPlayerShip.contentSize.width / 2, 
+											   newPlayerShip.currentShieldStrength, 
+											   0, 
+											   0, 
+											   newPlayerShip);
+	
+	NSAssert(newPlayerShip.entityIndex != kEntityIndexNone, @"ActionLayer: not enough memory to add a player");
 	
 	return newPlayerShip;
 	
@@ -163,6 +218,27 @@
 #pragma mark -
 #pragma mark Countdown Methods
 
+/*
+ Fades out the countdown label over the given duration then calls updateCountdown. The sequence which called
+ updateCountdown has finished, so it is given back to the CCActionManager, and the new one is made from
+ actions given back before it.
+ */
+- (void)runCountdownFadeWithDuration:(ccTime)duration {
+	
+	CCActionManager *manager = [CCActionManager sharedManager];
+	
+	if (countdownAction != nil) {
+		[manager returnAction:countdownAction];
+	}
+	
+	CCFadeOut *fade = [[manager reusableActionOfClass:[CCFadeOut class]] initWithDuration:duration];
+	countdownAction = [[CCSequence actionOne:fade thenCallTarget:self selector:@selector(updateCountdown:)] retain];
+	[fade release];
+	
+	[self.countdownLabel runAction:countdownAction];
+	
+}
+
 /*
  This method updates the countdown label with a new string and begins an action sequence to make the label fade out then
  call the updateCountdown method.
@@ -172,10 +248,7 @@
 	[self.countdownLabel setString:countdownLabelString];
 	self.countdownLabel.opacity = 100;
 	
-	id actionFade = [CCFadeOut actionWithDuration:0.9f];
-	id actionFadeDone = [CCCallFuncN actionWithTarget:self 
-											 selector:@selector(updateCountdown:)];
-	[self.countdownLabel runAction:[CCSequence actions:actionFade, actionFadeDone, nil]];
+	[self runCountdownFadeWithDuration:0.9f];
 	
 }
 
@@ -216,6 +289,9 @@
 		[self removeChild:countdownLabel cleanup:YES];
 		countdownLabel = nil;
 		
+		[[CCActionManager sharedManager] returnAction:countdownAction];
+		countdownAction = nil;
+		
 	}
 
 	
@@ -256,10 +332,7 @@
 	/*
 	 Create action sequence to fade out countdown label and call updateCountdown.
 	 */
-	id actionFade = [CCFadeOut actionWithDuration:2.5f];
-	id actionFadeDone = [CCCallFuncN actionWithTarget:self 
-											 selector:@selector(updateCountdown:)];
-	[countdownLabel runAction:[CCSequence actions:actionFade, actionFadeDone, nil]];
+	[self runCountdownFadeWithDuration:2.5f];
 	
 }
 
@@ -273,6 +346,17 @@
 	
 	CollidableSprite *sprite = (CollidableSprite *)sender;
 	
+	if (sprite.tag == 1) {
+		
+		/*
+		 The tag 1 identifies a projectile sprite. Projectiles belong to the ProjectileSystem, which hides
+		 the sprite and makes it available to be fired again.
+		 */
+		[self.projectileSystem removeProjectile:(Projectile *)sprite];
+		return;
+		
+	}
+	
 	/*
 	 The sprite which was passed to the method is removed from the spritesheet. The cleanup parameter
 	 specifies whether all actions associated with the sprite should be stopped and released, which is
@@ -286,15 +370,7 @@
 	[sprite unscheduleAllSelectors];
 	[sprite stopAllActions];
 	
-	if (sprite.tag == 1) {
-		
-		/*
-		 The tag 1 identifies a projectile sprite. Therefore the projectile is removed from the
-		 projectiles list.
-		 */
-		[self.projectiles removeObject:sprite];
-		
-	} else if (sprite.tag == 2) {
+	if (sprite.tag == 2) {
 		
 		/*
 		 The tag 2 identifies a TargetShip sprite. Therefore the sprite reference is cast to a 
@@ -302,6 +378,19 @@
 		 ReusableTargetPool is informed to make the TargetShip available once more.
 		 */
 		TargetShip *targetShip = (TargetShip *)sprite;
+		
+		/*
+		 Removing the target's entry moves the last entry in the store into it's place. The TargetShip which
+		 owns the moved entry is told it's new index.
+		 */
+		if (targetShip.entityIndex != kEntityIndexNone) {
+			
+			TargetShip *movedTarget = (TargetShip *)EntityStoreRemove(targetEntities, targetShip.entityIndex);
+			movedTarget.entityIndex = targetShip.entityIndex;
+			targetShip.entityIndex = kEntityIndexNone;
+			
+		}
+		
 		[self.activeTargets removeObject:targetShip];
 		[[ReusableTargetPool sharedInstance] releaseTargetShip:targetShip];
 		
@@ -310,59 +399,25 @@
 }
 
 /*
- Creates a Projectile instance at the specified location, initiates a CCAction sequence to move the projectile to
- the destination point and adds the projectile to the layer.
+ Activates a Projectile from the ProjectileSystem at the specified location. The projectile travels in a straight
+ line by the destination point over kProjectileLifetime seconds and is moved by the ProjectileSystem each frame, 
+ so no actions are run on it.
  */
 - (void)fireProjectileWithStartingPosition:(CGPoint)startingPosition destinationPoint:(CGPoint)destinationPoint ship:(PlayerShip *)ship {
 	
 	/*
-	 A new Projectile is instantiated with the projectile image.
-	 */
-	Projectile *newProjectile = [Projectile spriteWithSpriteFrameName:@"projectile.png"];
-	
-	/*
-	 The tag assigned to projectiles is 1 to differentiate it from a TargetShip or other objects.
-	 */
-	newProjectile.tag = 1;
-	//originatingPlayerID is used during collision detection to ensure that a player isn't
-	//damaged by their own projectiles.
-	newProjectile.originatingPlayerID = ship.playerID; 
-	newProjectile.rotation = ship.rotation;
-	
-	/*
-	 The speed of the projectile is represented by the time it will take the projectile
-	 to travel from it's starting location the distance calculated above (speed = distance / time).
-	 */
-	ccTime projectileSpeed = 1.0f;
-	
-	/*
-	 An action sequence is initiated on the new projectile which will move it along the 
-	 projectileDestinationVector in the time denoted by projectileSpeed, then call clearUpSprite
-	 to remove the projectile when it is finished.
+	 The velocity of the projectile is the distance it needs to travel divided by the time it will take 
+	 to travel it (speed = distance / time).
 	 */
-	[newProjectile runAction:[CCSequence actions:
-							  [CCMoveBy actionWithDuration:projectileSpeed position:destinationPoint],
-							  [CCCallFuncN actionWithTarget:self selector:@selector(clearUpSprite:)],
-							  nil]];
+	CGPoint velocity = ccpMult(destinationPoint, 1.0f / kProjectileLifetime);
 	
 	/*
-	 The initial position of the projectile is now set because all calculation 
-	 and configuration is complete.
+	 If every projectile is already active, or the destination point is zero so the projectile wouldn't move,
+	 then nil is returned and the shot is dropped.
 	 */
-	newProjectile.position = startingPosition;
-	
-	/*
-	 The new projectile is added to the spritesheet for display and the projectiles
-	 array for use in collision detection.
-	 */
-	[self.spriteSheet addChild:newProjectile]; 
-	[self.projectiles addObject:newProjectile];
-	
-	/*
-	 The new projectile is retained by the spritesheet and the projectiles array,
-	 therefore the pointer in this method can be set to nil.
-	 */
-	newProjectile = nil;
+	[self.projectileSystem fireProjectileWithStartingPosition:startingPosition 
+													 velocity:velocity 
+													 playerID:ship.playerID];
 	
 }
 
@@ -439,32 +494,22 @@
 - (TargetType)determineSpawnedTargetType {
 	
 	/*
-	 The probability of each target ship type appearing is added together to get the total probability.
+	 Each TargetShip type has a probability of appearing associated with it. The rule which chooses between them
+	 is shared with the headless Simulation.
 	 */
-	int totalProbability = kTargetShipLargeAppearanceProbability + 
-	kTargetShipSmallAppearanceProbability;
-	/*
-	 A random number between 0 and the totalProbability is generated. Each TargetShip type has a probability
-	 of appearing associated with it. The if statement below determines which ship type will be spawned.  
-	 */
-	int randomTargetTypeSpawnFactor = arc4random() % totalProbability;
-	int targetShipType;
+	return (TargetType)SimulationDetermineTargetType(&spawnRandom, 
+													 kTargetShipSmallAppearanceProbability, 
+													 kTargetShipLargeAppearanceProbability);
 	
-	/*
-	 If the number generated is less than the probability of a Large Ship Appearing, then the target type to 
-	 be spawned is the large type. Otherwise the small target ship type will be spawned.
-	 */
-	if (randomTargetTypeSpawnFactor < kTargetShipLargeAppearanceProbability) {
-		
-		targetShipType = kTargetShipLarge;
-		
-	} else {
-		
-		targetShipType = kTargetShipSmall;
-		
-	}
+}
+
+/*
+ Seeds the random number generator used when spawning targets. Two layers seeded with the same value
+ spawn the same sequence of targets.
+ */
+- (void)seedSpawnRandom:(uint32_t)seed {
 	
-	return targetShipType;
+	SimulationRandomSeed(&spawnRandom, seed);
 	
 }
 
@@ -486,17 +531,12 @@
 	if (newTarget != nil) {
 		
 		/*
-		 A new target has been acquired. The generateRandomStartingPositionAndHeading method sets the initial 
+		 A new target has been acquired. The generateStartingPositionAndHeadingWithRandom method sets the initial 
 		 state of the target ship.
 		 */
-		[newTarget generateRandomStartingPositionAndHeading];
+		[newTarget generateStartingPositionAndHeadingWithRandom:&spawnRandom];
 		
-		/*
-		 Add the new target ship to the activeTargets list and the spritesheet. From now on it's movement
-		 will be handled by calls to it's updatePosition method from the nextFrame method below.   
-		 */
-		[self.activeTargets addObject:newTarget];
-		[self.spriteSheet addChild:newTarget];
+		[self addActiveTarget:newTarget];
 		
 		/*
 		 The newTarget has been retained by adding it to both the spritesheet and the activeTargets list. 
@@ -508,6 +548,43 @@
 	
 }
 
+/*
+ Add the new target ship to the activeTargets list, the spritesheet and the targetEntities store. From now on 
+ it's movement will be handled by the updateActiveTargetPositions method called from nextFrame below. Targets 
+ are not owned by a player, so their owner in the store is 0.
+ */
+- (BOOL)addActiveTarget:(TargetShip *)target {
+	
+	target.entityIndex = EntityStoreAdd(targetEntities, 
+										target.position.x, 
+										target.position.y, 
+										target.currentHeading, 
+										target.speed, 
+										target.contentSize.width / 2, 
+										target.currentShieldStrength, 
+										0, 
+										target.targetType, 
+										target);
+	
+	/*
+	 A target without an entry in the store would never move or collide, so it is given back to the pool
+	 rather than shown.
+	 */
+	if (target.entityIndex == kEntityIndexNone) {
+		
+		NSLog(@"ActionLayer: not enough memory to add a target");
+		[[ReusableTargetPool sharedInstance] releaseTargetShip:target];
+		return NO;
+		
+	}
+	
+	[self.activeTargets addObject:target];
+	[self.spriteSheet addChild:target];
+	
+	return YES;
+	
+}
+
 /*
  This method is called when a TargetShip is destroyed. It creates a label which indicates the points awarded
  for destroying the Target and adds it to the layer in the position the TargetShip instance used to occupy.
@@ -525,15 +602,12 @@
 	
 	/*
 	 2 actions are run simultaneously on the label. The first causes the label to move upwards slightly. 
-	 The second causes the label to fade out then call the removeRewardLabelWithId method. 
-	 */
-	CCAction *moveAction = [CCMoveBy actionWithDuration:1.0f position:ccp(0, +20)];
-	CCAction *fadeAction = [CCSequence actions:
-							 [CCFadeOut actionWithDuration:1.0f],
-							 [CCCallFuncN actionWithTarget:self selector:@selector(removeRewardLabelWithId:)],
-							 nil];
-	[rewardLabel runAction:moveAction];
-	[rewardLabel runAction:fadeAction];
+	 The second causes the label to fade out then call the removeRewardLabelWithId method. They are batched
+	 actions, so when many targets are destroyed at once the CCActionManager steps the labels together without
+	 creating any action objects.
+	 */
+	[rewardLabel runBatchedAction:ccBatchedMoveBy(1.0f, ccp(0, +20))];
+	[rewardLabel runBatchedAction:ccBatchedActionCall(ccBatchedFadeOut(1.0f), self, @selector(removeRewardLabelWithId:))];
 	[self addChild:rewardLabel z:1];
 	
 }
@@ -569,6 +643,13 @@
 	 */
 	[countdownLabel stopAllActions];
 	
+	/*
+	 The countdown sequence's CCCallFuncN retains this layer, so it is released here rather than in dealloc.
+	 It may have been stopped part way through, so it is released rather than given back to be reused.
+	 */
+	[countdownAction release];
+	countdownAction = nil;
+	
 	/*
 	 Remove the reference to this layer as the accelerometer delegate.
 	 */
@@ -577,13 +658,9 @@
 	}
 	
 	/*
-	 Call clearUpSprite on all projectiles to release them.
+	 Return all projectiles to the ProjectileSystem.
 	 */
-	while ([self.projectiles count] > 0) {
-		
-		[self clearUpSprite:[self.projectiles objectAtIndex:0]];
-		
-	}
+	[self.projectileSystem removeAllProjectiles];
 	
 	/*
 	 Call clearUpSprite on all active targets to release them back to
@@ -641,6 +718,86 @@
 #pragma mark -
 #pragma mark Main Game Iterators and Logic
 
+/*
+ Moves every active TargetShip in one pass over the targetEntities store, then copies the new positions 
+ to the sprites. This replaces calling updatePosition on each TargetShip, which needed several message
+ sends per target per frame.
+ */
+- (void)updateActiveTargetPositions:(ccTime)timeSinceLastCall {
+	
+	EntityStoreIntegrate(targetEntities, timeSinceLastCall);
+	
+	for (unsigned int i = 0; i < targetEntities->count; i++) {
+		
+		TargetShip *target = (TargetShip *)targetEntities->views[i];
+		target.position = ccp(targetEntities->positionX[i], targetEntities->positionY[i]);
+		target.rotation = targetEntities->heading[i];
+		
+	}
+	
+}
+
+/*
+ Moves every PlayerShip which isn't disabled in one pass over the playerEntities store, keeping each on the
+ screen below the HUD, then copies the new positions to the sprites. The sprites' heading, speed and position
+ are copied into the store first because the controls, the peer players' directional data and the rollback
+ simulation all set them on the sprites. This replaces calling updatePosition on each PlayerShip.
+ */
+- (void)updatePlayerShipPositions:(ccTime)timeSinceLastCall {
+	
+	CGSize winSize = [[CCDirector sharedDirector] winSize];
+	
+	for (PlayerShip *currentPlayer in self.playerShips) {
+		
+		int index = currentPlayer.entityIndex;
+		CGPoint position = currentPlayer.position;
+		
+		playerEntities->positionX[index] = position.x;
+		playerEntities->positionY[index] = position.y;
+		playerEntities->speed[index] = currentPlayer.shipDisabled ? 0.0f : currentPlayer.speed;
+		playerEntities->shield[index] = currentPlayer.currentShieldStrength;
+		playerEntities->owner[index] = currentPlayer.playerID;
+		EntityStoreSetHeading(playerEntities, index, currentPlayer.currentHeading);
+		
+	}
+	
+	EntityStoreIntegrate(playerEntities, timeSinceLastCall);
+	EntityStoreConfine(playerEntities, 0.0f, 0.0f, winSize.width, winSize.height - (kHUD_Y_POSITION * 2));
+	
+	for (PlayerShip *currentPlayer in self.playerShips) {
+		
+		/*
+		 Disabled ships stay exactly where they were stopped.
+		 */
+		if (!currentPlayer.shipDisabled) {
+			
+			int index = currentPlayer.entityIndex;
+			
+			currentPlayer.position = ccp(playerEntities->positionX[index], playerEntities->positionY[index]);
+			currentPlayer.rotation = playerEntities->heading[index];
+			
+		}
+		
+	}
+	
+}
+
+/*
+ Reduces the shield strength of a TargetShip and keeps it's entry in the targetEntities store consistent.
+ Returns true if the target has been destroyed.
+ */
+- (BOOL)damageTarget:(TargetShip *)target {
+	
+	BOOL targetDestroyed = [target reduceShieldStrength];
+	
+	if (target.entityIndex != kEntityIndexNone) {
+		targetEntities->shield[target.entityIndex] = target.currentShieldStrength;
+	}
+	
+	return targetDestroyed;
+	
+}
+
 /*
  Called 60 times a second (the framerate) to update the state of the entities in the game 
  and perform collision detection. 
@@ -657,7 +814,45 @@
 	NSMutableArray *spritesToClearUp = [[NSMutableArray alloc] init];
 	
 	/*
-	 Firstly all PlayerShip instances are compared with projectile instances to discover collisions.
+	 The match time only advances while nextFrame is scheduled, i.e. while the game is being played.
+	 */
+	matchTime += timeSinceLastCall;
+	
+	/*
+	 Move every TargetShip and update their sprites.
+	 */
+	[self updateActiveTargetPositions:timeSinceLastCall];
+	
+	/*
+	 Move every PlayerShip and update their sprites.
+	 */
+	[self updatePlayerShipPositions:timeSinceLastCall];
+	
+	/*
+	 Move every projectile, and expire those which have left the screen.
+	 */
+	[self.projectileSystem update:timeSinceLastCall];
+	
+#if CC_ENABLE_PROFILERS
+	CCProfilingBeginTimingBlock(collisionProfilingTimer);
+#endif
+	
+	/*
+	 Projectiles don't move during this method, so they are added to the collision grid once at the start.
+	 Each ship is then only compared with the projectiles in the cells around it rather than every projectile.
+	 */
+	[self.collisionGrid removeAllCollidableSprites];
+	
+	unsigned int projectileCount = [self.projectileSystem count];
+	
+	for (unsigned int i = 0; i < projectileCount; i++) {
+		
+		[self.collisionGrid addCollidableSprite:[self.projectileSystem projectileAtIndex:i]];
+		
+	}
+	
+	/*
+	 Firstly all PlayerShip instances are compared with nearby projectile instances to discover collisions.
 	 */
 	for(PlayerShip *currentPlayer in self.playerShips) {
 		/*
@@ -665,23 +860,22 @@
 		 */
 		if (!currentPlayer.shipDisabled) {
 			/*
-			 This method, located in the PlayerShip class, updates the position and rotation of the ship.
+			 The collision grid returns only the projectiles which are in collision with the PlayerShip.
 			 */
-			[currentPlayer updatePosition:timeSinceLastCall];
-			
-			for (Projectile *currentProjectile in self.projectiles) {
+			for (Projectile *currentProjectile in [self.collisionGrid collidableSpritesInCollisionWithCollidableSprite:currentPlayer]) {
 				
 				/*
-				 The checkCollisionWithCollidableSprite method returns a boolean indicating if the 
-				 PlayerShip is in collision with the current projectile.
+				 A projectile which has already hit something earlier in the algorithm can't hit anything else.
 				 */
-				collisionDetected = [currentProjectile checkCollisionWithCollidableSprite:currentPlayer]; 
+				if (currentProjectile.hasCollided)
+					continue;
 				
 				/*
 				 Only projectiles fired by another player should damage the ship. 
 				 */
-				if (collisionDetected && (currentProjectile.originatingPlayerID != currentPlayer.playerID)) {
+				if (currentProjectile.originatingPlayerID != currentPlayer.playerID) {
 					
+					currentProjectile.hasCollided = YES;
 					[spritesToClearUp addObject:currentProjectile];
 					[currentPlayer reduceShieldStrength];
 					[[GameState sharedState] rewardPlayer:currentProjectile.originatingPlayerID
@@ -703,16 +897,13 @@
 		//TargetDestroyed is used to ensure that a destroyed target is not compared against any other sprites.
 		targetDestroyed = NO;
 		
-		//Update the position of the target.
-		[currentTarget updatePosition:timeSinceLastCall];
-		
 		/*
 		 If the currentTarget is offscreen then no collision detection is performed.
 		 */
 		if ([currentTarget checkIfOffscreen]) 
 			continue;
 		
-		for (Projectile *currentProjectile in self.projectiles) {
+		for (Projectile *currentProjectile in [self.collisionGrid collidableSpritesInCollisionWithCollidableSprite:currentTarget]) {
 			
 			/*
 			 If a projectile has already collided with an object earlier in the algorithm then it can't 
@@ -721,29 +912,24 @@
 			if (currentProjectile.hasCollided)
 				continue;
 			
-			collisionDetected = [currentProjectile checkCollisionWithCollidableSprite:currentTarget];
-			
 			/*
-			 If a collision is detected then the projectile is added to the sprites which need clearing up and 
+			 The projectile is in collision, so it is added to the sprites which need clearing up and 
 			 the TargetShip's shields are decremented. If the target is destroyed then it is also added to the 
 			 sprites to clear up and the correct player is rewarded.
 			 */
-			if (collisionDetected) {
-				
-				[spritesToClearUp addObject:currentProjectile];
-				
-				targetDestroyed = [currentTarget reduceShieldStrength];
+			currentProjectile.hasCollided = YES;
+			[spritesToClearUp addObject:currentProjectile];
+			
+			targetDestroyed = [self damageTarget:currentTarget];
+			
+			if (targetDestroyed) {
 				
-				if (targetDestroyed) {
-					
-					[[GameState sharedState] rewardPlayer:currentProjectile.originatingPlayerID
-												   points:currentTarget.scoreAwarded];
-					[self showRewardLabelWithValue:currentTarget.scoreAwarded 
-										  position:currentTarget.position];
-					[spritesToClearUp addObject:currentTarget];
-					break;
-					
-				}
+				[[GameState sharedState] rewardPlayer:currentProjectile.originatingPlayerID
+											   points:currentTarget.scoreAwarded];
+				[self showRewardLabelWithValue:currentTarget.scoreAwarded 
+									  position:currentTarget.position];
+				[spritesToClearUp addObject:currentTarget];
+				break;
 				
 			}
 				
@@ -769,7 +955,7 @@
 					
 					[currentPlayer reduceShieldStrength];
 					
-					targetDestroyed = [currentTarget reduceShieldStrength];
+					targetDestroyed = [self damageTarget:currentTarget];
 					
 					if (targetDestroyed) {
 						
@@ -790,6 +976,10 @@
 		
 	}
 	
+#if CC_ENABLE_PROFILERS
+	CCProfilingEndTimingBlock(collisionProfilingTimer);
+#endif
+	
 	/*
 	 Clear up any ships or projectiles which were destroyed during this iteration.
 	 */
@@ -805,7 +995,7 @@
 
 - (void)checkTargetSpawningSituation {
 	
-	double now = [[NSDate date] timeIntervalSince1970];
+	double now = matchTime;
 	
 	/*
 	 The spawn rate increases as the game time remaining decreases. This is because
@@ -813,7 +1003,7 @@
 	 0 over the course of the game. Therefore initially spawnRate = kMaximumSpawnRate + (1(kSpawnRateModifier)),
 	 and towards the end of the game spawnRate = kMaximumSpawnRate + (0(kSpawnRateModifier)).
 	 */
-	double spawnRate =  kMaximumSpawnRate + (self.gameTimeRemainingRatio * kSpawnRateModifier);
+	double spawnRate = SimulationSpawnInterval(kMaximumSpawnRate, kSpawnRateModifier, self.gameTimeRemainingRatio);
 	
 	/*
 	 At the start of the game or when the difference between now and the previous time a target was spawned
@@ -889,6 +1079,15 @@
 		self.gameTimeRemainingRatio = (float)self.gameTimeRemaining / (float)[GameState sharedState].gameLength;
 		
 	}
+	
+#if kActionLayerLogActionAllocations
+	CCActionManager *actionManager = [CCActionManager sharedManager];
+	NSLog(@"ActionLayer: %lu actions allocated and %lu reused in the last second",
+		  (unsigned long)(actionManager.actionsAllocated - lastActionsAllocated),
+		  (unsigned long)(actionManager.actionsReused - lastActionsReused));
+	lastActionsAllocated = actionManager.actionsAllocated;
+	lastActionsReused = actionManager.actionsReused;
+#endif
 
 		
 }
@@ -1006,10 +1205,20 @@
 	localPlayer = nil;
 	[playerShips release];
 	self.playerShips = nil;
-	[projectiles release];
-	self.projectiles = nil;
+	[projectileSystem release];
+	projectileSystem = nil;
 	[activeTargets release];
 	self.activeTargets = nil;
+	[collisionGrid release];
+	collisionGrid = nil;
+	EntityStoreFree(targetEntities);
+	targetEntities = NULL;
+	EntityStoreFree(playerEntities);
+	playerEntities = NULL;
+	
+#if CC_ENABLE_PROFILERS
+	[CCProfiler releaseTimer:collisionProfilingTimer];
+#endif
 	
 	[super dealloc];
 	
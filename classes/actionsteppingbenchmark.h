@@ -0,0 +1,56 @@
+//
+//  ActionSteppingBenchmark.h
+//  AberFighter
+//
+//  Created by wde7 on 21/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The ActionSteppingBenchmark compares the time the CCActionManager takes to step moves and fades run as
+ action objects, as CCMoveBy and CCFadeOut are, against the same moves and fades run as batched actions. Each
+ node runs one of each, as a reward label does, and the manager is then updated for a number of frames. The
+ mean time of a frame with each kind of action is logged and kept in the result.
+
+ Unlike the SchedulerBenchmark and PointerMapBenchmark there is no host version in the tests directory. Both
+ kinds of action step by calling into Objective-C nodes, so the cost being compared, a message send per action
+ against a cached IMP per entry, only exists on the device.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*
+ When kActionSteppingBenchmarkOnLaunch is 1 the benchmark is run with several numbers of nodes when the app
+ launches, and the results are logged.
+ */
+#define kActionSteppingBenchmarkOnLaunch	0
+//Frames timed in each run.
+#define kActionSteppingBenchmarkFrames		600
+//Seconds the actions last for, long enough that none of them finish while they are timed.
+#define kActionSteppingBenchmarkDuration	1000.0f
+
+typedef struct {
+
+	int nodes;
+
+	//Seconds taken to step every node's actions for a frame, with action objects and with batched actions.
+	double actionObjectFrameTime;
+	double batchedActionFrameTime;
+
+} ActionSteppingBenchmarkResult;
+
+@interface ActionSteppingBenchmark : NSObject {
+
+}
+
+/*
+ Runs the benchmark with 100, 500 and 1000 nodes and logs the results.
+ */
++ (void)compareNumbersOfNodes;
+
+/*
+ Runs the benchmark once with the number of nodes specified and logs the result. Must be run before any
+ scene, so that the only actions the CCActionManager steps are the benchmark's.
+ */
++ (ActionSteppingBenchmarkResult)runWithNodes:(int)numberOfNodes;
+
+@end
@@ -0,0 +1,85 @@
+//
+//  ActionSteppingBenchmark.m
+//  AberFighter
+//
+//  Created by wde7 on 21/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "ActionSteppingBenchmark.h"
+#import "cocos2d.h"
+
+@implementation ActionSteppingBenchmark
+
++ (void)compareNumbersOfNodes {
+
+	[self runWithNodes:100];
+	[self runWithNodes:500];
+	[self runWithNodes:1000];
+
+}
+
++ (ActionSteppingBenchmarkResult)runWithNodes:(int)numberOfNodes {
+
+	ActionSteppingBenchmarkResult result;
+	CCActionManager *actionManager = [CCActionManager sharedManager];
+	NSMutableArray *nodes = [[NSMutableArray alloc] initWithCapacity:numberOfNodes];
+	ccTime frameInterval = 1.0f / 60.0f;
+
+	for (int i = 0; i < numberOfNodes; i++) {
+
+		CCSprite *node = [[CCSprite alloc] init];
+		[nodes addObject:node];
+		[node release];
+
+	}
+
+	for (CCSprite *node in nodes) {
+
+		[actionManager addAction:[CCMoveBy actionWithDuration:kActionSteppingBenchmarkDuration position:ccp(0, 20)] target:node paused:NO];
+		[actionManager addAction:[CCFadeOut actionWithDuration:kActionSteppingBenchmarkDuration] target:node paused:NO];
+
+	}
+
+	//The first step of an action only starts it, so it isn't timed.
+	[actionManager update:frameInterval];
+	CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kActionSteppingBenchmarkFrames; i++) {
+		[actionManager update:frameInterval];
+	}
+
+	result.actionObjectFrameTime = (CFAbsoluteTimeGetCurrent() - startTime) / kActionSteppingBenchmarkFrames;
+
+	for (CCSprite *node in nodes) {
+
+		[actionManager removeAllActionsFromTarget:node];
+		[actionManager addBatchedAction:ccBatchedMoveBy(kActionSteppingBenchmarkDuration, ccp(0, 20)) target:node paused:NO];
+		[actionManager addBatchedAction:ccBatchedFadeOut(kActionSteppingBenchmarkDuration) target:node paused:NO];
+
+	}
+
+	[actionManager update:frameInterval];
+	startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kActionSteppingBenchmarkFrames; i++) {
+		[actionManager update:frameInterval];
+	}
+
+	result.batchedActionFrameTime = (CFAbsoluteTimeGetCurrent() - startTime) / kActionSteppingBenchmarkFrames;
+	result.nodes = numberOfNodes;
+
+	for (CCSprite *node in nodes) {
+		[actionManager removeAllActionsFromTarget:node];
+	}
+
+	[nodes release];
+
+	NSLog(@"Stepping a move and a fade on %d nodes: action objects %.1f us per frame, batched actions %.1f us per frame",
+		  result.nodes, result.actionObjectFrameTime * 1.0e6, result.batchedActionFrameTime * 1.0e6);
+
+	return result;
+
+}
+
+@end
@@ -7,50 +7,64 @@
 //
 /*
  The BluetoothCommsManager is the centralised location for communicating across the bluetooth network. 
+ Packets are sent and received through a NetworkTransport, which is a GameKitTransport when playing over
+ bluetooth.
+ 
+ A game can have up to kMaximumNumberOfPlayers players, connected as a mesh or a star (see NetworkTopology).
+ Each connected peer has it's own NetworkLink, with the packet numbers, reliable channel, link estimator,
+ directional streams and batch of unreliable messages, because each peer receives different packets.
+ Messages about the game, rather than about a link, are known by the PlayerID of the player they came from,
+ which for a message relayed by the hub of a star isn't the peer it arrived from.
  */
 
 #import <Foundation/Foundation.h>
 #import <GameKit/GameKit.h>
 #import "DirectionalChanges.h"
-#import "BluetoothNotificationNames.h"
+#import "WireProtocol.h"
+#import "DirectionalStream.h"
+#import "ReliableChannel.h"
+#import "LinkEstimator.h"
+#import "NetworkLink.h"
+#import "NetworkEventQueue.h"
+#import "PacketRing.h"
+#import "NetworkTransport.h"
+#import "Simulation.h"
+#import "RollbackSession.h"
+#import "PlayerElection.h"
+#import "ReplicationScheduler.h"
+#import "GameState.h"
 
 //ID of app's bluetooth session
 #define kAberFighterBluetoothSessionID @"com.wde7.AberFighter.session"
-//Default die roll figure
-#define kDieNotRolled INT_MAX
-//Network Heartbeat will run at this speed
-#define kNetworkHeartbeatFrequency 0.5f
+/*
+ Domain of the errors the BluetoothCommsManager fails a session with itself, rather than passing on from the
+ transport. A reliable message which can't be queued, because a peer has stopped acknowledging them, can't be
+ delivered, so the session fails with kNetworkErrorReliableChannelFull.
+ */
+#define kNetworkErrorDomain @"com.wde7.AberFighter.network"
+#define kNetworkErrorReliableChannelFull 1
+//How often the link to the peer is checked, and any link report which is due sent, when no frames are being drawn.
+#define kNetworkHeartbeatFrequency 0.1f
+//Traffic rates are measured over this many seconds.
+#define kNetworkTrafficSampleInterval 1.0
+//How often the reliable channel is checked for messages to resend when nothing else is being sent.
+#define kReliableChannelServiceInterval (1.0/20.0)
+//Network events are passed to the layers before any other scheduled update runs in the frame.
+#define kNetworkEventDispatchPriority -1
+//Most peers a device can be connected to, which is the hub of a star with the most players.
+#define kNetworkMaximumPeers (kMaximumNumberOfPlayers - 1)
+//Passed as the peer index to send a packet to every peer.
+#define kNetworkAllPeers -1
+//How often every other player is pinged to measure the round trip time to them, through the hub in a star.
+#define kPlayerPingInterval 0.5
+//Weight given to each new measurement of the round trip time to a player.
+#define kPlayerPingSmoothing 0.125
 
 //Generate a random very large number. Used for the initial die roll.
 #define generateRandomDieRoll() (arc4random() % 1000000)
 
 #pragma mark -
-#pragma mark Bluetooth PacketTypes and PlayerID Declarations
-
-/*
- These are the packet types which are sent across the network.
- */
-typedef enum PacketTypes {
-	
-	kPacketTypeDieRoll,
-	kPacketTypeDieRollReceived,
-	kPacketTypeRestartDieRoll,
-	kPacketTypePeerHeartbeat,
-	kPacketTypeNewGameLength,
-	kPacketTypePlayerReady,
-	kPacketTypeAcknowledgePlayerReady,
-	kPacketTypeGameCancelled,
-	kPacketTypeActionLayerReady,
-	kPacketTypeAcknowledgeActionLayerReady,
-	kPacketTypePeerPlayerShipDirectionalData,
-	kPacketTypeTargetShipSpawned,
-	kPacketTypeProjectileFired,
-	kPacketTypePeerPausedGame,
-	kPacketTypePeerResumedGame,
-	kPacketTypeAcknowledgePeerResumedGame,
-	kPacketTypePeerQuitGame
-	
-} PacketType;
+#pragma mark Bluetooth PlayerID Declarations
 
 /*
  These are the PlayerIDs which can be assigned to each deive.
@@ -59,109 +73,195 @@ typedef enum PlayerIdentifiers {
 	
 	kPlayerUndecided,
 	kPlayer1,
-	kPlayer2
+	kPlayer2,
+	kPlayer3,
+	kPlayer4
 	
 } PlayerIdentifier;
 
-#pragma mark -
-#pragma mark Bluetooth Packet Data Struct Declarations
-
 /*
- Struct used for transferring Directional data across the network.
+ How the devices in a game are connected. In a mesh every device is connected to every other device and sends
+ to each of them directly. In a star one device, the hub, is connected to every other device and the others,
+ the leaves, are only connected to the hub. The hub relays whatever a leaf sends to the rest of the leaves, so
+ a leaf sends each message once however many players there are, but messages between leaves take two hops and
+ wait for a frame on the hub, and the hub carries most of the traffic. Every device in a game must use the same
+ topology. With two players the topologies are the same.
  */
-typedef struct {
+typedef enum NetworkTopologies {
 	
-	float newHeading;
-	float newSpeed;
-	CGPoint currentPosition;
-	float currentRotation;
+	kNetworkTopologyMesh,
+	kNetworkTopologyStar
 	
-} PlayerShipDirectionalInformation;
+} NetworkTopology;
 
 /*
- Struct used for transferring target spawn details across the network.
+ The state of the link to one connected peer.
  */
 typedef struct {
 	
-	int targetShipType;
-	float currentHeading;
-	CGPoint startingPosition;
+	/*
+	 PlayerID of the peer, once the die roll has decided it, and the number of devices it said it was connected
+	 to in it's die roll.
+	 */
+	PlayerIdentifier playerID;
+	int connectedPeers;
+	
+	//The peer's ID in an array, for passing to the transport. Retained. lost is set while the peer is lost.
+	NSArray *destination;
+	BOOL lost;
 	
-} TargetShipDetails;
+	//Packet numbers, reliable channel, link estimator, directional streams, batch and replication scheduler.
+	NetworkLink link;
+	
+} NetworkPeer;
+
+#pragma mark -
+#pragma mark NetworkEventHandler Protocol Declaration
 
 /*
- Struct used for transferring projectile firing details across the network.
+ Implemented by the layers which react to network events. Only the layer set as the BluetoothCommsManager's
+ eventHandler receives them.
  */
-typedef struct {
+@protocol NetworkEventHandler <NSObject>
 
-	CGPoint startingPosition;
-	CGPoint destinationPoint;
-	
-} ProjectileDetails;
+- (void)processNetworkEvent:(const NetworkEvent *)event;
+
+@end
 
 #pragma mark -
 #pragma mark BluetoothCommsManager Interface Declaration
 
-@interface BluetoothCommsManager : NSObject <GKSessionDelegate> {
+@interface BluetoothCommsManager : NSObject <NetworkTransportDelegate> {
 	
 	/*
-	 The currentBluetoothSession is the GKSession which represents the connection with the other peer.
+	 The transport which carries packets to and from the other peers.
 	 */
-	GKSession *currentBluetoothSession;
-	//Array of peerIDs which have been connected to.
+	id<NetworkTransport> transport;
+	//Array of peerIDs which have been connected to, in the same order as peers.
 	NSMutableArray *peerIDs;
+	//The link to each peer in peerIDs.
+	NetworkPeer peers[kNetworkMaximumPeers];
 	//PlayerID assigned to this device.
 	PlayerIdentifier playerID;
+	//Number of players in the game, including this device. Decided along with the PlayerIDs.
+	int numberOfPlayers;
+	//How the devices are connected. Must be set before connecting to any peers.
+	NetworkTopology topology;
 	
 	/*
-	 Identifier for data packets.
+	 reliableChannelTimer makes sure that messages on the reliable channels are resent even when no frames are
+	 being drawn.
 	 */
-	int packetNumber;
-	/*
-	 The currentPacketNumber must be greater than the previous packet number. 
-	 */
-	int previousPacketNumber;
+	NSTimer *reliableChannelTimer;
 	
 	/*
-	 Used in the die roll procedure. localDieRoll is the die roll generated on this device,
-	 peerDieRoll the value on the other.	 
+	 The die roll which decides the PlayerIDs. dieRollStarted is set once this device has rolled.
 	 */
-	int localDieRoll;
-	int peerDieRoll;
+	PlayerElection election;
+	BOOL dieRollStarted;
 	
 	/*
-	 Booleans used to monitor status of die roll.
+	 Seed for the target spawning of the match, derived from the die rolls so that the devices agree on
+	 it without sending anything extra.
 	 */
-	BOOL peerDieRollReceived;
-	BOOL dieRollAcknowledged;
+	uint32_t matchSeed;
 	
 	/*
-	 Bools which monitor the state of layers which must be instantiated before receiving bluetooth notifications.
+	 Bools which monitor the state of layers which must be instantiated before receiving network events.
 	 */
 	BOOL localActionLayerReady;
 	BOOL pauseMenuAcknowledgedPacketReceipt;
 	
 	/*
-	 Heartbeat related functionality. The NSTimer periodically calls the networkHeartbeat method to ensure the 
-	 connection is still active.  
+	 The players, as bits (1 << PlayerID), which have sent each of the handshake messages. The event for a
+	 handshake is posted once every other player has sent it.
+	 */
+	unsigned int playersReady;
+	unsigned int playersAcknowledgedReady;
+	unsigned int playersActionLayerReady;
+	unsigned int playersAcknowledgedActionLayerReady;
+	unsigned int playersResumed;
+	unsigned int playersAcknowledgedResumed;
+	
+	/*
+	 Heartbeat related functionality. The NSTimer periodically calls the networkHeartbeat method to check the
+	 link estimators of the peers when no frames are being drawn.
 	 */
 	NSTimer *networkHeartbeatGenerator;
-	NSDate *lastHeartbeatDate;
 	BOOL attemptingNetworkReconnect;
 	
+	/*
+	 Every other player is pinged every kPlayerPingInterval and replies, which measures the round trip time
+	 between the players including any relaying. Only the latest ping is kept.
+	 */
+	uint32_t playerPingNumber;
+	NSTimeInterval playerPingSendTime;
+	double playerRoundTripTimes[kMaximumNumberOfPlayers];
+	
+	/*
+	 Traffic counters. trafficSample holds the totals at the start of the current sample.
+	 */
+	NetworkTrafficStatistics trafficStatistics;
+	NetworkTrafficStatistics trafficSample;
+	NSDate *trafficSampleDate;
+	
+	/*
+	 The latest directional data of the local ship, which is sent to each peer when it's scheduler chooses it,
+	 and the latest position of every ship, which the updates to each peer are weighted by.
+	 */
+	PlayerShipDirectionalInformation localShipInformation;
+	NetworkPoint shipPositions[kMaximumNumberOfPlayers];
+	BOOL shipPositionKnown[kMaximumNumberOfPlayers];
+	
+	/*
+	 Events for the layers are pushed onto the eventQueue as packets are processed, and passed to the
+	 eventHandler once per frame. While the director is paused, e.g. when an alert is showing, no frames are
+	 drawn so the pausedEventDispatchTimer passes them on instead.
+	 */
+	NetworkEventQueue eventQueue;
+	id<NetworkEventHandler> eventHandler;
+	NSTimer *pausedEventDispatchTimer;
+	
+	/*
+	 Packets are pushed onto the receivedPackets ring by the thread the transport delivers them on, and
+	 applied by the main thread at the start of the next frame. packetReceiveTime is the time the packet being
+	 applied arrived, which is used for measurements instead of the time it is applied.
+	 */
+	PacketRing receivedPackets;
+	NSTimeInterval packetReceiveTime;
+	
 }
 
 #pragma mark -
 #pragma mark BluetoothCommsManager Property Declaration
 
-@property (readonly) GKSession *currentBluetoothSession; 
+@property (readonly) id<NetworkTransport> transport;
 @property (readonly) NSMutableArray *peerIDs;
 @property (readonly) PlayerIdentifier playerID;
+@property (readonly) int numberOfPlayers;
+@property (nonatomic, readwrite, assign) NetworkTopology topology;
+//YES if this device is the hub of a star, i.e. it is connected to more than one peer in a star.
+@property (nonatomic, readonly) BOOL isHub;
+@property (readonly) uint32_t matchSeed;
 @property (nonatomic, readwrite, assign) BOOL localActionLayerReady;
 @property (nonatomic, readwrite, assign) BOOL pauseMenuAcknowledgedPacketReceipt;
 @property (nonatomic, retain) NSTimer *networkHeartbeatGenerator;
-@property (nonatomic, retain) NSDate *lastHeartbeatDate;
 @property (nonatomic, readwrite, assign) BOOL attemptingNetworkReconnect;
+@property (nonatomic, readonly) NetworkTrafficStatistics trafficStatistics;
+//Longest smoothed round trip time to a peer in seconds, measured by the reliable channels. 0 until measured.
+@property (nonatomic, readonly) double roundTripTime;
+//Round trip time, jitter, loss and send rates measured by the link estimator of the first peer.
+@property (nonatomic, readonly) LinkStatistics linkStatistics;
+/*
+ Seconds between directional data messages, adapted to the quality of the links. Directional data goes to
+ every peer, so this is the interval of the worst link.
+ */
+@property (nonatomic, readonly) double directionalDataSendInterval;
+/*
+ The layer which receives network events. Events which arrived before the handler was set were meant for
+ the previous one, so they are discarded. Not retained.
+ */
+@property (nonatomic, assign) id<NetworkEventHandler> eventHandler;
 
 #pragma mark -
 #pragma mark BluetoothCommsManager Public Methods Declaration
@@ -171,23 +271,91 @@ typedef struct {
  */
 + (BluetoothCommsManager *)sharedInstance;
 
+/*
+ Seconds from an arbitrary point, from a clock which never goes backwards. Unlike NSDate it isn't affected by 
+ the system clock being changed, so it is used for every network time measurement.
+ */
++ (NSTimeInterval)currentTime;
+
 /*
  Create a new GKSession and return it for use by the peer picker.
  */
 - (GKSession *)setUpNewSession;
 
+/*
+ Sets up a session which uses the transport specified rather than a GKSession, for example a LoopbackTransport
+ or UDPTransport. The transport is retained. connectToPeer must be called once the transport is connected.
+ */
+- (void)setUpSessionWithTransport:(id<NetworkTransport>)newTransport;
+
+/*
+ Called once the transport has connected to the peer. Adds the peer to the list of peers which packets are 
+ sent to and starts receiving packets from the transport.
+ */
+- (void)connectToPeer:(NSString *)peerID;
+
 /*
  Reset the BluetoothCommsManager.
  */
 - (void)clearUpSession;
 
+/*
+ Clears up the session and stops the timers and scheduled update which keep the manager running. Only needed
+ by managers other than the sharedInstance, such as those created by a TopologyBenchmark, which can be
+ released afterwards.
+ */
+- (void)invalidate;
+
+/*
+ Returns the measurements of the link which the messages of the player specified arrive over: the link to
+ that player, or to the hub if this device is a leaf of a star.
+ */
+- (LinkStatistics)linkStatisticsForPlayer:(PlayerIdentifier)player;
+
+/*
+ Returns the smoothed round trip time in seconds to the player specified, including the time spent being
+ relayed by the hub in a star, or 0 if it hasn't been measured.
+ */
+- (double)roundTripTimeToPlayer:(PlayerIdentifier)player;
+
+/*
+ Returns the replication statistics of the updates of the ship of the player specified, added up over every
+ peer they are sent to. These include the local ship and, on the hub of a star, the ships it relays.
+ */
+- (ReplicationStatistics)replicationStatisticsForShipOfPlayer:(PlayerIdentifier)player;
+
+/*
+ Returns the replication statistics of every projectile sent or relayed by this device, added up.
+ */
+- (ReplicationStatistics)projectileReplicationStatistics;
+
+/*
+ Returns how long the newest update of the ship of the player specified has been waiting to be sent, to
+ the peer it has waited longest for, or 0 if it is up to date everywhere.
+ */
+- (double)replicationStalenessOfShipOfPlayer:(PlayerIdentifier)player;
+
+/*
+ Applies every packet which has been received since this was last called, in the order they arrived. Called
+ at the start of every frame, before any layer is updated, so packets never change the game part way
+ through a frame.
+ */
+- (void)processReceivedPackets;
+
+/*
+ Stops the handler specified receiving network events, if it is still the eventHandler. Called by layers as
+ they leave the screen, which may be after the next layer has set itself as the eventHandler.
+ */
+- (void)removeEventHandler:(id<NetworkEventHandler>)handler;
+
 /*
  Reset the booleans indicating whether the required layers have been initiated.
  */
 - (void)resetLayerStateIndicators;
 
 /*
- Initiate a new dieRoll process.
+ Initiate a new dieRoll process. Peers connected afterwards are sent the roll when they connect. Does nothing
+ if this device has already rolled, e.g. because another device restarted the die roll first.
  */
 - (void)sendNewDieRollPacket;
 
@@ -197,7 +365,8 @@ typedef struct {
 - (void)sendNewGameLengthPacket:(int)gameLength;
 
 /*
- Send PlayerReadyPacket when the user presses start game on the MultiplayerOptionsLayer.
+ Send PlayerReadyPacket when the user presses start game on the MultiplayerOptionsLayer. The peer ready event
+ is posted once every other player has sent it, as are the events of the other handshakes.
  */
 - (void)sendPlayerReadyPacket;
 
@@ -222,20 +391,39 @@ typedef struct {
 - (void)sendAcknowledgeActionLayerReadyPacket;
 
 /*
- This method sends PlayerShipDirectionalData across the network.
+ This method sends PlayerShipDirectionalData across the network. The data waits in each peer's replication
+ scheduler until it is chosen, and only the newest data is sent. Nothing is sent if the data hasn't changed
+ since the last data acknowledged by the peer.
  */
 - (void)sendLocalPlayerShipDirectionalDataWithNewHeading:(float)newHeading newSpeed:(float)newSpeed currentPosition:(CGPoint)currentPosition currentRotation:(float)currentRotation;
 
 /*
- This method sends TargetSpawnDetails across the network.
+ Sends the checksum of the targets spawned up to the match tick specified, so that the peer can check
+ that it spawned the same targets.
  */
-- (void)sendTargetSpawnDetailsWithType:(int)targetShipType currentHeading:(float)currentHeading startingPosition:(CGPoint)startingPosition;
+- (void)sendSpawnChecksum:(uint32_t)checksum forTick:(uint32_t)tick;
 
 /*
- This method sends ProjectileFiredDetails across the network. 
+ This method sends ProjectileFiredDetails across the network. The details wait in each peer's replication
+ scheduler until they are chosen.
  */
 - (void)sendProjectileFiredDetailsWithStartingPosition:(CGPoint)startingPosition destinationPoint:(CGPoint)destinationPoint;
 
+/*
+ Sends the inputs of a rollback game which the peer hasn't acknowledged, along with the acknowledgement of
+ the peer's inputs. Every message repeats the inputs which may have been lost, so it is sent unreliably.
+ Should be called once per frame.
+ */
+- (void)sendRollbackInputsFromSession:(const RollbackSession *)session;
+
+/*
+ Directional data and projectiles are sent unreliably. Rather than sending a packet for each
+ one they are queued and sent together in a single packet when this method is called, which should be once
+ per frame. Each peer's replication scheduler chooses the ship and projectile updates with the highest
+ priority which fit in kReplicationDatagramBudget bytes, and the rest wait for a later batch.
+ */
+- (void)flushOutboundMessages;
+
 /*
  Sent when the Pause button is pressed on the UserInterfaceLayer.
  */
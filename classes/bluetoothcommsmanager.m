@@ -9,29 +9,45 @@
 #import "BluetoothCommsManager.h"
 #import "MultilayerGameScene.h"
 #import "MultiplayerActionLayer.h"
+#import "GameKitTransport.h"
+#import <mach/mach_time.h>
 
 #pragma mark -
 #pragma mark BluetoothCommsManager
 /*
- The maximum NetworkDataPacketSize is 1024 bytes.
+ Size of the buffer used to encode the data of a single packet before it is sent. The largest packet
+ data, a ProjectileDetails, is 8 bytes once encoded.
  */
-#define kNetworkDataPacketSize 1024
+#define kNetworkPacketDataBufferSize 32
+/*
+ Size of the buffer used to encode rollback inputs: three variable length integers and up to 3 bytes for
+ each of kRollbackSessionHistorySize inputs.
+ */
+#define kNetworkRollbackDataBufferSize (15 + (3 * kRollbackSessionHistorySize))
 
-const float kMaximumNetworkHeartbeatInterval = 2.0f;
+#if kNetworkLinkMaximumPlayers != kMaximumNumberOfPlayers
+#error "Each NetworkLink must have a scheduler entity for the ship of every player"
+#endif
+
+static void BluetoothCommsManagerTransmit(NetworkLink *link, const uint8_t *packet, size_t length, void *context);
 
 @implementation BluetoothCommsManager
 
 #pragma mark -
 #pragma mark BluetoothCommsManager Synthesized Properties
 
-@synthesize currentBluetoothSession;
+@synthesize transport;
 @synthesize peerIDs;
 @synthesize playerID;
+@synthesize numberOfPlayers;
+@synthesize topology;
+@synthesize matchSeed;
 @synthesize localActionLayerReady;
 @synthesize pauseMenuAcknowledgedPacketReceipt;
 @synthesize networkHeartbeatGenerator;
-@synthesize lastHeartbeatDate;
 @synthesize attemptingNetworkReconnect;
+@synthesize trafficStatistics;
+@synthesize eventHandler;
 
 #pragma mark -
 #pragma mark BluetoothCommsManager Initializers
@@ -56,25 +72,52 @@ static BluetoothCommsManager *sharedInstance = nil;
 	
 }
 
++ (NSTimeInterval)currentTime {
+	
+	static double secondsPerTick = 0.0;
+	
+	if (secondsPerTick == 0.0) {
+		
+		mach_timebase_info_data_t timebase;
+		mach_timebase_info(&timebase);
+		secondsPerTick = ((double)timebase.numer / (double)timebase.denom) / 1.0e9;
+		
+	}
+	
+	return mach_absolute_time() * secondsPerTick;
+	
+}
+
 /*
- Reset Die Roll State.
+ Reset Die Roll State. The peers which are already connected take part in the next die roll.
  */
 - (void)resetDieState {
 	
-	localDieRoll = kDieNotRolled;
-	peerDieRoll = kDieNotRolled;
-	peerDieRollReceived = NO;
-	dieRollAcknowledged = NO;
+	PlayerElectionInit(&election);
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+		PlayerElectionAddPeer(&election);
+	}
+	
+	dieRollStarted = NO;
+	memset(shipPositionKnown, 0, sizeof(shipPositionKnown));
 	
 }
 
 /*
- The layer state indicators are used to check when the action layer and pause menu layers are available.
+ The layer state indicators are used to check when the action layer and pause menu layers are available. The
+ handshakes between the layers start again with them.
  */
 - (void)resetLayerStateIndicators {
 	
 	localActionLayerReady = NO;
 	pauseMenuAcknowledgedPacketReceipt = NO;
+	playersReady = 0;
+	playersAcknowledgedReady = 0;
+	playersActionLayerReady = 0;
+	playersAcknowledgedActionLayerReady = 0;
+	playersResumed = 0;
+	playersAcknowledgedResumed = 0;
 	
 }
 
@@ -89,8 +132,60 @@ static BluetoothCommsManager *sharedInstance = nil;
 		networkHeartbeatGenerator = nil;
 		
 	}
-	lastHeartbeatDate = nil;
 	attemptingNetworkReconnect = NO;
+	playerPingNumber = 0;
+	playerPingSendTime = 0;
+	memset(playerRoundTripTimes, 0, sizeof(playerRoundTripTimes));
+	
+}
+
+/*
+ Starts the link to a newly connected peer.
+ */
+- (void)resetPeer:(NetworkPeer *)peer withID:(NSString *)peerID {
+	
+	peer->playerID = kPlayerUndecided;
+	peer->connectedPeers = 0;
+	peer->destination = [[NSArray alloc] initWithObjects:peerID, nil];
+	peer->lost = NO;
+	NetworkLinkInit(&peer->link, BluetoothCommsManagerTransmit, self, &trafficStatistics, [BluetoothCommsManager currentTime]);
+	
+}
+
+/*
+ Forgets every peer. Any unacknowledged messages on their reliable channels are discarded.
+ */
+- (void)resetPeers {
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+		
+		[peers[i].destination release];
+		peers[i].destination = nil;
+		
+	}
+	
+	@synchronized(peerIDs) {
+		[peerIDs removeAllObjects];
+	}
+	
+	if (reliableChannelTimer != nil) {
+		
+		[reliableChannelTimer invalidate];
+		reliableChannelTimer = nil;
+		
+	}
+	
+}
+
+/*
+ The traffic counters are reset whenever a new session starts.
+ */
+- (void)resetTrafficStatistics {
+	
+	memset(&trafficStatistics, 0, sizeof(NetworkTrafficStatistics));
+	trafficSample = trafficStatistics;
+	[trafficSampleDate release];
+	trafficSampleDate = [[NSDate alloc] init];
 	
 }
 
@@ -102,14 +197,24 @@ static BluetoothCommsManager *sharedInstance = nil;
 
 	if ((self = [super init])) {
 		
-		packetNumber = 0;
-		previousPacketNumber = -1;
+		peerIDs = [[NSMutableArray alloc] init];
+		
 		playerID = kPlayerUndecided;
+		numberOfPlayers = 0;
+		topology = kNetworkTopologyMesh;
 		[self resetDieState];
 		[self resetLayerStateIndicators];
 		[self resetHeartbeatGenerator];
+		[self resetTrafficStatistics];
 		
-		peerIDs = [[NSMutableArray alloc] init];
+		NetworkEventQueueInit(&eventQueue);
+		PacketRingInit(&receivedPackets);
+		[[CCScheduler sharedScheduler] scheduleUpdateForTarget:self priority:kNetworkEventDispatchPriority paused:NO];
+		pausedEventDispatchTimer = [NSTimer scheduledTimerWithTimeInterval:kNetworkHeartbeatFrequency
+																	target:self
+																  selector:@selector(dispatchNetworkEventsWhilePaused:)
+																  userInfo:nil
+																   repeats:YES];
 		
 	}
 	
@@ -118,594 +223,1509 @@ static BluetoothCommsManager *sharedInstance = nil;
 }
 
 /*
- Create a new GKSession instance for use by the peer picker.
+ Create a new GKSession instance for use by the peer picker. The session is wrapped in a GameKitTransport.
  */
 - (GKSession *)setUpNewSession {
 	
-	NSAssert(currentBluetoothSession == nil, @"Trying to set up new session when one already exists");
-	currentBluetoothSession = [[GKSession alloc] initWithSessionID:kAberFighterBluetoothSessionID
-													   displayName:nil 
-													   sessionMode:GKSessionModePeer];
+	GameKitTransport *gameKitTransport = [[GameKitTransport alloc] initWithSessionID:kAberFighterBluetoothSessionID];
+	GKSession *session = gameKitTransport.session;
+	
+	[self setUpSessionWithTransport:gameKitTransport];
+	[gameKitTransport release];
 	
-	return currentBluetoothSession;	
+	return session;	
 
 }
 
-/*
- Returns the BluetoothCommsManager to it's original state.
- */
-- (void)clearUpSession {
-
-	if (currentBluetoothSession != nil) {
-		currentBluetoothSession.available = NO;
-		[currentBluetoothSession disconnectFromAllPeers];
-		currentBluetoothSession.delegate = nil;
-		[currentBluetoothSession setDataReceiveHandler:nil withContext:nil];
-		[currentBluetoothSession release];
-		currentBluetoothSession = nil;
-	}
-	
-	[peerIDs removeAllObjects];
-	playerID = kPlayerUndecided;
-	packetNumber = 0;
-	previousPacketNumber = -1;
+- (void)setUpSessionWithTransport:(id<NetworkTransport>)newTransport {
 	
-	[self resetLayerStateIndicators];
-	[self resetHeartbeatGenerator];
+	NSAssert(transport == nil, @"Trying to set up new session when one already exists");
+	transport = [newTransport retain];
 	
 }
 
-/*
- Called when the session fails. Posts a notification on the NSNotificationCenter and resets the BluetoothCommsManager.
- */
-- (void)session:(GKSession *)session didFailWithError:(NSError *)error {
+- (void)connectToPeer:(NSString *)peerID {
 	
-	NSLog(@"Error: %@", [error localizedDescription]);
+	NSUInteger peerIndex = [peerIDs count];
+	
+	if (peerIndex >= kNetworkMaximumPeers || [peerIDs containsObject:peerID]) {
+		
+		NSLog(@"Peer %@ not connected, already connected or too many peers", peerID);
+		return;
+		
+	}
+	
+	/*
+	 The peer's link is set up before it is added to peerIDs, because packets from it may start arriving on
+	 the transport's thread as soon as it is.
+	 */
+	[self resetPeer:&peers[peerIndex] withID:peerID];
+	
+	@synchronized(peerIDs) {
+		[peerIDs addObject:peerID];
+	}
+	
+	if (peerIndex == 0) {
+		
+		[transport startWithDelegate:self];
+		
+		reliableChannelTimer = [NSTimer scheduledTimerWithTimeInterval:kReliableChannelServiceInterval
+																target:self
+															  selector:@selector(serviceReliableChannel:)
+															  userInfo:nil
+															   repeats:YES];
+		
+	}
 	
-	NSDictionary *data = [NSDictionary dictionaryWithObject:error forKey:@"error"];
+	/*
+	 A peer which connects after this device has rolled is sent the roll. The peers already connected are sent it
+	 again too, which only updates the number of devices this one is connected to.
+	 */
+	if (PlayerElectionAddPeer(&election) >= 0 && dieRollStarted) {
+		[self sendDieRoll];
+	}
 	
-	NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
-	[notificationCenter postNotificationName:SessionFailedWithError object:self userInfo:data]; 
+}
+
+- (void)invalidate {
 	
 	[self clearUpSession];
 	
+	[[CCScheduler sharedScheduler] unscheduleUpdateForTarget:self];
+	[pausedEventDispatchTimer invalidate];
+	pausedEventDispatchTimer = nil;
+	eventHandler = nil;
+	
 }
 
 /*
- When the peer changes state this method is called. This checks if the Peer Disconnected, posts a notification
- and resets the BluetoothCommsManager. 
+ Sends any new reliable messages, acknowledgements or resent messages which are due on the reliable channels.
+ During a game the queues are flushed every frame anyway, so there is normally nothing to do; outside a game
+ this is what sends the reliable messages.
  */
-- (void)session:(GKSession *)session peer:(NSString *)peerID didChangeState:(GKPeerConnectionState)state {
+- (void)serviceReliableChannel:(NSTimer *)timer {
+	
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
 	
-	if (state == GKPeerStateDisconnected) {
-			
-		NSDictionary *data = [NSDictionary dictionaryWithObject:peerID forKey:@"peerID"];
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
 		
-		NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
-		[notificationCenter postNotificationName:PeerWasDisconnected object:self userInfo:data];
+		if (ReliableChannelHasDataToWrite(&peers[i].link.reliableChannel, now)) {
+			[self flushOutboundMessagesToPeer:(int)i];
+		}
 		
-		[self clearUpSession];
 	}
 	
 }
 
-#pragma mark -
-#pragma mark BluetoothCommsManager Initializers
-
-/*
- This method implements the die roll functionality used for determining the player ID of each device.
- This method is only called after the dieRoll sent has been acknowledged and the peer die roll has been received.
- */
-- (void)determinePlayerIdentifiers {
+- (BOOL)isHub {
 	
-	NSNotificationCenter *notificationCenter = [NSNotificationCenter defaultCenter];
-	NSString *notificationName;
+	return (topology == kNetworkTopologyStar && [peerIDs count] > 1);
 	
-	/*
-	 If the localDieRoll matches the peerDieRoll then the die roll must be restarted. 
-	 */
-	if (localDieRoll == peerDieRoll) {
-		
-		playerID = kPlayerUndecided;
-		[self resetDieState];
-		[self sendNewDieRollPacket];
-		notificationName = RestartingDieRoll;
-		
-	} else if (localDieRoll > peerDieRoll) {
-		
-		/*
-		 If the localDieRoll is greater than the peerDieRoll then
-		 this device is player 1.
-		 */
-		playerID = kPlayer1;
-		notificationName = DieRollFinished;
-		
-	} else {
-		
-		/*
-		 Else this device is player 2
-		 */
-		playerID = kPlayer2;
-		notificationName = DieRollFinished;
+}
 
-	}
+- (double)roundTripTime {
 	
-	/*
-	 Post a notification to alert of the current die roll state. 
-	 */
-	[notificationCenter postNotificationName:notificationName object:self];
-	[self resetDieState];
+	double roundTripTime = 0.0;
 	
-	if (playerID != kPlayerUndecided) {
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+		
+		if (peers[i].link.reliableChannel.hasRoundTripTime) {
+			roundTripTime = MAX(roundTripTime, peers[i].link.reliableChannel.smoothedRoundTripTime);
+		}
 		
-		networkHeartbeatGenerator = [NSTimer scheduledTimerWithTimeInterval:kNetworkHeartbeatFrequency
-																	 target:self
-																   selector:@selector(networkHeartbeat:) 
-																   userInfo:nil 
-																	repeats:YES];
 	}
 	
+	return roundTripTime;
+	
 }
 
-/*
- When the heartbeat is received the lastHeartbeatData is updated. If the status was 
- attemptingNetworkReconnect then it is set to false.
- */
-- (void)peerHeartbeatReceived {
+- (LinkStatistics)linkStatistics {
 	
-	self.lastHeartbeatDate = [NSDate date];
-	if (attemptingNetworkReconnect) {
-		
-		attemptingNetworkReconnect = NO;
-		[[NSNotificationCenter defaultCenter] postNotificationName:PeerFound 
-															object:self 
-														  userInfo:nil];
-		
+	LinkStatistics statistics;
+	
+	if ([peerIDs count] > 0) {
+		statistics = peers[0].link.linkEstimator.statistics;
+	} else {
+		memset(&statistics, 0, sizeof(LinkStatistics));
 	}
 	
+	return statistics;
+	
 }
 
 /*
- This method ensures that the network is behaving as expected by sending heartbeat packets across every half second which should
- be answered by the peer. It checks the difference between the current time and the last heartbeat date. If 
- this is greater than two seconds then the status changes to attemptingNetworkReconnect and a notification is 
- posted to the layers so that they can alert the user. 
+ Returns the index of the peer whose link the messages of the player specified arrive over, or -1 if there
+ isn't one. A leaf of a star receives every player's messages from the hub.
  */
-- (void)networkHeartbeat:(NSTimer *)timer {
-
-	if (lastHeartbeatDate == nil) {
-		
-		self.lastHeartbeatDate = [NSDate date];
-		
-	} else if (fabs([lastHeartbeatDate timeIntervalSinceNow]) >= kMaximumNetworkHeartbeatInterval) {
-		
-		attemptingNetworkReconnect = YES;
-		
-		[[NSNotificationCenter defaultCenter] postNotificationName:PeerLost 
-															object:self 
-														  userInfo:nil];
+- (int)peerIndexForPlayer:(PlayerIdentifier)player {
+	
+	NSUInteger count = [peerIDs count];
+	
+	for (NSUInteger i = 0; i < count; i++) {
 		
-	} else if (attemptingNetworkReconnect == YES) {
-			
-			attemptingNetworkReconnect = NO;
-			[[NSNotificationCenter defaultCenter] postNotificationName:PeerFound 
-																object:self 
-															  userInfo:nil];
+		if (peers[i].playerID == player) {
+			return (int)i;
+		}
 		
 	}
-
-	/*
-	 When the app is running then the Directional data is sent often enough to compensate for the 
-	 heartbeat and therefore replaces it.
-	 */
-	if ([GameState sharedState].currentState != kGameRunning) {
-		
-		[self sendPacketWithType:kPacketTypePeerHeartbeat 
-					dataLocation:nil 
-					  dataLength:0 
-						reliable:NO];
-		
+	
+	if (topology == kNetworkTopologyStar && count == 1) {
+		return 0;
 	}
-
-}
-
-- (void)postNewGameLengthNotificationWithValue:(int)newGameLength {
 	
-	NSNumber *newGameLengthWrapper = [NSNumber numberWithInt:newGameLength];
-	NSDictionary *dataDictionary = [NSDictionary dictionaryWithObject:newGameLengthWrapper forKey:@"newGameLength"];
-	[[NSNotificationCenter defaultCenter] postNotificationName:NewGameLengthReceived 
-														object:self 
-													  userInfo:dataDictionary];
+	return -1;
 	
 }
 
-- (void)acknowledgePlayerReady {
+- (LinkStatistics)linkStatisticsForPlayer:(PlayerIdentifier)player {
+	
+	LinkStatistics statistics;
+	int peerIndex = [self peerIndexForPlayer:player];
+	
+	if (peerIndex >= 0) {
+		statistics = peers[peerIndex].link.linkEstimator.statistics;
+	} else {
+		memset(&statistics, 0, sizeof(LinkStatistics));
+	}
 	
-	[[NSNotificationCenter defaultCenter] postNotificationName:PeerReadyToPlay 
-														object:self 
-													  userInfo:nil];
+	return statistics;
 	
 }
 
-- (void)playerReadyAcknowledgementReceived {
-
-	[[NSNotificationCenter defaultCenter] postNotificationName:LocalPlayerReadyAcknowledged 
-														object:self 
-													  userInfo:nil];
+- (double)roundTripTimeToPlayer:(PlayerIdentifier)player {
+	
+	if (player < kPlayer1 || player > kMaximumNumberOfPlayers) {
+		return 0.0;
+	}
+	
+	return playerRoundTripTimes[player - 1];
 	
 }
 
-- (void)postGameCancelledNotification {
+- (ReplicationStatistics)replicationStatisticsForShipOfPlayer:(PlayerIdentifier)player {
+	
+	ReplicationStatistics statistics;
+	
+	memset(&statistics, 0, sizeof(ReplicationStatistics));
+	
+	if (player < kPlayer1 || player > kMaximumNumberOfPlayers) {
+		return statistics;
+	}
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+		ReplicationStatisticsAdd(&statistics, &peers[i].link.replication.entities[player - 1].statistics);
+	}
 	
-	[[NSNotificationCenter defaultCenter] postNotificationName:PeerCancelledGame 
-														object:self 
-													  userInfo:nil];
+	return statistics;
 	
 }
 
-- (void) actionLayerStatusCheck:(NSTimer *)timer {
-
-	if (localActionLayerReady) {
+- (ReplicationStatistics)projectileReplicationStatistics {
+	
+	ReplicationStatistics statistics;
+	
+	memset(&statistics, 0, sizeof(ReplicationStatistics));
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
 		
-		[timer invalidate];
-		[[NSNotificationCenter defaultCenter] postNotificationName:PeerActionLayerReady 
-															object:self 
-														  userInfo:nil];
+		for (int entity = kMaximumNumberOfPlayers; entity < kReplicationMaximumEntities; entity++) {
+			ReplicationStatisticsAdd(&statistics, &peers[i].link.replication.entities[entity].statistics);
+		}
 		
 	}
 	
+	return statistics;
+	
 }
 
-- (void)acknowledgeActionLayerReady {
+- (double)replicationStalenessOfShipOfPlayer:(PlayerIdentifier)player {
 	
-	if (localActionLayerReady) {
-		
-		[[NSNotificationCenter defaultCenter] postNotificationName:PeerActionLayerReady 
-															object:self 
-														  userInfo:nil];
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	double staleness = 0.0;
 	
-	} else {
-		
-		[NSTimer scheduledTimerWithTimeInterval:1.0/10.0 
-										 target:self
-									   selector:@selector(actionLayerStatusCheck:) 
-									   userInfo:nil 
-										repeats:YES];
-		
+	if (player < kPlayer1 || player > kMaximumNumberOfPlayers) {
+		return 0.0;
 	}
-
-					
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+		staleness = MAX(staleness, ReplicationSchedulerStaleness(&peers[i].link.replication, player - 1, now));
+	}
+	
+	return staleness;
+	
 }
 
-- (void)actionLayerReadyAcknowledgementReceived {
+- (double)directionalDataSendInterval {
 	
-	[[NSNotificationCenter defaultCenter] postNotificationName:ActionLayerReadyAcknowledged 
-														object:self 
-													  userInfo:nil];
+	double interval = 0.0;
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+		interval = MAX(interval, LinkEstimatorSendInterval(&peers[i].link.linkEstimator));
+	}
+	
+	return interval;
 	
 }
 
-/*
- The peer directional data is applied directly to the peerPlayer in the MultiplayerActionLayer
- using the reference available in the MultilayerGameScene. This avoids the overhead involved in
- sending data through the notification system. This is the same for TargetShipDetails and Projectile Details.
- */
-- (void)processPeerPlayerDirectionalDataReceived:(void *)directionalData {
+#pragma mark -
+#pragma mark BluetoothCommsManager Network Events
+
+- (void)setEventHandler:(id<NetworkEventHandler>)handler {
+	
+	NetworkEventQueueDiscard(&eventQueue);
+	eventHandler = handler;
 	
-	self.lastHeartbeatDate = [NSDate date];
+}
+
+- (void)removeEventHandler:(id<NetworkEventHandler>)handler {
 	
-	PlayerShipDirectionalInformation *directionalInformation = (PlayerShipDirectionalInformation *)directionalData;
+	if (eventHandler == handler) {
+		self.eventHandler = nil;
+	}
 	
-	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+}
+
+/*
+ Queues an event for the eventHandler.
+ */
+- (void)postEvent:(const NetworkEvent *)event {
 	
-	[actionLayer.peerPlayer applyDirectionalChangesWithNewHeading:directionalInformation->newHeading
-														 newSpeed:directionalInformation->newSpeed];
-	actionLayer.peerPlayer.position = directionalInformation -> currentPosition;
-	actionLayer.peerPlayer.rotation = directionalInformation -> currentRotation;
+	if (!NetworkEventQueuePush(&eventQueue, event)) {
+		NSLog(@"Network event queue full, dropped event %d", event->type);
+	}
 	
 }
 
-- (void)processTargetShipDetailsReceived:(void *)targetShipDetails {
+- (void)postEventWithType:(NetworkEventType)type {
 	
-	TargetShipDetails *targetData = (TargetShipDetails *)targetShipDetails;
+	NetworkEvent event;
 	
-	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+	memset(&event, 0, sizeof(NetworkEvent));
+	event.type = type;
+	[self postEvent:&event];
 	
-	[actionLayer spawnTargetWithType:targetData -> targetShipType 
-							 heading:targetData -> currentHeading 
-					startingPosition:targetData -> startingPosition];
-
 }
 
-- (void)processProjectileDetailsReceived:(void *)projectileDetails {
-	
-	ProjectileDetails *projectileData = (ProjectileDetails *)projectileDetails;
+/*
+ Passes every queued event to the eventHandler in the order they were posted. The handler is looked up again
+ for each event, because handling one may remove it. Events which arrive when there is no handler are dropped.
+ */
+- (void)dispatchNetworkEvents {
 	
-	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+	NetworkEvent event;
 	
-	[actionLayer fireProjectileWithStartingPosition:projectileData->startingPosition 
-								   destinationPoint:projectileData->destinationPoint
-											   ship:actionLayer.peerPlayer];
+	while (NetworkEventQueuePop(&eventQueue, &event)) {
+		[eventHandler processNetworkEvent:&event];
+	}
 	
 }
 
-- (void)postPeerPausedGameNotification {
+/*
+ Called by the CCScheduler at the start of every frame. The packets received since the last frame are
+ applied first, so that the events they post reach the eventHandler in the same frame.
+ */
+- (void)update:(ccTime)dt {
 	
-	[[NSNotificationCenter defaultCenter] postNotificationName:PeerPausedGame 
-														object:self 
-													  userInfo:nil];
+	[self processReceivedPackets];
+	[self dispatchNetworkEvents];
 	
 }
 
-- (void)postPeerResumedGameNotification:(NSTimer *)timer {
+- (void)dispatchNetworkEventsWhilePaused:(NSTimer *)timer {
 	
-	if (pauseMenuAcknowledgedPacketReceipt) {
-		
-		[timer invalidate];
+	if ([CCDirector sharedDirector].isPaused) {
 		
-	} else {
+		[self processReceivedPackets];
+		[self dispatchNetworkEvents];
 		
-		[[NSNotificationCenter defaultCenter] postNotificationName:PeerResumedGame 
-															object:self 
-														  userInfo:nil];		
+	}
+	
+}
+
+/*
+ Returns the BluetoothCommsManager to it's original state. The topology is kept for the next session.
+ */
+- (void)clearUpSession {
+	
+	/*
+	 Messages are only sent when the batches are flushed, so anything sent just before the session is cleared
+	 up, such as PeerQuitGame, is sent once now rather than being thrown away with the peers.
+	 */
+	if (transport != nil) {
 		
+		[self flushOutboundMessages];
+		[transport stop];
+		[transport release];
+		transport = nil;
 	}
 	
+	[self resetPeers];
+	playerID = kPlayerUndecided;
+	numberOfPlayers = 0;
+	
+	[self resetDieState];
+	[self resetLayerStateIndicators];
+	[self resetHeartbeatGenerator];
+	[self resetTrafficStatistics];
+	
+	/*
+	 Packets from the old session which haven't been applied yet are thrown away.
+	 */
+	PacketRingDiscard(&receivedPackets);
+	
 }
 
-- (void)schedulePeerResumedGameNotificationTimer {
+/*
+ Called when the transport fails. Posts a SessionFailed event and resets the BluetoothCommsManager.
+ */
+- (void)transport:(id<NetworkTransport>)failedTransport failedWithError:(NSError *)error {
 	
-	pauseMenuAcknowledgedPacketReceipt = NO;
+	NSLog(@"Error: %@", [error localizedDescription]);
 	
-	[NSTimer scheduledTimerWithTimeInterval:1.0/10.0 
-									 target:self
-								   selector:@selector(postPeerResumedGameNotification:) 
-								   userInfo:nil 
-									repeats:YES];
+	NetworkEvent event;
+	
+	event.type = kNetworkEventSessionFailed;
+	event.data.errorCode = (int)[error code];
+	[self postEvent:&event];
+	
+	[self clearUpSession];
+	
+}
+
+/*
+ When any peer disconnects this method is called. The game can't carry on without one of it's players, so
+ it posts a PeerDisconnected event and resets the BluetoothCommsManager.
+ */
+- (void)transport:(id<NetworkTransport>)disconnectedTransport peerDisconnected:(NSString *)peerID {
+	
+	[self postEventWithType:kNetworkEventPeerDisconnected];
+	
+	[self clearUpSession];
 	
 }
 
-- (void)postPeerResumedGameAcknowledgedNotification {
+#pragma mark -
+#pragma mark BluetoothCommsManager Die Roll
 
-	[[NSNotificationCenter defaultCenter] postNotificationName:PeerResumedGameAcknowledged 
-														object:self 
-													  userInfo:nil];
+/*
+ Sends the local roll to every peer, along with the round it belongs to and the number of devices this one is
+ connected to, which tells the peers whether this device is the hub of a star.
+ */
+- (void)sendDieRoll {
+	
+	uint8_t packetData[kNetworkPacketDataBufferSize];
+	WireWriter writer;
+	
+	WireWriterInit(&writer, packetData, sizeof(packetData));
+	WireWriteVarUInt(&writer, election.round);
+	WireWriteVarUInt(&writer, election.localRoll);
+	WireWriteVarUInt(&writer, (uint32_t)[peerIDs count]);
+	
+	[self sendPacketWithType:kPacketTypeDieRoll dataLocation:packetData dataLength:writer.length reliable:YES];
 	
 }
 
-- (void)postPeerQuitGameNotification {
+- (void)rollForRound:(uint32_t)round {
 	
-	[[NSNotificationCenter defaultCenter] postNotificationName:PeerQuitGame 
-														object:self 
-													  userInfo:nil];
+	PlayerElectionRoll(&election, round, generateRandomDieRoll());
+	dieRollStarted = YES;
+	[self sendDieRoll];
 	
 }
 
 /*
- This method extracts data from the NSData instance received over the network.
+ Called once the players have been decided, by the die roll or by the hub of a star. The links are measured
+ from the start of the match, and every peer is treated as just having been heard from.
  */
-- (void)receiveData:(NSData *)data fromPeer:(NSString *)peerID 
-		  inSession:(GKSession *)session context:(void *)context {
+- (void)finishDieRollAsPlayer:(PlayerIdentifier)localPlayer numberOfPlayers:(int)players seed:(uint32_t)seed {
 	
-	/*
-	 The bytes are extracted from the NSData instance to create an unsigned char array.
-	 */
-	unsigned char *packetData = (unsigned char *)[data bytes];
+	playerID = localPlayer;
+	numberOfPlayers = players;
+	matchSeed = seed;
 	
-	/*
-	 It is then possible to extract information from the array identifying the packet number and the 
-	 packet type.
-	 */
-	int *arrayPointer = (int *)&packetData[0];
+	[self resetDieState];
 	
-	int currentPacketNumber = arrayPointer[0];
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+	
+		LinkEstimatorInit(&peers[i].link.linkEstimator, now);
+		peers[i].lost = NO;
 	
-	if (currentPacketNumber < previousPacketNumber) {
-		return;
 	}
 	
-	previousPacketNumber = currentPacketNumber;
+	[self postEventWithType:kNetworkEventDieRollFinished];
 	
-	int packetType = arrayPointer[1];
+	networkHeartbeatGenerator = [NSTimer scheduledTimerWithTimeInterval:kNetworkHeartbeatFrequency
+																 target:self
+															   selector:@selector(networkHeartbeat:)
+															   userInfo:nil
+																repeats:YES];
+	
+}
+
+/*
+ Decides the PlayerIDs once every roll has arrived. If two rolls are the same a new round is started. The
+ hub of a star sends each leaf it's PlayerID, because the leaves can't see each other's rolls.
+ */
+- (void)determinePlayerIdentifiers {
+	
+	int localPlayer;
+	int peerPlayers[kNetworkMaximumPeers];
+	uint32_t seed;
+	
+	if (!PlayerElectionDecide(&election, &localPlayer, peerPlayers, &seed)) {
+	
+		[self rollForRound:election.round + 1];
+		[self postEventWithType:kNetworkEventRestartingDieRoll];
+		return;
+	
+	}
+	
+	int count = (int)[peerIDs count];
+	
+	for (int i = 0; i < count; i++) {
+		peers[i].playerID = peerPlayers[i];
+	}
+	
+	if (self.isHub) {
+	
+		for (int i = 0; i < count; i++) {
+	
+			uint8_t packetData[kNetworkPacketDataBufferSize];
+			WireWriter writer;
+	
+			WireWriterInit(&writer, packetData, sizeof(packetData));
+			WireWriteVarUInt(&writer, (uint32_t)(count + 1));
+			WireWriteVarUInt(&writer, (uint32_t)peerPlayers[i]);
+			WireWriteVarUInt(&writer, (uint32_t)localPlayer);
+			WireWriteUInt32(&writer, seed);
+	
+			[self sendPacketWithType:kPacketTypePlayerAssignment
+						dataLocation:packetData
+						  dataLength:writer.length
+							reliable:YES
+							  toPeer:i];
+	
+		}
+	
+	}
+	
+	[self finishDieRollAsPlayer:localPlayer numberOfPlayers:count + 1 seed:seed];
+	
+}
+
+/*
+ The die roll is decided once every peer has the local roll and every peer's roll has arrived, and every peer
+ is connected to the devices it should be: every other device in a mesh, or only the hub in a star. A leaf of
+ a star waits for the hub to tell it it's PlayerID instead.
+ */
+- (void)checkDieRoll {
+	
+	if (playerID != kPlayerUndecided || !dieRollStarted || !PlayerElectionIsComplete(&election)) {
+		return;
+	}
+	
+	int count = (int)[peerIDs count];
+	int expectedPeers = (topology == kNetworkTopologyStar) ? 1 : count;
+	
+	for (int i = 0; i < count; i++) {
+	
+		if (peers[i].connectedPeers != expectedPeers) {
+			return;
+		}
+	
+	}
+	
+	[self determinePlayerIdentifiers];
+	
+}
+
+/*
+ Every roll is acknowledged, even once the players have been decided, so that a peer which is still waiting
+ for the acknowledgement can finish. A roll from a later round means the peer restarted the die roll, so this
+ device rolls again and joins it.
+ */
+- (void)processDieRollFromPeer:(int)peerIndex reader:(WireReader *)reader {
+	
+	uint32_t round = WireReadVarUInt(reader);
+	uint32_t roll = WireReadVarUInt(reader);
+	uint32_t connectedPeers = WireReadVarUInt(reader);
+	
+	if (reader->error) {
+		return;
+	}
+	
+	peers[peerIndex].connectedPeers = (int)connectedPeers;
+	
+	uint8_t packetData[kNetworkPacketDataBufferSize];
+	WireWriter writer;
+	
+	WireWriterInit(&writer, packetData, sizeof(packetData));
+	WireWriteVarUInt(&writer, round);
+	WireWriteVarUInt(&writer, roll);
+	
+	[self sendPacketWithType:kPacketTypeDieRollReceived
+				dataLocation:packetData
+				  dataLength:writer.length
+					reliable:YES
+					  toPeer:peerIndex];
+	
+	if (playerID != kPlayerUndecided) {
+		return;
+	}
+	
+	if (PlayerElectionRollReceived(&election, peerIndex, round, roll) == kPlayerElectionRollFromLaterRound) {
+	
+		[self rollForRound:round];
+		PlayerElectionRollReceived(&election, peerIndex, round, roll);
+	
+	}
+	
+}
+
+- (void)processPlayerAssignmentFromPeer:(int)peerIndex reader:(WireReader *)reader {
+	
+	uint32_t players = WireReadVarUInt(reader);
+	uint32_t localPlayer = WireReadVarUInt(reader);
+	uint32_t hubPlayer = WireReadVarUInt(reader);
+	uint32_t seed = WireReadUInt32(reader);
+	
+	if (reader->error || playerID != kPlayerUndecided || players > kMaximumNumberOfPlayers ||
+		localPlayer < kPlayer1 || localPlayer > players || hubPlayer < kPlayer1 || hubPlayer > players) {
+		return;
+	}
+	
+	peers[peerIndex].playerID = hubPlayer;
+	[self finishDieRollAsPlayer:localPlayer numberOfPlayers:(int)players seed:seed];
+	
+}
+
+#pragma mark -
+#pragma mark BluetoothCommsManager Heartbeat
+
+/*
+ Recalculates the traffic rates once every kNetworkTrafficSampleInterval.
+ */
+- (void)updateTrafficRates {
+	
+	NSTimeInterval elapsed = fabs([trafficSampleDate timeIntervalSinceNow]);
+	
+	if (elapsed >= kNetworkTrafficSampleInterval) {
+	
+		trafficStatistics.messagesPerSecond = (trafficStatistics.totalMessages - trafficSample.totalMessages) / elapsed;
+		trafficStatistics.messageBytesPerSecond = (trafficStatistics.totalMessageBytes - trafficSample.totalMessageBytes) / elapsed;
+		trafficStatistics.packetsPerSecond = (trafficStatistics.totalPackets - trafficSample.totalPackets) / elapsed;
+		trafficStatistics.packetBytesPerSecond = (trafficStatistics.totalPacketBytes - trafficSample.totalPacketBytes) / elapsed;
+		trafficStatistics.packetsReceivedPerSecond = (trafficStatistics.totalPacketsReceived - trafficSample.totalPacketsReceived) / elapsed;
+		trafficStatistics.packetBytesReceivedPerSecond = (trafficStatistics.totalPacketBytesReceived - trafficSample.totalPacketBytesReceived) / elapsed;
+	
+		trafficSample = trafficStatistics;
+		[trafficSampleDate release];
+		trafficSampleDate = [[NSDate alloc] init];
+	
+	}
+	
+}
+
+/*
+ Pings every other player. The ping goes everywhere a player's messages go, so it is relayed by the hub of a
+ star.
+ */
+- (void)sendPlayerPing {
+	
+	playerPingNumber++;
+	playerPingSendTime = [BluetoothCommsManager currentTime];
+	
+	[self sendPacketWithType:kPacketTypePlayerPing integer:playerPingNumber reliable:NO];
+	
+}
+
+/*
+ This method ensures that the network is behaving as expected when no frames are being drawn. The link
+ estimators decide whether each peer has been lost, from how long it has been since anything arrived compared
+ with how often packets normally arrive. While any peer is lost the status changes to
+ attemptingNetworkReconnect and an event is posted to the layers so that they can alert the user.
+ */
+- (void)networkHeartbeat:(NSTimer *)timer {
+	
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	BOOL peerLost = NO;
+	
+	for (NSUInteger i = 0; i < [peerIDs count]; i++) {
+	
+		LinkEstimatorEvent event = LinkEstimatorUpdate(&peers[i].link.linkEstimator, now);
+	
+		if (event == kLinkEstimatorPeerLost) {
+			peers[i].lost = YES;
+		} else if (event == kLinkEstimatorPeerFound) {
+			peers[i].lost = NO;
+		}
+	
+		peerLost = peerLost || peers[i].lost;
+	
+	}
+	
+	if (peerLost && !attemptingNetworkReconnect) {
+	
+		attemptingNetworkReconnect = YES;
+		[self postEventWithType:kNetworkEventPeerLost];
+	
+	} else if (!peerLost && attemptingNetworkReconnect) {
+	
+		attemptingNetworkReconnect = NO;
+		[self postEventWithType:kNetworkEventPeerFound];
+	
+	}
+	
+	if (now - playerPingSendTime >= kPlayerPingInterval) {
+		[self sendPlayerPing];
+	}
+	
+	/*
+	 Nothing flushes the outbound messages while the game isn't running, so the heartbeat does it. This
+	 also sends the link reports when they are due.
+	 */
+	[self flushOutboundMessages];
+	[self updateTrafficRates];
+	
+}
+
+#pragma mark -
+#pragma mark BluetoothCommsManager Received Messages
+
+/*
+ Returns the bit of every player other than the local one, for checking the handshakes.
+ */
+- (unsigned int)otherPlayers {
+	
+	unsigned int players = 0;
+	
+	for (int player = kPlayer1; player <= numberOfPlayers; player++) {
+	
+		if (player != playerID) {
+			players |= (1u << player);
+		}
+	
+	}
+	
+	return players;
+	
+}
+
+/*
+ Adds a player to the set of players which have sent a handshake message. Returns YES if that player was
+ the last one the handshake was waiting for.
+ */
+- (BOOL)addPlayer:(PlayerIdentifier)player toHandshake:(unsigned int *)players {
+	
+	unsigned int otherPlayers = [self otherPlayers];
+	BOOL wasComplete = ((*players & otherPlayers) == otherPlayers);
+	
+	if (player >= kPlayer1 && player <= kMaximumNumberOfPlayers) {
+		*players |= (1u << player);
+	}
+	
+	return (!wasComplete && (*players & otherPlayers) == otherPlayers);
+	
+}
+
+- (void)postNewGameLengthEventWithValue:(int)newGameLength {
+	
+	NetworkEvent event;
+	
+	event.type = kNetworkEventNewGameLengthReceived;
+	event.data.gameLength = newGameLength;
+	[self postEvent:&event];
+	
+}
+
+- (void)acknowledgePlayerReady {
+	
+	[self postEventWithType:kNetworkEventPeerReadyToPlay];
+	
+}
+
+- (void)playerReadyAcknowledgementReceived {
+	
+	[self postEventWithType:kNetworkEventLocalPlayerReadyAcknowledged];
+	
+}
+
+- (void)postGameCancelledEvent {
+	
+	[self postEventWithType:kNetworkEventPeerCancelledGame];
+	
+}
+
+- (void) actionLayerStatusCheck:(NSTimer *)timer {
+	
+	if (localActionLayerReady) {
+	
+		[timer invalidate];
+		[self postEventWithType:kNetworkEventPeerActionLayerReady];
+	
+	}
+	
+}
+
+- (void)acknowledgeActionLayerReady {
+	
+	if (localActionLayerReady) {
+	
+		[self postEventWithType:kNetworkEventPeerActionLayerReady];
+	
+	} else {
+	
+		[NSTimer scheduledTimerWithTimeInterval:1.0/10.0
+										 target:self
+									   selector:@selector(actionLayerStatusCheck:)
+									   userInfo:nil
+										repeats:YES];
+	
+	}
+	
+	
+}
+
+- (void)actionLayerReadyAcknowledgementReceived {
+	
+	[self postEventWithType:kNetworkEventActionLayerReadyAcknowledged];
+	
+}
+
+/*
+ The peer directional data is passed directly to the MultiplayerActionLayer using the reference available
+ in the MultilayerGameScene. This avoids the overhead involved in sending data through the event
+ queue. This is the same for Projectile Details and spawn checksums. The layer buffers the directional
+ data and interpolates each peer player between the packets rather than moving it straight to each one.
+ */
+- (void)processDirectionalData:(const PlayerShipDirectionalInformation *)directionalInformation fromPlayer:(PlayerIdentifier)player {
+	
+	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+	
+	if (player >= kPlayer1 && player <= kMaximumNumberOfPlayers) {
+		
+		shipPositions[player - 1].x = directionalInformation->currentPositionX;
+		shipPositions[player - 1].y = directionalInformation->currentPositionY;
+		shipPositionKnown[player - 1] = YES;
+		
+	}
+	
+	[actionLayer addPeerSnapshotWithHeading:directionalInformation->newHeading
+									  speed:directionalInformation->newSpeed
+								   position:ccp(directionalInformation->currentPositionX, directionalInformation->currentPositionY)
+								   rotation:directionalInformation->currentRotation
+									 sentAt:directionalInformation->sendTime
+								 receivedAt:packetReceiveTime
+								 fromPlayer:player];
+	
+}
+
+- (void)processSpawnChecksumReceived:(uint32_t)checksum forTick:(uint32_t)tick fromPlayer:(PlayerIdentifier)player {
+	
+	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+	
+	[actionLayer comparePeerSpawnChecksum:checksum forTick:tick fromPlayer:player];
+	
+}
+
+- (void)processProjectileDetailsReceived:(ProjectileDetails *)projectileData fromPlayer:(PlayerIdentifier)player {
+	
+	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+	PlayerShip *ship = [actionLayer peerPlayerWithID:player];
+	
+	if (ship == nil) {
+		return;
+	}
+	
+	[actionLayer fireProjectileWithStartingPosition:ccp(projectileData->startingPositionX, projectileData->startingPositionY)
+								   destinationPoint:ccp(projectileData->destinationPointX, projectileData->destinationPointY)
+											   ship:ship];
+	
+}
+
+- (void)processRollbackInputsReceived:(const RollbackInputMessage *)message {
+	
+	MultiplayerActionLayer *actionLayer = (MultiplayerActionLayer *)[MultilayerGameScene sharedScene].actionLayer;
+	
+	[actionLayer addPeerRollbackInputs:message];
+	
+}
+
+/*
+ Answers a ping from another player. The reply is sent over the link the pinger's messages arrive on, so in
+ a star it is relayed by the hub.
+ */
+- (void)replyToPingNumber:(uint32_t)number fromPlayer:(PlayerIdentifier)player {
+	
+	uint8_t packetData[kNetworkPacketDataBufferSize];
+	WireWriter writer;
+	int peerIndex = [self peerIndexForPlayer:player];
+	
+	if (peerIndex < 0) {
+		return;
+	}
+	
+	WireWriterInit(&writer, packetData, sizeof(packetData));
+	WireWriteVarUInt(&writer, (uint32_t)player);
+	WireWriteVarUInt(&writer, number);
+	
+	[self sendPacketWithType:kPacketTypePlayerPingReply
+				dataLocation:packetData
+				  dataLength:writer.length
+					reliable:NO
+					  toPeer:peerIndex];
+	
+}
+
+/*
+ Replies to older pings are ignored, so a reply which took longer than kPlayerPingInterval is lost.
+ */
+- (void)processPingReplyNumber:(uint32_t)number fromPlayer:(PlayerIdentifier)player {
+	
+	if (number != playerPingNumber || player < kPlayer1 || player > kMaximumNumberOfPlayers) {
+		return;
+	}
+	
+	double sample = packetReceiveTime - playerPingSendTime;
+	double *roundTripTime = &playerRoundTripTimes[player - 1];
+	
+	if (*roundTripTime == 0.0) {
+		*roundTripTime = sample;
+	} else {
+		*roundTripTime += kPlayerPingSmoothing * (sample - *roundTripTime);
+	}
+	
+}
+
+- (void)postPeerPausedGameEvent {
+	
+	[self postEventWithType:kNetworkEventPeerPausedGame];
+	
+}
+
+- (void)postPeerResumedGameEvent:(NSTimer *)timer {
+	
+	if (pauseMenuAcknowledgedPacketReceipt) {
+	
+		[timer invalidate];
+	
+	} else {
+	
+		[self postEventWithType:kNetworkEventPeerResumedGame];
+	
+	}
+	
+}
+
+- (void)schedulePeerResumedGameEventTimer {
+	
+	pauseMenuAcknowledgedPacketReceipt = NO;
+	
+	[NSTimer scheduledTimerWithTimeInterval:1.0/10.0
+									 target:self
+								   selector:@selector(postPeerResumedGameEvent:)
+								   userInfo:nil
+									repeats:YES];
+	
+}
+
+- (void)postPeerResumedGameAcknowledgedEvent {
+	
+	[self postEventWithType:kNetworkEventPeerResumedGameAcknowledged];
+	
+}
+
+- (void)postPeerQuitGameEvent {
+	
+	[self postEventWithType:kNetworkEventPeerQuitGame];
+	
+}
+
+/*
+ Calls the correct handler method for a message about the game, from the player specified. The reader is
+ positioned at the start of the message's data. The handshakes only post their events once every other
+ player has sent the message.
+ */
+- (void)processPlayerMessageWithType:(int)packetType reader:(WireReader *)reader fromPlayer:(PlayerIdentifier)player {
 	
 	/*
-	 This switch statement calls the correct handler method to interpret the packet type received.
+	 This switch statement calls the correct handler method to interpret the packet type received. Packets
+	 whose data can't be decoded are dropped.
 	 */
 	switch (packetType) {
-			
+	
+		case kPacketTypeProjectileFired: {
+	
+			ProjectileDetails projectileDetails;
+	
+			if (WireReadProjectileDetails(reader, &projectileDetails)) {
+				[self processProjectileDetailsReceived:&projectileDetails fromPlayer:player];
+			}
+	
+		}
+		break;
+	
+		case kPacketTypeRollbackInputs: {
+	
+			RollbackInputMessage message;
+	
+			if (RollbackSessionReadMessage(reader, &message)) {
+				[self processRollbackInputsReceived:&message];
+			}
+	
+		}
+		break;
+	
+		case kPacketTypeSpawnChecksum: {
+	
+			uint32_t tick = WireReadVarUInt(reader);
+			uint32_t checksum = WireReadUInt32(reader);
+	
+			if (!reader->error) {
+				[self processSpawnChecksumReceived:checksum forTick:tick fromPlayer:player];
+			}
+	
+		}
+		break;
+	
+		case kPacketTypePlayerPing: {
+	
+			uint32_t number = WireReadVarUInt(reader);
+	
+			if (!reader->error) {
+				[self replyToPingNumber:number fromPlayer:player];
+			}
+	
+		}
+		break;
+	
+		case kPacketTypePlayerPingReply: {
+	
+			uint32_t pinger = WireReadVarUInt(reader);
+			uint32_t number = WireReadVarUInt(reader);
+	
+			if (!reader->error && pinger == (uint32_t)playerID) {
+				[self processPingReplyNumber:number fromPlayer:player];
+			}
+	
+		}
+		break;
+	
+		case kPacketTypePeerPausedGame: {
+	
+			playersResumed = 0;
+			playersAcknowledgedResumed = 0;
+			[self postPeerPausedGameEvent];
+		}
+		break;
+	
+		case kPacketTypePeerResumedGame: {
+	
+			if ([self addPlayer:player toHandshake:&playersResumed]) {
+				[self schedulePeerResumedGameEventTimer];
+			}
+		}
+		break;
+	
+		case kPacketTypeAcknowledgePeerResumedGame: {
+	
+			if ([self addPlayer:player toHandshake:&playersAcknowledgedResumed]) {
+				[self postPeerResumedGameAcknowledgedEvent];
+			}
+		}
+		break;
+	
+		case kPacketTypePeerQuitGame: {
+	
+			[self postPeerQuitGameEvent];
+		}
+		break;
+	
+		case kPacketTypeNewGameLength: {
+	
+			uint32_t newGameLength = WireReadVarUInt(reader);
+	
+			if (reader->error) {
+				break;
+			}
+	
+			[self postNewGameLengthEventWithValue:(int)newGameLength];
+		}
+		break;
+	
+		case kPacketTypePlayerReady: {
+	
+			if ([self addPlayer:player toHandshake:&playersReady]) {
+				[self acknowledgePlayerReady];
+			}
+		}
+		break;
+	
+		case kPacketTypeAcknowledgePlayerReady: {
+	
+			if ([self addPlayer:player toHandshake:&playersAcknowledgedReady]) {
+				[self playerReadyAcknowledgementReceived];
+			}
+		}
+		break;
+	
+		case kPacketTypeGameCancelled: {
+	
+			[self postGameCancelledEvent];
+		}
+		break;
+	
+		case kPacketTypeActionLayerReady: {
+	
+			if ([self addPlayer:player toHandshake:&playersActionLayerReady]) {
+				[self acknowledgeActionLayerReady];
+			}
+		}
+		break;
+	
+		case kPacketTypeAcknowledgeActionLayerReady: {
+	
+			if ([self addPlayer:player toHandshake:&playersAcknowledgedActionLayerReady]) {
+				[self actionLayerReadyAcknowledgementReceived];
+			}
+		}
+		break;
+	
+		default:
+			break;
+	}
+	
+}
+
+/*
+ Returns the latest position of the ship of the player a peer belongs to, which the updates sent to it are
+ weighted by, or NULL until it is known.
+ */
+- (const NetworkPoint *)receiverShipOfPeer:(int)peerIndex {
+	
+	PlayerIdentifier receiver = peers[peerIndex].playerID;
+	
+	if (receiver < kPlayer1 || receiver > kMaximumNumberOfPlayers || !shipPositionKnown[receiver - 1]) {
+		return NULL;
+	}
+	
+	return &shipPositions[receiver - 1];
+	
+}
+
+/*
+ The hub of a star passes a message from one leaf on to the others with the same reliability, wrapped in a
+ Relayed message which says which player it came from. The reader isn't moved.
+ */
+- (void)relayMessageWithType:(int)packetType reader:(const WireReader *)reader fromPeer:(int)sourceIndex reliable:(BOOL)sendReliably {
+	
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	
+	for (int i = 0; i < (int)[peerIDs count]; i++) {
+	
+		if (i == sourceIndex) {
+			continue;
+		}
+	
+		if (!NetworkLinkRelayMessage(&peers[i].link,
+									 peers[sourceIndex].playerID,
+									 (uint8_t)packetType,
+									 reader,
+									 sendReliably,
+									 [self receiverShipOfPeer:i],
+									 now)) {
+	
+			[self reliableChannelFullForPacketWithType:kPacketTypeRelayed];
+			return;
+	
+		}
+	
+	}
+	
+}
+
+/*
+ Directional data waits in the scheduler of each of the other leaves as the update of the source player's
+ ship.
+ */
+- (void)relayDirectionalData:(const PlayerShipDirectionalInformation *)directionalInformation fromPeer:(int)sourceIndex {
+	
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	
+	for (int i = 0; i < (int)[peerIDs count]; i++) {
+	
+		if (i != sourceIndex) {
+			NetworkLinkRelayDirectionalData(&peers[i].link, peers[sourceIndex].playerID, directionalInformation, [self receiverShipOfPeer:i], now);
+		}
+	
+	}
+	
+}
+
+/*
+ Calls the correct handler method for a single message from a peer. Messages about the link are handled
+ here, everything else is about the game and is passed on as coming from the peer's player, after the hub of
+ a star has relayed it. The reader is positioned at the start of the message's data.
+ */
+- (void)processMessageWithType:(int)packetType reader:(WireReader *)reader fromPeer:(int)peerIndex reliable:(BOOL)reliable {
+	
+	NetworkPeer *peer = &peers[peerIndex];
+	
+	switch (packetType) {
+	
 		case kPacketTypePeerPlayerShipDirectionalData: {
-			
-			[self processPeerPlayerDirectionalDataReceived:&packetData[8]];
-			
-		}
-		break;
-			
-		case kPacketTypeProjectileFired: {
-			
-			[self processProjectileDetailsReceived:&packetData[8]];
-			
+	
+			PlayerShipDirectionalInformation directionalInformation;
+	
+			if (NetworkLinkReceiveDirectionalData(&peer->link, reader, &directionalInformation)) {
+	
+				[self processDirectionalData:&directionalInformation fromPlayer:peer->playerID];
+	
+				if (self.isHub) {
+					[self relayDirectionalData:&directionalInformation fromPeer:peerIndex];
+				}
+	
+			}
+	
 		}
 		break;
-			
-		case kPacketTypeTargetShipSpawned: {
-			
-			[self processTargetShipDetailsReceived:&packetData[8]];
-		
+	
+		case kPacketTypeDirectionalDataAcknowledgement: {
+	
+			NetworkLinkReceiveDirectionalAcknowledgement(&peer->link, reader);
+	
 		}
 		break;
-			
-		case kPacketTypePeerHeartbeat: {
-			
-			[self peerHeartbeatReceived];
-			
+	
+		case kPacketTypeLinkReport: {
+	
+			LinkEstimatorReadReport(&peer->link.linkEstimator, reader, packetReceiveTime);
+	
 		}
 		break;
-		
+	
 		case kPacketTypeDieRoll: {
-			peerDieRoll = arrayPointer[2];
-			peerDieRollReceived = YES;
-			[self sendPacketWithType:kPacketTypeDieRollReceived dataLocation:&peerDieRoll 
-						  dataLength:sizeof(peerDieRoll) reliable:YES];
+	
+			[self processDieRollFromPeer:peerIndex reader:reader];
 		}
 		break;
-			
+	
 		case kPacketTypeDieRollReceived: {
-			int acknowledgedDieRoll = arrayPointer[2];
-			dieRollAcknowledged = YES;
-		}
-		break;
-			
-		case kPacketTypePeerPausedGame: {
-			
-			[self postPeerPausedGameNotification];
-		}
-		break;
-		
-		case kPacketTypePeerResumedGame: {
-			
-			[self schedulePeerResumedGameNotificationTimer];
-		}
-		break;
-			
-		case kPacketTypeAcknowledgePeerResumedGame: {
-			
-			[self postPeerResumedGameAcknowledgedNotification];
-		}
-		break;
-			
-		case kPacketTypePeerQuitGame: {
-			
-			[self postPeerQuitGameNotification];
-		}
-		break;
-			
-		case kPacketTypeNewGameLength: {
-			
-			[self postNewGameLengthNotificationWithValue:arrayPointer[2]];
-		}
-		break;
-			
-		case kPacketTypePlayerReady: {
-			
-			[self acknowledgePlayerReady];
-		}
-		break;
-			
-		case kPacketTypeAcknowledgePlayerReady: {
-			
-			[self playerReadyAcknowledgementReceived];
+	
+			uint32_t round = WireReadVarUInt(reader);
+			uint32_t roll = WireReadVarUInt(reader);
+	
+			if (!reader->error) {
+				PlayerElectionAcknowledgementReceived(&election, peerIndex, round, roll);
+			}
 		}
 		break;
-
-		case kPacketTypeGameCancelled: {
-			
-			[self postGameCancelledNotification];
+	
+		case kPacketTypePlayerAssignment: {
+	
+			[self processPlayerAssignmentFromPeer:peerIndex reader:reader];
 		}
 		break;
-			
-		case kPacketTypeActionLayerReady: {
-			
-			[self acknowledgeActionLayerReady];
+	
+		case kPacketTypeRelayed: {
+	
+			uint32_t player = WireReadVarUInt(reader);
+			uint8_t relayedType = WireReadUInt8(reader);
+	
+			if (!reader->error) {
+				[self processPlayerMessageWithType:relayedType reader:reader fromPlayer:(PlayerIdentifier)player];
+			}
 		}
 		break;
-			
-		case kPacketTypeAcknowledgeActionLayerReady: {
-			
-			[self actionLayerReadyAcknowledgementReceived];
+	
+		case kPacketTypeRelayedDirectionalData: {
+	
+			uint32_t player = WireReadVarUInt(reader);
+			PlayerShipDirectionalInformation directionalInformation;
+	
+			if (WireReadDirectionalInformation(reader, &directionalInformation) && !reader->error) {
+				[self processDirectionalData:&directionalInformation fromPlayer:(PlayerIdentifier)player];
+			}
 		}
 		break;
-
-		default:
+	
+		case kPacketTypeBatch:
+		case kPacketTypeReliableChannel:
 			break;
-	}	
 	
-	if (peerDieRollReceived && dieRollAcknowledged) {
-		
-		[self determinePlayerIdentifiers];
-		
+		default:
+	
+			if (self.isHub) {
+				[self relayMessageWithType:packetType reader:reader fromPeer:peerIndex reliable:reliable];
+			}
+	
+			[self processPlayerMessageWithType:packetType reader:reader fromPlayer:peer->playerID];
+			break;
 	}
 	
 }
 
-#pragma mark -
-#pragma mark Private Packet Sending Method
+/*
+ Passes data for a peer's reliable channel to it, then handles every message which is now ready in order.
+ */
+- (void)processReliableChannelData:(WireReader *)reader fromPeer:(int)peerIndex {
+	
+	uint8_t messageType;
+	WireReader message;
+	
+	ReliableChannelRead(&peers[peerIndex].link.reliableChannel, reader, packetReceiveTime);
+	
+	while (ReliableChannelReceive(&peers[peerIndex].link.reliableChannel, &messageType, &message)) {
+		[self processMessageWithType:messageType reader:&message fromPeer:peerIndex reliable:YES];
+	}
+	
+}
 
 /*
- The sendPacketWithTypeDataLocationDataLengthReliable method is private to the is class and 
- called from the public send methods below.
+ Called by the transport when a packet arrives, on whichever thread it receives on. Nothing is done with the
+ packet here apart from decoding it's header and adding it to the receivedPackets ring along with the index of
+ the peer it came from, so nothing else which belongs to the main thread is touched. Packets written with a
+ different version of the WireProtocol, which are too short to contain a header, or which come from a device
+ which isn't a connected peer, are ignored.
  */
-- (void)sendPacketWithType:(int)packetType dataLocation:(void *)data dataLength:(int)length reliable:(BOOL)sendReliably {
+- (void)transport:(id<NetworkTransport>)receivingTransport receivedData:(NSData *)data fromPeer:(NSString *)peerID {
+	
+	NSUInteger peerIndex;
+	
+	@synchronized(peerIDs) {
+		peerIndex = [peerIDs indexOfObject:peerID];
+	}
+	
+	if (peerIndex == NSNotFound) {
+		return;
+	}
 	
 	/*
-	 An unsigned char array of the required size is created to store the bytes which need to be transferred across the network.
+	 A packet which arrives while the ring is full is lost in the same way as one dropped by the radio.
 	 */
-	static unsigned char networkPacket[kNetworkDataPacketSize];
+	PacketRingPush(&receivedPackets, (const uint8_t *)[data bytes], [data length], (int)peerIndex, [BluetoothCommsManager currentTime]);
+	
+}
+
+/*
+ Applies a single received packet.
+ */
+- (void)processReceivedPacket:(const ReceivedPacket *)packet {
+	
+	WireReader reader;
+	WirePacketHeader header = packet->header;
+	int peerIndex = packet->source;
+	
+	if (peerIndex < 0 || peerIndex >= (int)[peerIDs count]) {
+		return;
+	}
+	
+	NetworkPeer *peer = &peers[peerIndex];
+	
+	WireReaderInit(&reader, packet->data, packet->dataLength);
+	packetReceiveTime = packet->receiveTime;
 	
 	/*
-	 The header contains the packet number and the packet type.
+	 The unreliable messages in a packet which arrives after a newer one are out of date and are ignored, as are
+	 those in a duplicate of a packet which has already been received.
+	 The reliable channel has it's own sequence numbers, so it's messages are always read.
 	 */
-	const unsigned int headerSize = 2 * sizeof(int);
+	BOOL outOfDate = !NetworkLinkPacketReceived(&peer->link, &header, packet->dataLength, packetReceiveTime);
 	
+	if (header.packetType == kPacketTypeBatch) {
 	
-	if (length < (kNetworkDataPacketSize - headerSize)) {
-		
-		packetNumber++;
-		
-		int *arrayPointer = (int *)&networkPacket[0];
-		arrayPointer[0] = packetNumber;
-		arrayPointer[1] = packetType;
-		
 		/*
-		 The memory at by the data pointer is copied into the network packet array. 
+		 A batch packet contains several messages which are handled in the order they were queued.
 		 */
-		if (data != nil) {
-			memcpy(&networkPacket[headerSize], data, length);
+		uint8_t messageType;
+		WireReader message;
+	
+		while (WireReadMessage(&reader, &messageType, &message)) {
+	
+			if (messageType == kPacketTypeReliableChannel) {
+				[self processReliableChannelData:&message fromPeer:peerIndex];
+			} else if (messageType != kPacketTypeBatch && !outOfDate) {
+				[self processMessageWithType:messageType reader:&message fromPeer:peerIndex reliable:NO];
+			}
+	
 		}
-		
-		/*
-		 The bytes in the array are wrapped in an NSData object for transfer over the network.
-		 */
-		NSData *packetData = [NSData dataWithBytes:networkPacket length:(length + 8)];
-		
-		if (sendReliably) {
-			[currentBluetoothSession sendData:packetData toPeers:peerIDs 
-								 withDataMode:GKSendDataReliable error:nil];
-		} else {
-			[currentBluetoothSession sendData:packetData toPeers:peerIDs 
-								 withDataMode:GKSendDataUnreliable error:nil];
+	
+	} else if (!outOfDate) {
+	
+		[self processMessageWithType:header.packetType reader:&reader fromPeer:peerIndex reliable:NO];
+	
+	}
+	
+	[self checkDieRoll];
+	
+}
+
+- (void)processReceivedPackets {
+	
+	const ReceivedPacket *packet;
+	
+	while ((packet = PacketRingPeek(&receivedPackets)) != NULL) {
+	
+		[self processReceivedPacket:packet];
+		PacketRingRelease(&receivedPackets);
+	
+	}
+	
+}
+
+#pragma mark -
+#pragma mark Private Packet Sending Methods
+
+/*
+ Hands a packet written by a peer's NetworkLink to the transport to send to that peer. Every packet which is
+ actually sent across the network goes through this method. Packets are always sent unreliably, reliability
+ is provided by the reliable channels.
+ */
+- (void)transmitPacket:(const uint8_t *)packet length:(size_t)length overLink:(NetworkLink *)link {
+	
+	for (int i = 0; i < (int)[peerIDs count]; i++) {
+	
+		if (&peers[i].link == link) {
+	
+			/*
+			 The bytes are wrapped in an NSData object for transfer over the network.
+			 */
+			NSData *packetData = [NSData dataWithBytes:packet length:length];
+	
+			[transport sendData:packetData toPeers:peers[i].destination reliable:NO];
+			return;
+	
 		}
-		
+	
+	}
+	
+}
+
+static void BluetoothCommsManagerTransmit(NetworkLink *link, const uint8_t *packet, size_t length, void *context) {
+	
+	[(BluetoothCommsManager *)context transmitPacket:packet length:length overLink:link];
+	
+}
+
+/*
+ Messages wait in a reliable channel's backlog while it's window is full. If the backlog is full too the peer
+ hasn't acknowledged anything for a long time, and the message can't be delivered, so the session fails.
+ */
+- (void)reliableChannelFullForPacketWithType:(int)packetType {
+	
+	NSString *description = [NSString stringWithFormat:@"Reliable channel full, packet of type %d could not be sent", packetType];
+	NSError *error = [NSError errorWithDomain:kNetworkErrorDomain
+										 code:kNetworkErrorReliableChannelFull
+									 userInfo:[NSDictionary dictionaryWithObject:description forKey:NSLocalizedDescriptionKey]];
+	
+	[self transport:transport failedWithError:error];
+	
+}
+
+/*
+ Puts together a peer's batch and sends it. Link reports are only sent once the players have been decided,
+ which is when the links start being measured.
+ */
+- (void)flushOutboundMessagesToPeer:(int)peerIndex {
+	
+	NetworkLinkFlush(&peers[peerIndex].link,
+					 (playerID == kPlayerUndecided) ? -1 : playerID - 1,
+					 &localShipInformation,
+					 [self receiverShipOfPeer:peerIndex],
+					 networkHeartbeatGenerator != nil,
+					 [BluetoothCommsManager currentTime]);
+	
+}
+
+- (void)flushOutboundMessages {
+	
+	for (int i = 0; i < (int)[peerIDs count]; i++) {
+		[self flushOutboundMessagesToPeer:i];
 	}
 	
 }
 
+/*
+ The sendPacketWithTypeDataLocationDataLengthReliableToPeer method is private to the is class and called
+ from the public send methods below, to send to one peer or, with kNetworkAllPeers, to every peer. The data
+ must already have been encoded with the WireProtocol. Unreliable packets are queued to be batched together.
+ Reliable packets are added to the reliable channel, which is written into the same batch. Neither is sent
+ straight away: during a game the batch goes at the end of the frame, and otherwise serviceReliableChannel:
+ sends it within kReliableChannelServiceInterval, so several reliable messages sent in a frame share a packet.
+ */
+- (void)sendPacketWithType:(int)packetType dataLocation:(const void *)data dataLength:(int)length reliable:(BOOL)sendReliably toPeer:(int)peerIndex {
+	
+	int firstPeer = (peerIndex == kNetworkAllPeers) ? 0 : peerIndex;
+	int lastPeer = (peerIndex == kNetworkAllPeers) ? (int)[peerIDs count] - 1 : peerIndex;
+	
+	for (int i = firstPeer; i <= lastPeer; i++) {
+	
+		if (!NetworkLinkSendMessage(&peers[i].link, (uint8_t)packetType, data, length, sendReliably)) {
+	
+			[self reliableChannelFullForPacketWithType:packetType];
+			return;
+	
+		}
+	
+	}
+	
+}
+
+- (void)sendPacketWithType:(int)packetType dataLocation:(const void *)data dataLength:(int)length reliable:(BOOL)sendReliably {
+	
+	[self sendPacketWithType:packetType dataLocation:data dataLength:length reliable:sendReliably toPeer:kNetworkAllPeers];
+	
+}
+
+/*
+ Sends a packet whose data is a single non-negative integer, written as a variable length integer.
+ */
+- (void)sendPacketWithType:(int)packetType integer:(int)value reliable:(BOOL)sendReliably toPeer:(int)peerIndex {
+	
+	uint8_t packetData[kNetworkPacketDataBufferSize];
+	WireWriter writer;
+	
+	WireWriterInit(&writer, packetData, sizeof(packetData));
+	WireWriteVarUInt(&writer, (uint32_t)value);
+	
+	[self sendPacketWithType:packetType dataLocation:packetData dataLength:writer.length reliable:sendReliably toPeer:peerIndex];
+	
+}
+
+- (void)sendPacketWithType:(int)packetType integer:(int)value reliable:(BOOL)sendReliably {
+	
+	[self sendPacketWithType:packetType integer:value reliable:sendReliably toPeer:kNetworkAllPeers];
+	
+}
+
 #pragma mark -
 #pragma mark Public Packet Sending Methods
 
 - (void)sendNewDieRollPacket {
 	
-	localDieRoll = generateRandomDieRoll();
-	[self sendPacketWithType:kPacketTypeDieRoll dataLocation:&localDieRoll 
-				  dataLength:sizeof(localDieRoll) reliable:YES];
+	if (!dieRollStarted) {
+		[self rollForRound:election.round];
+	}
 	
 }
 
 - (void)sendNewGameLengthPacket:(int)gameLength {
-
-	[self sendPacketWithType:kPacketTypeNewGameLength dataLocation:&gameLength
-				  dataLength:sizeof(gameLength) reliable:YES];
+	
+	[self sendPacketWithType:kPacketTypeNewGameLength integer:gameLength reliable:YES];
 	
 }
 
 - (void)sendPlayerReadyPacket {
-
-	[self sendPacketWithType:kPacketTypePlayerReady dataLocation:nil 
+	
+	[self sendPacketWithType:kPacketTypePlayerReady dataLocation:nil
 				  dataLength:0 reliable:YES];
 	
 }
 
 - (void)sendAcknowledgePlayerReadyPacket {
-		
+	
 	[self sendPacketWithType:kPacketTypeAcknowledgePlayerReady
 				dataLocation:nil
 				  dataLength:0
@@ -714,27 +1734,27 @@ static BluetoothCommsManager *sharedInstance = nil;
 }
 
 - (void)sendGameCancelledPacket {
-
+	
 	[self sendPacketWithType:kPacketTypeGameCancelled
 				dataLocation:nil
-				  dataLength:0 
+				  dataLength:0
 					reliable:YES];
 	
 }
 
 - (void)sendActionLayerReadyPacket {
-
+	
 	localActionLayerReady = YES;
 	
 	[self sendPacketWithType:kPacketTypeActionLayerReady
 				dataLocation:nil
-				  dataLength:0 
+				  dataLength:0
 					reliable:YES];
 	
 }
 
 - (void)sendAcknowledgeActionLayerReadyPacket {
-
+	
 	[self sendPacketWithType:kPacketTypeAcknowledgeActionLayerReady
 				dataLocation:nil
 				  dataLength:0
@@ -742,55 +1762,102 @@ static BluetoothCommsManager *sharedInstance = nil;
 	
 }
 
+/*
+ Each peer has it's own directional stream, so the data is only kept here and is encoded separately for each
+ of them as their batch is put together, when it's size becomes known.
+ */
 - (void)sendLocalPlayerShipDirectionalDataWithNewHeading:(float)newHeading newSpeed:(float)newSpeed currentPosition:(CGPoint)currentPosition currentRotation:(float)currentRotation {
 	
-	PlayerShipDirectionalInformation directionalInformation = {newHeading, 
-															   newSpeed, 
-														       currentPosition, 
-														       currentRotation};
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	PlayerShipDirectionalInformation directionalInformation = {newHeading,
+															   newSpeed,
+														       currentPosition.x,
+														       currentPosition.y,
+														       currentRotation,
+															   WireQuantizeTime(now)};
 	
-	[self sendPacketWithType:kPacketTypePeerPlayerShipDirectionalData
-				dataLocation:&directionalInformation
-				  dataLength:sizeof(PlayerShipDirectionalInformation)
-					reliable:NO];
+	if (playerID == kPlayerUndecided) {
+		return;
+	}
+	
+	localShipInformation = directionalInformation;
+	shipPositions[playerID - 1].x = currentPosition.x;
+	shipPositions[playerID - 1].y = currentPosition.y;
+	shipPositionKnown[playerID - 1] = YES;
+	
+	for (int i = 0; i < (int)[peerIDs count]; i++) {
+		NetworkLinkLocalShipChanged(&peers[i].link, playerID - 1, now);
+	}
 	
 }
 
-- (void)sendTargetSpawnDetailsWithType:(int)targetShipType currentHeading:(float)currentHeading startingPosition:(CGPoint)startingPosition {
+- (void)sendSpawnChecksum:(uint32_t)checksum forTick:(uint32_t)tick {
+	
+	uint8_t packetData[kNetworkPacketDataBufferSize];
+	WireWriter writer;
+	
+	WireWriterInit(&writer, packetData, sizeof(packetData));
+	WireWriteVarUInt(&writer, tick);
+	WireWriteUInt32(&writer, checksum);
+	
+	/*
+	 Checksums are rare and a lost one would leave a gap in the divergence checking, so they go over the
+	 reliable channel.
+	 */
+	[self sendPacketWithType:kPacketTypeSpawnChecksum
+				dataLocation:packetData
+				  dataLength:writer.length
+					reliable:YES];
+}
 
-	TargetShipDetails targetShipDetails = {targetShipType, currentHeading, startingPosition};
+- (void)sendRollbackInputsFromSession:(const RollbackSession *)session {
+	
+	uint8_t packetData[kNetworkRollbackDataBufferSize];
+	WireWriter writer;
 	
-	[self sendPacketWithType:kPacketTypeTargetShipSpawned
-				dataLocation:&targetShipDetails
-				  dataLength:sizeof(targetShipDetails)
+	WireWriterInit(&writer, packetData, sizeof(packetData));
+	if (!RollbackSessionWriteMessage(session, &writer)) {
+		return;
+	}
+	
+	[self sendPacketWithType:kPacketTypeRollbackInputs
+				dataLocation:packetData
+				  dataLength:writer.length
 					reliable:NO];
+	
 }
 
 - (void)sendProjectileFiredDetailsWithStartingPosition:(CGPoint)startingPosition destinationPoint:(CGPoint)destinationPoint {
-
-	ProjectileDetails projectileDetails = {startingPosition, destinationPoint};
 	
-	[self sendPacketWithType:kPacketTypeProjectileFired
-				dataLocation:&projectileDetails 
-				  dataLength:sizeof(projectileDetails) 
-					reliable:NO];
+	ProjectileDetails projectileDetails = {startingPosition.x, startingPosition.y, destinationPoint.x, destinationPoint.y};
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	
+	for (int i = 0; i < (int)[peerIDs count]; i++) {
+		NetworkLinkSendProjectile(&peers[i].link, &projectileDetails, [self receiverShipOfPeer:i], now);
+	}
 	
 }
 
+/*
+ The local player pausing starts a new resume handshake, as does any other player pausing.
+ */
 - (void)sendPeerPausedGamePacket {
-
+	
+	playersResumed = 0;
+	playersAcknowledgedResumed = 0;
+	
 	[self sendPacketWithType:kPacketTypePeerPausedGame
 				dataLocation:nil
-				  dataLength:0 
+				  dataLength:0
 					reliable:YES];
 	
 }
 
 - (void)sendPeerResumedGamePacket {
-
+	
 	[self sendPacketWithType:kPacketTypePeerResumedGame
 				dataLocation:nil
-				  dataLength:0 
+				  dataLength:0
 					reliable:YES];
 	
 }
@@ -807,9 +1874,9 @@ static BluetoothCommsManager *sharedInstance = nil;
 }
 
 - (void)sendPeerQuitGamePacket {
-
+	
 	[self sendPacketWithType:kPacketTypePeerQuitGame
-				dataLocation:nil 
+				dataLocation:nil
 				  dataLength:0
 					reliable:YES];
 	
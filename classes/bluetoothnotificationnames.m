@@ -1,30 +0,0 @@
-//
-//  BluetoothNotificationNames.m
-//  AberFighter
-//
-//  Created by wde7 on 22/03/2011.
-//  Copyright 2011 William Darius Elphick. All rights reserved.
-//
-
-#import "BluetoothNotificationNames.h"
-
-NSString *const SessionFailedWithError = @"SessionFailedWithError";
-NSString *const PeerWasDisconnected = @"PeerChangedState";
-NSString *const PeerLost = @"PeerLost";
-NSString *const PeerFound = @"PeerFound";
-NSString *const RestartingDieRoll = @"RestartingDieRoll";
-NSString *const DieRollFinished = @"DieRollFinished";
-NSString *const NewGameLengthReceived = @"NewGameLengthReceived";
-NSString *const PeerReadyToPlay = @"PeerReadyToPlay";
-NSString *const LocalPlayerReadyAcknowledged = @"LocalPlayerReadyAcknowledged";
-NSString *const PeerCancelledGame = @"PeerCancelledGame";
-NSString *const PeerActionLayerReady = @"PeerActionLayerReady";
-NSString *const ActionLayerReadyAcknowledged = @"ActionLayerReadyAcknowledged";
-NSString *const PeerDirectionalDataReceived = @"PeerDirectionalDataReceived";
-NSString *const TargetShipSpawned = @"TargetShipSpawned";
-NSString *const ProjectileFired = @"ProjectileFired";
-NSString *const PeerPausedGame = @"PeerPausedGame";
-NSString *const PeerResumedGame = @"PeerResumedGame";
-NSString *const PeerResumedGameAcknowledged = @"PeerResumedGameAcknowledged";
-NSString *const PeerQuitGame = @"PeerQuitGame";
-
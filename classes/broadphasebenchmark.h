@@ -0,0 +1,57 @@
+//
+//  BroadphaseBenchmark.h
+//  AberFighter
+//
+//  Created by wde7 on 14/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The BroadphaseBenchmark compares the CollisionGrid against the brute force comparison which nextFrame made
+ before it, where every ship was checked against every projectile. Ships and projectiles of the sizes used
+ by the game are spread at random over the screen and the collisions of a frame are found both ways: the
+ grid is emptied, every projectile added and each ship queried, as nextFrame does. The projectiles move a
+ little between frames so that the grid is rebuilt from new positions every time. The mean time of a frame
+ with each approach is logged and kept in the result, and both must find the same number of collisions.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*
+ When kBroadphaseBenchmarkOnLaunch is 1 the benchmark is run with several numbers of ships and projectiles
+ when the app launches, and the results are logged.
+ */
+#define kBroadphaseBenchmarkOnLaunch	0
+//Frames timed in each run.
+#define kBroadphaseBenchmarkFrames		600
+
+typedef struct {
+
+	int ships;
+	int projectiles;
+
+	//Seconds taken to find the collisions of a frame by brute force and with the CollisionGrid.
+	double bruteForceFrameTime;
+	double gridFrameTime;
+
+	//Collisions found over every frame by each approach, which should be the same.
+	unsigned long bruteForceCollisions;
+	unsigned long gridCollisions;
+
+} BroadphaseBenchmarkResult;
+
+@interface BroadphaseBenchmark : NSObject {
+
+}
+
+/*
+ Runs the benchmark with the numbers of ships and projectiles of a normal game, a busy one and one with every
+ target the game allows on the screen, and logs the results.
+ */
++ (void)compareNumbersOfSprites;
+
+/*
+ Runs the benchmark once with the numbers of ships and projectiles specified and logs the result.
+ */
++ (BroadphaseBenchmarkResult)runWithShips:(int)numberOfShips projectiles:(int)numberOfProjectiles;
+
+@end
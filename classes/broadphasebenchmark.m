@@ -0,0 +1,159 @@
+//
+//  BroadphaseBenchmark.m
+//  AberFighter
+//
+//  Created by wde7 on 14/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "BroadphaseBenchmark.h"
+#import "CollidableSprite.h"
+#import "CollisionGrid.h"
+#import "GameConstants.h"
+
+@implementation BroadphaseBenchmark
+
++ (void)compareNumbersOfSprites {
+
+	[self runWithShips:8 projectiles:20];
+	[self runWithShips:20 projectiles:60];
+	[self runWithShips:(kGameMaximumActiveSmallTargets + kGameMaximumActiveLargeTargets + 1) projectiles:200];
+
+}
+
+/*
+ Creates a sprite of the size specified at a random position on the screen. The sprite is retained by the
+ array.
+ */
++ (CollidableSprite *)addSpriteOfSize:(float)size toArray:(NSMutableArray *)array random:(uint32_t *)random {
+
+	CollidableSprite *sprite = [[CollidableSprite alloc] init];
+
+	*random = *random * 1664525u + 1013904223u;
+	float x = (float)((*random >> 8) % kGameScreenWidth);
+	*random = *random * 1664525u + 1013904223u;
+	float y = (float)((*random >> 8) % kGameScreenHeight);
+
+	sprite.contentSize = CGSizeMake(size, size);
+	sprite.position = ccp(x, y);
+	[array addObject:sprite];
+	[sprite release];
+
+	return sprite;
+
+}
+
+/*
+ Moves every projectile a little to the right and up, wrapping around the edges of the screen.
+ */
++ (void)moveProjectiles:(NSArray *)projectiles {
+
+	for (CollidableSprite *projectile in projectiles) {
+
+		CGPoint position = projectile.position;
+		position.x = fmodf(position.x + 3.0f, kGameScreenWidth);
+		position.y = fmodf(position.y + 2.0f, kGameScreenHeight);
+		projectile.position = position;
+
+	}
+
+}
+
++ (BroadphaseBenchmarkResult)runWithShips:(int)numberOfShips projectiles:(int)numberOfProjectiles {
+
+	BroadphaseBenchmarkResult result;
+	NSMutableArray *ships = [[NSMutableArray alloc] initWithCapacity:numberOfShips];
+	NSMutableArray *projectiles = [[NSMutableArray alloc] initWithCapacity:numberOfProjectiles];
+	CollisionGrid *grid = [[CollisionGrid alloc] initWithSize:CGSizeMake(kGameScreenWidth, kGameScreenHeight) cellSize:kCollisionGridCellSize];
+	uint32_t random = 1;
+
+	memset(&result, 0, sizeof(result));
+
+	//Half of the ships are small targets and half are large targets.
+	for (int i = 0; i < numberOfShips; i++) {
+		[self addSpriteOfSize:((i & 1) ? kGameLargeTargetImageSize : kGameSmallTargetImageSize) toArray:ships random:&random];
+	}
+
+	for (int i = 0; i < numberOfProjectiles; i++) {
+		[self addSpriteOfSize:kGameProjectileImageSize toArray:projectiles random:&random];
+	}
+
+	/*
+	 Each approach is timed over the same frames, with the projectiles moved between the frames outside the
+	 timing. The projectiles are moved back to where they started before the grid is timed.
+	 */
+	CFTimeInterval bruteForceTime = 0.0;
+	CFTimeInterval gridTime = 0.0;
+	CGPoint *startPositions = malloc(sizeof(CGPoint) * numberOfProjectiles);
+
+	for (int i = 0; i < numberOfProjectiles; i++) {
+		startPositions[i] = ((CollidableSprite *)[projectiles objectAtIndex:i]).position;
+	}
+
+	for (int frame = 0; frame < kBroadphaseBenchmarkFrames; frame++) {
+
+		CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+		for (CollidableSprite *ship in ships) {
+
+			for (CollidableSprite *projectile in projectiles) {
+
+				if ([projectile checkCollisionWithCollidableSprite:ship]) {
+					result.bruteForceCollisions++;
+				}
+
+			}
+
+		}
+
+		bruteForceTime += CFAbsoluteTimeGetCurrent() - startTime;
+		[self moveProjectiles:projectiles];
+
+	}
+
+	for (int i = 0; i < numberOfProjectiles; i++) {
+		((CollidableSprite *)[projectiles objectAtIndex:i]).position = startPositions[i];
+	}
+
+	for (int frame = 0; frame < kBroadphaseBenchmarkFrames; frame++) {
+
+		CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+		[grid removeAllCollidableSprites];
+
+		for (CollidableSprite *projectile in projectiles) {
+			[grid addCollidableSprite:projectile];
+		}
+
+		for (CollidableSprite *ship in ships) {
+			result.gridCollisions += [[grid collidableSpritesInCollisionWithCollidableSprite:ship] count];
+		}
+
+		gridTime += CFAbsoluteTimeGetCurrent() - startTime;
+		[self moveProjectiles:projectiles];
+
+	}
+
+	result.ships = numberOfShips;
+	result.projectiles = numberOfProjectiles;
+	result.bruteForceFrameTime = bruteForceTime / kBroadphaseBenchmarkFrames;
+	result.gridFrameTime = gridTime / kBroadphaseBenchmarkFrames;
+
+	free(startPositions);
+	[grid release];
+	[projectiles release];
+	[ships release];
+
+	NSLog(@"Collisions between %d ships and %d projectiles: brute force %.1f us per frame (%lu collisions), "
+		  @"CollisionGrid %.1f us per frame (%lu collisions)",
+		  result.ships, result.projectiles,
+		  result.bruteForceFrameTime * 1.0e6, result.bruteForceCollisions,
+		  result.gridFrameTime * 1.0e6, result.gridCollisions);
+
+	NSAssert(result.bruteForceCollisions == result.gridCollisions, @"BroadphaseBenchmark: the CollisionGrid and the brute force comparison found different collisions");
+
+	return result;
+
+}
+
+@end
@@ -12,6 +12,7 @@
 
 #import <Foundation/Foundation.h>
 #import "cocos2d.h"
+#import "EntityStore.h"
 
 @interface CollidableSprite : CCSprite {
 	
@@ -20,6 +21,13 @@
 	 detection to avoid making unnecessary comparisons between objects.
 	 */
 	BOOL hasCollided;
+	
+	/*
+	 Index of the entry which holds this sprite's movement data in an EntityStore. The owning layer
+	 keeps this up to date as entities are added and removed. kEntityIndexNone when the sprite
+	 is not in a store.
+	 */
+	int entityIndex;
 
 }
 
@@ -27,6 +35,7 @@
  Property declarations for the instance variables.
  */
 @property (nonatomic,readwrite,assign) BOOL hasCollided;
+@property (nonatomic,readwrite,assign) int entityIndex;
 
 /*
  Takes a CollidableSprite as a parameter and returns a boolean indicating whether this 
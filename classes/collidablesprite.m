@@ -14,15 +14,18 @@
  Automatically creates getter and setter methods for the hasCollided property.
  */
 @synthesize hasCollided;
+@synthesize entityIndex;
 
 /*
  Initializer method. Creates an instance of this class, sets the default values for instance 
- variables and returns a reference to the instance. hasCollided is initially false.
+ variables and returns a reference to the instance. hasCollided is initially false and the
+ sprite is not in an EntityStore.
  */
 - (id)init {
 	
 	if ((self = [super init])) {
 		self.hasCollided = NO;	
+		self.entityIndex = kEntityIndexNone;
 	}
 	
 	return self;
@@ -46,12 +49,18 @@
 	 to the height. The minimumIntersectionDistance is the sum of the radii of the two bounding circles.
 	 If the distance between the centers of both sprites is less than the sum of the two radii, then
 	 the sprites are in collision. Distance between centers is calculated using the pythagoras theorem.
+	 Both sides of the comparison are squared to avoid calculating a square root. The positions are read
+	 once into local variables rather than through the property accessors for every term.
 	 */
+	CGPoint position = self.position;
+	CGPoint otherPosition = otherSprite.position;
+	
 	float minimumIntersectionDistance = (otherSprite.contentSize.width / 2) + (self.contentSize.width / 2);
-	float distanceBetweenSprites = sqrt((pow((self.position.x - otherSprite.position.x), 2) 
-										 + pow((self.position.y - otherSprite.position.y), 2)));
+	float xDistance = position.x - otherPosition.x;
+	float yDistance = position.y - otherPosition.y;
+	float distanceBetweenSpritesSquared = (xDistance * xDistance) + (yDistance * yDistance);
 	
-	if (minimumIntersectionDistance > distanceBetweenSprites) {
+	if ((minimumIntersectionDistance * minimumIntersectionDistance) > distanceBetweenSpritesSquared) {
 		
 		/*
 		 When a collision has occured hasCollided is set to true. This is so that when performing collision detection 
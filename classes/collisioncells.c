@@ -0,0 +1,271 @@
+//
+//  CollisionCells.c
+//  AberFighter
+//
+//  Created by wde7 on 05/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "CollisionCells.h"
+#include "CollisionKernel.h"
+
+/*
+ Changes the size of a single array. On failure the original array is left untouched and 0 is returned.
+ */
+static int CollisionCellsResizeArray(void **array, size_t elementSize, unsigned int capacity) {
+
+	void *resized = realloc(*array, elementSize * capacity);
+
+	if (resized == NULL) {
+		return 0;
+	}
+
+	*array = resized;
+	return 1;
+
+}
+
+/*
+ Changes the capacity of the per circle arrays. The grid starts with room for a typical number of projectiles
+ and doubles in size whenever it runs out, so after the first few frames no memory is allocated.
+ */
+static int CollisionCellsSetCapacity(CollisionCells *cells, unsigned int capacity) {
+
+	if (!CollisionCellsResizeArray((void **)&cells->positionX, sizeof(float), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->positionY, sizeof(float), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->radius, sizeof(float), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->cellIndices, sizeof(int), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->sortedIndices, sizeof(unsigned int), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->sortedPositionX, sizeof(float), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->sortedPositionY, sizeof(float), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->sortedRadius, sizeof(float), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->hits, sizeof(unsigned int), capacity) ||
+		!CollisionCellsResizeArray((void **)&cells->hitMask, sizeof(uint32_t), CollisionKernelMaskWordCount(capacity))) {
+		return 0;
+	}
+
+	cells->capacity = capacity;
+	return 1;
+
+}
+
+CollisionCells *CollisionCellsNew(float width, float height, float cellSize) {
+
+	CollisionCells *cells = (CollisionCells *)calloc(1, sizeof(CollisionCells));
+
+	if (cells == NULL) {
+		return NULL;
+	}
+
+	cells->cellSize = cellSize;
+
+	/*
+	 Round up so that the grid always covers the entire area. There is always at least one cell.
+	 */
+	cells->columns = (int)ceilf(width / cellSize);
+	cells->rows = (int)ceilf(height / cellSize);
+
+	if (cells->columns < 1) {
+		cells->columns = 1;
+	}
+
+	if (cells->rows < 1) {
+		cells->rows = 1;
+	}
+
+	cells->cellStarts = (unsigned int *)calloc((cells->columns * cells->rows) + 1, sizeof(unsigned int));
+	cells->sorted = 1;
+
+	if (cells->cellStarts == NULL || !CollisionCellsSetCapacity(cells, 64)) {
+		CollisionCellsFree(cells);
+		return NULL;
+	}
+
+	return cells;
+
+}
+
+void CollisionCellsFree(CollisionCells *cells) {
+
+	if (cells == NULL) {
+		return;
+	}
+
+	free(cells->positionX);
+	free(cells->positionY);
+	free(cells->radius);
+	free(cells->cellIndices);
+	free(cells->sortedIndices);
+	free(cells->sortedPositionX);
+	free(cells->sortedPositionY);
+	free(cells->sortedRadius);
+	free(cells->cellStarts);
+	free(cells->hitMask);
+	free(cells->hits);
+	free(cells);
+
+}
+
+/*
+ Converts a coordinate into a column or row index. Coordinates outside the grid are clamped onto the
+ nearest edge cell.
+ */
+static inline int CollisionCellsIndexForCoordinate(float coordinate, float cellSize, int cellCount) {
+
+	int index = (int)floorf(coordinate / cellSize);
+
+	if (index < 0) {
+
+		index = 0;
+
+	} else if (index >= cellCount) {
+
+		index = cellCount - 1;
+
+	}
+
+	return index;
+
+}
+
+void CollisionCellsRemoveAll(CollisionCells *cells) {
+
+	cells->count = 0;
+	cells->sorted = 0;
+	cells->largestRadius = 0.0f;
+
+}
+
+int CollisionCellsAdd(CollisionCells *cells, float x, float y, float radius) {
+
+	if (cells->count == cells->capacity && !CollisionCellsSetCapacity(cells, cells->capacity * 2)) {
+		return 0;
+	}
+
+	int column = CollisionCellsIndexForCoordinate(x, cells->cellSize, cells->columns);
+	int row = CollisionCellsIndexForCoordinate(y, cells->cellSize, cells->rows);
+	unsigned int index = cells->count;
+
+	cells->positionX[index] = x;
+	cells->positionY[index] = y;
+	cells->radius[index] = radius;
+	cells->cellIndices[index] = (row * cells->columns) + column;
+	cells->count++;
+
+	cells->sorted = 0;
+
+	if (radius > cells->largestRadius) {
+		cells->largestRadius = radius;
+	}
+
+	return 1;
+
+}
+
+/*
+ Counting sort of the circles by cell index. The first pass counts the circles in each cell, the counts are then
+ turned into the starting offset of each cell and the second pass copies each circle into it's cell. The sort is
+ stable, so the circles in each cell remain in the order they were added.
+ */
+static void CollisionCellsSort(CollisionCells *cells) {
+
+	int cellCount = cells->columns * cells->rows;
+	unsigned int *cellStarts = cells->cellStarts;
+
+	memset(cellStarts, 0, sizeof(unsigned int) * (cellCount + 1));
+
+	for (unsigned int i = 0; i < cells->count; i++) {
+		cellStarts[cells->cellIndices[i] + 1]++;
+	}
+
+	for (int cell = 0; cell < cellCount; cell++) {
+		cellStarts[cell + 1] += cellStarts[cell];
+	}
+
+	/*
+	 cellStarts[cell] is used as the insertion point for each cell and is incremented as circles are copied,
+	 which leaves it pointing at the start of the next cell. Shifting the array back afterwards restores the
+	 starting offsets.
+	 */
+	for (unsigned int i = 0; i < cells->count; i++) {
+
+		unsigned int destination = cellStarts[cells->cellIndices[i]]++;
+
+		cells->sortedIndices[destination] = i;
+		cells->sortedPositionX[destination] = cells->positionX[i];
+		cells->sortedPositionY[destination] = cells->positionY[i];
+		cells->sortedRadius[destination] = cells->radius[i];
+
+	}
+
+	memmove(&cellStarts[1], &cellStarts[0], sizeof(unsigned int) * cellCount);
+	cellStarts[0] = 0;
+
+	cells->sorted = 1;
+
+}
+
+/*
+ Finds the range of cells overlapped by the probe, expanded by the largest radius in the grid. The cells in
+ one row of that range are next to each other in the sorted arrays, so each row is tested with one call to
+ the CollisionKernel and the circles whose bits are set in the mask are added to the hits.
+ */
+unsigned int CollisionCellsQuery(CollisionCells *cells, float x, float y, float radius) {
+
+	unsigned int hitCount = 0;
+
+	if (cells->count == 0) {
+		return 0;
+	}
+
+	if (!cells->sorted) {
+		CollisionCellsSort(cells);
+	}
+
+	float searchRadius = radius + cells->largestRadius;
+
+	int minimumColumn = CollisionCellsIndexForCoordinate(x - searchRadius, cells->cellSize, cells->columns);
+	int maximumColumn = CollisionCellsIndexForCoordinate(x + searchRadius, cells->cellSize, cells->columns);
+	int minimumRow = CollisionCellsIndexForCoordinate(y - searchRadius, cells->cellSize, cells->rows);
+	int maximumRow = CollisionCellsIndexForCoordinate(y + searchRadius, cells->cellSize, cells->rows);
+
+	for (int row = minimumRow; row <= maximumRow; row++) {
+
+		unsigned int start = cells->cellStarts[(row * cells->columns) + minimumColumn];
+		unsigned int end = cells->cellStarts[(row * cells->columns) + maximumColumn + 1];
+
+		if (end == start) {
+			continue;
+		}
+
+		unsigned int rowHits = CollisionKernelTestCircles(x, y, radius,
+														  &cells->sortedPositionX[start], &cells->sortedPositionY[start],
+														  &cells->sortedRadius[start], end - start, cells->hitMask);
+
+		/*
+		 Walk the set bits of the mask, lowest first, to keep the circles in order.
+		 */
+		for (unsigned int word = 0; rowHits > 0; word++) {
+
+			uint32_t bits = cells->hitMask[word];
+
+			while (bits) {
+
+				unsigned int bit = __builtin_ctz(bits);
+				cells->hits[hitCount] = cells->sortedIndices[start + (word * 32) + bit];
+				hitCount++;
+				bits &= bits - 1;
+				rowHits--;
+
+			}
+
+		}
+
+	}
+
+	return hitCount;
+
+}
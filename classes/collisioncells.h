@@ -0,0 +1,106 @@
+//
+//  CollisionCells.h
+//  AberFighter
+//
+//  Created by wde7 on 05/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The uniform grid of cells behind the CollisionGrid. Circles are added by position and radius and each is
+ identified by the order it was added in. Before the first query the circles are sorted by cell with a
+ counting sort, so that the circles in neighbouring cells of the same row are next to each other in memory
+ and can be tested in one batch by the CollisionKernel. A query fills hits with the indices of the circles
+ in collision with the probe.
+
+ Positions outside the grid are clamped onto the edge cells, so circles which are offscreen are still stored.
+
+ The cells are written in plain C with no dependency on UIKit or cocos2d, so that the broadphase can be
+ measured on the host.
+ */
+
+#ifndef __COLLISION_CELLS_H__
+#define __COLLISION_CELLS_H__
+
+#include <stdint.h>
+
+typedef struct {
+
+	/*
+	 The dimensions of the grid in cells and the size of each cell in points.
+	 */
+	int columns;
+	int rows;
+	float cellSize;
+
+	/*
+	 Number of circles added since the grid was last emptied, and the number which can be added before the
+	 arrays below need to grow.
+	 */
+	unsigned int count;
+	unsigned int capacity;
+
+	/*
+	 The circles in the order they were added and the index of the cell containing each.
+	 */
+	float *positionX;
+	float *positionY;
+	float *radius;
+	int *cellIndices;
+
+	/*
+	 The same data sorted by cell, with the index each circle was added at. The circles in cell i are found
+	 between cellStarts[i] and cellStarts[i + 1].
+	 */
+	unsigned int *sortedIndices;
+	float *sortedPositionX;
+	float *sortedPositionY;
+	float *sortedRadius;
+	unsigned int *cellStarts;
+
+	//Bitmask filled in by the CollisionKernel during a query.
+	uint32_t *hitMask;
+
+	//Indices of the circles found by the last query.
+	unsigned int *hits;
+
+	//Whether the sorted arrays are up to date with the circles which have been added.
+	int sorted;
+
+	/*
+	 The largest radius of the circles added since the grid was last emptied. Queries are expanded by this
+	 amount because a circle is only stored in the cell containing it's center.
+	 */
+	float largestRadius;
+
+} CollisionCells;
+
+/*
+ Creates a grid covering an area of the size specified, divided into square cells of the width specified.
+ Returns NULL if the memory could not be allocated.
+ */
+CollisionCells *CollisionCellsNew(float width, float height, float cellSize);
+
+/*
+ Frees the grid and all of it's arrays.
+ */
+void CollisionCellsFree(CollisionCells *cells);
+
+/*
+ Empties every cell. The arrays keep their size so that no memory is allocated when the circles are added
+ again during the next frame.
+ */
+void CollisionCellsRemoveAll(CollisionCells *cells);
+
+/*
+ Adds a circle to the cell which contains it's center. The circle's index is the number of circles added
+ before it. Returns 0 if the arrays needed to grow and the memory could not be allocated.
+ */
+int CollisionCellsAdd(CollisionCells *cells, float x, float y, float radius);
+
+/*
+ Finds the circles whose bounding circle intersects the probe's and fills hits with their indices, in the
+ order they were added within each cell. Returns the number found.
+ */
+unsigned int CollisionCellsQuery(CollisionCells *cells, float x, float y, float radius);
+
+#endif // __COLLISION_CELLS_H__
@@ -0,0 +1,87 @@
+//
+//  CollisionGrid.h
+//  AberFighter
+//
+//  Created by wde7 on 14/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The CollisionGrid is a uniform grid broadphase used to reduce the number of comparisons made during
+ collision detection. The layer is divided into square cells. Each frame the ActionLayer empties the grid
+ and adds every Projectile to it. When a ship needs to be checked for collisions it asks the grid for the
+ sprites it is in collision with, and only the sprites in the cells overlapped by it's bounding circle are
+ tested. This turns the O(ships x projectiles) comparison in nextFrame into roughly O(ships + projectiles)
+ when the sprites are spread across the screen.
+
+ The position and radius of each sprite are copied into the grid when it is added. The cells themselves, and
+ the sorting and batched testing of the copies, are the plain C CollisionCells, which the broadphase benchmark
+ in tests measures on the host.
+ */
+
+#import <Foundation/Foundation.h>
+#import "CollidableSprite.h"
+#import "CollisionCells.h"
+
+/*
+ The default width and height of each cell in points. This is roughly the size of the largest TargetShip
+ so that a ship's bounding circle usually overlaps at most four cells. If the cell size is larger than the
+ size of the grid then every sprite is placed in the same cell and the grid behaves like the original
+ brute force comparison, which is useful when profiling.
+ */
+#define kCollisionGridCellSize 64.0f
+
+@interface CollisionGrid : NSObject {
+
+	/*
+	 The cells the positions and radii of the sprites are copied into, and which are queried.
+	 */
+	CollisionCells *cells;
+
+	/*
+	 The sprites in the order they were added, so that the indices found by a query can be turned back into
+	 sprites, and the number there is room for. The sprites are not retained, the layer's arrays are
+	 responsible for keeping them alive.
+	 */
+	CollidableSprite **sprites;
+	unsigned int spriteCapacity;
+
+	/*
+	 Array which is filled with the results of a query. It is reused between queries to avoid creating
+	 an autoreleased array for every ship every frame.
+	 */
+	NSMutableArray *hits;
+
+}
+
+/*
+ The dimensions of the cells, read from the CollisionCells. These don't change once the grid has been initialised.
+ */
+@property (nonatomic,readonly) int columns;
+@property (nonatomic,readonly) int rows;
+@property (nonatomic,readonly) float cellSize;
+
+/*
+ Initializer method. Creates a grid covering an area of the specified size, divided into square cells of
+ the specified width.
+ */
+- (id)initWithSize:(CGSize)size cellSize:(float)newCellSize;
+
+/*
+ Empties every cell in the grid. Should be called at the start of each frame before the sprites are added.
+ */
+- (void)removeAllCollidableSprites;
+
+/*
+ Adds a sprite to the cell which contains it's current position. The position is copied, so the sprite
+ should not move until the grid is emptied again.
+ */
+- (void)addCollidableSprite:(CollidableSprite *)sprite;
+
+/*
+ Returns the sprites in the grid whose bounding circle intersects the bounding circle of the sprite passed in,
+ in the order they were added within each cell. The array returned is owned by the grid and is only valid
+ until the next query.
+ */
+- (NSArray *)collidableSpritesInCollisionWithCollidableSprite:(CollidableSprite *)sprite;
+
+@end
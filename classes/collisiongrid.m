@@ -0,0 +1,121 @@
+//
+//  CollisionGrid.m
+//  AberFighter
+//
+//  Created by wde7 on 14/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "CollisionGrid.h"
+
+@implementation CollisionGrid
+
+- (int)columns {
+
+	return cells->columns;
+
+}
+
+- (int)rows {
+
+	return cells->rows;
+
+}
+
+- (float)cellSize {
+
+	return cells->cellSize;
+
+}
+
+/*
+ Initializer method. Creates the cells covering the area specified and the array of sprites, which starts with
+ room for as many sprites as the cells do.
+ */
+- (id)initWithSize:(CGSize)size cellSize:(float)newCellSize {
+
+	if ((self = [super init])) {
+
+		cells = CollisionCellsNew(size.width, size.height, newCellSize);
+		NSAssert(cells != NULL, @"CollisionGrid: not enough memory");
+
+		spriteCapacity = cells->capacity;
+		sprites = (CollidableSprite **)malloc(sizeof(CollidableSprite *) * spriteCapacity);
+		NSAssert(sprites != NULL, @"CollisionGrid: not enough memory");
+
+		hits = [[NSMutableArray alloc] initWithCapacity:8];
+
+	}
+
+	return self;
+
+}
+
+/*
+ Empties the grid. The arrays keep their size so that no memory is allocated when the sprites are
+ added again during the next frame.
+ */
+- (void)removeAllCollidableSprites {
+
+	CollisionCellsRemoveAll(cells);
+
+}
+
+/*
+ Copies the sprite's position and the radius of it's bounding circle into the cells, and remembers the sprite
+ by the index the cells give it.
+ */
+- (void)addCollidableSprite:(CollidableSprite *)sprite {
+
+	if (cells->count == spriteCapacity) {
+
+		spriteCapacity *= 2;
+		sprites = (CollidableSprite **)realloc(sprites, sizeof(CollidableSprite *) * spriteCapacity);
+		NSAssert(sprites != NULL, @"CollisionGrid: not enough memory");
+
+	}
+
+	sprites[cells->count] = sprite;
+
+	CGPoint position = sprite.position;
+
+	if (!CollisionCellsAdd(cells, position.x, position.y, sprite.contentSize.width / 2)) {
+		NSAssert(NO, @"CollisionGrid: not enough memory");
+	}
+
+}
+
+/*
+ Queries the cells with the sprite's bounding circle and turns the indices found back into sprites.
+ */
+- (NSArray *)collidableSpritesInCollisionWithCollidableSprite:(CollidableSprite *)sprite {
+
+	[hits removeAllObjects];
+
+	CGPoint position = sprite.position;
+	unsigned int hitCount = CollisionCellsQuery(cells, position.x, position.y, sprite.contentSize.width / 2);
+
+	for (unsigned int i = 0; i < hitCount; i++) {
+		[hits addObject:sprites[cells->hits[i]]];
+	}
+
+	return hits;
+
+}
+
+/*
+ Frees the cells and the array of sprites and releases the hits array.
+ */
+- (void)dealloc {
+
+	CollisionCellsFree(cells);
+	free(sprites);
+
+	[hits release];
+	hits = nil;
+
+	[super dealloc];
+
+}
+
+@end
@@ -0,0 +1,121 @@
+//
+//  CollisionKernel.c
+//  AberFighter
+//
+//  Created by wde7 on 21/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include "CollisionKernel.h"
+
+#if kCollisionKernelUseSIMD && defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define COLLISION_KERNEL_NEON 1
+#elif kCollisionKernelUseSIMD && defined(__SSE__)
+#include <xmmintrin.h>
+#define COLLISION_KERNEL_SSE 1
+#endif
+
+/*
+ Tests a single candidate. This is the same comparison as CollidableSprite's checkCollisionWithCollidableSprite
+ method, but with both sides squared: the sprites are in collision if the distance between their centers is less
+ than the sum of their radii.
+ */
+static inline uint32_t CollisionKernelTestCircle(float probeX, float probeY, float probeRadius, float x, float y, float radius) {
+
+	float xDistance = x - probeX;
+	float yDistance = y - probeY;
+	float minimumIntersectionDistance = radius + probeRadius;
+
+	return ((xDistance * xDistance) + (yDistance * yDistance)) < (minimumIntersectionDistance * minimumIntersectionDistance);
+
+}
+
+unsigned int CollisionKernelTestCircles(float probeX, float probeY, float probeRadius,
+										const float *x, const float *y, const float *radius,
+										unsigned int count, uint32_t *hitMask) {
+
+	unsigned int i = 0;
+	unsigned int hitCount = 0;
+
+	memset(hitMask, 0, sizeof(uint32_t) * CollisionKernelMaskWordCount(count));
+
+#if COLLISION_KERNEL_NEON
+
+	/*
+	 Four candidates are tested per iteration. The comparison produces all ones in each lane which is in
+	 collision. ANDing with {1, 2, 4, 8} and adding the lanes together turns this into a 4 bit mask.
+	 */
+	float32x4_t probeXVector = vdupq_n_f32(probeX);
+	float32x4_t probeYVector = vdupq_n_f32(probeY);
+	float32x4_t probeRadiusVector = vdupq_n_f32(probeRadius);
+	static const uint32_t laneBitValues[4] = {1, 2, 4, 8};
+	uint32x4_t laneBits = vld1q_u32(laneBitValues);
+
+	for (; i + 4 <= count; i += 4) {
+
+		float32x4_t xDistance = vsubq_f32(vld1q_f32(&x[i]), probeXVector);
+		float32x4_t yDistance = vsubq_f32(vld1q_f32(&y[i]), probeYVector);
+		float32x4_t minimumIntersectionDistance = vaddq_f32(vld1q_f32(&radius[i]), probeRadiusVector);
+
+		float32x4_t distanceSquared = vmlaq_f32(vmulq_f32(xDistance, xDistance), yDistance, yDistance);
+		float32x4_t minimumSquared = vmulq_f32(minimumIntersectionDistance, minimumIntersectionDistance);
+
+		uint32x4_t lanes = vandq_u32(vcltq_f32(distanceSquared, minimumSquared), laneBits);
+		uint32x2_t pairs = vadd_u32(vget_low_u32(lanes), vget_high_u32(lanes));
+		uint32_t bits = vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+
+		if (bits) {
+			hitMask[i / 32] |= bits << (i % 32);
+			hitCount += __builtin_popcount(bits);
+		}
+
+	}
+
+#elif COLLISION_KERNEL_SSE
+
+	/*
+	 Four candidates are tested per iteration. movemask collects the sign bit of each lane of the
+	 comparison result into a 4 bit mask.
+	 */
+	__m128 probeXVector = _mm_set1_ps(probeX);
+	__m128 probeYVector = _mm_set1_ps(probeY);
+	__m128 probeRadiusVector = _mm_set1_ps(probeRadius);
+
+	for (; i + 4 <= count; i += 4) {
+
+		__m128 xDistance = _mm_sub_ps(_mm_loadu_ps(&x[i]), probeXVector);
+		__m128 yDistance = _mm_sub_ps(_mm_loadu_ps(&y[i]), probeYVector);
+		__m128 minimumIntersectionDistance = _mm_add_ps(_mm_loadu_ps(&radius[i]), probeRadiusVector);
+
+		__m128 distanceSquared = _mm_add_ps(_mm_mul_ps(xDistance, xDistance), _mm_mul_ps(yDistance, yDistance));
+		__m128 minimumSquared = _mm_mul_ps(minimumIntersectionDistance, minimumIntersectionDistance);
+
+		uint32_t bits = (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(distanceSquared, minimumSquared));
+
+		if (bits) {
+			hitMask[i / 32] |= bits << (i % 32);
+			hitCount += __builtin_popcount(bits);
+		}
+
+	}
+
+#endif
+
+	/*
+	 Scalar version. Handles every candidate when no vector unit is available, otherwise only the
+	 candidates left over after the last group of four.
+	 */
+	for (; i < count; i++) {
+
+		if (CollisionKernelTestCircle(probeX, probeY, probeRadius, x[i], y[i], radius[i])) {
+			hitMask[i / 32] |= (uint32_t)1 << (i % 32);
+			hitCount++;
+		}
+
+	}
+
+	return hitCount;
+
+}
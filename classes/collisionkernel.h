@@ -0,0 +1,45 @@
+//
+//  CollisionKernel.h
+//  AberFighter
+//
+//  Created by wde7 on 21/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Batch version of the bounding circle collision test in CollidableSprite. One probe circle is tested
+ against a list of candidate circles stored as separate arrays of x positions, y positions and radii.
+ The result is a bitmask with one bit set for each candidate in collision with the probe.
+
+ Squared distances are compared so no square roots are calculated. On the device (ARMv7) the test is
+ performed on four candidates at a time using NEON instructions and in the simulator (x86) using SSE.
+ Other architectures, and any candidates left over at the end of the arrays, use the scalar version.
+
+ Like the EntityStore this file is plain C with no dependency on UIKit or cocos2d.
+ */
+
+#ifndef __COLLISION_KERNEL_H__
+#define __COLLISION_KERNEL_H__
+
+#include <stdint.h>
+
+/*
+ Set to 0 to always use the scalar version of the test. Useful for comparing the vector versions
+ against the scalar one with the profiler.
+ */
+#define kCollisionKernelUseSIMD 1
+
+/*
+ Number of 32 bit words needed for the bitmask of the number of candidates specified.
+ */
+#define CollisionKernelMaskWordCount(__COUNT__) (((__COUNT__) + 31) / 32)
+
+/*
+ Tests the probe circle against count candidate circles. Bit (i % 32) of hitMask[i / 32] is set if the
+ probe is in collision with candidate i, otherwise it is cleared. hitMask must have room for at least
+ CollisionKernelMaskWordCount(count) words. Returns the number of candidates in collision.
+ */
+unsigned int CollisionKernelTestCircles(float probeX, float probeY, float probeRadius,
+										const float *x, const float *y, const float *radius,
+										unsigned int count, uint32_t *hitMask);
+
+#endif // __COLLISION_KERNEL_H__
@@ -0,0 +1,307 @@
+//
+//  DirectionalStream.c
+//  AberFighter
+//
+//  Created by wde7 on 08/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include "DirectionalStream.h"
+
+/*
+ Bits of the field mask.
+ */
+#define kDirectionalFieldHeading	0x01
+#define kDirectionalFieldSpeed		0x02
+#define kDirectionalFieldPositionX	0x04
+#define kDirectionalFieldPositionY	0x08
+#define kDirectionalFieldRotation	0x10
+
+#define kDirectionalStreamOffsetBits 3
+#define kDirectionalStreamOffsetMask ((1 << kDirectionalStreamOffsetBits) - 1)
+
+/*
+ An offset of this in the field mask byte means the offset is in the byte after it.
+ */
+#define kDirectionalStreamExtendedOffset kDirectionalStreamOffsetMask
+
+void DirectionalStreamSenderInit(DirectionalStreamSender *sender) {
+
+	memset(sender, 0, sizeof(DirectionalStreamSender));
+
+}
+
+void DirectionalStreamReceiverInit(DirectionalStreamReceiver *receiver) {
+
+	memset(receiver, 0, sizeof(DirectionalStreamReceiver));
+
+}
+
+/*
+ Returns a mask of the fields which differ between two states.
+ */
+static uint8_t DirectionalStreamChangedFields(const DirectionalState *baseline, const DirectionalState *state) {
+
+	uint8_t fields = 0;
+
+	if (state->heading != baseline->heading) {
+		fields |= kDirectionalFieldHeading;
+	}
+
+	if (state->speed != baseline->speed) {
+		fields |= kDirectionalFieldSpeed;
+	}
+
+	if (state->positionX != baseline->positionX) {
+		fields |= kDirectionalFieldPositionX;
+	}
+
+	if (state->positionY != baseline->positionY) {
+		fields |= kDirectionalFieldPositionY;
+	}
+
+	if (state->rotation != baseline->rotation) {
+		fields |= kDirectionalFieldRotation;
+	}
+
+	return fields;
+
+}
+
+int DirectionalStreamSenderWrite(DirectionalStreamSender *sender, WireWriter *writer, const PlayerShipDirectionalInformation *information) {
+
+	DirectionalState state;
+	DirectionalState keyframeBaseline;
+	const DirectionalState *baseline = &keyframeBaseline;
+	uint8_t sequence = sender->nextSequence;
+	uint8_t offset = 0;
+
+	state.heading = WireQuantizeHeading(information->newHeading);
+	state.speed = WireQuantizeSpeed(information->newSpeed);
+	state.positionX = WireQuantizePosition(information->currentPositionX);
+	state.positionY = WireQuantizePosition(information->currentPositionY);
+	state.rotation = WireQuantizeHeading(information->currentRotation);
+
+	memset(&keyframeBaseline, 0, sizeof(DirectionalState));
+
+	/*
+	 An acknowledgement which has fallen out of the history can't be used as a baseline, and it's sequence
+	 number could be mistaken for a newer one once the sequence numbers wrap around.
+	 */
+	if (sender->hasAcknowledged && (uint8_t)(sequence - sender->acknowledgedSequence) > kDirectionalStreamHistorySize) {
+		sender->hasAcknowledged = 0;
+	}
+
+	int sameAsLatestSent = sender->hasSent && DirectionalStreamChangedFields(&sender->latestSentState, &state) == 0;
+
+	if (sender->hasAcknowledged) {
+
+		/*
+		 Nothing needs to be sent if the acknowledged message is one of the run of latest messages, which all
+		 have this state, as whichever of them the peer has is the same.
+		 */
+		if (sameAsLatestSent && (uint8_t)(sequence - sender->acknowledgedSequence) <= sender->latestSentRun) {
+			return 0;
+		}
+
+		/*
+		 The acknowledged state can only be used as the baseline if the peer still has it in it's history,
+		 which is overwritten once kDirectionalStreamHistorySize newer messages have been sent.
+		 */
+		uint8_t age = (uint8_t)(sequence - sender->acknowledgedSequence);
+
+		if (age < kDirectionalStreamHistorySize) {
+
+			baseline = &sender->acknowledgedState;
+			offset = age;
+
+		}
+
+	}
+
+	uint8_t fields = DirectionalStreamChangedFields(baseline, &state);
+
+	WireWriteUInt8(writer, sequence);
+
+	if (offset < kDirectionalStreamExtendedOffset) {
+
+		WireWriteUInt8(writer, (uint8_t)((fields << kDirectionalStreamOffsetBits) | offset));
+
+	} else {
+
+		WireWriteUInt8(writer, (uint8_t)((fields << kDirectionalStreamOffsetBits) | kDirectionalStreamExtendedOffset));
+		WireWriteUInt8(writer, offset);
+
+	}
+
+	WireWriteUInt16(writer, information->sendTime);
+
+	if (fields & kDirectionalFieldHeading) {
+		WireWriteUInt8(writer, state.heading);
+	}
+
+	if (fields & kDirectionalFieldSpeed) {
+		WireWriteUInt8(writer, state.speed);
+	}
+
+	if (fields & kDirectionalFieldPositionX) {
+		WireWriteVarInt(writer, (int32_t)state.positionX - baseline->positionX);
+	}
+
+	if (fields & kDirectionalFieldPositionY) {
+		WireWriteVarInt(writer, (int32_t)state.positionY - baseline->positionY);
+	}
+
+	if (fields & kDirectionalFieldRotation) {
+		WireWriteUInt8(writer, state.rotation);
+	}
+
+	sender->sent[sequence % kDirectionalStreamHistorySize] = state;
+	sender->nextSequence++;
+
+	if (sameAsLatestSent) {
+
+		if (sender->latestSentRun < kDirectionalStreamHistorySize) {
+			sender->latestSentRun++;
+		}
+
+	} else {
+
+		sender->hasSent = 1;
+		sender->latestSentState = state;
+		sender->latestSentRun = 1;
+
+	}
+
+	return 1;
+
+}
+
+void DirectionalStreamSenderAcknowledge(DirectionalStreamSender *sender, uint8_t sequence) {
+
+	/*
+	 The message must have been sent within the history, and be newer than the current baseline.
+	 */
+	uint8_t age = (uint8_t)(sender->nextSequence - sequence);
+
+	if (age == 0 || age > kDirectionalStreamHistorySize) {
+		return;
+	}
+
+	if (sender->hasAcknowledged && (int8_t)(sequence - sender->acknowledgedSequence) <= 0) {
+		return;
+	}
+
+	sender->hasAcknowledged = 1;
+	sender->acknowledgedSequence = sequence;
+	sender->acknowledgedState = sender->sent[sequence % kDirectionalStreamHistorySize];
+
+}
+
+int DirectionalStreamReceiverRead(DirectionalStreamReceiver *receiver, WireReader *reader, PlayerShipDirectionalInformation *information, uint8_t *sequence) {
+
+	DirectionalState state;
+	uint8_t messageSequence = WireReadUInt8(reader);
+	uint8_t fieldsAndOffset = WireReadUInt8(reader);
+	uint8_t fields = fieldsAndOffset >> kDirectionalStreamOffsetBits;
+	uint8_t offset = fieldsAndOffset & kDirectionalStreamOffsetMask;
+
+	if (offset == kDirectionalStreamExtendedOffset) {
+
+		offset = WireReadUInt8(reader);
+
+		//Shorter offsets are never extended, and longer ones than the history are never sent.
+		if (offset < kDirectionalStreamExtendedOffset || offset >= kDirectionalStreamHistorySize) {
+			return 0;
+		}
+
+	}
+
+	uint16_t sendTime = WireReadUInt16(reader);
+
+	if (reader->error) {
+		return 0;
+	}
+
+	if (receiver->hasLatest && (int8_t)(messageSequence - receiver->latestSequence) <= 0) {
+		return 0;
+	}
+
+	if (offset == 0) {
+
+		memset(&state, 0, sizeof(DirectionalState));
+
+	} else {
+
+		uint8_t baselineSequence = (uint8_t)(messageSequence - offset);
+		unsigned int slot = baselineSequence % kDirectionalStreamHistorySize;
+
+		if (!receiver->receivedValid[slot] || receiver->receivedSequence[slot] != baselineSequence) {
+			return 0;
+		}
+
+		state = receiver->received[slot];
+
+	}
+
+	if (fields & kDirectionalFieldHeading) {
+		state.heading = WireReadUInt8(reader);
+	}
+
+	if (fields & kDirectionalFieldSpeed) {
+		state.speed = WireReadUInt8(reader);
+	}
+
+	if (fields & kDirectionalFieldPositionX) {
+		state.positionX = (int16_t)(state.positionX + WireReadVarInt(reader));
+	}
+
+	if (fields & kDirectionalFieldPositionY) {
+		state.positionY = (int16_t)(state.positionY + WireReadVarInt(reader));
+	}
+
+	if (fields & kDirectionalFieldRotation) {
+		state.rotation = WireReadUInt8(reader);
+	}
+
+	if (reader->error) {
+		return 0;
+	}
+
+	unsigned int slot = messageSequence % kDirectionalStreamHistorySize;
+
+	receiver->received[slot] = state;
+	receiver->receivedSequence[slot] = messageSequence;
+	receiver->receivedValid[slot] = 1;
+	receiver->hasLatest = 1;
+	receiver->latestSequence = messageSequence;
+	receiver->unacknowledgedCount++;
+	receiver->latestWasKeyframe = (offset == 0);
+
+	information->newHeading = WireDequantizeHeading(state.heading);
+	information->newSpeed = WireDequantizeSpeed(state.speed);
+	information->currentPositionX = WireDequantizePosition(state.positionX);
+	information->currentPositionY = WireDequantizePosition(state.positionY);
+	information->currentRotation = WireDequantizeHeading(state.rotation);
+	information->sendTime = sendTime;
+
+	*sequence = messageSequence;
+
+	return 1;
+
+}
+
+int DirectionalStreamReceiverAcknowledgementDue(DirectionalStreamReceiver *receiver) {
+
+	//A keyframe is acknowledged straight away so that the sender can stop sending them.
+	if (!receiver->latestWasKeyframe && receiver->unacknowledgedCount < kDirectionalStreamAcknowledgementInterval) {
+		return 0;
+	}
+
+	receiver->unacknowledgedCount = 0;
+	receiver->latestWasKeyframe = 0;
+
+	return 1;
+
+}
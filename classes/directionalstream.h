@@ -0,0 +1,139 @@
+//
+//  DirectionalStream.h
+//  AberFighter
+//
+//  Created by wde7 on 08/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The DirectionalStream encodes the directional data of the local PlayerShip as changes from a baseline which
+ the peer is known to have received, rather than sending every field every time.
+
+ Each directional message has an 8 bit sequence number. The receiver acknowledges every
+ kDirectionalStreamAcknowledgementInterval'th message it decodes, and every keyframe, and the sender
+ remembers the state it sent in each of the last kDirectionalStreamHistorySize messages. A new message only
+ contains the fields which differ from the latest acknowledged state, which is identified by how many
+ messages before the new one it was sent. Positions are written as the difference from the baseline, which
+ is usually small enough to fit in a single byte.
+
+ If nothing has changed since the acknowledged state, and nothing different has been sent since, then there
+ is nothing to send, so a ship which isn't moving costs nothing. If no message has been acknowledged
+ recently enough to still be in the history, because messages or acknowledgements have been lost, a
+ keyframe containing every field is sent instead.
+
+ Message format:
+   sequence       1 byte
+   fields/offset  1 byte, the field mask in the top 5 bits and the baseline offset in the bottom 3 bits.
+                  An offset of 0 means a keyframe, whose baseline is a state of all zeros, and an offset of
+                  7 means the offset is in the next byte.
+   offset         1 byte, only present for offsets of 7 or more.
+   send time      2 bytes, the sender's clock when the data was sampled, as written by the WireProtocol. It
+                  is in every message, as it always changes, but isn't compared to decide whether to send.
+   fields         heading byte, speed byte, x and y as variable length integer differences, rotation byte,
+                  only those set in the mask and in that order.
+
+ The stream is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __DIRECTIONAL_STREAM_H__
+#define __DIRECTIONAL_STREAM_H__
+
+#include <stdint.h>
+#include "WireProtocol.h"
+
+/*
+ Number of sent states remembered, so a baseline can be at most one less than this many messages older than
+ the message which uses it. It must cover the round trip and the acknowledgement interval at the highest
+ send rate: at 30 messages a second a 100 ms link takes 6 messages to acknowledge one, and more when
+ acknowledgements are lost. Baselines up to 6 messages old cost nothing extra to refer to, and older ones
+ a byte, which is still much less than a keyframe.
+ */
+#define kDirectionalStreamHistorySize 32
+
+/*
+ The receiver acknowledges one in this many of the messages it decodes. An acknowledgement costs about as
+ much as a message which has changed little, so acknowledging every message costs more than the changes
+ save. The baseline is older by up to this many messages less one, so acknowledging less often makes the
+ changes larger. In the DirectionalStreamBenchmark one in three saved the most at 20% loss, and one in six
+ cost more than it saved on a 100 ms link.
+ */
+#define kDirectionalStreamAcknowledgementInterval 3
+
+/*
+ Directional data as it is quantized by the WireProtocol. Two states are only different if they
+ would be written differently.
+ */
+typedef struct {
+
+	uint8_t heading;
+	uint8_t speed;
+	int16_t positionX;
+	int16_t positionY;
+	uint8_t rotation;
+
+} DirectionalState;
+
+typedef struct {
+
+	//States sent, indexed by sequence number modulo kDirectionalStreamHistorySize.
+	DirectionalState sent[kDirectionalStreamHistorySize];
+	uint8_t nextSequence;
+
+	//The latest state acknowledged by the peer.
+	int hasAcknowledged;
+	uint8_t acknowledgedSequence;
+	DirectionalState acknowledgedState;
+
+	//The state of the newest message sent, and how many messages in a row have been sent with that state.
+	int hasSent;
+	DirectionalState latestSentState;
+	unsigned int latestSentRun;
+
+} DirectionalStreamSender;
+
+typedef struct {
+
+	//States received, indexed by sequence number modulo kDirectionalStreamHistorySize.
+	DirectionalState received[kDirectionalStreamHistorySize];
+	uint8_t receivedSequence[kDirectionalStreamHistorySize];
+	uint8_t receivedValid[kDirectionalStreamHistorySize];
+
+	//Sequence number of the newest message decoded.
+	int hasLatest;
+	uint8_t latestSequence;
+
+	//Messages decoded since the last one which was acknowledged, and whether the newest was a keyframe.
+	unsigned int unacknowledgedCount;
+	int latestWasKeyframe;
+
+} DirectionalStreamReceiver;
+
+void DirectionalStreamSenderInit(DirectionalStreamSender *sender);
+void DirectionalStreamReceiverInit(DirectionalStreamReceiver *receiver);
+
+/*
+ Writes a message for the directional data specified. Returns 0 and writes nothing if the peer is known to
+ already have the data: every message since one the peer has acknowledged was sent with the same state.
+ Checking against the acknowledged state alone isn't enough, as a message sent after it with a different
+ state may still arrive and be applied.
+ */
+int DirectionalStreamSenderWrite(DirectionalStreamSender *sender, WireWriter *writer, const PlayerShipDirectionalInformation *information);
+
+/*
+ Records that the peer has received the message with the sequence number specified. Acknowledgements for
+ messages older than the current baseline, or no longer in the history, are ignored.
+ */
+void DirectionalStreamSenderAcknowledge(DirectionalStreamSender *sender, uint8_t sequence);
+
+/*
+ Reads a message. Returns 1 and sets it's sequence number if the message was newer than any received so
+ far and could be decoded. Returns 0 if it arrived out of order, was corrupt or it's baseline is unknown.
+ */
+int DirectionalStreamReceiverRead(DirectionalStreamReceiver *receiver, WireReader *reader, PlayerShipDirectionalInformation *information, uint8_t *sequence);
+
+/*
+ Returns 1 if the message just decoded should be acknowledged, and counts it as acknowledged.
+ */
+int DirectionalStreamReceiverAcknowledgementDue(DirectionalStreamReceiver *receiver);
+
+#endif // __DIRECTIONAL_STREAM_H__
@@ -0,0 +1,260 @@
+//
+//  EntityStore.c
+//  AberFighter
+//
+//  Created by wde7 on 18/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <stdlib.h>
+#include "EntityStore.h"
+#include "TrigTable.h"
+
+/*
+ Reallocates a single array of the store. On failure the original array is left untouched and 0 is returned.
+ */
+static int EntityStoreResizeArray(void **array, size_t elementSize, unsigned int capacity) {
+
+	void *resized = realloc(*array, elementSize * capacity);
+
+	if (resized == NULL) {
+		return 0;
+	}
+
+	*array = resized;
+	return 1;
+
+}
+
+/*
+ Changes the capacity of every array in the store. Returns 0 if any of the arrays could not be resized.
+ */
+static int EntityStoreSetCapacity(EntityStore *store, unsigned int capacity) {
+
+	if (!EntityStoreResizeArray((void **)&store->positionX, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->positionY, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->heading, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->directionX, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->directionY, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->speed, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->radius, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->shield, sizeof(int), capacity) ||
+		!EntityStoreResizeArray((void **)&store->owner, sizeof(int), capacity) ||
+		!EntityStoreResizeArray((void **)&store->type, sizeof(int), capacity) ||
+		!EntityStoreResizeArray((void **)&store->age, sizeof(float), capacity) ||
+		!EntityStoreResizeArray((void **)&store->views, sizeof(void *), capacity)) {
+		return 0;
+	}
+
+	store->capacity = capacity;
+	return 1;
+
+}
+
+EntityStore *EntityStoreNew(unsigned int capacity) {
+
+	EntityStore *store = (EntityStore *)calloc(1, sizeof(EntityStore));
+
+	if (store == NULL) {
+		return NULL;
+	}
+
+	if (capacity == 0) {
+		capacity = 1;
+	}
+
+	if (!EntityStoreSetCapacity(store, capacity)) {
+		EntityStoreFree(store);
+		return NULL;
+	}
+
+	return store;
+
+}
+
+void EntityStoreFree(EntityStore *store) {
+
+	if (store == NULL) {
+		return;
+	}
+
+	free(store->positionX);
+	free(store->positionY);
+	free(store->heading);
+	free(store->directionX);
+	free(store->directionY);
+	free(store->speed);
+	free(store->radius);
+	free(store->shield);
+	free(store->owner);
+	free(store->type);
+	free(store->age);
+	free(store->views);
+	free(store);
+
+}
+
+int EntityStoreAdd(EntityStore *store, float x, float y, float heading, float speed, float radius, int shield, int owner, int type, void *view) {
+
+	/*
+	 The capacity is doubled when the store is full so that adding entities is amortised O(1).
+	 */
+	if (store->count == store->capacity) {
+
+		if (!EntityStoreSetCapacity(store, store->capacity * 2)) {
+			return kEntityIndexNone;
+		}
+
+	}
+
+	unsigned int index = store->count;
+
+	store->positionX[index] = x;
+	store->positionY[index] = y;
+	store->speed[index] = speed;
+	store->radius[index] = radius;
+	store->shield[index] = shield;
+	store->owner[index] = owner;
+	store->type[index] = type;
+	store->age[index] = 0.0f;
+	store->views[index] = view;
+	EntityStoreSetHeading(store, index, heading);
+
+	store->count++;
+
+	return (int)index;
+
+}
+
+void *EntityStoreRemove(EntityStore *store, unsigned int index) {
+
+	if (index >= store->count) {
+		return NULL;
+	}
+
+	unsigned int last = store->count - 1;
+	store->count--;
+
+	if (index == last) {
+		return NULL;
+	}
+
+	/*
+	 Move the last entity into the empty slot so that the arrays remain contiguous.
+	 */
+	store->positionX[index] = store->positionX[last];
+	store->positionY[index] = store->positionY[last];
+	store->heading[index] = store->heading[last];
+	store->directionX[index] = store->directionX[last];
+	store->directionY[index] = store->directionY[last];
+	store->speed[index] = store->speed[last];
+	store->radius[index] = store->radius[last];
+	store->shield[index] = store->shield[last];
+	store->owner[index] = store->owner[last];
+	store->type[index] = store->type[last];
+	store->age[index] = store->age[last];
+	store->views[index] = store->views[last];
+
+	return store->views[index];
+
+}
+
+void EntityStoreRemoveAll(EntityStore *store) {
+
+	store->count = 0;
+
+}
+
+int EntityStoreReserve(EntityStore *store, unsigned int capacity) {
+
+	if (capacity <= store->capacity) {
+		return 1;
+	}
+
+	return EntityStoreSetCapacity(store, capacity);
+
+}
+
+void EntityStoreSetHeading(EntityStore *store, unsigned int index, float heading) {
+
+	store->heading[index] = heading;
+	store->directionX[index] = TrigTableSine(heading);
+	store->directionY[index] = TrigTableCosine(heading);
+
+}
+
+void EntityStoreIntegrate(EntityStore *store, float timeSinceLastUpdate) {
+
+	/*
+	 Local copies of the array pointers let the compiler keep them in registers and vectorize the loop.
+	 */
+	float *positionX = store->positionX;
+	float *positionY = store->positionY;
+	const float *directionX = store->directionX;
+	const float *directionY = store->directionY;
+	const float *speed = store->speed;
+	float *age = store->age;
+	unsigned int count = store->count;
+
+	for (unsigned int i = 0; i < count; i++) {
+
+		float distance = speed[i] * timeSinceLastUpdate;
+		positionX[i] += directionX[i] * distance;
+		positionY[i] += directionY[i] * distance;
+		age[i] += timeSinceLastUpdate;
+
+	}
+
+}
+
+void EntityStoreConfine(EntityStore *store, float minimumX, float minimumY, float maximumX, float maximumY) {
+
+	float *positionX = store->positionX;
+	float *positionY = store->positionY;
+	const float *radius = store->radius;
+	unsigned int count = store->count;
+
+	for (unsigned int i = 0; i < count; i++) {
+
+		if (positionX[i] > maximumX - radius[i]) {
+			positionX[i] = maximumX - radius[i];
+		} else if (positionX[i] < minimumX + radius[i]) {
+			positionX[i] = minimumX + radius[i];
+		}
+
+		if (positionY[i] > maximumY - radius[i]) {
+			positionY[i] = maximumY - radius[i];
+		} else if (positionY[i] < minimumY + radius[i]) {
+			positionY[i] = minimumY + radius[i];
+		}
+
+	}
+
+}
+
+unsigned int EntityStoreFindCollisions(const EntityStore *store, float x, float y, float radius, unsigned int *hits, unsigned int maximumHits) {
+
+	const float *positionX = store->positionX;
+	const float *positionY = store->positionY;
+	const float *radii = store->radius;
+	unsigned int count = store->count;
+	unsigned int hitCount = 0;
+
+	for (unsigned int i = 0; i < count && hitCount < maximumHits; i++) {
+
+		float xDistance = positionX[i] - x;
+		float yDistance = positionY[i] - y;
+		float minimumIntersectionDistance = radii[i] + radius;
+
+		if ((xDistance * xDistance) + (yDistance * yDistance) < (minimumIntersectionDistance * minimumIntersectionDistance)) {
+
+			hits[hitCount] = i;
+			hitCount++;
+
+		}
+
+	}
+
+	return hitCount;
+
+}
@@ -0,0 +1,126 @@
+//
+//  EntityStore.h
+//  AberFighter
+//
+//  Created by wde7 on 18/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The EntityStore keeps the movement and collision data of a group of entities in contiguous arrays
+ (a structure of arrays) rather than inside each sprite. Moving every entity and testing a bounding
+ circle against every entity then become tight loops over plain floats instead of an Objective-C
+ message send per property per entity, which is much kinder to the cache on the device.
+
+ The store is written in plain C with no dependency on UIKit or cocos2d so that it can be built and
+ exercised on any platform. The sprites which draw the entities are attached to each entry as an opaque
+ view pointer and are updated from the store once per frame by the owning layer.
+
+ Entities are removed by moving the last entity into the empty slot, so indices are not stable across
+ removals. EntityStoreRemove returns the view which was moved so that the caller can update it's index.
+ */
+
+#ifndef __ENTITY_STORE_H__
+#define __ENTITY_STORE_H__
+
+/*
+ Sentinel used by sprites which have not been added to an EntityStore.
+ */
+#define kEntityIndexNone -1
+
+typedef struct EntityStore {
+
+	//Number of entities currently in the store.
+	unsigned int count;
+	//Number of entities which can be stored before the arrays need to grow.
+	unsigned int capacity;
+
+	/*
+	 Position of the center of each entity.
+	 */
+	float *positionX;
+	float *positionY;
+	/*
+	 Heading of each entity in degrees, using the same convention as Ship (0 is up the screen, clockwise).
+	 directionX and directionY cache the sine and cosine of the heading so that integration doesn't need
+	 to call any trigonometric functions. They are updated whenever the heading is set.
+	 */
+	float *heading;
+	float *directionX;
+	float *directionY;
+	//Distance travelled by each entity per second.
+	float *speed;
+	//Radius of each entity's bounding circle.
+	float *radius;
+	//Remaining shield strength of each entity.
+	int *shield;
+	//ID of the player which owns the entity, or 0 if it isn't owned by a player.
+	int *owner;
+	//Kind of entity, e.g. the TargetType of a target. The meaning is up to the owner of the store.
+	int *type;
+	//Time in seconds since the entity was added. Incremented by EntityStoreIntegrate.
+	float *age;
+	//The sprite which displays each entity. Not retained by the store.
+	void **views;
+
+} EntityStore;
+
+/*
+ Creates a new empty store with room for the number of entities specified. Returns NULL if the memory
+ could not be allocated.
+ */
+EntityStore *EntityStoreNew(unsigned int capacity);
+
+/*
+ Frees the store and all of it's arrays. The views are not released.
+ */
+void EntityStoreFree(EntityStore *store);
+
+/*
+ Adds an entity to the end of the store, growing the arrays if necessary. Returns the index of the new
+ entity, or kEntityIndexNone if the arrays could not be grown.
+ */
+int EntityStoreAdd(EntityStore *store, float x, float y, float heading, float speed, float radius, int shield, int owner, int type, void *view);
+
+/*
+ Removes the entity at the index specified by moving the last entity into it's place. Returns the view
+ of the entity which now occupies the index, or NULL if the removed entity was the last one.
+ */
+void *EntityStoreRemove(EntityStore *store, unsigned int index);
+
+/*
+ Removes every entity from the store without freeing it's memory.
+ */
+void EntityStoreRemoveAll(EntityStore *store);
+
+/*
+ Grows the arrays, if necessary, so that the store can hold at least the number of entities specified.
+ Returns 0 if the arrays could not be grown.
+ */
+int EntityStoreReserve(EntityStore *store, unsigned int capacity);
+
+/*
+ Sets the heading of an entity and updates it's cached direction vector.
+ */
+void EntityStoreSetHeading(EntityStore *store, unsigned int index, float heading);
+
+/*
+ Moves every entity along it's heading by speed * timeSinceLastUpdate and increases it's age. This is
+ the batch equivalent of Ship's calculateNewPositionWithHeading:distance: method.
+ */
+void EntityStoreIntegrate(EntityStore *store, float timeSinceLastUpdate);
+
+/*
+ Moves every entity whose bounding circle reaches outside the area specified back inside it, so that it is
+ touching the edge. This is the batch equivalent of the border checking in PlayerShip's
+ calculateNewPositionWithHeading:distance: method.
+ */
+void EntityStoreConfine(EntityStore *store, float minimumX, float minimumY, float maximumX, float maximumY);
+
+/*
+ Bounding circle test between the circle specified and every entity in the store. The indices of the
+ entities in collision are written to the hits array, up to maximumHits of them. Returns the number of
+ indices written. Squared distances are compared so no square roots are calculated.
+ */
+unsigned int EntityStoreFindCollisions(const EntityStore *store, float x, float y, float radius, unsigned int *hits, unsigned int maximumHits);
+
+#endif // __ENTITY_STORE_H__
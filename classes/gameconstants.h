@@ -0,0 +1,53 @@
+//
+//  GameConstants.h
+//  AberFighter
+//
+//  Created by wde7 on 26/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Sizes and limits shared by the layers which play the game with sprites and the headless Simulation. The
+ Simulation can't load the sprite images, so it takes their sizes from here, and the sprites check when they
+ are created that their images still match. The file is plain C so that Simulation.c can include it.
+ */
+
+#ifndef __GAME_CONSTANTS_H__
+#define __GAME_CONSTANTS_H__
+
+/*
+ Size of the screen in points, in landscape, and the height of the HUD across the top of it.
+ */
+#define kGameScreenWidth 480
+#define kGameScreenHeight 320
+#define kGameHUDHeight 20
+
+/*
+ Widths of the square sprite images in points. Sprites collide as circles whose diameter is their width.
+ */
+#define kGamePlayerShipImageSize 44
+#define kGameProjectileImageSize 12
+#define kGameSmallTargetImageSize 40
+#define kGameLargeTargetImageSize 50
+
+/*
+ Most targets of each type which can be active at once. The ReusableTargetPool grows to hold this many
+ targets of a type and no more.
+ */
+#define kGameMaximumActiveSmallTargets 40
+#define kGameMaximumActiveLargeTargets 40
+
+/*
+ Most players in a game, seconds a projectile lasts before it expires, which is the time it takes to cross
+ the screen, and the frame rate the game runs at.
+ */
+#define kGameMaximumPlayers 4
+#define kGameProjectileLifetime 1.0f
+#define kGameFrameRate 60
+
+/*
+ Most projectiles which can be active at once. A player fires at most once a frame, so each player can have
+ a lifetime's worth of frames of projectiles in flight. The ProjectileSystem creates this many sprites.
+ */
+#define kGameMaximumActiveProjectiles (int)(kGameMaximumPlayers * kGameFrameRate * kGameProjectileLifetime)
+
+#endif // __GAME_CONSTANTS_H__
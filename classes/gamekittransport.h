@@ -0,0 +1,33 @@
+//
+//  GameKitTransport.h
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ NetworkTransport which sends packets over a GKSession. This is the transport used when two devices are
+ connected over bluetooth with the peer picker.
+ */
+
+#import <Foundation/Foundation.h>
+#import <GameKit/GameKit.h>
+#import "NetworkTransport.h"
+
+@interface GameKitTransport : NSObject <NetworkTransport, GKSessionDelegate> {
+
+	//The session which represents the connection with the other peer.
+	GKSession *session;
+	//Receives the packets and peer state changes. Not retained.
+	id<NetworkTransportDelegate> delegate;
+
+}
+
+@property (nonatomic, readonly) GKSession *session;
+
+/*
+ Creates a new GKSession with the session ID specified for use by the peer picker.
+ */
+- (id)initWithSessionID:(NSString *)sessionID;
+
+@end
@@ -0,0 +1,93 @@
+//
+//  GameKitTransport.m
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "GameKitTransport.h"
+
+@implementation GameKitTransport
+
+@synthesize session;
+
+- (id)initWithSessionID:(NSString *)sessionID {
+
+	if ((self = [super init])) {
+
+		session = [[GKSession alloc] initWithSessionID:sessionID
+										   displayName:nil
+										   sessionMode:GKSessionModePeer];
+		delegate = nil;
+
+	}
+
+	return self;
+
+}
+
+/*
+ The peer picker manages the session until it has connected, so the transport only becomes the delegate
+ and data receive handler of the session once it is started.
+ */
+- (void)startWithDelegate:(id<NetworkTransportDelegate>)newDelegate {
+
+	delegate = newDelegate;
+	session.delegate = self;
+	[session setDataReceiveHandler:self withContext:NULL];
+
+}
+
+- (void)sendData:(NSData *)data toPeers:(NSArray *)peerIDs reliable:(BOOL)reliable {
+
+	[session sendData:data
+			  toPeers:peerIDs
+		 withDataMode:(reliable ? GKSendDataReliable : GKSendDataUnreliable)
+				error:nil];
+
+}
+
+- (void)stop {
+
+	delegate = nil;
+	session.available = NO;
+	[session disconnectFromAllPeers];
+	session.delegate = nil;
+	[session setDataReceiveHandler:nil withContext:nil];
+
+}
+
+#pragma mark -
+#pragma mark GKSession Callbacks
+
+- (void)receiveData:(NSData *)data fromPeer:(NSString *)peerID
+		  inSession:(GKSession *)receivingSession context:(void *)context {
+
+	[delegate transport:self receivedData:data fromPeer:peerID];
+
+}
+
+- (void)session:(GKSession *)failedSession didFailWithError:(NSError *)error {
+
+	[delegate transport:self failedWithError:error];
+
+}
+
+- (void)session:(GKSession *)changedSession peer:(NSString *)peerID didChangeState:(GKPeerConnectionState)state {
+
+	if (state == GKPeerStateDisconnected) {
+		[delegate transport:self peerDisconnected:peerID];
+	}
+
+}
+
+- (void)dealloc {
+
+	[self stop];
+	[session release];
+	[super dealloc];
+
+}
+
+@end
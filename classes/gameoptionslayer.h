@@ -82,9 +82,9 @@
 /*
  Creates the title shown at the top of the layer with a ship image next to it. The intention of this 
  is that the title indicates the player ID of the local player on the device and shows the PlayerShip 
- which will represent them during the game.
+ which will represent them during the game. Returns the ship sprite so that it can be tinted.
  */
-- (void)setUpTitle:(NSString *)titleText shipFrameName:(NSString *)spriteFrameName shipRotation:(float)shipRotation;
+- (CCSprite *)setUpTitle:(NSString *)titleText shipFrameName:(NSString *)spriteFrameName shipRotation:(float)shipRotation;
 
 /*
  Creates a game length slider under the title of the view. SinglePlayerOptionsLayer shows this, as does the 
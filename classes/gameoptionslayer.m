@@ -33,7 +33,7 @@
 /*
  Creates a title and a sprite representing the player at the top of the view.
  */
-- (void)setUpTitle:(NSString *)titleText shipFrameName:(NSString *)spriteFrameName shipRotation:(float)shipRotation {
+- (CCSprite *)setUpTitle:(NSString *)titleText shipFrameName:(NSString *)spriteFrameName shipRotation:(float)shipRotation {
 
 	//Add a title to the Game Options window.
 	static int MAIN_TITLE_TOP_MARGIN = 35;
@@ -51,6 +51,8 @@
 	playerShipSprite.position = ccp(titleLabel.position.x + (titleLabel.contentSize.width / 2) + 30, titleYPosition);
 	[spriteSheet addChild:playerShipSprite];
 	
+	return playerShipSprite;
+	
 }
 
 /*
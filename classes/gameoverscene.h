@@ -13,8 +13,9 @@
 
 #import <Foundation/Foundation.h>
 #import "cocos2d.h"
+#import "BluetoothCommsManager.h"
 
-@interface GameOverLayer : CCLayer <UIAlertViewDelegate> {
+@interface GameOverLayer : CCLayer <UIAlertViewDelegate, NetworkEventHandler> {
 	
 	/*
 	 This is a pointer to the alertView instance which is used for describing problems
@@ -74,38 +74,35 @@ NSString *const DefeatEnding = @"You Lose!!";
 		
 	} else {
 		
-		if (currentGameState.player1Score == currentGameState.player2Score) {
+		/*
+		 The local score is compared with the best score of the other players.
+		 */
+		int localPlayer = [BluetoothCommsManager sharedInstance].playerID;
+		int localScore = [currentGameState scoreForPlayer:localPlayer];
+		int bestOtherScore = -1;
+		
+		for (int player = kPlayer1; player <= MAX(currentGameState.numberOfPlayers, 2); player++) {
+			
+			if (player != localPlayer) {
+				bestOtherScore = MAX(bestOtherScore, [currentGameState scoreForPlayer:player]);
+			}
+			
+		}
+		
+		if (localScore == bestOtherScore) {
 			
 			/*
 			 In a tied multiplayer game the message is "This game is a draw".
 			 */
 			description = DrawEnding;
 			
-		} else if (currentGameState.player1Score > currentGameState.player2Score) {
+		} else if (localScore > bestOtherScore) {
 			
-			/*
-			 The rest of these conditionals work out which player won and which lost and apply 
-			 the relevant description value.
-			 */
-			if ([BluetoothCommsManager sharedInstance].playerID == kPlayer1) {
-				
-				description = VictoryEnding;
-					
-			} else {
-			
-				description = DefeatEnding;
-			}
+			description = VictoryEnding;
 			
 		} else {
 			
-			if ([BluetoothCommsManager sharedInstance].playerID == kPlayer1) {
-				
-				description = DefeatEnding;
-				
-			} else {
-				
-				description = VictoryEnding;
-			}
+			description = DefeatEnding;
 			
 		}
 	}
@@ -120,26 +117,28 @@ NSString *const DefeatEnding = @"You Lose!!";
 	[self addChild:descriptionLabel];
 	
 	/*
-	 A label is created with player 1's score and it is added to the layer.
+	 A label is created with each player's score and added to the layer, player 1's first. A single player game
+	 only has player 1's. With more than two players the labels are smaller so that they all fit.
 	 */
-	NSString *player1ScoreString = [NSString stringWithFormat:@"Player 1: %d points", currentGameState.player1Score];
-	CCLabel *player1Score = [CCLabel labelWithString:player1ScoreString fontName:@"Arial" fontSize:30];
-	player1Score.position = ccp((winSize.width / 2), 
-								descriptionLabel.position.y - 
-								((player1Score.contentSize.height/2) + winSize.height/8));
-	[self addChild:player1Score];
+	int numberOfScores = 1;
 	
-	/*
-	 If the game is multiplayer another label is created for player 2's score and added to the layer.
-	 */
 	if (currentGameState.gameType == kMultiplayerGame) {
+		numberOfScores = MAX(currentGameState.numberOfPlayers, 2);
+	}
+	
+	float scoreFontSize = (numberOfScores > 2) ? 20 : 30;
+	float scoreSpacing = (numberOfScores > 2) ? winSize.height/16 : winSize.height/8;
+	CCNode *previousLabel = descriptionLabel;
+	
+	for (int player = kPlayer1; player <= numberOfScores; player++) {
 		
-		NSString *player2ScoreString = [NSString stringWithFormat:@"Player 2: %d points", currentGameState.player2Score];
-		CCLabel *player2Score = [CCLabel labelWithString:player2ScoreString fontName:@"Arial" fontSize:30];
-		player2Score.position = ccp((winSize.width / 2), 
-									player1Score.position.y - 
-									((player2Score.contentSize.height/2) + winSize.height/8));
-		[self addChild:player2Score];
+		NSString *scoreString = [NSString stringWithFormat:@"Player %d: %d points", player, [currentGameState scoreForPlayer:player]];
+		CCLabel *scoreLabel = [CCLabel labelWithString:scoreString fontName:@"Arial" fontSize:scoreFontSize];
+		scoreLabel.position = ccp((winSize.width / 2), 
+								  previousLabel.position.y - 
+								  ((scoreLabel.contentSize.height/2) + scoreSpacing));
+		[self addChild:scoreLabel];
+		previousLabel = scoreLabel;
 		
 	}
 	
@@ -363,49 +362,68 @@ NSString *const DefeatEnding = @"You Lose!!";
 }
 
 #pragma mark -
-#pragma mark BluetoothCommsManager Notification Processing
+#pragma mark BluetoothCommsManager Event Processing
 
 /*
- Called by the NSNotificationCenter when this class is registered as an observer of the BluetoothCommsManager.
- This method reacts to the notifications posted by the BluetoothCommsManager.
+ Called by the BluetoothCommsManager once per frame for each event posted while this layer is it's eventHandler.
  */
-- (void)processBluetoothNotification:(NSNotification *)notification {
+- (void)processNetworkEvent:(const NetworkEvent *)event {
 	
-	if (notification.name == SessionFailedWithError) {
-		
-		/*
-		 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+	switch (event->type) {
 		
-	} else if (notification.name == PeerCancelledGame) {
-		
-		/*
-		 Peer pressed Main Menu button. Show Cancel Alert which will return the local player to the main menu when dismissed.
-		 */
-		[self showCancelAlert];
-		
-	} else if (notification.name == PeerWasDisconnected) {
+		case kNetworkEventSessionFailed: {
+			
+			/*
+			 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-		/*
-		 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventPeerCancelledGame: {
+			
+			/*
+			 Peer pressed Main Menu button. Show Cancel Alert which will return the local player to the main menu when dismissed.
+			 */
+			[self showCancelAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerLost) {
+		case kNetworkEventPeerDisconnected: {
+			
+			/*
+			 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-		/*
-		 Peer connection lost. Show Reconnect alert which notifies user that the devices are attempting to re-connect. They
-		 can dimiss the alert to return to the main menu or wait for reconnection.
-		 */
-		[self showReconnectAlert];
+		case kNetworkEventPeerLost: {
+			
+			/*
+			 Peer connection lost. Show Reconnect alert which notifies user that the devices are attempting to re-connect. They
+			 can dimiss the alert to return to the main menu or wait for reconnection.
+			 */
+			[self showReconnectAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerFound) {
+		case kNetworkEventPeerFound: {
+			
+			/*
+			 Peer has been reconnected with other device. Dismiss the UIAlertView.
+			 */
+			[self.alertView dismissWithClickedButtonIndex:-1 animated:YES];
+			
+		}
+		break;
 		
-		/*
-		 Peer has been reconnected with other device. Dismiss the UIAlertView.
-		 */
-		[self.alertView dismissWithClickedButtonIndex:-1 animated:YES];
+		default:
+		break;
 		
 	}
 }
@@ -414,29 +432,25 @@ NSString *const DefeatEnding = @"You Lose!!";
 #pragma mark Superclass Overrides
 
 /*
- Called when the layer is shown. Adds the layer as an observer of the BluetoothCommsManager in the
- NSNotificationCenter.
+ Called when the layer is shown. Sets the layer as the BluetoothCommsManager's eventHandler.
  */
 - (void)onEnter {
 	
 	[super onEnter];
 	
-	[[NSNotificationCenter defaultCenter] addObserver:self 
-											 selector:@selector(processBluetoothNotification:) 
-												 name:nil 
-											   object:[BluetoothCommsManager sharedInstance]];
+	[BluetoothCommsManager sharedInstance].eventHandler = self;
 	
 }
 
 /*
- Called when a transition out of this layer is over. Removes this layer as an observer in the 
- NSNotificationCenter before it it deallocated.
+ Called when a transition out of this layer is over. Stops this layer receiving network events before it
+ is deallocated.
  */
 - (void)onExit {
 	
 	[super onExit];
 	
-	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
 	
 }
 
@@ -12,6 +12,9 @@
 
 #import <Foundation/Foundation.h>
 
+//Most players a multiplayer game can have, including the local player.
+#define kMaximumNumberOfPlayers 4
+
 /*
  Enumeration which can take the values kSinglePlayerGame and kMultiplayerGame. Used for identifying
  the game type when in various scenes.
@@ -64,11 +67,16 @@ typedef enum States {
 	int accelerometerControlMethod;
 	
 	/*
-	 Current score of players 1 and 2. Located here so that the information can be used in the MultilayerGameScene 
-	 and the GameOverLayer.	 
+	 Number of players in the game, 1 in a single player game. Set once the player IDs have been decided in a
+	 multiplayer game.
 	 */
-	int player1Score;
-	int player2Score;
+	int numberOfPlayers;
+	
+	/*
+	 Current score of each player, indexed by PlayerID - 1. Located here so that the information can be used in
+	 the MultilayerGameScene and the GameOverLayer.
+	 */
+	int playerScores[kMaximumNumberOfPlayers];
 
 }
 
@@ -80,8 +88,7 @@ typedef enum States {
 @property (nonatomic,readwrite,assign) int gameLength;
 @property (nonatomic,readwrite,assign) int accelerometerControlMethod;
 @property (nonatomic,readwrite,assign) double calibratedPosition;
-@property (nonatomic,readwrite,assign) int player1Score;
-@property (nonatomic,readwrite,assign) int player2Score;
+@property (nonatomic,readwrite,assign) int numberOfPlayers;
 
 /*
  GameState is a singleton. This method instantiates the singleton if this hasn't 
@@ -90,8 +97,8 @@ typedef enum States {
 + (GameState *)sharedState;
 
 /*
- Reset the game state to it's initial configuration. The scores of both players are set to 0.
- The initial GameState is GameNotStarted. The accelerometer control method is set to 1 by default.
+ Reset the game state to it's initial configuration. The scores of every player are set to 0 and the game has a
+ single player. The initial GameState is GameNotStarted. The accelerometer control method is set to 1 by default.
  The gameLength is not reset because the SinglePlayerOptionsLayer remembers the length of previous games.
  */
 - (void)reset;
@@ -104,7 +111,17 @@ typedef enum States {
 - (void)resetGameLength;
 
 /*
- This method adds the points specified to the correct player score variable.
+ Returns the score of the player specified, from 1 to kMaximumNumberOfPlayers, or 0 for any other player.
+ */
+- (int)scoreForPlayer:(int)player;
+
+/*
+ Sets the score of the player specified. Players outside 1 to kMaximumNumberOfPlayers are ignored.
+ */
+- (void)setScore:(int)score forPlayer:(int)player;
+
+/*
+ This method adds the points specified to the score of the player specified.
  */
 - (void)rewardPlayer:(int)player points:(int)points;
 
@@ -18,8 +18,7 @@
 @synthesize gameLength; 
 @synthesize calibratedPosition;
 @synthesize accelerometerControlMethod;
-@synthesize player1Score;
-@synthesize player2Score;
+@synthesize numberOfPlayers;
 
 /*
  Singleton of this class.
@@ -67,27 +66,37 @@ static GameState *sharedState = nil;
  */
 - (void)reset {
 	
-	self.player1Score = 0;
-	self.player2Score = 0;
+	memset(playerScores, 0, sizeof(playerScores));
+	self.numberOfPlayers = 1;
 	self.currentState = kGameNotStarted;
 	self.accelerometerControlMethod = 1;
 	
 }
 
+- (int)scoreForPlayer:(int)player {
+	
+	if (player < 1 || player > kMaximumNumberOfPlayers) {
+		return 0;
+	}
+	
+	return playerScores[player - 1];
+	
+}
+
+- (void)setScore:(int)score forPlayer:(int)player {
+	
+	if (player >= 1 && player <= kMaximumNumberOfPlayers) {
+		playerScores[player - 1] = score;
+	}
+	
+}
+
 /*
  Adds the reward specified in the parameters to the player with the specified parameter. 
  */
 - (void)rewardPlayer:(int)player points:(int)points {
 
-	if (player == 1) {
-		
-		self.player1Score = self.player1Score + points;
-		
-	} else if (player == 2) {
-		
-		self.player2Score = self.player2Score + points;
-		
-	}
+	[self setScore:([self scoreForPlayer:player] + points) forPlayer:player];
 
 }
 
@@ -0,0 +1,306 @@
+//
+//  LinkEstimator.c
+//  AberFighter
+//
+//  Created by wde7 on 12/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include <math.h>
+#include "LinkEstimator.h"
+
+#define kLinkEstimatorFlagEcho 0x01
+
+/*
+ Weight given to each new loss measurement.
+ */
+#define kLinkEstimatorLossSmoothing 0.25f
+
+void LinkEstimatorInit(LinkEstimator *estimator, double now) {
+
+	memset(estimator, 0, sizeof(LinkEstimator));
+
+	for (unsigned int i = 0; i < kLinkEstimatorPingHistorySize; i++) {
+		estimator->pingSendTimes[i] = -1.0;
+	}
+
+	estimator->statistics.sendRate = kLinkEstimatorInitialSendRate;
+	estimator->lastReportTime = now - kLinkEstimatorReportInterval;
+	estimator->lastReceiveTime = now;
+
+}
+
+void LinkEstimatorPacketReceived(LinkEstimator *estimator, uint32_t packetNumber, double now) {
+
+	/*
+	 Packets after the highest received so far show how many the peer has sent. Late packets were counted
+	 as expected when the gap before them opened, so they only count as received.
+	 */
+	if (!estimator->hasPacketNumber) {
+
+		estimator->hasPacketNumber = 1;
+		estimator->highestPacketNumber = packetNumber;
+		estimator->packetsExpected++;
+
+	} else if ((int32_t)(packetNumber - estimator->highestPacketNumber) > 0) {
+
+		estimator->packetsExpected += packetNumber - estimator->highestPacketNumber;
+		estimator->highestPacketNumber = packetNumber;
+
+	}
+
+	estimator->packetsReceived++;
+
+	/*
+	 The silence while the peer was lost isn't a normal interval between packets, so it isn't measured.
+	 */
+	if (!estimator->peerLost) {
+
+		double interval = now - estimator->lastReceiveTime;
+
+		if (!estimator->hasReceiveInterval) {
+
+			estimator->hasReceiveInterval = 1;
+			estimator->receiveInterval = interval;
+			estimator->receiveIntervalDeviation = interval / 2.0;
+
+		} else {
+
+			estimator->receiveIntervalDeviation = 0.75 * estimator->receiveIntervalDeviation + 0.25 * fabs(estimator->receiveInterval - interval);
+			estimator->receiveInterval = 0.875 * estimator->receiveInterval + 0.125 * interval;
+
+		}
+
+	} else {
+
+		estimator->packetsSinceLost++;
+
+		if (estimator->packetsSinceLost >= kLinkEstimatorFoundPackets) {
+
+			estimator->peerLost = 0;
+			estimator->peerFoundPending = 1;
+
+		}
+
+	}
+
+	estimator->lastReceiveTime = now;
+
+}
+
+int LinkEstimatorReportDue(const LinkEstimator *estimator, double now) {
+
+	return (now - estimator->lastReportTime) >= kLinkEstimatorReportInterval;
+
+}
+
+void LinkEstimatorWriteReport(LinkEstimator *estimator, WireWriter *writer, double now) {
+
+	LinkStatistics *statistics = &estimator->statistics;
+
+	if (estimator->packetsExpected > 0) {
+
+		uint32_t received = (estimator->packetsReceived < estimator->packetsExpected) ? estimator->packetsReceived : estimator->packetsExpected;
+		float loss = 1.0f - (float)received / (float)estimator->packetsExpected;
+
+		statistics->incomingLoss += (loss - statistics->incomingLoss) * kLinkEstimatorLossSmoothing;
+
+		estimator->packetsExpected = 0;
+		estimator->packetsReceived = 0;
+
+	}
+
+	unsigned int slot = estimator->nextPing % kLinkEstimatorPingHistorySize;
+
+	estimator->pingNumbers[slot] = estimator->nextPing;
+	estimator->pingSendTimes[slot] = now;
+
+	WireWriteUInt16(writer, estimator->nextPing);
+	WireWriteUInt8(writer, (uint8_t)lroundf(statistics->incomingLoss * 255.0f));
+	WireWriteUInt8(writer, (uint8_t)lroundf(statistics->sendRate));
+	WireWriteUInt8(writer, estimator->hasPeerPing ? kLinkEstimatorFlagEcho : 0);
+
+	if (estimator->hasPeerPing) {
+
+		WireWriteUInt16(writer, estimator->peerPing);
+		WireWriteVarUInt(writer, (uint32_t)lround((now - estimator->peerPingReceiveTime) * 1000.0));
+
+	}
+
+	estimator->nextPing++;
+	estimator->lastReportTime = now;
+
+}
+
+/*
+ Updates the round trip time estimate with a new measurement, smoothed in the same way as TCP.
+ */
+static void LinkEstimatorAddRoundTripSample(LinkEstimator *estimator, double sample) {
+
+	LinkStatistics *statistics = &estimator->statistics;
+
+	if (!estimator->hasRoundTripTime) {
+
+		estimator->hasRoundTripTime = 1;
+		estimator->minimumRoundTripTime = sample;
+		statistics->roundTripTime = sample;
+		statistics->jitter = sample / 2.0;
+
+	} else {
+
+		statistics->jitter = 0.75 * statistics->jitter + 0.25 * fabs(statistics->roundTripTime - sample);
+		statistics->roundTripTime = 0.875 * statistics->roundTripTime + 0.125 * sample;
+
+		if (sample < estimator->minimumRoundTripTime) {
+			estimator->minimumRoundTripTime = sample;
+		}
+
+	}
+
+}
+
+/*
+ Cuts the send rate when the link is congested and increases it when it is clean. Loss between the two
+ thresholds leaves the rate alone. A round trip time well above the lowest measured means packets are
+ queueing somewhere, which happens before they start being dropped.
+ */
+static void LinkEstimatorAdjustSendRate(LinkEstimator *estimator) {
+
+	LinkStatistics *statistics = &estimator->statistics;
+
+	int queueing = estimator->hasRoundTripTime &&
+				   statistics->roundTripTime > 2.0 * estimator->minimumRoundTripTime + 0.05;
+
+	if (statistics->outgoingLoss > kLinkEstimatorCongestedLoss || queueing) {
+		statistics->sendRate *= 0.75f;
+	} else if (statistics->outgoingLoss < kLinkEstimatorCleanLoss) {
+		statistics->sendRate += 1.0f;
+	}
+
+	if (statistics->sendRate < kLinkEstimatorMinimumSendRate) {
+		statistics->sendRate = kLinkEstimatorMinimumSendRate;
+	} else if (statistics->sendRate > kLinkEstimatorMaximumSendRate) {
+		statistics->sendRate = kLinkEstimatorMaximumSendRate;
+	}
+
+}
+
+int LinkEstimatorReadReport(LinkEstimator *estimator, WireReader *reader, double now) {
+
+	uint16_t ping = WireReadUInt16(reader);
+	uint8_t loss = WireReadUInt8(reader);
+	uint8_t peerSendRate = WireReadUInt8(reader);
+	uint8_t flags = WireReadUInt8(reader);
+	uint16_t echo = 0;
+	uint32_t echoDelay = 0;
+
+	if (flags & kLinkEstimatorFlagEcho) {
+
+		echo = WireReadUInt16(reader);
+		echoDelay = WireReadVarUInt(reader);
+
+	}
+
+	if (reader->error) {
+		return 0;
+	}
+
+	/*
+	 Only the newest ping is echoed, so an older one arriving late is ignored.
+	 */
+	if (!estimator->hasPeerPing || (int16_t)(ping - estimator->peerPing) > 0) {
+
+		estimator->hasPeerPing = 1;
+		estimator->peerPing = ping;
+		estimator->peerPingReceiveTime = now;
+
+	}
+
+	/*
+	 Each ping gives at most one measurement, so a repeated echo is ignored. The time the peer held the ping
+	 before echoing it is taken off.
+	 */
+	if (flags & kLinkEstimatorFlagEcho) {
+
+		unsigned int slot = echo % kLinkEstimatorPingHistorySize;
+
+		if (estimator->pingNumbers[slot] == echo && estimator->pingSendTimes[slot] >= 0.0) {
+
+			double sample = now - estimator->pingSendTimes[slot] - echoDelay / 1000.0;
+
+			if (sample >= 0.0) {
+				LinkEstimatorAddRoundTripSample(estimator, sample);
+			}
+
+			estimator->pingSendTimes[slot] = -1.0;
+
+		}
+
+	}
+
+	estimator->statistics.outgoingLoss = loss / 255.0f;
+	estimator->statistics.peerSendRate = peerSendRate;
+
+	LinkEstimatorAdjustSendRate(estimator);
+
+	return 1;
+
+}
+
+double LinkEstimatorTimeout(const LinkEstimator *estimator) {
+
+	/*
+	 Packets arrive at least as often as the peer sends link reports, even when nothing else is being sent.
+	 */
+	double expectedInterval = kLinkEstimatorReportInterval;
+
+	if (estimator->hasReceiveInterval) {
+
+		double measuredInterval = estimator->receiveInterval + 4.0 * estimator->receiveIntervalDeviation;
+
+		if (measuredInterval > expectedInterval) {
+			expectedInterval = measuredInterval;
+		}
+
+	}
+
+	double timeout = kLinkEstimatorMissedPackets * expectedInterval +
+					 estimator->statistics.roundTripTime + 4.0 * estimator->statistics.jitter;
+
+	if (timeout < kLinkEstimatorMinimumTimeout) {
+		timeout = kLinkEstimatorMinimumTimeout;
+	} else if (timeout > kLinkEstimatorMaximumTimeout) {
+		timeout = kLinkEstimatorMaximumTimeout;
+	}
+
+	return timeout;
+
+}
+
+LinkEstimatorEvent LinkEstimatorUpdate(LinkEstimator *estimator, double now) {
+
+	if (estimator->peerFoundPending) {
+
+		estimator->peerFoundPending = 0;
+		return kLinkEstimatorPeerFound;
+
+	}
+
+	if (!estimator->peerLost && (now - estimator->lastReceiveTime) > LinkEstimatorTimeout(estimator)) {
+
+		estimator->peerLost = 1;
+		estimator->packetsSinceLost = 0;
+		return kLinkEstimatorPeerLost;
+
+	}
+
+	return kLinkEstimatorNoChange;
+
+}
+
+double LinkEstimatorSendInterval(const LinkEstimator *estimator) {
+
+	return 1.0 / estimator->statistics.sendRate;
+
+}
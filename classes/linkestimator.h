@@ -0,0 +1,182 @@
+//
+//  LinkEstimator.h
+//  AberFighter
+//
+//  Created by wde7 on 12/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The LinkEstimator measures the quality of the connection to the peer and decides how often directional data
+ should be sent over it. It replaces the fixed heartbeat, which sent a packet every half second and declared
+ the peer lost after two seconds without one regardless of how the link had been behaving.
+
+ Each device sends a link report every kLinkEstimatorReportInterval seconds. A report carries:
+   ping        2 bytes, a sequence number for the report
+   loss        1 byte, the fraction of the peer's packets this device has been losing, out of 255
+   send rate   1 byte, how many times a second this device is sending directional data
+   flags       1 byte, bit 0 set if an echo follows
+   echo        2 bytes, the newest ping received from the peer, then the time in milliseconds between it
+               arriving and this report being written as a variable length integer
+
+ The round trip time is measured from the echoes, with the time the report was held by the peer taken off,
+ and the jitter is it's mean deviation. Loss is measured from gaps in the packet numbers of every packet
+ received, so it covers all traffic rather than just the reports.
+
+ The directional data send rate is controlled in the same way as TCP's congestion window. When the peer
+ reports losing more than kLinkEstimatorCongestedLoss of our packets, or the round trip time has grown well
+ beyond the lowest seen, the rate is cut by a quarter. When the link is clean it is increased by one message
+ a second per report, up to kLinkEstimatorMaximumSendRate.
+
+ The peer is considered lost when nothing has arrived for longer than the timeout, which is calculated
+ from the measured interval between packets and the round trip time. It is found again once
+ kLinkEstimatorFoundPackets packets have arrived.
+
+ Times are in seconds and must come from a clock which never goes backwards. The estimator is written in
+ plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __LINK_ESTIMATOR_H__
+#define __LINK_ESTIMATOR_H__
+
+#include <stdint.h>
+#include "WireProtocol.h"
+
+//Seconds between link reports.
+#define kLinkEstimatorReportInterval 0.25
+
+//Number of sent pings remembered for matching with echoes.
+#define kLinkEstimatorPingHistorySize 16
+
+/*
+ Limits and initial value of the directional data send rate, in messages per second. The maximum is below
+ the accelerometer rate, which is the most often there is new data to send.
+ */
+#define kLinkEstimatorMinimumSendRate 5.0
+#define kLinkEstimatorInitialSendRate 20.0
+#define kLinkEstimatorMaximumSendRate 30.0
+
+/*
+ Reported loss above which the send rate is cut, and below which it is increased.
+ */
+#define kLinkEstimatorCongestedLoss 0.1
+#define kLinkEstimatorCleanLoss 0.02
+
+/*
+ The peer is lost after kLinkEstimatorMissedPackets expected packets fail to arrive, but never sooner than
+ the minimum timeout or later than the maximum.
+ */
+#define kLinkEstimatorMissedPackets 4
+#define kLinkEstimatorMinimumTimeout 1.5
+#define kLinkEstimatorMaximumTimeout 5.0
+
+//Packets which must arrive after the peer was lost for it to be found.
+#define kLinkEstimatorFoundPackets 3
+
+/*
+ Changes in the state of the peer returned by LinkEstimatorUpdate.
+ */
+typedef enum {
+
+	kLinkEstimatorNoChange,
+	kLinkEstimatorPeerLost,
+	kLinkEstimatorPeerFound
+
+} LinkEstimatorEvent;
+
+/*
+ The measurements made by a LinkEstimator.
+ */
+typedef struct {
+
+	//Smoothed round trip time and it's mean deviation, in seconds. 0 until the first echo arrives.
+	double roundTripTime;
+	double jitter;
+	//Fraction of the peer's packets lost on the way here, and of ours lost on the way there as reported by the peer.
+	float incomingLoss;
+	float outgoingLoss;
+	//Directional data messages per second sent by this device and by the peer.
+	float sendRate;
+	float peerSendRate;
+
+} LinkStatistics;
+
+typedef struct {
+
+	LinkStatistics statistics;
+
+	//Pings sent, indexed by ping number modulo the history size.
+	uint16_t nextPing;
+	double pingSendTimes[kLinkEstimatorPingHistorySize];
+	uint16_t pingNumbers[kLinkEstimatorPingHistorySize];
+	double lastReportTime;
+
+	//Newest ping received from the peer and when it arrived.
+	int hasPeerPing;
+	uint16_t peerPing;
+	double peerPingReceiveTime;
+
+	//Round trip time estimate and the lowest round trip time measured.
+	int hasRoundTripTime;
+	double minimumRoundTripTime;
+
+	//Packet numbers expected and received since the last report, for measuring incoming loss.
+	int hasPacketNumber;
+	uint32_t highestPacketNumber;
+	uint32_t packetsExpected;
+	uint32_t packetsReceived;
+
+	//Time the last packet arrived, and the smoothed interval between packets and it's mean deviation.
+	double lastReceiveTime;
+	int hasReceiveInterval;
+	double receiveInterval;
+	double receiveIntervalDeviation;
+
+	//Whether the peer is lost, and the number of packets received since it was.
+	int peerLost;
+	unsigned int packetsSinceLost;
+	int peerFoundPending;
+
+} LinkEstimator;
+
+/*
+ Resets the estimator. The peer is treated as having just been heard from at the time specified.
+ */
+void LinkEstimatorInit(LinkEstimator *estimator, double now);
+
+/*
+ Records the arrival of a packet with the packet number specified. Called for every packet received.
+ */
+void LinkEstimatorPacketReceived(LinkEstimator *estimator, uint32_t packetNumber, double now);
+
+/*
+ Returns 1 if a link report should be sent.
+ */
+int LinkEstimatorReportDue(const LinkEstimator *estimator, double now);
+
+/*
+ Writes a link report. The incoming loss is measured over the packets which have arrived since the last report.
+ */
+void LinkEstimatorWriteReport(LinkEstimator *estimator, WireWriter *writer, double now);
+
+/*
+ Reads a link report from the peer, updating the round trip time and adjusting the send rate. Returns 0 if
+ the report was corrupt.
+ */
+int LinkEstimatorReadReport(LinkEstimator *estimator, WireReader *reader, double now);
+
+/*
+ Checks whether the peer has been lost or found. Returns each change once.
+ */
+LinkEstimatorEvent LinkEstimatorUpdate(LinkEstimator *estimator, double now);
+
+/*
+ Seconds without a packet after which the peer is considered lost.
+ */
+double LinkEstimatorTimeout(const LinkEstimator *estimator);
+
+/*
+ Seconds between directional data messages at the current send rate.
+ */
+double LinkEstimatorSendInterval(const LinkEstimator *estimator);
+
+#endif // __LINK_ESTIMATOR_H__
@@ -0,0 +1,78 @@
+//
+//  LoopbackTransport.h
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ NetworkTransport which connects BluetoothCommsManagers, or a BluetoothCommsManager and a test harness,
+ within a single process. LoopbackTransports are connected to each other in pairs and each delivers the
+ packets sent through it to the transports it is connected to on the main run loop. A transport can be
+ connected to up to kLoopbackTransportMaximumPeers others, so several can be connected as a mesh or a star.
+
+ The conditions of a real wireless link can be imitated by setting the conditions of a transport, which
+ apply to the packets it sends. Every packet is delayed by the latency plus or minus a random amount of
+ jitter. Unreliable packets may also be lost or held back long enough for later packets to overtake them.
+ Reliable packets are never lost and always arrive in the order they were sent. The random numbers come
+ from a seeded generator so that a run can be repeated exactly.
+ */
+
+#import <Foundation/Foundation.h>
+#import "NetworkTransport.h"
+#import "Simulation.h"
+
+//Most transports a single transport can be connected to.
+#define kLoopbackTransportMaximumPeers 7
+
+typedef struct {
+
+	//Seconds every packet is delayed by.
+	NSTimeInterval latency;
+	//Maximum number of seconds added to or removed from the latency of each packet.
+	NSTimeInterval jitter;
+	//Probability from 0 to 1 that an unreliable packet is lost.
+	float lossRate;
+	//Probability from 0 to 1 that an unreliable packet is held back for an extra latency period.
+	float reorderRate;
+
+} LoopbackConditions;
+
+@interface LoopbackTransport : NSObject <NetworkTransport> {
+
+	//The ID this transport is known by to the transport it is connected to.
+	NSString *peerID;
+	//The transports this one sends to. Not retained, connected transports refer to each other.
+	LoopbackTransport *peers[kLoopbackTransportMaximumPeers];
+	int numberOfPeers;
+	//Receives the packets and peer state changes. Not retained.
+	id<NetworkTransportDelegate> delegate;
+
+	LoopbackConditions conditions;
+	SimulationRandom random;
+
+	//Time at which the last reliable packet sent will be delivered, used to keep reliable packets in order.
+	NSTimeInterval lastReliableDeliveryTime;
+
+}
+
+@property (nonatomic, readonly) NSString *peerID;
+@property (nonatomic, readwrite, assign) LoopbackConditions conditions;
+
+/*
+ Initializer method. The transport is created with perfect conditions, no latency, jitter, loss or reordering.
+ */
+- (id)initWithPeerID:(NSString *)newPeerID;
+
+/*
+ Connects this transport and the one specified to each other. Does nothing if they are already connected or
+ either has no room for another peer.
+ */
+- (void)connectToTransport:(LoopbackTransport *)otherTransport;
+
+/*
+ Seeds the generator used to decide the delay and fate of each packet.
+ */
+- (void)seedConditions:(uint32_t)seed;
+
+@end
@@ -0,0 +1,208 @@
+//
+//  LoopbackTransport.m
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "LoopbackTransport.h"
+
+@implementation LoopbackTransport
+
+@synthesize peerID;
+@synthesize conditions;
+
+- (id)initWithPeerID:(NSString *)newPeerID {
+
+	if ((self = [super init])) {
+
+		peerID = [newPeerID copy];
+		numberOfPeers = 0;
+		delegate = nil;
+		memset(&conditions, 0, sizeof(LoopbackConditions));
+		SimulationRandomSeed(&random, 1);
+		lastReliableDeliveryTime = 0;
+
+	}
+
+	return self;
+
+}
+
+/*
+ Returns the index of the transport specified in peers, or -1 if it isn't connected to this one.
+ */
+- (int)indexOfPeer:(LoopbackTransport *)transport {
+
+	for (int i = 0; i < numberOfPeers; i++) {
+
+		if (peers[i] == transport) {
+			return i;
+		}
+
+	}
+
+	return -1;
+
+}
+
+- (void)connectToTransport:(LoopbackTransport *)otherTransport {
+
+	if (otherTransport == self ||
+		[self indexOfPeer:otherTransport] >= 0 ||
+		numberOfPeers == kLoopbackTransportMaximumPeers ||
+		otherTransport->numberOfPeers == kLoopbackTransportMaximumPeers) {
+		return;
+	}
+
+	peers[numberOfPeers++] = otherTransport;
+	otherTransport->peers[otherTransport->numberOfPeers++] = self;
+
+}
+
+/*
+ Forgets the transport specified, keeping the rest of the peers in the order they were connected.
+ */
+- (void)removePeer:(LoopbackTransport *)transport {
+
+	int index = [self indexOfPeer:transport];
+
+	if (index < 0) {
+		return;
+	}
+
+	for (int i = index; i < numberOfPeers - 1; i++) {
+		peers[i] = peers[i + 1];
+	}
+
+	numberOfPeers--;
+
+}
+
+- (void)seedConditions:(uint32_t)seed {
+
+	SimulationRandomSeed(&random, seed);
+
+}
+
+/*
+ Returns a random number from 0 up to but not including 1.
+ */
+- (double)nextRandomFraction {
+
+	return SimulationRandomNext(&random) / 4294967296.0;
+
+}
+
+- (void)startWithDelegate:(id<NetworkTransportDelegate>)newDelegate {
+
+	delegate = newDelegate;
+
+}
+
+/*
+ Called on the receiving transport when a packet sent by one of it's peers arrives. The packet is an array of
+ the data and the transport which sent it. Packets from a transport which has since disconnected are dropped.
+ */
+- (void)deliverPacket:(NSArray *)packet {
+
+	LoopbackTransport *sender = [packet objectAtIndex:1];
+
+	if ([self indexOfPeer:sender] >= 0) {
+		[delegate transport:self receivedData:[packet objectAtIndex:0] fromPeer:sender.peerID];
+	}
+
+}
+
+/*
+ Sends a packet to a single peer under the conditions of this transport.
+ */
+- (void)sendData:(NSData *)data toPeer:(LoopbackTransport *)peer reliable:(BOOL)reliable {
+
+	if (!reliable && [self nextRandomFraction] < conditions.lossRate) {
+		return;
+	}
+
+	NSTimeInterval delay = conditions.latency + ((([self nextRandomFraction] * 2.0) - 1.0) * conditions.jitter);
+
+	if (delay < 0) {
+		delay = 0;
+	}
+
+	if (reliable) {
+
+		/*
+		 A reliable packet is never delivered before a reliable packet sent earlier.
+		 */
+		NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+
+		if (now + delay < lastReliableDeliveryTime) {
+			delay = lastReliableDeliveryTime - now;
+		}
+
+		lastReliableDeliveryTime = now + delay;
+
+	} else if ([self nextRandomFraction] < conditions.reorderRate) {
+
+		delay += conditions.latency + conditions.jitter;
+
+	}
+
+	/*
+	 The data is copied because the sender may reuse it's buffer.
+	 */
+	NSArray *packet = [NSArray arrayWithObjects:[[data copy] autorelease], self, nil];
+	
+	[peer performSelector:@selector(deliverPacket:) withObject:packet afterDelay:delay];
+
+}
+
+- (void)sendData:(NSData *)data toPeers:(NSArray *)peerIDs reliable:(BOOL)reliable {
+
+	for (int i = 0; i < numberOfPeers; i++) {
+
+		if ([peerIDs containsObject:peers[i].peerID]) {
+			[self sendData:data toPeer:peers[i] reliable:reliable];
+		}
+
+	}
+
+}
+
+/*
+ Called on each peer when the transport specified is stopped.
+ */
+- (void)peerStopped:(LoopbackTransport *)stoppedPeer {
+
+	NSString *disconnectedPeerID = [[stoppedPeer.peerID retain] autorelease];
+
+	[self removePeer:stoppedPeer];
+	[delegate transport:self peerDisconnected:disconnectedPeerID];
+
+}
+
+- (void)stop {
+
+	delegate = nil;
+	[NSObject cancelPreviousPerformRequestsWithTarget:self];
+
+	while (numberOfPeers > 0) {
+
+		LoopbackTransport *stoppedPeer = peers[numberOfPeers - 1];
+		numberOfPeers--;
+		[stoppedPeer peerStopped:self];
+
+	}
+
+}
+
+- (void)dealloc {
+
+	[self stop];
+	[peerID release];
+	[super dealloc];
+
+}
+
+@end
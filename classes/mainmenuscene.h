@@ -14,8 +14,9 @@
 #import <Foundation/Foundation.h>
 #import <GameKit/GameKit.h>
 #import "cocos2d.h"
+#import "BluetoothCommsManager.h"
 
-@interface MainMenuLayer : CCLayer <GKPeerPickerControllerDelegate, UIAlertViewDelegate> {
+@interface MainMenuLayer : CCLayer <GKPeerPickerControllerDelegate, UIAlertViewDelegate, NetworkEventHandler> {
 	
 	/*
 	 Container for the sprites which are shown in this view. Used to improve performance 
@@ -134,20 +134,14 @@
 }
 
 /*
- Called when the Multiplayer Button is pressed. Registers the main menu to receive notifications
- from the BluetoothCommsManager through the NSNotificationCenter.
+ Called when the Multiplayer Button is pressed. Sets the main menu as the BluetoothCommsManager's eventHandler.
  */
 - (void)newMultiplayerGame {
 	
 	/*
-	 NSNotificationCenter is an implementation of the Observer design pattern provided by iOS. The main menu is registered
-	 to receive NSNotification instances which are posted to the NSNotificationCenter from the BluetoothCommsManager, at
-	 which point the processBluetoothNotification is called.
+	 Network events posted by the BluetoothCommsManager are passed to the processNetworkEvent method once per frame.
 	 */
-	[[NSNotificationCenter defaultCenter] addObserver:self 
-											 selector:@selector(processBluetoothNotification:) 
-												 name:nil 
-											   object:[BluetoothCommsManager sharedInstance]];
+	[BluetoothCommsManager sharedInstance].eventHandler = self;
 	
 	/*
 	 Instantiate the peer picker, which is shown on top of the Main Menu with this class as it's delegate. The peer picker
@@ -206,13 +200,13 @@
 }
 
 /*
- Called when a transition out of this layer is over. Removes this layer as an observer in the 
- NSNotificationCenter before it it deallocated.
+ Called when a transition out of this layer is over. Stops this layer receiving network events before it
+ is deallocated.
  */
 - (void)onExit {
 	
 	[super onExit];
-	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
 	
 }
 
@@ -235,8 +229,8 @@
 
 /*
  Called when the peer picker is cancelled. Releases the picker, notifies the 
- BluetoothCommsManager to clear up the session and removes the main menu layer
- as an observer on the NSNotificationCenter.
+ BluetoothCommsManager to clear up the session and stops the main menu layer
+ receiving network events.
  */
 - (void)peerPickerControllerDidCancel:(GKPeerPickerController *)picker {
 
@@ -245,7 +239,7 @@
 	
 	[[BluetoothCommsManager sharedInstance] clearUpSession];
 	
-	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
 	
 }
 
@@ -276,15 +270,10 @@
 
 	/*
 	 Add the ID of the peer connected to the BluetoothCommsManager's list so that it can send information to them.
+	 The BluetoothCommsManager's transport then becomes the delegate and data receive handler of the session in order
+	 to receive data packets sent to the device across the network.
 	 */
-	[manager.peerIDs addObject:peerID]; 
-	
-	/*
-	 The BluetoothCommsManager is set as the delegate and data receive handler of the session in order to receive data 
-	 packets sent to the device across the network.
-	 */
-	session.delegate = manager;
-	[session setDataReceiveHandler:manager withContext:NULL];
+	[manager connectToPeer:peerID];
 	
 	/*
 	 The peer picker is removed from view and released.
@@ -302,7 +291,7 @@
 	
 	/*
 	 The sendNewDieRollPacket method in the BluetoothCommsManager begins the process for determining the player ID 
-	 of each device. When this process is finished a DieRollFinished notification is received in the processBluetoothNotification 
+	 of each device. When this process is finished a DieRollFinished event is received in the processNetworkEvent 
 	 method of this layer. 
 	 */
 	[[BluetoothCommsManager sharedInstance] sendNewDieRollPacket];
@@ -325,38 +314,54 @@
 }
 	 
 /*
- Called by the NSNotificationCenter when this class is registered as an observer of the BluetoothCommsManager.
- This method reacts to the notifications posted by the BluetoothCommsManager.
+ Called by the BluetoothCommsManager once per frame for each event posted while this layer is it's eventHandler.
  */
-- (void)processBluetoothNotification:(NSNotification *)notification {
+- (void)processNetworkEvent:(const NetworkEvent *)event {
 	 
 	/*
-	 A SessionFailedWithError notification is a fatal occurence for the bluetooth connection.
-	 An alert is shown to the user explaining the situation and then the main menu is removed as an observer.
-	 The same goes for the PeerWasDisconnected notification.
+	 A SessionFailed event is a fatal occurence for the bluetooth connection.
+	 An alert is shown to the user explaining the situation and then the main menu stops receiving events.
+	 The same goes for the PeerDisconnected event.
 	 */
-	 if(notification.name == SessionFailedWithError) {
-		 
-		 [self showAlertViewWithTitle:@"Connection Error" 
-							  message:@"Failed to establish a connection."];
-		 [[NSNotificationCenter defaultCenter] removeObserver:self];
-		 
-	 } else if(notification.name == PeerWasDisconnected) {
-		 
-		 [self showAlertViewWithTitle:@"Connection Error" 
-							  message:@"The connection has been lost."];
-		 [[NSNotificationCenter defaultCenter] removeObserver:self];
-		 
-	 } else if(notification.name == DieRollFinished) {
-		 
-		 /*
-		  This notification indicates that the die roll process is now complete and the device has a playerID. 
-		  Therefore the showGameOptionsScene method is called to show the MultiplayerGameOptionsLayer.
-		  */
-		 AberFighterAppDelegate *delegate = (AberFighterAppDelegate *)[UIApplication sharedApplication].delegate;
-		 [delegate showGameOptionsScene];
-		 
-	 }
+	switch (event->type) {
+		
+		case kNetworkEventSessionFailed: {
+			
+			[self showAlertViewWithTitle:@"Connection Error" 
+								 message:@"Failed to establish a connection."];
+			[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
+			
+		}
+		break;
+		
+		case kNetworkEventPeerDisconnected: {
+			
+			[self showAlertViewWithTitle:@"Connection Error" 
+								 message:@"The connection has been lost."];
+			[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
+			
+		}
+		break;
+		
+		case kNetworkEventDieRollFinished: {
+			
+			/*
+			 This event indicates that the die roll process is now complete and the device has a playerID. 
+			 The number of players it decided is kept for the scores, then the showGameOptionsScene method is
+			 called to show the MultiplayerGameOptionsLayer.
+			 */
+			[GameState sharedState].numberOfPlayers = [BluetoothCommsManager sharedInstance].numberOfPlayers;
+			
+			AberFighterAppDelegate *delegate = (AberFighterAppDelegate *)[UIApplication sharedApplication].delegate;
+			[delegate showGameOptionsScene];
+			
+		}
+		break;
+		
+		default:
+		break;
+		
+	}
 	
 }
 
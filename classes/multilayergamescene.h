@@ -19,6 +19,7 @@
 #import "cocos2d.h"
 #import "UserInterfaceLayer.h"
 #import "ActionLayer.h"
+#import "GameConstants.h"
 
 /*
  These are the tags which represent the sublayers within this layer. These are used so that the
@@ -31,9 +32,9 @@ typedef enum SublayerTags {
 
 /*
  This constant indicates the y position that all components located on the
- Heads Up Display should have.
+ Heads Up Display should have, which is the middle of the HUD.
  */
-#define kHUD_Y_POSITION 10
+#define kHUD_Y_POSITION (kGameHUDHeight / 2)
 
 @interface MultilayerGameScene : CCLayer {
 
@@ -7,19 +7,111 @@
 //
 /*
  The MultiplayerActionLayer configures the functionality available in the ActionLayer for a multiplayer game.
+ There is a ship for each of the players decided by the die roll, and every ship other than the local one is
+ moved by the directional data received from it's player.
  */
 
 #import <Foundation/Foundation.h>
 #import "cocos2d.h"
 #import "ActionLayer.h"
+#import "SnapshotBuffer.h"
+#import "LinkEstimator.h"
+#import "BluetoothCommsManager.h"
+#import "RollbackSession.h"
+#import "ReplayFile.h"
 
-@interface MultiplayerActionLayer : ActionLayer <UIAlertViewDelegate> {
+/*
+ Each peer player is drawn kPeerSnapshotInterpolationDelay seconds in the past so that it can be interpolated
+ between the directional data received either side of that time. The delay covers two send intervals, so a
+ single lost packet doesn't interrupt the interpolation. This is the initial delay, it is adjusted as the
+ rate the peer's data arrives at changes.
+ */
+#define kPeerSnapshotInterpolationDelay		(2.0 / kLinkEstimatorInitialSendRate)
+//Longest time the peer player is moved on by it's heading and speed when directional data stops arriving.
+#define kPeerSnapshotMaximumExtrapolation	0.25
+//Time over which a jump in the peer player's position is smoothed out.
+#define kPeerSnapshotCorrectionTime			0.1
+
+/*
+ Both devices spawn the same targets from the match seed instead of player 1 sending every spawn. Spawning is
+ decided on ticks of the match clock, kSpawnTicksPerSecond a second as with the gameLogic method, and every
+ kSpawnChecksumInterval ticks a checksum of the targets spawned so far is exchanged to detect divergence. The
+ checksums of the last kSpawnChecksumHistorySize checkpoints are kept for comparing with the peers'.
+ */
+#define kSpawnTicksPerSecond				10
+#define kSpawnChecksumInterval				50
+#define kSpawnChecksumHistorySize			4
+
+/*
+ When kMultiplayerRollbackEnabled is 1 the game is played as a rollback game. Rather than sending the local
+ ship's position and projectiles, each device sends it's inputs and runs the same Simulation through a
+ RollbackSession, and the sprites only show the state of the simulation. The setting changes what is sent,
+ so both devices must be built with the same value. Rollback games are only played by two players, games with
+ more players send positions whatever the setting.
+ */
+#define kMultiplayerRollbackEnabled			0
+//Most simulation frames run in one drawn frame, so the game doesn't race to catch up after a slow frame.
+#define kRollbackMaximumFramesPerUpdate		4
+/*
+ When kRollbackRecordReplays is 1 every rollback game is recorded to a replay file in the app's Documents
+ directory, which can be played back by a ReplayPlayer.
+ */
+#define kRollbackRecordReplays				0
+
+@interface MultiplayerActionLayer : ActionLayer <UIAlertViewDelegate, NetworkEventHandler> {
+	
+	/*
+	 The PlayerShips which represent the peer players, by PlayerID - 1. The entry for the local player, and for
+	 players who aren't in the game, is nil. They are used for applying directional data received over the
+	 network to their state.
+	 */
+	PlayerShip *peerPlayers[kMaximumNumberOfPlayers];
+	
+	/*
+	 Directional data received for each peer player, used to calculate where it is drawn each frame.
+	 */
+	SnapshotBuffer peerSnapshots[kMaximumNumberOfPlayers];
+	
+	/*
+	 matchSeed is the spawn seed agreed in the die roll. spawnTick is the last tick of the match clock on which
+	 spawning has been decided and spawnChecksum the checksum of every spawn up to it.
+	 */
+	uint32_t matchSeed;
+	uint32_t spawnTick;
+	uint32_t spawnChecksum;
+	
+	/*
+	 Local checksums at the most recent checkpoints, and a checksum from each peer for a checkpoint which hasn't
+	 been reached locally yet, by PlayerID - 1.
+	 */
+	uint32_t spawnChecksumTicks[kSpawnChecksumHistorySize];
+	uint32_t spawnChecksums[kSpawnChecksumHistorySize];
+	BOOL peerSpawnChecksumPending[kMaximumNumberOfPlayers];
+	uint32_t peerSpawnChecksumTick[kMaximumNumberOfPlayers];
+	uint32_t peerSpawnChecksum[kMaximumNumberOfPlayers];
+	BOOL spawnDivergenceDetected;
+	
+	/*
+	 Time the local player's directional data was last sent. Directional data is sent at most once every
+	 directionalDataSendInterval of the BluetoothCommsManager rather than every time the accelerometer fires.
+	 The peer interpolates between the packets, so it's ship still moves smoothly.
+	 */
+	NSTimeInterval lastDirectionalDataSendTime;
+	
+	/*
+	 The session which runs a rollback game, or NULL when ship positions are sent instead. rollbackTime is
+	 the time which hasn't been simulated yet, and rollbackFirePending is set when the fire button is pressed
+	 until the next frame is simulated.
+	 */
+	RollbackSession *rollbackSession;
+	ccTime rollbackTime;
+	BOOL rollbackFirePending;
 	
 	/*
-	 This is a pointer to the instance of PlayerShip which represents the peer player.
-	 It is used for applying directional data received over the network to it's state.
+	 Records the rollback game, or NULL if it isn't being recorded. Frames are recorded once they are confirmed,
+	 so the recording only holds the game both devices agree on.
 	 */
-	PlayerShip *peerPlayer;
+	ReplayRecorder *replayRecorder;
 	
 	/*
 	 These booleans indicate the readiness of both ActionLayers to start the game. Only 
@@ -37,18 +129,39 @@
 }
 
 /*
- Readonly pointers to readiness booleans and PlayerShip peer player.
+ Readonly pointers to readiness booleans.
  Also a property which retains the alertView when it is set.
  */
-@property (readonly) PlayerShip *peerPlayer;
 @property (nonatomic,readonly) BOOL localActionLayerReady;
 @property (nonatomic,readonly) BOOL peerActionLayerReady;
 @property (nonatomic, retain) UIAlertView *alertView;
+//Set when a spawn checksum from a peer doesn't match the local one.
+@property (nonatomic, readonly) BOOL spawnDivergenceDetected;
+//How often the predictions of the peer's input were wrong in a rollback game. All 0 in other games.
+@property (nonatomic, readonly) RollbackStatistics rollbackStatistics;
+
+/*
+ Returns the ship of the peer player with the PlayerID specified, or nil if there isn't one.
+ */
+- (PlayerShip *)peerPlayerWithID:(PlayerIdentifier)player;
+
+/*
+ Compares a spawn checksum received from a peer with the local checksum for the same tick. If the tick
+ hasn't been reached locally the checksum is kept until it is.
+ */
+- (void)comparePeerSpawnChecksum:(uint32_t)checksum forTick:(uint32_t)tick fromPlayer:(PlayerIdentifier)player;
+
+/*
+ Adds directional data received from a peer to it's player's snapshot buffer. The peer player is moved to the
+ position calculated from the buffer at the start of each frame. receiveTime is when the packet arrived,
+ which may be earlier in the frame than it is applied. Ignored if the player has no ship.
+ */
+- (void)addPeerSnapshotWithHeading:(float)heading speed:(float)speed position:(CGPoint)position rotation:(float)rotation sentAt:(uint16_t)sendTime receivedAt:(NSTimeInterval)receiveTime fromPlayer:(PlayerIdentifier)player;
 
 /*
- This method retrieves a TargetShip from the ReusableTargetPool, configures it with the 
- parameters specified and adds it to the layer.
+ Adds the inputs received from the peer to the rollback session. The frames they change are simulated again
+ at the start of the next frame. Ignored if this isn't a rollback game.
  */
-- (void)spawnTargetWithType:(TargetType)targetType heading:(float)heading startingPosition:(CGPoint)startingPosition;
+- (void)addPeerRollbackInputs:(const RollbackInputMessage *)message;
 
 @end
@@ -15,55 +15,191 @@
 
 @implementation MultiplayerActionLayer
 
-@synthesize peerPlayer;
 @synthesize localActionLayerReady;
 @synthesize peerActionLayerReady;
 @synthesize alertView;
+@synthesize spawnDivergenceDetected;
 
 /*
- Used for creating a PlayerShip instance to represent the local player and peer player. Initializes the
- playerShips array and adds the local player to it.
+ Players 1 and 2 start on the left and right facing each other, as they always have. Players 3 and 4 start at
+ the top and bottom facing the middle.
+ */
+- (CGPoint)startingPositionForPlayer:(int)player heading:(float *)heading {
+	
+	CGSize winSize = [CCDirector sharedDirector].winSize;
+	float playAreaHeight = winSize.height - (kHUD_Y_POSITION * 2);
+	
+	switch (player) {
+			
+		case kPlayer1:
+			*heading = 90.0f;
+			return ccp(kPLAYER_START_POSITION, (playAreaHeight / 2));
+			
+		case kPlayer2:
+			*heading = 270.0f;
+			return ccp((winSize.width - kPLAYER_START_POSITION), (playAreaHeight / 2));
+			
+		case kPlayer3:
+			*heading = 180.0f;
+			return ccp((winSize.width / 2), (playAreaHeight - kPLAYER_START_POSITION));
+			
+		default:
+			*heading = 0.0f;
+			return ccp((winSize.width / 2), kPLAYER_START_POSITION);
+			
+	}
+	
+}
+
+/*
+ Used for creating a PlayerShip instance to represent the local player and each peer player. Initializes the
+ playerShips array and adds every ship to it.
  */
 - (void)setUpPlayerShips {
 	
+	BluetoothCommsManager *commsManager = [BluetoothCommsManager sharedInstance];
+	int numberOfPlayers = MAX(commsManager.numberOfPlayers, 2);
+	
+	self.playerShips = [[NSMutableArray alloc] init];
+	
+	for (int player = kPlayer1; player <= numberOfPlayers; player++) {
+		
+		float heading;
+		CGPoint startingPosition = [self startingPositionForPlayer:player heading:&heading];
+		
+		PlayerShip *ship = [self createPlayerShipWithSpriteFrameName:[PlayerShip spriteFrameNameForPlayer:player]
+															position:startingPosition
+															 heading:heading
+														maximumSpeed:kDefaultNetworkGameMaximumSpeed];
+		ship.playerID = player;
+		ship.color = [PlayerShip tintForPlayer:player];
+		
+		if (player == commsManager.playerID) {
+			localPlayer = ship;
+		} else {
+			peerPlayers[player - 1] = ship;
+		}
+		
+		[self.spriteSheet addChild:ship];
+		[self.playerShips addObject:ship];
+		
+	}
+	
+}
+
+- (PlayerShip *)peerPlayerWithID:(PlayerIdentifier)player {
+	
+	if (player < kPlayer1 || player > kMaximumNumberOfPlayers) {
+		return nil;
+	}
+	
+	return peerPlayers[player - 1];
+	
+}
+
+/*
+ Creates the session for a rollback game. The simulation uses the game length chosen in the options and the
+ seed agreed in the die roll, and the local player's index in it follows their PlayerID.
+ */
+- (void)setUpRollbackSession {
+	
 	CGSize winSize = [CCDirector sharedDirector].winSize;
+	SimulationConfig config;
+	
+	SimulationConfigDefaults(&config, 2);
+	config.gameLength = [GameState sharedState].gameLength;
+	config.worldWidth = winSize.width;
+	config.worldHeight = winSize.height;
+	
+	rollbackSession = RollbackSessionNew(&config, matchSeed, [BluetoothCommsManager sharedInstance].playerID - 1);
+	rollbackTime = 0;
+	rollbackFirePending = NO;
+	
+	NSAssert(rollbackSession != NULL, @"MultiplayerActionLayer: not enough memory for the rollback session");
+	
+#if kRollbackRecordReplays
+	[self startReplayRecording];
+#endif
+	
+}
+
+/*
+ Creates the replay file for the rollback game, named after the time the game started. The game is played
+ without being recorded if the file can't be created.
+ */
+- (void)startReplayRecording {
 	
-	CGPoint player1StartingPosition = ccp(kPLAYER_START_POSITION, 
-										  ((winSize.height - (kHUD_Y_POSITION * 2)) / 2)); 
+	NSArray *paths = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
+	NSDateFormatter *formatter = [[NSDateFormatter alloc] init];
 	
-	CGPoint player2StartingPosition = ccp((winSize.width - kPLAYER_START_POSITION), 
-										  ((winSize.height - (kHUD_Y_POSITION * 2)) / 2));
+	[formatter setDateFormat:@"yyyy-MM-dd HH.mm.ss"];
+	NSString *fileName = [NSString stringWithFormat:@"Replay %@.afreplay", [formatter stringFromDate:[NSDate date]]];
+	[formatter release];
 	
-	PlayerShip *player1Ship = [self createPlayerShipWithSpriteFrameName:@"ship_1.png" 
-															   position:player1StartingPosition 
-																heading:90.0f 
-														   maximumSpeed:kDefaultNetworkGameMaximumSpeed];
-	player1Ship.playerID = kPlayer1;
+	NSString *path = [[paths objectAtIndex:0] stringByAppendingPathComponent:fileName];
 	
-	PlayerShip *player2Ship = [self createPlayerShipWithSpriteFrameName:@"ship_2.png"
-															   position:player2StartingPosition 
-																heading:270.0f 
-														   maximumSpeed:kDefaultNetworkGameMaximumSpeed];
-	player2Ship.playerID = kPlayer2;
+	replayRecorder = ReplayRecorderOpen([path fileSystemRepresentation], &rollbackSession->simulation->config, matchSeed);
 	
-	if ([BluetoothCommsManager sharedInstance].playerID == kPlayer1) {
+	if (replayRecorder == NULL) {
+		NSLog(@"Replay file %@ could not be created", path);
+	}
+	
+}
+
+/*
+ Adds the frames which have been confirmed since the last call to the replay file, with a keyframe whenever
+ one is due. Only frames before the confirmed frame are recorded, whose inputs and saved states are final.
+ The session carries on through frames after the game is over while it waits for the peer, but those don't
+ change the simulation, whose tick stops at the end of the game, so they aren't recorded.
+ */
+- (void)recordConfirmedRollbackFrames {
+	
+	uint32_t lastFrame = MIN(RollbackSessionConfirmedFrame(rollbackSession), rollbackSession->simulation->tick);
+	SimulationInput inputs[kSimulationMaximumPlayers];
+	
+	while (replayRecorder->frameCount < lastFrame) {
 		
-		localPlayer = player1Ship;
-		peerPlayer = player2Ship;
+		uint32_t frame = replayRecorder->frameCount;
 		
-	} else {
+		if (ReplayRecorderKeyframeDue(replayRecorder)) {
+			
+			size_t length;
+			const void *state = RollbackSessionSavedState(rollbackSession, frame, &length);
+			
+			if (state != NULL) {
+				ReplayRecorderAddKeyframe(replayRecorder, state, length);
+			}
+			
+		}
+		
+		if (!RollbackSessionFrameInputs(rollbackSession, frame, inputs)) {
+			break;
+		}
 		
-		localPlayer = player2Ship;
-		peerPlayer = player1Ship;
+		ReplayRecorderAddFrame(replayRecorder, inputs);
 		
 	}
+	
+}
 
-	[self.spriteSheet addChild:player1Ship];
-	[self.spriteSheet addChild:player2Ship];
+/*
+ Records the last confirmed frames and closes the replay file. The result of the game is only written if
+ every frame was confirmed, so a game which ended with the peer's inputs missing can be played back but not
+ verified.
+ */
+- (void)finishReplayRecording {
 	
-	self.playerShips = [[NSMutableArray alloc] init];
-	[self.playerShips addObject:player1Ship];
-	[self.playerShips addObject:player2Ship];
+	if (replayRecorder == NULL) {
+		return;
+	}
+	
+	[self recordConfirmedRollbackFrames];
+	
+	if (!ReplayRecorderClose(replayRecorder, rollbackSession->simulation)) {
+		NSLog(@"Replay file could not be written");
+	}
+	
+	replayRecorder = NULL;
 	
 }
 
@@ -82,24 +218,49 @@
 		localActionLayerReady = NO;
 		peerActionLayerReady = NO;
 		
+		for (int i = 0; i < kMaximumNumberOfPlayers; i++) {
+			
+			SnapshotBufferInit(&peerSnapshots[i], 
+							   kPeerSnapshotInterpolationDelay, 
+							   kPeerSnapshotMaximumExtrapolation, 
+							   kPeerSnapshotCorrectionTime);
+			
+		}
+		
+		lastDirectionalDataSendTime = 0;
+		
+		/*
+		 Targets are spawned from the seed agreed with the peer rather than the random seed set by the superclass.
+		 */
+		matchSeed = [BluetoothCommsManager sharedInstance].matchSeed;
+		spawnTick = 0;
+		spawnChecksum = kSimulationHashOffsetBasis;
+		memset(spawnChecksumTicks, 0, sizeof(spawnChecksumTicks));
+		memset(spawnChecksums, 0, sizeof(spawnChecksums));
+		memset(peerSpawnChecksumPending, 0, sizeof(peerSpawnChecksumPending));
+		spawnDivergenceDetected = NO;
+		
+#if kMultiplayerRollbackEnabled
+		if ([BluetoothCommsManager sharedInstance].numberOfPlayers == 2) {
+			[self setUpRollbackSession];
+		}
+#endif
+		
 	}
 	
 	return self;
 }
 
 /*
- Called after a transition to this layer is complete. The layer is setup as an observer of the 
- BluetoothCommsManager through the NSNotificationCenter. Then if the game is starting an ActionLayerReadyPacket
+ Called after a transition to this layer is complete. The layer is set as the BluetoothCommsManager's
+ eventHandler. Then if the game is starting an ActionLayerReadyPacket
  is sent to the peer device. Otherwise the game is just resumed.
  */
 - (void)onEnter {
 
 	[super onEnter];
 	
-	[[NSNotificationCenter defaultCenter] addObserver:self 
-											 selector:@selector(processBluetoothNotification:) 
-												 name:nil 
-											   object:[BluetoothCommsManager sharedInstance]];
+	[BluetoothCommsManager sharedInstance].eventHandler = self;
 	
 	if ([GameState sharedState].currentState == kGameStarting) {
 		
@@ -114,14 +275,14 @@
 }
 
 /*
- Called when a transition out of this layer is over. Removes this layer as an observer in the 
- NSNotificationCenter before it it deallocated.
+ Called when a transition out of this layer is over. Stops this layer receiving network events before it
+ is deallocated.
  */
 - (void)onExit {
 
 	[super onExit];
 	
-	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
 	
 }
 
@@ -147,6 +308,20 @@
  */
 - (void)fireProjectile {
 	
+	/*
+	 In a rollback game pressing fire is part of the input for the next simulation frame. The simulation
+	 decides where the projectile starts, and ignores it if the ship is disabled by then.
+	 */
+	if (rollbackSession != NULL) {
+		
+		if ([GameState sharedState].currentState == kGameRunning) {
+			rollbackFirePending = YES;
+		}
+		
+		return;
+		
+	}
+	
 	/*
 	 If the local player's ship is currently disabled then firing weapons is not permitted.
 	 It is also not permitted for projectiles to be fired when the game start countdown is taking place, 
@@ -210,113 +385,480 @@
 }
 
 /*
- This method retrieves a TargetShip from the ReusableTargetPool, configures it with the 
- parameters specified and adds it to the layer. This is used for when spawning information
- arrives over the network.
+ Spawns the target for a tick of the match clock. The spawn random is seeded from the match seed and the tick,
+ so each spawn only depends on when it happens and not on what was spawned before it. The spawn is added to
+ spawnChecksum along with whether the target could be added to the layer.
  */
-- (void)spawnTargetWithType:(TargetType)targetType heading:(float)heading startingPosition:(CGPoint)startingPosition {
-
+- (void)spawnTargetOnTick:(uint32_t)tick {
+	
+	[self seedSpawnRandom:(matchSeed + tick * 2654435761u)];
+	
+	int targetShipType = [self determineSpawnedTargetType];
+	int32_t spawnRecord[6] = {tick, targetShipType, 0, 0, 0, 0};
+	
+	/*
+	 The ReusableTargetPool grows in the background, so whether it has a target available at this moment is
+	 different on each device. Both devices must spawn on the same ticks, so the pool is made to create a
+	 target now if it has none available, rather than the spawn being skipped as in a single player game.
+	 */
+	ReusableTargetPool *targetPool = [ReusableTargetPool sharedInstance];
+	
+	[targetPool reserveTargetShipsWithType:targetShipType count:1];
+	
+	TargetShip *newTarget = [targetPool acquireTargetShipWithType:targetShipType];
+	NSAssert(newTarget != nil, @"MultiplayerActionLayer: no target available after reserving one");
+	
+	[newTarget generateStartingPositionAndHeadingWithRandom:&spawnRandom];
+	
+	/*
+	 The spawn is checksummed as it would be sent over the network, so that the checksum doesn't depend
+	 on the last bit of a floating point calculation.
+	 */
+	spawnRecord[3] = WireQuantizePosition(newTarget.position.x);
+	spawnRecord[4] = WireQuantizePosition(newTarget.position.y);
+	spawnRecord[5] = WireQuantizeHeading(newTarget.currentHeading);
+	
 	/*
-	 A TargetShip instance of the specified type is requested from the ReusableTargetPool. If one is
-	 available, a reference will be returned. Otherwise the pool will return nil. In this is the case no target
-	 will be spawned during this iteration. 
+	 Add the new target ship to the layer. From now on it's movement will be handled by the nextFrame method.
+	 The target is only missing if the memory for it couldn't be found, which the checksum will report.
 	 */
-	TargetShip *newTarget = [[ReusableTargetPool sharedInstance] acquireTargetShipWithType:targetType];
-	if (newTarget != nil) {
+	if ([self addActiveTarget:newTarget]) {
+		spawnRecord[2] = 1;
+	}
+	
+	/*
+	 The newTarget has been retained by adding it to both the spritesheet and the activeTargets list. 
+	 Therefore this reference can be set to nil without losing the auto-release object.
+	 */
+	newTarget = nil;
+	
+	spawnChecksum = SimulationHash(spawnChecksum, spawnRecord, sizeof(spawnRecord));
+	
+}
+
+/*
+ Stores the local spawn checksum for the checkpoint at spawnTick and sends it to the peers. If a peer's
+ checksum for the checkpoint arrived first they are compared now.
+ */
+- (void)recordSpawnChecksumCheckpoint {
+	
+	unsigned int slot = (spawnTick / kSpawnChecksumInterval) % kSpawnChecksumHistorySize;
+	
+	spawnChecksumTicks[slot] = spawnTick;
+	spawnChecksums[slot] = spawnChecksum;
+	
+	[[BluetoothCommsManager sharedInstance] sendSpawnChecksum:spawnChecksum forTick:spawnTick];
+	
+	for (int i = 0; i < kMaximumNumberOfPlayers; i++) {
 		
-		[newTarget spawnWithHeading:heading startingPosition:startingPosition];
+		if (peerSpawnChecksumPending[i] && peerSpawnChecksumTick[i] == spawnTick) {
+			
+			peerSpawnChecksumPending[i] = NO;
+			[self comparePeerSpawnChecksum:peerSpawnChecksum[i] forTick:peerSpawnChecksumTick[i] fromPlayer:i + 1];
+			
+		}
 		
-		/*
-		 Add the new target ship to the activeTargets list and the spritesheet. From now on it's movement
-		 will be handled by calls to it's updatePosition method from the nextFrame method below.   
-		 */
-		[self.activeTargets addObject:newTarget];
-		[self.spriteSheet addChild:newTarget];
+	}
+	
+}
+
+- (void)comparePeerSpawnChecksum:(uint32_t)checksum forTick:(uint32_t)tick fromPlayer:(PlayerIdentifier)player {
+	
+	if (player < kPlayer1 || player > kMaximumNumberOfPlayers) {
+		return;
+	}
+	
+	if (tick > spawnTick) {
 		
-		/*
-		 The newTarget has been retained by adding it to both the spritesheet and the activeTargets list. 
-		 Therefore this reference can be set to nil without losing the auto-release object.
-		 */
-		newTarget = nil;
+		peerSpawnChecksumPending[player - 1] = YES;
+		peerSpawnChecksumTick[player - 1] = tick;
+		peerSpawnChecksum[player - 1] = checksum;
+		return;
+		
+	}
+	
+	unsigned int slot = (tick / kSpawnChecksumInterval) % kSpawnChecksumHistorySize;
+	
+	if (spawnChecksumTicks[slot] == tick && spawnChecksums[slot] != checksum) {
+		
+		spawnDivergenceDetected = YES;
+		NSLog(@"Target spawning diverged from player %d by match tick %u", player, tick);
 		
 	}
 	
 }
 
 /*
- This method is called from the gameLogic method when the spawnRate has been reached.
- It acquires a target of a random type from the ReusableTargetPool, configures it
- and adds it to the layer.
+ Overrides checkTargetSpawningSituation so that spawning is decided on ticks of the match clock rather than
+ whenever gameLogic happens to be called. Every tick which has passed since the last call is processed, so
+ both devices make the same decisions even though their gameLogic calls don't line up. The game time
+ remaining ratio is worked out from the tick rather than taken from the timer method for the same reason.
  */
-- (void) spawnTarget {
+- (void)checkTargetSpawningSituation {
 	
-	int targetShipType = [self determineSpawnedTargetType];	
+	uint32_t currentTick = (uint32_t)(matchTime * kSpawnTicksPerSecond);
+	int gameLength = [GameState sharedState].gameLength;
+	
+	while (spawnTick < currentTick) {
+		
+		spawnTick++;
+		
+		double tickTime = (double)spawnTick / kSpawnTicksPerSecond;
+		int gameTimeElapsed = spawnTick / kSpawnTicksPerSecond;
+		float remainingRatio = (gameTimeElapsed < gameLength) ? (float)(gameLength - gameTimeElapsed) / (float)gameLength : 0.0f;
+		double spawnRate = SimulationSpawnInterval(kMaximumSpawnRate, kSpawnRateModifier, remainingRatio);
+		
+		if (self.previousTimeTargetSpawned == 0 || (tickTime - self.previousTimeTargetSpawned) >= spawnRate) {
+			
+			[self spawnTargetOnTick:spawnTick];
+			self.previousTimeTargetSpawned = tickTime;
+			
+		}
+		
+		if (spawnTick % kSpawnChecksumInterval == 0) {
+			
+			[self recordSpawnChecksumCheckpoint];
+			
+		}
+		
+	}
+	
+}
+
+/*
+ Called by the accelerometer to update this class at regular intervals of the current acceleration values.
+ */
+- (void)accelerometer:(UIAccelerometer *)accelerometer didAccelerate:(UIAcceleration *)acceleration {
+	
+	/*
+	 DirectionalChanges are calculated and applied in the superclass call.
+	 The localPlayer's directional data is then sent across the network to update their 
+	 ship on that side. How often it is sent is decided by the BluetoothCommsManager from the quality of the
+	 link, sending less when packets are being lost or delayed.
+	 */
+	[super accelerometer:accelerometer didAccelerate:acceleration];
 	
 	/*
-	 A TargetShip instance of the specified type is requested from the ReusableTargetPool. If one is
-	 available, a reference will be returned. Otherwise the pool will return nil. In this is the case no target
-	 will be spawned during this iteration. 
+	 In a rollback game the heading and speed are sent as part of the input of every frame instead.
 	 */
-	TargetShip *newTarget = [[ReusableTargetPool sharedInstance] acquireTargetShipWithType:targetShipType];
-	if (newTarget != nil) {
+	if (rollbackSession != NULL) {
+		return;
+	}
+	
+	BluetoothCommsManager *commsManager = [BluetoothCommsManager sharedInstance];
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	
+	if ((now - lastDirectionalDataSendTime) >= commsManager.directionalDataSendInterval) {
 		
-		/*
-		 A new target has been acquired. The generateRandomStartingPositionAndHeading method sets the initial 
-		 state of the target ship.
-		 */
-		[newTarget generateRandomStartingPositionAndHeading];
+		lastDirectionalDataSendTime = now;
+		
+		[commsManager sendLocalPlayerShipDirectionalDataWithNewHeading:localPlayer.currentHeading
+															  newSpeed:localPlayer.speed
+													   currentPosition:localPlayer.position
+													   currentRotation:localPlayer.rotation];
+		
+	}
+	
+}
+
+- (void)addPeerSnapshotWithHeading:(float)heading speed:(float)speed position:(CGPoint)position rotation:(float)rotation sentAt:(uint16_t)sendTime receivedAt:(NSTimeInterval)receiveTime fromPlayer:(PlayerIdentifier)player {
+	
+	if ([self peerPlayerWithID:player] == nil) {
+		return;
+	}
+	
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	SnapshotBuffer *snapshots = &peerSnapshots[player - 1];
+	
+	/*
+	 The interpolation delay follows the rate the player's data arrives at, so that it always covers two of
+	 it's send intervals. In a star this is the rate of the link to the hub. The buffer eases each change in
+	 rather than letting the ship jump.
+	 */
+	float peerSendRate = [[BluetoothCommsManager sharedInstance] linkStatisticsForPlayer:player].peerSendRate;
+	
+	if (peerSendRate > 0.0f) {
+		snapshots->interpolationDelay = 2.0 / peerSendRate;
+	}
+	
+	/*
+	 The snapshot is stamped with the time the player's device sampled it, which is read back as the time
+	 nearest the player's clock as the buffer knows it. A hub passes the time on unchanged.
+	 */
+	double sampleTime = WireDequantizeTime(sendTime, SnapshotBufferSenderTime(snapshots, receiveTime));
+	Snapshot snapshot = {sampleTime, position.x, position.y, heading, speed, rotation};
+	
+	SnapshotBufferAdd(snapshots, &snapshot, receiveTime, now);
+	
+}
+
+- (void)addPeerRollbackInputs:(const RollbackInputMessage *)message {
+	
+	if (rollbackSession != NULL) {
+		RollbackSessionAddMessage(rollbackSession, message);
+	}
+	
+}
+
+- (RollbackStatistics)rollbackStatistics {
+	
+	RollbackStatistics statistics;
+	
+	if (rollbackSession != NULL) {
+		statistics = rollbackSession->statistics;
+	} else {
+		memset(&statistics, 0, sizeof(statistics));
+	}
+	
+	return statistics;
+	
+}
+
+/*
+ Makes the active targets match the targets in the rollback simulation. Targets are removed from the
+ simulation by swapping, so rather than following each target the sprites of each type are handed out in
+ order, and targets are only acquired from or released to the ReusableTargetPool when the number of a type
+ changes.
+ */
+- (void)showRollbackTargets:(const EntityStore *)targets {
+	
+	ReusableTargetPool *targetPool = [ReusableTargetPool sharedInstance];
+	NSUInteger nextTarget[kTargetShipTypeCount] = {0, 0};
+	
+	for (unsigned int i = 0; i < targets->count; i++) {
 		
-		[[BluetoothCommsManager sharedInstance] sendTargetSpawnDetailsWithType:targetShipType
-																currentHeading:newTarget.currentHeading
-															  startingPosition:newTarget.position];
+		int type = targets->type[i];
+		TargetShip *target = nil;
 		
 		/*
-		 Add the new target ship to the activeTargets list and the spritesheet. From now on it's movement
-		 will be handled by calls to it's updatePosition method from the nextFrame method below.   
+		 Find the next active target of the type, or acquire a new one if they have all been used.
 		 */
-		[self.activeTargets addObject:newTarget];
-		[self.spriteSheet addChild:newTarget];
+		while (nextTarget[type] < [self.activeTargets count]) {
+			
+			TargetShip *candidate = [self.activeTargets objectAtIndex:nextTarget[type]];
+			nextTarget[type]++;
+			
+			if (candidate.targetType == type) {
+				target = candidate;
+				break;
+			}
+			
+		}
+		
+		if (target == nil) {
+			
+			target = [targetPool acquireTargetShipWithType:type];
+			
+			if (target == nil) {
+				continue;
+			}
+			
+			[target spawnWithHeading:targets->heading[i] startingPosition:ccp(targets->positionX[i], targets->positionY[i])];
+			
+			if (![self addActiveTarget:target]) {
+				continue;
+			}
+			
+			nextTarget[type] = [self.activeTargets count];
+			
+		}
+		
+		target.position = ccp(targets->positionX[i], targets->positionY[i]);
+		target.currentHeading = targets->heading[i];
+		target.rotation = targets->heading[i];
+		target.currentShieldStrength = targets->shield[i];
+		
+	}
+	
+	/*
+	 Every target of a type after the last one used is no longer in the simulation. They are cleared up from
+	 the end of the list so that the indices of the targets before them don't change.
+	 */
+	for (NSUInteger i = [self.activeTargets count]; i > 0; i--) {
+		
+		TargetShip *target = [self.activeTargets objectAtIndex:(i - 1)];
+		
+		if ((i - 1) >= nextTarget[target.targetType]) {
+			[self clearUpSprite:target];
+		}
+		
+	}
+	
+}
+
+/*
+ Moves the sprites to the current state of the rollback simulation, and copies the scores and game time
+ into the GameState and HUD. The simulation decides every collision, so none are detected on the sprites.
+ */
+- (void)showRollbackSimulation {
+	
+	Simulation *simulation = rollbackSession->simulation;
+	
+	for (int i = 0; i < simulation->config.numberOfPlayers; i++) {
+		
+		SimulationPlayer *player = &simulation->players[i];
+		PlayerShip *ship = [self.playerShips objectAtIndex:i];
+		BOOL disabled = (player->disabledTicks > 0);
+		
+		ship.position = ccp(player->x, player->y);
+		ship.rotation = player->heading;
+		ship.currentShieldStrength = player->shieldStrength;
+		[ship setShipDisabled:disabled invincible:(player->invincibleTicks > 0)];
 		
 		/*
-		 The newTarget has been retained by adding it to both the spritesheet and the activeTargets list. 
-		 Therefore this reference can be set to nil without losing the auto-release object.
+		 The local ship's heading and speed are the input for the frames still to come, so they are left alone
+		 unless the ship has been stopped by being disabled.
 		 */
-		newTarget = nil;
+		if (ship != localPlayer) {
+			
+			ship.currentHeading = player->heading;
+			ship.speed = player->speed;
+			
+		} else if (disabled) {
+			
+			ship.speed = 0.0f;
+			
+		}
+		
+	}
+	
+	[self showRollbackTargets:simulation->targets];
+	[self.projectileSystem updateWithEntityStore:simulation->projectiles];
+	
+	[[GameState sharedState] setScore:simulation->players[0].score forPlayer:kPlayer1];
+	[[GameState sharedState] setScore:simulation->players[1].score forPlayer:kPlayer2];
+	
+	if (self.gameTimeRemaining != simulation->gameTimeRemaining) {
+		
+		self.gameTimeRemaining = simulation->gameTimeRemaining;
+		[[MultilayerGameScene sharedScene].userInterfaceLayer updateTimeLabel:self.gameTimeRemaining];
 		
 	}
 	
 }
 
 /*
- Called by the accelerometer to update this class at regular intervals of the current acceleration values.
+ Runs the rollback simulation in fixed frames for the time which has passed, sends the local inputs and
+ shows the result. The local input for each frame is the heading and speed the accelerometer has given
+ the local ship. The game ends once the simulation's time has run out and every frame up to it has been
+ simulated with the peer's real input, or the peer has stopped sending it's input. It also ends if a
+ rollback fails and the simulation is no longer in step with the peer's.
  */
-- (void)accelerometer:(UIAccelerometer *)accelerometer didAccelerate:(UIAcceleration *)acceleration {
+- (void)updateRollbackSession:(ccTime)timeSinceLastCall {
+	
+	BOOL stalled = NO;
+	int framesSimulated = 0;
+	
+	rollbackTime += timeSinceLastCall;
+	
+	while (rollbackTime >= kSimulationTimestep && framesSimulated < kRollbackMaximumFramesPerUpdate) {
+		
+		SimulationInput input = {localPlayer.currentHeading, localPlayer.speed, rollbackFirePending};
+		
+		if (!RollbackSessionAdvance(rollbackSession, &input)) {
+			stalled = YES;
+			break;
+		}
+		
+		rollbackFirePending = NO;
+		rollbackTime -= kSimulationTimestep;
+		framesSimulated++;
+		
+	}
 	
 	/*
-	 DirectionalChanges are calculated and applied in the superclass call.
-	 The localPlayer's directional data is then sent across the network to update their 
-	 ship on that side.
+	 A rollback which couldn't load it's saved state leaves the simulation different from the peer's, and
+	 there's no way back to a state both agree on, so the game is ended rather than played on out of sync.
 	 */
-	[super accelerometer:accelerometer didAccelerate:acceleration];
+	if (rollbackSession->desynchronized) {
+		
+		NSLog(@"Rollback simulation desynchronized at frame %u", rollbackSession->currentFrame);
+		[self finishReplayRecording];
+		[self endGame];
+		return;
+		
+	}
 	
-	[[BluetoothCommsManager sharedInstance] sendLocalPlayerShipDirectionalDataWithNewHeading:localPlayer.currentHeading
-																					newSpeed:localPlayer.speed
-																			 currentPosition:localPlayer.position
-																			 currentRotation:localPlayer.rotation];
+	/*
+	 Time which couldn't be simulated, because the session is waiting for the peer or too many frames were due,
+	 is dropped. A device which is ahead of the peer slows down to it's pace this way.
+	 */
+	if (rollbackTime > kSimulationTimestep) {
+		rollbackTime = kSimulationTimestep;
+	}
+	
+	[[BluetoothCommsManager sharedInstance] sendRollbackInputsFromSession:rollbackSession];
+	
+	if (replayRecorder != NULL) {
+		[self recordConfirmedRollbackFrames];
+	}
+	
+	[self showRollbackSimulation];
+	
+	if (SimulationIsGameOver(rollbackSession->simulation) &&
+		(stalled || RollbackSessionConfirmedFrame(rollbackSession) == rollbackSession->currentFrame)) {
+		
+		[self finishReplayRecording];
+		[self endGame];
+		
+	}
+	
+}
+
+/*
+ Moves each peer player to the position and rotation calculated from the directional data received. The peer
+ players' speed is never set, so updatePlayerShipPositions in nextFrame leaves them where they are placed here.
+ */
+- (void)updatePeerPlayerPositions:(ccTime)timeSinceLastCall {
+	
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	float positionX, positionY, rotation;
+	
+	for (int i = 0; i < kMaximumNumberOfPlayers; i++) {
+		
+		PlayerShip *peerPlayer = peerPlayers[i];
+		
+		if (peerPlayer != nil && SnapshotBufferSample(&peerSnapshots[i], now, timeSinceLastCall,
+													  &positionX, &positionY, &rotation)) {
+			
+			peerPlayer.position = ccp(positionX, positionY);
+			peerPlayer.currentHeading = rotation;
+			peerPlayer.rotation = rotation;
+			
+		}
+		
+	}
 	
 }
 
 /*
- Overrides the nextFrame method in order to perform collision detection between the localPlayer and peerPlayer.
+ Overrides the nextFrame method in order to move the peer players and perform collision detection between the localPlayer and each peer player.
  Once that has been done the rest of the collision detection algorithm runs as normal through a call to the superclass.
+ Finally the messages queued for the peer during the frame are sent. The packets received since the last frame
+ have already been applied by the BluetoothCommsManager, which is updated before any layer in each frame.
  */
 - (void)nextFrame:(ccTime)timeSinceLastCall {
 	
-	if (!localPlayer.shipDisabled) {
+	/*
+	 A rollback game is played entirely by the simulation.
+	 */
+	if (rollbackSession != NULL) {
+		
+		[self updateRollbackSession:timeSinceLastCall];
+		[[BluetoothCommsManager sharedInstance] flushOutboundMessages];
+		return;
 		
-		if (!peerPlayer.shipDisabled) {
+	}
+	
+	[self updatePeerPlayerPositions:timeSinceLastCall];
+	
+	for (int i = 0; i < kMaximumNumberOfPlayers && !localPlayer.shipDisabled; i++) {
+		
+		PlayerShip *peerPlayer = peerPlayers[i];
+		
+		if (peerPlayer != nil && !peerPlayer.shipDisabled) {
 			
-			if ([localPlayer checkCollisionWithCollidableSprite:self.peerPlayer]) {
+			if ([localPlayer checkCollisionWithCollidableSprite:peerPlayer]) {
 		
 				[localPlayer reduceShieldStrength];
 				[peerPlayer reduceShieldStrength];
@@ -328,46 +870,49 @@
 	}
 	
 	[super nextFrame:timeSinceLastCall];
+	
+	/*
+	 Everything queued for the peer during this frame is sent together in a single packet.
+	 */
+	[[BluetoothCommsManager sharedInstance] flushOutboundMessages];
 
 }
 
 /*
- Called 10 times a second. Used for spawning enemies and clearing up enemies which 
- have reached the end of their lifespan.
+ In a rollback game targets are spawned and cleared up, and the game time is counted down, by the simulation.
  */
 - (void)gameLogic:(ccTime)timeSinceLastCall {
-
-	/*
-	 Player 1's device acts as the server for target ship spawning.
-	 */
-	if ([BluetoothCommsManager sharedInstance].playerID == kPlayer1) {
-		
-		[self checkTargetSpawningSituation];
-		
+	
+	if (rollbackSession == NULL) {
+		[super gameLogic:timeSinceLastCall];
 	}
 	
-	[self clearOffscreenTargets];
+}
+
+- (void)timer:(ccTime)timeSinceLastCall {
+	
+	if (rollbackSession == NULL) {
+		[super timer:timeSinceLastCall];
+	}
 	
 }
 
 /*
- The draw method is overridden to update the score labels in the HUD for both players.
+ The draw method is overridden to update the score labels in the HUD. The HUD only has room for two scores, so
+ with more than two players the peer score shown is the best of the other players'.
  */
 - (void)draw {
 
-	int playerID = [BluetoothCommsManager sharedInstance].playerID;
-	int localScore = 0;
+	BluetoothCommsManager *commsManager = [BluetoothCommsManager sharedInstance];
+	GameState *gameState = [GameState sharedState];
+	int localScore = [gameState scoreForPlayer:commsManager.playerID];
 	int peerScore = 0;
 	
-	if (playerID == kPlayer1) {
-		
-		localScore = [GameState sharedState].player1Score;
-		peerScore = [GameState sharedState].player2Score;
+	for (int player = kPlayer1; player <= commsManager.numberOfPlayers; player++) {
 		
-	} else {
-		
-		localScore = [GameState sharedState].player2Score;
-		peerScore = [GameState sharedState].player1Score;
+		if (player != commsManager.playerID) {
+			peerScore = MAX(peerScore, [gameState scoreForPlayer:player]);
+		}
 		
 	}
 	
@@ -448,65 +993,109 @@
 	
 }
 
-- (void)processBluetoothNotification:(NSNotification *)notification {
+/*
+ Called by the BluetoothCommsManager once per frame for each event posted while this layer is it's eventHandler.
+ */
+- (void)processNetworkEvent:(const NetworkEvent *)event {
 	
-	if (notification.name == PeerPausedGame) {
+	if (replayRecorder != NULL) {
 		
-		/*
-		 Peer player has paused game. Call UserInterfaceLayer to pause game.
-		 */
-		[[MultilayerGameScene sharedScene].userInterfaceLayer pauseGame];
+		int32_t data = 0;
 		
-	} else if (notification.name == PeerActionLayerReady) {
+		if (event->type == kNetworkEventSessionFailed) {
+			data = event->data.errorCode;
+		} else if (event->type == kNetworkEventNewGameLengthReceived) {
+			data = event->data.gameLength;
+		}
 		
-		/*
-		 Peer's actionLayerReady. Send acknowledgement and check ready state.
-		 */
-		peerActionLayerReady = YES;
-		[[BluetoothCommsManager sharedInstance] sendAcknowledgeActionLayerReadyPacket];
-		[self checkReadyState];
+		ReplayRecorderAddEvent(replayRecorder, event->type, data);
 		
-	} else if (notification.name == ActionLayerReadyAcknowledged) {
+	}
+	
+	switch (event->type) {
 		
-		/*
-		 localActionLayerReady isn't true until acknowledgement is received. Stops one
-		 device from starting the game without the other.
-		 */
-		localActionLayerReady = YES;
-		[self checkReadyState];
+		case kNetworkEventPeerPausedGame: {
+			
+			/*
+			 Peer player has paused game. Call UserInterfaceLayer to pause game.
+			 */
+			[[MultilayerGameScene sharedScene].userInterfaceLayer pauseGame];
+			
+		}
+		break;
 		
-	} else if (notification.name == SessionFailedWithError) {
+		case kNetworkEventPeerActionLayerReady: {
+			
+			/*
+			 Peer's actionLayerReady. Send acknowledgement and check ready state.
+			 */
+			peerActionLayerReady = YES;
+			[[BluetoothCommsManager sharedInstance] sendAcknowledgeActionLayerReadyPacket];
+			[self checkReadyState];
+			
+		}
+		break;
 		
-		/*
-		 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventActionLayerReadyAcknowledged: {
+			
+			/*
+			 localActionLayerReady isn't true until acknowledgement is received. Stops one
+			 device from starting the game without the other.
+			 */
+			localActionLayerReady = YES;
+			[self checkReadyState];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerWasDisconnected) {
+		case kNetworkEventSessionFailed: {
+			
+			/*
+			 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-		/*
-		 Peer has been disconnected. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventPeerDisconnected: {
+			
+			/*
+			 Peer has been disconnected. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerLost) {
+		case kNetworkEventPeerLost: {
+			
+			/*
+			 Peer connection lost. Show Reconnect alert which notifies user that they must return to the main menu.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-		/*
-		 Peer connection lost. Show Reconnect alert which notifies user that they must return to the main menu.
-		 */
-		[self showDisconnectAlert];
+		default:
+		break;
 		
-	} 
+	}
 	
 }
 
 /*
- Peer player and AlertView are dealloced when the layer is dealloced.
+ Peer players and AlertView are dealloced when the layer is dealloced.
  */
 - (void)dealloc {
 	
-	[peerPlayer unscheduleAllSelectors];
-	peerPlayer = nil;
+	for (int i = 0; i < kMaximumNumberOfPlayers; i++) {
+		
+		[peerPlayers[i] unscheduleAllSelectors];
+		peerPlayers[i] = nil;
+		
+	}
 	
 	if ((self.alertView != nil) && self.alertView.visible) {
 		
@@ -516,6 +1105,11 @@
 	
 	self.alertView = nil;
 	
+	[self finishReplayRecording];
+	
+	RollbackSessionFree(rollbackSession);
+	rollbackSession = NULL;
+	
 	[super dealloc];
 	
 }
@@ -12,8 +12,9 @@
 
 #import <Foundation/Foundation.h>
 #import "GameOptionsLayer.h"
+#import "BluetoothCommsManager.h"
 
-@interface MultiplayerOptionsLayer : GameOptionsLayer <UIAlertViewDelegate> {
+@interface MultiplayerOptionsLayer : GameOptionsLayer <UIAlertViewDelegate, NetworkEventHandler> {
 	
 	/*
 	 These labels are used to indicate when each player has pressed Start Game.
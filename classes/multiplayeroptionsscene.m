@@ -10,6 +10,7 @@
 #import "AberFighterAppDelegate.h"
 #import "BluetoothCommsManager.h"
 #import "GameState.h"
+#import "PlayerShip.h"
 
 #pragma mark -
 #pragma mark MultiplayerOptionsLayer
@@ -85,15 +86,16 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 		 An image is also loaded for the PlayerShip sprite with the correct colours for the playerID.
 		 */
 		NSString *titleString = [NSString stringWithFormat:@"Game Options - Player %d", playerID];
-		NSString *playerShipFrameName = [NSString stringWithFormat:@"ship_%d.png", playerID];
+		NSString *playerShipFrameName = [PlayerShip spriteFrameNameForPlayer:playerID];
+		CCSprite *playerShipSprite;
 		
 		if (playerID == kPlayer1) {
 			/*
 			 Player 1's ship points to the right as it will in the ActionLayer.
 			 */
-			[self setUpTitle:titleString 
-				shipFrameName:playerShipFrameName 
-				 shipRotation:90.0f];
+			playerShipSprite = [self setUpTitle:titleString 
+								  shipFrameName:playerShipFrameName 
+								   shipRotation:90.0f];
 			
 			/*
 			 Player 1 decides on the game length and therefore setUpGameLengthSlider is called to
@@ -104,11 +106,12 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 		} else {
 			
 			/*
-			 Player 2's ship points to the left as it will in the ActionLayer.
+			 Player 2's ship points to the left as it will in the ActionLayer. The other players' ships are
+			 shown the same way.
 			 */
-			[self setUpTitle:titleString 
-				shipFrameName:playerShipFrameName 
-				 shipRotation:270.0f];
+			playerShipSprite = [self setUpTitle:titleString 
+								  shipFrameName:playerShipFrameName 
+								   shipRotation:270.0f];
 			
 			/*
 			 Player 2 is shown a message alerting them that Player 1 will select the game length.
@@ -122,6 +125,8 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 			[self addChild:messageLabel];
 			
 		}
+		
+		playerShipSprite.color = [PlayerShip tintForPlayer:playerID];
 
 		/*
 		 Creates the buttons displayed on the layer.
@@ -334,12 +339,12 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 }
 
 #pragma mark -
-#pragma mark BluetoothCommsManager Notification Processing
+#pragma mark BluetoothCommsManager Event Processing
 
 /*
  This method is used to identify when the game should start.
  It makes use of the peerReady and localPlayerReady booleans. These are set when the relevant 
- packets are received across the network (see processBluetoothNotification method).
+ packets are received across the network (see processNetworkEvent method).
  */
 - (void)updateReadyState {
 	
@@ -353,7 +358,7 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 	 the peer player is ready and they're player 1.
 	 */
 	if ((self.localPlayerReady && localPlayerID == kPlayer1) ||
-		(self.peerReady && localPlayerID == kPlayer2)) {
+		(self.peerReady && localPlayerID != kPlayer1)) {
 		
 		player1ReadyLabel.opacity = 255.0;
 		player1ReadyLabel.color = ccc3(0.0, 255.0, 0.0);
@@ -361,10 +366,11 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 	} 
 	
 	/*
-	 Player 2 Ready is green if the localPlayer is ready and is player 2 or 
-	 the peer player is ready and they're player 2.
+	 Player 2 Ready is green if the localPlayer is ready and isn't player 1 or 
+	 the peer players are ready and the localPlayer is player 1. With more than two players it stands for
+	 every player other than player 1.
 	 */
-	if ((self.localPlayerReady && localPlayerID == kPlayer2) ||
+	if ((self.localPlayerReady && localPlayerID != kPlayer1) ||
 		(self.peerReady && localPlayerID == kPlayer1)) {
 		
 		player2ReadyLabel.opacity = 255.0;
@@ -386,77 +392,104 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 }
 
 /*
- Called by the NSNotificationCenter when this class is registered as an observer of the BluetoothCommsManager.
- This method reacts to the notifications posted by the BluetoothCommsManager.
+ Called by the BluetoothCommsManager once per frame for each event posted while this layer is it's eventHandler.
  */
-- (void)processBluetoothNotification:(NSNotification *)notification {
+- (void)processNetworkEvent:(const NetworkEvent *)event {
 
-	if (notification.name == NewGameLengthReceived) {
-		
-		/*
-		 New game length received over the network. Calls updateGameLength with the values transferred.
-		 */
-		NSNumber *newGameLength = (NSNumber *)[notification.userInfo objectForKey:@"newGameLength"];
-		[self updateGameLength:[newGameLength intValue]];
-		
-	} else if (notification.name == PeerReadyToPlay) {
+	switch (event->type) {
 		
-		/*
-		 Peer ready to player packet received. Set peerReady to true and call sendAcknowledgePlayerReadyPacket 
-		 on the comms manager. 
-		 */
-		peerReady = YES;
-		[[BluetoothCommsManager sharedInstance] sendAcknowledgePlayerReadyPacket];
-		/*
-		 Call updateReadyState which checks if both players have said they're ready and been acknowledged, in which case 
-		 the game starts.
-		 */
-		[self updateReadyState];
-		 
-	} else if (notification.name == LocalPlayerReadyAcknowledged) {
-		
-		/*
-		 Acknowledgement received that local player is ready to play. Set localPlayerReady to true and
-		 call updateReadyState to check if both players are ready.
-		 */
-		localPlayerReady = YES;
-		[self updateReadyState];
-		
-	} else if (notification.name == PeerCancelledGame) {
-		
-		/*
-		 Peer pressed Cancel button. Show Cancel Alert which will return the local player to the main menu when dismissed.
-		 */
-		[self showCancelAlert];
+		case kNetworkEventNewGameLengthReceived: {
+			
+			/*
+			 New game length received over the network. Calls updateGameLength with the values transferred.
+			 */
+			[self updateGameLength:event->data.gameLength];
+			
+		}
+		break;
 		
-	} else if (notification.name == SessionFailedWithError) {
+		case kNetworkEventPeerReadyToPlay: {
+			
+			/*
+			 Peer ready to player packet received. Set peerReady to true and call sendAcknowledgePlayerReadyPacket 
+			 on the comms manager. 
+			 */
+			peerReady = YES;
+			[[BluetoothCommsManager sharedInstance] sendAcknowledgePlayerReadyPacket];
+			/*
+			 Call updateReadyState which checks if both players have said they're ready and been acknowledged, in which case 
+			 the game starts.
+			 */
+			[self updateReadyState];
+			 
+		}
+		break;
 		
-		/*
-		 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventLocalPlayerReadyAcknowledged: {
+			
+			/*
+			 Acknowledgement received that local player is ready to play. Set localPlayerReady to true and
+			 call updateReadyState to check if both players are ready.
+			 */
+			localPlayerReady = YES;
+			[self updateReadyState];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerWasDisconnected) {
+		case kNetworkEventPeerCancelledGame: {
+			
+			/*
+			 Peer pressed Cancel button. Show Cancel Alert which will return the local player to the main menu when dismissed.
+			 */
+			[self showCancelAlert];
+			
+		}
+		break;
 		
-		/*
-		 Peer has been disconnected. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventSessionFailed: {
+			
+			/*
+			 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerLost) {
+		case kNetworkEventPeerDisconnected: {
+			
+			/*
+			 Peer has been disconnected. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-		/*
-		 Peer connection lost. Show Reconnect alert which notifies user that the devices are attempting to re-connect. They
-		 can dimiss the alert to return to the main menu or wait for reconnection.
-		 */
-		[self showReconnectAlert];
+		case kNetworkEventPeerLost: {
+			
+			/*
+			 Peer connection lost. Show Reconnect alert which notifies user that the devices are attempting to re-connect. They
+			 can dimiss the alert to return to the main menu or wait for reconnection.
+			 */
+			[self showReconnectAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerFound) {
+		case kNetworkEventPeerFound: {
+			
+			/*
+			 Peer has been reconnected with other device. Dismiss the UIAlertView.
+			 */
+			[self.alertView dismissWithClickedButtonIndex:-1 animated:YES];
+			
+		}
+		break;
 		
-		/*
-		 Peer has been reconnected with other device. Dismiss the UIAlertView.
-		 */
-		[self.alertView dismissWithClickedButtonIndex:-1 animated:YES];
+		default:
+		break;
 		
 	}
 }
@@ -465,17 +498,13 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 #pragma mark Superclass Overrides
 
 /*
- Called when the layer is shown. Adds the layer as an observer of the BluetoothCommsManager in the
- NSNotificationCenter.
+ Called when the layer is shown. Sets the layer as the BluetoothCommsManager's eventHandler.
  */
 - (void) onEnter{
 	
 	[super onEnter];
 	
-	[[NSNotificationCenter defaultCenter] addObserver:self 
-											 selector:@selector(processBluetoothNotification:) 
-												 name:nil 
-											   object:[BluetoothCommsManager sharedInstance]];
+	[BluetoothCommsManager sharedInstance].eventHandler = self;
 	
 	/*
 	 Reset player readiness state.
@@ -491,14 +520,14 @@ NSString *const Player2TimeMessage = @"Player 1 will select the game length. Ple
 }
 
 /*
- Called when a transition out of this layer is over. Removes this layer as an observer in the 
- NSNotificationCenter before it it deallocated.
+ Called when a transition out of this layer is over. Stops this layer receiving network events before it
+ is deallocated.
  */
 - (void) onExit{
 	
 	[super onExit];
 	
-	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
 	
 	
 }
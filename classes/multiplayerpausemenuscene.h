@@ -6,15 +6,16 @@
 //  Copyright 2011 William Darius Elphick. All rights reserved.
 //
 /*
- This class extends the PauseMenuLayer to provide functionality related to interpretting notifications
- from the BluetoothCommsManager through the NSNotificationCenter.
+ This class extends the PauseMenuLayer to provide functionality related to interpretting network events
+ from the BluetoothCommsManager.
  */
 
 #import <Foundation/Foundation.h>
 #import "cocos2d.h"
 #import "PauseMenuScene.h"
+#import "BluetoothCommsManager.h"
 
-@interface MultiplayerPauseMenuLayer : PauseMenuLayer {
+@interface MultiplayerPauseMenuLayer : PauseMenuLayer <NetworkEventHandler> {
 	
 	/*
 	 These labels are used to indicate when each player has pressed Resume.
@@ -239,14 +239,14 @@
 }
 
 #pragma mark -
-#pragma mark BluetoothCommsManager Notification Processing
+#pragma mark BluetoothCommsManager Event Processing
 
 /*
  This method is used to identify when the game should resume.
  It makes use of the peerReady and localPlayerReady booleans. The local player readiness indicator is
  changed straight away when the Resume button is pressed. 
  peerReady is set when the relevant packets are received across the network 
- (see processBluetoothNotification method).
+ (see processNetworkEvent method).
  */
 - (void)updateReadyState {
 	
@@ -258,7 +258,7 @@
 	/*
 	 Update the peer player's readiness indicator. 
 	 */
-	if (self.peerReady && localPlayerID == kPlayer2) {
+	if (self.peerReady && localPlayerID != kPlayer1) {
 		
 		self.player1ReadyLabel.opacity = 255.0;
 		self.player1ReadyLabel.color = ccc3(0.0, 255.0, 0.0);
@@ -284,65 +284,90 @@
 }
 
 /*
- Called by the NSNotificationCenter when this class is registered as an observer of the BluetoothCommsManager.
- This method reacts to the notifications posted by the BluetoothCommsManager.
+ Called by the BluetoothCommsManager once per frame for each event posted while this layer is it's eventHandler.
  */
-- (void)processBluetoothNotification:(NSNotification *)notification {
+- (void)processNetworkEvent:(const NetworkEvent *)event {
 	
-	if (notification.name == PeerResumedGame) {
+	switch (event->type) {
 		
-		/*
-		 Peer player has pressed resume on the pause menu. Set peerReady to true, send an acknowledgement
-		 that the message has been received and call the updateReadyState method above.
-		 */		
-		peerReady = YES;
-		[[BluetoothCommsManager sharedInstance] sendAcknowledgePeerResumedGamePacket];
-		[self updateReadyState];
-		
-	} else if (notification.name == PeerResumedGameAcknowledged) {
-		
-		/*
-		 Peer has acknowledged that the local player has resumed the game. Set localPlayerReady to true and
-		 call updateReadyState.
-		 */
-		localPlayerReady = YES;
-		[self updateReadyState];
-		
-	} else if (notification.name == PeerQuitGame) {
-		
-		/*
-		 Peer has quit the game. Call quitGame to show the GameOverLayer.
-		 */
-		[self quitGame];
-		
-	} else if (notification.name == SessionFailedWithError) {
+		case kNetworkEventPeerResumedGame: {
+			
+			/*
+			 Peer player has pressed resume on the pause menu. Set peerReady to true, send an acknowledgement
+			 that the message has been received and call the updateReadyState method above.
+			 */		
+			peerReady = YES;
+			[[BluetoothCommsManager sharedInstance] sendAcknowledgePeerResumedGamePacket];
+			[self updateReadyState];
+			
+		}
+		break;
 		
-		/*
-		 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventPeerResumedGameAcknowledged: {
+			
+			/*
+			 Peer has acknowledged that the local player has resumed the game. Set localPlayerReady to true and
+			 call updateReadyState.
+			 */
+			localPlayerReady = YES;
+			[self updateReadyState];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerWasDisconnected) {
+		case kNetworkEventPeerQuitGame: {
+			
+			/*
+			 Peer has quit the game. Call quitGame to show the GameOverLayer.
+			 */
+			[self quitGame];
+			
+		}
+		break;
 		
-		/*
-		 Peer has been disconnected. Show Disconnect Alert which will return the player to the main menu when dismissed.
-		 */
-		[self showDisconnectAlert];
+		case kNetworkEventSessionFailed: {
+			
+			/*
+			 Error with session. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerLost) {
+		case kNetworkEventPeerDisconnected: {
+			
+			/*
+			 Peer has been disconnected. Show Disconnect Alert which will return the player to the main menu when dismissed.
+			 */
+			[self showDisconnectAlert];
+			
+		}
+		break;
 		
-		/*
-		 Peer connection lost. Show Reconnect alert which notifies user that the devices are attempting to re-connect. They
-		 can dimiss the alert to return to the main menu or wait for reconnection.
-		 */
-		[self showReconnectAlert];
+		case kNetworkEventPeerLost: {
+			
+			/*
+			 Peer connection lost. Show Reconnect alert which notifies user that the devices are attempting to re-connect. They
+			 can dimiss the alert to return to the main menu or wait for reconnection.
+			 */
+			[self showReconnectAlert];
+			
+		}
+		break;
 		
-	} else if (notification.name == PeerFound) {
+		case kNetworkEventPeerFound: {
+			
+			/*
+			 Peer has been reconnected with other device. Dismiss the UIAlertView.
+			 */
+			[self.alertView dismissWithClickedButtonIndex:-1 animated:YES];
+			
+		}
+		break;
 		
-		/*
-		 Peer has been reconnected with other device. Dismiss the UIAlertView.
-		 */
-		[self.alertView dismissWithClickedButtonIndex:-1 animated:YES];
+		default:
+		break;
 		
 	}
 	
@@ -352,29 +377,25 @@
 #pragma mark Superclass Overrides
 
 /*
- Called when the layer is shown. Adds the layer as an observer of the BluetoothCommsManager in the
- NSNotificationCenter.
+ Called when the layer is shown. Sets the layer as the BluetoothCommsManager's eventHandler.
  */
 - (void)onEnter {
 	
 	[super onEnter];
 	
-	[[NSNotificationCenter defaultCenter] addObserver:self 
-											 selector:@selector(processBluetoothNotification:) 
-												 name:nil 
-											   object:[BluetoothCommsManager sharedInstance]];
+	[BluetoothCommsManager sharedInstance].eventHandler = self;
 	
 }
 
 /*
- Called when a transition out of this layer is over. Removes this layer as an observer in the 
- NSNotificationCenter before it it deallocated.
+ Called when a transition out of this layer is over. Stops this layer receiving network events before it
+ is deallocated.
  */
 - (void)onExit {
 	
 	[super onExit];
 	
-	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[[BluetoothCommsManager sharedInstance] removeEventHandler:self];
 	
 }
 
@@ -0,0 +1,75 @@
+//
+//  NetworkEventQueue.c
+//  AberFighter
+//
+//  Created by wde7 on 13/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include "NetworkEventQueue.h"
+
+/*
+ Full memory barrier. Stops the compiler and the processor from moving reads and writes of an event
+ across the update of the index which hands it to the other side.
+ */
+#define NetworkEventQueueBarrier() __sync_synchronize()
+
+void NetworkEventQueueInit(NetworkEventQueue *queue) {
+
+	memset(queue, 0, sizeof(NetworkEventQueue));
+
+}
+
+int NetworkEventQueuePush(NetworkEventQueue *queue, const NetworkEvent *event) {
+
+	uint32_t writeCount = queue->writeCount;
+
+	NetworkEventQueueBarrier();
+
+	if (writeCount - queue->readCount >= kNetworkEventQueueCapacity) {
+
+		queue->droppedEvents++;
+		return 0;
+
+	}
+
+	queue->events[writeCount & (kNetworkEventQueueCapacity - 1)] = *event;
+
+	NetworkEventQueueBarrier();
+
+	queue->writeCount = writeCount + 1;
+
+	return 1;
+
+}
+
+int NetworkEventQueuePop(NetworkEventQueue *queue, NetworkEvent *event) {
+
+	uint32_t readCount = queue->readCount;
+
+	if (readCount == queue->writeCount) {
+		return 0;
+	}
+
+	NetworkEventQueueBarrier();
+
+	*event = queue->events[readCount & (kNetworkEventQueueCapacity - 1)];
+
+	NetworkEventQueueBarrier();
+
+	queue->readCount = readCount + 1;
+
+	return 1;
+
+}
+
+void NetworkEventQueueDiscard(NetworkEventQueue *queue) {
+
+	uint32_t writeCount = queue->writeCount;
+
+	NetworkEventQueueBarrier();
+
+	queue->readCount = writeCount;
+
+}
@@ -0,0 +1,99 @@
+//
+//  NetworkEventQueue.h
+//  AberFighter
+//
+//  Created by wde7 on 13/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The NetworkEventQueue carries events from the BluetoothCommsManager to the layer currently on screen. It
+ replaces posting NSNotifications, which boxed every payload in an NSDictionary and left each layer to find
+ out what had happened by comparing notification names.
+
+ Events are small structs with a type and a plain data payload. They are copied into a fixed size ring
+ buffer when they are pushed and copied out again when they are popped, so nothing is allocated.
+
+ The queue has a single producer and a single consumer, which may be on different threads. Each index is
+ only ever written by one side, and a memory barrier makes sure an event is completely written before the
+ index which makes it visible to the consumer is moved on, so no lock is needed.
+
+ The queue is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __NETWORK_EVENT_QUEUE_H__
+#define __NETWORK_EVENT_QUEUE_H__
+
+#include <stdint.h>
+
+/*
+ Number of events which can be waiting. Must be a power of 2.
+ */
+#define kNetworkEventQueueCapacity 64
+
+typedef enum {
+
+	kNetworkEventSessionFailed,
+	kNetworkEventPeerDisconnected,
+	kNetworkEventPeerLost,
+	kNetworkEventPeerFound,
+	kNetworkEventRestartingDieRoll,
+	kNetworkEventDieRollFinished,
+	kNetworkEventNewGameLengthReceived,
+	kNetworkEventPeerReadyToPlay,
+	kNetworkEventLocalPlayerReadyAcknowledged,
+	kNetworkEventPeerCancelledGame,
+	kNetworkEventPeerActionLayerReady,
+	kNetworkEventActionLayerReadyAcknowledged,
+	kNetworkEventPeerPausedGame,
+	kNetworkEventPeerResumedGame,
+	kNetworkEventPeerResumedGameAcknowledged,
+	kNetworkEventPeerQuitGame
+
+} NetworkEventType;
+
+typedef struct {
+
+	NetworkEventType type;
+
+	union {
+
+		//kNetworkEventSessionFailed: the code of the error reported by the transport.
+		int errorCode;
+		//kNetworkEventNewGameLengthReceived: the game length chosen by the peer in seconds.
+		int gameLength;
+
+	} data;
+
+} NetworkEvent;
+
+typedef struct {
+
+	NetworkEvent events[kNetworkEventQueueCapacity];
+
+	//Total events pushed and popped. Only the producer writes writeCount and only the consumer writes readCount.
+	volatile uint32_t writeCount;
+	volatile uint32_t readCount;
+
+	//Events which were pushed while the queue was full. Only written by the producer.
+	unsigned long droppedEvents;
+
+} NetworkEventQueue;
+
+void NetworkEventQueueInit(NetworkEventQueue *queue);
+
+/*
+ Adds an event to the queue. Returns 0 and drops the event if the queue is full. Only called by the producer.
+ */
+int NetworkEventQueuePush(NetworkEventQueue *queue, const NetworkEvent *event);
+
+/*
+ Takes the oldest event from the queue. Returns 0 if the queue is empty. Only called by the consumer.
+ */
+int NetworkEventQueuePop(NetworkEventQueue *queue, NetworkEvent *event);
+
+/*
+ Throws away every event in the queue. Only called by the consumer.
+ */
+void NetworkEventQueueDiscard(NetworkEventQueue *queue);
+
+#endif // __NETWORK_EVENT_QUEUE_H__
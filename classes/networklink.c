@@ -0,0 +1,472 @@
+//
+//  NetworkLink.c
+//  AberFighter
+//
+//  Created by wde7 on 03/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <math.h>
+#include <string.h>
+#include "NetworkLink.h"
+
+/*
+ Size of the buffer used to encode a small message, such as a link report, an acknowledgement or a ship or
+ projectile update.
+ */
+#define kNetworkLinkSmallMessageSize 32
+
+/*
+ Empties the batch. The batch must leave room for the header of the packet it is sent in.
+ */
+static void NetworkLinkResetBatch(NetworkLink *link) {
+
+	WireWriterInit(&link->outboundWriter, link->outboundMessages, kNetworkDataPacketSize - kWireProtocolMaximumHeaderSize);
+	link->outboundMessageCount = 0;
+
+}
+
+void NetworkLinkInit(NetworkLink *link, NetworkLinkTransmitFunction transmit, void *context, NetworkTrafficStatistics *traffic, double now) {
+
+	link->packetNumber = 0;
+	link->previousPacketNumber = -1;
+	ReliableChannelInit(&link->reliableChannel);
+	LinkEstimatorInit(&link->linkEstimator, now);
+	DirectionalStreamSenderInit(&link->directionalSender);
+	DirectionalStreamReceiverInit(&link->directionalReceiver);
+	NetworkLinkResetBatch(link);
+	ReplicationSchedulerInit(&link->replication);
+
+	link->transmit = transmit;
+	link->transmitContext = context;
+	link->traffic = traffic;
+
+}
+
+void NetworkLinkTransmit(NetworkLink *link, uint8_t packetType, const void *data, size_t length) {
+
+	uint8_t packet[kNetworkDataPacketSize];
+	WireWriter writer;
+
+	if (length > kNetworkDataPacketSize - kWireProtocolMaximumHeaderSize) {
+		return;
+	}
+
+	link->packetNumber++;
+
+	/*
+	 The header contains the protocol version, the packet type and the packet number. It is followed by the data.
+	 */
+	WireWriterInit(&writer, packet, sizeof(packet));
+	WireWriteHeader(&writer, packetType, (uint32_t)link->packetNumber);
+
+	if (data != NULL) {
+		WireWriteBytes(&writer, data, length);
+	}
+
+	link->transmit(link, packet, writer.length, link->transmitContext);
+
+	link->traffic->totalPackets++;
+	link->traffic->totalPacketBytes += writer.length;
+
+}
+
+/*
+ The traffic counters record the size each message would have been if it had been sent to the peer in it's
+ own packet.
+ */
+static void NetworkLinkCountMessage(NetworkLink *link, size_t length) {
+
+	link->traffic->totalMessages++;
+	link->traffic->totalMessageBytes += 2 + WireVarUIntSize((uint32_t)(link->packetNumber + 1)) + length;
+
+}
+
+/*
+ Adds a message to the batch, sending the batch first if the message doesn't fit. A message which doesn't fit
+ in an empty batch is dropped.
+ */
+static void NetworkLinkQueueMessage(NetworkLink *link, uint8_t messageType, const void *data, size_t length) {
+
+	if (WireMessageSize(length) > WireWriterRemaining(&link->outboundWriter)) {
+
+		NetworkLinkSendBatch(link);
+
+		if (WireMessageSize(length) > WireWriterRemaining(&link->outboundWriter)) {
+			return;
+		}
+
+	}
+
+	WireWriteMessage(&link->outboundWriter, messageType, data, length);
+	link->outboundMessageCount++;
+
+}
+
+int NetworkLinkSendMessage(NetworkLink *link, uint8_t messageType, const void *data, size_t length, int reliable) {
+
+	NetworkLinkCountMessage(link, length);
+
+	if (reliable) {
+		return ReliableChannelSend(&link->reliableChannel, messageType, data, length);
+	}
+
+	NetworkLinkQueueMessage(link, messageType, data, length);
+
+	return 1;
+
+}
+
+void NetworkLinkSendBatch(NetworkLink *link) {
+
+	if (link->outboundMessageCount > 0) {
+		NetworkLinkTransmit(link, kPacketTypeBatch, link->outboundMessages, link->outboundWriter.length);
+	}
+
+	NetworkLinkResetBatch(link);
+
+}
+
+/*
+ Lets the replication scheduler choose the ship and projectile updates for the batch, and queues them. The
+ weights are worked out again first, as the ships may have moved since the updates were made.
+
+ The local ship is encoded against a copy of the directional stream, so that it's size is known without
+ using up a sequence number unless it is chosen. It is dropped if the peer is known to already have it.
+ */
+static void NetworkLinkQueueReplicatedUpdates(NetworkLink *link, int localShip, const PlayerShipDirectionalInformation *localShipInformation,
+											  const NetworkPoint *receiverShip, double now) {
+
+	DirectionalStreamSender localShipSender = link->directionalSender;
+	uint8_t localShipData[kNetworkLinkSmallMessageSize];
+	WireWriter localShipWriter;
+	int selected[kReplicationSchedulerMaximumEntities];
+
+	if (localShip < 0) {
+		return;
+	}
+
+	for (int entity = 0; entity < kReplicationMaximumEntities; entity++) {
+
+		if (entity != localShip && ReplicationSchedulerIsPending(&link->replication, entity)) {
+
+			const ReplicatedUpdate *update = &link->replicatedUpdates[entity];
+
+			ReplicationSchedulerUpdate(&link->replication,
+									   entity,
+									   NetworkLinkUpdateWeight(update, receiverShip),
+									   WireMessageSize(update->length),
+									   now);
+
+		}
+
+	}
+
+	WireWriterInit(&localShipWriter, localShipData, sizeof(localShipData));
+
+	if (ReplicationSchedulerIsPending(&link->replication, localShip)) {
+
+		if (DirectionalStreamSenderWrite(&localShipSender, &localShipWriter, localShipInformation)) {
+			ReplicationSchedulerUpdate(&link->replication, localShip, kReplicationLocalShipWeight, WireMessageSize(localShipWriter.length), now);
+		} else {
+			ReplicationSchedulerCancel(&link->replication, localShip);
+		}
+
+	}
+
+	int count = ReplicationSchedulerTick(&link->replication, kReplicationDatagramBudget, now, selected);
+
+	for (int i = 0; i < count; i++) {
+
+		if (selected[i] == localShip) {
+
+			link->directionalSender = localShipSender;
+			NetworkLinkSendMessage(link, kPacketTypePeerPlayerShipDirectionalData, localShipData, localShipWriter.length, 0);
+
+		} else {
+
+			ReplicatedUpdate *update = &link->replicatedUpdates[selected[i]];
+
+			if (update->messageType == kPacketTypeRelayed || update->messageType == kPacketTypeRelayedDirectionalData) {
+				link->traffic->totalMessagesRelayed++;
+			}
+
+			NetworkLinkSendMessage(link, update->messageType, update->data, update->length, 0);
+
+		}
+
+	}
+
+}
+
+/*
+ Adds the reliable channel's acknowledgement and any messages due to be sent or resent to the batch, as one
+ message. Whatever doesn't fit is sent with the next batch.
+ */
+static void NetworkLinkQueueReliableChannelData(NetworkLink *link, double now) {
+
+	uint8_t channelData[kNetworkDataPacketSize];
+	WireWriter writer;
+
+	if (!ReliableChannelHasDataToWrite(&link->reliableChannel, now)) {
+		return;
+	}
+
+	size_t available = WireWriterRemaining(&link->outboundWriter);
+	size_t framing = WireMessageSize(available) - available;
+
+	if (available <= framing) {
+		return;
+	}
+
+	WireWriterInit(&writer, channelData, available - framing);
+
+	size_t length = ReliableChannelWrite(&link->reliableChannel, &writer, now);
+
+	if (length > 0) {
+
+		WireWriteMessage(&link->outboundWriter, kPacketTypeReliableChannel, channelData, length);
+		link->outboundMessageCount++;
+
+	}
+
+}
+
+void NetworkLinkFlush(NetworkLink *link, int localShip, const PlayerShipDirectionalInformation *localShipInformation,
+					  const NetworkPoint *receiverShip, int sendLinkReport, double now) {
+
+	NetworkLinkQueueReplicatedUpdates(link, localShip, localShipInformation, receiverShip, now);
+
+	if (sendLinkReport && LinkEstimatorReportDue(&link->linkEstimator, now)) {
+
+		uint8_t reportData[kNetworkLinkSmallMessageSize];
+		WireWriter writer;
+
+		WireWriterInit(&writer, reportData, sizeof(reportData));
+		LinkEstimatorWriteReport(&link->linkEstimator, &writer, now);
+		NetworkLinkQueueMessage(link, kPacketTypeLinkReport, reportData, writer.length);
+
+	}
+
+	NetworkLinkQueueReliableChannelData(link, now);
+	NetworkLinkSendBatch(link);
+
+}
+
+int NetworkLinkSetUpUpdate(ReplicatedUpdate *update, uint8_t messageType, const void *data, size_t length, float weight, NetworkPoint from, NetworkPoint to) {
+
+	if (length > kReplicationMaximumUpdateLength) {
+		return 0;
+	}
+
+	update->messageType = messageType;
+	update->length = (uint8_t)length;
+	memcpy(update->data, data, length);
+	update->weight = weight;
+	update->from = from;
+	update->to = to;
+
+	return 1;
+
+}
+
+float NetworkLinkUpdateWeight(const ReplicatedUpdate *update, const NetworkPoint *receiverShip) {
+
+	if (receiverShip == NULL) {
+		return update->weight;
+	}
+
+	/*
+	 The nearest point is found along the path from the start of the update to it's end.
+	 */
+	float pathX = update->to.x - update->from.x;
+	float pathY = update->to.y - update->from.y;
+	float pathLengthSquared = (pathX * pathX) + (pathY * pathY);
+	float along = 0.0f;
+
+	if (pathLengthSquared > 0.0f) {
+
+		along = (((receiverShip->x - update->from.x) * pathX) + ((receiverShip->y - update->from.y) * pathY)) / pathLengthSquared;
+		along = fminf(fmaxf(along, 0.0f), 1.0f);
+
+	}
+
+	float offsetX = receiverShip->x - (update->from.x + (pathX * along));
+	float offsetY = receiverShip->y - (update->from.y + (pathY * along));
+	float distance = sqrtf((offsetX * offsetX) + (offsetY * offsetY));
+
+	return update->weight * kReplicationNearDistance / fmaxf(distance, kReplicationNearDistance);
+
+}
+
+void NetworkLinkScheduleUpdate(NetworkLink *link, const ReplicatedUpdate *update, int entity, const NetworkPoint *receiverShip, double now) {
+
+	link->replicatedUpdates[entity] = *update;
+	ReplicationSchedulerUpdate(&link->replication,
+							   entity,
+							   NetworkLinkUpdateWeight(update, receiverShip),
+							   WireMessageSize(update->length),
+							   now);
+
+}
+
+int NetworkLinkScheduleProjectile(NetworkLink *link, const ReplicatedUpdate *update, const NetworkPoint *receiverShip, double now) {
+
+	int entity = ReplicationSchedulerFindIdle(&link->replication, kNetworkLinkMaximumPlayers, kReplicationMaximumEntities - 1);
+
+	if (entity < 0) {
+		return 0;
+	}
+
+	NetworkLinkScheduleUpdate(link, update, entity, receiverShip, now);
+
+	return 1;
+
+}
+
+void NetworkLinkLocalShipChanged(NetworkLink *link, int localShip, double now) {
+
+	ReplicationSchedulerUpdate(&link->replication, localShip, kReplicationLocalShipWeight, 0, now);
+
+}
+
+void NetworkLinkSendProjectile(NetworkLink *link, const ProjectileDetails *details, const NetworkPoint *receiverShip, double now) {
+
+	uint8_t data[kNetworkLinkSmallMessageSize];
+	WireWriter writer;
+	ReplicatedUpdate update;
+	NetworkPoint from = { details->startingPositionX, details->startingPositionY };
+	NetworkPoint to = { details->destinationPointX, details->destinationPointY };
+
+	WireWriterInit(&writer, data, sizeof(data));
+	WireWriteProjectileDetails(&writer, details);
+
+	if (!NetworkLinkSetUpUpdate(&update, kPacketTypeProjectileFired, data, writer.length, kReplicationProjectileWeight, from, to) ||
+		!NetworkLinkScheduleProjectile(link, &update, receiverShip, now)) {
+		NetworkLinkSendMessage(link, kPacketTypeProjectileFired, data, writer.length, 0);
+	}
+
+}
+
+int NetworkLinkRelayMessage(NetworkLink *link, int player, uint8_t messageType, const WireReader *reader, int reliable,
+							const NetworkPoint *receiverShip, double now) {
+
+	uint8_t relayData[kNetworkDataPacketSize];
+	WireWriter writer;
+
+	WireWriterInit(&writer, relayData, sizeof(relayData));
+	WireWriteVarUInt(&writer, (uint32_t)player);
+	WireWriteUInt8(&writer, messageType);
+	WireWriteBytes(&writer, &reader->bytes[reader->position], WireReaderRemaining(reader));
+
+	if (writer.overflow) {
+		return 1;
+	}
+
+	/*
+	 Unreliable projectiles are scheduled like the hub's own, weighted by how close their path comes to the
+	 receiving player's ship.
+	 */
+	if (!reliable && messageType == kPacketTypeProjectileFired) {
+
+		ReplicatedUpdate update;
+		WireReader projectileReader = *reader;
+		ProjectileDetails details;
+
+		if (WireReadProjectileDetails(&projectileReader, &details)) {
+
+			NetworkPoint from = { details.startingPositionX, details.startingPositionY };
+			NetworkPoint to = { details.destinationPointX, details.destinationPointY };
+
+			if (NetworkLinkSetUpUpdate(&update, kPacketTypeRelayed, relayData, writer.length, kReplicationProjectileWeight, from, to) &&
+				NetworkLinkScheduleProjectile(link, &update, receiverShip, now)) {
+				return 1;
+			}
+
+		}
+
+	}
+
+	link->traffic->totalMessagesRelayed++;
+
+	return NetworkLinkSendMessage(link, kPacketTypeRelayed, relayData, writer.length, reliable);
+
+}
+
+void NetworkLinkRelayDirectionalData(NetworkLink *link, int player, const PlayerShipDirectionalInformation *information,
+									 const NetworkPoint *receiverShip, double now) {
+
+	uint8_t relayData[kNetworkLinkSmallMessageSize];
+	WireWriter writer;
+	ReplicatedUpdate update;
+	NetworkPoint position = { information->currentPositionX, information->currentPositionY };
+
+	WireWriterInit(&writer, relayData, sizeof(relayData));
+	WireWriteVarUInt(&writer, (uint32_t)player);
+	WireWriteDirectionalInformation(&writer, information);
+
+	if (player >= 1 && player <= kNetworkLinkMaximumPlayers &&
+		NetworkLinkSetUpUpdate(&update, kPacketTypeRelayedDirectionalData, relayData, writer.length, kReplicationShipWeight, position, position)) {
+
+		NetworkLinkScheduleUpdate(link, &update, player - 1, receiverShip, now);
+
+	} else {
+
+		link->traffic->totalMessagesRelayed++;
+		NetworkLinkSendMessage(link, kPacketTypeRelayedDirectionalData, relayData, writer.length, 0);
+
+	}
+
+}
+
+int NetworkLinkPacketReceived(NetworkLink *link, const WirePacketHeader *header, size_t dataLength, double now) {
+
+	link->traffic->totalPacketsReceived++;
+	link->traffic->totalPacketBytesReceived += 2 + WireVarUIntSize(header->packetNumber) + dataLength;
+
+	LinkEstimatorPacketReceived(&link->linkEstimator, header->packetNumber, now);
+
+	int currentPacketNumber = (int)header->packetNumber;
+
+	if (currentPacketNumber <= link->previousPacketNumber) {
+		return 0;
+	}
+
+	link->previousPacketNumber = currentPacketNumber;
+
+	return 1;
+
+}
+
+int NetworkLinkReceiveDirectionalData(NetworkLink *link, WireReader *reader, PlayerShipDirectionalInformation *information) {
+
+	uint8_t sequence;
+
+	if (!DirectionalStreamReceiverRead(&link->directionalReceiver, reader, information, &sequence)) {
+		return 0;
+	}
+
+	if (DirectionalStreamReceiverAcknowledgementDue(&link->directionalReceiver)) {
+
+		uint8_t data[kNetworkLinkSmallMessageSize];
+		WireWriter writer;
+
+		WireWriterInit(&writer, data, sizeof(data));
+		WireWriteVarUInt(&writer, sequence);
+		NetworkLinkSendMessage(link, kPacketTypeDirectionalDataAcknowledgement, data, writer.length, 0);
+
+	}
+
+	return 1;
+
+}
+
+void NetworkLinkReceiveDirectionalAcknowledgement(NetworkLink *link, WireReader *reader) {
+
+	uint32_t sequence = WireReadVarUInt(reader);
+
+	if (!reader->error) {
+		DirectionalStreamSenderAcknowledge(&link->directionalSender, (uint8_t)sequence);
+	}
+
+}
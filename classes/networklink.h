@@ -0,0 +1,314 @@
+//
+//  NetworkLink.h
+//  AberFighter
+//
+//  Created by wde7 on 03/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ A NetworkLink is a device's end of the link to one connected peer, and decides what is sent over it. It
+ keeps the packet numbers, the reliable channel, the link estimator and the directional streams of the link,
+ puts the unreliable messages sent to the peer together into one batch packet per frame, and lets the
+ link's replication scheduler choose which ship and projectile updates go in each batch. The hub of a star
+ relays the messages of one leaf to the others through the links to them.
+
+ The BluetoothCommsManager keeps a NetworkLink for each peer and hands the packets they write to it's
+ transport. The link is written in plain C with no dependency on UIKit, GameKit or cocos2d, so that the
+ TopologyBenchmark in the tests runs the same sending, batching and relaying on the host. Times are in
+ seconds and must come from a clock which never goes backwards.
+ */
+
+#ifndef __NETWORK_LINK_H__
+#define __NETWORK_LINK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WireProtocol.h"
+#include "DirectionalStream.h"
+#include "ReliableChannel.h"
+#include "LinkEstimator.h"
+#include "ReplicationScheduler.h"
+#include "PlayerElection.h"
+
+//The maximum size of a packet sent across the network in bytes.
+#define kNetworkDataPacketSize 1024
+//Most players in a game. The scheduler of each link has an entity for each player's ship.
+#define kNetworkLinkMaximumPlayers kPlayerElectionMaximumPlayers
+//Bytes of ship and projectile updates, including their message headers, which may go in each batch to a peer.
+#define kReplicationDatagramBudget 64
+//Projectiles which may be waiting to be sent to a peer. Any more are sent straight away.
+#define kReplicationMaximumProjectiles 16
+//Scheduler entities used for each peer: one for each player's ship, then the projectiles.
+#define kReplicationMaximumEntities (kNetworkLinkMaximumPlayers + kReplicationMaximumProjectiles)
+//Longest encoded update which can wait in the scheduler. Longer ones are sent straight away.
+#define kReplicationMaximumUpdateLength 24
+/*
+ Priority gained per second by updates waiting to be sent. The local ship always has it's full weight, other
+ ships and projectiles have theirs while they are within kReplicationNearDistance points of the receiving
+ player's ship, and less the further away they are.
+ */
+#define kReplicationLocalShipWeight 8.0f
+#define kReplicationShipWeight 2.0f
+#define kReplicationProjectileWeight 4.0f
+#define kReplicationNearDistance 80.0f
+
+#if kReplicationMaximumEntities > kReplicationSchedulerMaximumEntities
+#error "The replication scheduler has too few entities for every ship and projectile"
+#endif
+
+/*
+ These are the packet types which are sent across the network.
+ */
+typedef enum PacketTypes {
+
+	kPacketTypeDieRoll,
+	kPacketTypeDieRollReceived,
+	kPacketTypeRestartDieRoll,
+	kPacketTypeLinkReport,
+	kPacketTypeNewGameLength,
+	kPacketTypePlayerReady,
+	kPacketTypeAcknowledgePlayerReady,
+	kPacketTypeGameCancelled,
+	kPacketTypeActionLayerReady,
+	kPacketTypeAcknowledgeActionLayerReady,
+	kPacketTypePeerPlayerShipDirectionalData,
+	kPacketTypeSpawnChecksum,
+	kPacketTypeProjectileFired,
+	kPacketTypePeerPausedGame,
+	kPacketTypePeerResumedGame,
+	kPacketTypeAcknowledgePeerResumedGame,
+	kPacketTypePeerQuitGame,
+	kPacketTypeBatch,
+	kPacketTypeDirectionalDataAcknowledgement,
+	kPacketTypeReliableChannel,
+	kPacketTypeRollbackInputs,
+	kPacketTypePlayerAssignment,
+	kPacketTypeRelayed,
+	kPacketTypeRelayedDirectionalData,
+	kPacketTypePlayerPing,
+	kPacketTypePlayerPingReply
+
+} PacketType;
+
+/*
+ Counts of the traffic sent by a device. Messages are counted as they are sent, i.e. as they would have been
+ sent before unreliable messages were batched together, once for each peer they are sent to. Ship and
+ projectile updates are counted when their replication scheduler chooses them. Packets are counted as they
+ are handed to the transport. Message bytes include the header each message would have needed on it's own.
+ The counters are shared by every link of a device.
+ */
+typedef struct {
+
+	unsigned long totalMessages;
+	unsigned long totalMessageBytes;
+	unsigned long totalPackets;
+	unsigned long totalPacketBytes;
+
+	/*
+	 Packets received from every peer, including their headers, and the messages the hub of a star has relayed
+	 to a leaf. A message relayed to two leaves counts twice.
+	 */
+	unsigned long totalPacketsReceived;
+	unsigned long totalPacketBytesReceived;
+	unsigned long totalMessagesRelayed;
+
+	/*
+	 Rates measured over the last kNetworkTrafficSampleInterval, which are worked out by the
+	 BluetoothCommsManager.
+	 */
+	float messagesPerSecond;
+	float messageBytesPerSecond;
+	float packetsPerSecond;
+	float packetBytesPerSecond;
+	float packetsReceivedPerSecond;
+	float packetBytesReceivedPerSecond;
+
+} NetworkTrafficStatistics;
+
+/*
+ A point on the screen, in points.
+ */
+typedef struct {
+
+	float x;
+	float y;
+
+} NetworkPoint;
+
+/*
+ A ship or projectile update waiting in a link's replication scheduler, encoded as the message it will be
+ sent as. weight is before it is scaled by distance, and from and to are the points the update covers: the
+ position of a ship or the path of a projectile.
+ */
+typedef struct {
+
+	uint8_t messageType;
+	uint8_t length;
+	uint8_t data[kReplicationMaximumUpdateLength];
+	float weight;
+	NetworkPoint from;
+	NetworkPoint to;
+
+} ReplicatedUpdate;
+
+struct NetworkLink;
+
+/*
+ Called with every packet written by a link, header and all, to send it to the peer unreliably.
+ */
+typedef void (*NetworkLinkTransmitFunction)(struct NetworkLink *link, const uint8_t *packet, size_t length, void *context);
+
+typedef struct NetworkLink {
+
+	/*
+	 Identifier for data packets. Packet numbers only order the unreliable messages, the reliable channel
+	 has it's own sequence numbers. Unreliable messages are ignored unless the packet number is greater than
+	 previousPacketNumber.
+	 */
+	int packetNumber;
+	int previousPacketNumber;
+
+	ReliableChannel reliableChannel;
+
+	//Measures the link from the link reports and packet numbers.
+	LinkEstimator linkEstimator;
+
+	//Directional data is sent as changes from the latest state acknowledged by the peer.
+	DirectionalStreamSender directionalSender;
+	DirectionalStreamReceiver directionalReceiver;
+
+	/*
+	 Unreliable messages are queued here and sent together in a single batch packet by NetworkLinkFlush.
+	 */
+	uint8_t outboundMessages[kNetworkDataPacketSize];
+	WireWriter outboundWriter;
+	unsigned int outboundMessageCount;
+
+	/*
+	 Ship and projectile updates wait in the replication scheduler until they are chosen for a batch. Entity
+	 PlayerID - 1 is the ship of that player and the entities from kNetworkLinkMaximumPlayers are projectiles.
+	 Each update is kept in replicatedUpdates, apart from the local ship's, which is encoded against the
+	 directional stream when it is chosen.
+	 */
+	ReplicationScheduler replication;
+	ReplicatedUpdate replicatedUpdates[kReplicationMaximumEntities];
+
+	//Where the packets are sent, and the counters the traffic is added to. Not owned by the link.
+	NetworkLinkTransmitFunction transmit;
+	void *transmitContext;
+	NetworkTrafficStatistics *traffic;
+
+} NetworkLink;
+
+/*
+ Starts the link to a newly connected peer. The reliable channel and directional streams start empty and the
+ peer is treated as just having been heard from.
+ */
+void NetworkLinkInit(NetworkLink *link, NetworkLinkTransmitFunction transmit, void *context, NetworkTrafficStatistics *traffic, double now);
+
+/*
+ Writes the header and data of a packet and hands it to the transmit function. Every packet which is
+ actually sent to the peer goes through here. Packets too long for kNetworkDataPacketSize are dropped.
+ */
+void NetworkLinkTransmit(NetworkLink *link, uint8_t packetType, const void *data, size_t length);
+
+/*
+ Sends a message to the peer. A reliable message is added to the reliable channel, and goes out with the next
+ batch. Returns 0 if the channel's backlog is full, because the peer hasn't acknowledged anything for a long
+ time, so the message can't be delivered. An unreliable message is added to the batch, and if the batch is
+ full it is sent first and the message starts a new one.
+ */
+int NetworkLinkSendMessage(NetworkLink *link, uint8_t messageType, const void *data, size_t length, int reliable);
+
+/*
+ Sends the batch, if it has anything in it, and starts a new one.
+ */
+void NetworkLinkSendBatch(NetworkLink *link);
+
+/*
+ Puts together the batch for a frame and sends it. The replication scheduler chooses the ship and projectile
+ updates with the highest priority which fit in kReplicationDatagramBudget bytes, and the rest wait for a
+ later batch. A link report is added if sendLinkReport is set and one is due, then the reliable channel's
+ acknowledgement and any messages due to be sent or resent.
+
+ localShip is the scheduler entity of the local player's ship, or -1 before the players have been decided,
+ and localShipInformation it's latest data. receiverShip is the position of the ship of the player the
+ updates go to, or NULL if it isn't known.
+ */
+void NetworkLinkFlush(NetworkLink *link, int localShip, const PlayerShipDirectionalInformation *localShipInformation,
+					  const NetworkPoint *receiverShip, int sendLinkReport, double now);
+
+/*
+ Fills in a ship or projectile update which is to wait in the replication schedulers. Returns 0 if the data
+ is too long to be kept, in which case it must be sent straight away.
+ */
+int NetworkLinkSetUpUpdate(ReplicatedUpdate *update, uint8_t messageType, const void *data, size_t length, float weight, NetworkPoint from, NetworkPoint to);
+
+/*
+ Scales the weight of an update by the distance between the receiving player's ship and the nearest point
+ the update covers, so that ships and projectiles close to it are sent first. Updates keep their full weight
+ while the receiving ship's position isn't known.
+ */
+float NetworkLinkUpdateWeight(const ReplicatedUpdate *update, const NetworkPoint *receiverShip);
+
+/*
+ Puts an update in the replication scheduler as the entity specified, replacing any update of that entity
+ which is still waiting.
+ */
+void NetworkLinkScheduleUpdate(NetworkLink *link, const ReplicatedUpdate *update, int entity, const NetworkPoint *receiverShip, double now);
+
+/*
+ Puts a projectile in the first projectile entity which has nothing waiting. Returns 0 if they are all
+ waiting, in which case the projectile must be sent straight away.
+ */
+int NetworkLinkScheduleProjectile(NetworkLink *link, const ReplicatedUpdate *update, const NetworkPoint *receiverShip, double now);
+
+/*
+ Marks the local ship as having new data to send. It is encoded when the batch is put together.
+ */
+void NetworkLinkLocalShipChanged(NetworkLink *link, int localShip, double now);
+
+/*
+ Sends a projectile fired by the local player. It waits in the scheduler unless every projectile entity is
+ already waiting, in which case it is queued straight away.
+ */
+void NetworkLinkSendProjectile(NetworkLink *link, const ProjectileDetails *details, const NetworkPoint *receiverShip, double now);
+
+/*
+ Used by the hub of a star to pass a message from the player specified on to the peer, with the same
+ reliability, wrapped in a Relayed message which says which player it came from. Unreliable projectiles wait
+ in the scheduler like the hub's own. The reader isn't moved. Returns 0 if a reliable message couldn't be
+ queued, as NetworkLinkSendMessage does.
+ */
+int NetworkLinkRelayMessage(NetworkLink *link, int player, uint8_t messageType, const WireReader *reader, int reliable,
+							const NetworkPoint *receiverShip, double now);
+
+/*
+ Used by the hub of a star to pass the directional data of the player specified on to the peer. It is sent
+ in full rather than as changes, because the directional streams only run between the two ends of a link,
+ and waits in the scheduler as the update of that player's ship, replacing any older data which hasn't
+ been sent yet.
+ */
+void NetworkLinkRelayDirectionalData(NetworkLink *link, int player, const PlayerShipDirectionalInformation *information,
+									 const NetworkPoint *receiverShip, double now);
+
+/*
+ Records the arrival of a packet with the header specified and dataLength bytes of data. Every packet counts
+ towards the link estimate, including those which turn out to be out of date. Returns 1 if the unreliable
+ messages in the packet should be handled, or 0 if it arrived after a newer packet or is a duplicate of one
+ already received. The reliable channel has it's own sequence numbers, so it's messages are always read.
+ */
+int NetworkLinkPacketReceived(NetworkLink *link, const WirePacketHeader *header, size_t dataLength, double now);
+
+/*
+ Reads a directional data message from the peer's stream. Returns 1 if it was decoded, in which case it is
+ acknowledged when an acknowledgement is due, so that the peer can use it as the baseline for later messages.
+ */
+int NetworkLinkReceiveDirectionalData(NetworkLink *link, WireReader *reader, PlayerShipDirectionalInformation *information);
+
+/*
+ Reads the peer's acknowledgement of a directional data message.
+ */
+void NetworkLinkReceiveDirectionalAcknowledgement(NetworkLink *link, WireReader *reader);
+
+#endif // __NETWORK_LINK_H__
@@ -0,0 +1,63 @@
+//
+//  NetworkTransport.h
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The NetworkTransport protocol is the interface between the BluetoothCommsManager and whatever actually
+ carries it's packets to the other device. The BluetoothCommsManager only sends and receives NSData
+ packets through this interface, so the same multiplayer code can run over a GameKit session, over a
+ LoopbackTransport within a single process or over a UDPTransport between two processes.
+
+ Transports deliver peer state changes to their delegate on the main thread, in the same way that GKSession
+ does. Received data may be delivered on another thread, such as a thread which only receives packets, but
+ only ever on one thread at a time.
+ */
+
+#import <Foundation/Foundation.h>
+
+@protocol NetworkTransport;
+
+/*
+ Implemented by the object which receives the packets, normally the BluetoothCommsManager.
+ */
+@protocol NetworkTransportDelegate <NSObject>
+
+/*
+ Called when a packet is received from a peer. May be called on a thread other than the main thread.
+ */
+- (void)transport:(id<NetworkTransport>)transport receivedData:(NSData *)data fromPeer:(NSString *)peerID;
+
+/*
+ Called when a peer disconnects.
+ */
+- (void)transport:(id<NetworkTransport>)transport peerDisconnected:(NSString *)peerID;
+
+/*
+ Called when the transport fails and can no longer be used.
+ */
+- (void)transport:(id<NetworkTransport>)transport failedWithError:(NSError *)error;
+
+@end
+
+@protocol NetworkTransport <NSObject>
+
+/*
+ Starts delivering received packets and peer state changes to the delegate. The delegate is not retained.
+ */
+- (void)startWithDelegate:(id<NetworkTransportDelegate>)delegate;
+
+/*
+ Sends a packet to the peers specified. Reliable packets are delivered once and in order, unreliable
+ packets may be lost, duplicated or reordered.
+ */
+- (void)sendData:(NSData *)data toPeers:(NSArray *)peerIDs reliable:(BOOL)reliable;
+
+/*
+ Disconnects from every peer. Nothing is delivered to the delegate afterwards.
+ */
+- (void)stop;
+
+@end
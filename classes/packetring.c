@@ -0,0 +1,103 @@
+//
+//  PacketRing.c
+//  AberFighter
+//
+//  Created by wde7 on 14/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include "PacketRing.h"
+
+/*
+ Full memory barrier, as used by the NetworkEventQueue.
+ */
+#define PacketRingBarrier() __sync_synchronize()
+
+void PacketRingInit(PacketRing *ring) {
+
+	ring->writeCount = 0;
+	ring->readCount = 0;
+	ring->droppedPackets = 0;
+
+}
+
+int PacketRingPush(PacketRing *ring, const uint8_t *bytes, size_t length, int source, double receiveTime) {
+
+	WireReader reader;
+	WirePacketHeader header;
+
+	if (length > kPacketRingMaximumPacketSize) {
+		return 0;
+	}
+
+	WireReaderInit(&reader, bytes, length);
+
+	if (!WireReadHeader(&reader, &header)) {
+		return 0;
+	}
+
+	uint32_t writeCount = ring->writeCount;
+
+	PacketRingBarrier();
+
+	if (writeCount - ring->readCount >= kPacketRingCapacity) {
+
+		ring->droppedPackets++;
+		return 0;
+
+	}
+
+	ReceivedPacket *packet = &ring->packets[writeCount & (kPacketRingCapacity - 1)];
+
+	packet->header = header;
+	packet->source = source;
+	packet->receiveTime = receiveTime;
+	packet->dataLength = WireReaderRemaining(&reader);
+	memcpy(packet->data, &bytes[reader.position], packet->dataLength);
+
+	PacketRingBarrier();
+
+	ring->writeCount = writeCount + 1;
+
+	return 1;
+
+}
+
+const ReceivedPacket *PacketRingPeek(PacketRing *ring) {
+
+	uint32_t readCount = ring->readCount;
+
+	if (readCount == ring->writeCount) {
+		return NULL;
+	}
+
+	PacketRingBarrier();
+
+	return &ring->packets[readCount & (kPacketRingCapacity - 1)];
+
+}
+
+void PacketRingRelease(PacketRing *ring) {
+
+	uint32_t readCount = ring->readCount;
+
+	if (readCount == ring->writeCount) {
+		return;
+	}
+
+	PacketRingBarrier();
+
+	ring->readCount = readCount + 1;
+
+}
+
+void PacketRingDiscard(PacketRing *ring) {
+
+	uint32_t writeCount = ring->writeCount;
+
+	PacketRingBarrier();
+
+	ring->readCount = writeCount;
+
+}
@@ -0,0 +1,96 @@
+//
+//  PacketRing.h
+//  AberFighter
+//
+//  Created by wde7 on 14/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The PacketRing hands received packets from the thread the transport delivers them on to the game loop,
+ which applies them at the start of each frame. Before it was added, packets were applied as soon as they
+ arrived, in between frames, and a burst of packets held up the next frame until they had all been handled.
+
+ The header of each packet is decoded as it is pushed, on the receiving thread. Packets whose header can't
+ be read, or which were written with a different version of the WireProtocol, never reach the game loop.
+ The rest of the packet is copied into a fixed size slot and decoded by the game loop, because decoding
+ the reliable channel and directional data depends on state which is shared with the sending side.
+
+ The ring has a single producer and a single consumer, which may be on different threads, and works in
+ the same way as the NetworkEventQueue. Packets are read in place, so a slot is only reused once the
+ consumer has released it.
+
+ The ring is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __PACKET_RING_H__
+#define __PACKET_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WireProtocol.h"
+
+/*
+ Number of packets which can be waiting. Must be a power of 2. The game loop empties the ring every frame,
+ so it only fills if the radio delivers more than this many packets in a single frame.
+ */
+#define kPacketRingCapacity 64
+
+/*
+ Largest packet which can be pushed, including it's header. Must be at least kNetworkDataPacketSize.
+ */
+#define kPacketRingMaximumPacketSize 1024
+
+/*
+ A packet waiting in the ring. source is the index of the peer it came from and data holds the bytes which
+ followed the header.
+ */
+typedef struct {
+
+	WirePacketHeader header;
+	int source;
+	double receiveTime;
+	size_t dataLength;
+	uint8_t data[kPacketRingMaximumPacketSize];
+
+} ReceivedPacket;
+
+typedef struct {
+
+	ReceivedPacket packets[kPacketRingCapacity];
+
+	//Total packets pushed and released. Only the producer writes writeCount and only the consumer writes readCount.
+	volatile uint32_t writeCount;
+	volatile uint32_t readCount;
+
+	//Packets which were pushed while the ring was full. Only written by the producer.
+	unsigned long droppedPackets;
+
+} PacketRing;
+
+void PacketRingInit(PacketRing *ring);
+
+/*
+ Decodes the header of a packet and copies it into the ring, with the peer it came from and the time it was
+ received. Returns 0 and drops the packet if it's header is invalid, it is too large or the ring is full. Only
+ called by the producer.
+ */
+int PacketRingPush(PacketRing *ring, const uint8_t *bytes, size_t length, int source, double receiveTime);
+
+/*
+ Returns the oldest packet in the ring without removing it, or NULL if the ring is empty. The packet stays
+ valid until PacketRingRelease is called. Only called by the consumer.
+ */
+const ReceivedPacket *PacketRingPeek(PacketRing *ring);
+
+/*
+ Removes the packet returned by PacketRingPeek. Does nothing if the ring has been discarded since. Only called
+ by the consumer.
+ */
+void PacketRingRelease(PacketRing *ring);
+
+/*
+ Throws away every packet in the ring. Only called by the consumer.
+ */
+void PacketRingDiscard(PacketRing *ring);
+
+#endif // __PACKET_RING_H__
@@ -0,0 +1,181 @@
+//
+//  PlayerElection.c
+//  AberFighter
+//
+//  Created by wde7 on 17/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include "PlayerElection.h"
+#include "Simulation.h"
+
+void PlayerElectionInit(PlayerElection *election) {
+
+	memset(election, 0, sizeof(PlayerElection));
+
+}
+
+int PlayerElectionAddPeer(PlayerElection *election) {
+
+	int peer = election->numberOfPeers;
+
+	if (peer >= kPlayerElectionMaximumPlayers - 1) {
+		return -1;
+	}
+
+	election->peerRolls[peer] = 0;
+	election->peerRollReceived[peer] = 0;
+	election->peerAcknowledged[peer] = 0;
+	election->numberOfPeers++;
+
+	return peer;
+
+}
+
+void PlayerElectionRoll(PlayerElection *election, uint32_t round, uint32_t localRoll) {
+
+	if (round < election->round) {
+		return;
+	}
+
+	if (round > election->round) {
+
+		election->round = round;
+		memset(election->peerRolls, 0, sizeof(election->peerRolls));
+		memset(election->peerRollReceived, 0, sizeof(election->peerRollReceived));
+
+	}
+
+	election->hasLocalRoll = 1;
+	election->localRoll = localRoll;
+	memset(election->peerAcknowledged, 0, sizeof(election->peerAcknowledged));
+
+}
+
+PlayerElectionRollResult PlayerElectionRollReceived(PlayerElection *election, int peer, uint32_t round, uint32_t roll) {
+
+	if (peer < 0 || peer >= election->numberOfPeers || round < election->round) {
+		return kPlayerElectionRollIgnored;
+	}
+
+	if (round > election->round) {
+		return kPlayerElectionRollFromLaterRound;
+	}
+
+	if (election->peerRollReceived[peer]) {
+		return kPlayerElectionRollIgnored;
+	}
+
+	election->peerRolls[peer] = roll;
+	election->peerRollReceived[peer] = 1;
+
+	return kPlayerElectionRollAccepted;
+
+}
+
+void PlayerElectionAcknowledgementReceived(PlayerElection *election, int peer, uint32_t round, uint32_t roll) {
+
+	if (peer >= 0 && peer < election->numberOfPeers && election->hasLocalRoll &&
+		round == election->round && roll == election->localRoll) {
+		election->peerAcknowledged[peer] = 1;
+	}
+
+}
+
+int PlayerElectionHasAllRolls(const PlayerElection *election) {
+
+	for (int i = 0; i < election->numberOfPeers; i++) {
+
+		if (!election->peerRollReceived[i]) {
+			return 0;
+		}
+
+	}
+
+	return 1;
+
+}
+
+int PlayerElectionIsComplete(const PlayerElection *election) {
+
+	if (!election->hasLocalRoll || !PlayerElectionHasAllRolls(election)) {
+		return 0;
+	}
+
+	for (int i = 0; i < election->numberOfPeers; i++) {
+
+		if (!election->peerAcknowledged[i]) {
+			return 0;
+		}
+
+	}
+
+	return 1;
+
+}
+
+/*
+ The PlayerID of a roll is one more than the number of rolls which are higher than it.
+ */
+static int PlayerElectionRank(const int *rolls, int count, int roll) {
+
+	int higher = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		if (rolls[i] > roll) {
+			higher++;
+		}
+
+	}
+
+	return higher + 1;
+
+}
+
+int PlayerElectionDecide(const PlayerElection *election, int *localPlayer, int *peerPlayers, uint32_t *seed) {
+
+	int count = election->numberOfPeers + 1;
+	int rolls[kPlayerElectionMaximumPlayers];
+	int sortedRolls[kPlayerElectionMaximumPlayers];
+
+	/*
+	 Rolls are below a million, so they are kept as ints to give the same seed as the original two player die roll.
+	 */
+	rolls[0] = (int)election->localRoll;
+
+	for (int i = 0; i < election->numberOfPeers; i++) {
+		rolls[i + 1] = (int)election->peerRolls[i];
+	}
+
+	/*
+	 Each roll goes in the position of it's rank, so two rolls which are the same end up in the same position.
+	 */
+	for (int i = 0; i < count; i++) {
+		sortedRolls[i] = -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+
+		int position = PlayerElectionRank(rolls, count, rolls[i]) - 1;
+
+		if (sortedRolls[position] != -1) {
+			return 0;
+		}
+
+		sortedRolls[position] = rolls[i];
+
+	}
+
+	*localPlayer = PlayerElectionRank(rolls, count, rolls[0]);
+
+	for (int i = 0; i < election->numberOfPeers; i++) {
+		peerPlayers[i] = PlayerElectionRank(rolls, count, rolls[i + 1]);
+	}
+
+	*seed = SimulationHash(kSimulationHashOffsetBasis, sortedRolls, count * sizeof(int));
+
+	return 1;
+
+}
@@ -0,0 +1,113 @@
+//
+//  PlayerElection.h
+//  AberFighter
+//
+//  Created by wde7 on 17/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The PlayerElection decides the PlayerID of every device in a game of up to kPlayerElectionMaximumPlayers
+ players with a die roll. Each device rolls a large random number and sends it to each of it's peers, which
+ acknowledge it. Once a device has every peer's roll and every peer has acknowledged it's own, the device
+ with the highest roll is player 1, the next highest player 2 and so on. Every device which can see all of the
+ rolls works out the same order, so nothing else needs to be sent.
+
+ If any two rolls are the same the order can't be decided, and the election starts again with a new round.
+ Rolls and acknowledgements carry the round they belong to. A device which receives a roll from a later
+ round than it's own has missed the restart, so it joins that round with a new roll, and anything from an
+ earlier round is ignored.
+
+ The match seed is a hash of the rolls from the highest to the lowest, so every device agrees on it without
+ it being sent. With two players it is the same seed the die roll has always produced.
+
+ The election is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __PLAYER_ELECTION_H__
+#define __PLAYER_ELECTION_H__
+
+#include <stdint.h>
+
+/*
+ Most devices which can take part in an election, including the local device. Must be at least
+ kMaximumNumberOfPlayers.
+ */
+#define kPlayerElectionMaximumPlayers 4
+
+/*
+ Returned by PlayerElectionRollReceived.
+ */
+typedef enum {
+
+	//The roll was from an earlier round, or repeated one already received, and was ignored.
+	kPlayerElectionRollIgnored,
+	//The roll was added to the current round.
+	kPlayerElectionRollAccepted,
+	//The roll was from a later round. The local device must join it with PlayerElectionRoll and a new roll, then add the roll again.
+	kPlayerElectionRollFromLaterRound
+
+} PlayerElectionRollResult;
+
+typedef struct {
+
+	uint32_t round;
+	int numberOfPeers;
+
+	//The local roll for the current round, if the local device has rolled.
+	int hasLocalRoll;
+	uint32_t localRoll;
+
+	//Each peer's roll for the current round, and whether it has arrived and the peer has acknowledged the local roll.
+	uint32_t peerRolls[kPlayerElectionMaximumPlayers - 1];
+	uint8_t peerRollReceived[kPlayerElectionMaximumPlayers - 1];
+	uint8_t peerAcknowledged[kPlayerElectionMaximumPlayers - 1];
+
+} PlayerElection;
+
+/*
+ Starts an election in the first round, with no peers and without a local roll.
+ */
+void PlayerElectionInit(PlayerElection *election);
+
+/*
+ Adds a peer to the election and returns it's number, or -1 if there are already
+ kPlayerElectionMaximumPlayers - 1 peers. Peers are numbered from 0 in the order they are added.
+ */
+int PlayerElectionAddPeer(PlayerElection *election);
+
+/*
+ Sets the local roll for the round specified. Moving to a later round forgets every roll and
+ acknowledgement from the previous round. Rolling again in the current round keeps the rolls received from
+ the peers but not their acknowledgements, which were for the old roll. Earlier rounds are ignored.
+ */
+void PlayerElectionRoll(PlayerElection *election, uint32_t round, uint32_t localRoll);
+
+/*
+ Adds a roll received from a peer.
+ */
+PlayerElectionRollResult PlayerElectionRollReceived(PlayerElection *election, int peer, uint32_t round, uint32_t roll);
+
+/*
+ Records that a peer has acknowledged a roll. Ignored unless it is the local roll for the current round.
+ */
+void PlayerElectionAcknowledgementReceived(PlayerElection *election, int peer, uint32_t round, uint32_t roll);
+
+/*
+ Returns non-zero if every peer's roll for the current round has arrived.
+ */
+int PlayerElectionHasAllRolls(const PlayerElection *election);
+
+/*
+ Returns non-zero if the local device has rolled, every peer's roll has arrived and every peer has
+ acknowledged the local roll.
+ */
+int PlayerElectionIsComplete(const PlayerElection *election);
+
+/*
+ Decides the PlayerIDs from the rolls of the current round, which must all have arrived. localPlayer is set
+ to the local device's PlayerID, peerPlayers to each peer's and seed to the match seed. Returns 0 without
+ setting anything if two rolls are the same, in which case a new round must be started.
+ */
+int PlayerElectionDecide(const PlayerElection *election, int *localPlayer, int *peerPlayers, uint32_t *seed);
+
+#endif // __PLAYER_ELECTION_H__
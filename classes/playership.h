@@ -69,6 +69,17 @@
 @property (nonatomic,readwrite,assign) int maximumSpeed;
 @property (nonatomic,readwrite,assign) int playerID;
 
+/*
+ Name of the sprite frame for the ship of the player specified. There are only frames for players 1 and 2, so
+ players 3 and 4 reuse them and are told apart by the tint returned by tintForPlayer.
+ */
++ (NSString *)spriteFrameNameForPlayer:(int)player;
+
+/*
+ Colour the ship of the player specified is tinted with. White, i.e. untinted, for players 1 and 2.
+ */
++ (ccColor3B)tintForPlayer:(int)player;
+
 /*
  Sets the new position and rotation of the ship. Should be called each frame.
  */
@@ -80,4 +91,10 @@
  */
 - (void)applyDirectionalChangesWithNewHeading:(float)newHeading newSpeed:(float)newSpeed;
 
+/*
+ Sets whether the ship is disabled and invincible when the damage is worked out elsewhere, e.g. by the
+ Simulation of a rollback game. Unlike disableShip, nothing is scheduled to reactivate the ship.
+ */
+- (void)setShipDisabled:(BOOL)disabled invincible:(BOOL)isInvincible;
+
 @end
@@ -40,6 +40,29 @@
 	
 }
 
++ (NSString *)spriteFrameNameForPlayer:(int)player {
+	
+	return (player % 2 == 0) ? @"ship_2.png" : @"ship_1.png";
+	
+}
+
++ (ccColor3B)tintForPlayer:(int)player {
+	
+	if (player > 2) {
+		return ccc3(255, 200, 60);
+	}
+	
+	return ccWHITE;
+	
+}
+
+- (void)setShipDisabled:(BOOL)disabled invincible:(BOOL)isInvincible {
+	
+	shipDisabled = disabled;
+	invincible = isInvincible;
+	
+}
+
 /*
  Called from reduceShieldStrength when currentShieldStrength reaches 0. Sets shipDisabled and invincible to true 
  and stops the ship. Then schedules to re-activate the ship after a short period of time. 
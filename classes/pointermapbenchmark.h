@@ -0,0 +1,54 @@
+//
+//  PointerMapBenchmark.h
+//  AberFighter
+//
+//  Created by wde7 on 20/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The PointerMapBenchmark compares the ccPointerMap which the CCScheduler and CCActionManager find their
+ targets with against the uthash tables they used before, with as many targets as a game has nodes. Each
+ run looks up targets in a random order, as runAction: and schedule: do, and removes and adds targets again,
+ as happens whenever a projectile or target is cleared up and another spawned. The mean time of a lookup and
+ of a removal and addition with each table are logged and kept in the result.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*
+ When kPointerMapBenchmarkOnLaunch is 1 the benchmark is run with several numbers of targets when the app
+ launches, and the results are logged.
+ */
+#define kPointerMapBenchmarkOnLaunch	0
+//Lookups timed in each run.
+#define kPointerMapBenchmarkLookups		200000
+//Removals and additions timed in each run.
+#define kPointerMapBenchmarkChurns		20000
+
+typedef struct {
+
+	int targets;
+
+	//Seconds taken by a lookup, and by removing a target and adding it again, with each table.
+	double uthashLookupTime;
+	double pointerMapLookupTime;
+	double uthashChurnTime;
+	double pointerMapChurnTime;
+
+} PointerMapBenchmarkResult;
+
+@interface PointerMapBenchmark : NSObject {
+
+}
+
+/*
+ Runs the benchmark with 32, 128 and 512 targets and logs the results.
+ */
++ (void)compareNumbersOfTargets;
+
+/*
+ Runs the benchmark once with the number of targets specified and logs the result.
+ */
++ (PointerMapBenchmarkResult)runWithTargets:(int)numberOfTargets;
+
+@end
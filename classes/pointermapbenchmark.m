@@ -0,0 +1,131 @@
+//
+//  PointerMapBenchmark.m
+//  AberFighter
+//
+//  Created by wde7 on 20/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "PointerMapBenchmark.h"
+#import "uthash.h"
+#import "ccPointerMap.h"
+
+/*
+ An element of the uthash table, keyed on the target in the same way as the CCScheduler and CCActionManager
+ elements were.
+ */
+typedef struct {
+
+	id target;
+	UT_hash_handle hh;
+
+} PointerMapBenchmarkElement;
+
+@implementation PointerMapBenchmark
+
++ (void)compareNumbersOfTargets {
+
+	[self runWithTargets:32];
+	[self runWithTargets:128];
+	[self runWithTargets:512];
+
+}
+
++ (PointerMapBenchmarkResult)runWithTargets:(int)numberOfTargets {
+
+	PointerMapBenchmarkResult result;
+	NSMutableArray *targets = [[NSMutableArray alloc] initWithCapacity:numberOfTargets];
+	PointerMapBenchmarkElement *elements = calloc(numberOfTargets, sizeof(PointerMapBenchmarkElement));
+	int *order = malloc(kPointerMapBenchmarkLookups * sizeof(int));
+	PointerMapBenchmarkElement *table = NULL;
+	ccPointerMap *map = ccPointerMapNew(numberOfTargets);
+	unsigned long found = 0;
+	uint32_t random = 1;
+
+	/*
+	 The targets are looked up in the same random order with both tables, worked out beforehand so that it
+	 isn't timed.
+	 */
+	for (int i = 0; i < kPointerMapBenchmarkLookups; i++) {
+
+		random = random * 1664525u + 1013904223u;
+		order[i] = (int)((random >> 8) % (uint32_t)numberOfTargets);
+
+	}
+
+	for (int i = 0; i < numberOfTargets; i++) {
+
+		NSObject *target = [[NSObject alloc] init];
+		PointerMapBenchmarkElement *element = &elements[i];
+
+		[targets addObject:target];
+		element->target = target;
+		HASH_ADD_INT(table, target, element);
+		ccPointerMapSet(map, target, element);
+		[target release];
+
+	}
+
+	CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kPointerMapBenchmarkLookups; i++) {
+
+		PointerMapBenchmarkElement *element = NULL;
+		id target = elements[order[i]].target;
+
+		HASH_FIND_INT(table, &target, element);
+		found += (element != NULL);
+
+	}
+
+	result.uthashLookupTime = (CFAbsoluteTimeGetCurrent() - startTime) / kPointerMapBenchmarkLookups;
+	startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kPointerMapBenchmarkLookups; i++) {
+		found += (ccPointerMapGet(map, elements[order[i]].target) != NULL);
+	}
+
+	result.pointerMapLookupTime = (CFAbsoluteTimeGetCurrent() - startTime) / kPointerMapBenchmarkLookups;
+	startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kPointerMapBenchmarkChurns; i++) {
+
+		PointerMapBenchmarkElement *element = &elements[order[i]];
+
+		HASH_DEL(table, element);
+		HASH_ADD_INT(table, target, element);
+
+	}
+
+	result.uthashChurnTime = (CFAbsoluteTimeGetCurrent() - startTime) / kPointerMapBenchmarkChurns;
+	startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kPointerMapBenchmarkChurns; i++) {
+
+		PointerMapBenchmarkElement *element = &elements[order[i]];
+
+		ccPointerMapRemove(map, element->target);
+		ccPointerMapSet(map, element->target, element);
+
+	}
+
+	result.pointerMapChurnTime = (CFAbsoluteTimeGetCurrent() - startTime) / kPointerMapBenchmarkChurns;
+	result.targets = numberOfTargets;
+
+	HASH_CLEAR(hh, table);
+	ccPointerMapFree(map);
+	free(order);
+	free(elements);
+	[targets release];
+
+	NSLog(@"Target lookups with %d targets (%lu found): uthash %.1f ns, ccPointerMap %.1f ns. "
+		  @"Removing and adding a target: uthash %.1f ns, ccPointerMap %.1f ns",
+		  result.targets, found,
+		  result.uthashLookupTime * 1.0e9, result.pointerMapLookupTime * 1.0e9,
+		  result.uthashChurnTime * 1.0e9, result.pointerMapChurnTime * 1.0e9);
+
+	return result;
+
+}
+
+@end
@@ -0,0 +1,112 @@
+//
+//  ProjectileSystem.h
+//  AberFighter
+//
+//  Created by wde7 on 28/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The ProjectileSystem owns every Projectile used by an ActionLayer. A fixed number of Projectile sprites are
+ created and added to the spritesheet when the system is initialised. Firing takes a hidden sprite from the
+ pool and makes it visible, and expiring a projectile hides it and returns it to the pool, so firing doesn't
+ allocate any memory or create any actions however quickly the players shoot.
+
+ Active projectiles travel in straight lines, so rather than running a CCMoveBy action on each one their
+ positions are kept in an EntityStore and moved together once per frame by update:. A projectile expires
+ when it has existed for the lifetime of the system or when it leaves the screen, whichever happens first.
+ */
+
+#import <Foundation/Foundation.h>
+#import "cocos2d.h"
+#import "Projectile.h"
+#import "EntityStore.h"
+#import "GameConstants.h"
+
+/*
+ Number of projectiles which can be active at once, enough for every player to fire continuously at the
+ framerate.
+ */
+#define kProjectileSystemCapacity kGameMaximumActiveProjectiles
+
+@interface ProjectileSystem : NSObject {
+
+	/*
+	 The spritesheet which the projectile sprites belong to. Not retained, the layer owns it.
+	 */
+	CCSpriteSheet *spriteSheet;
+
+	/*
+	 Every sprite created by the system, and a stack of the ones which are not currently active.
+	 */
+	Projectile **projectileSprites;
+	Projectile **availableProjectiles;
+	unsigned int availableCount;
+	unsigned int capacity;
+
+	/*
+	 Position and movement of the active projectiles. The view of each entry is it's Projectile and each
+	 Projectile's entityIndex identifies it's entry.
+	 */
+	EntityStore *activeProjectiles;
+
+	/*
+	 Seconds before an active projectile expires.
+	 */
+	float lifetime;
+
+	/*
+	 Projectiles are expired when they are further than their radius outside of this area.
+	 */
+	CGSize worldSize;
+
+}
+
+/*
+ Property declarations for the instance variables.
+ */
+@property (nonatomic,readonly) unsigned int capacity;
+@property (nonatomic,readonly) float lifetime;
+
+/*
+ Initializer method. Creates capacity hidden Projectile sprites and adds them to the spritesheet.
+ */
+- (id)initWithSpriteSheet:(CCSpriteSheet *)sheet capacity:(unsigned int)newCapacity lifetime:(float)newLifetime;
+
+/*
+ Activates a projectile at the starting position which will travel with the velocity specified, in points
+ per second. Returns the projectile, or nil if every projectile is already active or the velocity is zero,
+ as a projectile which doesn't move would sit on the screen until it expired.
+ */
+- (Projectile *)fireProjectileWithStartingPosition:(CGPoint)startingPosition velocity:(CGPoint)velocity playerID:(int)playerID;
+
+/*
+ Moves every active projectile and expires the ones which have reached the end of their lifetime or left
+ the screen. Should be called once per frame.
+ */
+- (void)update:(ccTime)timeSinceLastUpdate;
+
+/*
+ Makes the active projectiles match the entities in a store which is moved by something else, such as the
+ Simulation run by a RollbackSession. Projectiles are activated or removed until there is one for each
+ entity, then each is moved to it's entity. update: must not be called as well.
+ */
+- (void)updateWithEntityStore:(const EntityStore *)store;
+
+/*
+ Hides an active projectile and returns it to the pool. Projectiles which are not active are ignored.
+ */
+- (void)removeProjectile:(Projectile *)projectile;
+
+/*
+ Returns every active projectile to the pool.
+ */
+- (void)removeAllProjectiles;
+
+/*
+ Number of projectiles currently active, and access to them by index. Indices change when projectiles
+ are removed.
+ */
+- (unsigned int)count;
+- (Projectile *)projectileAtIndex:(unsigned int)index;
+
+@end
@@ -0,0 +1,258 @@
+//
+//  ProjectileSystem.m
+//  AberFighter
+//
+//  Created by wde7 on 28/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "ProjectileSystem.h"
+#import "GameConstants.h"
+
+@implementation ProjectileSystem
+
+/*
+ Automatically creates the getter methods for the properties defined in the header file.
+ */
+@synthesize capacity;
+@synthesize lifetime;
+
+/*
+ Initializer method. Every sprite is created here, hidden and added to the spritesheet, so that
+ nothing needs to be allocated while the game is running.
+ */
+- (id)initWithSpriteSheet:(CCSpriteSheet *)sheet capacity:(unsigned int)newCapacity lifetime:(float)newLifetime {
+
+	if ((self = [super init])) {
+
+		spriteSheet = sheet;
+		capacity = newCapacity;
+		lifetime = newLifetime;
+		worldSize = [CCDirector sharedDirector].winSize;
+
+		projectileSprites = (Projectile **)calloc(capacity, sizeof(Projectile *));
+		availableProjectiles = (Projectile **)calloc(capacity, sizeof(Projectile *));
+		activeProjectiles = EntityStoreNew(capacity);
+
+		NSAssert(projectileSprites && availableProjectiles && activeProjectiles, @"ProjectileSystem: not enough memory");
+
+		for (unsigned int i = 0; i < capacity; i++) {
+
+			Projectile *projectile = [[Projectile alloc] initWithSpriteFrameName:@"projectile.png"];
+
+			NSAssert(projectile.contentSize.width == kGameProjectileImageSize,
+					 @"ProjectileSystem: projectile.png isn't the size in GameConstants.h, which the Simulation uses");
+
+			/*
+			 The tag assigned to projectiles is 1 to differentiate it from a TargetShip or other objects.
+			 */
+			projectile.tag = 1;
+			projectile.visible = NO;
+			[spriteSheet addChild:projectile];
+
+			projectileSprites[i] = projectile;
+			availableProjectiles[i] = projectile;
+
+		}
+
+		availableCount = capacity;
+
+	}
+
+	return self;
+
+}
+
+/*
+ Takes a sprite from the pool and adds an entry for it to the store. The caller has checked that a sprite is
+ available.
+ */
+- (Projectile *)activateProjectileWithStartingPosition:(CGPoint)startingPosition heading:(float)heading speed:(float)speed playerID:(int)playerID {
+
+	availableCount--;
+	Projectile *projectile = availableProjectiles[availableCount];
+
+	projectile.entityIndex = EntityStoreAdd(activeProjectiles,
+											startingPosition.x,
+											startingPosition.y,
+											heading,
+											speed,
+											projectile.contentSize.width / 2,
+											1,
+											playerID,
+											0,
+											projectile);
+
+	//originatingPlayerID is used during collision detection to ensure that a player isn't
+	//damaged by their own projectiles.
+	projectile.originatingPlayerID = playerID;
+	projectile.hasCollided = NO;
+	projectile.position = startingPosition;
+	projectile.rotation = heading;
+	projectile.visible = YES;
+
+	return projectile;
+
+}
+
+- (Projectile *)fireProjectileWithStartingPosition:(CGPoint)startingPosition velocity:(CGPoint)velocity playerID:(int)playerID {
+
+	float speed = ccpLength(velocity);
+
+	//A NaN speed fails the comparison as well as a zero one.
+	if (availableCount == 0 || !(speed > 0.0f)) {
+		return nil;
+	}
+
+	/*
+	 The heading uses the same convention as Ship, 0 degrees is up the screen and headings increase clockwise.
+	 */
+	float heading = CC_RADIANS_TO_DEGREES(atan2f(velocity.x, velocity.y));
+
+	return [self activateProjectileWithStartingPosition:startingPosition heading:heading speed:speed playerID:playerID];
+
+}
+
+/*
+ Returns true if the entity is further than it's radius outside of the screen.
+ */
+static inline BOOL projectileIsOffscreen(EntityStore *store, unsigned int index, CGSize worldSize) {
+
+	float x = store->positionX[index];
+	float y = store->positionY[index];
+	float radius = store->radius[index];
+
+	return (x < -radius || x > worldSize.width + radius || y < -radius || y > worldSize.height + radius);
+
+}
+
+- (void)update:(ccTime)timeSinceLastUpdate {
+
+	EntityStoreIntegrate(activeProjectiles, timeSinceLastUpdate);
+
+	/*
+	 The store is walked backwards so that the entity moved into an expired projectile's slot has
+	 already been checked.
+	 */
+	for (unsigned int i = activeProjectiles->count; i > 0; i--) {
+
+		unsigned int index = i - 1;
+
+		if (activeProjectiles->age[index] >= lifetime || projectileIsOffscreen(activeProjectiles, index, worldSize)) {
+
+			[self removeProjectile:(Projectile *)activeProjectiles->views[index]];
+
+		} else {
+
+			Projectile *projectile = (Projectile *)activeProjectiles->views[index];
+			projectile.position = ccp(activeProjectiles->positionX[index], activeProjectiles->positionY[index]);
+
+		}
+
+	}
+
+}
+
+- (void)updateWithEntityStore:(const EntityStore *)store {
+
+	while (activeProjectiles->count > store->count) {
+
+		[self removeProjectile:(Projectile *)activeProjectiles->views[activeProjectiles->count - 1]];
+
+	}
+
+	while (activeProjectiles->count < store->count && availableCount > 0) {
+
+		[self activateProjectileWithStartingPosition:CGPointZero heading:0.0f speed:0.0f playerID:0];
+
+	}
+
+	/*
+	 Entities are removed from the store by swapping, so a projectile may be showing a different entity from
+	 the one it showed on the last frame. Every field which affects how it is drawn is copied.
+	 */
+	for (unsigned int i = 0; i < activeProjectiles->count; i++) {
+
+		Projectile *projectile = (Projectile *)activeProjectiles->views[i];
+
+		activeProjectiles->positionX[i] = store->positionX[i];
+		activeProjectiles->positionY[i] = store->positionY[i];
+		activeProjectiles->owner[i] = store->owner[i];
+		EntityStoreSetHeading(activeProjectiles, i, store->heading[i]);
+
+		projectile.originatingPlayerID = store->owner[i];
+		projectile.position = ccp(store->positionX[i], store->positionY[i]);
+		projectile.rotation = store->heading[i];
+
+	}
+
+}
+
+- (void)removeProjectile:(Projectile *)projectile {
+
+	int index = projectile.entityIndex;
+
+	if (index == kEntityIndexNone) {
+		return;
+	}
+
+	/*
+	 Removing the projectile's entry moves the last entry in the store into it's place. The Projectile which
+	 owns the moved entry is told it's new index.
+	 */
+	Projectile *movedProjectile = (Projectile *)EntityStoreRemove(activeProjectiles, index);
+	movedProjectile.entityIndex = index;
+
+	projectile.entityIndex = kEntityIndexNone;
+	projectile.visible = NO;
+
+	availableProjectiles[availableCount] = projectile;
+	availableCount++;
+
+}
+
+- (void)removeAllProjectiles {
+
+	while (activeProjectiles->count > 0) {
+
+		[self removeProjectile:(Projectile *)activeProjectiles->views[0]];
+
+	}
+
+}
+
+- (unsigned int)count {
+
+	return activeProjectiles->count;
+
+}
+
+- (Projectile *)projectileAtIndex:(unsigned int)index {
+
+	return (Projectile *)activeProjectiles->views[index];
+
+}
+
+/*
+ Releases the sprites created by the system. They are removed from the spritesheet first in case the
+ system is released before the layer which owns the spritesheet.
+ */
+- (void)dealloc {
+
+	for (unsigned int i = 0; i < capacity; i++) {
+
+		[projectileSprites[i] removeFromParentAndCleanup:YES];
+		[projectileSprites[i] release];
+
+	}
+
+	free(projectileSprites);
+	free(availableProjectiles);
+	EntityStoreFree(activeProjectiles);
+	spriteSheet = nil;
+
+	[super dealloc];
+
+}
+
+@end
@@ -0,0 +1,414 @@
+//
+//  ReliableChannel.c
+//  AberFighter
+//
+//  Created by wde7 on 10/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include <math.h>
+#include "ReliableChannel.h"
+
+/*
+ Size of the acknowledgement at the start of the data written by ReliableChannelWrite.
+ */
+#define kReliableChannelAcknowledgementSize 6
+
+/*
+ Number of messages after the next expected one which the received bitfield covers.
+ */
+#define kReliableChannelAcknowledgementBits 32
+
+/*
+ Returns true if sequence a comes before sequence b, allowing for the numbers wrapping around.
+ */
+static int ReliableChannelSequenceBefore(uint16_t a, uint16_t b) {
+
+	return (int16_t)(a - b) < 0;
+
+}
+
+void ReliableChannelInit(ReliableChannel *channel) {
+
+	memset(channel, 0, sizeof(ReliableChannel));
+	channel->retransmissionTimeout = kReliableChannelInitialTimeout;
+
+}
+
+/*
+ Returns true if the window has room for another outgoing message.
+ */
+static int ReliableChannelWindowHasRoom(const ReliableChannel *channel) {
+
+	return (uint16_t)(channel->nextSendSequence - channel->oldestUnacknowledgedSequence) < kReliableChannelWindowSize;
+
+}
+
+/*
+ Adds a message to the end of the window. The window must have room for it.
+ */
+static void ReliableChannelAddToWindow(ReliableChannel *channel, uint8_t type, const void *data, size_t length) {
+
+	ReliableChannelMessage *message = &channel->outgoing[channel->nextSendSequence % kReliableChannelWindowSize];
+
+	message->inUse = 1;
+	message->sequence = channel->nextSendSequence;
+	message->type = type;
+	message->length = (uint8_t)length;
+	message->sendCount = 0;
+	message->lastSendTime = 0;
+
+	if (length > 0) {
+		memcpy(message->data, data, length);
+	}
+
+	channel->nextSendSequence++;
+
+}
+
+/*
+ Moves messages from the front of the backlog into the window while there is room.
+ */
+static void ReliableChannelFillWindow(ReliableChannel *channel) {
+
+	while (channel->backlogCount > 0 && ReliableChannelWindowHasRoom(channel)) {
+
+		const ReliableChannelMessage *waiting = &channel->backlog[channel->backlogStart];
+
+		ReliableChannelAddToWindow(channel, waiting->type, waiting->data, waiting->length);
+		channel->backlogStart = (channel->backlogStart + 1) % kReliableChannelBacklogSize;
+		channel->backlogCount--;
+
+	}
+
+}
+
+int ReliableChannelSend(ReliableChannel *channel, uint8_t type, const void *data, size_t length) {
+
+	if (length > kReliableChannelMaximumMessageSize) {
+		return 0;
+	}
+
+	/*
+	 Once anything is waiting in the backlog new messages go behind it, so that they keep their order.
+	 */
+	if (channel->backlogCount == 0 && ReliableChannelWindowHasRoom(channel)) {
+
+		ReliableChannelAddToWindow(channel, type, data, length);
+		return 1;
+
+	}
+
+	if (channel->backlogCount == kReliableChannelBacklogSize) {
+		return 0;
+	}
+
+	ReliableChannelMessage *waiting = &channel->backlog[(channel->backlogStart + channel->backlogCount) % kReliableChannelBacklogSize];
+
+	waiting->type = type;
+	waiting->length = (uint8_t)length;
+
+	if (length > 0) {
+		memcpy(waiting->data, data, length);
+	}
+
+	channel->backlogCount++;
+
+	return 1;
+
+}
+
+/*
+ Returns true if the outgoing message should be sent at the time specified.
+ */
+static int ReliableChannelMessageIsDue(const ReliableChannel *channel, const ReliableChannelMessage *message, double now) {
+
+	return message->inUse && (message->sendCount == 0 || (now - message->lastSendTime) >= channel->retransmissionTimeout);
+
+}
+
+int ReliableChannelHasDataToWrite(const ReliableChannel *channel, double now) {
+
+	if (channel->acknowledgementPending) {
+		return 1;
+	}
+
+	for (uint16_t sequence = channel->oldestUnacknowledgedSequence; sequence != channel->nextSendSequence; sequence++) {
+
+		if (ReliableChannelMessageIsDue(channel, &channel->outgoing[sequence % kReliableChannelWindowSize], now)) {
+			return 1;
+		}
+
+	}
+
+	return 0;
+
+}
+
+/*
+ Returns true if the incoming message with the sequence specified has arrived and is being held.
+ */
+static int ReliableChannelHoldsIncoming(const ReliableChannel *channel, uint16_t sequence) {
+
+	const ReliableChannelMessage *message = &channel->incoming[sequence % kReliableChannelWindowSize];
+
+	return message->inUse && message->sequence == sequence;
+
+}
+
+size_t ReliableChannelWrite(ReliableChannel *channel, WireWriter *writer, double now) {
+
+	if (!ReliableChannelHasDataToWrite(channel, now) || WireWriterRemaining(writer) < kReliableChannelAcknowledgementSize) {
+		return 0;
+	}
+
+	size_t start = writer->length;
+	uint16_t nextExpected = channel->nextReceiveSequence;
+	uint32_t receivedBits = 0;
+
+	/*
+	 Messages which have arrived but haven't been taken with ReliableChannelReceive yet count as received, or
+	 the peer would resend them until they are taken.
+	 */
+	while (ReliableChannelHoldsIncoming(channel, nextExpected)) {
+		nextExpected++;
+	}
+
+	for (unsigned int bit = 0; bit < kReliableChannelAcknowledgementBits; bit++) {
+
+		if (ReliableChannelHoldsIncoming(channel, (uint16_t)(nextExpected + 1 + bit))) {
+			receivedBits |= (1u << bit);
+		}
+
+	}
+
+	WireWriteUInt16(writer, nextExpected);
+	WireWriteUInt32(writer, receivedBits);
+	channel->acknowledgementPending = 0;
+
+	int timedOut = 0;
+
+	/*
+	 Messages are written oldest first until the writer is full.
+	 */
+	for (uint16_t sequence = channel->oldestUnacknowledgedSequence; sequence != channel->nextSendSequence; sequence++) {
+
+		ReliableChannelMessage *message = &channel->outgoing[sequence % kReliableChannelWindowSize];
+
+		if (!ReliableChannelMessageIsDue(channel, message, now)) {
+			continue;
+		}
+
+		if (WireWriterRemaining(writer) < 3 + WireVarUIntSize(message->length) + message->length) {
+			break;
+		}
+
+		if (message->sendCount > 0) {
+
+			channel->retransmissions++;
+			timedOut = 1;
+
+		}
+
+		WireWriteUInt16(writer, message->sequence);
+		WireWriteUInt8(writer, message->type);
+		WireWriteVarUInt(writer, message->length);
+		WireWriteBytes(writer, message->data, message->length);
+
+		message->lastSendTime = now;
+		message->sendCount++;
+
+	}
+
+	/*
+	 The messages resent together timed out together, so the timeout is only doubled once for them.
+	 */
+	if (timedOut) {
+
+		channel->retransmissionTimeout *= 2.0;
+
+		if (channel->retransmissionTimeout > kReliableChannelMaximumTimeout) {
+			channel->retransmissionTimeout = kReliableChannelMaximumTimeout;
+		}
+
+	}
+
+	return writer->length - start;
+
+}
+
+/*
+ Updates the round trip time estimate with a new measurement and recalculates the retransmission timeout,
+ which undoes any doubling.
+ */
+static void ReliableChannelAddRoundTripSample(ReliableChannel *channel, double sample) {
+
+	if (!channel->hasRoundTripTime) {
+
+		channel->hasRoundTripTime = 1;
+		channel->smoothedRoundTripTime = sample;
+		channel->roundTripTimeVariance = sample / 2.0;
+
+	} else {
+
+		channel->roundTripTimeVariance = 0.75 * channel->roundTripTimeVariance + 0.25 * fabs(channel->smoothedRoundTripTime - sample);
+		channel->smoothedRoundTripTime = 0.875 * channel->smoothedRoundTripTime + 0.125 * sample;
+
+	}
+
+	double timeout = channel->smoothedRoundTripTime + 4.0 * channel->roundTripTimeVariance;
+
+	if (timeout < kReliableChannelMinimumTimeout) {
+		timeout = kReliableChannelMinimumTimeout;
+	} else if (timeout > kReliableChannelMaximumTimeout) {
+		timeout = kReliableChannelMaximumTimeout;
+	}
+
+	channel->retransmissionTimeout = timeout;
+
+}
+
+/*
+ Releases an outgoing message which the peer has received. Messages which were only sent once give a round
+ trip time measurement; those which were resent don't, because it isn't known which copy arrived.
+ */
+static void ReliableChannelAcknowledge(ReliableChannel *channel, uint16_t sequence, double now) {
+
+	ReliableChannelMessage *message = &channel->outgoing[sequence % kReliableChannelWindowSize];
+
+	if (message->inUse && message->sequence == sequence) {
+
+		if (message->sendCount == 1) {
+			ReliableChannelAddRoundTripSample(channel, now - message->lastSendTime);
+		}
+
+		message->inUse = 0;
+
+	}
+
+}
+
+void ReliableChannelRead(ReliableChannel *channel, WireReader *reader, double now) {
+
+	uint16_t nextExpected = WireReadUInt16(reader);
+	uint32_t receivedBits = WireReadUInt32(reader);
+
+	if (reader->error) {
+		return;
+	}
+
+	/*
+	 Everything before the next expected sequence has arrived, as have the messages in the bitfield.
+	 Acknowledgements for messages which haven't been sent yet can only come from a corrupt packet.
+	 */
+	if (!ReliableChannelSequenceBefore(channel->nextSendSequence, nextExpected)) {
+
+		while (ReliableChannelSequenceBefore(channel->oldestUnacknowledgedSequence, nextExpected)) {
+
+			ReliableChannelAcknowledge(channel, channel->oldestUnacknowledgedSequence, now);
+			channel->oldestUnacknowledgedSequence++;
+
+		}
+
+		for (unsigned int bit = 0; bit < kReliableChannelAcknowledgementBits; bit++) {
+
+			if (receivedBits & (1u << bit)) {
+				ReliableChannelAcknowledge(channel, (uint16_t)(nextExpected + 1 + bit), now);
+			}
+
+		}
+
+		/*
+		 The window moves on past any messages at the start of it which were acknowledged selectively.
+		 */
+		while (channel->oldestUnacknowledgedSequence != channel->nextSendSequence &&
+			   !channel->outgoing[channel->oldestUnacknowledgedSequence % kReliableChannelWindowSize].inUse) {
+
+			channel->oldestUnacknowledgedSequence++;
+
+		}
+
+		ReliableChannelFillWindow(channel);
+
+	}
+
+	/*
+	 Then the messages themselves.
+	 */
+	while (WireReaderRemaining(reader) > 0) {
+
+		uint16_t sequence = WireReadUInt16(reader);
+		uint8_t type = WireReadUInt8(reader);
+		uint32_t length = WireReadVarUInt(reader);
+
+		if (reader->error || length > kReliableChannelMaximumMessageSize || WireReaderRemaining(reader) < length) {
+			return;
+		}
+
+		/*
+		 Every message is acknowledged, including duplicates, since the peer resends a message whose
+		 acknowledgement was lost.
+		 */
+		channel->acknowledgementPending = 1;
+
+		ReliableChannelMessage *message = &channel->incoming[sequence % kReliableChannelWindowSize];
+
+		if (ReliableChannelSequenceBefore(sequence, channel->nextReceiveSequence) ||
+			(uint16_t)(sequence - channel->nextReceiveSequence) >= kReliableChannelWindowSize ||
+			(message->inUse && message->sequence == sequence)) {
+
+			WireReaderSkip(reader, length);
+			continue;
+
+		}
+
+		message->inUse = 1;
+		message->sequence = sequence;
+		message->type = type;
+		message->length = (uint8_t)length;
+		WireReadBytes(reader, message->data, length);
+
+	}
+
+}
+
+int ReliableChannelReceive(ReliableChannel *channel, uint8_t *type, WireReader *message) {
+
+	ReliableChannelMessage *next = &channel->incoming[channel->nextReceiveSequence % kReliableChannelWindowSize];
+
+	if (!next->inUse || next->sequence != channel->nextReceiveSequence) {
+		return 0;
+	}
+
+	next->inUse = 0;
+	channel->nextReceiveSequence++;
+
+	*type = next->type;
+	WireReaderInit(message, next->data, next->length);
+
+	return 1;
+
+}
+
+unsigned int ReliableChannelUnacknowledgedCount(const ReliableChannel *channel) {
+
+	unsigned int count = 0;
+
+	for (uint16_t sequence = channel->oldestUnacknowledgedSequence; sequence != channel->nextSendSequence; sequence++) {
+
+		if (channel->outgoing[sequence % kReliableChannelWindowSize].inUse) {
+			count++;
+		}
+
+	}
+
+	return count;
+
+}
+
+unsigned int ReliableChannelBacklogCount(const ReliableChannel *channel) {
+
+	return channel->backlogCount;
+
+}
@@ -0,0 +1,153 @@
+//
+//  ReliableChannel.h
+//  AberFighter
+//
+//  Created by wde7 on 10/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The ReliableChannel delivers control messages, such as PlayerReady and PeerResumedGame, reliably and in
+ order on top of unreliable packets. Previously these were sent with GKSendDataReliable, which holds back
+ everything sent after a lost packet until it has been resent, and shared a packet number with the
+ unreliable traffic, so a late reliable packet could be discarded as out of date.
+
+ Each message has it's own 16 bit sequence number, separate from the packet numbers of the unreliable
+ traffic. Outgoing messages are kept until the peer acknowledges them and are resent if no acknowledgement
+ arrives within the retransmission timeout, which is calculated from the measured round trip time. Each
+ timeout doubles it, up to kReliableChannelMaximumTimeout, so a peer which has gone quiet isn't flooded
+ with resends, until a message is acknowledged without having been resent and gives a new measurement.
+ Acknowledgements are selective: the receiver sends the next sequence number it expects plus a bitfield of
+ the messages after it which have already arrived, so only the messages which were actually lost are resent.
+ Messages which arrive early are held until the ones before them have arrived.
+
+ Messages sent while the window is full wait in a backlog, in the order they were sent, and join the window
+ as the peer acknowledges the messages ahead of them. A message is only refused when the backlog is full too,
+ which means the peer hasn't acknowledged anything for a long time.
+
+ Everything the channel needs to send is written into a single block of data which is sent as one message
+ in a batch packet:
+   next expected sequence   2 bytes
+   received bitfield        4 bytes, bit n set if next expected + 1 + n has arrived
+   messages                 sequence (2 bytes), type (1 byte), length (variable length integer), data
+
+ The channel is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __RELIABLE_CHANNEL_H__
+#define __RELIABLE_CHANNEL_H__
+
+#include <stdint.h>
+#include "WireProtocol.h"
+
+/*
+ Number of messages which can be waiting for acknowledgement, and number of early messages which can be held.
+ */
+#define kReliableChannelWindowSize 32
+
+/*
+ Number of messages which can wait for room in the window.
+ */
+#define kReliableChannelBacklogSize 64
+
+/*
+ Largest message data which can be sent. Control messages only carry a few bytes.
+ */
+#define kReliableChannelMaximumMessageSize 32
+
+/*
+ Limits and initial value of the retransmission timeout, in seconds.
+ */
+#define kReliableChannelInitialTimeout 0.25
+#define kReliableChannelMinimumTimeout 0.05
+#define kReliableChannelMaximumTimeout 1.0
+
+typedef struct {
+
+	int inUse;
+	uint16_t sequence;
+	uint8_t type;
+	uint8_t length;
+	uint8_t data[kReliableChannelMaximumMessageSize];
+
+	//Time the message was last sent and how many times it has been sent. Only used for outgoing messages.
+	double lastSendTime;
+	unsigned int sendCount;
+
+} ReliableChannelMessage;
+
+typedef struct {
+
+	//Outgoing messages waiting for acknowledgement, indexed by sequence number modulo the window size.
+	ReliableChannelMessage outgoing[kReliableChannelWindowSize];
+	uint16_t nextSendSequence;
+	uint16_t oldestUnacknowledgedSequence;
+
+	//Outgoing messages waiting for room in the window, in a ring starting at backlogStart.
+	ReliableChannelMessage backlog[kReliableChannelBacklogSize];
+	unsigned int backlogStart;
+	unsigned int backlogCount;
+
+	//Incoming messages which arrived before the messages preceding them.
+	ReliableChannelMessage incoming[kReliableChannelWindowSize];
+	uint16_t nextReceiveSequence;
+
+	//True when messages have arrived which the peer hasn't been told about.
+	int acknowledgementPending;
+
+	/*
+	 Round trip time estimate in seconds, smoothed in the same way as TCP. The retransmission timeout is
+	 calculated from it and doubled by each timeout.
+	 */
+	int hasRoundTripTime;
+	double smoothedRoundTripTime;
+	double roundTripTimeVariance;
+	double retransmissionTimeout;
+
+	//Number of messages resent because they weren't acknowledged in time.
+	unsigned long retransmissions;
+
+} ReliableChannel;
+
+void ReliableChannelInit(ReliableChannel *channel);
+
+/*
+ Queues a message. Returns 0 if the data is too large, or if the window and the backlog are both full, in
+ which case the message can't be delivered and the link should be treated as failed.
+ */
+int ReliableChannelSend(ReliableChannel *channel, uint8_t type, const void *data, size_t length);
+
+/*
+ Returns 1 if anything needs to be sent at the time specified: messages which haven't been sent, messages
+ whose retransmission timeout has passed, or an acknowledgement.
+ */
+int ReliableChannelHasDataToWrite(const ReliableChannel *channel, double now);
+
+/*
+ Writes the acknowledgement and as many of the messages due to be sent as fit. Returns the number of bytes
+ written, or 0 if nothing needed to be sent or the acknowledgement didn't fit.
+ */
+size_t ReliableChannelWrite(ReliableChannel *channel, WireWriter *writer, double now);
+
+/*
+ Reads data written by the peer's ReliableChannelWrite. Acknowledged outgoing messages are released and
+ incoming messages are stored until they are taken with ReliableChannelReceive.
+ */
+void ReliableChannelRead(ReliableChannel *channel, WireReader *reader, double now);
+
+/*
+ Takes the next incoming message in order. The message reader is set up to read it's data, which remains
+ valid until the next call to ReliableChannelRead. Returns 0 when the next message hasn't arrived.
+ */
+int ReliableChannelReceive(ReliableChannel *channel, uint8_t *type, WireReader *message);
+
+/*
+ Number of outgoing messages which haven't been acknowledged.
+ */
+unsigned int ReliableChannelUnacknowledgedCount(const ReliableChannel *channel);
+
+/*
+ Number of outgoing messages waiting for room in the window. These haven't been sent yet.
+ */
+unsigned int ReliableChannelBacklogCount(const ReliableChannel *channel);
+
+#endif // __RELIABLE_CHANNEL_H__
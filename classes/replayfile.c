@@ -0,0 +1,666 @@
+//
+//  ReplayFile.c
+//  AberFighter
+//
+//  Created by wde7 on 16/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "ReplayFile.h"
+
+static const uint8_t kReplayFileMagic[4] = { 'A', 'F', 'R', 'P' };
+
+/*
+ Flags written before each player's input in a frames record, as in the messages of a RollbackSession.
+ */
+#define kReplayInputFlagFire		0x01
+#define kReplayInputFlagMovement	0x02
+
+/*
+ Writes a record made of a short head, built in memory, followed by a body which may be large.
+ */
+static void ReplayRecorderWriteRecord(ReplayRecorder *recorder, uint8_t type, const WireWriter *head,
+									  const void *body, size_t bodyLength) {
+
+	uint8_t prefixBytes[8];
+	WireWriter prefix;
+
+	WireWriterInit(&prefix, prefixBytes, sizeof(prefixBytes));
+	WireWriteUInt8(&prefix, type);
+	WireWriteVarUInt(&prefix, (uint32_t)(head->length + bodyLength));
+
+	if (fwrite(prefixBytes, 1, prefix.length, recorder->file) != prefix.length ||
+		fwrite(head->bytes, 1, head->length, recorder->file) != head->length ||
+		(bodyLength > 0 && fwrite(body, 1, bodyLength, recorder->file) != bodyLength)) {
+		recorder->error = 1;
+	}
+
+}
+
+/*
+ Writes the pending frames as a single record.
+ */
+static void ReplayRecorderFlushFrames(ReplayRecorder *recorder) {
+
+	uint8_t headBytes[10];
+	WireWriter head;
+
+	if (recorder->pendingCount == 0) {
+		return;
+	}
+
+	WireWriterInit(&head, headBytes, sizeof(headBytes));
+	WireWriteVarUInt(&head, recorder->pendingFirstFrame);
+	WireWriteVarUInt(&head, recorder->pendingCount);
+
+	ReplayRecorderWriteRecord(recorder, kReplayRecordFrames, &head,
+							  recorder->pendingBytes, recorder->pendingWriter.length);
+
+	WireWriterInit(&recorder->pendingWriter, recorder->pendingBytes, sizeof(recorder->pendingBytes));
+	recorder->pendingCount = 0;
+
+}
+
+ReplayRecorder *ReplayRecorderOpen(const char *path, const SimulationConfig *config, uint32_t seed) {
+
+	ReplayRecorder *recorder = (ReplayRecorder *)calloc(1, sizeof(ReplayRecorder));
+
+	if (recorder == NULL) {
+		return NULL;
+	}
+
+	recorder->file = fopen(path, "wb");
+
+	if (recorder->file == NULL) {
+		free(recorder);
+		return NULL;
+	}
+
+	recorder->numberOfPlayers = config->numberOfPlayers;
+	recorder->lastKeyframe = -1;
+	WireWriterInit(&recorder->pendingWriter, recorder->pendingBytes, sizeof(recorder->pendingBytes));
+
+	uint8_t headerBytes[16];
+	WireWriter header;
+
+	WireWriterInit(&header, headerBytes, sizeof(headerBytes));
+	WireWriteBytes(&header, kReplayFileMagic, sizeof(kReplayFileMagic));
+	WireWriteUInt8(&header, kReplayFileVersion);
+	WireWriteUInt32(&header, seed);
+	WireWriteVarUInt(&header, (uint32_t)sizeof(SimulationConfig));
+
+	if (fwrite(headerBytes, 1, header.length, recorder->file) != header.length ||
+		fwrite(config, sizeof(SimulationConfig), 1, recorder->file) != 1) {
+		recorder->error = 1;
+	}
+
+	return recorder;
+
+}
+
+int ReplayRecorderKeyframeDue(const ReplayRecorder *recorder) {
+
+	return (recorder->frameCount % kReplayFileKeyframeInterval) == 0 &&
+		recorder->lastKeyframe != (int64_t)recorder->frameCount;
+
+}
+
+void ReplayRecorderAddKeyframe(ReplayRecorder *recorder, const void *state, size_t length) {
+
+	uint8_t headBytes[5];
+	WireWriter head;
+
+	/*
+	 The frames before the keyframe are written first, so the record after a keyframe always starts with it's frame.
+	 */
+	ReplayRecorderFlushFrames(recorder);
+
+	WireWriterInit(&head, headBytes, sizeof(headBytes));
+	WireWriteVarUInt(&head, recorder->frameCount);
+	ReplayRecorderWriteRecord(recorder, kReplayRecordKeyframe, &head, state, length);
+
+	recorder->lastKeyframe = recorder->frameCount;
+
+	if (fflush(recorder->file) != 0) {
+		recorder->error = 1;
+	}
+
+}
+
+void ReplayRecorderAddFrame(ReplayRecorder *recorder, const SimulationInput *inputs) {
+
+	WireWriter *writer = &recorder->pendingWriter;
+
+	if (recorder->pendingCount == 0) {
+		recorder->pendingFirstFrame = recorder->frameCount;
+	}
+
+	for (int p = 0; p < recorder->numberOfPlayers; p++) {
+
+		uint8_t heading = WireQuantizeHeading(inputs[p].heading);
+		uint8_t speed = WireQuantizeSpeed(inputs[p].speed);
+		uint8_t flags = inputs[p].fire ? kReplayInputFlagFire : 0;
+
+		if (recorder->pendingCount == 0 ||
+			heading != recorder->previousHeadings[p] || speed != recorder->previousSpeeds[p]) {
+			flags |= kReplayInputFlagMovement;
+		}
+
+		WireWriteUInt8(writer, flags);
+
+		if (flags & kReplayInputFlagMovement) {
+
+			WireWriteUInt8(writer, heading);
+			WireWriteUInt8(writer, speed);
+
+		}
+
+		recorder->previousHeadings[p] = heading;
+		recorder->previousSpeeds[p] = speed;
+
+	}
+
+	recorder->pendingCount++;
+	recorder->frameCount++;
+
+	if (recorder->pendingCount == kReplayFileFramesPerRecord) {
+		ReplayRecorderFlushFrames(recorder);
+	}
+
+}
+
+void ReplayRecorderAddEvent(ReplayRecorder *recorder, int eventType, int32_t data) {
+
+	uint8_t headBytes[16];
+	WireWriter head;
+
+	//Events are rare, so the frames before them are written first to keep the records in frame order.
+	ReplayRecorderFlushFrames(recorder);
+
+	WireWriterInit(&head, headBytes, sizeof(headBytes));
+	WireWriteVarUInt(&head, recorder->frameCount);
+	WireWriteUInt8(&head, (uint8_t)eventType);
+	WireWriteVarInt(&head, data);
+	ReplayRecorderWriteRecord(recorder, kReplayRecordEvent, &head, NULL, 0);
+
+}
+
+int ReplayRecorderClose(ReplayRecorder *recorder, const Simulation *simulation) {
+
+	ReplayRecorderFlushFrames(recorder);
+
+	if (simulation != NULL && simulation->tick == recorder->frameCount &&
+		simulation->config.numberOfPlayers == recorder->numberOfPlayers) {
+
+		uint8_t headBytes[10 + kSimulationMaximumPlayers * 5];
+		WireWriter head;
+
+		WireWriterInit(&head, headBytes, sizeof(headBytes));
+		WireWriteVarUInt(&head, recorder->frameCount);
+
+		for (int p = 0; p < recorder->numberOfPlayers; p++) {
+			WireWriteVarInt(&head, simulation->players[p].score);
+		}
+
+		WireWriteUInt32(&head, SimulationChecksum(simulation));
+		ReplayRecorderWriteRecord(recorder, kReplayRecordEnd, &head, NULL, 0);
+
+	}
+
+	if (fclose(recorder->file) != 0) {
+		recorder->error = 1;
+	}
+
+	int succeeded = !recorder->error;
+
+	free(recorder);
+
+	return succeeded;
+
+}
+
+/*
+ Reads the type of the record at offset and gives a reader for the rest of it. Returns 0 if the record runs
+ past the end of the file.
+ */
+static int ReplayPlayerReadRecord(const ReplayPlayer *player, size_t offset, uint8_t *type,
+								  WireReader *record, size_t *recordEnd) {
+
+	WireReader reader;
+
+	if (offset >= player->length) {
+		return 0;
+	}
+
+	WireReaderInit(&reader, &player->bytes[offset], player->length - offset);
+	*type = WireReadUInt8(&reader);
+	uint32_t length = WireReadVarUInt(&reader);
+
+	if (reader.error || length > WireReaderRemaining(&reader)) {
+		return 0;
+	}
+
+	WireReaderInit(record, &player->bytes[offset + reader.position], length);
+	*recordEnd = offset + reader.position + length;
+
+	return 1;
+
+}
+
+/*
+ Reads the file into memory, checks the header and creates the simulation.
+ */
+static int ReplayPlayerReadFile(ReplayPlayer *player, const char *path) {
+
+	FILE *file = fopen(path, "rb");
+
+	if (file == NULL) {
+		return 0;
+	}
+
+	long length = -1;
+
+	if (fseek(file, 0, SEEK_END) == 0) {
+		length = ftell(file);
+	}
+
+	if (length <= 0 || fseek(file, 0, SEEK_SET) != 0) {
+
+		fclose(file);
+		return 0;
+
+	}
+
+	player->bytes = (uint8_t *)malloc((size_t)length);
+	player->length = (size_t)length;
+
+	if (player->bytes == NULL || fread(player->bytes, 1, player->length, file) != player->length) {
+
+		fclose(file);
+		return 0;
+
+	}
+
+	fclose(file);
+
+	WireReader reader;
+	uint8_t magic[sizeof(kReplayFileMagic)];
+
+	WireReaderInit(&reader, player->bytes, player->length);
+	WireReadBytes(&reader, magic, sizeof(magic));
+	uint8_t version = WireReadUInt8(&reader);
+	player->seed = WireReadUInt32(&reader);
+	uint32_t configSize = WireReadVarUInt(&reader);
+
+	if (reader.error || memcmp(magic, kReplayFileMagic, sizeof(magic)) != 0 ||
+		version != kReplayFileVersion || configSize != sizeof(SimulationConfig)) {
+		return 0;
+	}
+
+	WireReadBytes(&reader, &player->config, sizeof(SimulationConfig));
+
+	if (reader.error || player->config.numberOfPlayers < 1 ||
+		player->config.numberOfPlayers > kSimulationMaximumPlayers) {
+		return 0;
+	}
+
+	player->firstRecordOffset = reader.position;
+	player->nextRecordOffset = reader.position;
+	player->simulation = SimulationNew(&player->config, player->seed);
+
+	return player->simulation != NULL;
+
+}
+
+/*
+ Reads the type of every record to index the keyframes and find the end of the game. The file is treated as
+ ending at the first record which is incomplete.
+ */
+static int ReplayPlayerIndexRecords(ReplayPlayer *player) {
+
+	unsigned int keyframeCapacity = 0;
+	size_t offset = player->firstRecordOffset;
+	uint8_t type;
+	WireReader record;
+	size_t recordEnd;
+
+	while (ReplayPlayerReadRecord(player, offset, &type, &record, &recordEnd)) {
+
+		if (type == kReplayRecordKeyframe) {
+
+			if (player->keyframeCount == keyframeCapacity) {
+
+				unsigned int capacity = (keyframeCapacity == 0) ? 16 : keyframeCapacity * 2;
+				ReplayKeyframe *keyframes = (ReplayKeyframe *)realloc(player->keyframes, capacity * sizeof(ReplayKeyframe));
+
+				if (keyframes == NULL) {
+					return 0;
+				}
+
+				player->keyframes = keyframes;
+				keyframeCapacity = capacity;
+
+			}
+
+			ReplayKeyframe *keyframe = &player->keyframes[player->keyframeCount];
+
+			keyframe->frame = WireReadVarUInt(&record);
+			keyframe->offset = offset;
+
+			if (!record.error) {
+				player->keyframeCount++;
+			}
+
+		} else if (type == kReplayRecordEnd) {
+
+			player->endFrame = WireReadVarUInt(&record);
+
+			for (int p = 0; p < player->config.numberOfPlayers; p++) {
+				player->endScores[p] = WireReadVarInt(&record);
+			}
+
+			player->endChecksum = WireReadUInt32(&record);
+			player->hasEnd = !record.error;
+
+		}
+
+		offset = recordEnd;
+
+		if (type == kReplayRecordEnd) {
+			break;
+		}
+
+	}
+
+	player->length = offset;
+
+	return 1;
+
+}
+
+ReplayPlayer *ReplayPlayerOpen(const char *path) {
+
+	ReplayPlayer *player = (ReplayPlayer *)calloc(1, sizeof(ReplayPlayer));
+
+	if (player == NULL) {
+		return NULL;
+	}
+
+	if (!ReplayPlayerReadFile(player, path) || !ReplayPlayerIndexRecords(player)) {
+
+		ReplayPlayerClose(player);
+		return NULL;
+
+	}
+
+	return player;
+
+}
+
+void ReplayPlayerClose(ReplayPlayer *player) {
+
+	if (player == NULL) {
+		return;
+	}
+
+	SimulationFree(player->simulation);
+	free(player->bytes);
+	free(player->keyframes);
+	free(player->scratchState);
+	free(player);
+
+}
+
+/*
+ Compares the simulation with a keyframe for the frame it is at.
+ */
+static void ReplayPlayerCheckKeyframe(ReplayPlayer *player, const uint8_t *state, size_t length) {
+
+	size_t size = SimulationStateSize(player->simulation);
+
+	if (size > player->scratchCapacity) {
+
+		uint8_t *bytes = (uint8_t *)realloc(player->scratchState, size * 2);
+
+		if (bytes == NULL) {
+			return;
+		}
+
+		player->scratchState = bytes;
+		player->scratchCapacity = size * 2;
+
+	}
+
+	size = SimulationSaveState(player->simulation, player->scratchState, player->scratchCapacity);
+
+	player->keyframesChecked++;
+
+	if (size != length || memcmp(player->scratchState, state, length) != 0) {
+		player->keyframeMismatches++;
+	}
+
+}
+
+/*
+ Moves on to the next record. Returns 1 once a frames record has been reached, and 0 at the end of the file
+ or if a record is invalid.
+ */
+static int ReplayPlayerNextRecord(ReplayPlayer *player) {
+
+	uint8_t type;
+	WireReader record;
+	size_t recordEnd;
+
+	if (player->error ||
+		!ReplayPlayerReadRecord(player, player->nextRecordOffset, &type, &record, &recordEnd)) {
+		return 0;
+	}
+
+	switch (type) {
+
+		case kReplayRecordFrames: {
+
+			uint32_t firstFrame = WireReadVarUInt(&record);
+			uint32_t count = WireReadVarUInt(&record);
+
+			if (record.error || firstFrame != player->simulation->tick) {
+
+				player->error = 1;
+				return 0;
+
+			}
+
+			player->frames = record;
+			player->framesRemaining = count;
+
+		}
+		break;
+
+		case kReplayRecordEvent: {
+
+			uint32_t frame = WireReadVarUInt(&record);
+			int eventType = WireReadUInt8(&record);
+			int32_t data = WireReadVarInt(&record);
+
+			if (!record.error && player->eventHandler != NULL) {
+				player->eventHandler(frame, eventType, data, player->eventContext);
+			}
+
+		}
+		break;
+
+		case kReplayRecordKeyframe: {
+
+			uint32_t frame = WireReadVarUInt(&record);
+
+			if (!record.error && frame == player->simulation->tick) {
+				ReplayPlayerCheckKeyframe(player, &record.bytes[record.position], WireReaderRemaining(&record));
+			}
+
+		}
+		break;
+
+		case kReplayRecordEnd:
+			//The playback stays at the end record.
+			return 0;
+
+		default:
+			//Records added by later versions of the recorder are skipped.
+		break;
+
+	}
+
+	player->nextRecordOffset = recordEnd;
+
+	return 1;
+
+}
+
+int ReplayPlayerStep(ReplayPlayer *player) {
+
+	SimulationInput inputs[kSimulationMaximumPlayers];
+
+	while (player->framesRemaining == 0) {
+
+		if (!ReplayPlayerNextRecord(player)) {
+			return 0;
+		}
+
+	}
+
+	for (int p = 0; p < player->config.numberOfPlayers; p++) {
+
+		uint8_t flags = WireReadUInt8(&player->frames);
+
+		if (flags & kReplayInputFlagMovement) {
+
+			player->headings[p] = WireReadUInt8(&player->frames);
+			player->speeds[p] = WireReadUInt8(&player->frames);
+
+		}
+
+		inputs[p].heading = WireDequantizeHeading(player->headings[p]);
+		inputs[p].speed = WireDequantizeSpeed(player->speeds[p]);
+		inputs[p].fire = (flags & kReplayInputFlagFire) ? 1 : 0;
+
+	}
+
+	if (player->frames.error) {
+
+		player->error = 1;
+		player->framesRemaining = 0;
+		return 0;
+
+	}
+
+	SimulationStep(player->simulation, inputs);
+	player->framesRemaining--;
+
+	return 1;
+
+}
+
+uint32_t ReplayPlayerPlay(ReplayPlayer *player) {
+
+	uint32_t framesPlayed = 0;
+
+	while (ReplayPlayerStep(player)) {
+		framesPlayed++;
+	}
+
+	return framesPlayed;
+
+}
+
+/*
+ Loads a keyframe into the simulation and continues playback from the record after it. With no keyframe the
+ simulation is reset and playback starts from the beginning of the file.
+ */
+static int ReplayPlayerLoadKeyframe(ReplayPlayer *player, const ReplayKeyframe *keyframe) {
+
+	player->framesRemaining = 0;
+
+	if (keyframe == NULL) {
+
+		SimulationReset(player->simulation, player->seed);
+		player->nextRecordOffset = player->firstRecordOffset;
+		return 1;
+
+	}
+
+	uint8_t type;
+	WireReader record;
+	size_t recordEnd;
+
+	if (!ReplayPlayerReadRecord(player, keyframe->offset, &type, &record, &recordEnd)) {
+		return 0;
+	}
+
+	WireReadVarUInt(&record);
+
+	if (record.error ||
+		!SimulationLoadState(player->simulation, &record.bytes[record.position], WireReaderRemaining(&record))) {
+		return 0;
+	}
+
+	player->nextRecordOffset = recordEnd;
+
+	return 1;
+
+}
+
+int ReplayPlayerSeek(ReplayPlayer *player, uint32_t frame) {
+
+	const ReplayKeyframe *keyframe = NULL;
+
+	for (unsigned int i = 0; i < player->keyframeCount && player->keyframes[i].frame <= frame; i++) {
+		keyframe = &player->keyframes[i];
+	}
+
+	/*
+	 Playing forward from where the simulation is already is quicker than loading a keyframe which isn't
+	 any closer.
+	 */
+	if (frame < player->simulation->tick || (keyframe != NULL && keyframe->frame > player->simulation->tick)) {
+
+		if (!ReplayPlayerLoadKeyframe(player, keyframe)) {
+			return 0;
+		}
+
+	}
+
+	while (player->simulation->tick < frame) {
+
+		if (!ReplayPlayerStep(player)) {
+			return 0;
+		}
+
+	}
+
+	return 1;
+
+}
+
+int ReplayPlayerVerify(ReplayPlayer *player) {
+
+	ReplayPlayerPlay(player);
+
+	if (!player->hasEnd || player->error || player->keyframeMismatches > 0 ||
+		player->simulation->tick != player->endFrame ||
+		SimulationChecksum(player->simulation) != player->endChecksum) {
+		return 0;
+	}
+
+	for (int p = 0; p < player->config.numberOfPlayers; p++) {
+
+		if (player->simulation->players[p].score != player->endScores[p]) {
+			return 0;
+		}
+
+	}
+
+	return 1;
+
+}
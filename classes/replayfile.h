@@ -0,0 +1,232 @@
+//
+//  ReplayFile.h
+//  AberFighter
+//
+//  Created by wde7 on 16/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ A replay file records a game played by a Simulation so it can be played back later: the configuration and
+ seed the simulation was created with and the input of every player for every frame. The input is the
+ heading and speed given by the DirectionalChangesCalculator and whether the fire button was pressed. The
+ network events handled during the game are recorded alongside the frame they arrived on, for analysis.
+
+ The ReplayRecorder only ever appends to the file. Inputs are written with the precision of the
+ WireProtocol and a frame whose heading and speed haven't changed takes a single byte per player, so a two
+ minute game takes a few tens of kilobytes. Frames are buffered and written kReplayFileFramesPerRecord at a
+ time, so a recording which is cut short loses less than a second of play.
+
+ Every kReplayFileKeyframeInterval frames the recorder also writes a keyframe, the saved state of the
+ simulation at the start of that frame. The ReplayPlayer indexes the keyframes when it opens a file, so it
+ can seek to any frame by loading the nearest keyframe and playing forward from there. When playback passes
+ a keyframe the simulation is compared with it, and the file ends with the final scores and checksum, so a
+ replay also checks that the simulation still produces the same game it did when it was recorded.
+
+ The player has no view and steps the simulation as fast as it can, so playing back a file is also a
+ repeatable workload for profiling the game rules.
+
+ The configuration and keyframes are stored in the byte order of the device, as saved states are, so a file
+ can only be played back on a device with the same byte order as the one which recorded it. Everything else
+ is written as in the WireProtocol. Inputs are reproduced exactly if they were quantized to the precision
+ of the WireProtocol when the game was played, as they are by a RollbackSession.
+
+ The file is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __REPLAY_FILE_H__
+#define __REPLAY_FILE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "Simulation.h"
+#include "WireProtocol.h"
+
+//Changed whenever the layout of the file changes. Files with a different version aren't played.
+#define kReplayFileVersion 1
+
+//Frames of input written together as a single record.
+#define kReplayFileFramesPerRecord 60
+
+//Frames between keyframes. Seeking plays at most this many frames after loading a keyframe.
+#define kReplayFileKeyframeInterval 600
+
+/*
+ The kinds of record which follow the header of a file. Each record is it's type, the length of the rest
+ of the record as a varuint and then:
+
+ kReplayRecordFrames: the first frame and number of frames as varuints, then for each frame the input of
+ every player in turn as a flags byte, followed by the heading and speed if the movement flag is set. The
+ movement is always written for the first frame of a record.
+ kReplayRecordEvent: the frame as a varuint, the event type as a byte and the event's data as a varint.
+ kReplayRecordKeyframe: the frame as a varuint and the saved state at the start of it.
+ kReplayRecordEnd: the number of frames played as a varuint, each player's score as a varint and the
+ checksum of the simulation after the last frame.
+ */
+typedef enum {
+
+	kReplayRecordFrames = 1,
+	kReplayRecordEvent,
+	kReplayRecordKeyframe,
+	kReplayRecordEnd
+
+} ReplayRecordType;
+
+//Room for the inputs of a frames record, which are kept in memory until the record is written.
+#define kReplayRecorderPendingSize (kReplayFileFramesPerRecord * kSimulationMaximumPlayers * 3)
+
+typedef struct {
+
+	FILE *file;
+	int numberOfPlayers;
+
+	//Frames recorded so far. The next frame added is this frame.
+	uint32_t frameCount;
+
+	//Frames which haven't been written yet, starting at pendingFirstFrame.
+	uint32_t pendingFirstFrame;
+	unsigned int pendingCount;
+	WireWriter pendingWriter;
+	uint8_t pendingBytes[kReplayRecorderPendingSize];
+
+	//The quantized heading and speed of each player in the previous pending frame.
+	uint8_t previousHeadings[kSimulationMaximumPlayers];
+	uint8_t previousSpeeds[kSimulationMaximumPlayers];
+
+	//Frame of the last keyframe written, or -1 before the first.
+	int64_t lastKeyframe;
+
+	//Set if anything couldn't be written.
+	int error;
+
+} ReplayRecorder;
+
+/*
+ Called by the ReplayPlayer for each event record it passes during playback.
+ */
+typedef void (*ReplayEventHandler)(uint32_t frame, int eventType, int32_t data, void *context);
+
+//Position of a keyframe in the file.
+typedef struct {
+
+	uint32_t frame;
+	size_t offset;
+
+} ReplayKeyframe;
+
+typedef struct {
+
+	SimulationConfig config;
+	uint32_t seed;
+
+	/*
+	 The simulation being played back. It's tick is the next frame to be played.
+	 */
+	Simulation *simulation;
+
+	//The whole file, which is read into memory when it is opened.
+	uint8_t *bytes;
+	size_t length;
+	size_t firstRecordOffset;
+	size_t nextRecordOffset;
+
+	//The part of the current frames record which hasn't been played, and the movement it's frames carry on with.
+	WireReader frames;
+	uint32_t framesRemaining;
+	uint8_t headings[kSimulationMaximumPlayers];
+	uint8_t speeds[kSimulationMaximumPlayers];
+
+	ReplayKeyframe *keyframes;
+	unsigned int keyframeCount;
+
+	//What the file says the game ended with. Only set if the recording was closed with a final simulation.
+	int hasEnd;
+	uint32_t endFrame;
+	int endScores[kSimulationMaximumPlayers];
+	uint32_t endChecksum;
+
+	//Keyframes the simulation was compared with during playback, and how many it didn't match.
+	unsigned long keyframesChecked;
+	unsigned long keyframeMismatches;
+	uint8_t *scratchState;
+	size_t scratchCapacity;
+
+	//Set if a record is invalid. Playback stops when it is reached.
+	int error;
+
+	ReplayEventHandler eventHandler;
+	void *eventContext;
+
+} ReplayPlayer;
+
+/*
+ Creates the file at path, replacing any file already there, and writes the header for a game played with
+ the configuration and seed specified. Returns NULL if the file couldn't be created or the memory could not
+ be allocated.
+ */
+ReplayRecorder *ReplayRecorderOpen(const char *path, const SimulationConfig *config, uint32_t seed);
+
+/*
+ Returns non-zero if a keyframe should be added before the next frame.
+ */
+int ReplayRecorderKeyframeDue(const ReplayRecorder *recorder);
+
+/*
+ Adds a keyframe for the next frame. state is the simulation saved at the start of that frame.
+ */
+void ReplayRecorderAddKeyframe(ReplayRecorder *recorder, const void *state, size_t length);
+
+/*
+ Adds the inputs of the next frame, one for each player.
+ */
+void ReplayRecorderAddFrame(ReplayRecorder *recorder, const SimulationInput *inputs);
+
+/*
+ Adds a network event which was handled before the next frame.
+ */
+void ReplayRecorderAddEvent(ReplayRecorder *recorder, int eventType, int32_t data);
+
+/*
+ Writes the frames which are still pending and closes the file. If simulation isn't NULL and has played
+ every frame recorded, it's scores and checksum are written as the result of the game. Returns 0 if any
+ part of the recording couldn't be written. The recorder is freed either way.
+ */
+int ReplayRecorderClose(ReplayRecorder *recorder, const Simulation *simulation);
+
+/*
+ Reads the file at path and creates a simulation to play it back with, at the start of the game. Returns
+ NULL if the file can't be read, isn't a replay file, has a different version or the memory could not be
+ allocated. A file whose last record was cut short is played up to the record before it.
+ */
+ReplayPlayer *ReplayPlayerOpen(const char *path);
+
+/*
+ Frees the player and it's simulation.
+ */
+void ReplayPlayerClose(ReplayPlayer *player);
+
+/*
+ Plays the next frame. Returns 0 if there are no frames left or the file is invalid.
+ */
+int ReplayPlayerStep(ReplayPlayer *player);
+
+/*
+ Plays every frame left and returns the number played.
+ */
+uint32_t ReplayPlayerPlay(ReplayPlayer *player);
+
+/*
+ Moves the playback to the start of the frame specified, loading the nearest keyframe before it if the
+ frame is behind the simulation or a keyframe is closer. Returns 0 if the file ends before that frame, in
+ which case the playback is left at the end of the file.
+ */
+int ReplayPlayerSeek(ReplayPlayer *player, uint32_t frame);
+
+/*
+ Plays every frame left and compares the result with the end of the file. Returns non-zero if the file has
+ a result, every frame was played, the scores and checksum match and every keyframe passed matched the
+ simulation.
+ */
+int ReplayPlayerVerify(ReplayPlayer *player);
+
+#endif // __REPLAY_FILE_H__
@@ -0,0 +1,161 @@
+//
+//  ReplicationScheduler.c
+//  AberFighter
+//
+//  Created by wde7 on 18/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include "ReplicationScheduler.h"
+
+void ReplicationSchedulerInit(ReplicationScheduler *scheduler) {
+
+	memset(scheduler, 0, sizeof(ReplicationScheduler));
+
+}
+
+void ReplicationSchedulerUpdate(ReplicationScheduler *scheduler, int entity, float weight, size_t size, double now) {
+
+	ReplicatedEntity *replicated = &scheduler->entities[entity];
+
+	if (!replicated->pending) {
+
+		replicated->pending = 1;
+		replicated->priority = 0.0f;
+		replicated->pendingSince = now;
+
+	}
+
+	replicated->weight = weight;
+	replicated->size = size;
+
+}
+
+void ReplicationSchedulerCancel(ReplicationScheduler *scheduler, int entity) {
+
+	scheduler->entities[entity].pending = 0;
+	scheduler->entities[entity].priority = 0.0f;
+
+}
+
+int ReplicationSchedulerIsPending(const ReplicationScheduler *scheduler, int entity) {
+
+	return scheduler->entities[entity].pending;
+
+}
+
+int ReplicationSchedulerFindIdle(const ReplicationScheduler *scheduler, int first, int last) {
+
+	for (int i = first; i <= last; i++) {
+
+		if (!scheduler->entities[i].pending) {
+			return i;
+		}
+
+	}
+
+	return -1;
+
+}
+
+int ReplicationSchedulerTick(ReplicationScheduler *scheduler, size_t budget, double now, int *selected) {
+
+	int order[kReplicationSchedulerMaximumEntities];
+	int pending = 0;
+	int count = 0;
+	float elapsed = scheduler->hasTicked ? (float)(now - scheduler->lastTickTime) : 0.0f;
+
+	scheduler->hasTicked = 1;
+	scheduler->lastTickTime = now;
+
+	/*
+	 Pending entities are built up and put in order of priority. There are only a few, so an insertion sort
+	 is fine. An entity made pending since the last tick still gets the whole tick, so that an update is
+	 never held back by the scheduler alone.
+	 */
+	for (int i = 0; i < kReplicationSchedulerMaximumEntities; i++) {
+
+		ReplicatedEntity *replicated = &scheduler->entities[i];
+
+		if (!replicated->pending) {
+			continue;
+		}
+
+		replicated->priority += replicated->weight * elapsed;
+
+		int position = pending;
+
+		while (position > 0 && scheduler->entities[order[position - 1]].priority < replicated->priority) {
+
+			order[position] = order[position - 1];
+			position--;
+
+		}
+
+		order[position] = i;
+		pending++;
+
+	}
+
+	for (int i = 0; i < pending; i++) {
+
+		ReplicatedEntity *replicated = &scheduler->entities[order[i]];
+
+		if (count > 0 && replicated->size > budget) {
+
+			replicated->statistics.deferrals++;
+			continue;
+
+		}
+
+		double staleness = now - replicated->pendingSince;
+
+		budget = (replicated->size > budget) ? 0 : budget - replicated->size;
+
+		replicated->pending = 0;
+		replicated->priority = 0.0f;
+		replicated->statistics.updatesSent++;
+		replicated->statistics.totalStaleness += staleness;
+
+		if (staleness > replicated->statistics.maximumStaleness) {
+			replicated->statistics.maximumStaleness = staleness;
+		}
+
+		selected[count++] = order[i];
+
+	}
+
+	return count;
+
+}
+
+double ReplicationSchedulerStaleness(const ReplicationScheduler *scheduler, int entity, double now) {
+
+	const ReplicatedEntity *replicated = &scheduler->entities[entity];
+
+	return replicated->pending ? now - replicated->pendingSince : 0.0;
+
+}
+
+void ReplicationStatisticsAdd(ReplicationStatistics *total, const ReplicationStatistics *statistics) {
+
+	total->updatesSent += statistics->updatesSent;
+	total->deferrals += statistics->deferrals;
+	total->totalStaleness += statistics->totalStaleness;
+
+	if (statistics->maximumStaleness > total->maximumStaleness) {
+		total->maximumStaleness = statistics->maximumStaleness;
+	}
+
+}
+
+double ReplicationStatisticsMeanStaleness(const ReplicationStatistics *statistics) {
+
+	if (statistics->updatesSent == 0) {
+		return 0.0;
+	}
+
+	return statistics->totalStaleness / statistics->updatesSent;
+
+}
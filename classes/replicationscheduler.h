@@ -0,0 +1,118 @@
+//
+//  ReplicationScheduler.h
+//  AberFighter
+//
+//  Created by wde7 on 18/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The ReplicationScheduler decides which of the updates waiting to be sent to a peer go in the next datagram.
+ Without it every update was sent as soon as it was made, so with more ships and projectiles the link would
+ saturate and updates were lost at random rather than by how much they mattered.
+
+ Each replicated entity, such as a ship or a projectile, has a slot in the scheduler. When the entity
+ changes it's slot is marked pending with a weight, which is how important an update is per second, and the
+ size of the update in bytes. Every tick each pending slot's priority grows by it's weight multiplied by the
+ time since the last tick, and the updates with the highest priority are chosen until the byte budget for
+ the datagram is used up. An update which doesn't fit is left for a later tick with the priority it has
+ built up, so low weight updates are delayed but never starved. The update with the highest priority is
+ always chosen, even if it is larger than the budget, so that the scheduler can't stall.
+
+ A newer update for a slot which is already pending replaces the old one but keeps it's priority and the
+ time it became pending, as only the newest state of an entity is worth sending.
+
+ For tuning, each slot records how many updates it has sent, how many times it was pending but left out of a
+ datagram, and it's staleness: the time from an update being made to it being sent.
+
+ Times are in seconds and must come from a clock which never goes backwards. The scheduler is written in
+ plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __REPLICATION_SCHEDULER_H__
+#define __REPLICATION_SCHEDULER_H__
+
+#include <stddef.h>
+
+//Number of entity slots in a scheduler.
+#define kReplicationSchedulerMaximumEntities 24
+
+typedef struct {
+
+	unsigned long updatesSent;
+	//Ticks in which an update was pending but not chosen.
+	unsigned long deferrals;
+	//Seconds from updates being made to them being sent, in total and the longest.
+	double totalStaleness;
+	double maximumStaleness;
+
+} ReplicationStatistics;
+
+typedef struct {
+
+	int pending;
+	float weight;
+	float priority;
+	size_t size;
+	double pendingSince;
+	ReplicationStatistics statistics;
+
+} ReplicatedEntity;
+
+typedef struct {
+
+	ReplicatedEntity entities[kReplicationSchedulerMaximumEntities];
+	int hasTicked;
+	double lastTickTime;
+
+} ReplicationScheduler;
+
+/*
+ Starts a scheduler with nothing pending and no statistics.
+ */
+void ReplicationSchedulerInit(ReplicationScheduler *scheduler);
+
+/*
+ Marks an entity as having an update of size bytes to send with the weight specified. If it is already
+ pending the weight and size are replaced and the priority is kept.
+ */
+void ReplicationSchedulerUpdate(ReplicationScheduler *scheduler, int entity, float weight, size_t size, double now);
+
+/*
+ Forgets the pending update of an entity without counting it as sent.
+ */
+void ReplicationSchedulerCancel(ReplicationScheduler *scheduler, int entity);
+
+/*
+ Returns non-zero if the entity has an update waiting to be sent.
+ */
+int ReplicationSchedulerIsPending(const ReplicationScheduler *scheduler, int entity);
+
+/*
+ Returns the first entity from first to last inclusive which has nothing pending, or -1 if they all do.
+ */
+int ReplicationSchedulerFindIdle(const ReplicationScheduler *scheduler, int first, int last);
+
+/*
+ Builds up the priority of every pending entity and chooses the updates to send within budget bytes. The
+ chosen entities are written to selected, which must have room for kReplicationSchedulerMaximumEntities, from
+ the highest priority to the lowest, and their number is returned. Chosen entities are no longer pending and
+ their priority starts again from 0.
+ */
+int ReplicationSchedulerTick(ReplicationScheduler *scheduler, size_t budget, double now, int *selected);
+
+/*
+ Returns how long the entity's pending update has been waiting, or 0 if it has nothing pending.
+ */
+double ReplicationSchedulerStaleness(const ReplicationScheduler *scheduler, int entity, double now);
+
+/*
+ Adds the statistics of one entity to a total, keeping the longest staleness of the two.
+ */
+void ReplicationStatisticsAdd(ReplicationStatistics *total, const ReplicationStatistics *statistics);
+
+/*
+ Returns the mean seconds from an update being made to it being sent, or 0 if none have been sent.
+ */
+double ReplicationStatisticsMeanStaleness(const ReplicationStatistics *statistics);
+
+#endif // __REPLICATION_SCHEDULER_H__
@@ -6,35 +6,120 @@
 //  Copyright 2011 William Darius Elphick. All rights reserved.
 //
 /*
- This class implements the Object Pool design pattern. Targets are initialized and 
- added to the pool beforehand to avoid instantiating them while the game 
+ This class implements the Object Pool design pattern. Targets are initialized and
+ added to the pool beforehand to avoid instantiating them while the game
  is running. Layers can request a TargetShip of a particular type and the pool will return
- a reference as long as an appropriate target instance is available. Once the layer is 
+ a reference as long as an appropriate target instance is available. Once the layer is
  finished with a target it is expected to return it to the pool so that it can be re-used.
- 
+
+ The available targets of each type are kept in a free list linked through the TargetShip's
+ nextAvailableTarget variable, so acquiring and releasing a target are O(1) regardless of
+ the size of the pool.
+
+ Each type has a low and a high watermark. When the number of available targets of a type drops
+ below the low watermark the pool schedules itself to create more on the next pass of the run
+ loop, after the current frame has finished, rather than allocating sprites in the middle of a frame.
+ The pool never holds more than the high watermark of a type, which by default is the most targets of
+ the type which can be active at once in GameConstants.h, the same limit the Simulation uses. The pool
+ keeps statistics for each type which can be used to choose the watermarks for dense waves of targets.
+
  ReusableTargetPool is used as a singleton.
  */
 
 #import <Foundation/Foundation.h>
 #import "TargetShip.h"
 
+/*
+ The number of targets of each type created when the pool is initialised. These keep the 3:1 ratio
+ of small to large targets which the pool has always used.
+ */
+#define kReusableTargetPoolInitialSmallTargets 15
+#define kReusableTargetPoolInitialLargeTargets 5
+
+/*
+ Default low watermark. The pool grows when fewer than the low watermark of a type are available. The
+ default high watermarks are kGameMaximumActiveSmallTargets and kGameMaximumActiveLargeTargets.
+ */
+#define kReusableTargetPoolDefaultLowWatermark 2
+
+//Number of targets created each time the pool grows.
+#define kReusableTargetPoolGrowthSize 5
+
+/*
+ Statistics kept for each TargetType. A hit is a request which returned a target, a miss is a request
+ which returned nil because no target of the type was available.
+ */
+typedef struct ReusableTargetPoolStatistics {
+
+	unsigned int hits;
+	unsigned int misses;
+	//Number of targets of the type currently acquired, and the highest this has been.
+	unsigned int inUse;
+	unsigned int peakInUse;
+	//Number of targets of the type owned by the pool, and the number of times the pool has grown.
+	unsigned int capacity;
+	unsigned int growths;
+
+} ReusableTargetPoolStatistics;
+
 @interface ReusableTargetPool : NSObject {
 
+	/*
+	 Stores every TargetShip instance which belongs to the pool, whether available or in use.
+	 */
+	NSMutableArray *reusableTargetShips;
+
+	/*
+	 Head of the free list of each type. nil when no target of the type is available.
+	 */
+	TargetShip *availableTargets[kTargetShipTypeCount];
+
+	unsigned int availableCount[kTargetShipTypeCount];
+	unsigned int lowWatermark[kTargetShipTypeCount];
+	unsigned int highWatermark[kTargetShipTypeCount];
+	ReusableTargetPoolStatistics statistics[kTargetShipTypeCount];
+
+	/*
+	 Indicates whether a call to growPool has already been scheduled.
+	 */
+	BOOL growthScheduled;
+
 }
 
 /*
- ReusableTargetPool is a singleton. This method instantiates the singleton if this hasn't 
+ ReusableTargetPool is a singleton. This method instantiates the singleton if this hasn't
  been done previously and returns a reference to it.
  */
 + (ReusableTargetPool *)sharedInstance;
 /*
  Returns a TargetShip instance of the specified type if one is available in the pool.
- If an appropriate target is not available then nil is returned.
+ If an appropriate target is not available then nil is returned and the pool is scheduled
+ to grow.
  */
 - (TargetShip *)acquireTargetShipWithType:(TargetType)type;
+/*
+ Makes sure at least count targets of the specified type are available, creating any which are missing
+ straight away rather than on the next pass of the run loop. The high watermark of the type is raised if
+ it is in the way. Used when whether a target is spawned must not depend on when the pool happened to
+ grow, as in a multiplayer game where both devices spawn the same targets.
+ */
+- (void)reserveTargetShipsWithType:(TargetType)type count:(unsigned int)count;
 /*
  This method should be used for returning a TargetShip to the pool for re-use.
  */
 - (void)releaseTargetShip:(TargetShip *)target;
+/*
+ Sets the watermarks for a TargetType. The pool grows immediately if it holds fewer available
+ targets than the new low watermark.
+ */
+- (void)setLowWatermark:(unsigned int)low highWatermark:(unsigned int)high forType:(TargetType)type;
+/*
+ Returns the statistics recorded for a TargetType.
+ */
+- (ReusableTargetPoolStatistics)statisticsForType:(TargetType)type;
+/*
+ Resets the hit, miss and peak counters of every type, e.g. at the start of a game.
+ */
+- (void)resetStatistics;
 
 @end
@@ -10,24 +10,55 @@
 
 @implementation ReusableTargetPool
 
-/*
- The reusableTargetShips array stores the TargetShip instances which are in the pool.
- */
-NSMutableArray *reusableTargetShips;
 /*
  Singleton of this class.
  */
-static ReusableTargetPool *sharedReusableTargetPool = nil; 
+static ReusableTargetPool *sharedReusableTargetPool = nil;
 
 //Static Singleton accessor.
 + (ReusableTargetPool *)sharedInstance {
-	
+
 	if (!sharedReusableTargetPool) {
 		sharedReusableTargetPool = [[ReusableTargetPool alloc] init];
 	}
-	
+
 	return sharedReusableTargetPool;
-	
+
+}
+
+/*
+ Pushes a TargetShip onto the front of the free list for it's type. Must be called while synchronized.
+ */
+- (void)pushAvailableTarget:(TargetShip *)target {
+
+	TargetType type = target.targetType;
+
+	target.currentlyInUse = NO;
+	target.nextAvailableTarget = availableTargets[type];
+	availableTargets[type] = target;
+	availableCount[type]++;
+
+}
+
+/*
+ Creates new TargetShip instances of the specified type and adds them to the pool, without exceeding
+ the high watermark. Must be called while synchronized.
+ */
+- (void)addTargetShipsWithType:(TargetType)type count:(unsigned int)count {
+
+	TargetShip *newTargetShip = nil;
+
+	for (unsigned int i = 0; i < count && statistics[type].capacity < highWatermark[type]; i++) {
+
+		newTargetShip = [[TargetShip alloc] initTargetWithType:type];
+		[reusableTargetShips addObject:newTargetShip];
+		[self pushAvailableTarget:newTargetShip];
+		[newTargetShip release];
+
+		statistics[type].capacity++;
+
+	}
+
 }
 
 /*
@@ -35,126 +66,213 @@ static ReusableTargetPool *sharedReusableTargetPool = nil;
  TargetShip objects and returns a reference to the class.
  */
 - (id)init {
-	
+
 	if ((self = [super init])) {
-		
-		/*
-		 The initial size of the Object Pool. 20 TargetShips is sufficient because in the
-		 current application the action is confined to the size of the screen. 
-		 */
-		int initialPoolSize = 20;
-		
-		/*
-		 Create and retain an array to store the TargetShip instances. 
-		 */
-		reusableTargetShips = [[[NSMutableArray alloc] initWithCapacity:initialPoolSize] retain];
-		
-		/*
-		 Currently the ratio of small target ships to large target ships is 3/1. This can be changed
-		 to add new ships to the pool on initialization in the future.
-		 */
-		float shipTypeRatio = initialPoolSize / 4;
-		
-		TargetShip *newTargetShip = nil;
-		
-		/*
-		 Create the required amount of TargetShips of type small.
-		 */
-		for (int i = 0; i < (shipTypeRatio * 3); i++) {
-			
-			newTargetShip = [[TargetShip alloc] initTargetWithType:kTargetShipSmall];
-			[reusableTargetShips addObject:newTargetShip];
-			[newTargetShip release];
-			
+
+		reusableTargetShips = [[NSMutableArray alloc] initWithCapacity:(kReusableTargetPoolInitialSmallTargets +
+																		kReusableTargetPoolInitialLargeTargets)];
+
+		for (int type = 0; type < kTargetShipTypeCount; type++) {
+
+			availableTargets[type] = nil;
+			availableCount[type] = 0;
+			lowWatermark[type] = kReusableTargetPoolDefaultLowWatermark;
+			memset(&statistics[type], 0, sizeof(ReusableTargetPoolStatistics));
+
 		}
-		
+
+		highWatermark[kTargetShipSmall] = kGameMaximumActiveSmallTargets;
+		highWatermark[kTargetShipLarge] = kGameMaximumActiveLargeTargets;
+
+		growthScheduled = NO;
+
 		/*
-		 Create the required amount of TargetShips of type large.
+		 Currently the ratio of small target ships to large target ships is 3/1. The initial sizes can be
+		 changed to add more ships to the pool on initialization in the future.
 		 */
-		for (int i = 0; i < shipTypeRatio; i++) {
-			
-			newTargetShip = [[TargetShip alloc] initTargetWithType:kTargetShipLarge];
-			[reusableTargetShips addObject:newTargetShip];
-			[newTargetShip release];
-			
-		}
-		
+		[self addTargetShipsWithType:kTargetShipSmall count:kReusableTargetPoolInitialSmallTargets];
+		[self addTargetShipsWithType:kTargetShipLarge count:kReusableTargetPoolInitialLargeTargets];
+
 	}
-	
+
 	return self;
-	
+
+}
+
+/*
+ Called on the main thread after the frame which requested it has finished. Tops up every type which
+ has fewer available targets than it's low watermark.
+ */
+- (void)growPool {
+
+	@synchronized (self) {
+
+		growthScheduled = NO;
+
+		for (int type = 0; type < kTargetShipTypeCount; type++) {
+
+			if (availableCount[type] < lowWatermark[type] && statistics[type].capacity < highWatermark[type]) {
+
+				[self addTargetShipsWithType:type count:MAX(kReusableTargetPoolGrowthSize, lowWatermark[type] - availableCount[type])];
+				statistics[type].growths++;
+
+			}
+
+		}
+
+	}
+
+}
+
+/*
+ Schedules growPool to run on the main thread. Because waitUntilDone is NO the call is queued on the
+ run loop and only runs once the current frame has been drawn, so no sprites are created mid-frame.
+ Must be called while synchronized.
+ */
+- (void)scheduleGrowthIfNeededForType:(TargetType)type {
+
+	if (!growthScheduled && availableCount[type] < lowWatermark[type] && statistics[type].capacity < highWatermark[type]) {
+
+		growthScheduled = YES;
+		[self performSelectorOnMainThread:@selector(growPool) withObject:nil waitUntilDone:NO];
+
+	}
+
 }
 
 /*
- Returns a reference to a TargetShip of the specified type. Will return nil if no 
+ Returns a reference to a TargetShip of the specified type. Will return nil if no
  suitable TargetShip instances are available.
  */
 - (TargetShip *)acquireTargetShipWithType:(TargetType)type {
-	
-	TargetShip *instance;
-	
+
+	TargetShip *instance = nil;
+
 	/*
-	 Access to the reusableTargetShips array (i.e. the object pool) is synchronized to
-	 ensure that only one thread can access it at a time. This avoids data inconsistency 
-	 in the situation that TargetShip instances are requested in this method while
-	 simultaneously being released in the releaseTargetShip method by another thread.	 
+	 Access to the pool is synchronized to ensure that only one thread can access it at a time. This avoids
+	 data inconsistency in the situation that TargetShip instances are requested in this method while
+	 simultaneously being released in the releaseTargetShip method by another thread. The work done inside
+	 the block is constant, so the lock is only held briefly.
 	 */
-	@synchronized (reusableTargetShips) {
+	@synchronized (self) {
+
 		/*
-		 Enumerate over the object pool. If an instance of the required type is found which is
-		 not in use (indicated by the currentlyInUse variable in the TargetShip class), mark it
-		 as in use and return a reference to it.
+		 The first target in the type's free list is removed from the list, marked as in use and returned.
 		 */
-		NSEnumerator *enumerator = [reusableTargetShips objectEnumerator];
-		while ((instance = (TargetShip *)[enumerator nextObject])) {
-			
-			if ((instance.targetType == type) && (!instance.currentlyInUse)) {
-				instance.currentlyInUse = YES;
-				return instance;
+		instance = availableTargets[type];
+
+		if (instance != nil) {
+
+			availableTargets[type] = instance.nextAvailableTarget;
+			availableCount[type]--;
+			instance.nextAvailableTarget = nil;
+			instance.currentlyInUse = YES;
+
+			statistics[type].hits++;
+			statistics[type].inUse++;
+
+			if (statistics[type].inUse > statistics[type].peakInUse) {
+				statistics[type].peakInUse = statistics[type].inUse;
 			}
-			
+
+		} else {
+
+			statistics[type].misses++;
+
 		}
+
+		[self scheduleGrowthIfNeededForType:type];
+
 	}
-	
-	/*
-	 If the method reaches this point, no TargetShip was found. Therefore return nil.
-	 */
-	return nil;
-	
+
+	return instance;
+
+}
+
+- (void)reserveTargetShipsWithType:(TargetType)type count:(unsigned int)count {
+
+	@synchronized (self) {
+
+		/*
+		 The pool grows by at least kReusableTargetPoolGrowthSize as usual, as far as the high watermark
+		 allows, so that reserving one target at a time doesn't create one target at a time.
+		 */
+		if (availableCount[type] < count) {
+
+			unsigned int missing = count - availableCount[type];
+
+			highWatermark[type] = MAX(highWatermark[type], statistics[type].capacity + missing);
+			[self addTargetShipsWithType:type count:MAX(missing, kReusableTargetPoolGrowthSize)];
+			statistics[type].growths++;
+
+		}
+
+	}
+
 }
 
 /*
- Finds the TargetShip instance referred to in the parameter in the object pool, resets
- it's variables and marks it as available.
+ Resets the TargetShip's variables and pushes it back onto the free list of it's type, making it available to
+ the acquireTargetShipWithType method. Targets which aren't in use are ignored so that releasing a target
+ twice can't add it to the free list twice.
  */
 - (void)releaseTargetShip:(TargetShip *)target {
-	
-	TargetShip *instance;
-	
-	/*
-	 Access to the reusableTargetShips array (i.e. the object pool) is synchronized to
-	 ensure that only one thread can access it at a time.	 
-	 */
-	@synchronized (reusableTargetShips) {
-		
-		/*
-		 Enumerate over the object pool. When the TargetShip instance referred to in the 
-		 parameter is found, call the TargetShip resetVariables method which restores the 
-		 initial state of the target and then set currentlyInUse to false, which makes the 
-		 instance available to the acquireTargetShipWithType method. 
-		 */
-		NSEnumerator *enumerator = [reusableTargetShips objectEnumerator];
-		while ((instance = (TargetShip *)[enumerator nextObject])) {
-			if ([instance isEqual:target]) {
-			
-				[instance resetVariables];
-				instance.currentlyInUse = NO;
-				
-			}
-			
+
+	@synchronized (self) {
+
+		if (target.currentlyInUse) {
+
+			[target resetVariables];
+			[self pushAvailableTarget:target];
+			statistics[target.targetType].inUse--;
+
+		}
+
+	}
+
+}
+
+- (void)setLowWatermark:(unsigned int)low highWatermark:(unsigned int)high forType:(TargetType)type {
+
+	@synchronized (self) {
+
+		highWatermark[type] = MAX(low, high);
+		lowWatermark[type] = low;
+		[self scheduleGrowthIfNeededForType:type];
+
+	}
+
+}
+
+- (ReusableTargetPoolStatistics)statisticsForType:(TargetType)type {
+
+	ReusableTargetPoolStatistics typeStatistics;
+
+	@synchronized (self) {
+		typeStatistics = statistics[type];
+	}
+
+	return typeStatistics;
+
+}
+
+/*
+ inUse, capacity and growths describe the pool itself rather than a game, so they are kept.
+ */
+- (void)resetStatistics {
+
+	@synchronized (self) {
+
+		for (int type = 0; type < kTargetShipTypeCount; type++) {
+
+			statistics[type].hits = 0;
+			statistics[type].misses = 0;
+			statistics[type].peakInUse = statistics[type].inUse;
+
 		}
+
 	}
-	
+
 }
 
 /*
@@ -162,12 +280,12 @@ static ReusableTargetPool *sharedReusableTargetPool = nil;
  which recursively calls release on the TargetShip instances within it.
  */
 - (void)dealloc {
-	
+
 	[reusableTargetShips release];
 	reusableTargetShips = nil;
 	sharedReusableTargetPool = nil;
 	[super dealloc];
-	
+
 }
 
 @end
@@ -0,0 +1,433 @@
+//
+//  RollbackSession.c
+//  AberFighter
+//
+//  Created by wde7 on 15/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include "RollbackSession.h"
+
+#define kRollbackSessionHistoryMask (kRollbackSessionHistorySize - 1)
+
+/*
+ Flags written before each input in a message. kRollbackInputFlagMovement is set when the heading and speed
+ follow, otherwise they are the same as the previous input in the message.
+ */
+#define kRollbackInputFlagFire		0x01
+#define kRollbackInputFlagMovement	0x02
+
+static RollbackInput RollbackSessionQuantizeInput(const SimulationInput *input) {
+
+	RollbackInput quantized;
+
+	quantized.heading = WireQuantizeHeading(input->heading);
+	quantized.speed = WireQuantizeSpeed(input->speed);
+	quantized.fire = (input->fire != 0) ? 1 : 0;
+
+	return quantized;
+
+}
+
+static void RollbackSessionDequantizeInput(const RollbackInput *input, SimulationInput *dequantized) {
+
+	dequantized->heading = WireDequantizeHeading(input->heading);
+	dequantized->speed = WireDequantizeSpeed(input->speed);
+	dequantized->fire = input->fire;
+
+}
+
+static int RollbackSessionInputsEqual(const RollbackInput *a, const RollbackInput *b) {
+
+	return a->heading == b->heading && a->speed == b->speed && a->fire == b->fire;
+
+}
+
+RollbackSession *RollbackSessionNew(const SimulationConfig *config, uint32_t seed, int localPlayerIndex) {
+
+	RollbackSession *session = (RollbackSession *)calloc(1, sizeof(RollbackSession));
+
+	if (session == NULL) {
+		return NULL;
+	}
+
+	session->simulation = SimulationNew(config, seed);
+
+	if (session->simulation == NULL) {
+		RollbackSessionFree(session);
+		return NULL;
+	}
+
+	session->localPlayerIndex = localPlayerIndex;
+	session->remotePlayerIndex = (localPlayerIndex == 0) ? 1 : 0;
+
+	/*
+	 Nothing can be sampled for the frames before the input delay has passed, so both devices use each ship's
+	 starting heading with no speed for them. They are treated as if they had been received from the peer.
+	 */
+	for (int p = 0; p < 2; p++) {
+
+		SimulationInput startingInput = { session->simulation->players[p].heading, 0.0f, 0 };
+		RollbackInput input = RollbackSessionQuantizeInput(&startingInput);
+
+		for (uint32_t frame = 0; frame < kRollbackSessionInputDelay; frame++) {
+
+			if (p == session->localPlayerIndex) {
+				session->localInputs[frame] = input;
+			} else {
+				session->remoteInputs[frame] = input;
+			}
+
+		}
+
+		if (p == session->remotePlayerIndex) {
+			session->lastConfirmedRemoteInput = input;
+		}
+
+	}
+
+	session->currentFrame = 0;
+	session->localInputFrame = kRollbackSessionInputDelay;
+	session->confirmedRemoteFrame = kRollbackSessionInputDelay;
+	session->acknowledgedLocalFrame = kRollbackSessionInputDelay;
+
+	return session;
+
+}
+
+void RollbackSessionFree(RollbackSession *session) {
+
+	if (session == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < kRollbackSessionHistorySize; i++) {
+		free(session->savedStates[i].bytes);
+	}
+
+	SimulationFree(session->simulation);
+	free(session);
+
+}
+
+/*
+ Saves the state of the simulation as the state at the start of the frame specified.
+ */
+static int RollbackSessionSaveState(RollbackSession *session, uint32_t frame) {
+
+	RollbackSavedState *state = &session->savedStates[frame & kRollbackSessionHistoryMask];
+	size_t size = SimulationStateSize(session->simulation);
+
+	if (size > state->capacity) {
+
+		/*
+		 Room is left for the state to grow by a few entities, so the buffer isn't reallocated every time a
+		 projectile is fired.
+		 */
+		size_t capacity = size * 2;
+		uint8_t *bytes = (uint8_t *)realloc(state->bytes, capacity);
+
+		if (bytes == NULL) {
+			return 0;
+		}
+
+		state->bytes = bytes;
+		state->capacity = capacity;
+
+	}
+
+	state->length = SimulationSaveState(session->simulation, state->bytes, state->capacity);
+
+	return state->length != 0;
+
+}
+
+/*
+ Simulates one frame. The peer's input is predicted if it hasn't been received, and the prediction is
+ stored so that it can be compared with the real input when it arrives.
+ */
+static void RollbackSessionSimulateFrame(RollbackSession *session, uint32_t frame) {
+
+	unsigned int slot = frame & kRollbackSessionHistoryMask;
+	SimulationInput inputs[kSimulationMaximumPlayers];
+
+	if (frame >= session->confirmedRemoteFrame) {
+
+		session->remoteInputs[slot] = session->lastConfirmedRemoteInput;
+		session->remoteInputs[slot].fire = 0;
+
+	}
+
+	RollbackSessionDequantizeInput(&session->localInputs[slot], &inputs[session->localPlayerIndex]);
+	RollbackSessionDequantizeInput(&session->remoteInputs[slot], &inputs[session->remotePlayerIndex]);
+
+	SimulationStep(session->simulation, inputs);
+
+}
+
+/*
+ Rewinds the simulation to the earliest frame with a wrong prediction and simulates every frame up to the
+ current frame again.
+ */
+static void RollbackSessionRollBack(RollbackSession *session) {
+
+	uint32_t frame = session->rollbackFrame;
+	RollbackSavedState *state = &session->savedStates[frame & kRollbackSessionHistoryMask];
+
+	session->rollbackPending = 0;
+
+	if (!SimulationLoadState(session->simulation, state->bytes, state->length)) {
+
+		session->desynchronized = 1;
+		return;
+
+	}
+
+	unsigned int framesResimulated = session->currentFrame - frame;
+
+	for (; frame < session->currentFrame; frame++) {
+
+		/*
+		 The state at the start of the first frame hasn't changed, but every later one has.
+		 */
+		if (frame != session->rollbackFrame) {
+			RollbackSessionSaveState(session, frame);
+		}
+
+		RollbackSessionSimulateFrame(session, frame);
+
+	}
+
+	session->statistics.rollbacks++;
+	session->statistics.framesResimulated += framesResimulated;
+
+	if (framesResimulated > session->statistics.longestRollback) {
+		session->statistics.longestRollback = framesResimulated;
+	}
+
+}
+
+int RollbackSessionAdvance(RollbackSession *session, const SimulationInput *localInput) {
+
+	if (session->rollbackPending) {
+		RollbackSessionRollBack(session);
+	}
+
+	if (session->desynchronized) {
+		return 0;
+	}
+
+	/*
+	 The session waits for the peer rather than predicting too far ahead of it. The local inputs are only kept
+	 for kRollbackSessionHistorySize frames, so it also waits if the peer stops acknowledging them.
+	 */
+	if (session->currentFrame >= session->confirmedRemoteFrame &&
+		session->currentFrame - session->confirmedRemoteFrame >= kRollbackSessionMaximumPrediction) {
+
+		session->statistics.stalls++;
+		return 0;
+
+	}
+
+	if (session->localInputFrame - session->acknowledgedLocalFrame >= kRollbackSessionHistorySize) {
+
+		session->statistics.stalls++;
+		return 0;
+
+	}
+
+	if (!RollbackSessionSaveState(session, session->currentFrame)) {
+		return 0;
+	}
+
+	session->localInputs[session->localInputFrame & kRollbackSessionHistoryMask] = RollbackSessionQuantizeInput(localInput);
+	session->localInputFrame++;
+
+	RollbackSessionSimulateFrame(session, session->currentFrame);
+
+	session->currentFrame++;
+	session->statistics.framesAdvanced++;
+
+	return 1;
+
+}
+
+uint32_t RollbackSessionConfirmedFrame(const RollbackSession *session) {
+
+	if (session->confirmedRemoteFrame < session->currentFrame) {
+		return session->confirmedRemoteFrame;
+	}
+
+	return session->currentFrame;
+
+}
+
+/*
+ Returns non-zero if the slot of a frame which has been simulated hasn't been reused by a later frame, when
+ the frames up to lastFrame have been written to the ring.
+ */
+static int RollbackSessionSlotHolds(const RollbackSession *session, uint32_t frame, uint32_t lastFrame) {
+
+	return frame < session->currentFrame && frame + kRollbackSessionHistorySize > lastFrame;
+
+}
+
+int RollbackSessionFrameInputs(const RollbackSession *session, uint32_t frame, SimulationInput *inputs) {
+
+	unsigned int slot = frame & kRollbackSessionHistoryMask;
+
+	/*
+	 Local inputs are recorded ahead of the current frame, and the peer's may have been received further ahead.
+	 */
+	if (!RollbackSessionSlotHolds(session, frame, session->localInputFrame - 1) ||
+		!RollbackSessionSlotHolds(session, frame, session->confirmedRemoteFrame - 1)) {
+		return 0;
+	}
+
+	RollbackSessionDequantizeInput(&session->localInputs[slot], &inputs[session->localPlayerIndex]);
+	RollbackSessionDequantizeInput(&session->remoteInputs[slot], &inputs[session->remotePlayerIndex]);
+
+	return 1;
+
+}
+
+const void *RollbackSessionSavedState(const RollbackSession *session, uint32_t frame, size_t *length) {
+
+	const RollbackSavedState *state = &session->savedStates[frame & kRollbackSessionHistoryMask];
+
+	if (!RollbackSessionSlotHolds(session, frame, session->currentFrame - 1) || state->length == 0) {
+		return NULL;
+	}
+
+	*length = state->length;
+
+	return state->bytes;
+
+}
+
+int RollbackSessionWriteMessage(const RollbackSession *session, WireWriter *writer) {
+
+	uint32_t firstFrame = session->acknowledgedLocalFrame;
+	uint32_t count = session->localInputFrame - firstFrame;
+
+	WireWriteVarUInt(writer, session->confirmedRemoteFrame);
+	WireWriteVarUInt(writer, firstFrame);
+	WireWriteVarUInt(writer, count);
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		const RollbackInput *input = &session->localInputs[(firstFrame + i) & kRollbackSessionHistoryMask];
+		const RollbackInput *previousInput = &session->localInputs[(firstFrame + i - 1) & kRollbackSessionHistoryMask];
+		uint8_t flags = input->fire ? kRollbackInputFlagFire : 0;
+
+		if (i == 0 || input->heading != previousInput->heading || input->speed != previousInput->speed) {
+			flags |= kRollbackInputFlagMovement;
+		}
+
+		WireWriteUInt8(writer, flags);
+
+		if (flags & kRollbackInputFlagMovement) {
+
+			WireWriteUInt8(writer, input->heading);
+			WireWriteUInt8(writer, input->speed);
+
+		}
+
+	}
+
+	return !writer->overflow;
+
+}
+
+int RollbackSessionReadMessage(WireReader *reader, RollbackInputMessage *message) {
+
+	message->acknowledgedFrame = WireReadVarUInt(reader);
+	message->firstFrame = WireReadVarUInt(reader);
+	uint32_t count = WireReadVarUInt(reader);
+
+	if (reader->error || count > kRollbackSessionHistorySize) {
+		return 0;
+	}
+
+	message->count = count;
+
+	for (uint32_t i = 0; i < count; i++) {
+
+		RollbackInput *input = &message->inputs[i];
+		uint8_t flags = WireReadUInt8(reader);
+
+		if (flags & kRollbackInputFlagMovement) {
+
+			input->heading = WireReadUInt8(reader);
+			input->speed = WireReadUInt8(reader);
+
+		} else if (i > 0) {
+
+			input->heading = message->inputs[i - 1].heading;
+			input->speed = message->inputs[i - 1].speed;
+
+		} else {
+
+			return 0;
+
+		}
+
+		input->fire = (flags & kRollbackInputFlagFire) ? 1 : 0;
+
+	}
+
+	return !reader->error;
+
+}
+
+void RollbackSessionAddMessage(RollbackSession *session, const RollbackInputMessage *message) {
+
+	/*
+	 Acknowledgements which go backwards are from messages which arrived out of order, and ones for inputs
+	 which haven't been recorded yet can't be genuine.
+	 */
+	if (message->acknowledgedFrame > session->acknowledgedLocalFrame &&
+		message->acknowledgedFrame <= session->localInputFrame) {
+		session->acknowledgedLocalFrame = message->acknowledgedFrame;
+	}
+
+	for (unsigned int i = 0; i < message->count; i++) {
+
+		uint32_t frame = message->firstFrame + i;
+
+		if (frame < session->confirmedRemoteFrame) {
+			continue;
+		}
+
+		/*
+		 Inputs are only added in order. The slots of frames which may still be rolled back to must not be
+		 overwritten, which limits how far ahead of the current frame an input can be.
+		 */
+		if (frame != session->confirmedRemoteFrame ||
+			(frame >= session->currentFrame &&
+			 frame - session->currentFrame >= kRollbackSessionHistorySize - kRollbackSessionMaximumPrediction)) {
+			break;
+		}
+
+		unsigned int slot = frame & kRollbackSessionHistoryMask;
+		const RollbackInput *input = &message->inputs[i];
+
+		if (frame < session->currentFrame && !RollbackSessionInputsEqual(&session->remoteInputs[slot], input)) {
+
+			if (!session->rollbackPending || frame < session->rollbackFrame) {
+				session->rollbackFrame = frame;
+			}
+
+			session->rollbackPending = 1;
+
+		}
+
+		session->remoteInputs[slot] = *input;
+		session->lastConfirmedRemoteInput = *input;
+		session->confirmedRemoteFrame++;
+
+	}
+
+}
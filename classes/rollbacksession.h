@@ -0,0 +1,206 @@
+//
+//  RollbackSession.h
+//  AberFighter
+//
+//  Created by wde7 on 15/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The RollbackSession runs a network game as a Simulation on both devices. Only the input of each player is
+ exchanged: the heading and speed produced by the DirectionalChangesCalculator and whether the fire button
+ was pressed, for every frame. Each device steps it's own copy of the simulation with the same inputs, so
+ both see the same targets, projectiles, hits and scores however late the packets arrive.
+
+ The local input is applied kRollbackSessionInputDelay frames after it is sampled, which gives it time to
+ reach the peer before it is needed. When the peer's input for a frame hasn't arrived the session predicts
+ it, repeating the peer's last heading and speed without firing, and carries on. The state before every
+ frame is saved, and when the real input turns out to be different from the prediction the simulation is
+ rewound to that frame and run forward again with the real input. The local device never gets more than
+ kRollbackSessionMaximumPrediction frames ahead of the inputs it has received, it stalls instead.
+
+ Inputs are quantized to the precision they are sent with before they are used, so both devices simulate
+ with exactly the same values. Every message repeats all of the local inputs the peer hasn't acknowledged,
+ so messages are sent unreliably and a lost one is covered by the next. Frames whose heading and speed are
+ the same as the previous frame take a single byte.
+
+ The session is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __ROLLBACK_SESSION_H__
+#define __ROLLBACK_SESSION_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "Simulation.h"
+#include "WireProtocol.h"
+
+/*
+ Frames between sampling the local input and applying it.
+ */
+#define kRollbackSessionInputDelay 2
+
+/*
+ Most frames which can be simulated with a predicted input for the peer before the session stalls.
+ */
+#define kRollbackSessionMaximumPrediction 8
+
+/*
+ Number of frames of inputs and saved states kept. Must be a power of 2 and larger than
+ kRollbackSessionInputDelay + kRollbackSessionMaximumPrediction. This is also the most inputs a message
+ can carry, so the session stalls if the peer stops acknowledging the local inputs.
+ */
+#define kRollbackSessionHistorySize 32
+
+/*
+ The input of one player for one frame, as it is sent to the peer.
+ */
+typedef struct {
+
+	uint8_t heading;
+	uint8_t speed;
+	uint8_t fire;
+
+} RollbackInput;
+
+/*
+ A message of inputs received from the peer. acknowledgedFrame is the number of local inputs the peer has
+ received without a gap, and the inputs are the peer's for the frames starting at firstFrame.
+ */
+typedef struct {
+
+	uint32_t acknowledgedFrame;
+	uint32_t firstFrame;
+	unsigned int count;
+	RollbackInput inputs[kRollbackSessionHistorySize];
+
+} RollbackInputMessage;
+
+/*
+ Counters kept by the session for measuring how often prediction goes wrong.
+ */
+typedef struct {
+
+	unsigned long framesAdvanced;
+	//Frames on which the session couldn't advance because it was too far ahead of the peer.
+	unsigned long stalls;
+	//Times a prediction was wrong and the simulation was rewound, and the frames simulated again as a result.
+	unsigned long rollbacks;
+	unsigned long framesResimulated;
+	unsigned int longestRollback;
+
+} RollbackStatistics;
+
+/*
+ A saved state of the simulation. The bytes are grown as needed and reused.
+ */
+typedef struct {
+
+	uint8_t *bytes;
+	size_t length;
+	size_t capacity;
+
+} RollbackSavedState;
+
+typedef struct {
+
+	/*
+	 The simulation owned by the session. It is at the start of currentFrame, which has not been simulated yet.
+	 */
+	Simulation *simulation;
+	int localPlayerIndex;
+	int remotePlayerIndex;
+	uint32_t currentFrame;
+
+	/*
+	 localInputFrame is the first frame without a local input. confirmedRemoteFrame is the first frame
+	 without an input from the peer, so every frame before it has a real input. acknowledgedLocalFrame is the
+	 first frame of local input the peer hasn't acknowledged.
+	 */
+	uint32_t localInputFrame;
+	uint32_t confirmedRemoteFrame;
+	uint32_t acknowledgedLocalFrame;
+
+	/*
+	 Inputs and saved states by frame, indexed by the frame modulo kRollbackSessionHistorySize. The remote
+	 inputs of frames which have been simulated but not confirmed hold the prediction which was used.
+	 */
+	RollbackInput localInputs[kRollbackSessionHistorySize];
+	RollbackInput remoteInputs[kRollbackSessionHistorySize];
+	RollbackSavedState savedStates[kRollbackSessionHistorySize];
+
+	//Predictions repeat the heading and speed of the last real input from the peer.
+	RollbackInput lastConfirmedRemoteInput;
+
+	//Set when a prediction was wrong. rollbackFrame is the earliest frame which must be simulated again.
+	int rollbackPending;
+	uint32_t rollbackFrame;
+
+	/*
+	 Set when a rollback failed because the saved state couldn't be loaded. The simulation no longer matches
+	 the peer's and the session can't continue.
+	 */
+	int desynchronized;
+
+	RollbackStatistics statistics;
+
+} RollbackSession;
+
+/*
+ Creates a session for a two player game, with a new simulation made from the configuration and seed.
+ localPlayerIndex is the index of the local player in the simulation's players. Returns NULL if the memory
+ could not be allocated.
+ */
+RollbackSession *RollbackSessionNew(const SimulationConfig *config, uint32_t seed, int localPlayerIndex);
+
+/*
+ Frees the session and it's simulation.
+ */
+void RollbackSessionFree(RollbackSession *session);
+
+/*
+ Records the local input sampled this frame and simulates the current frame. Any rollback needed because
+ of inputs received since the last call is done first. Returns 0, without recording the input, if the
+ session is too far ahead of the peer or the state could not be saved, and always once the session is
+ desynchronized.
+ */
+int RollbackSessionAdvance(RollbackSession *session, const SimulationInput *localInput);
+
+/*
+ Returns the first frame which was simulated with a predicted input. Every frame before it is final.
+ */
+uint32_t RollbackSessionConfirmedFrame(const RollbackSession *session);
+
+/*
+ Fills in the inputs the frame specified was last simulated with, one for each player. The peer's input is
+ the prediction if the frame hasn't been confirmed. Returns 0 if the frame hasn't been simulated or is no
+ longer in the history.
+ */
+int RollbackSessionFrameInputs(const RollbackSession *session, uint32_t frame, SimulationInput *inputs);
+
+/*
+ Returns the state saved at the start of the frame specified and sets length to it's size, or returns NULL
+ if the frame hasn't been simulated or is no longer in the history. The state is overwritten if the frame is
+ simulated again, which can only happen to frames from the confirmed frame on.
+ */
+const void *RollbackSessionSavedState(const RollbackSession *session, uint32_t frame, size_t *length);
+
+/*
+ Writes a message with the acknowledgement of the peer's inputs and every local input it hasn't acknowledged.
+ Returns 0 if there wasn't room for the whole message.
+ */
+int RollbackSessionWriteMessage(const RollbackSession *session, WireWriter *writer);
+
+/*
+ Reads a message written by RollbackSessionWriteMessage. Returns 0 if the data is invalid.
+ */
+int RollbackSessionReadMessage(WireReader *reader, RollbackInputMessage *message);
+
+/*
+ Adds the inputs in a message from the peer. Inputs which have already been received are ignored, as are
+ inputs after a gap, which will be repeated in a later message. If an input is different from the
+ prediction which was used for it's frame, the frames from there on are simulated again by the next call to
+ RollbackSessionAdvance.
+ */
+void RollbackSessionAddMessage(RollbackSession *session, const RollbackInputMessage *message);
+
+#endif // __ROLLBACK_SESSION_H__
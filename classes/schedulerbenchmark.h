@@ -0,0 +1,58 @@
+//
+//  SchedulerBenchmark.h
+//  AberFighter
+//
+//  Created by wde7 on 19/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The SchedulerBenchmark measures how the cost of a CCScheduler tick grows with the number of timers waiting
+ to fire. Each timer is a one-shot timer on a target of it's own, like the ones a TargetShip or PlayerShip
+ schedules: when it fires it unschedules itself and schedules a new one. The timers are due evenly over the
+ following seconds, so kSchedulerBenchmarkTimersPerTick fire every tick however many are pending, and only
+ the number pending changes between runs. The mean time of a tick is logged and kept in the result.
+
+ The shared scheduler is ticked directly rather than by the director, so the benchmark must be run before the
+ first scene.
+ */
+
+#import <Foundation/Foundation.h>
+
+/*
+ When kSchedulerBenchmarkOnLaunch is 1 the benchmark is run with several numbers of pending timers when the
+ app launches, and the results are logged.
+ */
+#define kSchedulerBenchmarkOnLaunch			0
+//Seconds added to the scheduler's time by each tick.
+#define kSchedulerBenchmarkTickInterval		(1.0f/60.0f)
+//Ticks measured in each run.
+#define kSchedulerBenchmarkTicks			600
+//Timers which fire in each tick.
+#define kSchedulerBenchmarkTimersPerTick	4
+
+typedef struct {
+
+	int pendingTimers;
+	int ticks;
+	unsigned long timersFired;
+	//Seconds taken by a tick, averaged over the run.
+	double meanTickTime;
+
+} SchedulerBenchmarkResult;
+
+@interface SchedulerBenchmark : NSObject {
+
+}
+
+/*
+ Runs the benchmark with 100, 1000 and 10000 pending timers and logs the results.
+ */
++ (void)compareNumbersOfTimers;
+
+/*
+ Runs the benchmark once with the number of pending timers specified, which must be at least
+ kSchedulerBenchmarkTimersPerTick, and logs the result.
+ */
++ (SchedulerBenchmarkResult)runWithPendingTimers:(int)pendingTimers;
+
+@end
@@ -0,0 +1,115 @@
+//
+//  SchedulerBenchmark.m
+//  AberFighter
+//
+//  Created by wde7 on 19/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "SchedulerBenchmark.h"
+#import "cocos2d.h"
+
+//Timers fired during the current run.
+static unsigned long timersFired = 0;
+
+/*
+ The target of a single one-shot timer. Once fired it is scheduled again for the furthest due time, which
+ keeps the number of pending timers the same.
+ */
+@interface SchedulerBenchmarkTimer : NSObject {
+
+	ccTime interval;
+
+}
+
+- (id)initWithInterval:(ccTime)newInterval;
+- (void)fire:(ccTime)dt;
+
+@end
+
+@implementation SchedulerBenchmarkTimer
+
+- (id)initWithInterval:(ccTime)newInterval {
+
+	if ((self = [super init])) {
+		interval = newInterval;
+	}
+
+	return self;
+
+}
+
+- (void)fire:(ccTime)dt {
+
+	CCScheduler *scheduler = [CCScheduler sharedScheduler];
+
+	timersFired++;
+	[scheduler unscheduleSelector:_cmd forTarget:self];
+	[scheduler scheduleSelector:_cmd forTarget:self interval:interval paused:NO];
+
+}
+
+@end
+
+@implementation SchedulerBenchmark
+
++ (void)compareNumbersOfTimers {
+
+	[self runWithPendingTimers:100];
+	[self runWithPendingTimers:1000];
+	[self runWithPendingTimers:10000];
+
+}
+
++ (SchedulerBenchmarkResult)runWithPendingTimers:(int)pendingTimers {
+
+	NSAssert(pendingTimers >= kSchedulerBenchmarkTimersPerTick, @"SchedulerBenchmark: too few pending timers");
+
+	CCScheduler *scheduler = [CCScheduler sharedScheduler];
+	NSMutableArray *timers = [[NSMutableArray alloc] initWithCapacity:pendingTimers];
+	ccTime furthestInterval = (pendingTimers / kSchedulerBenchmarkTimersPerTick) * kSchedulerBenchmarkTickInterval;
+	SchedulerBenchmarkResult result;
+
+	/*
+	 Each group of kSchedulerBenchmarkTimersPerTick timers is due a tick after the one before it. Timers
+	 start in the tick after they are scheduled, so the first tick only starts them and isn't measured.
+	 */
+	for (int i = 0; i < pendingTimers; i++) {
+
+		SchedulerBenchmarkTimer *timer = [[SchedulerBenchmarkTimer alloc] initWithInterval:furthestInterval];
+		ccTime interval = (i / kSchedulerBenchmarkTimersPerTick + 1) * kSchedulerBenchmarkTickInterval;
+
+		[scheduler scheduleSelector:@selector(fire:) forTarget:timer interval:interval paused:NO];
+		[timers addObject:timer];
+		[timer release];
+
+	}
+
+	[scheduler tick:kSchedulerBenchmarkTickInterval];
+	timersFired = 0;
+
+	CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kSchedulerBenchmarkTicks; i++) {
+		[scheduler tick:kSchedulerBenchmarkTickInterval];
+	}
+
+	result.pendingTimers = pendingTimers;
+	result.ticks = kSchedulerBenchmarkTicks;
+	result.timersFired = timersFired;
+	result.meanTickTime = (CFAbsoluteTimeGetCurrent() - startTime) / kSchedulerBenchmarkTicks;
+
+	for (SchedulerBenchmarkTimer *timer in timers) {
+		[scheduler unscheduleAllSelectorsForTarget:timer];
+	}
+
+	[timers release];
+
+	NSLog(@"Scheduler with %d pending timers: %.1f us per tick, %lu timers fired in %d ticks",
+		  result.pendingTimers, result.meanTickTime * 1000000.0, result.timersFired, result.ticks);
+
+	return result;
+
+}
+
+@end
@@ -0,0 +1,991 @@
+//
+//  Simulation.c
+//  AberFighter
+//
+//  Created by wde7 on 25/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Simulation.h"
+#include "TrigTable.h"
+
+/*
+ Screen edges used when choosing where a target spawns. These match the StartingEdges enumeration in TargetShip.h.
+ */
+#define kSimulationLeftEdge 0
+#define kSimulationUpperEdge 1
+#define kSimulationRightEdge 2
+#define kSimulationLowerEdge 3
+
+/*
+ Most targets of each type which can be active at once, which is the most the ReusableTargetPool holds.
+ */
+static const int kSimulationMaximumActiveTargets[kSimulationTargetTypeCount] = {
+	kGameMaximumActiveSmallTargets,
+	kGameMaximumActiveLargeTargets
+};
+
+void SimulationRandomSeed(SimulationRandom *random, uint32_t seed) {
+
+	/*
+	 xorshift never leaves the all zero state, so the seed is mixed with a constant. Mixing also spreads
+	 small consecutive seeds across the state.
+	 */
+	uint32_t state = seed ^ 0x9E3779B9u;
+	state = (state ^ (state >> 16)) * 0x85EBCA6Bu;
+	state = (state ^ (state >> 13)) * 0xC2B2AE35u;
+	state ^= state >> 16;
+
+	random->state = (state != 0) ? state : 0x6D2B79F5u;
+
+}
+
+uint32_t SimulationRandomNext(SimulationRandom *random) {
+
+	uint32_t state = random->state;
+
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+
+	random->state = state;
+	return state;
+
+}
+
+int SimulationDetermineTargetType(SimulationRandom *random, int smallAppearanceProbability, int largeAppearanceProbability) {
+
+	/*
+	 A random number between 0 and the total probability is generated. If it is less than the probability of a
+	 large target appearing then a large target is spawned, otherwise a small one.
+	 */
+	int totalProbability = largeAppearanceProbability + smallAppearanceProbability;
+	int randomTargetTypeSpawnFactor = (int)(SimulationRandomNext(random) % (uint32_t)totalProbability);
+
+	if (randomTargetTypeSpawnFactor < largeAppearanceProbability) {
+		return kSimulationTargetLarge;
+	}
+
+	return kSimulationTargetSmall;
+
+}
+
+void SimulationGenerateTargetSpawn(SimulationRandom *random, float worldWidth, float worldHeight, float targetSize,
+								   float *x, float *y, float *heading) {
+
+	/*
+	 The edge is chosen first, then the random element of the heading (0 to 90 degrees, which avoids targets
+	 travelling parallel to the edge) and finally the position along the edge. This order must not change
+	 because both peers of a network game draw the same sequence of numbers.
+	 */
+	int randomSpawnEdge = (int)(SimulationRandomNext(random) % 4);
+	float randomHeading = (float)(SimulationRandomNext(random) % 91);
+
+	float xStartingPosition = 0.0f;
+	float yStartingPosition = 0.0f;
+	float initialHeading = 0.0f;
+	int xPositionDetermined = 0;
+
+	switch (randomSpawnEdge) {
+		case kSimulationLeftEdge:
+			xStartingPosition = 0 - (targetSize / 2);
+			initialHeading = 45.0f + randomHeading;
+			xPositionDetermined = 1;
+			break;
+		case kSimulationUpperEdge:
+			yStartingPosition = worldHeight + (targetSize / 2);
+			initialHeading = 135.0f + randomHeading;
+			break;
+		case kSimulationRightEdge:
+			xStartingPosition = worldWidth + (targetSize / 2);
+			initialHeading = 360.0f - (45.0f + randomHeading);
+			xPositionDetermined = 1;
+			break;
+		default:
+			yStartingPosition = 0 - (targetSize / 2);
+			initialHeading = 45.0f - randomHeading;
+			break;
+	}
+
+	/*
+	 The position along the chosen edge is between 1/4 and 3/4 of the way across it.
+	 */
+	if (xPositionDetermined) {
+
+		uint32_t yAxisMiddle = (uint32_t)(worldHeight / 2);
+		yStartingPosition = (worldHeight / 4) + (float)(SimulationRandomNext(random) % yAxisMiddle);
+
+	} else {
+
+		uint32_t xAxisMiddle = (uint32_t)(worldWidth / 2);
+		xStartingPosition = (worldWidth / 4) + (float)(SimulationRandomNext(random) % xAxisMiddle);
+
+	}
+
+	/*
+	 Headings are kept between 0 and 360 degrees, as Ship's setCurrentHeading method does.
+	 */
+	if (initialHeading < 0.0f) {
+		initialHeading += 360.0f;
+	}
+
+	*x = xStartingPosition;
+	*y = yStartingPosition;
+	*heading = initialHeading;
+
+}
+
+float SimulationSpawnInterval(float maximumSpawnRate, float spawnRateModifier, float gameTimeRemainingRatio) {
+
+	return maximumSpawnRate + (gameTimeRemainingRatio * spawnRateModifier);
+
+}
+
+void SimulationConfigDefaults(SimulationConfig *config, int numberOfPlayers) {
+
+	SimulationConfigDefaultsWithWorldSize(config, numberOfPlayers, kGameScreenWidth, kGameScreenHeight);
+
+}
+
+void SimulationConfigDefaultsWithWorldSize(SimulationConfig *config, int numberOfPlayers, float worldWidth, float worldHeight) {
+
+	memset(config, 0, sizeof(SimulationConfig));
+
+	if (numberOfPlayers < 1) {
+		numberOfPlayers = 1;
+	} else if (numberOfPlayers > kSimulationMaximumPlayers) {
+		numberOfPlayers = kSimulationMaximumPlayers;
+	}
+
+	config->numberOfPlayers = numberOfPlayers;
+	config->gameLength = 120;
+
+	config->worldWidth = worldWidth;
+	config->worldHeight = worldHeight;
+	config->hudHeight = kGameHUDHeight;
+
+	//Sprites collide as circles as wide as their images. Network games are played at a lower speed.
+	config->playerRadius = kGamePlayerShipImageSize / 2.0f;
+	config->playerMaximumSpeed = (numberOfPlayers == 1) ? 100.0f : 50.0f;
+	config->playerMaximumShieldStrength = 5;
+	config->shipRepairTime = 3.0f;
+	config->shipInvincibleTime = 3.0f;
+
+	config->projectileRadius = kGameProjectileImageSize / 2.0f;
+	config->projectileLifetime = kGameProjectileLifetime;
+	config->projectileHitReward = 50;
+
+	config->targetRadius[kSimulationTargetSmall] = kGameSmallTargetImageSize / 2.0f;
+	config->targetSpeed[kSimulationTargetSmall] = 100.0f;
+	config->targetMaximumShieldStrength[kSimulationTargetSmall] = 1;
+	config->targetScoreAwarded[kSimulationTargetSmall] = 50;
+	config->targetAppearanceProbability[kSimulationTargetSmall] = 80;
+
+	config->targetRadius[kSimulationTargetLarge] = kGameLargeTargetImageSize / 2.0f;
+	config->targetSpeed[kSimulationTargetLarge] = 50.0f;
+	config->targetMaximumShieldStrength[kSimulationTargetLarge] = 5;
+	config->targetScoreAwarded[kSimulationTargetLarge] = 200;
+	config->targetAppearanceProbability[kSimulationTargetLarge] = 20;
+
+	config->targetMinimumLifetime = 2.0f;
+
+	config->maximumSpawnRate = 0.5f;
+	config->spawnRateModifier = 1.5f;
+
+}
+
+Simulation *SimulationNew(const SimulationConfig *config, uint32_t seed) {
+
+	Simulation *simulation = (Simulation *)calloc(1, sizeof(Simulation));
+
+	if (simulation == NULL) {
+		return NULL;
+	}
+
+	simulation->config = *config;
+	simulation->targets = EntityStoreNew(20);
+	simulation->projectiles = EntityStoreNew(32);
+
+	if (simulation->targets == NULL || simulation->projectiles == NULL) {
+		SimulationFree(simulation);
+		return NULL;
+	}
+
+	SimulationReset(simulation, seed);
+
+	return simulation;
+
+}
+
+void SimulationFree(Simulation *simulation) {
+
+	if (simulation == NULL) {
+		return;
+	}
+
+	EntityStoreFree(simulation->targets);
+	EntityStoreFree(simulation->projectiles);
+	free(simulation);
+
+}
+
+void SimulationReset(Simulation *simulation, uint32_t seed) {
+
+	const SimulationConfig *config = &simulation->config;
+
+	SimulationRandomSeed(&simulation->random, seed);
+
+	simulation->tick = 0;
+	simulation->gameTimeRemaining = config->gameLength;
+	simulation->gameTimeRemainingRatio = 1.0f;
+	simulation->previousSpawnTick = -1;
+
+	EntityStoreRemoveAll(simulation->targets);
+	EntityStoreRemoveAll(simulation->projectiles);
+
+	memset(simulation->players, 0, sizeof(simulation->players));
+
+	/*
+	 Players start where the SinglePlayerActionLayer and MultiplayerActionLayer place them. With more than two
+	 players the even players start on the left facing right and the odd players on the right facing left,
+	 spaced evenly up the playable height, so that two players start exactly as they do in the app.
+	 */
+	float playableHeight = config->worldHeight - config->hudHeight;
+	int rows = (config->numberOfPlayers + 1) / 2;
+
+	for (int i = 0; i < config->numberOfPlayers; i++) {
+
+		SimulationPlayer *player = &simulation->players[i];
+
+		player->playerID = i + 1;
+		player->maximumSpeed = config->playerMaximumSpeed;
+		player->shieldStrength = config->playerMaximumShieldStrength;
+
+		if (config->numberOfPlayers == 1) {
+
+			player->x = config->worldWidth / 2;
+			player->y = config->worldHeight / 4;
+			player->heading = 0.0f;
+
+		} else {
+
+			int row = i / 2;
+
+			player->x = ((i & 1) == 0) ? 50.0f : config->worldWidth - 50.0f;
+			player->y = (playableHeight * (row + 1)) / (rows + 1);
+			player->heading = ((i & 1) == 0) ? 90.0f : 270.0f;
+
+		}
+
+	}
+
+}
+
+/*
+ Converts a time in seconds into a number of ticks, rounding to the nearest tick.
+ */
+static int SimulationTicksForTime(float seconds) {
+
+	return (int)((seconds / kSimulationTimestep) + 0.5f);
+
+}
+
+/*
+ Equivalent of TargetShip's checkIfOffscreen method. The margin is half the diagonal of the target.
+ */
+static int SimulationTargetIsOffscreen(const Simulation *simulation, unsigned int index) {
+
+	const EntityStore *targets = simulation->targets;
+	float margin = (targets->radius[index] * 2.0f * 1.41421356f) / 2;
+	float x = targets->positionX[index];
+	float y = targets->positionY[index];
+
+	return (x < (0 - margin) || x > (simulation->config.worldWidth + margin) ||
+			y < (0 - margin) || y > (simulation->config.worldHeight + margin));
+
+}
+
+/*
+ Equivalent of PlayerShip's reduceShieldStrength method. Invincible players take no damage. A player
+ whose shields reach 0 is disabled and stopped.
+ */
+static void SimulationDamagePlayer(Simulation *simulation, SimulationPlayer *player) {
+
+	if (player->invincibleTicks > 0) {
+		return;
+	}
+
+	player->shieldStrength--;
+
+	if (player->shieldStrength <= 0) {
+
+		player->speed = 0.0f;
+		player->disabledTicks = SimulationTicksForTime(simulation->config.shipRepairTime);
+		player->invincibleTicks = player->disabledTicks + SimulationTicksForTime(simulation->config.shipInvincibleTime);
+
+	}
+
+}
+
+static void SimulationRewardPlayer(Simulation *simulation, int playerID, int points) {
+
+	if (playerID >= 1 && playerID <= simulation->config.numberOfPlayers) {
+		simulation->players[playerID - 1].score += points;
+	}
+
+}
+
+/*
+ Applies the player's input and moves them, keeping them inside the playing area as PlayerShip's
+ calculateNewPositionWithHeading:distance: method does. Fires a projectile from the front of the ship
+ if requested.
+ */
+static void SimulationUpdatePlayer(Simulation *simulation, SimulationPlayer *player, const SimulationInput *input) {
+
+	const SimulationConfig *config = &simulation->config;
+
+	if (player->disabledTicks > 0) {
+		return;
+	}
+
+	if (input != NULL) {
+
+		float speed = input->speed;
+		float heading = input->heading;
+
+		if (speed < 0.0f) {
+			speed = 0.0f;
+		} else if (speed > player->maximumSpeed) {
+			speed = player->maximumSpeed;
+		}
+
+		if (heading < 0.0f) {
+			heading += 360.0f;
+		} else if (heading >= 360.0f) {
+			heading -= 360.0f;
+		}
+
+		player->speed = speed;
+		player->heading = heading;
+
+	}
+
+	float directionX = TrigTableSine(player->heading);
+	float directionY = TrigTableCosine(player->heading);
+	float distance = player->speed * kSimulationTimestep;
+
+	player->x += directionX * distance;
+	player->y += directionY * distance;
+
+	float radius = config->playerRadius;
+	float upperBoundary = config->worldHeight - config->hudHeight;
+
+	if (player->x > config->worldWidth - radius) {
+		player->x = config->worldWidth - radius;
+	} else if (player->x < radius) {
+		player->x = radius;
+	}
+
+	if (player->y > upperBoundary - radius) {
+		player->y = upperBoundary - radius;
+	} else if (player->y < radius) {
+		player->y = radius;
+	}
+
+	/*
+	 Projectiles travel the diagonal of the screen during their lifetime. Their shield is used to mark
+	 whether they have hit something, as Projectile's hasCollided property does.
+	 */
+	if (input != NULL && input->fire) {
+
+		float diagonal = sqrtf((config->worldWidth * config->worldWidth) + (config->worldHeight * config->worldHeight));
+
+		EntityStoreAdd(simulation->projectiles,
+					   player->x + (directionX * radius),
+					   player->y + (directionY * radius),
+					   player->heading,
+					   diagonal / config->projectileLifetime,
+					   config->projectileRadius,
+					   1,
+					   player->playerID,
+					   0,
+					   NULL);
+
+	}
+
+}
+
+/*
+ Reduces the shield of a target. Returns non-zero if the target has been destroyed.
+ */
+static int SimulationDamageTarget(Simulation *simulation, unsigned int index) {
+
+	simulation->targets->shield[index]--;
+
+	return simulation->targets->shield[index] <= 0;
+
+}
+
+/*
+ Equivalent of the collision detection in ActionLayer's nextFrame method, performed in the same order.
+ */
+static void SimulationDetectCollisions(Simulation *simulation) {
+
+	const SimulationConfig *config = &simulation->config;
+	EntityStore *targets = simulation->targets;
+	EntityStore *projectiles = simulation->projectiles;
+
+	/*
+	 Players are compared with projectiles fired by other players.
+	 */
+	for (int p = 0; p < config->numberOfPlayers; p++) {
+
+		SimulationPlayer *player = &simulation->players[p];
+
+		if (player->disabledTicks > 0) {
+			continue;
+		}
+
+		for (unsigned int i = 0; i < projectiles->count; i++) {
+
+			if (projectiles->shield[i] == 0 || projectiles->owner[i] == player->playerID) {
+				continue;
+			}
+
+			float xDistance = projectiles->positionX[i] - player->x;
+			float yDistance = projectiles->positionY[i] - player->y;
+			float minimumIntersectionDistance = projectiles->radius[i] + config->playerRadius;
+
+			if ((xDistance * xDistance) + (yDistance * yDistance) < (minimumIntersectionDistance * minimumIntersectionDistance)) {
+
+				projectiles->shield[i] = 0;
+				SimulationDamagePlayer(simulation, player);
+				SimulationRewardPlayer(simulation, projectiles->owner[i], config->projectileHitReward);
+
+			}
+
+		}
+
+	}
+
+	/*
+	 Targets which are onscreen are compared with projectiles, then with players. Destroyed targets are
+	 marked with a shield of 0 and removed afterwards.
+	 */
+	for (unsigned int t = 0; t < targets->count; t++) {
+
+		if (SimulationTargetIsOffscreen(simulation, t)) {
+			continue;
+		}
+
+		int targetDestroyed = 0;
+		int type = targets->type[t];
+
+		for (unsigned int i = 0; i < projectiles->count && !targetDestroyed; i++) {
+
+			if (projectiles->shield[i] == 0) {
+				continue;
+			}
+
+			float xDistance = projectiles->positionX[i] - targets->positionX[t];
+			float yDistance = projectiles->positionY[i] - targets->positionY[t];
+			float minimumIntersectionDistance = projectiles->radius[i] + targets->radius[t];
+
+			if ((xDistance * xDistance) + (yDistance * yDistance) < (minimumIntersectionDistance * minimumIntersectionDistance)) {
+
+				projectiles->shield[i] = 0;
+				targetDestroyed = SimulationDamageTarget(simulation, t);
+
+				if (targetDestroyed) {
+					SimulationRewardPlayer(simulation, projectiles->owner[i], config->targetScoreAwarded[type]);
+				}
+
+			}
+
+		}
+
+		for (int p = 0; p < config->numberOfPlayers && !targetDestroyed; p++) {
+
+			SimulationPlayer *player = &simulation->players[p];
+
+			if (player->disabledTicks > 0) {
+				continue;
+			}
+
+			float xDistance = player->x - targets->positionX[t];
+			float yDistance = player->y - targets->positionY[t];
+			float minimumIntersectionDistance = config->playerRadius + targets->radius[t];
+
+			if ((xDistance * xDistance) + (yDistance * yDistance) < (minimumIntersectionDistance * minimumIntersectionDistance)) {
+
+				SimulationDamagePlayer(simulation, player);
+				targetDestroyed = SimulationDamageTarget(simulation, t);
+
+				if (targetDestroyed) {
+					SimulationRewardPlayer(simulation, player->playerID, config->targetScoreAwarded[type]);
+				}
+
+			}
+
+		}
+
+	}
+
+	/*
+	 Remove the projectiles which hit something and the targets which were destroyed. The stores are walked
+	 backwards so that swap removal never moves an entity which hasn't been checked yet.
+	 */
+	for (unsigned int i = projectiles->count; i > 0; i--) {
+
+		if (projectiles->shield[i - 1] == 0) {
+			EntityStoreRemove(projectiles, i - 1);
+		}
+
+	}
+
+	for (unsigned int i = targets->count; i > 0; i--) {
+
+		if (targets->shield[i - 1] <= 0) {
+			EntityStoreRemove(targets, i - 1);
+		}
+
+	}
+
+}
+
+/*
+ Counts down the repair and invincibility of disabled players. Shields are recharged when a player is
+ re-enabled, as PlayerShip's reactivateShip: method does.
+ */
+static void SimulationUpdatePlayerTimers(Simulation *simulation) {
+
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		SimulationPlayer *player = &simulation->players[p];
+
+		if (player->disabledTicks > 0) {
+
+			player->disabledTicks--;
+
+			if (player->disabledTicks == 0) {
+				player->shieldStrength = simulation->config.playerMaximumShieldStrength;
+			}
+
+		}
+
+		if (player->invincibleTicks > 0) {
+			player->invincibleTicks--;
+		}
+
+	}
+
+}
+
+/*
+ Equivalent of ActionLayer's gameLogic: method. Spawns a target when the spawn interval has passed and
+ clears up targets which have left the screen.
+ */
+static void SimulationGameLogic(Simulation *simulation) {
+
+	const SimulationConfig *config = &simulation->config;
+	EntityStore *targets = simulation->targets;
+
+	float spawnInterval = SimulationSpawnInterval(config->maximumSpawnRate, config->spawnRateModifier,
+												  simulation->gameTimeRemainingRatio);
+	int64_t ticksSinceSpawn = (int64_t)simulation->tick - simulation->previousSpawnTick;
+
+	if (simulation->previousSpawnTick < 0 || ((float)ticksSinceSpawn * kSimulationTimestep) >= spawnInterval) {
+
+		int type = SimulationDetermineTargetType(&simulation->random,
+												 config->targetAppearanceProbability[kSimulationTargetSmall],
+												 config->targetAppearanceProbability[kSimulationTargetLarge]);
+
+		/*
+		 No target is spawned if the most targets of the type which can be active at once already are. The
+		 ReusableTargetPool never holds more targets of a type than this.
+		 */
+		int activeOfType = 0;
+
+		for (unsigned int i = 0; i < targets->count; i++) {
+
+			if (targets->type[i] == type) {
+				activeOfType++;
+			}
+
+		}
+
+		if (activeOfType < kSimulationMaximumActiveTargets[type]) {
+
+			float radius = config->targetRadius[type];
+			float x, y, heading;
+
+			SimulationGenerateTargetSpawn(&simulation->random, config->worldWidth, config->worldHeight,
+										  radius * 2.0f * 1.41421356f, &x, &y, &heading);
+
+			EntityStoreAdd(targets, x, y, heading, config->targetSpeed[type], radius,
+						   config->targetMaximumShieldStrength[type], 0, type, NULL);
+
+		}
+
+		simulation->previousSpawnTick = (int64_t)simulation->tick;
+
+	}
+
+	for (unsigned int i = targets->count; i > 0; i--) {
+
+		if (targets->age[i - 1] >= config->targetMinimumLifetime && SimulationTargetIsOffscreen(simulation, i - 1)) {
+			EntityStoreRemove(targets, i - 1);
+		}
+
+	}
+
+}
+
+/*
+ Equivalent of ActionLayer's timer: method.
+ */
+static void SimulationTimer(Simulation *simulation) {
+
+	simulation->gameTimeRemaining--;
+
+	if (simulation->gameTimeRemaining > 0) {
+		simulation->gameTimeRemainingRatio = (float)simulation->gameTimeRemaining / (float)simulation->config.gameLength;
+	}
+
+}
+
+void SimulationStep(Simulation *simulation, const SimulationInput *inputs) {
+
+	if (SimulationIsGameOver(simulation)) {
+		return;
+	}
+
+	EntityStore *projectiles = simulation->projectiles;
+
+	/*
+	 Move targets and projectiles. Projectiles are removed once they have travelled across the screen.
+	 */
+	EntityStoreIntegrate(simulation->targets, kSimulationTimestep);
+	EntityStoreIntegrate(projectiles, kSimulationTimestep);
+
+	for (unsigned int i = projectiles->count; i > 0; i--) {
+
+		if (projectiles->age[i - 1] >= simulation->config.projectileLifetime) {
+			EntityStoreRemove(projectiles, i - 1);
+		}
+
+	}
+
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		SimulationUpdatePlayer(simulation, &simulation->players[p], (inputs != NULL) ? &inputs[p] : NULL);
+
+	}
+
+	SimulationDetectCollisions(simulation);
+	SimulationUpdatePlayerTimers(simulation);
+
+	simulation->tick++;
+
+	if ((simulation->tick % kSimulationGameLogicInterval) == 0) {
+		SimulationGameLogic(simulation);
+	}
+
+	if ((simulation->tick % kSimulationTimerInterval) == 0) {
+		SimulationTimer(simulation);
+	}
+
+}
+
+int SimulationIsGameOver(const Simulation *simulation) {
+
+	return simulation->gameTimeRemaining <= 0;
+
+}
+
+uint32_t SimulationRunGame(Simulation *simulation, SimulationInputProvider inputProvider, void *context) {
+
+	SimulationInput inputs[kSimulationMaximumPlayers];
+	uint32_t ticks = 0;
+
+	while (!SimulationIsGameOver(simulation)) {
+
+		if (inputProvider != NULL) {
+
+			memset(inputs, 0, sizeof(inputs));
+			inputProvider(simulation, inputs, context);
+			SimulationStep(simulation, inputs);
+
+		} else {
+
+			SimulationStep(simulation, NULL);
+
+		}
+
+		ticks++;
+
+	}
+
+	return ticks;
+
+}
+
+/*
+ Sizes of the parts of a saved state. Each entity is saved as it's position, heading, speed, radius and age
+ followed by it's shield, owner and type. The direction is worked out again from the heading when the state
+ is loaded, and views are never saved. Players are saved without the values which are fixed by the reset.
+ */
+#define kSimulationSavedHeaderSize ((2 * sizeof(unsigned int)) + (2 * sizeof(uint32_t)) + sizeof(int) + sizeof(float) + sizeof(int64_t))
+#define kSimulationSavedPlayerSize ((4 * sizeof(float)) + (4 * sizeof(int)))
+#define kSimulationSavedEntitySize ((6 * sizeof(float)) + (3 * sizeof(int)))
+
+size_t SimulationStateSize(const Simulation *simulation) {
+
+	size_t entityCount = (size_t)simulation->targets->count + simulation->projectiles->count;
+
+	return kSimulationSavedHeaderSize +
+		   ((size_t)simulation->config.numberOfPlayers * kSimulationSavedPlayerSize) +
+		   (entityCount * kSimulationSavedEntitySize);
+
+}
+
+static uint8_t *SimulationSaveBytes(uint8_t *cursor, const void *bytes, size_t length) {
+
+	memcpy(cursor, bytes, length);
+
+	return cursor + length;
+
+}
+
+static const uint8_t *SimulationLoadBytes(const uint8_t *cursor, void *bytes, size_t length) {
+
+	memcpy(bytes, cursor, length);
+
+	return cursor + length;
+
+}
+
+/*
+ Each array of a store is saved in one piece, in the same order as the fields are listed in EntityStore.h.
+ */
+static uint8_t *SimulationSaveEntityStore(uint8_t *cursor, const EntityStore *store) {
+
+	unsigned int count = store->count;
+
+	cursor = SimulationSaveBytes(cursor, store->positionX, sizeof(float) * count);
+	cursor = SimulationSaveBytes(cursor, store->positionY, sizeof(float) * count);
+	cursor = SimulationSaveBytes(cursor, store->heading, sizeof(float) * count);
+	cursor = SimulationSaveBytes(cursor, store->speed, sizeof(float) * count);
+	cursor = SimulationSaveBytes(cursor, store->radius, sizeof(float) * count);
+	cursor = SimulationSaveBytes(cursor, store->age, sizeof(float) * count);
+	cursor = SimulationSaveBytes(cursor, store->shield, sizeof(int) * count);
+	cursor = SimulationSaveBytes(cursor, store->owner, sizeof(int) * count);
+	cursor = SimulationSaveBytes(cursor, store->type, sizeof(int) * count);
+
+	return cursor;
+
+}
+
+/*
+ The store must already have room for count entities.
+ */
+static const uint8_t *SimulationLoadEntityStore(const uint8_t *cursor, EntityStore *store, unsigned int count) {
+
+	store->count = count;
+
+	cursor = SimulationLoadBytes(cursor, store->positionX, sizeof(float) * count);
+	cursor = SimulationLoadBytes(cursor, store->positionY, sizeof(float) * count);
+	cursor = SimulationLoadBytes(cursor, store->heading, sizeof(float) * count);
+	cursor = SimulationLoadBytes(cursor, store->speed, sizeof(float) * count);
+	cursor = SimulationLoadBytes(cursor, store->radius, sizeof(float) * count);
+	cursor = SimulationLoadBytes(cursor, store->age, sizeof(float) * count);
+	cursor = SimulationLoadBytes(cursor, store->shield, sizeof(int) * count);
+	cursor = SimulationLoadBytes(cursor, store->owner, sizeof(int) * count);
+	cursor = SimulationLoadBytes(cursor, store->type, sizeof(int) * count);
+
+	for (unsigned int i = 0; i < count; i++) {
+
+		EntityStoreSetHeading(store, i, store->heading[i]);
+		store->views[i] = NULL;
+
+	}
+
+	return cursor;
+
+}
+
+size_t SimulationSaveState(const Simulation *simulation, void *buffer, size_t capacity) {
+
+	size_t size = SimulationStateSize(simulation);
+
+	if (size > capacity) {
+		return 0;
+	}
+
+	uint8_t *cursor = (uint8_t *)buffer;
+
+	/*
+	 The entity counts come first so that the length of the state can be checked before anything is loaded.
+	 */
+	cursor = SimulationSaveBytes(cursor, &simulation->targets->count, sizeof(unsigned int));
+	cursor = SimulationSaveBytes(cursor, &simulation->projectiles->count, sizeof(unsigned int));
+	cursor = SimulationSaveBytes(cursor, &simulation->random.state, sizeof(uint32_t));
+	cursor = SimulationSaveBytes(cursor, &simulation->tick, sizeof(uint32_t));
+	cursor = SimulationSaveBytes(cursor, &simulation->gameTimeRemaining, sizeof(int));
+	cursor = SimulationSaveBytes(cursor, &simulation->gameTimeRemainingRatio, sizeof(float));
+	cursor = SimulationSaveBytes(cursor, &simulation->previousSpawnTick, sizeof(int64_t));
+
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		const SimulationPlayer *player = &simulation->players[p];
+
+		cursor = SimulationSaveBytes(cursor, &player->x, sizeof(float));
+		cursor = SimulationSaveBytes(cursor, &player->y, sizeof(float));
+		cursor = SimulationSaveBytes(cursor, &player->heading, sizeof(float));
+		cursor = SimulationSaveBytes(cursor, &player->speed, sizeof(float));
+		cursor = SimulationSaveBytes(cursor, &player->shieldStrength, sizeof(int));
+		cursor = SimulationSaveBytes(cursor, &player->disabledTicks, sizeof(int));
+		cursor = SimulationSaveBytes(cursor, &player->invincibleTicks, sizeof(int));
+		cursor = SimulationSaveBytes(cursor, &player->score, sizeof(int));
+
+	}
+
+	cursor = SimulationSaveEntityStore(cursor, simulation->targets);
+	cursor = SimulationSaveEntityStore(cursor, simulation->projectiles);
+
+	return size;
+
+}
+
+int SimulationLoadState(Simulation *simulation, const void *buffer, size_t length) {
+
+	const uint8_t *cursor = (const uint8_t *)buffer;
+	unsigned int targetCount, projectileCount;
+
+	if (length < kSimulationSavedHeaderSize) {
+		return 0;
+	}
+
+	cursor = SimulationLoadBytes(cursor, &targetCount, sizeof(unsigned int));
+	cursor = SimulationLoadBytes(cursor, &projectileCount, sizeof(unsigned int));
+
+	/*
+	 The counts are checked against the length before they are multiplied so that a corrupt state can't
+	 overflow the calculation of it's size.
+	 */
+	if (targetCount > length / kSimulationSavedEntitySize || projectileCount > length / kSimulationSavedEntitySize) {
+		return 0;
+	}
+
+	size_t size = kSimulationSavedHeaderSize +
+				  ((size_t)simulation->config.numberOfPlayers * kSimulationSavedPlayerSize) +
+				  (((size_t)targetCount + projectileCount) * kSimulationSavedEntitySize);
+
+	if (size != length ||
+		!EntityStoreReserve(simulation->targets, targetCount) ||
+		!EntityStoreReserve(simulation->projectiles, projectileCount)) {
+		return 0;
+	}
+
+	cursor = SimulationLoadBytes(cursor, &simulation->random.state, sizeof(uint32_t));
+	cursor = SimulationLoadBytes(cursor, &simulation->tick, sizeof(uint32_t));
+	cursor = SimulationLoadBytes(cursor, &simulation->gameTimeRemaining, sizeof(int));
+	cursor = SimulationLoadBytes(cursor, &simulation->gameTimeRemainingRatio, sizeof(float));
+	cursor = SimulationLoadBytes(cursor, &simulation->previousSpawnTick, sizeof(int64_t));
+
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		SimulationPlayer *player = &simulation->players[p];
+
+		cursor = SimulationLoadBytes(cursor, &player->x, sizeof(float));
+		cursor = SimulationLoadBytes(cursor, &player->y, sizeof(float));
+		cursor = SimulationLoadBytes(cursor, &player->heading, sizeof(float));
+		cursor = SimulationLoadBytes(cursor, &player->speed, sizeof(float));
+		cursor = SimulationLoadBytes(cursor, &player->shieldStrength, sizeof(int));
+		cursor = SimulationLoadBytes(cursor, &player->disabledTicks, sizeof(int));
+		cursor = SimulationLoadBytes(cursor, &player->invincibleTicks, sizeof(int));
+		cursor = SimulationLoadBytes(cursor, &player->score, sizeof(int));
+
+	}
+
+	cursor = SimulationLoadEntityStore(cursor, simulation->targets, targetCount);
+	cursor = SimulationLoadEntityStore(cursor, simulation->projectiles, projectileCount);
+
+	return 1;
+
+}
+
+#define kSimulationFNVPrime 16777619u
+
+uint32_t SimulationHash(uint32_t hash, const void *bytes, size_t length) {
+
+	const unsigned char *data = (const unsigned char *)bytes;
+
+	for (size_t i = 0; i < length; i++) {
+
+		hash ^= data[i];
+		hash *= kSimulationFNVPrime;
+
+	}
+
+	return hash;
+
+}
+
+/*
+ Hashes the parts of a store which describe the game state. The views are pointers, so are left out.
+ */
+static uint32_t SimulationHashEntityStore(uint32_t hash, const EntityStore *store) {
+
+	unsigned int count = store->count;
+
+	hash = SimulationHash(hash, &count, sizeof(count));
+	hash = SimulationHash(hash, store->positionX, sizeof(float) * count);
+	hash = SimulationHash(hash, store->positionY, sizeof(float) * count);
+	hash = SimulationHash(hash, store->heading, sizeof(float) * count);
+	hash = SimulationHash(hash, store->speed, sizeof(float) * count);
+	hash = SimulationHash(hash, store->shield, sizeof(int) * count);
+	hash = SimulationHash(hash, store->owner, sizeof(int) * count);
+	hash = SimulationHash(hash, store->type, sizeof(int) * count);
+	hash = SimulationHash(hash, store->age, sizeof(float) * count);
+
+	return hash;
+
+}
+
+uint32_t SimulationChecksum(const Simulation *simulation) {
+
+	uint32_t hash = kSimulationHashOffsetBasis;
+
+	hash = SimulationHash(hash, &simulation->random.state, sizeof(simulation->random.state));
+	hash = SimulationHash(hash, &simulation->tick, sizeof(simulation->tick));
+	hash = SimulationHash(hash, &simulation->gameTimeRemaining, sizeof(simulation->gameTimeRemaining));
+	hash = SimulationHash(hash, &simulation->previousSpawnTick, sizeof(simulation->previousSpawnTick));
+
+	/*
+	 The players are hashed field by field so that padding bytes are never included.
+	 */
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		const SimulationPlayer *player = &simulation->players[p];
+
+		hash = SimulationHash(hash, &player->x, sizeof(player->x));
+		hash = SimulationHash(hash, &player->y, sizeof(player->y));
+		hash = SimulationHash(hash, &player->heading, sizeof(player->heading));
+		hash = SimulationHash(hash, &player->speed, sizeof(player->speed));
+		hash = SimulationHash(hash, &player->shieldStrength, sizeof(player->shieldStrength));
+		hash = SimulationHash(hash, &player->disabledTicks, sizeof(player->disabledTicks));
+		hash = SimulationHash(hash, &player->invincibleTicks, sizeof(player->invincibleTicks));
+		hash = SimulationHash(hash, &player->score, sizeof(player->score));
+
+	}
+
+	hash = SimulationHashEntityStore(hash, simulation->targets);
+	hash = SimulationHashEntityStore(hash, simulation->projectiles);
+
+	return hash;
+
+}
@@ -0,0 +1,284 @@
+//
+//  Simulation.h
+//  AberFighter
+//
+//  Created by wde7 on 25/05/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The Simulation is a headless version of the game rules implemented by the ActionLayer. It moves the
+ players, targets and projectiles, performs collision detection, spawns targets, awards points and counts
+ down the game time, but it has no sprites, no scheduler and no dependency on UIKit, cocos2d or OpenGL.
+
+ The simulation advances in fixed timesteps of kSimulationTimestep seconds. Every random decision is taken
+ from a SimulationRandom generator which is seeded when the simulation is reset, and the periodic game logic
+ and timer run on tick counts rather than wall clock time. Given the same seed and the same sequence of
+ inputs the simulation therefore produces exactly the same result every time it is run, which makes it
+ suitable for balance testing, regression testing and measuring the CPU cost of the game rules.
+
+ The rules which decide the type, position and heading of spawned targets are exposed as separate functions
+ so that the ActionLayer uses exactly the same code as the simulation.
+ */
+
+#ifndef __SIMULATION_H__
+#define __SIMULATION_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "EntityStore.h"
+#include "GameConstants.h"
+
+/*
+ Length of each simulation step in seconds. This is the framerate of the game.
+ */
+#define kSimulationTimestep (1.0f / 60.0f)
+
+/*
+ The game logic (spawning and clearing up targets) runs every 6 ticks (10 times a second) and the game
+ timer every 60 ticks (once a second), as they do in the ActionLayer.
+ */
+#define kSimulationGameLogicInterval 6
+#define kSimulationTimerInterval 60
+
+/*
+ Maximum number of players which can take part in a simulated game. This is the most a network session can
+ elect, kPlayerElectionMaximumPlayers, although the app itself only plays games of one or two.
+ */
+#define kSimulationMaximumPlayers kGameMaximumPlayers
+
+/*
+ Target types. These have the same values as the TargetType enumeration in TargetShip.h.
+ */
+#define kSimulationTargetSmall 0
+#define kSimulationTargetLarge 1
+#define kSimulationTargetTypeCount 2
+
+/*
+ Small, fast pseudo random number generator (xorshift). Unlike arc4random it can be seeded, so two
+ generators seeded with the same value produce the same sequence on every device.
+ */
+typedef struct SimulationRandom {
+
+	uint32_t state;
+
+} SimulationRandom;
+
+/*
+ Seeds the generator. Any value, including 0, is a valid seed.
+ */
+void SimulationRandomSeed(SimulationRandom *random, uint32_t seed);
+
+/*
+ Returns the next 32 bit number in the sequence.
+ */
+uint32_t SimulationRandomNext(SimulationRandom *random);
+
+/*
+ Returns a random target type. The chance of each type appearing is proportional to it's probability.
+ This is the rule used by ActionLayer's determineSpawnedTargetType method.
+ */
+int SimulationDetermineTargetType(SimulationRandom *random, int smallAppearanceProbability, int largeAppearanceProbability);
+
+/*
+ Chooses a random point just offscreen of one of the four screen edges and a heading which takes a target
+ of the specified size onto the screen. targetSize is the length of the diagonal of the target's image.
+ This is the rule used by TargetShip's generateStartingPositionAndHeadingWithRandom: method.
+ */
+void SimulationGenerateTargetSpawn(SimulationRandom *random, float worldWidth, float worldHeight, float targetSize,
+								   float *x, float *y, float *heading);
+
+/*
+ Returns the number of seconds between spawns. Targets spawn more often as the game time remaining
+ decreases. gameTimeRemainingRatio is the game time remaining divided by the game length.
+ */
+float SimulationSpawnInterval(float maximumSpawnRate, float spawnRateModifier, float gameTimeRemainingRatio);
+
+/*
+ The constants which describe a game. SimulationConfigDefaults fills this in with the values used
+ by the app. The screen and the sprite sizes come from GameConstants.h, which the sprites are checked
+ against when they are created.
+ */
+typedef struct SimulationConfig {
+
+	int numberOfPlayers;
+	//Length of the game in seconds.
+	int gameLength;
+
+	//Size of the playing area. The HUD covers hudHeight points at the top.
+	float worldWidth;
+	float worldHeight;
+	float hudHeight;
+
+	float playerRadius;
+	float playerMaximumSpeed;
+	int playerMaximumShieldStrength;
+	//Seconds a player stays disabled, then stays invincible after being re-enabled.
+	float shipRepairTime;
+	float shipInvincibleTime;
+
+	float projectileRadius;
+	//Seconds taken by a projectile to travel the diagonal of the screen.
+	float projectileLifetime;
+	//Points awarded for hitting another player with a projectile.
+	int projectileHitReward;
+
+	float targetRadius[kSimulationTargetTypeCount];
+	float targetSpeed[kSimulationTargetTypeCount];
+	int targetMaximumShieldStrength[kSimulationTargetTypeCount];
+	int targetScoreAwarded[kSimulationTargetTypeCount];
+	int targetAppearanceProbability[kSimulationTargetTypeCount];
+	//Seconds before a target can be cleared up when it is offscreen.
+	float targetMinimumLifetime;
+
+	float maximumSpawnRate;
+	float spawnRateModifier;
+
+} SimulationConfig;
+
+/*
+ The input applied to a player for one tick. heading and speed are the values produced by the
+ DirectionalChangesCalculator. fire is non-zero if the fire button was pressed during the tick.
+ */
+typedef struct SimulationInput {
+
+	float heading;
+	float speed;
+	int fire;
+
+} SimulationInput;
+
+/*
+ State of one player's ship. Timers are counted in ticks.
+ */
+typedef struct SimulationPlayer {
+
+	int playerID;
+	float x;
+	float y;
+	float heading;
+	float speed;
+	float maximumSpeed;
+	int shieldStrength;
+	int disabledTicks;
+	int invincibleTicks;
+	int score;
+
+} SimulationPlayer;
+
+/*
+ The complete state of a simulated game.
+ */
+typedef struct Simulation {
+
+	SimulationConfig config;
+	SimulationRandom random;
+
+	//Number of steps taken since the simulation was reset.
+	uint32_t tick;
+	//Seconds remaining in the game. The game is over when this reaches 0.
+	int gameTimeRemaining;
+	//gameTimeRemaining divided by the game length, used to increase the spawn rate as the game progresses.
+	float gameTimeRemainingRatio;
+	//Tick of the previous spawn, or -1 if nothing has spawned yet.
+	int64_t previousSpawnTick;
+
+	SimulationPlayer players[kSimulationMaximumPlayers];
+
+	/*
+	 The targets and projectiles. Targets store their type in the type array. Projectiles store the ID of
+	 the player which fired them as their owner.
+	 */
+	EntityStore *targets;
+	EntityStore *projectiles;
+
+} Simulation;
+
+/*
+ Called once per tick by SimulationRunGame to get the input for every player. inputs has room for
+ config.numberOfPlayers entries and is cleared before each call.
+ */
+typedef void (*SimulationInputProvider)(const Simulation *simulation, SimulationInput *inputs, void *context);
+
+/*
+ Fills in the configuration used by the app for the number of players specified, from 1 to
+ kSimulationMaximumPlayers, on the app's screen of kGameScreenWidth by kGameScreenHeight points.
+ */
+void SimulationConfigDefaults(SimulationConfig *config, int numberOfPlayers);
+
+/*
+ Fills in the configuration used by the app for the number of players specified, but with a world of the size
+ specified in points. Everything which depends on the size of the world, such as the starting positions,
+ the spawn points and the distance projectiles travel, follows it.
+ */
+void SimulationConfigDefaultsWithWorldSize(SimulationConfig *config, int numberOfPlayers, float worldWidth, float worldHeight);
+
+/*
+ Creates a simulation with the configuration specified and resets it with the seed. Returns NULL if
+ the memory could not be allocated.
+ */
+Simulation *SimulationNew(const SimulationConfig *config, uint32_t seed);
+
+/*
+ Frees the simulation.
+ */
+void SimulationFree(Simulation *simulation);
+
+/*
+ Returns the simulation to the start of a game. The memory is reused, so a simulation can be used to
+ run many games without allocating.
+ */
+void SimulationReset(Simulation *simulation, uint32_t seed);
+
+/*
+ Advances the simulation by one tick using the inputs specified, one for each player. inputs may be
+ NULL, in which case the players keep their current heading and speed and don't fire.
+ */
+void SimulationStep(Simulation *simulation, const SimulationInput *inputs);
+
+/*
+ Returns non-zero once the game time has run out.
+ */
+int SimulationIsGameOver(const Simulation *simulation);
+
+/*
+ Steps the simulation until the game is over, asking the input provider for the input of each tick.
+ inputProvider may be NULL. Returns the number of ticks simulated.
+ */
+uint32_t SimulationRunGame(Simulation *simulation, SimulationInputProvider inputProvider, void *context);
+
+/*
+ The state of a simulation can be saved into a buffer and loaded back later to rewind it to an earlier tick.
+ Only what changes during a game is saved: the random generator, the clocks, the players, the targets and
+ the projectiles. The configuration isn't, so a state must be loaded into a simulation with the same
+ configuration as the one it was saved from. Values are copied in the byte order of the device.
+
+ Returns the number of bytes needed to save the current state.
+ */
+size_t SimulationStateSize(const Simulation *simulation);
+
+/*
+ Saves the current state into the buffer. Returns the number of bytes written, or 0 if the buffer is too small.
+ */
+size_t SimulationSaveState(const Simulation *simulation, void *buffer, size_t capacity);
+
+/*
+ Replaces the state of the simulation with one saved by SimulationSaveState. Returns 0 and leaves the
+ simulation unchanged if length isn't the size of the saved state or the entity stores could not be grown.
+ */
+int SimulationLoadState(Simulation *simulation, const void *buffer, size_t length);
+
+/*
+ Returns a checksum (FNV-1a) of the entire simulation state. Two simulations with the same checksum are,
+ for all practical purposes, in the same state. Used to check that replays and peers haven't diverged.
+ */
+uint32_t SimulationChecksum(const Simulation *simulation);
+
+/*
+ Adds bytes to a 32 bit FNV-1a hash, which starts with the value kSimulationHashOffsetBasis. This is the hash
+ SimulationChecksum is built from, and can be used to checksum state kept outside a Simulation.
+ */
+#define kSimulationHashOffsetBasis 2166136261u
+
+uint32_t SimulationHash(uint32_t hash, const void *bytes, size_t length);
+
+#endif // __SIMULATION_H__
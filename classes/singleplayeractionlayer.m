@@ -74,7 +74,7 @@
 - (void)draw {
 
 	UserInterfaceLayer* uiLayer = [MultilayerGameScene sharedScene].userInterfaceLayer;
-	[uiLayer updateLocalScoreLabel:[GameState sharedState].player1Score];
+	[uiLayer updateLocalScoreLabel:[[GameState sharedState] scoreForPlayer:1]];
 	
 	[super draw];
 	
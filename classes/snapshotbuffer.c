@@ -0,0 +1,296 @@
+//
+//  SnapshotBuffer.c
+//  AberFighter
+//
+//  Created by wde7 on 06/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <math.h>
+#include "SnapshotBuffer.h"
+
+#define kSnapshotBufferDegreesToRadians(degrees) ((degrees) * 0.01745329252f)
+
+/*
+ The time being drawn runs up to 10% faster or slower than the local clock while it catches up with a change
+ to the interpolation delay or clock offset. A change of more than a quarter of a second is applied at once.
+ */
+#define kSnapshotBufferRenderDelayRate 0.1
+#define kSnapshotBufferMaximumRenderDelayEase 0.25
+
+/*
+ Seconds per second the clock offset creeps up by when no snapshot arrives quicker.
+ */
+#define kSnapshotBufferClockOffsetRise 0.01
+
+void SnapshotBufferInit(SnapshotBuffer *buffer, double interpolationDelay, double maximumExtrapolation, double correctionTime) {
+
+	buffer->interpolationDelay = interpolationDelay;
+	buffer->maximumExtrapolation = maximumExtrapolation;
+	buffer->correctionTime = correctionTime;
+
+	SnapshotBufferClear(buffer);
+
+}
+
+void SnapshotBufferClear(SnapshotBuffer *buffer) {
+
+	buffer->first = 0;
+	buffer->count = 0;
+	buffer->correctionX = 0.0f;
+	buffer->correctionY = 0.0f;
+	buffer->correctionRotation = 0.0f;
+	buffer->hasClockOffset = 0;
+	buffer->clockOffset = 0.0;
+	buffer->lastReceiveTime = 0.0;
+	buffer->renderDelay = buffer->interpolationDelay;
+
+}
+
+/*
+ Returns the snapshot at position index from the oldest.
+ */
+static Snapshot *SnapshotBufferAt(SnapshotBuffer *buffer, unsigned int index) {
+
+	return &buffer->snapshots[(buffer->first + index) % kSnapshotBufferCapacity];
+
+}
+
+/*
+ Returns the difference between two angles in the range -180 to 180 degrees.
+ */
+static float SnapshotBufferAngleDifference(float from, float to) {
+
+	float difference = fmodf(to - from, 360.0f);
+
+	if (difference > 180.0f) {
+		difference -= 360.0f;
+	} else if (difference < -180.0f) {
+		difference += 360.0f;
+	}
+
+	return difference;
+
+}
+
+/*
+ Calculates the state of the entity at the time specified without any correction.
+ */
+static void SnapshotBufferStateAtTime(SnapshotBuffer *buffer, double time, float *positionX, float *positionY, float *rotation) {
+
+	Snapshot *oldest = SnapshotBufferAt(buffer, 0);
+	Snapshot *newest = SnapshotBufferAt(buffer, buffer->count - 1);
+
+	if (time <= oldest->time) {
+
+		*positionX = oldest->positionX;
+		*positionY = oldest->positionY;
+		*rotation = oldest->rotation;
+
+	} else if (time >= newest->time) {
+
+		/*
+		 Dead reckoning from the newest snapshot.
+		 */
+		double extrapolation = time - newest->time;
+
+		if (extrapolation > buffer->maximumExtrapolation) {
+			extrapolation = buffer->maximumExtrapolation;
+		}
+
+		float radians = kSnapshotBufferDegreesToRadians(newest->heading);
+		float distance = newest->speed * (float)extrapolation;
+
+		*positionX = newest->positionX + sinf(radians) * distance;
+		*positionY = newest->positionY + cosf(radians) * distance;
+		*rotation = newest->rotation;
+
+	} else {
+
+		/*
+		 Find the pair of snapshots either side of the time and interpolate between them.
+		 */
+		unsigned int index = 1;
+
+		while (SnapshotBufferAt(buffer, index)->time < time) {
+			index++;
+		}
+
+		Snapshot *before = SnapshotBufferAt(buffer, index - 1);
+		Snapshot *after = SnapshotBufferAt(buffer, index);
+
+		double interval = after->time - before->time;
+		float fraction = (interval > 0.0) ? (float)((time - before->time) / interval) : 1.0f;
+
+		*positionX = before->positionX + (after->positionX - before->positionX) * fraction;
+		*positionY = before->positionY + (after->positionY - before->positionY) * fraction;
+		*rotation = before->rotation + SnapshotBufferAngleDifference(before->rotation, after->rotation) * fraction;
+
+	}
+
+}
+
+/*
+ Changes the delay the entity is drawn at straight away, keeping the jump in where it is drawn as a correction.
+ */
+static void SnapshotBufferJumpRenderDelay(SnapshotBuffer *buffer, double renderDelay, double now) {
+
+	if (buffer->count > 0) {
+
+		float previousX, previousY, previousRotation;
+		float currentX, currentY, currentRotation;
+
+		SnapshotBufferStateAtTime(buffer, now - buffer->renderDelay, &previousX, &previousY, &previousRotation);
+		SnapshotBufferStateAtTime(buffer, now - renderDelay, &currentX, &currentY, &currentRotation);
+
+		buffer->correctionX += previousX - currentX;
+		buffer->correctionY += previousY - currentY;
+		buffer->correctionRotation += SnapshotBufferAngleDifference(currentRotation, previousRotation);
+
+	}
+
+	buffer->renderDelay = renderDelay;
+
+}
+
+/*
+ Moves the delay the entity is drawn at towards the interpolation delay on the sender's clock, by no more than
+ the time being drawn can gain or lose in elapsed seconds.
+ */
+static void SnapshotBufferEaseRenderDelay(SnapshotBuffer *buffer, double now, double elapsed) {
+
+	double targetDelay = buffer->interpolationDelay + buffer->clockOffset;
+	double difference = targetDelay - buffer->renderDelay;
+	double step = elapsed * kSnapshotBufferRenderDelayRate;
+
+	if (fabs(difference) > kSnapshotBufferMaximumRenderDelayEase) {
+
+		SnapshotBufferJumpRenderDelay(buffer, targetDelay, now);
+
+	} else if (difference > step) {
+
+		buffer->renderDelay += step;
+
+	} else if (difference < -step) {
+
+		buffer->renderDelay -= step;
+
+	} else {
+
+		buffer->renderDelay = targetDelay;
+
+	}
+
+}
+
+void SnapshotBufferAdd(SnapshotBuffer *buffer, const Snapshot *snapshot, double receiveTime, double now) {
+
+	if (buffer->count > 0 && snapshot->time < SnapshotBufferAt(buffer, buffer->count - 1)->time) {
+		return;
+	}
+
+	/*
+	 The quickest any snapshot has taken to arrive becomes the clock offset, which otherwise creeps up. The
+	 first snapshot starts the entity being drawn at the interpolation delay straight away.
+	 */
+	double transitTime = receiveTime - snapshot->time;
+
+	if (!buffer->hasClockOffset) {
+
+		buffer->hasClockOffset = 1;
+		buffer->clockOffset = transitTime;
+		buffer->renderDelay = buffer->interpolationDelay + transitTime;
+
+	} else {
+
+		double creptOffset = buffer->clockOffset + (receiveTime - buffer->lastReceiveTime) * kSnapshotBufferClockOffsetRise;
+		buffer->clockOffset = (transitTime < creptOffset) ? transitTime : creptOffset;
+
+	}
+
+	buffer->lastReceiveTime = receiveTime;
+
+	double renderTime = now - buffer->renderDelay;
+	float previousX = 0.0f, previousY = 0.0f, previousRotation = 0.0f;
+	int hadSnapshots = (buffer->count > 0);
+
+	if (hadSnapshots) {
+		SnapshotBufferStateAtTime(buffer, renderTime, &previousX, &previousY, &previousRotation);
+	}
+
+	/*
+	 Snapshots which are older than the one before the time being drawn are no longer needed. The oldest
+	 is also dropped if the buffer is full.
+	 */
+	while (buffer->count > 1 && SnapshotBufferAt(buffer, 1)->time <= renderTime) {
+
+		buffer->first = (buffer->first + 1) % kSnapshotBufferCapacity;
+		buffer->count--;
+
+	}
+
+	if (buffer->count == kSnapshotBufferCapacity) {
+
+		buffer->first = (buffer->first + 1) % kSnapshotBufferCapacity;
+		buffer->count--;
+
+	}
+
+	*SnapshotBufferAt(buffer, buffer->count) = *snapshot;
+	buffer->count++;
+
+	/*
+	 Any jump in where the entity should be drawn becomes a correction which is smoothed out over time.
+	 */
+	if (hadSnapshots) {
+
+		float currentX, currentY, currentRotation;
+		SnapshotBufferStateAtTime(buffer, renderTime, &currentX, &currentY, &currentRotation);
+
+		buffer->correctionX += previousX - currentX;
+		buffer->correctionY += previousY - currentY;
+		buffer->correctionRotation += SnapshotBufferAngleDifference(currentRotation, previousRotation);
+
+	}
+
+}
+
+int SnapshotBufferSample(SnapshotBuffer *buffer, double now, double elapsed, float *positionX, float *positionY, float *rotation) {
+
+	if (buffer->count == 0) {
+		return 0;
+	}
+
+	SnapshotBufferEaseRenderDelay(buffer, now, elapsed);
+
+	if (buffer->correctionTime > 0.0) {
+
+		float decay = (float)exp(-elapsed / buffer->correctionTime);
+
+		buffer->correctionX *= decay;
+		buffer->correctionY *= decay;
+		buffer->correctionRotation *= decay;
+
+	} else {
+
+		buffer->correctionX = 0.0f;
+		buffer->correctionY = 0.0f;
+		buffer->correctionRotation = 0.0f;
+
+	}
+
+	SnapshotBufferStateAtTime(buffer, now - buffer->renderDelay, positionX, positionY, rotation);
+
+	*positionX += buffer->correctionX;
+	*positionY += buffer->correctionY;
+	*rotation = fmodf(*rotation + buffer->correctionRotation + 360.0f, 360.0f);
+
+	return 1;
+
+}
+
+double SnapshotBufferSenderTime(const SnapshotBuffer *buffer, double localTime) {
+
+	return buffer->hasClockOffset ? localTime - buffer->clockOffset : localTime;
+
+}
@@ -0,0 +1,125 @@
+//
+//  SnapshotBuffer.h
+//  AberFighter
+//
+//  Created by wde7 on 06/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The SnapshotBuffer smooths the movement of an entity whose state arrives over the network, such as the
+ peer's PlayerShip. Each packet of directional data is stored as a Snapshot stamped with the time it was
+ sampled on the sender's clock, so that how long the packets spend on the way doesn't move them in time.
+ The entity is then drawn slightly in the past, interpolationDelay seconds behind the time on the sender's
+ clock, so that there is normally a snapshot either side of the time being drawn and the position can be
+ interpolated between them. Late or lost packets therefore don't cause the entity to stop and snap.
+
+ The sender's clock is taken to be behind the local clock by the shortest time a snapshot has taken to
+ arrive, so the network's jitter and the time the packets waited to be sent come out of interpolationDelay
+ rather than being added to it. This clock offset is allowed to creep up slowly, so that it follows the
+ link if it gets slower for good and the clocks if they drift apart.
+
+ Changes to interpolationDelay and the clock offset aren't applied straight away either, or the entity
+ would jump forwards or backwards in time. The time being drawn runs slightly faster or slower than the
+ local clock until it has caught up with them. A change too large to catch up with quickly is applied at
+ once and the jump is smoothed out as a correction, described below.
+
+ If the newest snapshot is older than the time being drawn, because packets have stopped arriving, the
+ entity is moved on from the newest snapshot using it's heading and speed (dead reckoning) for at most
+ maximumExtrapolation seconds.
+
+ When a new snapshot changes where the entity should be drawn, the jump is not applied straight away.
+ It is stored as a correction which is added to the drawn position and decays over correctionTime
+ seconds, so that the entity slides to it's new position.
+
+ The buffer is written in plain C with no dependency on UIKit or cocos2d.
+ */
+
+#ifndef __SNAPSHOT_BUFFER_H__
+#define __SNAPSHOT_BUFFER_H__
+
+/*
+ Maximum number of snapshots kept. Only the snapshots around the time being drawn are needed, so this
+ only has to cover interpolationDelay at the highest send rate.
+ */
+#define kSnapshotBufferCapacity 16
+
+/*
+ The state of an entity at a moment in time. Headings and rotations are in degrees using the same
+ convention as Ship, 0 is up the screen and angles increase clockwise.
+ */
+typedef struct {
+
+	//The time the state was sampled on the sender's clock.
+	double time;
+	float positionX;
+	float positionY;
+	float heading;
+	float speed;
+	float rotation;
+
+} Snapshot;
+
+typedef struct {
+
+	//Snapshots in order of time, stored in a ring starting at first.
+	Snapshot snapshots[kSnapshotBufferCapacity];
+	unsigned int first;
+	unsigned int count;
+
+	/*
+	 How far behind the sender's clock the entity is drawn. It can be changed at any time and is eased in.
+	 */
+	double interpolationDelay;
+	double maximumExtrapolation;
+	double correctionTime;
+
+	/*
+	 The local clock minus the sender's clock, plus the quickest time a snapshot has taken to arrive, and
+	 the local time the last snapshot arrived.
+	 */
+	int hasClockOffset;
+	double clockOffset;
+	double lastReceiveTime;
+
+	/*
+	 How far behind the local clock the entity is actually being drawn, which follows interpolationDelay plus
+	 clockOffset at a limited rate.
+	 */
+	double renderDelay;
+
+	//Correction still to be applied to the drawn position and rotation.
+	float correctionX;
+	float correctionY;
+	float correctionRotation;
+
+} SnapshotBuffer;
+
+/*
+ Sets up an empty buffer. All times are in seconds.
+ */
+void SnapshotBufferInit(SnapshotBuffer *buffer, double interpolationDelay, double maximumExtrapolation, double correctionTime);
+
+/*
+ Removes every snapshot and any outstanding correction.
+ */
+void SnapshotBufferClear(SnapshotBuffer *buffer);
+
+/*
+ Adds a snapshot which arrived at receiveTime, handled at the current time now. Snapshots older than the
+ newest one in the buffer arrived out of order and are ignored.
+ */
+void SnapshotBufferAdd(SnapshotBuffer *buffer, const Snapshot *snapshot, double receiveTime, double now);
+
+/*
+ Returns the sender's clock at the local time specified, as far as it is known, to use as the reference for
+ reading a wrapped time sent by the sender. Before the first snapshot it is taken to be the local time.
+ */
+double SnapshotBufferSenderTime(const SnapshotBuffer *buffer, double localTime);
+
+/*
+ Calculates where the entity should be drawn at the current time now. elapsed is the time since the
+ previous call and is used to decay the correction. Returns 0 if the buffer is empty.
+ */
+int SnapshotBufferSample(SnapshotBuffer *buffer, double now, double elapsed, float *positionX, float *positionY, float *rotation);
+
+#endif // __SNAPSHOT_BUFFER_H__
@@ -16,6 +16,7 @@
 
 #import <Foundation/Foundation.h>
 #import "Ship.h"
+#import "Simulation.h"
 
 /*
  Here the probability of a ship type appearing in the game should
@@ -32,8 +33,11 @@ typedef enum TargetTypes {
 	kTargetShipLarge	
 } TargetType;
 
+//Number of values in the TargetType enumeration.
+#define kTargetShipTypeCount 2
+
 /*
- This enumeration is used in the generateRandomStartingPositionAndHeading method when
+ This enumeration is used in the generateStartingPositionAndHeadingWithRandom: method when
  determining which screen edge the TargetShip will spawn on. 
  */
 typedef enum StartingEdges {
@@ -55,6 +59,11 @@ typedef enum StartingEdges {
 	 a reference to an instance of TargetShip. See ReusableTargetPool for more information.
 	 */
 	BOOL currentlyInUse;
+	/*
+	 Link to the next available TargetShip of the same type while this instance is in the
+	 ReusableTargetPool's free list. Not retained, the pool owns every instance.
+	 */
+	TargetShip *nextAvailableTarget;
 	/*
 	 TargetShips spawn offscreen and move onto the screen after a short time. The ActionLayer 
 	 uses the checkIfOffscreen method below to determine when a ship has passed back off the screen
@@ -78,6 +87,7 @@ typedef enum StartingEdges {
  */
 @property (nonatomic,readonly) int scoreAwarded;
 @property (nonatomic,readwrite,assign) BOOL currentlyInUse;
+@property (nonatomic,readwrite,assign) TargetShip *nextAvailableTarget;
 @property (nonatomic,readonly) BOOL minimumLifetimeExpired;
 @property (nonatomic,readonly) TargetType targetType;
 
@@ -90,9 +100,10 @@ typedef enum StartingEdges {
 /*
  This method will set the position of the TargetShip to a random point just offscreen
  of one of the four screen edges and set the heading to a random heading which takes
- the ship onto the screen area.
+ the ship onto the screen area. The random numbers are taken from the generator passed in,
+ so the same seed always produces the same spawns.
  */
-- (void)generateRandomStartingPositionAndHeading;
+- (void)generateStartingPositionAndHeadingWithRandom:(SimulationRandom *)random;
 
 /*
  This method sets the initial heading and position of the TargetShip for this spawn
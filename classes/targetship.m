@@ -15,6 +15,7 @@
  */
 @synthesize scoreAwarded;
 @synthesize currentlyInUse;
+@synthesize nextAvailableTarget;
 @synthesize minimumLifetimeExpired;
 @synthesize targetType;
 
@@ -27,6 +28,8 @@
 - (id)initTargetWithSpriteFrameName:(NSString *)spriteFrameName type:(TargetType)type maximumShieldStrength:(int)maxShieldStrength defaultSpeed:(float)defaultSpeed scoreAwarded:(int)score {
 	
 	if ((self = [super initWithSpriteFrameName:spriteFrameName])) {
+		NSAssert(self.contentSize.width == ((type == kTargetShipSmall) ? kGameSmallTargetImageSize : kGameLargeTargetImageSize),
+				 @"TargetShip: %@ isn't the size in GameConstants.h, which the Simulation uses", spriteFrameName);
 		self.tag = 2;
 		targetType = type;
 		maximumShieldStrength = maxShieldStrength;
@@ -34,6 +37,7 @@
 		self.speed = defaultSpeed;
 		scoreAwarded = score;
 		self.currentlyInUse = NO;
+		nextAvailableTarget = nil;
 		minimumLifetimeExpired = NO;
 	}
 	
@@ -71,94 +75,31 @@
 
 /*
  This method should be called before a TargetShip instance is added to a layer to
- generate the initial values for heading and position.
+ generate the initial values for heading and position. The rules are shared with the
+ headless Simulation so that the game and the simulation spawn targets identically.
  */
-- (void)generateRandomStartingPositionAndHeading {
+- (void)generateStartingPositionAndHeadingWithRandom:(SimulationRandom *)random {
 	
 	CGSize winSize = [[CCDirector sharedDirector] winSize];
 	
-	/*
-	 A random value between 0 and 3 determines which screen edge the initial position will be next to. 
-	 */
-	int randomSpawnEdge = arc4random() % 4;
-	
-	/*
-	 The random element of the heading is 0 to 90 degrees. This is used rather than 0 to 180 degrees to
-	 avoid ships which travel perpendicular to the screen edge. 
-	 */
-	int randomHeading = arc4random() % 91; 
-	
-	float xStartingPosition;
-	float yStartingPosition = 0.0f;
-	
 	/*
 	 Rather than use the width or height of the ship, the size intersecting from one corner
 	 of the rectangle to the other is used. This ensures that the ship is entirely offscreen.
 	 */
 	float shipSize = sqrt((pow(self.contentSize.width, 2) + pow(self.contentSize.height, 2)));
 	
-	/*
-	 Depending of which screen edge was chosen earlier, either the y or the x position will be
-	 set by the switch statement below. This boolean is used later to identify whcih position 
-	 still needs setting.
-	 */
-	BOOL xPositionDetermined = NO;
-	
-	float initialHeading = 0.0f;
-	
-	/*
-	 This switch statement sets the values for initialHeading and either xStartingPosition or
-	 yStartingPosition based on which screen edge was chosen earlier.
-	 */
-	switch (randomSpawnEdge) {
-		case kLeftEdge:
-			xStartingPosition = 0 - (shipSize / 2);
-			initialHeading = 45.0 + randomHeading;
-			xPositionDetermined = YES;
-			break;
-		case kUpperEdge:
-			yStartingPosition = winSize.height + (shipSize / 2);
-			initialHeading = 135.0 + randomHeading;
-			break;
-		case kRightEdge:
-			xStartingPosition = winSize.width + (shipSize / 2);
-			initialHeading = 360.0 - (45.0 + randomHeading);
-			xPositionDetermined = YES;
-			break;
-		case kLowerEdge:
-			yStartingPosition = 0 - (shipSize / 2);
-			initialHeading = 45.0 - randomHeading;
-			break;
-		default:
-			break;
-	}
-	
-	/*
-	 randomStartingPosition is the position along the screen edge chosen where the
-	 TargetShip will be placed. It is between 1/4 and 3/4 of the way across the edge.
-	 */
-	int randomStartingPosition;
+	float xStartingPosition;
+	float yStartingPosition;
+	float initialHeading;
 	
-	if (xPositionDetermined == YES) {
-		
-		int yAxisMiddle = (int)(winSize.height / 2);
-		randomStartingPosition = arc4random() % yAxisMiddle;
-		yStartingPosition = (winSize.height / 4) + randomStartingPosition;
-		
-	} else {
-		
-		int xAxisMiddle = (int)(winSize.width / 2);
-		randomStartingPosition = arc4random() % xAxisMiddle;
-		xStartingPosition = (winSize.width / 4) + randomStartingPosition;
-		
-	}
+	SimulationGenerateTargetSpawn(random, winSize.width, winSize.height, shipSize, 
+								  &xStartingPosition, &yStartingPosition, &initialHeading);
 	
 	/*
-	 The position is created from the values calculated earlier and this plus the initial heading are passed to
+	 The position is created from the values calculated and this plus the initial heading are passed to
 	 the spawnWithHeadingStartingPosition method below.
 	 */
 	CGPoint position = ccp(xStartingPosition, yStartingPosition);
-	
 	[self spawnWithHeading:initialHeading startingPosition:position];
 	
 }
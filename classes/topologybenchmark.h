@@ -0,0 +1,125 @@
+//
+//  TopologyBenchmark.h
+//  AberFighter
+//
+//  Created by wde7 on 17/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The TopologyBenchmark measures the traffic and latency of a game of several players connected as a mesh or
+ as a star. It creates a BluetoothCommsManager for each player, other than the sharedInstance, and connects
+ them with LoopbackTransports which imitate the conditions of a wireless link. Once the die roll has decided
+ the players it sends the traffic of a game from every manager for the duration specified: directional data
+ at the rate each manager chooses, a projectile every kTopologyBenchmarkProjectileInterval and a flush every
+ frame. The bytes each device sends and receives, the messages relayed by the hub, the round trip times
+ between the players measured by their pings and how long ship and projectile updates waited in the
+ replication schedulers are then logged and kept in the result.
+
+ The managers are run by the CCScheduler, so the director must be running. tests/topologybenchmark.c models
+ the same game on the host with the plain C parts of the managers.
+ */
+
+#import <Foundation/Foundation.h>
+#import "BluetoothCommsManager.h"
+#import "LoopbackTransport.h"
+
+/*
+ When kTopologyBenchmarkOnLaunch is 1 the mesh and star topologies are compared with kMaximumNumberOfPlayers
+ players when the app launches, and the results are logged.
+ */
+#define kTopologyBenchmarkOnLaunch				0
+//Seconds between the frames of the imitated game.
+#define kTopologyBenchmarkFrameInterval			(1.0/60.0)
+//Seconds between the projectiles fired by each player.
+#define kTopologyBenchmarkProjectileInterval	0.5
+
+typedef struct {
+
+	NetworkTopology topology;
+	int numberOfPlayers;
+	//Seconds the traffic was measured over, from when the players were decided.
+	NSTimeInterval duration;
+
+	//Packet bytes per second sent and received by a device, averaged over the devices and for the busiest one.
+	float meanBytesSentPerSecond;
+	float maximumBytesSentPerSecond;
+	float meanBytesReceivedPerSecond;
+	float maximumBytesReceivedPerSecond;
+
+	//Messages relayed by the hub of a star. Always 0 in a mesh.
+	unsigned long messagesRelayed;
+
+	//Round trip times between every pair of players in seconds, averaged and the longest.
+	double meanRoundTripTime;
+	double maximumRoundTripTime;
+
+	/*
+	 Seconds ship and projectile updates waited to be sent, averaged and the longest, and the number of times
+	 an update was left out of a batch, over every device.
+	 */
+	double meanShipUpdateStaleness;
+	double maximumShipUpdateStaleness;
+	double meanProjectileUpdateStaleness;
+	unsigned long updatesDeferred;
+
+} TopologyBenchmarkResult;
+
+@interface TopologyBenchmark : NSObject <NetworkEventHandler> {
+
+	NetworkTopology topology;
+	int numberOfPlayers;
+	LoopbackConditions conditions;
+	NSTimeInterval duration;
+
+	BluetoothCommsManager *managers[kMaximumNumberOfPlayers];
+	LoopbackTransport *transports[kMaximumNumberOfPlayers];
+
+	/*
+	 Number of managers which have finished the die roll. The traffic is only measured once they all have,
+	 from startTime, and the statistics of each manager at that time are kept in startStatistics.
+	 */
+	int playersDecided;
+	NSTimeInterval startTime;
+	NetworkTrafficStatistics startStatistics[kMaximumNumberOfPlayers];
+
+	//Drives the imitated game, and the times each player last sent directional data and a projectile.
+	NSTimer *frameTimer;
+	NSTimeInterval lastDirectionalDataSendTimes[kMaximumNumberOfPlayers];
+	NSTimeInterval lastProjectileTime;
+
+	//Sent the action, with the benchmark, once the results are ready. Not retained.
+	id target;
+	SEL action;
+
+	TopologyBenchmarkResult result;
+
+}
+
+@property (nonatomic, readonly) NetworkTopology topology;
+@property (nonatomic, readonly) int numberOfPlayers;
+@property (nonatomic, readonly) LoopbackConditions conditions;
+@property (nonatomic, readonly) NSTimeInterval duration;
+@property (nonatomic, readonly) TopologyBenchmarkResult result;
+
+/*
+ Runs a mesh benchmark and then a star benchmark with the same players and conditions, and logs both.
+ */
++ (void)compareTopologiesWithNumberOfPlayers:(int)players conditions:(LoopbackConditions)newConditions duration:(NSTimeInterval)newDuration;
+
+/*
+ Initializer method. players must be from 2 to kMaximumNumberOfPlayers. In a star the first device is the hub.
+ */
+- (id)initWithTopology:(NetworkTopology)newTopology numberOfPlayers:(int)players conditions:(LoopbackConditions)newConditions duration:(NSTimeInterval)newDuration;
+
+/*
+ Connects the managers and starts the die roll. The benchmark retains itself until it finishes, when the
+ action is sent to the target with the benchmark as it's argument.
+ */
+- (void)startWithTarget:(id)newTarget action:(SEL)newAction;
+
+/*
+ Stops the benchmark and releases the managers without sending the action.
+ */
+- (void)stop;
+
+@end
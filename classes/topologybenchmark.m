@@ -0,0 +1,326 @@
+//
+//  TopologyBenchmark.m
+//  AberFighter
+//
+//  Created by wde7 on 17/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "TopologyBenchmark.h"
+#import "cocos2d.h"
+
+@implementation TopologyBenchmark
+
+@synthesize topology;
+@synthesize numberOfPlayers;
+@synthesize conditions;
+@synthesize duration;
+@synthesize result;
+
++ (void)compareTopologiesWithNumberOfPlayers:(int)players conditions:(LoopbackConditions)newConditions duration:(NSTimeInterval)newDuration {
+
+	TopologyBenchmark *benchmark = [[TopologyBenchmark alloc] initWithTopology:kNetworkTopologyMesh
+															   numberOfPlayers:players
+																	conditions:newConditions
+																	  duration:newDuration];
+
+	[benchmark startWithTarget:self action:@selector(meshBenchmarkFinished:)];
+	[benchmark release];
+
+}
+
+/*
+ The star benchmark is started once the mesh has finished, so that they don't share the run loop.
+ */
++ (void)meshBenchmarkFinished:(TopologyBenchmark *)meshBenchmark {
+
+	TopologyBenchmark *benchmark = [[TopologyBenchmark alloc] initWithTopology:kNetworkTopologyStar
+															   numberOfPlayers:meshBenchmark.numberOfPlayers
+																	conditions:meshBenchmark.conditions
+																	  duration:meshBenchmark.duration];
+
+	[benchmark startWithTarget:nil action:NULL];
+	[benchmark release];
+
+}
+
+- (id)initWithTopology:(NetworkTopology)newTopology numberOfPlayers:(int)players conditions:(LoopbackConditions)newConditions duration:(NSTimeInterval)newDuration {
+
+	if ((self = [super init])) {
+
+		NSAssert(players >= 2 && players <= kMaximumNumberOfPlayers, @"TopologyBenchmark: unsupported number of players");
+
+		topology = newTopology;
+		numberOfPlayers = players;
+		conditions = newConditions;
+		duration = newDuration;
+		memset(&result, 0, sizeof(TopologyBenchmarkResult));
+
+	}
+
+	return self;
+
+}
+
+/*
+ In a mesh every transport is connected to every other, in a star every transport is connected to the first.
+ Each manager is then told about the peers it's transport is connected to.
+ */
+- (void)startWithTarget:(id)newTarget action:(SEL)newAction {
+
+	[self retain];
+
+	target = newTarget;
+	action = newAction;
+	playersDecided = 0;
+	lastProjectileTime = 0;
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		transports[i] = [[LoopbackTransport alloc] initWithPeerID:[NSString stringWithFormat:@"benchmark-%d", i]];
+		transports[i].conditions = conditions;
+		[transports[i] seedConditions:(uint32_t)(i + 1)];
+		lastDirectionalDataSendTimes[i] = 0;
+
+	}
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		for (int j = i + 1; j < numberOfPlayers; j++) {
+
+			if (topology == kNetworkTopologyMesh || i == 0) {
+				[transports[i] connectToTransport:transports[j]];
+			}
+
+		}
+
+	}
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		managers[i] = [[BluetoothCommsManager alloc] init];
+		managers[i].topology = topology;
+		managers[i].eventHandler = self;
+		[managers[i] setUpSessionWithTransport:transports[i]];
+
+	}
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		for (int j = 0; j < numberOfPlayers; j++) {
+
+			if (j != i && (topology == kNetworkTopologyMesh || i == 0 || j == 0)) {
+				[managers[i] connectToPeer:transports[j].peerID];
+			}
+
+		}
+
+	}
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+		[managers[i] sendNewDieRollPacket];
+	}
+
+	frameTimer = [NSTimer scheduledTimerWithTimeInterval:kTopologyBenchmarkFrameInterval
+												  target:self
+												selector:@selector(frame:)
+												userInfo:nil
+												 repeats:YES];
+
+}
+
+- (void)stop {
+
+	if (frameTimer == nil) {
+		return;
+	}
+
+	[frameTimer invalidate];
+	frameTimer = nil;
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		[managers[i] invalidate];
+		[managers[i] release];
+		managers[i] = nil;
+
+		[transports[i] release];
+		transports[i] = nil;
+
+	}
+
+	[self autorelease];
+
+}
+
+/*
+ Works out the result from the change in each manager's statistics since the players were decided.
+ */
+- (void)calculateResult {
+
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+	int roundTripTimes = 0;
+	ReplicationStatistics shipUpdates;
+	ReplicationStatistics projectileUpdates;
+
+	memset(&shipUpdates, 0, sizeof(ReplicationStatistics));
+	memset(&projectileUpdates, 0, sizeof(ReplicationStatistics));
+
+	memset(&result, 0, sizeof(TopologyBenchmarkResult));
+	result.topology = topology;
+	result.numberOfPlayers = numberOfPlayers;
+	result.duration = now - startTime;
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		NetworkTrafficStatistics statistics = managers[i].trafficStatistics;
+		float bytesSent = (statistics.totalPacketBytes - startStatistics[i].totalPacketBytes) / result.duration;
+		float bytesReceived = (statistics.totalPacketBytesReceived - startStatistics[i].totalPacketBytesReceived) / result.duration;
+
+		result.meanBytesSentPerSecond += bytesSent / numberOfPlayers;
+		result.maximumBytesSentPerSecond = MAX(result.maximumBytesSentPerSecond, bytesSent);
+		result.meanBytesReceivedPerSecond += bytesReceived / numberOfPlayers;
+		result.maximumBytesReceivedPerSecond = MAX(result.maximumBytesReceivedPerSecond, bytesReceived);
+		result.messagesRelayed += statistics.totalMessagesRelayed - startStatistics[i].totalMessagesRelayed;
+
+		ReplicationStatistics projectileStatistics = [managers[i] projectileReplicationStatistics];
+		ReplicationStatisticsAdd(&projectileUpdates, &projectileStatistics);
+
+		for (int player = kPlayer1; player <= numberOfPlayers; player++) {
+
+			double roundTripTime = [managers[i] roundTripTimeToPlayer:player];
+
+			if (player != managers[i].playerID && roundTripTime > 0.0) {
+
+				result.meanRoundTripTime += roundTripTime;
+				result.maximumRoundTripTime = MAX(result.maximumRoundTripTime, roundTripTime);
+				roundTripTimes++;
+
+			}
+
+			ReplicationStatistics shipStatistics = [managers[i] replicationStatisticsForShipOfPlayer:player];
+			ReplicationStatisticsAdd(&shipUpdates, &shipStatistics);
+
+		}
+
+	}
+
+	if (roundTripTimes > 0) {
+		result.meanRoundTripTime /= roundTripTimes;
+	}
+
+	result.meanShipUpdateStaleness = ReplicationStatisticsMeanStaleness(&shipUpdates);
+	result.maximumShipUpdateStaleness = shipUpdates.maximumStaleness;
+	result.meanProjectileUpdateStaleness = ReplicationStatisticsMeanStaleness(&projectileUpdates);
+	result.updatesDeferred = shipUpdates.deferrals + projectileUpdates.deferrals;
+
+	NSLog(@"%@ of %d players over %.1fs: sent %.0f B/s (busiest %.0f B/s), received %.0f B/s (busiest %.0f B/s), "
+		  @"%lu messages relayed, round trip %.1f ms (longest %.1f ms), ship updates waited %.1f ms (longest %.1f ms), "
+		  @"projectiles waited %.1f ms, %lu updates deferred",
+		  (topology == kNetworkTopologyStar) ? @"Star" : @"Mesh", numberOfPlayers, result.duration,
+		  result.meanBytesSentPerSecond, result.maximumBytesSentPerSecond,
+		  result.meanBytesReceivedPerSecond, result.maximumBytesReceivedPerSecond,
+		  result.messagesRelayed, result.meanRoundTripTime * 1000.0, result.maximumRoundTripTime * 1000.0,
+		  result.meanShipUpdateStaleness * 1000.0, result.maximumShipUpdateStaleness * 1000.0,
+		  result.meanProjectileUpdateStaleness * 1000.0, result.updatesDeferred);
+
+}
+
+/*
+ Sends a frame of the imitated game from every manager. The ships fly in circles so that their directional
+ data keeps changing.
+ */
+- (void)frame:(NSTimer *)timer {
+
+	NSTimeInterval now = [BluetoothCommsManager currentTime];
+
+	if (playersDecided < numberOfPlayers) {
+		return;
+	}
+
+	if (now - startTime >= duration) {
+
+		[self calculateResult];
+
+		id finishedTarget = target;
+		SEL finishedAction = action;
+
+		[self retain];
+		[self stop];
+		[finishedTarget performSelector:finishedAction withObject:self];
+		[self release];
+		return;
+
+	}
+
+	BOOL fireProjectiles = (now - lastProjectileTime >= kTopologyBenchmarkProjectileInterval);
+
+	if (fireProjectiles) {
+		lastProjectileTime = now;
+	}
+
+	for (int i = 0; i < numberOfPlayers; i++) {
+
+		float angle = (float)(now - startTime) + i;
+		CGPoint position = CGPointMake(240.0f + 100.0f * cosf(angle), 160.0f + 100.0f * sinf(angle));
+
+		if (now - lastDirectionalDataSendTimes[i] >= managers[i].directionalDataSendInterval) {
+
+			lastDirectionalDataSendTimes[i] = now;
+			[managers[i] sendLocalPlayerShipDirectionalDataWithNewHeading:CC_RADIANS_TO_DEGREES(angle)
+																 newSpeed:1.0f
+														  currentPosition:position
+														  currentRotation:CC_RADIANS_TO_DEGREES(angle)];
+
+		}
+
+		if (fireProjectiles) {
+			[managers[i] sendProjectileFiredDetailsWithStartingPosition:position destinationPoint:CGPointMake(240.0f, 160.0f)];
+		}
+
+		[managers[i] flushOutboundMessages];
+
+	}
+
+}
+
+/*
+ The traffic is measured from when the last manager finishes the die roll, so the die roll isn't counted.
+ */
+- (void)processNetworkEvent:(const NetworkEvent *)event {
+
+	switch (event->type) {
+
+		case kNetworkEventDieRollFinished: {
+
+			playersDecided++;
+
+			if (playersDecided == numberOfPlayers) {
+
+				startTime = [BluetoothCommsManager currentTime];
+
+				for (int i = 0; i < numberOfPlayers; i++) {
+					startStatistics[i] = managers[i].trafficStatistics;
+				}
+
+			}
+
+		}
+		break;
+
+		case kNetworkEventPeerDisconnected:
+		case kNetworkEventSessionFailed: {
+
+			NSLog(@"TopologyBenchmark: a device was disconnected before the benchmark finished");
+
+		}
+		break;
+
+		default:
+		break;
+
+	}
+
+}
+
+@end
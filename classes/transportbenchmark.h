@@ -0,0 +1,90 @@
+//
+//  TransportBenchmark.h
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The TransportBenchmark measures the latency and throughput of a NetworkTransport by itself, without a
+ BluetoothCommsManager. Two transports are connected to each other, one sending and one echoing. The sender
+ pings the echoer one packet at a time and times each round trip, then floods it with packets as fast as it
+ can send them and counts how many arrive and how quickly. The results are logged and kept in the result.
+
+ The benchmark waits for packets by running the main run loop, which is what delivers the packets of a
+ LoopbackTransport. The packets of a UDPTransport are delivered on it's receive thread, so the counts are
+ kept behind a lock.
+ */
+
+#import <Foundation/Foundation.h>
+#import "NetworkTransport.h"
+
+/*
+ When kTransportBenchmarkOnLaunch is 1 the LoopbackTransport and the UDPTransport are measured with packets
+ of several sizes when the app launches, and the results are logged.
+ */
+#define kTransportBenchmarkOnLaunch			0
+//Round trips timed in each run.
+#define kTransportBenchmarkPings			200
+//Packets sent by the flood in each run.
+#define kTransportBenchmarkFloodPackets		5000
+//Seconds to wait for a packet before it is counted as lost.
+#define kTransportBenchmarkTimeout			0.5
+//Local ports of the two UDPTransports.
+#define kTransportBenchmarkSenderPort		47100
+#define kTransportBenchmarkEchoerPort		47101
+
+typedef struct {
+
+	int packetSize;
+
+	//Round trip times of the pings in seconds, averaged and the longest, and the pings which never came back.
+	double meanRoundTripTime;
+	double maximumRoundTripTime;
+	unsigned long pingsLost;
+
+	//Packets and bytes of the flood received per second, from the first packet sent to the last received.
+	double packetsPerSecond;
+	double bytesPerSecond;
+	unsigned long floodPacketsLost;
+
+} TransportBenchmarkResult;
+
+@interface TransportBenchmark : NSObject <NetworkTransportDelegate> {
+
+	id<NetworkTransport> sender;
+	id<NetworkTransport> echoer;
+	//The ID the echoer is known by to the sender, and the ID the sender is known by to the echoer.
+	NSString *echoerPeerID;
+	NSString *senderPeerID;
+
+	/*
+	 Counts of the packets received, which may be updated on a transport's receive thread. The pongs are the
+	 pings echoed back to the sender.
+	 */
+	NSLock *lock;
+	unsigned long pongsReceived;
+	unsigned long floodPacketsReceived;
+	CFAbsoluteTime lastFloodPacketTime;
+
+}
+
+/*
+ Measures a pair of LoopbackTransports and a pair of UDPTransports with small and large packets and logs
+ the results.
+ */
++ (void)compareTransports;
+
+/*
+ Initializer method. The benchmark is made the delegate of both transports, which must already be connected
+ to each other.
+ */
+- (id)initWithSender:(id<NetworkTransport>)newSender echoer:(id<NetworkTransport>)newEchoer
+		echoerPeerID:(NSString *)newEchoerPeerID senderPeerID:(NSString *)newSenderPeerID;
+
+/*
+ Runs the pings and the flood with packets of the size specified, in bytes, and logs the result.
+ */
+- (TransportBenchmarkResult)runWithPacketSize:(int)packetSize name:(NSString *)name;
+
+@end
@@ -0,0 +1,282 @@
+//
+//  TransportBenchmark.m
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "TransportBenchmark.h"
+#import "LoopbackTransport.h"
+#import "UDPTransport.h"
+
+/*
+ The first byte of every packet says what it is. The rest of the packet is padding.
+ */
+typedef enum {
+
+	kTransportBenchmarkPing,
+	kTransportBenchmarkPong,
+	kTransportBenchmarkFlood
+
+} TransportBenchmarkPacketType;
+
+@implementation TransportBenchmark
+
++ (void)compareTransports {
+
+	LoopbackTransport *loopbackSender = [[LoopbackTransport alloc] initWithPeerID:@"sender"];
+	LoopbackTransport *loopbackEchoer = [[LoopbackTransport alloc] initWithPeerID:@"echoer"];
+	[loopbackSender connectToTransport:loopbackEchoer];
+
+	TransportBenchmark *benchmark = [[TransportBenchmark alloc] initWithSender:loopbackSender echoer:loopbackEchoer
+																   echoerPeerID:loopbackEchoer.peerID senderPeerID:loopbackSender.peerID];
+	[benchmark runWithPacketSize:20 name:@"LoopbackTransport"];
+	[benchmark runWithPacketSize:200 name:@"LoopbackTransport"];
+	[benchmark release];
+
+	[loopbackSender release];
+	[loopbackEchoer release];
+
+	UDPTransport *udpSender = [[UDPTransport alloc] initWithLocalPort:kTransportBenchmarkSenderPort remotePort:kTransportBenchmarkEchoerPort];
+	UDPTransport *udpEchoer = [[UDPTransport alloc] initWithLocalPort:kTransportBenchmarkEchoerPort remotePort:kTransportBenchmarkSenderPort];
+
+	if (udpSender != nil && udpEchoer != nil) {
+
+		benchmark = [[TransportBenchmark alloc] initWithSender:udpSender echoer:udpEchoer
+												  echoerPeerID:udpSender.remotePeerID senderPeerID:udpEchoer.remotePeerID];
+		[benchmark runWithPacketSize:20 name:@"UDPTransport"];
+		[benchmark runWithPacketSize:200 name:@"UDPTransport"];
+		[benchmark release];
+
+	} else {
+
+		NSLog(@"TransportBenchmark: ports %d and %d are in use, the UDPTransport wasn't measured",
+			  kTransportBenchmarkSenderPort, kTransportBenchmarkEchoerPort);
+
+	}
+
+	[udpSender release];
+	[udpEchoer release];
+
+}
+
+- (id)initWithSender:(id<NetworkTransport>)newSender echoer:(id<NetworkTransport>)newEchoer
+		echoerPeerID:(NSString *)newEchoerPeerID senderPeerID:(NSString *)newSenderPeerID {
+
+	if ((self = [super init])) {
+
+		sender = [newSender retain];
+		echoer = [newEchoer retain];
+		echoerPeerID = [newEchoerPeerID copy];
+		senderPeerID = [newSenderPeerID copy];
+		lock = [[NSLock alloc] init];
+
+		[sender startWithDelegate:self];
+		[echoer startWithDelegate:self];
+
+	}
+
+	return self;
+
+}
+
+/*
+ Runs the main run loop until the count reaches the value specified, or until no packet has been counted for
+ kTransportBenchmarkTimeout. Returns the count.
+ */
+- (unsigned long)waitForCount:(unsigned long *)count toReach:(unsigned long)value {
+
+	unsigned long lastCount = 0;
+	CFAbsoluteTime lastChangeTime = CFAbsoluteTimeGetCurrent();
+
+	while (YES) {
+
+		[lock lock];
+		unsigned long currentCount = *count;
+		[lock unlock];
+
+		if (currentCount >= value) {
+			return currentCount;
+		}
+
+		CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+
+		if (currentCount != lastCount) {
+
+			lastCount = currentCount;
+			lastChangeTime = now;
+
+		} else if (now - lastChangeTime > kTransportBenchmarkTimeout) {
+			return currentCount;
+		}
+
+		CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.0005, true);
+
+	}
+
+}
+
+- (TransportBenchmarkResult)runWithPacketSize:(int)packetSize name:(NSString *)name {
+
+	TransportBenchmarkResult result;
+	NSMutableData *packet = [[NSMutableData alloc] initWithLength:packetSize];
+	uint8_t *packetType = [packet mutableBytes];
+	NSArray *echoerPeers = [NSArray arrayWithObject:echoerPeerID];
+
+	memset(&result, 0, sizeof(result));
+	result.packetSize = packetSize;
+
+	/*
+	 One ping at a time, each timed from being sent until it's pong has been received.
+	 */
+	double totalRoundTripTime = 0.0;
+	unsigned long pingsReturned = 0;
+
+	*packetType = kTransportBenchmarkPing;
+
+	for (int i = 0; i < kTransportBenchmarkPings; i++) {
+
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+		[lock lock];
+		unsigned long expectedPongs = pongsReceived + 1;
+		[lock unlock];
+
+		CFAbsoluteTime sendTime = CFAbsoluteTimeGetCurrent();
+		[sender sendData:packet toPeers:echoerPeers reliable:NO];
+
+		if ([self waitForCount:&pongsReceived toReach:expectedPongs] >= expectedPongs) {
+
+			double roundTripTime = CFAbsoluteTimeGetCurrent() - sendTime;
+
+			totalRoundTripTime += roundTripTime;
+			pingsReturned++;
+
+			if (roundTripTime > result.maximumRoundTripTime) {
+				result.maximumRoundTripTime = roundTripTime;
+			}
+
+		}
+
+		[pool release];
+
+	}
+
+	result.pingsLost = kTransportBenchmarkPings - pingsReturned;
+	result.meanRoundTripTime = (pingsReturned > 0) ? totalRoundTripTime / pingsReturned : 0.0;
+
+	/*
+	 Every packet of the flood is sent before any are waited for.
+	 */
+	*packetType = kTransportBenchmarkFlood;
+
+	[lock lock];
+	floodPacketsReceived = 0;
+	[lock unlock];
+
+	CFAbsoluteTime floodStartTime = CFAbsoluteTimeGetCurrent();
+
+	for (int i = 0; i < kTransportBenchmarkFloodPackets; i++) {
+
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		[sender sendData:packet toPeers:echoerPeers reliable:NO];
+		[pool release];
+
+	}
+
+	unsigned long received = [self waitForCount:&floodPacketsReceived toReach:kTransportBenchmarkFloodPackets];
+
+	[lock lock];
+	double floodDuration = lastFloodPacketTime - floodStartTime;
+	[lock unlock];
+
+	if (received > 0 && floodDuration > 0) {
+
+		result.packetsPerSecond = received / floodDuration;
+		result.bytesPerSecond = result.packetsPerSecond * packetSize;
+
+	}
+
+	result.floodPacketsLost = kTransportBenchmarkFloodPackets - received;
+
+	[packet release];
+
+	NSLog(@"%@ with %d byte packets: round trip %.1f us mean, %.1f us longest, %lu of %d pings lost. "
+		  @"Flood %.0f packets/s, %.1f KB/s, %lu of %d packets lost",
+		  name, result.packetSize, result.meanRoundTripTime * 1.0e6, result.maximumRoundTripTime * 1.0e6,
+		  result.pingsLost, kTransportBenchmarkPings, result.packetsPerSecond, result.bytesPerSecond / 1024.0,
+		  result.floodPacketsLost, kTransportBenchmarkFloodPackets);
+
+	return result;
+
+}
+
+#pragma mark -
+#pragma mark NetworkTransportDelegate Methods
+
+/*
+ The echoer sends every ping back as a pong, and the counts are updated as the pongs and the packets of the
+ flood arrive.
+ */
+- (void)transport:(id<NetworkTransport>)transport receivedData:(NSData *)data fromPeer:(NSString *)peerID {
+
+	if ([data length] == 0) {
+		return;
+	}
+
+	uint8_t packetType = ((const uint8_t *)[data bytes])[0];
+
+	if (transport == echoer && packetType == kTransportBenchmarkPing) {
+
+		NSMutableData *pong = [data mutableCopy];
+		((uint8_t *)[pong mutableBytes])[0] = kTransportBenchmarkPong;
+		[echoer sendData:pong toPeers:[NSArray arrayWithObject:senderPeerID] reliable:NO];
+		[pong release];
+
+	} else if (transport == sender && packetType == kTransportBenchmarkPong) {
+
+		[lock lock];
+		pongsReceived++;
+		[lock unlock];
+
+	} else if (transport == echoer && packetType == kTransportBenchmarkFlood) {
+
+		[lock lock];
+		floodPacketsReceived++;
+		lastFloodPacketTime = CFAbsoluteTimeGetCurrent();
+		[lock unlock];
+
+	}
+
+}
+
+- (void)transport:(id<NetworkTransport>)transport peerDisconnected:(NSString *)peerID {
+
+}
+
+- (void)transport:(id<NetworkTransport>)transport failedWithError:(NSError *)error {
+
+	NSLog(@"TransportBenchmark: the transport failed: %@", error);
+
+}
+
+/*
+ The transports are stopped before they are released, so that nothing is delivered to the benchmark after it
+ has gone.
+ */
+- (void)dealloc {
+
+	[sender stop];
+	[echoer stop];
+	[sender release];
+	[echoer release];
+	[echoerPeerID release];
+	[senderPeerID release];
+	[lock release];
+
+	[super dealloc];
+
+}
+
+@end
@@ -0,0 +1,36 @@
+//
+//  TrigTable.h
+//  AberFighter
+//
+//  Created by wde7 on 04/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Sines and cosines of headings in degrees, looked up in a table rather than calculated by the maths library.
+ The results of sinf and cosf depend on the library's implementation, which isn't the same on every device
+ or version of iOS, so two devices running the same Simulation could move ships and projectiles by slightly
+ different amounts and drift apart. The table is written out in the source, and the lookup only uses
+ additions, multiplications and floorf, which give the same result everywhere as long as the compiler
+ doesn't fuse them (see -ffp-contract=off in the tests' Makefile and the project's per-file flags).
+
+ The table holds a quarter of a circle in kTrigTableQuarterSteps steps, and values between steps are
+ interpolated linearly, which is accurate to about 5e-6.
+
+ The table is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __TRIG_TABLE_H__
+#define __TRIG_TABLE_H__
+
+/*
+ Steps in a quarter of a circle. The table has one more entry, for 90 degrees.
+ */
+#define kTrigTableQuarterSteps 256
+
+/*
+ Returns the sine and cosine of an angle in degrees, which may be any finite value.
+ */
+float TrigTableSine(float degrees);
+float TrigTableCosine(float degrees);
+
+#endif // __TRIG_TABLE_H__
@@ -0,0 +1,58 @@
+//
+//  UDPTransport.h
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ NetworkTransport which sends packets as UDP datagrams between two ports on the local machine, so that two
+ processes can play against each other without bluetooth. Each packet is sent as a single datagram.
+
+ Datagrams are received on a thread of their own, which does nothing else, so they are read from the socket
+ as soon as they arrive however long the main thread spends drawing a frame.
+
+ UDP doesn't retransmit lost datagrams, so packets sent reliably are sent in the same way as unreliable ones.
+ Datagrams are very rarely lost between two ports on the same machine, but this transport should not be used
+ over a real network.
+ */
+
+#import <Foundation/Foundation.h>
+#import <netinet/in.h>
+#import "NetworkTransport.h"
+
+@interface UDPTransport : NSObject <NetworkTransport> {
+
+	/*
+	 Socket bound to the local port, and it's run loop source which calls back when a datagram arrives. The
+	 source is run by the receive thread's run loop, which stops when the source is invalidated.
+	 */
+	CFSocketRef socket;
+	CFRunLoopSourceRef runLoopSource;
+
+	/*
+	 The receive thread's run loop, and a lock whose condition is the state of the thread. stop waits for the
+	 thread to finish, so no datagram is being delivered to the delegate once it returns.
+	 */
+	CFRunLoopRef receiveRunLoop;
+	NSConditionLock *receiveThreadLock;
+
+	//Address datagrams are sent to. Datagrams from any other address are ignored.
+	struct sockaddr_in remoteAddress;
+	//The peer ID of the remote port, in the form 127.0.0.1:port.
+	NSString *remotePeerID;
+
+	//Receives the packets. Not retained.
+	id<NetworkTransportDelegate> delegate;
+
+}
+
+@property (nonatomic, readonly) NSString *remotePeerID;
+
+/*
+ Initializer method. Binds a socket to the local port which sends to the remote port. Returns nil if the
+ socket can't be created or the local port is already in use.
+ */
+- (id)initWithLocalPort:(uint16_t)localPort remotePort:(uint16_t)remotePort;
+
+@end
@@ -0,0 +1,203 @@
+//
+//  UDPTransport.m
+//  AberFighter
+//
+//  Created by wde7 on 04/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#import "UDPTransport.h"
+#import <sys/socket.h>
+#import <arpa/inet.h>
+
+/*
+ States of the receive thread, used as the conditions of the receiveThreadLock.
+ */
+enum {
+	kUDPTransportReceiveThreadStarting,
+	kUDPTransportReceiveThreadRunning,
+	kUDPTransportReceiveThreadFinished
+};
+
+@interface UDPTransport (Private)
+
+- (void)receivedData:(NSData *)data fromAddress:(NSData *)address;
+- (void)receiveWithRunLoopSource:(id)source;
+
+@end
+
+/*
+ Called by the receive thread's run loop when a datagram has been read from the socket.
+ */
+static void UDPTransportSocketCallBack(CFSocketRef socket, CFSocketCallBackType type,
+									   CFDataRef address, const void *data, void *info) {
+
+	if (type == kCFSocketDataCallBack) {
+
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		[(UDPTransport *)info receivedData:(NSData *)data fromAddress:(NSData *)address];
+		[pool release];
+
+	}
+
+}
+
+@implementation UDPTransport
+
+@synthesize remotePeerID;
+
+- (id)initWithLocalPort:(uint16_t)localPort remotePort:(uint16_t)remotePort {
+
+	if ((self = [super init])) {
+
+		delegate = nil;
+		runLoopSource = NULL;
+		receiveRunLoop = NULL;
+		receiveThreadLock = nil;
+
+		/*
+		 The transport isn't retained by the socket, it invalidates the socket before it is deallocated.
+		 */
+		CFSocketContext context = {0, self, NULL, NULL, NULL};
+		socket = CFSocketCreate(kCFAllocatorDefault, PF_INET, SOCK_DGRAM, IPPROTO_UDP,
+								kCFSocketDataCallBack, UDPTransportSocketCallBack, &context);
+
+		struct sockaddr_in localAddress;
+		memset(&localAddress, 0, sizeof(localAddress));
+		localAddress.sin_len = sizeof(localAddress);
+		localAddress.sin_family = AF_INET;
+		localAddress.sin_port = htons(localPort);
+		localAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		NSData *localAddressData = [NSData dataWithBytes:&localAddress length:sizeof(localAddress)];
+
+		if (socket == NULL || CFSocketSetAddress(socket, (CFDataRef)localAddressData) != kCFSocketSuccess) {
+
+			[self release];
+			return nil;
+
+		}
+
+		remoteAddress = localAddress;
+		remoteAddress.sin_port = htons(remotePort);
+		remotePeerID = [[NSString alloc] initWithFormat:@"127.0.0.1:%u", remotePort];
+
+	}
+
+	return self;
+
+}
+
+- (void)startWithDelegate:(id<NetworkTransportDelegate>)newDelegate {
+
+	delegate = newDelegate;
+
+	if (runLoopSource == NULL) {
+
+		/*
+		 The thread retains the source and the transport until it finishes, so neither is freed while a
+		 datagram is being delivered.
+		 */
+		runLoopSource = CFSocketCreateRunLoopSource(kCFAllocatorDefault, socket, 0);
+		receiveThreadLock = [[NSConditionLock alloc] initWithCondition:kUDPTransportReceiveThreadStarting];
+		[NSThread detachNewThreadSelector:@selector(receiveWithRunLoopSource:) toTarget:self withObject:(id)runLoopSource];
+
+	}
+
+}
+
+/*
+ The receive thread. Runs until stop invalidates the source, which leaves the run loop with nothing to run.
+ The lock tells stop when the run loop has been set up and when the thread has finished delivering datagrams.
+ */
+- (void)receiveWithRunLoopSource:(id)source {
+
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	[receiveThreadLock lock];
+	receiveRunLoop = CFRunLoopGetCurrent();
+	CFRunLoopAddSource(receiveRunLoop, (CFRunLoopSourceRef)source, kCFRunLoopDefaultMode);
+	[receiveThreadLock unlockWithCondition:kUDPTransportReceiveThreadRunning];
+
+	CFRunLoopRun();
+
+	[receiveThreadLock lock];
+	receiveRunLoop = NULL;
+	[receiveThreadLock unlockWithCondition:kUDPTransportReceiveThreadFinished];
+
+	[pool release];
+
+}
+
+- (void)receivedData:(NSData *)data fromAddress:(NSData *)address {
+
+	const struct sockaddr_in *sender = (const struct sockaddr_in *)[address bytes];
+
+	if ([address length] >= sizeof(struct sockaddr_in) &&
+		sender->sin_port == remoteAddress.sin_port &&
+		sender->sin_addr.s_addr == remoteAddress.sin_addr.s_addr) {
+
+		[delegate transport:self receivedData:data fromPeer:remotePeerID];
+
+	}
+
+}
+
+- (void)sendData:(NSData *)data toPeers:(NSArray *)peerIDs reliable:(BOOL)reliable {
+
+	if (socket != NULL) {
+
+		sendto(CFSocketGetNative(socket), [data bytes], [data length], 0,
+			   (const struct sockaddr *)&remoteAddress, sizeof(remoteAddress));
+
+	}
+
+}
+
+- (void)stop {
+
+	/*
+	 The source is invalidated once the receive thread has added it to it's run loop, and the run loop is
+	 stopped in case it is waiting for a datagram. The delegate is only cleared after the thread has finished,
+	 since until then it may be in the middle of delivering a datagram. stop therefore mustn't be called from
+	 the delegate while it is receiving data.
+	 */
+	if (runLoopSource != NULL) {
+
+		[receiveThreadLock lockWhenCondition:kUDPTransportReceiveThreadRunning];
+		CFRunLoopSourceInvalidate(runLoopSource);
+		CFRunLoopStop(receiveRunLoop);
+		[receiveThreadLock unlock];
+
+		[receiveThreadLock lockWhenCondition:kUDPTransportReceiveThreadFinished];
+		[receiveThreadLock unlock];
+
+		[receiveThreadLock release];
+		receiveThreadLock = nil;
+
+		CFRelease(runLoopSource);
+		runLoopSource = NULL;
+
+	}
+
+	delegate = nil;
+
+	if (socket != NULL) {
+
+		CFSocketInvalidate(socket);
+		CFRelease(socket);
+		socket = NULL;
+
+	}
+
+}
+
+- (void)dealloc {
+
+	[self stop];
+	[remotePeerID release];
+	[super dealloc];
+
+}
+
+@end
@@ -0,0 +1,503 @@
+//
+//  WireProtocol.c
+//  AberFighter
+//
+//  Created by wde7 on 01/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+
+#include <string.h>
+#include <math.h>
+#include "WireProtocol.h"
+
+/*
+ Number of steps a heading is divided into when stored in a byte.
+ */
+#define kWireProtocolHeadingSteps 256.0f
+
+void WireWriterInit(WireWriter *writer, uint8_t *bytes, size_t capacity) {
+
+	writer->bytes = bytes;
+	writer->capacity = capacity;
+	writer->length = 0;
+	writer->overflow = 0;
+
+}
+
+void WireReaderInit(WireReader *reader, const uint8_t *bytes, size_t length) {
+
+	reader->bytes = bytes;
+	reader->length = length;
+	reader->position = 0;
+	reader->error = 0;
+
+}
+
+size_t WireReaderRemaining(const WireReader *reader) {
+
+	return reader->error ? 0 : reader->length - reader->position;
+
+}
+
+size_t WireWriterRemaining(const WireWriter *writer) {
+
+	return writer->overflow ? 0 : writer->capacity - writer->length;
+
+}
+
+/*
+ Returns a pointer to the next length bytes of the buffer, or NULL if they don't fit.
+ */
+static uint8_t *WireWriterReserve(WireWriter *writer, size_t length) {
+
+	if (writer->overflow || (writer->capacity - writer->length) < length) {
+
+		writer->overflow = 1;
+		return NULL;
+
+	}
+
+	uint8_t *bytes = &writer->bytes[writer->length];
+	writer->length += length;
+
+	return bytes;
+
+}
+
+/*
+ Returns a pointer to the next length bytes of the packet, or NULL if the packet is too short.
+ */
+static const uint8_t *WireReaderConsume(WireReader *reader, size_t length) {
+
+	if (reader->error || (reader->length - reader->position) < length) {
+
+		reader->error = 1;
+		return NULL;
+
+	}
+
+	const uint8_t *bytes = &reader->bytes[reader->position];
+	reader->position += length;
+
+	return bytes;
+
+}
+
+void WireWriteUInt8(WireWriter *writer, uint8_t value) {
+
+	uint8_t *bytes = WireWriterReserve(writer, 1);
+
+	if (bytes != NULL) {
+		bytes[0] = value;
+	}
+
+}
+
+void WireWriteUInt16(WireWriter *writer, uint16_t value) {
+
+	uint8_t *bytes = WireWriterReserve(writer, 2);
+
+	if (bytes != NULL) {
+
+		bytes[0] = (uint8_t)(value & 0xFF);
+		bytes[1] = (uint8_t)(value >> 8);
+
+	}
+
+}
+
+void WireWriteUInt32(WireWriter *writer, uint32_t value) {
+
+	uint8_t *bytes = WireWriterReserve(writer, 4);
+
+	if (bytes != NULL) {
+
+		bytes[0] = (uint8_t)(value & 0xFF);
+		bytes[1] = (uint8_t)((value >> 8) & 0xFF);
+		bytes[2] = (uint8_t)((value >> 16) & 0xFF);
+		bytes[3] = (uint8_t)(value >> 24);
+
+	}
+
+}
+
+void WireWriteBytes(WireWriter *writer, const void *source, size_t length) {
+
+	uint8_t *bytes = WireWriterReserve(writer, length);
+
+	if (bytes != NULL && length > 0) {
+		memcpy(bytes, source, length);
+	}
+
+}
+
+void WireReaderSkip(WireReader *reader, size_t length) {
+
+	WireReaderConsume(reader, length);
+
+}
+
+uint8_t WireReadUInt8(WireReader *reader) {
+
+	const uint8_t *bytes = WireReaderConsume(reader, 1);
+
+	return (bytes != NULL) ? bytes[0] : 0;
+
+}
+
+uint16_t WireReadUInt16(WireReader *reader) {
+
+	const uint8_t *bytes = WireReaderConsume(reader, 2);
+
+	if (bytes == NULL) {
+		return 0;
+	}
+
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+
+}
+
+uint32_t WireReadUInt32(WireReader *reader) {
+
+	const uint8_t *bytes = WireReaderConsume(reader, 4);
+
+	if (bytes == NULL) {
+		return 0;
+	}
+
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+
+}
+
+void WireReadBytes(WireReader *reader, void *destination, size_t length) {
+
+	const uint8_t *bytes = WireReaderConsume(reader, length);
+
+	if (bytes != NULL && length > 0) {
+		memcpy(destination, bytes, length);
+	}
+
+}
+
+void WireWriteVarUInt(WireWriter *writer, uint32_t value) {
+
+	while (value >= 0x80) {
+
+		WireWriteUInt8(writer, (uint8_t)((value & 0x7F) | 0x80));
+		value >>= 7;
+
+	}
+
+	WireWriteUInt8(writer, (uint8_t)value);
+
+}
+
+void WireWriteVarInt(WireWriter *writer, int32_t value) {
+
+	/*
+	 Zigzag encoding maps 0, -1, 1, -2, 2... onto 0, 1, 2, 3, 4...
+	 */
+	WireWriteVarUInt(writer, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+
+}
+
+uint32_t WireReadVarUInt(WireReader *reader) {
+
+	uint32_t value = 0;
+
+	/*
+	 A 32 bit value never needs more than 5 bytes. Longer sequences are treated as corrupt.
+	 */
+	for (unsigned int shift = 0; shift < 35; shift += 7) {
+
+		uint8_t byte = WireReadUInt8(reader);
+
+		//A packet which ends part way through the value reads as 0 like any other field.
+		if (reader->error) {
+			return 0;
+		}
+
+		/*
+		 Only the lowest 4 bits of the fifth byte are left for a 32 bit value. Any above them would be lost,
+		 so the value is treated as corrupt rather than read as a different number.
+		 */
+		if (shift == 28 && (byte & 0x70) != 0) {
+			break;
+		}
+
+		value |= (uint32_t)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0) {
+			return value;
+		}
+
+	}
+
+	reader->error = 1;
+	return 0;
+
+}
+
+size_t WireVarUIntSize(uint32_t value) {
+
+	size_t size = 1;
+
+	while (value >= 0x80) {
+
+		value >>= 7;
+		size++;
+
+	}
+
+	return size;
+
+}
+
+int32_t WireReadVarInt(WireReader *reader) {
+
+	uint32_t value = WireReadVarUInt(reader);
+
+	return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+
+}
+
+int16_t WireQuantizePosition(float value) {
+
+	float scaled = roundf(value * kWireProtocolPositionScale);
+
+	/*
+	 Converting NaN or a float outside the range of the integer is undefined, so both are dealt with first.
+	 */
+	if (isnan(scaled)) {
+		return 0;
+	}
+
+	if (scaled > INT16_MAX) {
+		scaled = INT16_MAX;
+	} else if (scaled < INT16_MIN) {
+		scaled = INT16_MIN;
+	}
+
+	return (int16_t)scaled;
+
+}
+
+float WireDequantizePosition(int16_t value) {
+
+	return (float)value / kWireProtocolPositionScale;
+
+}
+
+uint8_t WireQuantizeHeading(float heading) {
+
+	/*
+	 Headings wrap around, so 360 degrees is stored as 0. Whole turns are taken off first so that the step
+	 always fits in an int. fmodf gives NaN for infinite headings.
+	 */
+	float turns = fmodf(heading / 360.0f, 1.0f);
+
+	if (isnan(turns)) {
+		return 0;
+	}
+
+	int step = (int)roundf(turns * kWireProtocolHeadingSteps);
+
+	return (uint8_t)(step & 0xFF);
+
+}
+
+float WireDequantizeHeading(uint8_t value) {
+
+	return ((float)value * 360.0f) / kWireProtocolHeadingSteps;
+
+}
+
+uint8_t WireQuantizeSpeed(float speed) {
+
+	float scaled = roundf(speed * kWireProtocolSpeedScale);
+
+	if (isnan(scaled)) {
+		return 0;
+	}
+
+	if (scaled > UINT8_MAX) {
+		scaled = UINT8_MAX;
+	} else if (scaled < 0.0f) {
+		scaled = 0.0f;
+	}
+
+	return (uint8_t)scaled;
+
+}
+
+float WireDequantizeSpeed(uint8_t value) {
+
+	return (float)value / kWireProtocolSpeedScale;
+
+}
+
+void WireWritePosition(WireWriter *writer, float value) {
+
+	WireWriteUInt16(writer, (uint16_t)WireQuantizePosition(value));
+
+}
+
+float WireReadPosition(WireReader *reader) {
+
+	return WireDequantizePosition((int16_t)WireReadUInt16(reader));
+
+}
+
+void WireWriteHeading(WireWriter *writer, float heading) {
+
+	WireWriteUInt8(writer, WireQuantizeHeading(heading));
+
+}
+
+float WireReadHeading(WireReader *reader) {
+
+	return WireDequantizeHeading(WireReadUInt8(reader));
+
+}
+
+void WireWriteSpeed(WireWriter *writer, float speed) {
+
+	WireWriteUInt8(writer, WireQuantizeSpeed(speed));
+
+}
+
+float WireReadSpeed(WireReader *reader) {
+
+	return WireDequantizeSpeed(WireReadUInt8(reader));
+
+}
+
+uint16_t WireQuantizeTime(double time) {
+
+	/*
+	 The milliseconds are wrapped while they are still a double, so that the conversion is defined however
+	 large the time is. fmod gives NaN for infinite times.
+	 */
+	double ticks = fmod(floor(time * kWireProtocolTimeScale), 65536.0);
+
+	if (isnan(ticks)) {
+		return 0;
+	}
+
+	if (ticks < 0.0) {
+		ticks += 65536.0;
+	}
+
+	return (uint16_t)ticks;
+
+}
+
+double WireDequantizeTime(uint16_t value, double reference) {
+
+	double referenceTicks = floor(reference * kWireProtocolTimeScale);
+	int16_t difference = (int16_t)(uint16_t)(value - WireQuantizeTime(reference));
+
+	return (referenceTicks + difference) / kWireProtocolTimeScale;
+
+}
+
+void WireWriteHeader(WireWriter *writer, uint8_t packetType, uint32_t packetNumber) {
+
+	WireWriteUInt8(writer, kWireProtocolVersion);
+	WireWriteUInt8(writer, packetType);
+	WireWriteVarUInt(writer, packetNumber);
+
+}
+
+int WireReadHeader(WireReader *reader, WirePacketHeader *header) {
+
+	header->version = WireReadUInt8(reader);
+
+	if (reader->error || header->version != kWireProtocolVersion) {
+		return 0;
+	}
+
+	header->packetType = WireReadUInt8(reader);
+	header->packetNumber = WireReadVarUInt(reader);
+
+	return !reader->error;
+
+}
+
+size_t WireMessageSize(size_t length) {
+
+	return 1 + WireVarUIntSize((uint32_t)length) + length;
+
+}
+
+void WireWriteMessage(WireWriter *writer, uint8_t messageType, const void *bytes, size_t length) {
+
+	WireWriteUInt8(writer, messageType);
+	WireWriteVarUInt(writer, (uint32_t)length);
+	WireWriteBytes(writer, bytes, length);
+
+}
+
+int WireReadMessage(WireReader *reader, uint8_t *messageType, WireReader *message) {
+
+	if (WireReaderRemaining(reader) == 0) {
+		return 0;
+	}
+
+	*messageType = WireReadUInt8(reader);
+	size_t length = WireReadVarUInt(reader);
+	const uint8_t *bytes = WireReaderConsume(reader, length);
+
+	if (bytes == NULL) {
+		return 0;
+	}
+
+	WireReaderInit(message, bytes, length);
+
+	return 1;
+
+}
+
+void WireWriteDirectionalInformation(WireWriter *writer, const PlayerShipDirectionalInformation *information) {
+
+	WireWriteHeading(writer, information->newHeading);
+	WireWriteSpeed(writer, information->newSpeed);
+	WireWritePosition(writer, information->currentPositionX);
+	WireWritePosition(writer, information->currentPositionY);
+	WireWriteHeading(writer, information->currentRotation);
+	WireWriteUInt16(writer, information->sendTime);
+
+}
+
+int WireReadDirectionalInformation(WireReader *reader, PlayerShipDirectionalInformation *information) {
+
+	information->newHeading = WireReadHeading(reader);
+	information->newSpeed = WireReadSpeed(reader);
+	information->currentPositionX = WireReadPosition(reader);
+	information->currentPositionY = WireReadPosition(reader);
+	information->currentRotation = WireReadHeading(reader);
+	information->sendTime = WireReadUInt16(reader);
+
+	return !reader->error;
+
+}
+
+void WireWriteProjectileDetails(WireWriter *writer, const ProjectileDetails *details) {
+
+	WireWritePosition(writer, details->startingPositionX);
+	WireWritePosition(writer, details->startingPositionY);
+	WireWritePosition(writer, details->destinationPointX);
+	WireWritePosition(writer, details->destinationPointY);
+
+}
+
+int WireReadProjectileDetails(WireReader *reader, ProjectileDetails *details) {
+
+	details->startingPositionX = WireReadPosition(reader);
+	details->startingPositionY = WireReadPosition(reader);
+	details->destinationPointX = WireReadPosition(reader);
+	details->destinationPointY = WireReadPosition(reader);
+
+	return !reader->error;
+
+}
@@ -0,0 +1,227 @@
+//
+//  WireProtocol.h
+//  AberFighter
+//
+//  Created by wde7 on 01/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The WireProtocol defines the format of the packets sent between devices by the BluetoothCommsManager.
+ Packets used to be made by copying structs straight into the packet, which meant their size and byte order
+ depended on the compiler and processor of the device. Every field is now written one byte at a time in
+ little endian order so that both devices agree on the format whatever they are running on.
+
+ Most of the traffic during a game is directional data, so fields are made as small as their use allows.
+ Positions are written as 16 bit fixed point numbers, headings and speeds as single bytes and integers as
+ variable length integers (7 bits per byte) so that small values only take one byte.
+
+ Every packet starts with a header made up of a version byte, a packet type byte and the packet number.
+ Packets with a different version are rejected, so the version must be increased whenever the format of
+ any packet changes.
+
+ Several messages can be sent in a single batch packet. Each message in the batch is made up of it's type
+ byte, the length of it's data as a variable length integer and then the data itself.
+
+ The protocol is written in plain C with no dependency on UIKit, GameKit or cocos2d.
+ */
+
+#ifndef __WIRE_PROTOCOL_H__
+#define __WIRE_PROTOCOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ Version of the packet format. Increase this whenever the format of the header or any packet changes.
+ */
+#define kWireProtocolVersion 9
+
+/*
+ Positions are multiplied by kWireProtocolPositionScale and stored as signed 16 bit integers, giving a
+ precision of 1/32 of a point and a range of -1024 to 1024 points. This covers the screen, the area just
+ offscreen where targets spawn and the longest projectile destination vector.
+ */
+#define kWireProtocolPositionScale 32.0f
+
+/*
+ Speeds are multiplied by kWireProtocolSpeedScale and stored in a byte, giving a precision of half a point
+ per second and a range of 0 to 127.5 points per second, which covers the maximum speed of a PlayerShip.
+ */
+#define kWireProtocolSpeedScale 2.0f
+
+/*
+ Times are multiplied by kWireProtocolTimeScale and stored as unsigned 16 bit integers, giving a precision of
+ a millisecond. The value wraps around every 65.536 seconds, so a time is read back as the one nearest a
+ reference time which is known to be within 32 seconds of it.
+ */
+#define kWireProtocolTimeScale 1000.0
+
+/*
+ Largest header which can be written: version, type and a 5 byte packet number.
+ */
+#define kWireProtocolMaximumHeaderSize 7
+
+/*
+ The header at the start of every packet.
+ */
+typedef struct {
+
+	uint8_t version;
+	uint8_t packetType;
+	uint32_t packetNumber;
+
+} WirePacketHeader;
+
+/*
+ Struct used for transferring Directional data across the network.
+ */
+typedef struct {
+
+	float newHeading;
+	float newSpeed;
+	float currentPositionX;
+	float currentPositionY;
+	float currentRotation;
+	//The sender's clock when the directional data was sampled, quantized with WireQuantizeTime.
+	uint16_t sendTime;
+
+} PlayerShipDirectionalInformation;
+
+/*
+ Struct used for transferring projectile firing details across the network.
+ */
+typedef struct {
+
+	float startingPositionX;
+	float startingPositionY;
+	float destinationPointX;
+	float destinationPointY;
+
+} ProjectileDetails;
+
+/*
+ Writes fields into a buffer owned by the caller. If a field doesn't fit then overflow is set and nothing
+ more is written, so a sequence of writes only needs to be checked once at the end.
+ */
+typedef struct {
+
+	uint8_t *bytes;
+	size_t capacity;
+	size_t length;
+	int overflow;
+
+} WireWriter;
+
+/*
+ Reads fields from a received packet. If a field runs past the end of the packet then error is set and
+ every following read returns 0, so a sequence of reads only needs to be checked once at the end.
+ */
+typedef struct {
+
+	const uint8_t *bytes;
+	size_t length;
+	size_t position;
+	int error;
+
+} WireReader;
+
+void WireWriterInit(WireWriter *writer, uint8_t *bytes, size_t capacity);
+void WireReaderInit(WireReader *reader, const uint8_t *bytes, size_t length);
+
+/*
+ Returns the number of unread bytes in a packet, or the number of bytes which can still be written.
+ */
+size_t WireReaderRemaining(const WireReader *reader);
+size_t WireWriterRemaining(const WireWriter *writer);
+
+/*
+ Primitive fields. Multi-byte values are little endian.
+ */
+void WireWriteUInt8(WireWriter *writer, uint8_t value);
+void WireWriteUInt16(WireWriter *writer, uint16_t value);
+void WireWriteUInt32(WireWriter *writer, uint32_t value);
+void WireWriteBytes(WireWriter *writer, const void *bytes, size_t length);
+uint8_t WireReadUInt8(WireReader *reader);
+uint16_t WireReadUInt16(WireReader *reader);
+uint32_t WireReadUInt32(WireReader *reader);
+void WireReadBytes(WireReader *reader, void *bytes, size_t length);
+void WireReaderSkip(WireReader *reader, size_t length);
+
+/*
+ Variable length integers. 7 bits of the value are written per byte, lowest first, with the top bit set
+ when more bytes follow. Signed values are zigzag encoded first so that small negative numbers are also short.
+ A value which doesn't fit in 32 bits is read as 0 with the reader's error set.
+ */
+void WireWriteVarUInt(WireWriter *writer, uint32_t value);
+void WireWriteVarInt(WireWriter *writer, int32_t value);
+uint32_t WireReadVarUInt(WireReader *reader);
+int32_t WireReadVarInt(WireReader *reader);
+
+/*
+ Number of bytes WireWriteVarUInt uses to write the value.
+ */
+size_t WireVarUIntSize(uint32_t value);
+
+/*
+ Quantized fields. Values outside the range of a field are clamped to it, and NaN is quantized as 0.
+ Positions: 16 bit fixed point. Headings: 0 to 360 degrees in 256 steps. Speeds: one byte.
+ The quantize functions return the value which the write functions write, and the dequantize functions
+ convert it back.
+ */
+int16_t WireQuantizePosition(float value);
+uint8_t WireQuantizeHeading(float heading);
+uint8_t WireQuantizeSpeed(float speed);
+float WireDequantizePosition(int16_t value);
+float WireDequantizeHeading(uint8_t value);
+float WireDequantizeSpeed(uint8_t value);
+void WireWritePosition(WireWriter *writer, float value);
+void WireWriteHeading(WireWriter *writer, float heading);
+void WireWriteSpeed(WireWriter *writer, float speed);
+float WireReadPosition(WireReader *reader);
+float WireReadHeading(WireReader *reader);
+float WireReadSpeed(WireReader *reader);
+
+/*
+ Times: 16 bits of milliseconds, wrapping around. WireDequantizeTime returns the time in seconds which the
+ value was quantized from, taking it to be the one nearest reference. NaN and infinite times are quantized as 0.
+ */
+uint16_t WireQuantizeTime(double time);
+double WireDequantizeTime(uint16_t value, double reference);
+
+/*
+ Writes the header of a packet using kWireProtocolVersion.
+ */
+void WireWriteHeader(WireWriter *writer, uint8_t packetType, uint32_t packetNumber);
+
+/*
+ Reads the header of a packet. Returns 0 if the packet is too short or was written with a different
+ version of the protocol, in which case the packet should be ignored.
+ */
+int WireReadHeader(WireReader *reader, WirePacketHeader *header);
+
+/*
+ Number of bytes a message with length bytes of data takes up in a batch packet.
+ */
+size_t WireMessageSize(size_t length);
+
+/*
+ Writes a message into a batch packet.
+ */
+void WireWriteMessage(WireWriter *writer, uint8_t messageType, const void *bytes, size_t length);
+
+/*
+ Reads the next message from a batch packet. The message reader is set up to read the data of the message
+ only. Returns 0 when there are no more messages or the rest of the batch is corrupt.
+ */
+int WireReadMessage(WireReader *reader, uint8_t *messageType, WireReader *message);
+
+void WireWriteDirectionalInformation(WireWriter *writer, const PlayerShipDirectionalInformation *information);
+void WireWriteProjectileDetails(WireWriter *writer, const ProjectileDetails *details);
+
+/*
+ Each read function returns 0 if the packet didn't contain a complete struct.
+ */
+int WireReadDirectionalInformation(WireReader *reader, PlayerShipDirectionalInformation *information);
+int WireReadProjectileDetails(WireReader *reader, ProjectileDetails *details);
+
+#endif // __WIRE_PROTOCOL_H__
@@ -62,6 +62,17 @@ enum {
 /** Allocates and initializes the action */
 +(id) action;
 
+/** Allocates the action and counts it, however it is allocated: with alloc, a copy or reusableActionOfClass:.
+ @see -[CCActionManager actionsAllocated]
+ @since v0.99.5
+ */
++(id) allocWithZone:(NSZone*)zone;
+
+/** The number of actions allocated since the application started.
+ @since v0.99.5
+ */
++(NSUInteger) numberOfActionsAllocated;
+
 /** Initializes the action */
 -(id) init;
 
@@ -82,6 +93,9 @@ enum {
 //! * 0.5 means that the action is in the middle
 //! * 1 means that the action is over
 -(void) update: (ccTime) time;
+//! called by the CCActionManager before it keeps an action given back with returnAction: to be reused.
+//! Actions that retain objects override it to release them, as dealloc does.
+-(void) prepareForReuse;
 
 @end
 
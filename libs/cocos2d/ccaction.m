@@ -36,6 +36,10 @@
 //
 #pragma mark -
 #pragma mark Action
+
+// actions are only allocated on the main thread, like every other node and action
+static NSUInteger _numberOfActionsAllocated = 0;
+
 @implementation CCAction
 
 @synthesize tag, target, originalTarget;
@@ -45,6 +49,17 @@
 	return [[[self alloc] init] autorelease];
 }
 
++(id) allocWithZone:(NSZone*)zone
+{
+	_numberOfActionsAllocated++;
+	return [super allocWithZone:zone];
+}
+
++(NSUInteger) numberOfActionsAllocated
+{
+	return _numberOfActionsAllocated;
+}
+
 -(id) init
 {
 	if( (self=[super init]) ) {	
@@ -96,6 +111,11 @@
 {
 	NSLog(@"[Action update]. override me");
 }
+
+-(void) prepareForReuse
+{
+	// target and originalTarget are not retained
+}
 @end
 
 //
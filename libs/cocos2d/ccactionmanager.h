@@ -27,19 +27,138 @@
 
 #import "CCAction.h"
 #import "Support/ccCArray.h"
-#import "Support/uthash.h"
+#import "Support/ccPointerMap.h"
 
 typedef struct _hashElement
 {
+	struct _hashElement	*prev, *next;	// every element, in the order they were added
 	struct ccArray	*actions;
 	id				target;
 	unsigned int	actionIndex;
 	CCAction		*currentAction;
 	BOOL			currentActionSalvaged;
 	BOOL			paused;	
-	UT_hash_handle	hh;
 } tHashElement;
 
+/** The types of batched action */
+typedef enum {
+	kCCBatchedActionMove,
+	kCCBatchedActionRotate,
+	kCCBatchedActionScale,
+	kCCBatchedActionFade,
+	
+	kCCBatchedActionTypes,
+} ccBatchedActionType;
+
+/** The easing of a batched action. It is worked out with the rate as CCEaseIn, CCEaseOut and CCEaseInOut do. */
+typedef enum {
+	kCCBatchedEaseNone,
+	kCCBatchedEaseIn,
+	kCCBatchedEaseOut,
+	kCCBatchedEaseInOut,
+} ccBatchedEase;
+
+/** A simple interval action which the CCActionManager steps as plain data, without an action object.
+ Create one with ccBatchedMoveTo() or one of the functions below it.
+ @since v0.99.5
+ */
+typedef struct _ccBatchedAction
+{
+	ccBatchedActionType	type;
+	ccTime				duration;
+	CGPoint				value;		// the position, the angle or opacity in x, or the scales in x and y
+	BOOL				relative;	// YES to add the value to the target's, or multiply for scales, as the "By" actions do
+	BOOL				hasFrom;	// YES to start from 'from' instead of the target's value, as CCFadeIn and CCFadeOut do
+	CGPoint				from;
+	ccBatchedEase		ease;
+	float				rate;
+	id					callbackTarget;		// sent callbackSelector with the node when the action finishes, as CCCallFuncN does. May be nil.
+	SEL					callbackSelector;
+} ccBatchedAction;
+
+/** Returns a batched action of the type, with no easing or callback */
+static inline ccBatchedAction ccBatchedActionMake(ccBatchedActionType type, ccTime d, CGPoint value, BOOL relative)
+{
+	ccBatchedAction action = { type, d, value, relative, NO, CGPointZero, kCCBatchedEaseNone, 1, nil, NULL };
+	return action;
+}
+
+/** Returns a batched action which moves to a position, like CCMoveTo */
+static inline ccBatchedAction ccBatchedMoveTo(ccTime d, CGPoint position)
+{
+	return ccBatchedActionMake(kCCBatchedActionMove, d, position, NO);
+}
+
+/** Returns a batched action which moves by a distance, like CCMoveBy */
+static inline ccBatchedAction ccBatchedMoveBy(ccTime d, CGPoint delta)
+{
+	return ccBatchedActionMake(kCCBatchedActionMove, d, delta, YES);
+}
+
+/** Returns a batched action which rotates the shortest way to an angle, like CCRotateTo */
+static inline ccBatchedAction ccBatchedRotateTo(ccTime d, float angle)
+{
+	return ccBatchedActionMake(kCCBatchedActionRotate, d, CGPointMake(angle, 0), NO);
+}
+
+/** Returns a batched action which rotates by an angle, like CCRotateBy */
+static inline ccBatchedAction ccBatchedRotateBy(ccTime d, float angle)
+{
+	return ccBatchedActionMake(kCCBatchedActionRotate, d, CGPointMake(angle, 0), YES);
+}
+
+/** Returns a batched action which scales to sx and sy, like CCScaleTo */
+static inline ccBatchedAction ccBatchedScaleTo(ccTime d, float sx, float sy)
+{
+	return ccBatchedActionMake(kCCBatchedActionScale, d, CGPointMake(sx, sy), NO);
+}
+
+/** Returns a batched action which multiplies the scales by sx and sy, like CCScaleBy */
+static inline ccBatchedAction ccBatchedScaleBy(ccTime d, float sx, float sy)
+{
+	return ccBatchedActionMake(kCCBatchedActionScale, d, CGPointMake(sx, sy), YES);
+}
+
+/** Returns a batched action which fades to an opacity, like CCFadeTo */
+static inline ccBatchedAction ccBatchedFadeTo(ccTime d, GLubyte opacity)
+{
+	return ccBatchedActionMake(kCCBatchedActionFade, d, CGPointMake(opacity, 0), NO);
+}
+
+/** Returns a batched action which fades from 0 to 255, like CCFadeIn */
+static inline ccBatchedAction ccBatchedFadeIn(ccTime d)
+{
+	ccBatchedAction action = ccBatchedFadeTo(d, 255);
+	action.hasFrom = YES;
+	action.from = CGPointZero;
+	return action;
+}
+
+/** Returns a batched action which fades from 255 to 0, like CCFadeOut */
+static inline ccBatchedAction ccBatchedFadeOut(ccTime d)
+{
+	ccBatchedAction action = ccBatchedFadeTo(d, 0);
+	action.hasFrom = YES;
+	action.from = CGPointMake(255, 0);
+	return action;
+}
+
+/** Returns the action eased with the rate */
+static inline ccBatchedAction ccBatchedActionEase(ccBatchedAction action, ccBatchedEase ease, float rate)
+{
+	action.ease = ease;
+	action.rate = rate;
+	return action;
+}
+
+/** Returns the action with a callback, which is sent to t with the node once the action has finished */
+static inline ccBatchedAction ccBatchedActionCall(ccBatchedAction action, id t, SEL s)
+{
+	action.callbackTarget = t;
+	action.callbackSelector = s;
+	return action;
+}
+
 
 /** CCActionManager is a singleton that manages all the actions.
  Normally you won't need to use this singleton directly. 99% of the cases you will use the CCNode interface,
@@ -53,11 +172,31 @@ typedef struct _hashElement
  */
 @interface CCActionManager : NSObject {
 
-	tHashElement	*targets;
+	tHashElement	*targets;		// list of the elements in hashForTargets
+	ccPointerMap	*hashForTargets;
 	tHashElement	*currentTarget;
 	BOOL			currentTargetSalvaged;
+	
+	ccPointerMap	*freeActions;		// a ccCArray of actions ready to be reused for each class
+	ccCArray		*returnedActions;	// actions given back since the last update, not reused until the next one
+	NSUInteger		actionsReused;
+	
+	struct _batchedActionArray	*batchedActions;	// an array for each ccBatchedActionType, then one for the finished actions
+	ccPointerMap				*batchedTargets;	// the number of batched actions of each target
 }
 
+/** The number of actions allocated by any means: with +alloc, +action and the other constructors, copies, and by
+ reusableActionOfClass: when no action of the class had been given back. It is counted by +[CCAction allocWithZone:].
+ Once a game is running it should stop changing: sample it each frame to check that no actions are allocated.
+ @since v0.99.5
+ */
+@property (nonatomic,readonly) NSUInteger actionsAllocated;
+
+/** The number of actions that reusableActionOfClass: reused instead of allocating.
+ @since v0.99.5
+ */
+@property (nonatomic,readonly) NSUInteger actionsReused;
+
 /** returns a shared instance of the CCActionManager */
 + (CCActionManager *)sharedManager;
 
@@ -113,6 +252,44 @@ typedef struct _hashElement
  */
 -(void) pauseAllActionsForTarget:(id)target DEPRECATED_ATTRIBUTE;
 
+// reuse
+
+/** Returns an action of the class that hasn't been initialized yet, as +alloc does: one that was given back with
+ returnAction:, with its instance variables cleared, or a newly allocated one. Initialize it with one of the class'
+ init methods. Only actions obtained this way and given back explicitly are ever reused.
+ Reused actions are counted in actionsReused, newly allocated ones in actionsAllocated.
+ Example:
+	CCFadeOut *fade = [[[CCActionManager sharedManager] reusableActionOfClass:[CCFadeOut class]] initWithDuration:1];
+ @since v0.99.5
+ */
+-(id) reusableActionOfClass:(Class)actionClass;
+
+/** Gives back a finished action so that reusableActionOfClass: can hand it out again, taking over the caller's reference.
+ IMPORTANT: only give back an action that nothing else uses or will use, since its instance variables are cleared.
+ Giving back a CCSequence or CCSpawn gives back the actions it is made of too.
+ The action is kept as it is until the next update, so an action can be given back by its own callback.
+ Up to CC_ACTION_POOL_SIZE actions of each class are kept, any others are released.
+ @since v0.99.5
+ */
+-(void) returnAction:(CCAction*)action;
+
+// batched actions
+
+/** Adds a batched action with a target, which must be a CCNode, and implement CCRGBAProtocol for fades.
+ The batched actions of each type are kept together in an array of plain structs and stepped in one loop after the
+ other actions, setting the target's property through a cached IMP, so hundreds of moves and fades cost little more
+ than their arithmetic. The callbacks of the actions which finish are called together once every type has been stepped.
+ Batched actions are paused, resumed and removed with the target's other actions, but they have no tag and
+ aren't counted by numberOfRunningActionsInTarget:.
+ @since v0.99.5
+ */
+-(void) addBatchedAction:(ccBatchedAction)action target:(id)target paused:(BOOL)paused;
+
+/** Returns the number of batched actions running in a target
+ @since v0.99.5
+ */
+-(NSUInteger) numberOfBatchedActionsInTarget:(id)target;
+
 
 @end
 
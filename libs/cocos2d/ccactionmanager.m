@@ -25,9 +25,18 @@
  */
 
 
+#import <objc/runtime.h>
+
 #import "CCActionManager.h"
 #import "CCScheduler.h"
+#import "CCIntervalAction.h"
+#import "CCInstantAction.h"
+#import "CCNode.h"
+#import "CCProtocols.h"
+#import "ccConfig.h"
 #import "ccMacros.h"
+#import "Support/utlist.h"
+#import "Support/CGPointExtension.h"
 
 
 //
@@ -35,15 +44,144 @@
 //
 static CCActionManager *_sharedManager = nil;
 
+//
+// batched actions
+//
+typedef struct _batchedActionEntry
+{
+	id				target;				// retained
+	IMP				set, setY;			// the target's setter, and setScaleY: for scales
+	ccTime			elapsed, duration;
+	BOOL			firstTick, paused;
+	ccBatchedEase	ease;
+	float			rate;
+	CGPoint			start, delta;
+	id				callbackTarget;		// retained
+	SEL				callbackSelector;
+} tBatchedActionEntry;
+
+typedef struct _batchedActionArray
+{
+	tBatchedActionEntry	*arr;
+	NSUInteger			num, max;
+} tBatchedActionArray;
+
+typedef void (*CC_SET_POINT)(id, SEL, CGPoint);
+typedef void (*CC_SET_FLOAT)(id, SEL, float);
+typedef void (*CC_SET_OPACITY)(id, SEL, GLubyte);
+
+static inline tBatchedActionEntry* batchedActionArrayAppend(tBatchedActionArray *array)
+{
+	if( array->num == array->max ) {
+		array->max = array->max ? array->max * 2 : 16;
+		array->arr = realloc( array->arr, array->max * sizeof(tBatchedActionEntry) );
+	}
+	return &array->arr[array->num++];
+}
+
+static inline void batchedTargetsAdd(ccPointerMap *batchedTargets, id target, NSInteger n)
+{
+	uintptr_t count = (uintptr_t)ccPointerMapGet(batchedTargets, target) + n;
+	if( count )
+		ccPointerMapSet(batchedTargets, target, (void*)count);
+	else
+		ccPointerMapRemove(batchedTargets, target);
+}
+
+// steps the entry as CCIntervalAction does, and returns it's eased progress
+static inline float batchedActionProgress(tBatchedActionEntry *entry, ccTime dt)
+{
+	if( entry->firstTick ) {
+		entry->firstTick = NO;
+		entry->elapsed = 0;
+	} else
+		entry->elapsed += dt;
+	
+	float t = MIN(1, entry->elapsed/entry->duration);
+	
+	switch( entry->ease ) {
+		case kCCBatchedEaseIn:
+			return powf(t, entry->rate);
+		case kCCBatchedEaseOut:
+			return powf(t, 1/entry->rate);
+		case kCCBatchedEaseInOut:
+			t *= 2;
+			return t < 1 ? 0.5f * powf(t, entry->rate) : 1 - 0.5f * powf(2 - t, entry->rate);
+		default:
+			return t;
+	}
+}
+
+static void stepBatchedMoves(tBatchedActionArray *array, ccTime dt)
+{
+	for( NSUInteger i = 0; i < array->num; i++ ) {
+		tBatchedActionEntry *entry = &array->arr[i];
+		if( entry->paused )
+			continue;
+		
+		float t = batchedActionProgress(entry, dt);
+		((CC_SET_POINT)entry->set)(entry->target, @selector(setPosition:), ccpAdd(entry->start, ccpMult(entry->delta, t)));
+	}
+}
+
+static void stepBatchedRotations(tBatchedActionArray *array, ccTime dt)
+{
+	for( NSUInteger i = 0; i < array->num; i++ ) {
+		tBatchedActionEntry *entry = &array->arr[i];
+		if( entry->paused )
+			continue;
+		
+		float t = batchedActionProgress(entry, dt);
+		((CC_SET_FLOAT)entry->set)(entry->target, @selector(setRotation:), entry->start.x + entry->delta.x * t);
+	}
+}
+
+static void stepBatchedScales(tBatchedActionArray *array, ccTime dt)
+{
+	for( NSUInteger i = 0; i < array->num; i++ ) {
+		tBatchedActionEntry *entry = &array->arr[i];
+		if( entry->paused )
+			continue;
+		
+		float t = batchedActionProgress(entry, dt);
+		((CC_SET_FLOAT)entry->set)(entry->target, @selector(setScaleX:), entry->start.x + entry->delta.x * t);
+		((CC_SET_FLOAT)entry->setY)(entry->target, @selector(setScaleY:), entry->start.y + entry->delta.y * t);
+	}
+}
+
+static void stepBatchedFades(tBatchedActionArray *array, ccTime dt)
+{
+	for( NSUInteger i = 0; i < array->num; i++ ) {
+		tBatchedActionEntry *entry = &array->arr[i];
+		if( entry->paused )
+			continue;
+		
+		float t = batchedActionProgress(entry, dt);
+		((CC_SET_OPACITY)entry->set)(entry->target, @selector(setOpacity:), (GLubyte)(entry->start.x + entry->delta.x * t));
+	}
+}
+
 @interface CCActionManager (Private)
 -(void) removeActionAtIndex:(NSUInteger)index hashElement:(tHashElement*)element;
 -(void) deleteHashElement:(tHashElement*)element;
 -(void) actionAllocWithHashElement:(tHashElement*)element;
+-(void) removeBatchedActionsFromTarget:(id)target;
+-(void) pauseBatchedActionsOfTarget:(id)target paused:(BOOL)paused;
+-(void) collectFinishedBatchedActions:(tBatchedActionArray*)array;
+-(void) stepBatchedActions:(ccTime)dt;
+-(void) reuseReturnedActions;
 @end
 
 
 @implementation CCActionManager
 
+@synthesize actionsReused;
+
+-(NSUInteger) actionsAllocated
+{
+	return [CCAction numberOfActionsAllocated];
+}
+
 #pragma mark ActionManager - init
 + (CCActionManager *)sharedManager
 {
@@ -70,6 +208,11 @@ static CCActionManager *_sharedManager = nil;
 	if ((self=[super init]) ) {
 		[[CCScheduler sharedScheduler] scheduleUpdateForTarget:self priority:0 paused:NO];
 		targets = NULL;
+		hashForTargets = ccPointerMapNew(64);
+		freeActions = ccPointerMapNew(32);
+		returnedActions = ccCArrayNew(16);
+		batchedActions = calloc( kCCBatchedActionTypes + 1, sizeof(tBatchedActionArray) );
+		batchedTargets = ccPointerMapNew(64);
 	}
 	
 	return self;
@@ -80,6 +223,29 @@ static CCActionManager *_sharedManager = nil;
 	CCLOGINFO( @"cocos2d: deallocing %@", self);
 	
 	[self removeAllActions];
+	ccPointerMapFree(hashForTargets);
+	
+	for( int type = 0; type <= kCCBatchedActionTypes; type++ )
+		free(batchedActions[type].arr);
+	free(batchedActions);
+	ccPointerMapFree(batchedTargets);
+	
+	// the actions given back since the last update haven't been cleared yet
+	for( NSUInteger i = 0; i < returnedActions->num; i++ )
+		[returnedActions->arr[i] release];
+	ccCArrayFree(returnedActions);
+	
+	for( size_t i = 0; i < freeActions->capacity; i++ ) {
+		ccCArray *freeList = freeActions->entries[i].value;
+		if( freeActions->entries[i].key == NULL )
+			continue;
+		
+		// the actions were cleared when they were kept, so there is nothing for their dealloc to release
+		for( NSUInteger j = 0; j < freeList->num; j++ )
+			[freeList->arr[j] release];
+		ccCArrayFree(freeList);
+	}
+	ccPointerMapFree(freeActions);
 
 	_sharedManager = nil;
 
@@ -91,8 +257,8 @@ static CCActionManager *_sharedManager = nil;
 -(void) deleteHashElement:(tHashElement*)element
 {
 	ccArrayFree(element->actions);
-	HASH_DEL(targets, element);
-//	CCLOG(@"cocos2d: ---- buckets: %d/%d - %@", targets->entries, targets->size, element->target);
+	ccPointerMapRemove(hashForTargets, element->target);
+	DL_DELETE(targets, element);
 	[element->target release];
 	free(element);
 }
@@ -139,10 +305,10 @@ static CCActionManager *_sharedManager = nil;
 
 -(void) pauseTarget:(id)target
 {
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	if( element )
 		element->paused = YES;
+	[self pauseBatchedActionsOfTarget:target paused:YES];
 //	else
 //		CCLOG(@"cocos2d: pauseAllActions: Target not found");
 }
@@ -155,10 +321,10 @@ static CCActionManager *_sharedManager = nil;
 
 -(void) resumeTarget:(id)target
 {
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	if( element )
 		element->paused = NO;
+	[self pauseBatchedActionsOfTarget:target paused:NO];
 //	else
 //		CCLOG(@"cocos2d: resumeAllActions: Target not found");
 }
@@ -170,14 +336,13 @@ static CCActionManager *_sharedManager = nil;
 	NSAssert( action != nil, @"Argument action must be non-nil");
 	NSAssert( target != nil, @"Argument target must be non-nil");	
 	
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	if( ! element ) {
 		element = calloc( sizeof( *element ), 1 );
 		element->paused = paused;
 		element->target = [target retain];
-		HASH_ADD_INT(targets, target, element);
-//		CCLOG(@"cocos2d: ---- buckets: %d/%d - %@", targets->entries, targets->size, element->target);
+		ccPointerMapSet(hashForTargets, target, element);
+		DL_APPEND(targets, element);
 
 	}
 	
@@ -195,9 +360,14 @@ static CCActionManager *_sharedManager = nil;
 {
 	for(tHashElement *element=targets; element != NULL; ) {	
 		id target = element->target;
-		element=element->hh.next;
+		element=element->next;
 		[self removeAllActionsFromTarget:target];
 	}
+	
+	for( int type = 0; type < kCCBatchedActionTypes; type++ ) {
+		while( batchedActions[type].num )
+			[self removeBatchedActionsFromTarget:batchedActions[type].arr[0].target];
+	}
 }
 -(void) removeAllActionsFromTarget:(id)target
 {
@@ -205,8 +375,9 @@ static CCActionManager *_sharedManager = nil;
 	if( target == nil )
 		return;
 	
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	[self removeBatchedActionsFromTarget:target];
+	
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	if( element ) {
 		if( ccArrayContainsObject(element->actions, element->currentAction) && !element->currentActionSalvaged ) {
 			[element->currentAction retain];
@@ -228,9 +399,8 @@ static CCActionManager *_sharedManager = nil;
 	if (action == nil)
 		return;
 	
-	tHashElement *element = NULL;
 	id target = [action originalTarget];
-	HASH_FIND_INT(targets, &target, element );
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	if( element ) {
 		NSUInteger i = ccArrayGetIndexOfObject(element->actions, action);
 		if( i != NSNotFound ) {
@@ -247,8 +417,7 @@ static CCActionManager *_sharedManager = nil;
 	NSAssert( aTag != kCCActionTagInvalid, @"Invalid tag");
 	NSAssert( target != nil, @"Target should be ! nil");
 	
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	
 	if( element ) {
 		NSUInteger limit = element->actions->num;
@@ -270,8 +439,7 @@ static CCActionManager *_sharedManager = nil;
 {
 	NSAssert( aTag != kCCActionTagInvalid, @"Invalid tag");
 
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 
 	if( element ) {
 		if( element->actions != nil ) {
@@ -292,8 +460,7 @@ static CCActionManager *_sharedManager = nil;
 
 -(int) numberOfRunningActionsInTarget:(id) target
 {
-	tHashElement *element = NULL;
-	HASH_FIND_INT(targets, &target, element);
+	tHashElement *element = ccPointerMapGet(hashForTargets, target);
 	if( element )
 		return element->actions ? element->actions->num : 0;
 
@@ -301,10 +468,219 @@ static CCActionManager *_sharedManager = nil;
 	return 0;
 }
 
+#pragma mark ActionManager - reuse
+
+-(id) reusableActionOfClass:(Class)actionClass
+{
+	NSAssert( [actionClass isSubclassOfClass:[CCAction class]], @"Only actions can be reused");
+	
+	ccCArray *freeList = ccPointerMapGet(freeActions, actionClass);
+	
+	// counted in actionsAllocated by +[CCAction allocWithZone:]
+	if( freeList == NULL || freeList->num == 0 )
+		return [actionClass alloc];
+	
+	actionsReused++;
+	return freeList->arr[--freeList->num];
+}
+
+-(void) returnAction:(CCAction*)action
+{
+	NSAssert( [action isKindOfClass:[CCAction class]], @"Only actions can be reused");
+	
+	ccCArrayAppendValueWithResize(returnedActions, action);
+}
+
+// Called at the start of each update. The actions given back during the last one, perhaps by their own
+// callbacks, have been removed from their targets since, so they can be cleared and kept.
+-(void) reuseReturnedActions
+{
+	// sequences and spawns give back their actions as they are cleared, which adds them to the end of the list
+	for( NSUInteger i = 0; i < returnedActions->num; i++ ) {
+		CCAction *action = returnedActions->arr[i];
+		Class actionClass = [action class];
+		ccCArray *freeList = ccPointerMapGet(freeActions, actionClass);
+		
+		if( ! freeList ) {
+			freeList = ccCArrayNew(CC_ACTION_POOL_SIZE);
+			ccPointerMapSet(freeActions, actionClass, freeList);
+		}
+		
+		if( freeList->num >= CC_ACTION_POOL_SIZE ) {
+			[action release];
+			continue;
+		}
+		
+		[action prepareForReuse];
+		memset( (char*)action + sizeof(Class), 0, class_getInstanceSize(actionClass) - sizeof(Class) );
+		ccCArrayAppendValue(freeList, action);
+	}
+	
+	ccCArrayRemoveAllValues(returnedActions);
+}
+
+#pragma mark ActionManager - batched actions
+
+-(void) addBatchedAction:(ccBatchedAction)action target:(id)target paused:(BOOL)paused
+{
+	NSAssert( target != nil, @"Argument target must be non-nil");
+	NSAssert( action.type >= 0 && action.type < kCCBatchedActionTypes, @"Invalid batched action type");
+	
+	CCNode *node = target;
+	CGPoint current;
+	tBatchedActionEntry *entry = batchedActionArrayAppend(&batchedActions[action.type]);
+	
+	entry->target = [target retain];
+	entry->setY = NULL;
+	entry->elapsed = 0;
+	entry->duration = action.duration == 0 ? FLT_EPSILON : action.duration;
+	entry->firstTick = YES;
+	entry->paused = paused;
+	entry->ease = action.ease;
+	entry->rate = action.rate;
+	entry->callbackTarget = [action.callbackTarget retain];
+	entry->callbackSelector = action.callbackSelector;
+	
+	switch( action.type ) {
+		case kCCBatchedActionMove:
+			entry->set = [node methodForSelector:@selector(setPosition:)];
+			current = node.position;
+			break;
+		case kCCBatchedActionRotate:
+			entry->set = [node methodForSelector:@selector(setRotation:)];
+			current = ccp(node.rotation, 0);
+			break;
+		case kCCBatchedActionScale:
+			entry->set = [node methodForSelector:@selector(setScaleX:)];
+			entry->setY = [node methodForSelector:@selector(setScaleY:)];
+			current = ccp(node.scaleX, node.scaleY);
+			break;
+		default:
+			NSAssert( [target conformsToProtocol:@protocol(CCRGBAProtocol)], @"Fades need a target which implements CCRGBAProtocol");
+			entry->set = [node methodForSelector:@selector(setOpacity:)];
+			current = ccp([(id<CCRGBAProtocol>)target opacity], 0);
+			break;
+	}
+	
+	entry->start = action.hasFrom ? action.from : current;
+	
+	if( ! action.relative )
+		entry->delta = ccpSub(action.value, entry->start);
+	else if( action.type == kCCBatchedActionScale )
+		entry->delta = ccp(entry->start.x * action.value.x - entry->start.x, entry->start.y * action.value.y - entry->start.y);
+	else
+		entry->delta = action.value;
+	
+	// turn the shortest way, as CCRotateTo does
+	if( action.type == kCCBatchedActionRotate && ! action.relative ) {
+		entry->start.x = fmodf(entry->start.x, 360.0f);
+		entry->delta.x = action.value.x - entry->start.x;
+		if( entry->delta.x > 180 )
+			entry->delta.x -= 360;
+		if( entry->delta.x < -180 )
+			entry->delta.x += 360;
+	}
+	
+	batchedTargetsAdd(batchedTargets, target, 1);
+}
+
+-(NSUInteger) numberOfBatchedActionsInTarget:(id)target
+{
+	return (uintptr_t)ccPointerMapGet(batchedTargets, target);
+}
+
+-(void) removeBatchedActionsFromTarget:(id)target
+{
+	if( ! ccPointerMapRemove(batchedTargets, target) )
+		return;
+	
+	// the target is released once it's entries are gone, in case it is deallocated
+	[target retain];
+	for( int type = 0; type < kCCBatchedActionTypes; type++ ) {
+		tBatchedActionArray *array = &batchedActions[type];
+		NSUInteger kept = 0;
+		
+		for( NSUInteger i = 0; i < array->num; i++ ) {
+			tBatchedActionEntry *entry = &array->arr[i];
+			
+			if( entry->target != target )
+				array->arr[kept++] = *entry;
+			else {
+				[entry->callbackTarget release];
+				[entry->target release];
+			}
+		}
+		array->num = kept;
+	}
+	[target release];
+}
+
+-(void) pauseBatchedActionsOfTarget:(id)target paused:(BOOL)paused
+{
+	if( ! ccPointerMapGet(batchedTargets, target) )
+		return;
+	
+	for( int type = 0; type < kCCBatchedActionTypes; type++ ) {
+		tBatchedActionArray *array = &batchedActions[type];
+		for( NSUInteger i = 0; i < array->num; i++ ) {
+			if( array->arr[i].target == target )
+				array->arr[i].paused = paused;
+		}
+	}
+}
+
+// moves the finished entries of the array to the finished array, keeping the others in order
+-(void) collectFinishedBatchedActions:(tBatchedActionArray*)array
+{
+	tBatchedActionArray *finished = &batchedActions[kCCBatchedActionTypes];
+	NSUInteger kept = 0;
+	
+	for( NSUInteger i = 0; i < array->num; i++ ) {
+		tBatchedActionEntry *entry = &array->arr[i];
+		
+		if( entry->paused || entry->elapsed < entry->duration )
+			array->arr[kept++] = *entry;
+		else {
+			*batchedActionArrayAppend(finished) = *entry;
+			batchedTargetsAdd(batchedTargets, entry->target, -1);
+		}
+	}
+	array->num = kept;
+}
+
+-(void) stepBatchedActions:(ccTime)dt
+{
+	stepBatchedMoves(&batchedActions[kCCBatchedActionMove], dt);
+	stepBatchedRotations(&batchedActions[kCCBatchedActionRotate], dt);
+	stepBatchedScales(&batchedActions[kCCBatchedActionScale], dt);
+	stepBatchedFades(&batchedActions[kCCBatchedActionFade], dt);
+	
+	for( int type = 0; type < kCCBatchedActionTypes; type++ )
+		[self collectFinishedBatchedActions:&batchedActions[type]];
+	
+	// The callbacks may add and remove actions, so they are only called once every array has been stepped.
+	// The finished entries still retain their targets, so a callback can remove it's node safely.
+	tBatchedActionArray *finished = &batchedActions[kCCBatchedActionTypes];
+	
+	for( NSUInteger i = 0; i < finished->num; i++ ) {
+		tBatchedActionEntry *entry = &finished->arr[i];
+		[entry->callbackTarget performSelector:entry->callbackSelector withObject:entry->target];
+	}
+	
+	for( NSUInteger i = 0; i < finished->num; i++ ) {
+		tBatchedActionEntry *entry = &finished->arr[i];
+		[entry->callbackTarget release];
+		[entry->target release];
+	}
+	finished->num = 0;
+}
+
 #pragma mark ActionManager - main loop
 
 -(void) update: (ccTime) dt
 {
+	[self reuseReturnedActions];
+	
 	for(tHashElement *elt=targets; elt != NULL; ) {	
 
 		currentTarget = elt;
@@ -340,7 +716,7 @@ static CCActionManager *_sharedManager = nil;
 
 		// elt, at this moment, is still valid
 		// so it is safe to ask this here (issue #490)
-		elt=elt->hh.next;
+		elt=elt->next;
 	
 		// only delete currentTarget if no actions were scheduled during the cycle (issue #481)
 		if( currentTargetSalvaged && currentTarget->actions->num == 0 )
@@ -349,5 +725,7 @@ static CCActionManager *_sharedManager = nil;
 	
 	// issue #635
 	currentTarget = nil;
+	
+	[self stepBatchedActions:dt];
 }
 @end
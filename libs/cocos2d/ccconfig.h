@@ -159,6 +159,14 @@
  */
 #define CC_LABELATLAS_DEBUG_DRAW 0
 
+/** @def CC_ACTION_POOL_SIZE
+ The number of actions of each class that the CCActionManager keeps after they are given back with returnAction:,
+ so that reusableActionOfClass: can hand them out again instead of allocating.
+ 
+ To disable reusing actions set it to 0. 32 by default.
+ */
+#define CC_ACTION_POOL_SIZE 32
+
 /** @def CC_ENABLE_PROFILERS
  If enabled, will activate various profilers withing cocos2d. This statistical data will be output to the console
  once per second showing average time (in milliseconds) required to execute the specific routine(s).
@@ -249,6 +249,12 @@
 	[super dealloc];
 }
 
+-(void) prepareForReuse
+{
+	[targetCallback release];
+	[super prepareForReuse];
+}
+
 -(id) copyWithZone: (NSZone*) zone
 {
 	CCInstantAction *copy = [[[self class] allocWithZone: zone] initWithTarget:targetCallback selector:selector];
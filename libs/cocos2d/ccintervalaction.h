@@ -77,6 +77,12 @@ Example:
 +(id) actions: (CCFiniteTimeAction*) action1, ... NS_REQUIRES_NIL_TERMINATION;
 /** creates the action */
 +(id) actionOne:(CCFiniteTimeAction*)actionOne two:(CCFiniteTimeAction*)actionTwo;
+/** creates the most common sequence: the action followed by a CCCallFuncN which calls the selector on t with the node.
+ The sequence and the CCCallFuncN are taken from -[CCActionManager reusableActionOfClass:], so once the sequence has been
+ given back with returnAction: running it again doesn't allocate. Take the action from the pool too to allocate nothing.
+ @since v0.99.5
+ */
++(id) actionOne:(CCFiniteTimeAction*)action thenCallTarget:(id)t selector:(SEL)s;
 /** initializes the action */
 -(id) initOne:(CCFiniteTimeAction*)actionOne two:(CCFiniteTimeAction*)actionTwo;
 @end
@@ -26,6 +26,8 @@
 
 
 #import "CCIntervalAction.h"
+#import "CCActionManager.h"
+#import "CCInstantAction.h"
 #import "CCSprite.h"
 #import "CCSpriteFrame.h"
 #import "CCNode.h"
@@ -122,6 +124,15 @@
 	return [[[self alloc] initOne:one two:two ] autorelease];
 }
 
++(id) actionOne: (CCFiniteTimeAction*) action thenCallTarget:(id) t selector:(SEL) s
+{
+	CCActionManager *manager = [CCActionManager sharedManager];
+	CCCallFuncN *call = [[manager reusableActionOfClass:[CCCallFuncN class]] initWithTarget:t selector:s];
+	CCSequence *sequence = [[manager reusableActionOfClass:self] initOne:action two:call];
+	[call release];
+	return [sequence autorelease];
+}
+
 +(id) actions: (CCFiniteTimeAction*) action1, ...
 {
 	va_list params;
@@ -171,6 +182,14 @@
 	[super dealloc];
 }
 
+-(void) prepareForReuse
+{
+	CCActionManager *manager = [CCActionManager sharedManager];
+	[manager returnAction:actions[0]];
+	[manager returnAction:actions[1]];
+	[super prepareForReuse];
+}
+
 -(void) startWithTarget:(id)aTarget
 {
 	[super startWithTarget:aTarget];	
@@ -390,6 +409,14 @@
 	[super dealloc];
 }
 
+-(void) prepareForReuse
+{
+	CCActionManager *manager = [CCActionManager sharedManager];
+	[manager returnAction:one];
+	[manager returnAction:two];
+	[super prepareForReuse];
+}
+
 -(void) startWithTarget:(id)aTarget
 {
 	[super startWithTarget:aTarget];
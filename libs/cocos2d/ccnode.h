@@ -27,6 +27,7 @@
 #import <OpenGLES/ES1/gl.h>
 
 #import "CCAction.h"
+#import "CCActionManager.h"
 #import "ccTypes.h"
 #import "CCTexture2D.h"
 #import "CCProtocols.h"
@@ -359,6 +360,11 @@ enum {
  @return An Action pointer
  */
 -(CCAction*) runAction: (CCAction*) action;
+/** Executes a batched action. The node becomes the action's target.
+ @see -[CCActionManager addBatchedAction:target:paused:]
+ @since v0.99.5
+ */
+-(void) runBatchedAction: (ccBatchedAction) action;
 /** Removes all actions from the running action list */
 -(void) stopAllActions;
 /** Removes an action from the running action list */
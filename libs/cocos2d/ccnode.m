@@ -607,6 +607,11 @@
 	return action;
 }
 
+-(void) runBatchedAction:(ccBatchedAction) action
+{
+	[[CCActionManager sharedManager] addBatchedAction:action target:self paused:!isRunning_];
+}
+
 -(void) stopAllActions
 {
 	[[CCActionManager sharedManager] removeAllActionsFromTarget:self];
@@ -24,7 +24,8 @@
 
 
 #import <Foundation/Foundation.h>
-#import "Support/uthash.h"
+#import "Support/ccPointerMap.h"
+#import "Support/ccTimerHeap.h"
 
 #import "ccTypes.h"
 
@@ -37,14 +38,20 @@ typedef void (*TICK_IMP)(id, SEL, ccTime);
 /** Light weight timer */
 @interface CCTimer : NSObject
 {
+@public					// optimization
 	id target;
 	TICK_IMP impMethod;
 	
+	// -1 until the timer has started. While the target is paused, the time since it last fired.
 	ccTime elapsed;
 
-@public					// optimization
 	ccTime interval;
 	SEL selector;
+	
+	// Used by the CCScheduler: where the timer is kept, the time it last fired and the tick it was scheduled in
+	int		heapIndex;
+	double	startTime;
+	unsigned int startTick;
 }
 
 /** interval in seconds */
@@ -102,15 +109,24 @@ struct _hashUpdateEntry;
 	struct _listEntry			*updatesNeg;	// list of priority < 0
 	struct _listEntry			*updates0;		// list priority == 0
 	struct _listEntry			*updatesPos;	// list priority > 0
-	struct _hashUpdateEntry		*hashForUpdates;	// hash used to fetch quickly the list entries for pause,delete,etc.
+	ccPointerMap				*hashForUpdates;	// hash used to fetch quickly the list entries for pause,delete,etc.
 		
 	// Used for "selectors with interval"
-	struct _hashSelectorEntry	*hashForSelectors;
+	ccPointerMap				*hashForSelectors;
+	struct _hashSelectorEntry	*selectorTargets;	// list of the entries in hashForSelectors
 	struct _hashSelectorEntry	*currentTarget;
 	BOOL						currentTargetSalvaged;
+	CCTimer						*currentTimer;
+	BOOL						currentTimerSalvaged;
+	
+	// The running timers, in a min-heap ordered by the time they are next due, so that each tick only
+	// looks at the timers which fire. Timers which can't go back into the heap until the tick is over wait in deferredTimers.
+	ccTimerHeap					*timerHeap;
+	ccTimerHeap					*deferredTimers;
+	double						currentTime;
+	unsigned int				currentTick;
 	
 	// Optimization
-	TICK_IMP			impMethod;
 	SEL					updateSelector;
 }
 
@@ -137,6 +153,7 @@ struct _hashUpdateEntry;
 -(void) tick:(ccTime)dt;
 
 /** The scheduled method will be called every 'interval' seconds.
+ Timers are kept in order of when they are next due, so a tick only costs as much as the timers which fire in it.
  If paused is YES, then it won't be called until it is resumed.
  If 'interval' is 0, it will be called every frame, but if so, it recommened to use 'scheduleUpdateForTarget:' instead.
  If the selector is already scheduled, then only the interval parameter will be updated without re-scheduling it again.
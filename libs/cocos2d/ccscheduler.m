@@ -26,7 +26,6 @@
 // cocos2d imports
 #import "CCScheduler.h"
 #import "ccMacros.h"
-#import "Support/uthash.h"
 #import "Support/utlist.h"
 #import "Support/ccCArray.h"
 
@@ -52,23 +51,17 @@ typedef struct _hashUpdateEntry
 	tListEntry		**list;		// Which list does it belong to ?
 	tListEntry		*entry;		// entry in the list
 	id				target;		// hash key (retained)
-	UT_hash_handle  hh;
 } tHashUpdateEntry;
 
 // Hash Element used for "selectors with interval"
 typedef struct _hashSelectorEntry
 {
+	struct _hashSelectorEntry	*prev, *next;	// every entry, in the order they were added
 	struct ccArray	*timers;
 	id				target;		// hash key (retained)
-	unsigned int	timerIndex;
-	CCTimer			*currentTimer;
-	BOOL			currentTimerSalvaged;
 	BOOL			paused;
-	UT_hash_handle  hh;
 } tHashSelectorEntry;
 
-
-
 //
 // CCTimer
 //
@@ -117,6 +110,7 @@ typedef struct _hashSelectorEntry
 		impMethod = (TICK_IMP) [t methodForSelector:s];
 		elapsed = -1;
 		interval = seconds;
+		heapIndex = kCCTimerIdle;
 	}
 	return self;
 }
@@ -153,6 +147,8 @@ typedef struct _hashSelectorEntry
 
 @interface CCScheduler (Private)
 -(void) removeHashElement:(tHashSelectorEntry*)element;
+-(void) startTimer:(CCTimer*)timer element:(tHashSelectorEntry*)element;
+-(void) stopTimer:(CCTimer*)timer;
 @end
 
 @implementation CCScheduler
@@ -185,20 +181,26 @@ static CCScheduler *sharedScheduler;
 	if( (self=[super init]) ) {		
 		timeScale_ = 1.0f;
 
-		// used to trigger CCTimer#update
+		// used to trigger the 'update' selectors
 		updateSelector = @selector(update:);
-		impMethod = (TICK_IMP) [CCTimer instanceMethodForSelector:updateSelector];
 
 		// updates with priority
 		updates0 = NULL;
 		updatesNeg = NULL;
 		updatesPos = NULL;
-		hashForUpdates = NULL;
+		hashForUpdates = ccPointerMapNew(64);
 		
 		// selectors with interval
 		currentTarget = nil;
 		currentTargetSalvaged = NO;
-		hashForSelectors = nil;
+		currentTimer = nil;
+		currentTimerSalvaged = NO;
+		hashForSelectors = ccPointerMapNew(64);
+		selectorTargets = NULL;
+		timerHeap = ccTimerHeapNew(64);
+		deferredTimers = ccTimerHeapNew(16);
+		currentTime = 0;
+		currentTick = 0;
 	}
 
 	return self;
@@ -209,6 +211,11 @@ static CCScheduler *sharedScheduler;
 	CCLOG(@"cocos2d: deallocing %@", self);
 
 	[self unscheduleAllSelectors];
+	
+	ccTimerHeapFree(timerHeap);
+	ccTimerHeapFree(deferredTimers);
+	ccPointerMapFree(hashForSelectors);
+	ccPointerMapFree(hashForUpdates);
 
 	sharedScheduler = nil;
 
@@ -221,11 +228,42 @@ static CCScheduler *sharedScheduler;
 -(void) removeHashElement:(tHashSelectorEntry*)element
 {
 	ccArrayFree(element->timers);
+	ccPointerMapRemove(hashForSelectors, element->target);
+	DL_DELETE(selectorTargets, element);
 	[element->target release];
-	HASH_DEL(hashForSelectors, element);
 	free(element);
 }
 
+// A timer which hasn't started yet starts in the next tick. One which was paused carries on from where it was.
+-(void) startTimer:(CCTimer*)timer element:(tHashSelectorEntry*)element
+{
+	ccTimerHeapEntry entry = { -1, timer, element, &timer->heapIndex };
+	
+	if( timer->elapsed == -1 )
+		timer->startTick = currentTick;
+	else {
+		timer->startTime = currentTime - timer->elapsed;
+		entry.fireTime = timer->startTime + timer->interval;
+	}
+	
+	ccTimerHeapPush(timerHeap, entry);
+}
+
+// Takes a timer out of the heap, keeping the time since it last fired in case it is started again
+-(void) stopTimer:(CCTimer*)timer
+{
+	if( timer->heapIndex == kCCTimerIdle )
+		return;
+	
+	if( timer->elapsed != -1 )
+		timer->elapsed = currentTime - timer->startTime;
+	
+	if( timer->heapIndex == kCCTimerDeferred )
+		ccTimerHeapClear(deferredTimers, timer);
+	else
+		ccTimerHeapRemove(timerHeap, timer->heapIndex);
+}
+
 -(void) scheduleTimer: (CCTimer*) t
 {
 	NSAssert(NO, @"Not implemented. Use scheduleSelector:forTarget:");
@@ -246,13 +284,13 @@ static CCScheduler *sharedScheduler;
 	NSAssert( selector != nil, @"Argument selector must be non-nil");
 	NSAssert( target != nil, @"Argument target must be non-nil");	
 	
-	tHashSelectorEntry *element = NULL;
-	HASH_FIND_INT(hashForSelectors, &target, element);
+	tHashSelectorEntry *element = ccPointerMapGet(hashForSelectors, target);
 	
 	if( ! element ) {
 		element = calloc( sizeof( *element ), 1 );
 		element->target = [target retain];
-		HASH_ADD_INT( hashForSelectors, target, element );
+		ccPointerMapSet(hashForSelectors, target, element);
+		DL_APPEND(selectorTargets, element);
 	
 		// Is this the 1st element ? Then set the pause level to all the selectors of this target
 		element->paused = paused;
@@ -273,6 +311,12 @@ static CCScheduler *sharedScheduler;
 		if( selector == timer->selector ) {
 			CCLOG(@"CCScheduler#scheduleSelector. Selector already scheduled. Updating interval from: %.2f to %.2f", timer->interval, interval);
 			timer->interval = interval;
+			
+			// a running timer is due again with the new interval
+			if( timer->heapIndex >= 0 && timer->elapsed != -1 ) {
+				[self stopTimer:timer];
+				[self startTimer:timer element:element];
+			}
 			found = YES;
 		}
 	}
@@ -281,6 +325,9 @@ static CCScheduler *sharedScheduler;
 		CCTimer *timer = [[CCTimer alloc] initWithTarget:target selector:selector interval:interval];
 		ccArrayAppendObject(element->timers, timer);
 		[timer release];
+		
+		if( ! element->paused )
+			[self startTimer:timer element:element];
 	}
 }
 
@@ -293,8 +340,7 @@ static CCScheduler *sharedScheduler;
 	NSAssert( target != nil, @"Target MUST not be nil");
 	NSAssert( selector != NULL, @"Selector MUST not be NULL");
 	
-	tHashSelectorEntry *element = NULL;
-	HASH_FIND_INT(hashForSelectors, &target, element);
+	tHashSelectorEntry *element = ccPointerMapGet(hashForSelectors, target);
 	
 	if( element ) {
 		
@@ -304,17 +350,14 @@ static CCScheduler *sharedScheduler;
 			
 			if( selector == timer->selector ) {
 				
-				if( timer == element->currentTimer && !element->currentTimerSalvaged ) {
-					[element->currentTimer retain];
-					element->currentTimerSalvaged = YES;
+				if( timer == currentTimer && !currentTimerSalvaged ) {
+					[currentTimer retain];
+					currentTimerSalvaged = YES;
 					
 				}
-
-				ccArrayRemoveObjectAtIndex(element->timers, i );
 				
-				// update timerIndex in case we are in tick:, looping over the actions
-				if( element->timerIndex >= i )
-					element->timerIndex--;
+				[self stopTimer:timer];
+				ccArrayRemoveObjectAtIndex(element->timers, i );
 
 				if( element->timers->num == 0 ) {
 					if( currentTarget == element ) {
@@ -381,7 +424,7 @@ static CCScheduler *sharedScheduler;
 	hashElement->target = [target retain];
 	hashElement->list = list;
 	hashElement->entry = listElement;
-	HASH_ADD_INT(hashForUpdates, target, hashElement );
+	ccPointerMapSet(hashForUpdates, target, hashElement);
 }
 
 -(void) appendIn:(tListEntry**)list target:(id)target paused:(BOOL)paused
@@ -400,14 +443,13 @@ static CCScheduler *sharedScheduler;
 	hashElement->target = [target retain];
 	hashElement->list = list;
 	hashElement->entry = listElement;
-	HASH_ADD_INT(hashForUpdates, target, hashElement );	
+	ccPointerMapSet(hashForUpdates, target, hashElement);
 }
 
 -(void) scheduleUpdateForTarget:(id)target priority:(int)priority paused:(BOOL)paused
 {
 #if COCOS2D_DEBUG >= 1
-	tHashUpdateEntry * hashElement = NULL;
-	HASH_FIND_INT(hashForUpdates, &target, hashElement);
+	tHashUpdateEntry *hashElement = ccPointerMapGet(hashForUpdates, target);
 	NSAssert( hashElement == NULL, @"CCScheduler: You can't re-schedule an 'update' selector'. Unschedule it first");
 #endif	
 		
@@ -428,8 +470,7 @@ static CCScheduler *sharedScheduler;
 	if( target == nil )
 		return;
 	
-	tHashUpdateEntry * element = NULL;
-	HASH_FIND_INT(hashForUpdates, &target, element);
+	tHashUpdateEntry *element = ccPointerMapGet(hashForUpdates, target);
 	if( element ) {
 	
 		// list entry
@@ -437,8 +478,8 @@ static CCScheduler *sharedScheduler;
 		free( element->entry );
 	
 		// hash entry
+		ccPointerMapRemove(hashForUpdates, element->target);
 		[element->target release];
-		HASH_DEL( hashForUpdates, element);
 		free(element);
 	}
 }
@@ -448,9 +489,9 @@ static CCScheduler *sharedScheduler;
 -(void) unscheduleAllSelectors
 {
 	// Custom Selectors
-	for(tHashSelectorEntry *element=hashForSelectors; element != NULL; ) {	
+	for(tHashSelectorEntry *element=selectorTargets; element != NULL; ) {	
 		id target = element->target;
-		element=element->hh.next;
+		element=element->next;
 		[self unscheduleAllSelectorsForTarget:target];
 	}
 
@@ -475,14 +516,15 @@ static CCScheduler *sharedScheduler;
 		return;
 	
 	// Custom Selectors
-	tHashSelectorEntry *element = NULL;
-	HASH_FIND_INT(hashForSelectors, &target, element);
+	tHashSelectorEntry *element = ccPointerMapGet(hashForSelectors, target);
 	
 	if( element ) {
-		if( ccArrayContainsObject(element->timers, element->currentTimer) && !element->currentTimerSalvaged ) {
-			[element->currentTimer retain];
-			element->currentTimerSalvaged = YES;
+		if( ccArrayContainsObject(element->timers, currentTimer) && !currentTimerSalvaged ) {
+			[currentTimer retain];
+			currentTimerSalvaged = YES;
 		}
+		for( unsigned int i=0; i< element->timers->num; i++ )
+			[self stopTimer:element->timers->arr[i]];
 		ccArrayRemoveAllObjects(element->timers);
 		if( currentTarget == element )
 			currentTargetSalvaged = YES;
@@ -499,14 +541,20 @@ static CCScheduler *sharedScheduler;
 	NSAssert( target != nil, @"target must be non nil" );
 	
 	// Custom Selectors
-	tHashSelectorEntry *element = NULL;
-	HASH_FIND_INT(hashForSelectors, &target, element);
-	if( element )
+	tHashSelectorEntry *element = ccPointerMapGet(hashForSelectors, target);
+	if( element && element->paused ) {
 		element->paused = NO;
+		
+		// the timer which is firing is put back once it has fired
+		for( unsigned int i=0; i< element->timers->num; i++ ) {
+			CCTimer *timer = element->timers->arr[i];
+			if( timer != currentTimer )
+				[self startTimer:timer element:element];
+		}
+	}
 	
 	// Update selector
-	tHashUpdateEntry * elementUpdate = NULL;
-	HASH_FIND_INT(hashForUpdates, &target, elementUpdate);
+	tHashUpdateEntry *elementUpdate = ccPointerMapGet(hashForUpdates, target);
 	if( elementUpdate ) {
 		NSAssert( elementUpdate->entry != NULL, @"resumeTarget: unknown error");
 		elementUpdate->entry->paused = NO;
@@ -518,14 +566,16 @@ static CCScheduler *sharedScheduler;
 	NSAssert( target != nil, @"target must be non nil" );
 	
 	// Custom selectors
-	tHashSelectorEntry *element = NULL;
-	HASH_FIND_INT(hashForSelectors, &target, element);
-	if( element )
+	tHashSelectorEntry *element = ccPointerMapGet(hashForSelectors, target);
+	if( element && ! element->paused ) {
 		element->paused = YES;
+		
+		for( unsigned int i=0; i< element->timers->num; i++ )
+			[self stopTimer:element->timers->arr[i]];
+	}
 	
 	// Update selector
-	tHashUpdateEntry * elementUpdate = NULL;
-	HASH_FIND_INT(hashForUpdates, &target, elementUpdate);
+	tHashUpdateEntry *elementUpdate = ccPointerMapGet(hashForUpdates, target);
 	if( elementUpdate ) {
 		NSAssert( elementUpdate->entry != NULL, @"pauseTarget: unknown error");
 		elementUpdate->entry->paused = YES;
@@ -561,42 +611,80 @@ static CCScheduler *sharedScheduler;
 			entry->impMethod( entry->target, updateSelector, dt );
 	}
 	
-	// Iterate all over the  custome selectors
-	for(tHashSelectorEntry *elt=hashForSelectors; elt != NULL; ) {	
+	// Custom selectors. Only the timers which are due are looked at.
+	currentTime += dt;
+	currentTick++;
+	
+	while( timerHeap->num > 0 && timerHeap->entries[0].fireTime <= currentTime ) {
+		
+		ccTimerHeapEntry entry = timerHeap->entries[0];
+		CCTimer *timer = entry.timer;
+		ccTimerHeapRemove(timerHeap, 0);
+		
+		// Timers start in the tick after they were scheduled, so those scheduled by a selector in this tick wait for the next
+		if( timer->elapsed == -1 ) {
+			if( timer->startTick == currentTick ) {
+				ccTimerHeapAppend(deferredTimers, entry);
+				continue;
+			}
+			
+			timer->elapsed = 0;
+			timer->startTime = currentTime;
+			entry.fireTime = currentTime + timer->interval;
+			
+			if( entry.fireTime > currentTime ) {
+				ccTimerHeapPush(timerHeap, entry);
+				continue;
+			}
+		}
 		
-		currentTarget = elt;
+		currentTarget = entry.element;
 		currentTargetSalvaged = NO;
-
-		if( ! currentTarget->paused ) {
+		currentTimer = timer;
+		currentTimerSalvaged = NO;
+		
+		timer->impMethod( timer->target, timer->selector, (ccTime)(currentTime - timer->startTime) );
+		
+		if( currentTimerSalvaged ) {
+			// The currentTimer told the remove itself. To prevent the timer from
+			// accidentally deallocating itself before finishing its step, we retained
+			// it. Now that step is done, it's safe to release it.
+			[timer release];
+		}
+		else {
+			timer->startTime = currentTime;
 			
-			// The 'timers' ccArray may change while inside this loop.
-			for( elt->timerIndex = 0; elt->timerIndex < elt->timers->num; elt->timerIndex++) {
-				elt->currentTimer = elt->timers->arr[elt->timerIndex];
-				elt->currentTimerSalvaged = NO;
-
-				impMethod( elt->currentTimer, updateSelector, dt);
-				
-				if( elt->currentTimerSalvaged ) {
-					// The currentTimer told the remove itself. To prevent the timer from
-					// accidentally deallocating itself before finishing its step, we retained
-					// it. Now that step is done, it's safe to release it.
-					[elt->currentTimer release];
-				}
-				
-				elt->currentTimer = nil;
-			}			
+			if( currentTarget->paused )
+				timer->elapsed = 0;
+			else {
+				// a timer due again in this tick, i.e. with an interval of 0, fires again in the next one
+				entry.fireTime = currentTime + timer->interval;
+				if( entry.fireTime > currentTime )
+					ccTimerHeapPush(timerHeap, entry);
+				else
+					ccTimerHeapAppend(deferredTimers, entry);
+			}
 		}
 		
-		// elt, at this moment, is still valid
-		// so it is safe to ask this here (issue #490)
-		elt=elt->hh.next;
+		currentTimer = nil;
 		
-		// only delete currentTarget if no actions were scheduled during the cycle (issue #481)
+		// only delete currentTarget if no selectors were scheduled during the cycle (issue #481)
 		if( currentTargetSalvaged && currentTarget->timers->num == 0 )
-			[self removeHashElement:currentTarget];		
+			[self removeHashElement:currentTarget];
 	}
 	
 	currentTarget = nil;
+	
+	for( unsigned int i = 0; i < deferredTimers->num; i++ ) {
+		ccTimerHeapEntry entry = deferredTimers->entries[i];
+		CCTimer *timer = entry.timer;
+		if( timer != nil ) {
+			if( timer->elapsed != -1 )
+				entry.fireTime = timer->startTime + timer->interval;
+			ccTimerHeapPush(timerHeap, entry);
+		}
+	}
+	deferredTimers->num = 0;
 }
 
 @end
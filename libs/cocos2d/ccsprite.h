@@ -131,7 +131,9 @@ typedef enum {
 	NSMutableDictionary *animations_;
 }
 
-/** whether or not the Sprite needs to be updated in the Atlas */
+/** whether or not the Sprite needs to be updated in the Atlas.
+ Setting it to YES queues the sprite in it's CCSpriteSheet, which only updates the queued sprites when it draws.
+ */
 @property (nonatomic,readwrite) BOOL dirty;
 /** the quad (tex coords, vertex coords and color) information */
 @property (nonatomic,readonly) ccV3F_C4B_T2F_Quad quad;
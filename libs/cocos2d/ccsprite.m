@@ -58,6 +58,15 @@ struct transformValues_ {
 -(struct transformValues_) getTransformValues;	// optimization
 @end
 
+// XXX: Optimization
+// A sprite in a CCSpriteSheet's atlas queues itself in the sheet when it becomes dirty,
+// so that the sheet only updates the sprites which changed since it last drew.
+#define SET_DIRTY() {																		\
+					if( ! dirty_ && usesSpriteSheet_ && atlasIndex_ != CCSpriteIndexNotInitialized )	\
+						[spriteSheet_ addDirtySprite:self];										\
+					dirty_ = YES;																\
+					}
+
 @implementation CCSprite
 
 @synthesize dirty = dirty_;
@@ -352,7 +361,7 @@ struct transformValues_ {
 	// rendering using SpriteSheet
 	if( usesSpriteSheet_ ) {
 		// update dirty_, don't update recursiveDirty_
-		dirty_ = YES;
+		SET_DIRTY();
 	}
 
 	// self rendering
@@ -634,9 +643,22 @@ struct transformValues_ {
 #pragma mark CCSprite - property overloads
 
 
+-(void) setDirty:(BOOL)b
+{
+	// the CCSpriteSheet sets it when the sprite is inserted, which always queues it,
+	// as the sprite may have become dirty before it had an atlas index
+	if( b && usesSpriteSheet_ && atlasIndex_ != CCSpriteIndexNotInitialized )
+		[spriteSheet_ addDirtySprite:self];
+	dirty_ = b;
+}
+
 -(void) setDirtyRecursively:(BOOL)b
 {
-	dirty_ = recursiveDirty_ = b;
+	if( b )
+		SET_DIRTY()
+	else
+		dirty_ = NO;
+	recursiveDirty_ = b;
 	// recursively set dirty
 	if( hasChildren_ ) {
 		CCSprite *child;
@@ -648,7 +670,8 @@ struct transformValues_ {
 // XXX HACK: optimization
 #define SET_DIRTY_RECURSIVELY() {									\
 					if( usesSpriteSheet_ && ! recursiveDirty_ ) {	\
-						dirty_ = recursiveDirty_ = YES;				\
+						SET_DIRTY();								\
+						recursiveDirty_ = YES;						\
 						if( hasChildren_)							\
 							[self setDirtyRecursively:YES];			\
 						}											\
@@ -707,7 +730,8 @@ struct transformValues_ {
 	if( v != visible_ ) {
 		[super setVisible:v];
 		if( usesSpriteSheet_ && ! recursiveDirty_ ) {
-			dirty_ = recursiveDirty_ = YES;
+			SET_DIRTY();
+			recursiveDirty_ = YES;
 			id child;
 			CCARRAY_FOREACH(children_, child)
 				[child setVisible:v];
@@ -759,7 +783,7 @@ struct transformValues_ {
 		else
 			// no need to set it recursively
 			// update dirty_, don't update recursiveDirty_
-			dirty_ = YES;
+			SET_DIRTY();
 	}
 	// self render
 	// do nothing
@@ -29,6 +29,7 @@
 #import "CCProtocols.h"
 #import "CCTextureAtlas.h"
 #import "ccMacros.h"
+#import "Support/ccCArray.h"
 
 #pragma mark CCSpriteSheet
 
@@ -56,6 +57,9 @@
 
 	// all descendants: chlidren, gran children, etc...
 	CCArray	*descendants_;
+	
+	// descendants which became dirty since the last draw (weak references)
+	ccCArray *dirtySprites_;
 }
 
 /** returns the TextureAtlas that is used */
@@ -128,6 +132,11 @@
 -(void)removeChild: (CCSprite *)sprite cleanup:(BOOL)doCleanup;
 
 -(void) insertChild:(CCSprite*)child inAtlasAtIndex:(NSUInteger)index;
+/** queues a descendant which became dirty, to be updated the next time the sheet draws.
+ Called by CCSprite: only the queued sprites are updated, so the sprites which haven't changed cost nothing.
+ @since v0.99.5
+ */
+-(void) addDirtySprite:(CCSprite*)sprite;
 -(void) removeSpriteFromAtlas:(CCSprite*)sprite;
 
 -(NSUInteger) rebuildIndexInOrder:(CCSprite*)parent atlasIndex:(NSUInteger)index;
@@ -91,6 +91,7 @@ const int defaultCapacity = 29;
 		// no lazy alloc in this node
 		children_ = [[CCArray alloc] initWithCapacity:capacity];
 		descendants_ = [[CCArray alloc] initWithCapacity:capacity];
+		dirtySprites_ = ccCArrayNew(capacity);
 	}
 	
 	return self;
@@ -114,6 +115,7 @@ const int defaultCapacity = 29;
 {	
 	[textureAtlas_ release];
 	[descendants_ release];
+	ccCArrayFree(dirtySprites_);
 	
 	[super dealloc];
 }
@@ -222,51 +224,58 @@ const int defaultCapacity = 29;
 -(void)removeAllChildrenWithCleanup:(BOOL)doCleanup
 {
 	// Invalidate atlas index. issue #569
-	[children_ makeObjectsPerformSelector:@selector(useSelfRender)];
+	// All the descendants are reset, so that none of them queue themselves in this sheet any more
+	[descendants_ makeObjectsPerformSelector:@selector(useSelfRender)];
 	
 	[super removeAllChildrenWithCleanup:doCleanup];
 	
 	[descendants_ removeAllObjects];
+	ccCArrayRemoveAllValues(dirtySprites_);
 	[textureAtlas_ removeAllQuads];
 }
 
 #pragma mark CCSpriteSheet - draw
-#pragma mark CCSpriteSheet - draw
+-(void) addDirtySprite:(CCSprite*)sprite
+{
+	ccCArrayAppendValueWithResize(dirtySprites_, sprite);
+}
+
 -(void) draw
 {
+	// Only the sprites which became dirty since the last draw are updated.
+	// Each updated quad is marked in the TextureAtlas, which uploads just the range of quads that changed.
+	if( dirtySprites_->num > 0 ) {
+		
+		// Optimization: Fast Dispatch
+		typedef BOOL (*DIRTY_IMP)(id, SEL);
+		typedef BOOL (*UPDATE_IMP)(id, SEL);
+		SEL selDirty = @selector(dirty);
+		SEL selUpdate = @selector(updateTransform);
+		CCSprite *child = dirtySprites_->arr[0];
+		DIRTY_IMP dirtyMethod = (DIRTY_IMP) [child methodForSelector:selDirty];
+		UPDATE_IMP updateMethod = (UPDATE_IMP) [child methodForSelector:selUpdate];
+		
+		id *arr = dirtySprites_->arr;
+		NSUInteger i = dirtySprites_->num;
+		while (i-- > 0) {
+			child = *arr++;
+			
+			// a sprite may have been updated already, or queued twice
+			if( dirtyMethod(child, selDirty) )
+				updateMethod(child, selUpdate);
+		}
+		
+		ccCArrayRemoveAllValues(dirtySprites_);
+	}
+	
 	if( textureAtlas_.totalQuads == 0 )
 		return;
 	
-	// Optimization: Fast Dispatch
-	typedef BOOL (*DIRTY_IMP)(id, SEL);
-	typedef BOOL (*UPDATE_IMP)(id, SEL);
-	SEL selDirty = @selector(dirty);
-	SEL selUpdate = @selector(updateTransform);
-	DIRTY_IMP dirtyMethod = nil;
-	UPDATE_IMP updateMethod = nil;
-	
+#if CC_SPRITESHEET_DEBUG_DRAW
 	ccArray *array = descendants_->data;
-	CCSprite *child;
-	
-	// is there any child ?. compare with array->num
-	// if so, compile the isDirty and update methods
-	if( array->num > 0 ) {
-		child = array->arr[0];
-		dirtyMethod = (DIRTY_IMP) [child methodForSelector:selDirty];
-		updateMethod = (UPDATE_IMP) [child methodForSelector:selUpdate];
-	}
-	
-	// itera
-	id *arr = array->arr;
-	NSUInteger i = array->num;
-	while (i-- > 0) {
-		child = *arr++;
+	for( NSUInteger i = 0; i < array->num; i++ ) {
+		CCSprite *child = array->arr[i];
 		
-		// fast dispatch
-		if( dirtyMethod(child, selDirty) )
-			updateMethod(child, selUpdate);
-		
-#if CC_SPRITESHEET_DEBUG_DRAW
 		CGRect rect = [child boundingBox]; //Issue #528
 		CGPoint vertices[4]={
 			ccp(rect.origin.x,rect.origin.y),
@@ -275,8 +284,8 @@ const int defaultCapacity = 29;
 			ccp(rect.origin.x,rect.origin.y+rect.size.height),
 		};
 		ccDrawPoly(vertices, 4, YES);
-#endif // CC_SPRITESHEET_DEBUG_DRAW
 	}
+#endif // CC_SPRITESHEET_DEBUG_DRAW
 	
 	// Default GL states: GL_TEXTURE_2D, GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY
 	// Needed states: GL_TEXTURE_2D, GL_VERTEX_ARRAY, GL_COLOR_ARRAY, GL_TEXTURE_COORD_ARRAY
@@ -441,6 +450,11 @@ const int defaultCapacity = 29;
 	// remove from TextureAtlas
 	[textureAtlas_ removeQuadAtIndex:sprite.atlasIndex];
 	
+	// forget the sprite if it is waiting to be updated
+	NSUInteger dirtyIndex;
+	while( (dirtyIndex = ccCArrayGetIndexOfValue(dirtySprites_, sprite)) != NSNotFound )
+		ccCArrayRemoveValueAtIndex(dirtySprites_, dirtyIndex);
+	
 	// Cleanup sprite. It might be reused (issue #569)
 	[sprite useSelfRender];
 	
@@ -36,7 +36,7 @@
    * Quads can be re-ordered in runtime
    * The TextureAtlas capacity can be increased or decreased in runtime
    * OpenGL component: V3F, C4B, T2F.
- The quads are rendered using an OpenGL ES VBO.
+ The quads are rendered using an OpenGL ES VBO. Only the range of quads which changed since the last draw is uploaded to it.
  To render the quads using an interleaved vertex array list, you should modify the ccConfig.h file 
  */
 @interface CCTextureAtlas : NSObject {
@@ -47,6 +47,7 @@
 	CCTexture2D			*texture_;
 #if CC_TEXTURE_ATLAS_USES_VBO
 	GLuint				buffersVBO_[2]; //0: vertex  1: indices
+	NSUInteger			dirtyStart_, dirtyEnd_;	// quads that changed since they were uploaded, from dirtyStart_ up to (not including) dirtyEnd_
 #endif // CC_TEXTURE_ATLAS_USES_VBO
 }
 
@@ -56,7 +57,9 @@
 @property (nonatomic,readonly) NSUInteger capacity;
 /** Texture of the texture atlas */
 @property (nonatomic,retain) CCTexture2D *texture;
-/** Quads that are going to be rendered */
+/** Quads that are going to be rendered.
+ They may be changed through the pointer, so getting or setting it uploads all of them again in the next draw.
+ */
 @property (nonatomic,readwrite) ccV3F_C4B_T2F_Quad *quads;
 
 /** creates a TextureAtlas with an filename and with an initial capacity for Quads.
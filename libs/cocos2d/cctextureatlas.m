@@ -37,11 +37,20 @@
 
 //According to some tests GL_TRIANGLE_STRIP is slower, MUCH slower. Probably I'm doing something very wrong
 
+#if CC_TEXTURE_ATLAS_USES_VBO
+// adds the quads from __START__ up to (not including) __END__ to the range uploaded in the next draw
+#define MARK_QUADS_DIRTY(__START__, __END__) {					\
+					dirtyStart_ = MIN(dirtyStart_, (__START__));	\
+					dirtyEnd_ = MAX(dirtyEnd_, (__END__));			\
+					}
+#else
+#define MARK_QUADS_DIRTY(__START__, __END__)
+#endif // CC_TEXTURE_ATLAS_USES_VBO
+
 @implementation CCTextureAtlas
 
 @synthesize totalQuads = totalQuads_, capacity = capacity_;
 @synthesize texture = texture_;
-@synthesize quads = quads_;
 
 #pragma mark TextureAtlas - alloc & init
 
@@ -146,6 +155,11 @@
 #if CC_TEXTURE_ATLAS_USES_VBO
 	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * capacity_, quads_, GL_DYNAMIC_DRAW);
+	
+	// every quad has just been uploaded
+	dirtyStart_ = NSUIntegerMax;
+	dirtyEnd_ = 0;
+	
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[1]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices_[0]) * capacity_ * 6, indices_, GL_STATIC_DRAW);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -155,6 +169,18 @@
 
 #pragma mark TextureAtlas - Update, Insert, Move & Remove
 
+-(ccV3F_C4B_T2F_Quad*) quads
+{
+	MARK_QUADS_DIRTY(0, capacity_);
+	return quads_;
+}
+
+-(void) setQuads:(ccV3F_C4B_T2F_Quad*)quads
+{
+	MARK_QUADS_DIRTY(0, capacity_);
+	quads_ = quads;
+}
+
 -(void) updateQuad:(ccV3F_C4B_T2F_Quad*)quad atIndex:(NSUInteger) n
 {
 	NSAssert( n >= 0 && n < capacity_, @"updateQuadWithTexture: Invalid index");
@@ -162,6 +188,7 @@
 	totalQuads_ =  MAX( n+1, totalQuads_);
 	
 	quads_[n] = *quad;	
+	MARK_QUADS_DIRTY(n, n+1);
 }
 
 
@@ -182,6 +209,7 @@
 	}
 	
 	quads_[index] = *quad;
+	MARK_QUADS_DIRTY(index, totalQuads_);
 }
 
 
@@ -205,6 +233,7 @@
 	ccV3F_C4B_T2F_Quad quadsBackup = quads_[oldIndex];
 	memmove( &quads_[dst],&quads_[src], sizeof(quads_[0]) * howMany );
 	quads_[newIndex] = quadsBackup;
+	MARK_QUADS_DIRTY(MIN(oldIndex, newIndex), MAX(oldIndex, newIndex)+1);
 }
 
 -(void) removeQuadAtIndex:(NSUInteger) index
@@ -221,6 +250,7 @@
 	}
 	
 	totalQuads_--;
+	MARK_QUADS_DIRTY(index, totalQuads_);
 	
 	NSAssert( totalQuads_ >= 0, @"invalid totalQuads");
 }
@@ -288,7 +318,12 @@
 	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0]);
 	
 	// XXX: update is done in draw... perhaps it should be done in a timer
-	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quads_[0]) * n, quads_);
+	// Only the quads which changed since the last draw are uploaded
+	if( dirtyStart_ < dirtyEnd_ ) {
+		glBufferSubData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * dirtyStart_, sizeof(quads_[0]) * (dirtyEnd_ - dirtyStart_), &quads_[dirtyStart_]);
+		dirtyStart_ = NSUIntegerMax;
+		dirtyEnd_ = 0;
+	}
 	
 	// vertices
 	glVertexPointer(3, GL_FLOAT, kQuadSize, (void*) offsetof( ccV3F_C4B_T2F, vertices));
@@ -0,0 +1,156 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2011 William Darius Elphick
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include "ccPointerMap.h"
+
+// 2^N divided by the golden ratio, for the width of a pointer
+#if UINTPTR_MAX > 0xFFFFFFFFu
+#define CC_POINTER_MAP_FIBONACCI	UINT64_C(11400714819323198485)
+#define CC_POINTER_MAP_BITS			64
+#else
+#define CC_POINTER_MAP_FIBONACCI	UINT32_C(2654435769)
+#define CC_POINTER_MAP_BITS			32
+#endif
+
+#define CC_POINTER_MAP_MINIMUM_CAPACITY 8
+
+static inline size_t ccPointerMapIndex(const ccPointerMap *map, const void *key)
+{
+	return (size_t)(((uintptr_t)key * CC_POINTER_MAP_FIBONACCI) >> map->shift);
+}
+
+static void ccPointerMapAllocate(ccPointerMap *map, size_t capacity)
+{
+	unsigned int bits = 0;
+	
+	while( ((size_t)1 << bits) < capacity )
+		bits++;
+	
+	map->capacity = (size_t)1 << bits;
+	map->shift = CC_POINTER_MAP_BITS - bits;
+	map->num = 0;
+	map->entries = calloc( map->capacity, sizeof(ccPointerMapEntry) );
+}
+
+ccPointerMap* ccPointerMapNew(size_t capacity)
+{
+	ccPointerMap *map = malloc( sizeof(ccPointerMap) );
+	
+	// room for capacity entries at half full
+	capacity *= 2;
+	if( capacity < CC_POINTER_MAP_MINIMUM_CAPACITY )
+		capacity = CC_POINTER_MAP_MINIMUM_CAPACITY;
+	
+	ccPointerMapAllocate(map, capacity);
+	
+	return map;
+}
+
+void ccPointerMapFree(ccPointerMap *map)
+{
+	if( map == NULL )
+		return;
+	
+	free(map->entries);
+	free(map);
+}
+
+void* ccPointerMapGet(const ccPointerMap *map, const void *key)
+{
+	size_t mask = map->capacity - 1;
+	
+	for( size_t i = ccPointerMapIndex(map, key); map->entries[i].key != NULL; i = (i + 1) & mask ) {
+		if( map->entries[i].key == key )
+			return map->entries[i].value;
+	}
+	
+	return NULL;
+}
+
+static void ccPointerMapGrow(ccPointerMap *map)
+{
+	ccPointerMapEntry *oldEntries = map->entries;
+	size_t oldCapacity = map->capacity;
+	
+	ccPointerMapAllocate(map, oldCapacity * 2);
+	
+	for( size_t i = 0; i < oldCapacity; i++ ) {
+		if( oldEntries[i].key != NULL )
+			ccPointerMapSet(map, oldEntries[i].key, oldEntries[i].value);
+	}
+	
+	free(oldEntries);
+}
+
+void ccPointerMapSet(ccPointerMap *map, const void *key, void *value)
+{
+	if( (map->num + 1) * 2 > map->capacity )
+		ccPointerMapGrow(map);
+	
+	size_t mask = map->capacity - 1;
+	size_t i = ccPointerMapIndex(map, key);
+	
+	for( ; map->entries[i].key != NULL; i = (i + 1) & mask ) {
+		if( map->entries[i].key == key ) {
+			map->entries[i].value = value;
+			return;
+		}
+	}
+	
+	map->entries[i].key = key;
+	map->entries[i].value = value;
+	map->num++;
+}
+
+void* ccPointerMapRemove(ccPointerMap *map, const void *key)
+{
+	size_t mask = map->capacity - 1;
+	size_t gap = ccPointerMapIndex(map, key);
+	
+	while( map->entries[gap].key != key ) {
+		if( map->entries[gap].key == NULL )
+			return NULL;
+		gap = (gap + 1) & mask;
+	}
+	
+	void *value = map->entries[gap].value;
+	
+	// Each following entry in the run moves back into the gap, unless that would put it before the index it hashes to
+	for( size_t i = (gap + 1) & mask; map->entries[i].key != NULL; i = (i + 1) & mask ) {
+		size_t home = ccPointerMapIndex(map, map->entries[i].key);
+		
+		if( ((i - home) & mask) >= ((i - gap) & mask) ) {
+			map->entries[gap] = map->entries[i];
+			gap = i;
+		}
+	}
+	
+	map->entries[gap].key = NULL;
+	map->entries[gap].value = NULL;
+	map->num--;
+	
+	return value;
+}
@@ -0,0 +1,84 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2011 William Darius Elphick
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/** 
+ @file
+ ccPointerMap maps pointers, such as the targets of the CCScheduler and the CCActionManager, to values.
+ It is used instead of uthash's HASH_FIND_INT, which hashes only 4 bytes of the pointer and follows a chain
+ of nodes for every lookup.
+ 
+ - Keys and values are stored side by side in a single array, with open addressing and linear probing, so a
+ lookup normally reads one or two neighbouring entries.
+ - The whole pointer is hashed with Fibonacci hashing, which spreads the aligned addresses of objects over
+ the table.
+ - Removing an entry shifts the entries after it back into the gap, so there are no tombstones and lookups
+ don't slow down as targets come and go.
+ - The table doubles when it becomes half full, and never shrinks.
+ 
+ Entries move when others are added or removed, so the map must not be changed while iterating over it.
+ NULL can't be used as a key.
+ */
+
+#ifndef CC_POINTER_MAP_H
+#define CC_POINTER_MAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ccPointerMapEntry {
+	const void *key;	// NULL if the entry is empty
+	void *value;
+} ccPointerMapEntry;
+
+typedef struct ccPointerMap {
+	ccPointerMapEntry *entries;
+	size_t num, capacity;	// capacity is always a power of 2
+	unsigned int shift;		// bits of the hash dropped to give an index
+} ccPointerMap;
+
+/** Allocates a map with room for at least capacity entries before it grows */
+ccPointerMap* ccPointerMapNew(size_t capacity);
+
+/** Frees the map. The values aren't freed. */
+void ccPointerMapFree(ccPointerMap *map);
+
+/** Returns the value of the key, or NULL if the key isn't in the map */
+void* ccPointerMapGet(const ccPointerMap *map, const void *key);
+
+/** Sets the value of the key, adding it if it isn't in the map */
+void ccPointerMapSet(ccPointerMap *map, const void *key, void *value);
+
+/** Removes the key and returns it's value, or NULL if the key isn't in the map */
+void* ccPointerMapRemove(ccPointerMap *map, const void *key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CC_POINTER_MAP_H
@@ -0,0 +1,135 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2011 William Darius Elphick
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include <stdlib.h>
+#include "ccTimerHeap.h"
+
+ccTimerHeap* ccTimerHeapNew(unsigned int capacity)
+{
+	ccTimerHeap *heap = malloc( sizeof(*heap) );
+	heap->entries = malloc( capacity * sizeof(ccTimerHeapEntry) );
+	heap->num = 0;
+	heap->max = capacity;
+	return heap;
+}
+
+void ccTimerHeapFree(ccTimerHeap *heap)
+{
+	if( heap == NULL )
+		return;
+	
+	free(heap->entries);
+	free(heap);
+}
+
+static inline void ccTimerHeapSet(ccTimerHeap *heap, unsigned int index, ccTimerHeapEntry entry)
+{
+	heap->entries[index] = entry;
+	*entry.index = (int)index;
+}
+
+static void ccTimerHeapSiftUp(ccTimerHeap *heap, unsigned int index)
+{
+	ccTimerHeapEntry entry = heap->entries[index];
+	
+	while( index > 0 ) {
+		unsigned int parent = (index - 1) / 2;
+		if( heap->entries[parent].fireTime <= entry.fireTime )
+			break;
+		ccTimerHeapSet(heap, index, heap->entries[parent]);
+		index = parent;
+	}
+	
+	ccTimerHeapSet(heap, index, entry);
+}
+
+static void ccTimerHeapSiftDown(ccTimerHeap *heap, unsigned int index)
+{
+	ccTimerHeapEntry entry = heap->entries[index];
+	
+	for(;;) {
+		unsigned int child = 2 * index + 1;
+		if( child >= heap->num )
+			break;
+		if( child + 1 < heap->num && heap->entries[child + 1].fireTime < heap->entries[child].fireTime )
+			child++;
+		if( entry.fireTime <= heap->entries[child].fireTime )
+			break;
+		ccTimerHeapSet(heap, index, heap->entries[child]);
+		index = child;
+	}
+	
+	ccTimerHeapSet(heap, index, entry);
+}
+
+static inline void ccTimerHeapReserve(ccTimerHeap *heap)
+{
+	if( heap->num == heap->max ) {
+		heap->max *= 2;
+		heap->entries = realloc( heap->entries, heap->max * sizeof(ccTimerHeapEntry) );
+	}
+}
+
+void ccTimerHeapPush(ccTimerHeap *heap, ccTimerHeapEntry entry)
+{
+	ccTimerHeapReserve(heap);
+	
+	heap->entries[heap->num] = entry;
+	ccTimerHeapSiftUp(heap, heap->num++);
+}
+
+void ccTimerHeapRemove(ccTimerHeap *heap, unsigned int index)
+{
+	*heap->entries[index].index = kCCTimerIdle;
+	heap->num--;
+	
+	// the last entry fills the gap, and may belong above or below it
+	if( index < heap->num ) {
+		ccTimerHeapSet(heap, index, heap->entries[heap->num]);
+		if( index > 0 && heap->entries[index].fireTime < heap->entries[(index - 1) / 2].fireTime )
+			ccTimerHeapSiftUp(heap, index);
+		else
+			ccTimerHeapSiftDown(heap, index);
+	}
+}
+
+void ccTimerHeapAppend(ccTimerHeap *heap, ccTimerHeapEntry entry)
+{
+	ccTimerHeapReserve(heap);
+	
+	heap->entries[heap->num++] = entry;
+	*entry.index = kCCTimerDeferred;
+}
+
+void ccTimerHeapClear(ccTimerHeap *heap, const void *timer)
+{
+	for( unsigned int i = 0; i < heap->num; i++ ) {
+		if( heap->entries[i].timer == timer ) {
+			*heap->entries[i].index = kCCTimerIdle;
+			heap->entries[i].timer = NULL;
+			break;
+		}
+	}
+}
@@ -0,0 +1,87 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2011 William Darius Elphick
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+/** 
+ @file
+ ccTimerHeap keeps the running timers of the CCScheduler in a binary min-heap ordered by the time each is next
+ due, so that a tick only looks at the timers which fire in it.
+ 
+ - Each entry points back at an int owned by it's timer, which is kept up to date with the entry's index in the
+ heap so that a timer can be taken out of the middle of the heap when it is paused or unscheduled.
+ - The same struct serves as the unordered list of timers which can't go back into the heap until the end of a
+ tick. Timers are appended to it and cleared from it rather than removed, and the list is emptied in one go.
+ - The entries array doubles when it is full, and never shrinks.
+ 
+ The heap has no dependency on Objective-C so that it can be tested and benchmarked on any platform.
+ */
+
+#ifndef CC_TIMER_HEAP_H
+#define CC_TIMER_HEAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Where a timer is kept when it isn't in the heap. Timers in the heap have their index in it. */
+enum {
+	kCCTimerIdle = -1,		// paused, unscheduled or firing
+	kCCTimerDeferred = -2	// in a list of deferred timers until the end of the tick
+};
+
+typedef struct ccTimerHeapEntry {
+	double	fireTime;
+	void	*timer;		// not retained. NULL once cleared from a list of deferred timers
+	void	*element;	// whatever the owner of the heap keeps with the timer
+	int		*index;		// the timer's record of where it is kept
+} ccTimerHeapEntry;
+
+typedef struct ccTimerHeap {
+	ccTimerHeapEntry	*entries;
+	unsigned int		num, max;
+} ccTimerHeap;
+
+/** Allocates a heap with room for capacity entries before it grows */
+ccTimerHeap* ccTimerHeapNew(unsigned int capacity);
+
+/** Frees the heap. The timers aren't freed. */
+void ccTimerHeapFree(ccTimerHeap *heap);
+
+/** Adds the entry to the heap in order of it's fireTime */
+void ccTimerHeapPush(ccTimerHeap *heap, ccTimerHeapEntry entry);
+
+/** Removes the entry at the index, which is 0 for the timer due first, and marks it's timer as idle */
+void ccTimerHeapRemove(ccTimerHeap *heap, unsigned int index);
+
+/** Adds the entry to the end of a list of deferred timers and marks it's timer as deferred */
+void ccTimerHeapAppend(ccTimerHeap *heap, ccTimerHeapEntry entry);
+
+/** Clears the timer's entry from a list of deferred timers, without moving the others, and marks the timer as idle */
+void ccTimerHeapClear(ccTimerHeap *heap, const void *timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CC_TIMER_HEAP_H
@@ -0,0 +1,30 @@
+//
+//  BenchmarkTimer.h
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The clock used by the benchmarks of the plain C modules, the equivalent of CFAbsoluteTimeGetCurrent in
+ the benchmarks which run in the app.
+ */
+
+#ifndef __BENCHMARK_TIMER_H__
+#define __BENCHMARK_TIMER_H__
+
+#include <time.h>
+
+/*
+ Returns the time in seconds from an arbitrary starting point which never goes backwards.
+ */
+static inline double BenchmarkTimerNow(void) {
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (double)now.tv_sec + ((double)now.tv_nsec / 1e9);
+
+}
+
+#endif // __BENCHMARK_TIMER_H__
@@ -0,0 +1,256 @@
+//
+//  BroadphaseBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 05/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The host version of the app's BroadphaseBenchmark. It sweeps the number of projectiles from 10 to 1000, with
+ a ship for every four projectiles, and finds the collisions of each frame both by brute force, every ship
+ tested against every projectile as nextFrame did, and with the CollisionCells behind the CollisionGrid,
+ emptied, filled and queried by every ship as nextFrame does now. Sprites are the game's sizes, spread at
+ random over the screen, and the projectiles move a little between frames. Both approaches must find the
+ same collisions.
+
+ The mean time of a frame with each is reported, along with the smallest number of projectiles from which the
+ grid is faster for every count measured.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "CollisionCells.h"
+#include "Simulation.h"
+#include "BenchmarkTimer.h"
+
+/*
+ The sizes from GameConstants.h and CollisionGrid.h, which are Objective-C headers.
+ */
+#define kGameScreenWidth 480
+#define kGameScreenHeight 320
+#define kGameProjectileImageSize 12
+#define kGameSmallTargetImageSize 40
+#define kGameLargeTargetImageSize 50
+#define kCollisionGridCellSize 64.0f
+
+static const int kBroadphaseBenchmarkProjectiles[] = { 10, 20, 30, 40, 60, 80, 100, 150, 200, 300, 500, 750, 1000 };
+
+#define kBroadphaseBenchmarkCounts (int)(sizeof(kBroadphaseBenchmarkProjectiles) / sizeof(kBroadphaseBenchmarkProjectiles[0]))
+
+/*
+ Projectiles processed by each run, split into as many frames as it takes, so that every run takes long
+ enough to time.
+ */
+#define kBroadphaseBenchmarkWork 2000000
+
+typedef struct {
+
+	int count;
+	float *x;
+	float *y;
+	float *radius;
+
+} BroadphaseCircles;
+
+static void BroadphaseCirclesInit(BroadphaseCircles *circles, int count, SimulationRandom *random, int ships) {
+
+	circles->count = count;
+	circles->x = malloc(sizeof(float) * count);
+	circles->y = malloc(sizeof(float) * count);
+	circles->radius = malloc(sizeof(float) * count);
+
+	for (int i = 0; i < count; i++) {
+
+		float size = kGameProjectileImageSize;
+
+		//Half of the ships are small targets and half are large targets.
+		if (ships) {
+			size = (i & 1) ? kGameLargeTargetImageSize : kGameSmallTargetImageSize;
+		}
+
+		circles->x[i] = (float)(SimulationRandomNext(random) % kGameScreenWidth);
+		circles->y[i] = (float)(SimulationRandomNext(random) % kGameScreenHeight);
+		circles->radius[i] = size / 2;
+
+	}
+
+}
+
+static void BroadphaseCirclesFree(BroadphaseCircles *circles) {
+
+	free(circles->x);
+	free(circles->y);
+	free(circles->radius);
+
+}
+
+/*
+ Moves every projectile a little to the right and up, wrapping around the edges of the screen.
+ */
+static void BroadphaseMoveProjectiles(BroadphaseCircles *projectiles) {
+
+	for (int i = 0; i < projectiles->count; i++) {
+
+		projectiles->x[i] = fmodf(projectiles->x[i] + 3.0f, kGameScreenWidth);
+		projectiles->y[i] = fmodf(projectiles->y[i] + 2.0f, kGameScreenHeight);
+
+	}
+
+}
+
+/*
+ The bounding circle test of CollidableSprite's checkCollisionWithCollidableSprite:.
+ */
+static unsigned long BroadphaseBruteForceFrame(const BroadphaseCircles *ships, const BroadphaseCircles *projectiles) {
+
+	unsigned long collisions = 0;
+
+	for (int s = 0; s < ships->count; s++) {
+
+		for (int p = 0; p < projectiles->count; p++) {
+
+			float minimumIntersectionDistance = ships->radius[s] + projectiles->radius[p];
+			float xDistance = projectiles->x[p] - ships->x[s];
+			float yDistance = projectiles->y[p] - ships->y[s];
+
+			if ((minimumIntersectionDistance * minimumIntersectionDistance) > (xDistance * xDistance) + (yDistance * yDistance)) {
+				collisions++;
+			}
+
+		}
+
+	}
+
+	return collisions;
+
+}
+
+static unsigned long BroadphaseGridFrame(CollisionCells *cells, const BroadphaseCircles *ships, const BroadphaseCircles *projectiles) {
+
+	unsigned long collisions = 0;
+
+	CollisionCellsRemoveAll(cells);
+
+	for (int p = 0; p < projectiles->count; p++) {
+		CollisionCellsAdd(cells, projectiles->x[p], projectiles->y[p], projectiles->radius[p]);
+	}
+
+	for (int s = 0; s < ships->count; s++) {
+		collisions += CollisionCellsQuery(cells, ships->x[s], ships->y[s], ships->radius[s]);
+	}
+
+	return collisions;
+
+}
+
+int main(void) {
+
+	CollisionCells *cells = CollisionCellsNew(kGameScreenWidth, kGameScreenHeight, kCollisionGridCellSize);
+	double bruteForceTimes[kBroadphaseBenchmarkCounts];
+	double gridTimes[kBroadphaseBenchmarkCounts];
+	int failed = 0;
+
+	if (cells == NULL) {
+		return 1;
+	}
+
+	printf("Mean time of a frame in us, finding every collision between the ships and the projectiles.\n");
+	printf("%s\n", "projectiles  ships   brute force     grid   speedup   collisions/frame");
+
+	for (int i = 0; i < kBroadphaseBenchmarkCounts; i++) {
+
+		int numberOfProjectiles = kBroadphaseBenchmarkProjectiles[i];
+		int numberOfShips = (numberOfProjectiles < 4) ? 1 : numberOfProjectiles / 4;
+		int frames = kBroadphaseBenchmarkWork / numberOfProjectiles;
+		BroadphaseCircles ships, projectiles;
+		SimulationRandom random;
+		unsigned long bruteForceCollisions = 0;
+		unsigned long gridCollisions = 0;
+
+		SimulationRandomSeed(&random, 1);
+		BroadphaseCirclesInit(&ships, numberOfShips, &random, 1);
+		BroadphaseCirclesInit(&projectiles, numberOfProjectiles, &random, 0);
+
+		/*
+		 Each approach is timed over the same frames, with the projectiles moved between the frames outside the
+		 timing. The projectiles are put back where they started before the grid is timed.
+		 */
+		float *startingX = malloc(sizeof(float) * numberOfProjectiles);
+		float *startingY = malloc(sizeof(float) * numberOfProjectiles);
+
+		for (int p = 0; p < numberOfProjectiles; p++) {
+
+			startingX[p] = projectiles.x[p];
+			startingY[p] = projectiles.y[p];
+
+		}
+
+		double bruteForceTime = 0.0;
+		double gridTime = 0.0;
+
+		for (int frame = 0; frame < frames; frame++) {
+
+			double start = BenchmarkTimerNow();
+			bruteForceCollisions += BroadphaseBruteForceFrame(&ships, &projectiles);
+			bruteForceTime += BenchmarkTimerNow() - start;
+
+			BroadphaseMoveProjectiles(&projectiles);
+
+		}
+
+		for (int p = 0; p < numberOfProjectiles; p++) {
+
+			projectiles.x[p] = startingX[p];
+			projectiles.y[p] = startingY[p];
+
+		}
+
+		for (int frame = 0; frame < frames; frame++) {
+
+			double start = BenchmarkTimerNow();
+			gridCollisions += BroadphaseGridFrame(cells, &ships, &projectiles);
+			gridTime += BenchmarkTimerNow() - start;
+
+			BroadphaseMoveProjectiles(&projectiles);
+
+		}
+
+		bruteForceTimes[i] = bruteForceTime / frames;
+		gridTimes[i] = gridTime / frames;
+
+		printf("%11d  %5d   %11.2f   %6.2f   %6.2fx   %16.2f%s\n", numberOfProjectiles, numberOfShips,
+			   bruteForceTimes[i] * 1e6, gridTimes[i] * 1e6, bruteForceTimes[i] / gridTimes[i],
+			   (double)gridCollisions / frames, (bruteForceCollisions == gridCollisions) ? "" : "  MISMATCH");
+
+		failed |= (bruteForceCollisions != gridCollisions);
+
+		BroadphaseCirclesFree(&ships);
+		BroadphaseCirclesFree(&projectiles);
+		free(startingX);
+		free(startingY);
+
+	}
+
+	/*
+	 The crossover is the smallest count from which the grid is faster at every larger count too, so a single
+	 noisy measurement doesn't move it.
+	 */
+	int crossover = kBroadphaseBenchmarkCounts;
+
+	while (crossover > 0 && gridTimes[crossover - 1] < bruteForceTimes[crossover - 1]) {
+		crossover--;
+	}
+
+	if (crossover < kBroadphaseBenchmarkCounts) {
+		printf("The grid is faster from %d projectiles and %d ships.\n", kBroadphaseBenchmarkProjectiles[crossover],
+			   kBroadphaseBenchmarkProjectiles[crossover] / 4);
+	} else {
+		printf("The grid isn't faster at any of the counts measured.\n");
+	}
+
+	CollisionCellsFree(cells);
+
+	return failed;
+
+}
@@ -0,0 +1,151 @@
+//
+//  CollisionKernelBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Measures the CollisionKernel against the scalar bounding circle test it replaced, for sweeps of the sizes
+ the game makes: a projectile tested against the targets near it, up to every target on the screen, and
+ larger lists to show the trend. Both versions must find the same collisions.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "CollisionKernel.h"
+#include "Simulation.h"
+#include "BenchmarkTimer.h"
+
+/*
+ Candidate counts measured and the number of candidates tested for each count, which is split between as
+ many probes as it takes.
+ */
+static const unsigned int kCollisionKernelBenchmarkCounts[] = { 8, 16, 40, 80, 256, 1024 };
+#define kCollisionKernelBenchmarkTests 100000000u
+
+/*
+ The scalar test, one candidate at a time, as CollisionKernelTestCircles does for the candidates left over
+ after the vector loop. Kept out of line so that it is measured as a call, like the kernel.
+ */
+__attribute__((noinline))
+static unsigned int CollisionKernelBenchmarkScalar(float probeX, float probeY, float probeRadius,
+												   const float *x, const float *y, const float *radius,
+												   unsigned int count, uint32_t *hitMask) {
+
+	unsigned int hitCount = 0;
+
+	memset(hitMask, 0, sizeof(uint32_t) * CollisionKernelMaskWordCount(count));
+
+	for (unsigned int i = 0; i < count; i++) {
+
+		float xDistance = x[i] - probeX;
+		float yDistance = y[i] - probeY;
+		float minimumIntersectionDistance = radius[i] + probeRadius;
+
+		if (((xDistance * xDistance) + (yDistance * yDistance)) < (minimumIntersectionDistance * minimumIntersectionDistance)) {
+
+			hitMask[i / 32] |= 1u << (i % 32);
+			hitCount++;
+
+		}
+
+	}
+
+	return hitCount;
+
+}
+
+int main(void) {
+
+	SimulationRandom random;
+	SimulationRandomSeed(&random, 2011);
+
+	printf("%s\n", "candidates   scalar ns/candidate   kernel ns/candidate   speedup   hits/probe");
+
+	for (size_t c = 0; c < sizeof(kCollisionKernelBenchmarkCounts) / sizeof(kCollisionKernelBenchmarkCounts[0]); c++) {
+
+		unsigned int count = kCollisionKernelBenchmarkCounts[c];
+		unsigned int probes = kCollisionKernelBenchmarkTests / count;
+
+		float *x = malloc(sizeof(float) * count);
+		float *y = malloc(sizeof(float) * count);
+		float *radius = malloc(sizeof(float) * count);
+		uint32_t *scalarMask = malloc(sizeof(uint32_t) * CollisionKernelMaskWordCount(count));
+		uint32_t *kernelMask = malloc(sizeof(uint32_t) * CollisionKernelMaskWordCount(count));
+
+		/*
+		 Targets of both sizes spread over the screen, and projectile sized probes moving across it.
+		 */
+		for (unsigned int i = 0; i < count; i++) {
+
+			x[i] = (float)(SimulationRandomNext(&random) % kGameScreenWidth);
+			y[i] = (float)(SimulationRandomNext(&random) % kGameScreenHeight);
+			radius[i] = (i & 1) ? (kGameLargeTargetImageSize / 2.0f) : (kGameSmallTargetImageSize / 2.0f);
+
+		}
+
+		float probeRadius = kGameProjectileImageSize / 2.0f;
+		unsigned long scalarHits = 0;
+		unsigned long kernelHits = 0;
+		unsigned long mismatches = 0;
+
+		double start = BenchmarkTimerNow();
+
+		for (unsigned int p = 0; p < probes; p++) {
+			scalarHits += CollisionKernelBenchmarkScalar((float)(p % kGameScreenWidth), (float)((p * 7) % kGameScreenHeight), probeRadius,
+														 x, y, radius, count, scalarMask);
+		}
+
+		double scalarTime = BenchmarkTimerNow() - start;
+
+		start = BenchmarkTimerNow();
+
+		for (unsigned int p = 0; p < probes; p++) {
+			kernelHits += CollisionKernelTestCircles((float)(p % kGameScreenWidth), (float)((p * 7) % kGameScreenHeight), probeRadius,
+													 x, y, radius, count, kernelMask);
+		}
+
+		double kernelTime = BenchmarkTimerNow() - start;
+
+		/*
+		 Compare the masks of every probe on a shorter run, outside the timing.
+		 */
+		for (unsigned int p = 0; p < probes && p < 100000; p++) {
+
+			float probeX = (float)(p % kGameScreenWidth);
+			float probeY = (float)((p * 7) % kGameScreenHeight);
+			CollisionKernelBenchmarkScalar(probeX, probeY, probeRadius, x, y, radius, count, scalarMask);
+			CollisionKernelTestCircles(probeX, probeY, probeRadius, x, y, radius, count, kernelMask);
+
+			if (memcmp(scalarMask, kernelMask, sizeof(uint32_t) * CollisionKernelMaskWordCount(count)) != 0) {
+				mismatches++;
+			}
+
+		}
+
+		double tests = (double)probes * count;
+
+		printf("%10u   %19.3f   %19.3f   %6.2fx   %10.2f\n", count, scalarTime / tests * 1e9, kernelTime / tests * 1e9,
+			   scalarTime / kernelTime, (double)kernelHits / probes);
+
+		if (scalarHits != kernelHits || mismatches > 0) {
+
+			printf("the kernel and the scalar test disagree: %lu and %lu hits, %lu masks differ\n", kernelHits, scalarHits, mismatches);
+			return 1;
+
+		}
+
+		free(x);
+		free(y);
+		free(radius);
+		free(scalarMask);
+		free(kernelMask);
+
+	}
+
+	return 0;
+
+}
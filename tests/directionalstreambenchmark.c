@@ -0,0 +1,375 @@
+//
+//  DirectionalStreamBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Measures how many bytes per second the DirectionalStream sends for a ship, compared with sending every field
+ in every update as the WireProtocol did before it. The ship's movement is taken from a game played by the
+ Simulation with randomly steered players. It is sent at kLinkEstimatorMaximumSendRate updates per second, the
+ most often the MultiplayerActionLayer sends it, and at 10 updates per second, as it might be on a link which
+ is losing packets. A ship which sits still is measured too.
+
+ The updates and the acknowledgements sent back for them go through a link with a fixed latency which loses
+ a proportion of each at random, so the cost of the keyframes sent when the acknowledgements stop arriving is
+ counted. Time moves a millisecond at a time. At 10 updates per second an update sent over a 25 or a 50 ms
+ link is acknowledged before the next one is sent, so those runs send the same messages. Every update which
+ is decoded must match the state which was sent in it.
+
+ Only the messages are counted, not the headers of the batch packets they are sent in, which are shared with
+ everything else sent in the same batch.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "DirectionalStream.h"
+#include "LinkEstimator.h"
+#include "Simulation.h"
+#include "WireProtocol.h"
+
+/*
+ Largest number of messages in flight in either direction at once.
+ */
+#define kDirectionalStreamBenchmarkLinkCapacity 64
+
+/*
+ A message on it's way across the link. The state is what the receiver should decode from a directional
+ message, and isn't used for acknowledgements.
+ */
+typedef struct {
+
+	uint32_t deliveryTime;
+	uint8_t bytes[16];
+	size_t length;
+	DirectionalState state;
+
+} DirectionalStreamBenchmarkMessage;
+
+typedef struct {
+
+	DirectionalStreamBenchmarkMessage messages[kDirectionalStreamBenchmarkLinkCapacity];
+	unsigned int first;
+	unsigned int count;
+
+} DirectionalStreamBenchmarkLink;
+
+static void DirectionalStreamBenchmarkLinkPush(DirectionalStreamBenchmarkLink *link, const DirectionalStreamBenchmarkMessage *message) {
+
+	if (link->count < kDirectionalStreamBenchmarkLinkCapacity) {
+
+		link->messages[(link->first + link->count) % kDirectionalStreamBenchmarkLinkCapacity] = *message;
+		link->count++;
+
+	}
+
+}
+
+/*
+ Returns the oldest message which has arrived by the time specified, in milliseconds, or NULL if there is
+ none. Every message takes the same time to cross the link, so they arrive in the order they were sent.
+ */
+static DirectionalStreamBenchmarkMessage *DirectionalStreamBenchmarkLinkPop(DirectionalStreamBenchmarkLink *link, uint32_t now) {
+
+	if (link->count == 0 || link->messages[link->first].deliveryTime > now) {
+		return NULL;
+	}
+
+	DirectionalStreamBenchmarkMessage *message = &link->messages[link->first];
+	link->first = (link->first + 1) % kDirectionalStreamBenchmarkLinkCapacity;
+	link->count--;
+
+	return message;
+
+}
+
+/*
+ The movement of a ship sampled at the update rate, for the length of a game.
+ */
+#define kDirectionalStreamBenchmarkGameLength 120
+#define kDirectionalStreamBenchmarkMaximumUpdates (kDirectionalStreamBenchmarkGameLength * (int)kLinkEstimatorMaximumSendRate)
+
+typedef struct {
+
+	const char *name;
+	unsigned int updateRate;
+	unsigned int updateCount;
+	PlayerShipDirectionalInformation updates[kDirectionalStreamBenchmarkMaximumUpdates];
+
+} DirectionalStreamBenchmarkTrace;
+
+static void DirectionalStreamBenchmarkInputs(const Simulation *simulation, SimulationInput *inputs, void *context) {
+
+	SimulationRandom *random = (SimulationRandom *)context;
+	static SimulationInput held[kSimulationMaximumPlayers];
+
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		//The device is tilted to a new heading and speed about twice a second.
+		if ((SimulationRandomNext(random) % 30) == 0) {
+
+			held[p].heading = (float)(SimulationRandomNext(random) % 360);
+			held[p].speed = (float)(SimulationRandomNext(random) % (int)simulation->config.playerMaximumSpeed);
+
+		}
+
+		inputs[p] = held[p];
+
+	}
+
+}
+
+/*
+ Plays a game and samples the first player at the update rate of the trace.
+ */
+static void DirectionalStreamBenchmarkPlayTrace(DirectionalStreamBenchmarkTrace *trace) {
+
+	SimulationConfig config;
+	SimulationRandom random;
+	SimulationInput inputs[kSimulationMaximumPlayers];
+
+	SimulationConfigDefaults(&config, 2);
+	config.gameLength = kDirectionalStreamBenchmarkGameLength;
+	SimulationRandomSeed(&random, 40);
+
+	Simulation *simulation = SimulationNew(&config, 11);
+	unsigned int update = 0;
+
+	trace->name = "played";
+	trace->updateCount = kDirectionalStreamBenchmarkGameLength * trace->updateRate;
+
+	while (!SimulationIsGameOver(simulation) && update < trace->updateCount) {
+
+		memset(inputs, 0, sizeof(inputs));
+		DirectionalStreamBenchmarkInputs(simulation, inputs, &random);
+		SimulationStep(simulation, inputs);
+
+		//Sample the first player whenever the next update is due.
+		if ((float)simulation->tick * kSimulationTimestep >= (float)update / trace->updateRate) {
+
+			const SimulationPlayer *player = &simulation->players[0];
+			PlayerShipDirectionalInformation information = { player->heading, player->speed, player->x, player->y, player->heading };
+
+			trace->updates[update] = information;
+			update++;
+
+		}
+
+	}
+
+	for (; update < trace->updateCount; update++) {
+		trace->updates[update] = trace->updates[update - 1];
+	}
+
+	SimulationFree(simulation);
+
+}
+
+static void DirectionalStreamBenchmarkStillTrace(DirectionalStreamBenchmarkTrace *trace) {
+
+	PlayerShipDirectionalInformation information = { 90.0f, 0.0f, 240.0f, 150.0f, 90.0f };
+
+	trace->name = "still";
+	trace->updateCount = kDirectionalStreamBenchmarkGameLength * trace->updateRate;
+
+	for (unsigned int update = 0; update < trace->updateCount; update++) {
+		trace->updates[update] = information;
+	}
+
+}
+
+static DirectionalState DirectionalStreamBenchmarkQuantize(const PlayerShipDirectionalInformation *information) {
+
+	DirectionalState state;
+
+	state.heading = WireQuantizeHeading(information->newHeading);
+	state.speed = WireQuantizeSpeed(information->newSpeed);
+	state.positionX = WireQuantizePosition(information->currentPositionX);
+	state.positionY = WireQuantizePosition(information->currentPositionY);
+	state.rotation = WireQuantizeHeading(information->currentRotation);
+
+	return state;
+
+}
+
+/*
+ Sends the trace over a link with the one-way latency, in milliseconds, and loss specified. Time moves on a
+ millisecond at a time, so an update is decoded and acknowledged as soon as it arrives rather than at the
+ next update. The losses of the updates and of the acknowledgements are drawn from their own random
+ sequences, which are the same whatever the latency, so runs with different latencies lose the same
+ updates. Returns 0 if any update was decoded wrongly.
+ */
+static int DirectionalStreamBenchmarkRun(const DirectionalStreamBenchmarkTrace *trace, unsigned int latency, unsigned int lossPercent) {
+
+	DirectionalStreamSender sender;
+	DirectionalStreamReceiver receiver;
+	static DirectionalStreamBenchmarkLink updates;
+	static DirectionalStreamBenchmarkLink acknowledgements;
+	SimulationRandom updateLoss;
+	SimulationRandom acknowledgementLoss;
+	unsigned long messagesSent = 0;
+	unsigned long keyframesSent = 0;
+	unsigned long messagesDecoded = 0;
+	unsigned long wrongDecodes = 0;
+	size_t updateBytes = 0;
+	size_t acknowledgementBytes = 0;
+	size_t fullStateBytes = 0;
+	uint32_t update = 0;
+	uint32_t duration = trace->updateCount * 1000 / trace->updateRate;
+
+	DirectionalStreamSenderInit(&sender);
+	DirectionalStreamReceiverInit(&receiver);
+	memset(&updates, 0, sizeof(updates));
+	memset(&acknowledgements, 0, sizeof(acknowledgements));
+	SimulationRandomSeed(&updateLoss, 41);
+	SimulationRandomSeed(&acknowledgementLoss, 42);
+
+	for (uint32_t now = 0; now < duration; now++) {
+
+		DirectionalStreamBenchmarkMessage *message;
+		DirectionalStreamBenchmarkMessage outgoing;
+		WireWriter writer;
+		WireReader reader;
+
+		//Acknowledgements which have arrived back at the sender.
+		while ((message = DirectionalStreamBenchmarkLinkPop(&acknowledgements, now)) != NULL) {
+
+			WireReaderInit(&reader, message->bytes, message->length);
+			DirectionalStreamSenderAcknowledge(&sender, (uint8_t)WireReadVarUInt(&reader));
+
+		}
+
+		//The next update is due once it's time has been reached.
+		if (update < trace->updateCount && (uint64_t)update * 1000 <= (uint64_t)now * trace->updateRate) {
+
+			/*
+			 What the WireProtocol sent before: every field, every update.
+			 */
+			uint8_t fullBytes[16];
+			WireWriter fullWriter;
+			WireWriterInit(&fullWriter, fullBytes, sizeof(fullBytes));
+			WireWriteDirectionalInformation(&fullWriter, &trace->updates[update]);
+			fullStateBytes += WireMessageSize(fullWriter.length);
+
+			WireWriterInit(&writer, outgoing.bytes, sizeof(outgoing.bytes));
+
+			if (DirectionalStreamSenderWrite(&sender, &writer, &trace->updates[update])) {
+
+				outgoing.length = writer.length;
+				outgoing.deliveryTime = now + latency;
+				outgoing.state = DirectionalStreamBenchmarkQuantize(&trace->updates[update]);
+				updateBytes += WireMessageSize(writer.length);
+				messagesSent++;
+
+				//The bottom bits of the second byte are the baseline offset, which is 0 for a keyframe.
+				if ((outgoing.bytes[1] & 0x07) == 0) {
+					keyframesSent++;
+				}
+
+				if ((SimulationRandomNext(&updateLoss) % 100) >= lossPercent) {
+					DirectionalStreamBenchmarkLinkPush(&updates, &outgoing);
+				}
+
+			}
+
+			update++;
+
+		}
+
+		//Updates which have arrived at the receiver, which acknowledges those it is due to.
+		while ((message = DirectionalStreamBenchmarkLinkPop(&updates, now)) != NULL) {
+
+			PlayerShipDirectionalInformation information;
+			uint8_t sequence;
+
+			WireReaderInit(&reader, message->bytes, message->length);
+
+			if (!DirectionalStreamReceiverRead(&receiver, &reader, &information, &sequence)) {
+				continue;
+			}
+
+			DirectionalState decoded = DirectionalStreamBenchmarkQuantize(&information);
+
+			if (memcmp(&decoded, &message->state, sizeof(DirectionalState)) != 0) {
+				wrongDecodes++;
+			}
+
+			messagesDecoded++;
+
+			if (!DirectionalStreamReceiverAcknowledgementDue(&receiver)) {
+				continue;
+			}
+
+			DirectionalStreamBenchmarkMessage acknowledgement;
+			WireWriterInit(&writer, acknowledgement.bytes, sizeof(acknowledgement.bytes));
+			WireWriteVarUInt(&writer, sequence);
+			acknowledgement.length = writer.length;
+			acknowledgement.deliveryTime = now + latency;
+			acknowledgementBytes += WireMessageSize(writer.length);
+
+			if ((SimulationRandomNext(&acknowledgementLoss) % 100) >= lossPercent) {
+				DirectionalStreamBenchmarkLinkPush(&acknowledgements, &acknowledgement);
+			}
+
+		}
+
+	}
+
+	double seconds = (double)trace->updateCount / trace->updateRate;
+	double fullRate = fullStateBytes / seconds;
+	double streamRate = (updateBytes + acknowledgementBytes) / seconds;
+
+	printf("%-6s %4u/s %4u ms %3u%%   %8.0f   %8.0f   %8.0f   %6.1f%%   %7lu   %9lu   %7lu\n",
+		   trace->name, trace->updateRate, latency, lossPercent,
+		   fullRate, updateBytes / seconds, acknowledgementBytes / seconds,
+		   100.0 * (1.0 - streamRate / fullRate), messagesSent, keyframesSent, messagesDecoded);
+
+	if (wrongDecodes > 0) {
+
+		printf("%lu updates were decoded wrongly\n", wrongDecodes);
+		return 0;
+
+	}
+
+	return 1;
+
+}
+
+int main(void) {
+
+	static const unsigned int rates[] = { (unsigned int)kLinkEstimatorMaximumSendRate, 10 };
+	//One-way latencies in milliseconds.
+	static const unsigned int latencies[] = { 25, 50, 100 };
+	static const unsigned int losses[] = { 0, 5, 20 };
+	static DirectionalStreamBenchmarkTrace trace;
+	int correct = 1;
+
+	printf("%d s of updates. Bytes/s: full is every field in every update, the stream sends updates one way and acks the other.\n",
+		   kDirectionalStreamBenchmarkGameLength);
+	printf("%s\n", "trace    rate one-way loss   full B/s   upd. B/s    ack B/s    saved      sent   keyframes  decoded");
+
+	for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+
+		trace.updateRate = rates[r];
+		DirectionalStreamBenchmarkPlayTrace(&trace);
+
+		for (size_t l = 0; l < sizeof(latencies) / sizeof(latencies[0]); l++) {
+
+			for (size_t p = 0; p < sizeof(losses) / sizeof(losses[0]); p++) {
+				correct &= DirectionalStreamBenchmarkRun(&trace, latencies[l], losses[p]);
+			}
+
+		}
+
+	}
+
+	trace.updateRate = (unsigned int)kLinkEstimatorMaximumSendRate;
+	DirectionalStreamBenchmarkStillTrace(&trace);
+	correct &= DirectionalStreamBenchmarkRun(&trace, 50, 0);
+	correct &= DirectionalStreamBenchmarkRun(&trace, 50, 20);
+
+	return correct ? 0 : 1;
+
+}
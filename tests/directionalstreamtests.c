@@ -0,0 +1,281 @@
+//
+//  DirectionalStreamTests.c
+//  AberFighter
+//
+//  Created by wde7 on 02/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the DirectionalStream: decoding against acknowledged baselines, when the sender can stop sending
+ a ship which isn't moving, messages which arrive out of order or against a baseline the receiver doesn't
+ have, and when the receiver acknowledges.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "DirectionalStream.h"
+#include "TestCheck.h"
+
+static const PlayerShipDirectionalInformation testStateA = { 90.0f, 40.0f, 240.0f, 150.0f, 90.0f, 1000 };
+static const PlayerShipDirectionalInformation testStateB = { 180.0f, 60.0f, 241.0f, 149.0f, 180.0f, 65000 };
+
+/*
+ A message as it was written by the sender.
+ */
+typedef struct {
+
+	uint8_t bytes[16];
+	size_t length;
+
+} TestMessage;
+
+/*
+ Writes the state specified. Returns 1 if a message was written.
+ */
+static int TestWrite(DirectionalStreamSender *sender, const PlayerShipDirectionalInformation *information, TestMessage *message) {
+
+	WireWriter writer;
+
+	WireWriterInit(&writer, message->bytes, sizeof(message->bytes));
+
+	int written = DirectionalStreamSenderWrite(sender, &writer, information);
+	message->length = writer.length;
+
+	TestCheck(!writer.overflow);
+	TestCheck(written || writer.length == 0);
+
+	return written;
+
+}
+
+/*
+ Reads a message. Returns 1 if it was decoded, and checks that it decoded to the state expected.
+ */
+static int TestRead(DirectionalStreamReceiver *receiver, const TestMessage *message, const PlayerShipDirectionalInformation *expected, uint8_t *sequence) {
+
+	WireReader reader;
+	PlayerShipDirectionalInformation information;
+
+	WireReaderInit(&reader, message->bytes, message->length);
+
+	if (!DirectionalStreamReceiverRead(receiver, &reader, &information, sequence)) {
+		return 0;
+	}
+
+	TestCheckClose(information.newHeading, expected->newHeading, 1.5);
+	TestCheckClose(information.newSpeed, expected->newSpeed, 0.5);
+	TestCheckClose(information.currentPositionX, expected->currentPositionX, 0.1);
+	TestCheckClose(information.currentPositionY, expected->currentPositionY, 0.1);
+	TestCheckClose(information.currentRotation, expected->currentRotation, 1.5);
+	TestCheck(information.sendTime == expected->sendTime);
+
+	return 1;
+
+}
+
+static void TestDecodesAgainstAcknowledgedBaseline(void) {
+
+	DirectionalStreamSender sender;
+	DirectionalStreamReceiver receiver;
+	TestMessage keyframe, delta;
+	uint8_t sequence;
+
+	DirectionalStreamSenderInit(&sender);
+	DirectionalStreamReceiverInit(&receiver);
+
+	TestCheck(TestWrite(&sender, &testStateA, &keyframe));
+	TestCheck(TestRead(&receiver, &keyframe, &testStateA, &sequence));
+	TestCheck(sequence == 0);
+	//The offset in the bottom bits is 0 for a keyframe.
+	TestCheck((keyframe.bytes[1] & 0x07) == 0);
+
+	DirectionalStreamSenderAcknowledge(&sender, sequence);
+
+	//Only the changed fields are sent against the baseline, so the delta is smaller than the keyframe.
+	TestCheck(TestWrite(&sender, &testStateB, &delta));
+	TestCheck((delta.bytes[1] & 0x07) == 1);
+	TestCheck(delta.length < keyframe.length);
+	TestCheck(TestRead(&receiver, &delta, &testStateB, &sequence));
+	TestCheck(sequence == 1);
+
+}
+
+static void TestStillShipStopsOnceAcknowledged(void) {
+
+	DirectionalStreamSender sender;
+	TestMessage message;
+
+	DirectionalStreamSenderInit(&sender);
+
+	TestCheck(TestWrite(&sender, &testStateA, &message));
+
+	//Until it's acknowledged the state is sent again, in case the message was lost.
+	TestCheck(TestWrite(&sender, &testStateA, &message));
+
+	DirectionalStreamSenderAcknowledge(&sender, 0);
+
+	TestCheck(!TestWrite(&sender, &testStateA, &message));
+	TestCheck(!TestWrite(&sender, &testStateA, &message));
+
+	/*
+	 Once the ship moves it's sent until one of the messages with the new state is acknowledged, even an older
+	 one than the newest.
+	 */
+	TestCheck(TestWrite(&sender, &testStateB, &message));
+	TestCheck(TestWrite(&sender, &testStateB, &message));
+	TestCheck(TestWrite(&sender, &testStateB, &message));
+
+	DirectionalStreamSenderAcknowledge(&sender, 2);
+
+	TestCheck(!TestWrite(&sender, &testStateB, &message));
+
+}
+
+/*
+ The ship moves from A to B and back to A before B is acknowledged. The state is the same as the one
+ acknowledged, but the peer may have applied B, so A must be sent again.
+ */
+static void TestReturnToAcknowledgedStateIsSent(void) {
+
+	DirectionalStreamSender sender;
+	DirectionalStreamReceiver receiver;
+	TestMessage first, second, third;
+	uint8_t sequence;
+
+	DirectionalStreamSenderInit(&sender);
+	DirectionalStreamReceiverInit(&receiver);
+
+	TestCheck(TestWrite(&sender, &testStateA, &first));
+	TestCheck(TestRead(&receiver, &first, &testStateA, &sequence));
+	DirectionalStreamSenderAcknowledge(&sender, sequence);
+
+	TestCheck(TestWrite(&sender, &testStateB, &second));
+	TestCheck(TestRead(&receiver, &second, &testStateB, &sequence));
+
+	TestCheck(TestWrite(&sender, &testStateA, &third));
+	TestCheck(TestRead(&receiver, &third, &testStateA, &sequence));
+	TestCheck(sequence == 2);
+
+	//Acknowledging B doesn't stop A being sent, but acknowledging A does.
+	DirectionalStreamSenderAcknowledge(&sender, 1);
+	TestCheck(TestWrite(&sender, &testStateA, &third));
+	DirectionalStreamSenderAcknowledge(&sender, 3);
+	TestCheck(!TestWrite(&sender, &testStateA, &third));
+
+}
+
+static void TestOutOfOrderAndUnknownBaseline(void) {
+
+	DirectionalStreamSender sender;
+	DirectionalStreamReceiver receiver;
+	TestMessage keyframe, first, second;
+	uint8_t sequence;
+
+	DirectionalStreamSenderInit(&sender);
+	DirectionalStreamReceiverInit(&receiver);
+
+	TestCheck(TestWrite(&sender, &testStateA, &keyframe));
+	DirectionalStreamSenderAcknowledge(&sender, 0);
+	TestCheck(TestWrite(&sender, &testStateB, &first));
+	TestCheck(TestWrite(&sender, &testStateA, &second));
+
+	//The keyframe was lost, so neither delta has a baseline the receiver knows.
+	TestCheck(!TestRead(&receiver, &first, &testStateB, &sequence));
+	TestCheck(!TestRead(&receiver, &second, &testStateA, &sequence));
+
+	TestCheck(TestRead(&receiver, &keyframe, &testStateA, &sequence));
+	TestCheck(TestRead(&receiver, &second, &testStateA, &sequence));
+	TestCheck(sequence == 2);
+
+	//The first delta is older than the second, which has already been applied.
+	TestCheck(!TestRead(&receiver, &first, &testStateB, &sequence));
+
+}
+
+/*
+ Baselines of 7 or more messages before are referred to by an offset in an extra byte. When no
+ acknowledgement is recent enough to be in the history, a keyframe is sent.
+ */
+static void TestKeyframeWhenAcknowledgementIsTooOld(void) {
+
+	DirectionalStreamSender sender;
+	DirectionalStreamReceiver receiver;
+	TestMessage message;
+	PlayerShipDirectionalInformation information = testStateA;
+	uint8_t sequence;
+
+	DirectionalStreamSenderInit(&sender);
+	DirectionalStreamReceiverInit(&receiver);
+
+	TestCheck(TestWrite(&sender, &information, &message));
+	TestCheck(TestRead(&receiver, &message, &information, &sequence));
+	DirectionalStreamSenderAcknowledge(&sender, 0);
+
+	for (int i = 1; i < kDirectionalStreamHistorySize; i++) {
+
+		information.currentPositionX += 1.0f;
+		TestCheck(TestWrite(&sender, &information, &message));
+		TestCheck(TestRead(&receiver, &message, &information, &sequence));
+
+		if (i < 7) {
+			TestCheck((message.bytes[1] & 0x07) == i);
+		} else {
+			TestCheck((message.bytes[1] & 0x07) == 7 && message.bytes[2] == i);
+		}
+
+	}
+
+	information.currentPositionX += 1.0f;
+	TestCheck(TestWrite(&sender, &information, &message));
+	TestCheck((message.bytes[1] & 0x07) == 0);
+
+	//An acknowledgement of a message which has left the history is ignored.
+	DirectionalStreamSenderAcknowledge(&sender, 0);
+	TestCheck(TestWrite(&sender, &information, &message));
+	TestCheck((message.bytes[1] & 0x07) == 0);
+
+}
+
+static void TestAcknowledgementDue(void) {
+
+	DirectionalStreamSender sender;
+	DirectionalStreamReceiver receiver;
+	TestMessage message;
+	PlayerShipDirectionalInformation information = testStateA;
+	uint8_t sequence;
+	int acknowledgements = 0;
+
+	DirectionalStreamSenderInit(&sender);
+	DirectionalStreamReceiverInit(&receiver);
+
+	//A keyframe is acknowledged straight away.
+	TestCheck(TestWrite(&sender, &information, &message));
+	TestCheck(TestRead(&receiver, &message, &information, &sequence));
+	TestCheck(DirectionalStreamReceiverAcknowledgementDue(&receiver));
+	DirectionalStreamSenderAcknowledge(&sender, sequence);
+
+	for (int i = 0; i < 4 * kDirectionalStreamAcknowledgementInterval; i++) {
+
+		information.currentPositionY += 1.0f;
+		TestCheck(TestWrite(&sender, &information, &message));
+		TestCheck(TestRead(&receiver, &message, &information, &sequence));
+		acknowledgements += DirectionalStreamReceiverAcknowledgementDue(&receiver);
+
+	}
+
+	TestCheck(acknowledgements == 4);
+
+}
+
+int main(void) {
+
+	TestDecodesAgainstAcknowledgedBaseline();
+	TestStillShipStopsOnceAcknowledged();
+	TestReturnToAcknowledgedStateIsSent();
+	TestOutOfOrderAndUnknownBaseline();
+	TestKeyframeWhenAcknowledgementIsTooOld();
+	TestAcknowledgementDue();
+
+	return TestCheckResult();
+
+}
@@ -0,0 +1,288 @@
+//
+//  EntityStoreTests.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the EntityStore: adding entities, removing them by moving the last entity into the empty slot,
+ integrating their positions and growing the arrays.
+ */
+
+#include <stdlib.h>
+#include "EntityStore.h"
+#include "TestCheck.h"
+
+/*
+ Views are only compared by address, so the entries of this array stand in for the sprites.
+ */
+static int views[8];
+
+static void TestAdd(void) {
+
+	EntityStore *store = EntityStoreNew(4);
+	TestCheck(store != NULL);
+	TestCheck(store->count == 0);
+	TestCheck(store->capacity == 4);
+
+	int first = EntityStoreAdd(store, 10.0f, 20.0f, 90.0f, 5.0f, 22.0f, 3, 1, 2, &views[0]);
+	int second = EntityStoreAdd(store, 30.0f, 40.0f, 0.0f, 6.0f, 25.0f, 1, 0, 1, &views[1]);
+
+	TestCheck(first == 0);
+	TestCheck(second == 1);
+	TestCheck(store->count == 2);
+
+	TestCheckClose(store->positionX[0], 10.0f, 0.0);
+	TestCheckClose(store->positionY[0], 20.0f, 0.0);
+	TestCheckClose(store->heading[0], 90.0f, 0.0);
+	TestCheckClose(store->speed[0], 5.0f, 0.0);
+	TestCheckClose(store->radius[0], 22.0f, 0.0);
+	TestCheck(store->shield[0] == 3);
+	TestCheck(store->owner[0] == 1);
+	TestCheck(store->type[0] == 2);
+	TestCheckClose(store->age[0], 0.0f, 0.0);
+	TestCheck(store->views[0] == &views[0]);
+	TestCheck(store->views[1] == &views[1]);
+
+	//0 degrees is up the screen and headings go clockwise, so 90 degrees is along the x axis.
+	TestCheckClose(store->directionX[0], 1.0f, 1e-6);
+	TestCheckClose(store->directionY[0], 0.0f, 1e-6);
+	TestCheckClose(store->directionX[1], 0.0f, 1e-6);
+	TestCheckClose(store->directionY[1], 1.0f, 1e-6);
+
+	EntityStoreFree(store);
+
+}
+
+static void TestRemove(void) {
+
+	EntityStore *store = EntityStoreNew(4);
+
+	for (int i = 0; i < 4; i++) {
+		EntityStoreAdd(store, (float)i, (float)(i * 10), (float)(i * 45), (float)i, 1.0f, i, i, i, &views[i]);
+	}
+
+	/*
+	 Removing from the middle moves the last entity, and all of it's data, into the empty slot and returns
+	 it's view so that the caller can update the index it holds.
+	 */
+	void *moved = EntityStoreRemove(store, 1);
+
+	TestCheck(moved == &views[3]);
+	TestCheck(store->count == 3);
+	TestCheck(store->views[1] == &views[3]);
+	TestCheckClose(store->positionX[1], 3.0f, 0.0);
+	TestCheckClose(store->positionY[1], 30.0f, 0.0);
+	TestCheckClose(store->heading[1], 135.0f, 0.0);
+	TestCheckClose(store->directionX[1], 0.70710678f, 1e-6);
+	TestCheckClose(store->directionY[1], -0.70710678f, 1e-6);
+	TestCheck(store->shield[1] == 3);
+	TestCheck(store->owner[1] == 3);
+	TestCheck(store->type[1] == 3);
+
+	//The entities before the removed one don't move.
+	TestCheck(store->views[0] == &views[0]);
+	TestCheck(store->views[2] == &views[2]);
+
+	//Removing the last entity moves nothing.
+	TestCheck(EntityStoreRemove(store, 2) == NULL);
+	TestCheck(store->count == 2);
+	TestCheck(store->views[0] == &views[0]);
+	TestCheck(store->views[1] == &views[3]);
+
+	//Indices past the end are ignored.
+	TestCheck(EntityStoreRemove(store, 2) == NULL);
+	TestCheck(store->count == 2);
+
+	TestCheck(EntityStoreRemove(store, 0) == &views[3]);
+	TestCheck(EntityStoreRemove(store, 0) == NULL);
+	TestCheck(store->count == 0);
+	TestCheck(EntityStoreRemove(store, 0) == NULL);
+
+	EntityStoreFree(store);
+
+}
+
+/*
+ Removes entities in a scrambled order, keeping a table of each view's index up to date from the views
+ returned, as the layers do, and checks the table against the store after every removal.
+ */
+static void TestRemoveRemapsIndices(void) {
+
+	EntityStore *store = EntityStoreNew(8);
+	int indexOfView[8];
+
+	for (int i = 0; i < 8; i++) {
+		indexOfView[i] = EntityStoreAdd(store, (float)i, 0.0f, 0.0f, 0.0f, 1.0f, 0, 0, i, &views[i]);
+	}
+
+	int removals[8] = { 5, 0, 7, 2, 3, 6, 1, 4 };
+
+	for (int r = 0; r < 8; r++) {
+
+		int view = removals[r];
+		int *moved = (int *)EntityStoreRemove(store, (unsigned int)indexOfView[view]);
+
+		if (moved != NULL) {
+			indexOfView[moved - views] = indexOfView[view];
+		}
+
+		indexOfView[view] = kEntityIndexNone;
+
+		TestCheck(store->count == (unsigned int)(7 - r));
+
+		for (int i = 0; i < 8; i++) {
+
+			if (indexOfView[i] != kEntityIndexNone) {
+				TestCheck(store->views[indexOfView[i]] == &views[i]);
+				TestCheck(store->type[indexOfView[i]] == i);
+				TestCheckClose(store->positionX[indexOfView[i]], (float)i, 0.0);
+			}
+
+		}
+
+	}
+
+	EntityStoreFree(store);
+
+}
+
+static void TestIntegrate(void) {
+
+	EntityStore *store = EntityStoreNew(4);
+
+	EntityStoreAdd(store, 0.0f, 0.0f, 0.0f, 10.0f, 1.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 100.0f, 100.0f, 90.0f, 20.0f, 1.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 50.0f, 50.0f, 225.0f, 0.0f, 1.0f, 0, 0, 0, NULL);
+
+	EntityStoreIntegrate(store, 0.5f);
+
+	TestCheckClose(store->positionX[0], 0.0f, 1e-4);
+	TestCheckClose(store->positionY[0], 5.0f, 1e-4);
+	TestCheckClose(store->positionX[1], 110.0f, 1e-4);
+	TestCheckClose(store->positionY[1], 100.0f, 1e-4);
+	TestCheckClose(store->positionX[2], 50.0f, 1e-4);
+	TestCheckClose(store->positionY[2], 50.0f, 1e-4);
+	TestCheckClose(store->age[0], 0.5f, 1e-6);
+
+	//Changing the heading changes the direction the next integration moves in.
+	EntityStoreSetHeading(store, 0, 180.0f);
+	EntityStoreIntegrate(store, 0.25f);
+
+	TestCheckClose(store->positionX[0], 0.0f, 1e-4);
+	TestCheckClose(store->positionY[0], 2.5f, 1e-4);
+	TestCheckClose(store->age[0], 0.75f, 1e-6);
+	TestCheckClose(store->age[2], 0.75f, 1e-6);
+
+	EntityStoreFree(store);
+
+}
+
+/*
+ Entities reaching outside the area are moved back so that they touch the edge, and those inside it are left
+ alone.
+ */
+static void TestConfine(void) {
+
+	EntityStore *store = EntityStoreNew(4);
+
+	EntityStoreAdd(store, 5.0f, 50.0f, 0.0f, 0.0f, 10.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 480.0f, 400.0f, 0.0f, 0.0f, 10.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 240.0f, -20.0f, 0.0f, 0.0f, 22.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 100.0f, 100.0f, 0.0f, 0.0f, 22.0f, 0, 0, 0, NULL);
+
+	EntityStoreConfine(store, 0.0f, 0.0f, 480.0f, 300.0f);
+
+	TestCheckClose(store->positionX[0], 10.0f, 1e-6);
+	TestCheckClose(store->positionY[0], 50.0f, 1e-6);
+	TestCheckClose(store->positionX[1], 470.0f, 1e-6);
+	TestCheckClose(store->positionY[1], 290.0f, 1e-6);
+	TestCheckClose(store->positionX[2], 240.0f, 1e-6);
+	TestCheckClose(store->positionY[2], 22.0f, 1e-6);
+	TestCheckClose(store->positionX[3], 100.0f, 1e-6);
+	TestCheckClose(store->positionY[3], 100.0f, 1e-6);
+
+	EntityStoreFree(store);
+
+}
+
+static void TestFindCollisions(void) {
+
+	EntityStore *store = EntityStoreNew(4);
+	unsigned int hits[4];
+
+	EntityStoreAdd(store, 0.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 100.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0, 0, 0, NULL);
+	EntityStoreAdd(store, 15.0f, 0.0f, 0.0f, 0.0f, 10.0f, 0, 0, 0, NULL);
+
+	TestCheck(EntityStoreFindCollisions(store, 5.0f, 0.0f, 1.0f, hits, 4) == 2);
+	TestCheck(hits[0] == 0);
+	TestCheck(hits[1] == 2);
+
+	//Circles which only touch don't collide.
+	TestCheck(EntityStoreFindCollisions(store, 120.0f, 0.0f, 10.0f, hits, 4) == 0);
+
+	//No more hits than asked for are written.
+	TestCheck(EntityStoreFindCollisions(store, 5.0f, 0.0f, 1.0f, hits, 1) == 1);
+
+	EntityStoreFree(store);
+
+}
+
+static void TestGrow(void) {
+
+	//A store created with no capacity still has room for one entity.
+	EntityStore *store = EntityStoreNew(0);
+	TestCheck(store->capacity == 1);
+
+	/*
+	 Adding to a full store doubles it's capacity and keeps the entities already in it.
+	 */
+	for (int i = 0; i < 5; i++) {
+		TestCheck(EntityStoreAdd(store, (float)i, 0.0f, 0.0f, 0.0f, 1.0f, 0, 0, i, &views[i]) == i);
+	}
+
+	TestCheck(store->capacity == 8);
+	TestCheck(store->count == 5);
+
+	for (int i = 0; i < 5; i++) {
+		TestCheck(store->views[i] == &views[i]);
+		TestCheck(store->type[i] == i);
+	}
+
+	//Reserving less than the capacity does nothing.
+	TestCheck(EntityStoreReserve(store, 6));
+	TestCheck(store->capacity == 8);
+
+	TestCheck(EntityStoreReserve(store, 100));
+	TestCheck(store->capacity == 100);
+	TestCheck(store->count == 5);
+	TestCheck(store->views[4] == &views[4]);
+
+	//Removing every entity keeps the memory.
+	EntityStoreRemoveAll(store);
+	TestCheck(store->count == 0);
+	TestCheck(store->capacity == 100);
+	TestCheck(EntityStoreAdd(store, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0, 0, 0, NULL) == 0);
+
+	EntityStoreFree(store);
+
+	//Freeing NULL is allowed, as it is for free.
+	EntityStoreFree(NULL);
+
+}
+
+int main(void) {
+
+	TestAdd();
+	TestRemove();
+	TestRemoveRemapsIndices();
+	TestIntegrate();
+	TestConfine();
+	TestFindCollisions();
+	TestGrow();
+
+	return TestCheckResult();
+
+}
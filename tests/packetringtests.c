@@ -0,0 +1,354 @@
+//
+//  PacketRingTests.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the PacketRing and the NetworkEventQueue. Besides checking them on a single thread, each is
+ flooded by a producer thread while a consumer thread empties it, as the transport's receive thread and the
+ game loop do. The consumer stops now and then so that the producer keeps finding it full. Every item must
+ arrive once, in order and intact, and every push which was refused must be counted as dropped.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "PacketRing.h"
+#include "NetworkEventQueue.h"
+#include "WireProtocol.h"
+#include "TestCheck.h"
+
+/*
+ Number of items sent through each ring by the flood tests.
+ */
+#define kPacketRingTestFloodCount 1000000
+
+/*
+ The consumer pauses after taking this many items so that the ring fills up behind it.
+ */
+#define kPacketRingTestConsumerPauseInterval 4096
+
+/*
+ Returns the byte at the index of the data of the packet with the packet number specified.
+ */
+static uint8_t PacketRingTestByte(uint32_t packetNumber, size_t index) {
+
+	return (uint8_t)((packetNumber * 31) + (index * 7));
+
+}
+
+/*
+ Returns the number of bytes which follow the header of the packet with the packet number specified,
+ anywhere from none to the most which fit.
+ */
+static size_t PacketRingTestDataLength(uint32_t packetNumber) {
+
+	return (packetNumber * 37) % (kPacketRingMaximumPacketSize - kWireProtocolMaximumHeaderSize + 1);
+
+}
+
+/*
+ Writes the packet with the packet number specified into bytes and returns it's length.
+ */
+static size_t PacketRingTestMakePacket(uint32_t packetNumber, uint8_t *bytes) {
+
+	WireWriter writer;
+	size_t dataLength = PacketRingTestDataLength(packetNumber);
+
+	WireWriterInit(&writer, bytes, kPacketRingMaximumPacketSize);
+	WireWriteHeader(&writer, (uint8_t)packetNumber, packetNumber);
+
+	for (size_t i = 0; i < dataLength; i++) {
+		WireWriteUInt8(&writer, PacketRingTestByte(packetNumber, i));
+	}
+
+	return writer.length;
+
+}
+
+static void PacketRingTestPause(void) {
+
+	struct timespec pause = { 0, 100000 };
+	nanosleep(&pause, NULL);
+
+}
+
+static void TestPacketRing(void) {
+
+	static PacketRing ring;
+	uint8_t bytes[kPacketRingMaximumPacketSize + 1];
+
+	PacketRingInit(&ring);
+	TestCheck(PacketRingPeek(&ring) == NULL);
+
+	/*
+	 Packets with a bad header or which are too large never enter the ring.
+	 */
+	size_t length = PacketRingTestMakePacket(1, bytes);
+	bytes[0] = kWireProtocolVersion + 1;
+	TestCheck(!PacketRingPush(&ring, bytes, length, 0, 0.0));
+	TestCheck(!PacketRingPush(&ring, bytes, 1, 0, 0.0));
+	TestCheck(!PacketRingPush(&ring, bytes, kPacketRingMaximumPacketSize + 1, 0, 0.0));
+	TestCheck(PacketRingPeek(&ring) == NULL);
+	TestCheck(ring.droppedPackets == 0);
+
+	/*
+	 Filling the ring drops the next packet, and releasing one makes room for it.
+	 */
+	for (uint32_t i = 0; i < kPacketRingCapacity; i++) {
+
+		length = PacketRingTestMakePacket(i, bytes);
+		TestCheck(PacketRingPush(&ring, bytes, length, (int)i, (double)i));
+
+	}
+
+	length = PacketRingTestMakePacket(kPacketRingCapacity, bytes);
+	TestCheck(!PacketRingPush(&ring, bytes, length, 0, 0.0));
+	TestCheck(ring.droppedPackets == 1);
+
+	const ReceivedPacket *packet = PacketRingPeek(&ring);
+	TestCheck(packet != NULL && packet->header.packetNumber == 0);
+	//Peeking again returns the same packet until it is released.
+	TestCheck(PacketRingPeek(&ring) == packet);
+	PacketRingRelease(&ring);
+
+	TestCheck(PacketRingPush(&ring, bytes, length, 0, 0.0));
+
+	packet = PacketRingPeek(&ring);
+	TestCheck(packet != NULL && packet->header.packetNumber == 1);
+	TestCheck(packet->source == 1);
+	TestCheck(packet->receiveTime == 1.0);
+	TestCheck(packet->dataLength == PacketRingTestDataLength(1));
+
+	/*
+	 Discarding empties the ring, and a release after it does nothing.
+	 */
+	PacketRingDiscard(&ring);
+	TestCheck(PacketRingPeek(&ring) == NULL);
+	PacketRingRelease(&ring);
+	TestCheck(ring.readCount == ring.writeCount);
+
+}
+
+static void TestNetworkEventQueue(void) {
+
+	static NetworkEventQueue queue;
+	NetworkEvent event;
+
+	NetworkEventQueueInit(&queue);
+	TestCheck(!NetworkEventQueuePop(&queue, &event));
+
+	for (int i = 0; i < kNetworkEventQueueCapacity; i++) {
+
+		event.type = kNetworkEventNewGameLengthReceived;
+		event.data.gameLength = i;
+		TestCheck(NetworkEventQueuePush(&queue, &event));
+
+	}
+
+	TestCheck(!NetworkEventQueuePush(&queue, &event));
+	TestCheck(queue.droppedEvents == 1);
+
+	TestCheck(NetworkEventQueuePop(&queue, &event));
+	TestCheck(event.type == kNetworkEventNewGameLengthReceived && event.data.gameLength == 0);
+
+	NetworkEventQueueDiscard(&queue);
+	TestCheck(!NetworkEventQueuePop(&queue, &event));
+
+}
+
+/*
+ Flood tests. The producer runs on it's own thread and the consumer on the main thread.
+ */
+
+typedef struct {
+
+	PacketRing ring;
+	//Pushes which the ring refused because it was full, counted by the producer.
+	unsigned long refusedPushes;
+
+} PacketRingFlood;
+
+static void *PacketRingFloodProducer(void *argument) {
+
+	PacketRingFlood *flood = (PacketRingFlood *)argument;
+	uint8_t bytes[kPacketRingMaximumPacketSize];
+
+	for (uint32_t packetNumber = 0; packetNumber < kPacketRingTestFloodCount; packetNumber++) {
+
+		size_t length = PacketRingTestMakePacket(packetNumber, bytes);
+
+		//A full ring refuses the packet, so it is pushed again until there is room, as a resend would be.
+		while (!PacketRingPush(&flood->ring, bytes, length, (int)(packetNumber & 1), (double)packetNumber)) {
+
+			flood->refusedPushes++;
+			sched_yield();
+
+		}
+
+	}
+
+	return NULL;
+
+}
+
+static void TestPacketRingFlood(void) {
+
+	static PacketRingFlood flood;
+	pthread_t producer;
+	uint32_t expectedPacketNumber = 0;
+	unsigned long corruptPackets = 0;
+	unsigned long outOfOrderPackets = 0;
+
+	PacketRingInit(&flood.ring);
+	flood.refusedPushes = 0;
+
+	TestCheck(pthread_create(&producer, NULL, PacketRingFloodProducer, &flood) == 0);
+
+	while (expectedPacketNumber < kPacketRingTestFloodCount) {
+
+		const ReceivedPacket *packet = PacketRingPeek(&flood.ring);
+
+		if (packet == NULL) {
+
+			sched_yield();
+			continue;
+
+		}
+
+		uint32_t packetNumber = packet->header.packetNumber;
+
+		/*
+		 Packets must arrive one after the other. A gap means one was lost and a repeat means a slot was
+		 read twice, so the count carries on from the packet received either way.
+		 */
+		if (packetNumber != expectedPacketNumber) {
+			outOfOrderPackets++;
+		}
+
+		int intact = (packet->header.packetType == (uint8_t)packetNumber &&
+					  packet->source == (int)(packetNumber & 1) &&
+					  packet->receiveTime == (double)packetNumber &&
+					  packet->dataLength == PacketRingTestDataLength(packetNumber));
+
+		for (size_t i = 0; intact && i < packet->dataLength; i++) {
+			intact = (packet->data[i] == PacketRingTestByte(packetNumber, i));
+		}
+
+		if (!intact) {
+			corruptPackets++;
+		}
+
+		PacketRingRelease(&flood.ring);
+		expectedPacketNumber = packetNumber + 1;
+
+		if ((expectedPacketNumber % kPacketRingTestConsumerPauseInterval) == 0) {
+			PacketRingTestPause();
+		}
+
+	}
+
+	pthread_join(producer, NULL);
+
+	TestCheck(outOfOrderPackets == 0);
+	TestCheck(corruptPackets == 0);
+	TestCheck(PacketRingPeek(&flood.ring) == NULL);
+	TestCheck(flood.ring.writeCount == kPacketRingTestFloodCount);
+	TestCheck(flood.ring.droppedPackets == flood.refusedPushes);
+	//The test only means something if the ring was full at times.
+	TestCheck(flood.refusedPushes > 0);
+
+	printf("packet ring: %d packets received in order, ring full %lu times\n", kPacketRingTestFloodCount, flood.refusedPushes);
+
+}
+
+typedef struct {
+
+	NetworkEventQueue queue;
+	unsigned long refusedPushes;
+
+} NetworkEventQueueFlood;
+
+static void *NetworkEventQueueFloodProducer(void *argument) {
+
+	NetworkEventQueueFlood *flood = (NetworkEventQueueFlood *)argument;
+	NetworkEvent event;
+
+	for (int i = 0; i < kPacketRingTestFloodCount; i++) {
+
+		event.type = (NetworkEventType)(i % (kNetworkEventPeerQuitGame + 1));
+		event.data.gameLength = i;
+
+		while (!NetworkEventQueuePush(&flood->queue, &event)) {
+
+			flood->refusedPushes++;
+			sched_yield();
+
+		}
+
+	}
+
+	return NULL;
+
+}
+
+static void TestNetworkEventQueueFlood(void) {
+
+	static NetworkEventQueueFlood flood;
+	pthread_t producer;
+	NetworkEvent event;
+	int expected = 0;
+	unsigned long wrongEvents = 0;
+
+	NetworkEventQueueInit(&flood.queue);
+	flood.refusedPushes = 0;
+
+	TestCheck(pthread_create(&producer, NULL, NetworkEventQueueFloodProducer, &flood) == 0);
+
+	while (expected < kPacketRingTestFloodCount) {
+
+		if (!NetworkEventQueuePop(&flood.queue, &event)) {
+
+			sched_yield();
+			continue;
+
+		}
+
+		if (event.data.gameLength != expected || event.type != (NetworkEventType)(expected % (kNetworkEventPeerQuitGame + 1))) {
+			wrongEvents++;
+		}
+
+		expected = event.data.gameLength + 1;
+
+		if ((expected % kPacketRingTestConsumerPauseInterval) == 0) {
+			PacketRingTestPause();
+		}
+
+	}
+
+	pthread_join(producer, NULL);
+
+	TestCheck(wrongEvents == 0);
+	TestCheck(!NetworkEventQueuePop(&flood.queue, &event));
+	TestCheck(flood.queue.writeCount == kPacketRingTestFloodCount);
+	TestCheck(flood.queue.droppedEvents == flood.refusedPushes);
+	TestCheck(flood.refusedPushes > 0);
+
+	printf("event queue: %d events received in order, queue full %lu times\n", kPacketRingTestFloodCount, flood.refusedPushes);
+
+}
+
+int main(void) {
+
+	TestPacketRing();
+	TestNetworkEventQueue();
+	TestPacketRingFlood();
+	TestNetworkEventQueueFlood();
+
+	return TestCheckResult();
+
+}
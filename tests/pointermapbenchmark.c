@@ -0,0 +1,162 @@
+//
+//  PointerMapBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 07/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The host version of the app's PointerMapBenchmark. It compares the ccPointerMap which the CCScheduler and
+ CCActionManager find their targets with against the uthash tables they used before, with as many targets as a
+ game has nodes. Each run looks up targets in a random order, as runAction: and schedule: do, and removes and
+ adds targets again, as happens whenever a projectile or target is cleared up and another spawned. Both tables
+ must find every target.
+
+ The targets are separate blocks the size of an NSObject. uthash hashes the whole pointer, as HASH_FIND_INT did
+ with the 4 byte pointers of the device.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "uthash.h"
+#include "ccPointerMap.h"
+#include "BenchmarkTimer.h"
+
+/*
+ The values from PointerMapBenchmark.h, which is an Objective-C header.
+ */
+#define kPointerMapBenchmarkLookups 200000
+#define kPointerMapBenchmarkChurns 20000
+
+#define kPointerMapBenchmarkTargetSize 16
+
+static const int kPointerMapBenchmarkTargets[] = { 32, 128, 512 };
+
+#define kPointerMapBenchmarkRuns (int)(sizeof(kPointerMapBenchmarkTargets) / sizeof(kPointerMapBenchmarkTargets[0]))
+
+/*
+ An element of the uthash table, keyed on the target in the same way as the CCScheduler and CCActionManager
+ elements were.
+ */
+typedef struct {
+
+	void *target;
+	UT_hash_handle hh;
+
+} PointerMapBenchmarkElement;
+
+int main(void) {
+
+	int failed = 0;
+
+	printf("Mean time in ns of looking up a target, and of removing a target and adding it again.\n");
+	printf("%s\n", "targets   uthash lookup   ccPointerMap lookup   uthash churn   ccPointerMap churn");
+
+	for (int run = 0; run < kPointerMapBenchmarkRuns; run++) {
+
+		int numberOfTargets = kPointerMapBenchmarkTargets[run];
+		PointerMapBenchmarkElement *elements = calloc(numberOfTargets, sizeof(PointerMapBenchmarkElement));
+		int *order = malloc(kPointerMapBenchmarkLookups * sizeof(int));
+		PointerMapBenchmarkElement *table = NULL;
+		ccPointerMap *map = ccPointerMapNew(numberOfTargets);
+		unsigned long uthashFound = 0;
+		unsigned long pointerMapFound = 0;
+		uint32_t random = 1;
+
+		/*
+		 The targets are looked up in the same random order with both tables, worked out beforehand so that it
+		 isn't timed.
+		 */
+		for (int i = 0; i < kPointerMapBenchmarkLookups; i++) {
+
+			random = random * 1664525u + 1013904223u;
+			order[i] = (int)((random >> 8) % (uint32_t)numberOfTargets);
+
+		}
+
+		for (int i = 0; i < numberOfTargets; i++) {
+
+			PointerMapBenchmarkElement *element = &elements[i];
+
+			element->target = malloc(kPointerMapBenchmarkTargetSize);
+			HASH_ADD(hh, table, target, sizeof(void *), element);
+			ccPointerMapSet(map, element->target, element);
+
+		}
+
+		double start = BenchmarkTimerNow();
+
+		for (int i = 0; i < kPointerMapBenchmarkLookups; i++) {
+
+			PointerMapBenchmarkElement *element = NULL;
+			void *target = elements[order[i]].target;
+
+			HASH_FIND(hh, table, &target, sizeof(void *), element);
+			uthashFound += (element != NULL);
+
+		}
+
+		double uthashLookupTime = (BenchmarkTimerNow() - start) / kPointerMapBenchmarkLookups;
+		start = BenchmarkTimerNow();
+
+		for (int i = 0; i < kPointerMapBenchmarkLookups; i++) {
+			pointerMapFound += (ccPointerMapGet(map, elements[order[i]].target) != NULL);
+		}
+
+		double pointerMapLookupTime = (BenchmarkTimerNow() - start) / kPointerMapBenchmarkLookups;
+		start = BenchmarkTimerNow();
+
+		for (int i = 0; i < kPointerMapBenchmarkChurns; i++) {
+
+			PointerMapBenchmarkElement *element = &elements[order[i]];
+
+			HASH_DEL(table, element);
+			HASH_ADD(hh, table, target, sizeof(void *), element);
+
+		}
+
+		double uthashChurnTime = (BenchmarkTimerNow() - start) / kPointerMapBenchmarkChurns;
+		start = BenchmarkTimerNow();
+
+		for (int i = 0; i < kPointerMapBenchmarkChurns; i++) {
+
+			PointerMapBenchmarkElement *element = &elements[order[i]];
+
+			ccPointerMapRemove(map, element->target);
+			ccPointerMapSet(map, element->target, element);
+
+		}
+
+		double pointerMapChurnTime = (BenchmarkTimerNow() - start) / kPointerMapBenchmarkChurns;
+
+		//Every target must still be in both tables after being removed and added again.
+		for (int i = 0; i < numberOfTargets; i++) {
+
+			PointerMapBenchmarkElement *element = NULL;
+			void *target = elements[i].target;
+
+			HASH_FIND(hh, table, &target, sizeof(void *), element);
+			failed |= (element != &elements[i]) || (ccPointerMapGet(map, target) != &elements[i]);
+
+		}
+
+		failed |= (uthashFound != kPointerMapBenchmarkLookups) || (pointerMapFound != kPointerMapBenchmarkLookups);
+
+		printf("%7d   %13.1f   %19.1f   %12.1f   %18.1f\n", numberOfTargets, uthashLookupTime * 1e9,
+			   pointerMapLookupTime * 1e9, uthashChurnTime * 1e9, pointerMapChurnTime * 1e9);
+
+		HASH_CLEAR(hh, table);
+		ccPointerMapFree(map);
+
+		for (int i = 0; i < numberOfTargets; i++) {
+			free(elements[i].target);
+		}
+
+		free(order);
+		free(elements);
+
+	}
+
+	return failed;
+
+}
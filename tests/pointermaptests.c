@@ -0,0 +1,325 @@
+//
+//  PointerMapTests.c
+//  AberFighter
+//
+//  Created by wde7 on 07/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the ccPointerMap used by the CCScheduler and CCActionManager: setting, replacing, finding and
+ removing keys, removal shifting the entries after the gap back, including around the end of the table, and
+ growing. A long random sequence of operations is checked against a plain array of the values each key
+ should have, with the layout of the table checked as it goes.
+ */
+
+#include <stdlib.h>
+#include "ccPointerMap.h"
+#include "Simulation.h"
+#include "TestCheck.h"
+
+/*
+ Keys are the addresses of entries 16 bytes apart, aligned like the addresses of objects.
+ */
+#define kPointerMapTestsKeys 2048
+#define kPointerMapTestsKeySpacing 16
+
+static char keys[kPointerMapTestsKeys * kPointerMapTestsKeySpacing];
+
+/*
+ Values are only compared by address, so the entries of this array stand in for the elements.
+ */
+static int values[kPointerMapTestsKeys];
+
+static const void *PointerMapTestsKey(int i) {
+
+	return &keys[i * kPointerMapTestsKeySpacing];
+
+}
+
+/*
+ The index a key hashes to, worked out the same way as in ccpointermap.c.
+ */
+static size_t PointerMapTestsHome(const ccPointerMap *map, const void *key) {
+
+#if UINTPTR_MAX > 0xFFFFFFFFu
+	return (size_t)(((uintptr_t)key * UINT64_C(11400714819323198485)) >> map->shift);
+#else
+	return (size_t)(((uintptr_t)key * UINT32_C(2654435769)) >> map->shift);
+#endif
+
+}
+
+/*
+ Checks that the map is at most half full, that num counts it's entries and that every entry can be reached
+ from the index it hashes to without crossing an empty entry, which is what a lookup relies on.
+ */
+static void PointerMapTestsCheckLayout(const ccPointerMap *map) {
+
+	size_t mask = map->capacity - 1;
+	size_t count = 0;
+	int reachable = 1;
+
+	for (size_t i = 0; i < map->capacity; i++) {
+
+		if (map->entries[i].key == NULL) {
+			continue;
+		}
+
+		count++;
+
+		for (size_t j = PointerMapTestsHome(map, map->entries[i].key); j != i; j = (j + 1) & mask) {
+
+			if (map->entries[j].key == NULL) {
+				reachable = 0;
+			}
+
+		}
+
+	}
+
+	TestCheck(count == map->num);
+	TestCheck(reachable);
+	TestCheck(map->num * 2 <= map->capacity);
+
+}
+
+/*
+ Finds a key from first onwards which hashes to the index specified, or returns -1 if there isn't one.
+ */
+static int PointerMapTestsFindKeyWithHome(const ccPointerMap *map, size_t home, int first) {
+
+	for (int i = first; i < kPointerMapTestsKeys; i++) {
+
+		if (PointerMapTestsHome(map, PointerMapTestsKey(i)) == home) {
+			return i;
+		}
+
+	}
+
+	return -1;
+
+}
+
+static void TestSetGetRemove(void) {
+
+	ccPointerMap *map = ccPointerMapNew(4);
+
+	TestCheck(map != NULL);
+	TestCheck(map->num == 0);
+	TestCheck(map->capacity == 8);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(0)) == NULL);
+	TestCheck(ccPointerMapRemove(map, PointerMapTestsKey(0)) == NULL);
+
+	ccPointerMapSet(map, PointerMapTestsKey(0), &values[0]);
+	ccPointerMapSet(map, PointerMapTestsKey(1), &values[1]);
+
+	TestCheck(map->num == 2);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(0)) == &values[0]);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(1)) == &values[1]);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(2)) == NULL);
+
+	//Setting a key which is already in the map replaces it's value.
+	ccPointerMapSet(map, PointerMapTestsKey(0), &values[5]);
+	TestCheck(map->num == 2);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(0)) == &values[5]);
+
+	TestCheck(ccPointerMapRemove(map, PointerMapTestsKey(0)) == &values[5]);
+	TestCheck(map->num == 1);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(0)) == NULL);
+	TestCheck(ccPointerMapRemove(map, PointerMapTestsKey(0)) == NULL);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(1)) == &values[1]);
+
+	ccPointerMapFree(map);
+
+	//Freeing NULL does nothing.
+	ccPointerMapFree(NULL);
+
+}
+
+/*
+ Three keys hash to the last index of the table, so two of them wrap around to the start, and a fourth hashes
+ to the first index and is pushed along behind them. Removing the first of them must shift every one after it
+ back, but not the fourth back past the index it hashes to.
+ */
+static void TestRemoveShiftsBackAroundTheEnd(void) {
+
+	ccPointerMap *map = ccPointerMapNew(4);
+	size_t last = map->capacity - 1;
+	int a = PointerMapTestsFindKeyWithHome(map, last, 0);
+	int b = PointerMapTestsFindKeyWithHome(map, last, a + 1);
+	int c = PointerMapTestsFindKeyWithHome(map, last, b + 1);
+	int d = PointerMapTestsFindKeyWithHome(map, 0, 0);
+
+	TestCheck(a >= 0 && b >= 0 && c >= 0 && d >= 0);
+
+	if (a < 0 || b < 0 || c < 0 || d < 0) {
+		ccPointerMapFree(map);
+		return;
+	}
+
+	ccPointerMapSet(map, PointerMapTestsKey(a), &values[a]);
+	ccPointerMapSet(map, PointerMapTestsKey(b), &values[b]);
+	ccPointerMapSet(map, PointerMapTestsKey(c), &values[c]);
+	ccPointerMapSet(map, PointerMapTestsKey(d), &values[d]);
+
+	//Four entries fill half of the table, so it hasn't grown.
+	TestCheck(map->capacity == 8);
+	TestCheck(map->entries[last].key == PointerMapTestsKey(a));
+	TestCheck(map->entries[0].key == PointerMapTestsKey(b));
+	TestCheck(map->entries[1].key == PointerMapTestsKey(c));
+	TestCheck(map->entries[2].key == PointerMapTestsKey(d));
+
+	TestCheck(ccPointerMapRemove(map, PointerMapTestsKey(a)) == &values[a]);
+
+	TestCheck(map->entries[last].key == PointerMapTestsKey(b));
+	TestCheck(map->entries[0].key == PointerMapTestsKey(c));
+	TestCheck(map->entries[1].key == PointerMapTestsKey(d));
+	TestCheck(map->entries[2].key == NULL);
+	PointerMapTestsCheckLayout(map);
+
+	//Removing an entry in the middle of the run leaves the one which hashes to the gap's own index alone.
+	TestCheck(ccPointerMapRemove(map, PointerMapTestsKey(c)) == &values[c]);
+
+	TestCheck(map->entries[last].key == PointerMapTestsKey(b));
+	TestCheck(map->entries[0].key == PointerMapTestsKey(d));
+	TestCheck(map->entries[1].key == NULL);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(b)) == &values[b]);
+	TestCheck(ccPointerMapGet(map, PointerMapTestsKey(d)) == &values[d]);
+	PointerMapTestsCheckLayout(map);
+
+	ccPointerMapFree(map);
+
+}
+
+/*
+ The table doubles when adding an entry would make it more than half full, keeps every entry through the
+ growth and doesn't shrink when the entries are removed.
+ */
+static void TestGrow(void) {
+
+	ccPointerMap *map = ccPointerMapNew(0);
+
+	TestCheck(map->capacity == 8);
+
+	for (int i = 0; i < 4; i++) {
+		ccPointerMapSet(map, PointerMapTestsKey(i), &values[i]);
+	}
+
+	TestCheck(map->capacity == 8);
+
+	ccPointerMapSet(map, PointerMapTestsKey(4), &values[4]);
+	TestCheck(map->capacity == 16);
+
+	for (int i = 5; i < 100; i++) {
+		ccPointerMapSet(map, PointerMapTestsKey(i), &values[i]);
+	}
+
+	TestCheck(map->num == 100);
+	TestCheck(map->capacity == 256);
+	PointerMapTestsCheckLayout(map);
+
+	for (int i = 0; i < 100; i++) {
+		TestCheck(ccPointerMapGet(map, PointerMapTestsKey(i)) == &values[i]);
+	}
+
+	for (int i = 0; i < 100; i++) {
+		TestCheck(ccPointerMapRemove(map, PointerMapTestsKey(i)) == &values[i]);
+	}
+
+	TestCheck(map->num == 0);
+	TestCheck(map->capacity == 256);
+	PointerMapTestsCheckLayout(map);
+
+	//A map asked for room for 100 entries holds them without growing.
+	ccPointerMapFree(map);
+	map = ccPointerMapNew(100);
+
+	for (int i = 0; i < 100; i++) {
+		ccPointerMapSet(map, PointerMapTestsKey(i), &values[i]);
+	}
+
+	TestCheck(map->capacity == 256);
+
+	ccPointerMapFree(map);
+
+}
+
+/*
+ Sets, replaces, finds and removes random keys, first mostly adding so that the table grows through several
+ sizes, then mostly removing so that long runs are broken up, and checks every result against the value each
+ key should have. The number of keys in use is limited in each phase so that removals find keys often.
+ */
+static void TestAgainstModel(void) {
+
+	static const int keysInUse[] = { 16, 300, kPointerMapTestsKeys, kPointerMapTestsKeys, 64 };
+	static const unsigned int setsPerHundred[] = { 60, 70, 80, 30, 40 };
+	ccPointerMap *map = ccPointerMapNew(1);
+	void *model[kPointerMapTestsKeys] = { NULL };
+	size_t modelCount = 0;
+	unsigned int mismatches = 0;
+	SimulationRandom random;
+
+	SimulationRandomSeed(&random, 12345);
+
+	for (int phase = 0; phase < 5; phase++) {
+
+		for (int operation = 0; operation < 20000; operation++) {
+
+			unsigned int choice = SimulationRandomNext(&random) % 100;
+			int i = (int)(SimulationRandomNext(&random) % (uint32_t)keysInUse[phase]);
+			const void *key = PointerMapTestsKey(i);
+
+			if (choice < setsPerHundred[phase]) {
+
+				//Alternate between two values so that replacing a value is checked too.
+				void *value = &values[(i + operation) % kPointerMapTestsKeys];
+
+				modelCount += (model[i] == NULL);
+				model[i] = value;
+				ccPointerMapSet(map, key, value);
+
+			} else if (choice < setsPerHundred[phase] + 10) {
+
+				mismatches += (ccPointerMapGet(map, key) != model[i]);
+
+			} else {
+
+				mismatches += (ccPointerMapRemove(map, key) != model[i]);
+				modelCount -= (model[i] != NULL);
+				model[i] = NULL;
+
+			}
+
+			mismatches += (map->num != modelCount);
+
+			if (operation % 1000 == 0) {
+				PointerMapTestsCheckLayout(map);
+			}
+
+		}
+
+		for (int i = 0; i < kPointerMapTestsKeys; i++) {
+			mismatches += (ccPointerMapGet(map, PointerMapTestsKey(i)) != model[i]);
+		}
+
+		PointerMapTestsCheckLayout(map);
+
+	}
+
+	TestCheck(mismatches == 0);
+	TestCheck(map->capacity >= 1024);
+
+	ccPointerMapFree(map);
+
+}
+
+int main(void) {
+
+	TestSetGetRemove();
+	TestRemoveShiftsBackAroundTheEnd();
+	TestGrow();
+	TestAgainstModel();
+
+	return TestCheckResult();
+
+}
@@ -0,0 +1,470 @@
+//
+//  ReliableChannelTests.c
+//  AberFighter
+//
+//  Created by wde7 on 06/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the ReliableChannel. Two channels talk over a simulated link which loses, delays, reorders and
+ duplicates their packets, starting just short of the point where the 16 bit sequence numbers wrap, and every
+ message must arrive once, in order and intact. The window and backlog are filled until a message is refused,
+ the received bitfield is checked bit by bit along with the resends it leads to, and the retransmission
+ timeout is checked to double after each timeout up to it's limit.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "ReliableChannel.h"
+#include "Simulation.h"
+#include "WireProtocol.h"
+#include "TestCheck.h"
+
+/*
+ Messages sent each way by the link test, and the sequence number the channels start at, so that the
+ numbers wrap part of the way through.
+ */
+#define kReliableChannelTestsMessageCount 5000
+#define kReliableChannelTestsFirstSequence 65000
+
+/*
+ The link: packets are lost, duplicated or held back by these percentages, and otherwise take between one
+ and kReliableChannelTestsMaximumDelay steps of kReliableChannelTestsStep seconds.
+ */
+#define kReliableChannelTestsStep 0.01
+#define kReliableChannelTestsLossPercent 20
+#define kReliableChannelTestsDuplicatePercent 10
+#define kReliableChannelTestsMaximumDelay 8
+
+/*
+ Small packets, so that the messages due don't always fit in one.
+ */
+#define kReliableChannelTestsPacketSize 64
+#define kReliableChannelTestsPacketsInFlight 256
+
+typedef struct {
+
+	int inUse;
+	unsigned int deliveryStep;
+	uint8_t bytes[kReliableChannelTestsPacketSize];
+	size_t length;
+
+} ReliableChannelTestsPacket;
+
+typedef struct {
+
+	ReliableChannelTestsPacket packets[kReliableChannelTestsPacketsInFlight];
+	SimulationRandom random;
+
+} ReliableChannelTestsLink;
+
+/*
+ The data of the message with the number specified, from one to four bytes of it.
+ */
+static size_t ReliableChannelTestsMessageData(uint32_t number, uint8_t *data) {
+
+	size_t length = 1 + (number % 4);
+
+	for (size_t i = 0; i < length; i++) {
+		data[i] = (uint8_t)(number >> (8 * i));
+	}
+
+	return length;
+
+}
+
+/*
+ Starts both ends of a channel at the sequence number specified.
+ */
+static void ReliableChannelTestsInit(ReliableChannel *channel, uint16_t sequence) {
+
+	ReliableChannelInit(channel);
+	channel->nextSendSequence = sequence;
+	channel->oldestUnacknowledgedSequence = sequence;
+	channel->nextReceiveSequence = sequence;
+
+}
+
+/*
+ Writes everything the channel has to send into one packet. Returns it's length, which is 0 if there was
+ nothing to send.
+ */
+static size_t ReliableChannelTestsWrite(ReliableChannel *channel, uint8_t *bytes, size_t capacity, double now) {
+
+	WireWriter writer;
+
+	WireWriterInit(&writer, bytes, capacity);
+
+	return ReliableChannelWrite(channel, &writer, now);
+
+}
+
+static void ReliableChannelTestsRead(ReliableChannel *channel, const uint8_t *bytes, size_t length, double now) {
+
+	WireReader reader;
+
+	WireReaderInit(&reader, bytes, length);
+	ReliableChannelRead(channel, &reader, now);
+
+}
+
+static void ReliableChannelTestsLinkSend(ReliableChannelTestsLink *link, const uint8_t *bytes, size_t length, unsigned int step) {
+
+	int copies = 1;
+
+	if ((SimulationRandomNext(&link->random) % 100) < kReliableChannelTestsLossPercent) {
+		return;
+	}
+
+	if ((SimulationRandomNext(&link->random) % 100) < kReliableChannelTestsDuplicatePercent) {
+		copies = 2;
+	}
+
+	for (int i = 0; i < kReliableChannelTestsPacketsInFlight && copies > 0; i++) {
+
+		ReliableChannelTestsPacket *packet = &link->packets[i];
+
+		if (packet->inUse) {
+			continue;
+		}
+
+		packet->inUse = 1;
+		packet->deliveryStep = step + 1 + (SimulationRandomNext(&link->random) % kReliableChannelTestsMaximumDelay);
+		memcpy(packet->bytes, bytes, length);
+		packet->length = length;
+		copies--;
+
+	}
+
+}
+
+/*
+ Delivers the packets due and takes every message which is ready, checking that it's the next one expected.
+ Returns 0 if a message arrived out of order or changed.
+ */
+static int ReliableChannelTestsLinkDeliver(ReliableChannelTestsLink *link, ReliableChannel *channel, unsigned int step,
+										   uint32_t *received) {
+
+	uint8_t type;
+	WireReader message;
+	int intact = 1;
+
+	for (int i = 0; i < kReliableChannelTestsPacketsInFlight; i++) {
+
+		ReliableChannelTestsPacket *packet = &link->packets[i];
+
+		if (packet->inUse && packet->deliveryStep <= step) {
+
+			ReliableChannelTestsRead(channel, packet->bytes, packet->length, step * kReliableChannelTestsStep);
+			packet->inUse = 0;
+
+		}
+
+	}
+
+	while (ReliableChannelReceive(channel, &type, &message)) {
+
+		uint8_t expected[4];
+		uint8_t data[kReliableChannelMaximumMessageSize];
+		size_t length = ReliableChannelTestsMessageData(*received, expected);
+
+		if (type != (uint8_t)*received || WireReaderRemaining(&message) != length) {
+
+			intact = 0;
+
+		} else {
+
+			WireReadBytes(&message, data, length);
+			intact &= (memcmp(data, expected, length) == 0);
+
+		}
+
+		(*received)++;
+
+	}
+
+	return intact;
+
+}
+
+static void TestLossyLinkDeliversInOrder(void) {
+
+	ReliableChannel channels[2];
+	ReliableChannelTestsLink links[2];
+	uint32_t sent[2] = { 0, 0 };
+	uint32_t received[2] = { 0, 0 };
+	int intact = 1;
+	unsigned int step;
+
+	memset(links, 0, sizeof(links));
+
+	for (int c = 0; c < 2; c++) {
+
+		ReliableChannelTestsInit(&channels[c], kReliableChannelTestsFirstSequence);
+		SimulationRandomSeed(&links[c].random, 11 + c);
+
+	}
+
+	for (step = 0; step < 100000 && (received[0] < kReliableChannelTestsMessageCount || received[1] < kReliableChannelTestsMessageCount); step++) {
+
+		double now = step * kReliableChannelTestsStep;
+
+		for (int c = 0; c < 2; c++) {
+
+			//Each link carries packets to the channel with the same index.
+			intact &= ReliableChannelTestsLinkDeliver(&links[c], &channels[c], step, &received[c]);
+
+			//A few messages a step, as long as they are taken, so that the window and the backlog fill up at times.
+			for (int i = 0; i < 3 && sent[c] < kReliableChannelTestsMessageCount; i++) {
+
+				uint8_t data[4];
+				size_t length = ReliableChannelTestsMessageData(sent[c], data);
+
+				if (!ReliableChannelSend(&channels[c], (uint8_t)sent[c], data, length)) {
+					break;
+				}
+
+				sent[c]++;
+
+			}
+
+			uint8_t bytes[kReliableChannelTestsPacketSize];
+			size_t length;
+
+			while ((length = ReliableChannelTestsWrite(&channels[c], bytes, sizeof(bytes), now)) > 0) {
+				ReliableChannelTestsLinkSend(&links[1 - c], bytes, length, step);
+			}
+
+		}
+
+	}
+
+	TestCheck(intact);
+
+	for (int c = 0; c < 2; c++) {
+
+		TestCheck(sent[c] == kReliableChannelTestsMessageCount);
+		TestCheck(received[c] == kReliableChannelTestsMessageCount);
+		TestCheck(channels[c].retransmissions > 0);
+
+		//The sequence numbers have wrapped.
+		TestCheck(channels[c].nextSendSequence == (uint16_t)(kReliableChannelTestsFirstSequence + kReliableChannelTestsMessageCount));
+
+	}
+
+}
+
+static void TestWindowAndBacklogOverflow(void) {
+
+	ReliableChannel sender, receiver;
+	uint8_t bytes[1024];
+	uint8_t type;
+	WireReader message;
+	int accepted = 1;
+
+	ReliableChannelTestsInit(&sender, 65520);
+	ReliableChannelTestsInit(&receiver, 65520);
+
+	for (int i = 0; i < kReliableChannelWindowSize + kReliableChannelBacklogSize; i++) {
+		accepted &= ReliableChannelSend(&sender, (uint8_t)i, NULL, 0);
+	}
+
+	TestCheck(accepted);
+	TestCheck(ReliableChannelUnacknowledgedCount(&sender) == kReliableChannelWindowSize);
+	TestCheck(ReliableChannelBacklogCount(&sender) == kReliableChannelBacklogSize);
+
+	//Once both are full a message is refused, as is one which is too large.
+	TestCheck(!ReliableChannelSend(&sender, 0, NULL, 0));
+	TestCheck(!ReliableChannelSend(&sender, 0, bytes, kReliableChannelMaximumMessageSize + 1));
+
+	/*
+	 Only the window is sent. Acknowledging it moves the backlog into the window in order.
+	 */
+	size_t length = ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), 0.0);
+	ReliableChannelTestsRead(&receiver, bytes, length, 0.01);
+
+	int next = 0;
+
+	while (ReliableChannelReceive(&receiver, &type, &message)) {
+
+		TestCheck(type == next);
+		next++;
+
+	}
+
+	TestCheck(next == kReliableChannelWindowSize);
+
+	length = ReliableChannelTestsWrite(&receiver, bytes, sizeof(bytes), 0.02);
+	ReliableChannelTestsRead(&sender, bytes, length, 0.02);
+
+	TestCheck(ReliableChannelUnacknowledgedCount(&sender) == kReliableChannelWindowSize);
+	TestCheck(ReliableChannelBacklogCount(&sender) == kReliableChannelBacklogSize - kReliableChannelWindowSize);
+	TestCheck(ReliableChannelSend(&sender, (uint8_t)(kReliableChannelWindowSize + kReliableChannelBacklogSize), NULL, 0));
+
+	length = ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), 0.03);
+	ReliableChannelTestsRead(&receiver, bytes, length, 0.04);
+
+	while (ReliableChannelReceive(&receiver, &type, &message)) {
+
+		TestCheck(type == next);
+		next++;
+
+	}
+
+	TestCheck(next == 2 * kReliableChannelWindowSize);
+
+}
+
+/*
+ Reads the acknowledgement at the start of data written by ReliableChannelWrite, and the sequence numbers of
+ the messages after it. Returns the number of messages.
+ */
+static unsigned int ReliableChannelTestsParse(const uint8_t *bytes, size_t length, uint16_t *nextExpected, uint32_t *receivedBits,
+											  uint16_t *sequences, unsigned int maximumSequences) {
+
+	WireReader reader;
+	unsigned int count = 0;
+
+	WireReaderInit(&reader, bytes, length);
+	*nextExpected = WireReadUInt16(&reader);
+	*receivedBits = WireReadUInt32(&reader);
+
+	while (WireReaderRemaining(&reader) > 0 && count < maximumSequences) {
+
+		sequences[count] = WireReadUInt16(&reader);
+		WireReadUInt8(&reader);
+		WireReaderSkip(&reader, WireReadVarUInt(&reader));
+		count++;
+
+	}
+
+	return count;
+
+}
+
+static void TestSelectiveAcknowledgement(void) {
+
+	ReliableChannel sender, receiver;
+	uint8_t packets[6][64];
+	size_t lengths[6];
+	uint8_t bytes[256];
+	uint16_t nextExpected, sequences[8];
+	uint32_t receivedBits;
+	uint8_t type;
+	WireReader message;
+
+	//The bitfield covers messages on both sides of the wrap.
+	ReliableChannelTestsInit(&sender, 65534);
+	ReliableChannelTestsInit(&receiver, 65534);
+
+	for (int i = 0; i < 6; i++) {
+
+		ReliableChannelSend(&sender, (uint8_t)i, NULL, 0);
+		lengths[i] = ReliableChannelTestsWrite(&sender, packets[i], sizeof(packets[i]), 0.0);
+
+	}
+
+	//Messages 1 and 3 are lost, and 4 arrives twice.
+	ReliableChannelTestsRead(&receiver, packets[0], lengths[0], 0.01);
+	ReliableChannelTestsRead(&receiver, packets[4], lengths[4], 0.01);
+	ReliableChannelTestsRead(&receiver, packets[2], lengths[2], 0.01);
+	ReliableChannelTestsRead(&receiver, packets[5], lengths[5], 0.01);
+	ReliableChannelTestsRead(&receiver, packets[4], lengths[4], 0.01);
+
+	TestCheck(ReliableChannelReceive(&receiver, &type, &message) && type == 0);
+	TestCheck(!ReliableChannelReceive(&receiver, &type, &message));
+
+	size_t length = ReliableChannelTestsWrite(&receiver, bytes, sizeof(bytes), 0.02);
+
+	TestCheck(ReliableChannelTestsParse(bytes, length, &nextExpected, &receivedBits, sequences, 8) == 0);
+	TestCheck(nextExpected == 65535);
+	//Messages 2, 4 and 5 are 1, 3 and 4 after the next expected, bits 0, 2 and 3.
+	TestCheck(receivedBits == 0x0d);
+
+	ReliableChannelTestsRead(&sender, bytes, length, 0.02);
+	TestCheck(ReliableChannelUnacknowledgedCount(&sender) == 2);
+
+	//Only the lost messages are resent, once their timeout has passed.
+	TestCheck(!ReliableChannelHasDataToWrite(&sender, 0.021));
+	length = ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), sender.retransmissionTimeout);
+
+	TestCheck(ReliableChannelTestsParse(bytes, length, &nextExpected, &receivedBits, sequences, 8) == 2);
+	TestCheck(sequences[0] == 65535 && sequences[1] == 1);
+
+	ReliableChannelTestsRead(&receiver, bytes, length, 0.3);
+
+	for (int i = 1; i < 6; i++) {
+		TestCheck(ReliableChannelReceive(&receiver, &type, &message) && type == i);
+	}
+
+	TestCheck(!ReliableChannelReceive(&receiver, &type, &message));
+
+}
+
+static void TestTimeoutBacksOff(void) {
+
+	ReliableChannel sender, receiver;
+	uint8_t bytes[256];
+	double now = 0.0;
+	double expectedTimeout = kReliableChannelInitialTimeout;
+
+	ReliableChannelInit(&sender);
+	ReliableChannelInit(&receiver);
+
+	ReliableChannelSend(&sender, 1, NULL, 0);
+	TestCheck(ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), now) > 0);
+
+	/*
+	 Nothing is acknowledged, so each resend waits twice as long as the one before, until the limit.
+	 */
+	for (int i = 0; i < 5; i++) {
+
+		TestCheckClose(sender.retransmissionTimeout, expectedTimeout, 1e-9);
+		TestCheck(!ReliableChannelHasDataToWrite(&sender, now + expectedTimeout - 0.001));
+
+		now += expectedTimeout;
+		TestCheck(ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), now) > 0);
+
+		expectedTimeout *= 2.0;
+
+		if (expectedTimeout > kReliableChannelMaximumTimeout) {
+			expectedTimeout = kReliableChannelMaximumTimeout;
+		}
+
+	}
+
+	TestCheckClose(sender.retransmissionTimeout, kReliableChannelMaximumTimeout, 1e-9);
+	TestCheck(sender.retransmissions == 5);
+
+	/*
+	 An acknowledgement of a resent message gives no measurement, so the timeout stays backed off. The
+	 receiver hasn't taken the message yet, which mustn't stop it being acknowledged.
+	 */
+	ReliableChannelTestsRead(&receiver, bytes, ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), now + 1.0), now + 1.0);
+	size_t length = ReliableChannelTestsWrite(&receiver, bytes, sizeof(bytes), now + 1.0);
+	ReliableChannelTestsRead(&sender, bytes, length, now + 1.05);
+
+	TestCheck(ReliableChannelUnacknowledgedCount(&sender) == 0);
+	TestCheckClose(sender.retransmissionTimeout, kReliableChannelMaximumTimeout, 1e-9);
+
+	//A message acknowledged first time measures the round trip again, which undoes the doubling.
+	now += 2.0;
+	ReliableChannelSend(&sender, 2, NULL, 0);
+	ReliableChannelTestsRead(&receiver, bytes, ReliableChannelTestsWrite(&sender, bytes, sizeof(bytes), now), now + 0.02);
+	length = ReliableChannelTestsWrite(&receiver, bytes, sizeof(bytes), now + 0.02);
+	ReliableChannelTestsRead(&sender, bytes, length, now + 0.04);
+
+	TestCheck(sender.retransmissionTimeout < kReliableChannelInitialTimeout);
+
+}
+
+int main(void) {
+
+	TestLossyLinkDeliversInOrder();
+	TestWindowAndBacklogOverflow();
+	TestSelectiveAcknowledgement();
+	TestTimeoutBacksOff();
+
+	return TestCheckResult();
+
+}
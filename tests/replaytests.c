@@ -0,0 +1,367 @@
+//
+//  ReplayTests.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the replay files. A two player game is played by a Simulation and recorded as the
+ MultiplayerActionLayer records a rollback game, then played back headless at full speed and checked
+ against the scores and checksum at the end of the file and every keyframe passed on the way. Seeking,
+ the network events and files which have been cut short or changed are checked too.
+
+ Given the paths of replay files, for example ones copied off a device, it plays and verifies each of
+ them instead and reports how fast they played:
+
+   build/replaytests game1.replay game2.replay
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ReplayFile.h"
+#include "Simulation.h"
+#include "WireProtocol.h"
+#include "BenchmarkTimer.h"
+#include "TestCheck.h"
+
+/*
+ Seeds of the recorded game and of the inputs played in it.
+ */
+#define kReplayTestsMatchSeed 20110627
+#define kReplayTestsInputSeed 42
+
+/*
+ A network event is recorded every this many frames.
+ */
+#define kReplayTestsEventInterval 250
+
+/*
+ Returns the inputs of the next frame. Each player changes direction every so often and otherwise carries
+ on, as a player tilting the device does, so most frames take a single byte per player. Inputs are quantized
+ to the precision of the WireProtocol, as a RollbackSession does, so that the replay reproduces them exactly.
+ */
+static void ReplayTestsNextInputs(SimulationRandom *random, int numberOfPlayers, SimulationInput *inputs) {
+
+	for (int p = 0; p < numberOfPlayers; p++) {
+
+		if ((SimulationRandomNext(random) % 20) == 0) {
+
+			float heading = (float)(SimulationRandomNext(random) % 360);
+			float speed = (float)(SimulationRandomNext(random) % 100);
+
+			inputs[p].heading = WireDequantizeHeading(WireQuantizeHeading(heading));
+			inputs[p].speed = WireDequantizeSpeed(WireQuantizeSpeed(speed));
+
+		}
+
+		inputs[p].fire = ((SimulationRandomNext(random) % 8) == 0);
+
+	}
+
+}
+
+/*
+ Plays a whole game, recording it to the file at path. Returns the final checksum of the simulation and
+ sets frames to the number of frames played.
+ */
+static uint32_t ReplayTestsRecordGame(const char *path, uint32_t *frames, unsigned int *events) {
+
+	SimulationConfig config;
+	SimulationRandom random;
+	SimulationInput inputs[kSimulationMaximumPlayers];
+
+	SimulationConfigDefaults(&config, 2);
+	SimulationRandomSeed(&random, kReplayTestsInputSeed);
+	memset(inputs, 0, sizeof(inputs));
+
+	Simulation *simulation = SimulationNew(&config, kReplayTestsMatchSeed);
+	ReplayRecorder *recorder = ReplayRecorderOpen(path, &config, kReplayTestsMatchSeed);
+	void *state = NULL;
+	size_t stateCapacity = 0;
+
+	TestCheck(simulation != NULL && recorder != NULL);
+
+	*events = 0;
+
+	while (!SimulationIsGameOver(simulation)) {
+
+		if (ReplayRecorderKeyframeDue(recorder)) {
+
+			//The state grows with the number of targets and projectiles.
+			if (SimulationStateSize(simulation) > stateCapacity) {
+
+				stateCapacity = SimulationStateSize(simulation) * 2;
+				state = realloc(state, stateCapacity);
+
+			}
+
+			size_t length = SimulationSaveState(simulation, state, stateCapacity);
+			TestCheck(length > 0);
+			ReplayRecorderAddKeyframe(recorder, state, length);
+
+		}
+
+		if ((simulation->tick % kReplayTestsEventInterval) == 0) {
+
+			ReplayRecorderAddEvent(recorder, (int)(*events % 4), (int32_t)simulation->tick - 1000);
+			(*events)++;
+
+		}
+
+		ReplayTestsNextInputs(&random, config.numberOfPlayers, inputs);
+		ReplayRecorderAddFrame(recorder, inputs);
+		SimulationStep(simulation, inputs);
+
+	}
+
+	*frames = simulation->tick;
+	uint32_t checksum = SimulationChecksum(simulation);
+
+	TestCheck(ReplayRecorderClose(recorder, simulation));
+
+	free(state);
+	SimulationFree(simulation);
+
+	return checksum;
+
+}
+
+typedef struct {
+
+	unsigned int count;
+	uint32_t previousFrame;
+	int inOrder;
+
+} ReplayTestsEvents;
+
+static void ReplayTestsCountEvent(uint32_t frame, int eventType, int32_t data, void *context) {
+
+	ReplayTestsEvents *events = (ReplayTestsEvents *)context;
+
+	if (frame % kReplayTestsEventInterval != 0 || data != (int32_t)frame - 1000 ||
+		eventType != (int)(events->count % 4) || (events->count > 0 && frame <= events->previousFrame)) {
+		events->inOrder = 0;
+	}
+
+	events->previousFrame = frame;
+	events->count++;
+
+}
+
+/*
+ Reads the whole file at path into memory. Returns NULL if it can't be read.
+ */
+static uint8_t *ReplayTestsReadFile(const char *path, size_t *length) {
+
+	FILE *file = fopen(path, "rb");
+
+	if (file == NULL) {
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	*length = (size_t)ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	uint8_t *bytes = malloc(*length);
+
+	if (bytes != NULL && fread(bytes, 1, *length, file) != *length) {
+
+		free(bytes);
+		bytes = NULL;
+
+	}
+
+	fclose(file);
+
+	return bytes;
+
+}
+
+static void ReplayTestsWriteFile(const char *path, const uint8_t *bytes, size_t length) {
+
+	FILE *file = fopen(path, "wb");
+
+	TestCheck(file != NULL && fwrite(bytes, 1, length, file) == length);
+	fclose(file);
+
+}
+
+static void TestRecordAndVerify(const char *path) {
+
+	uint32_t frames;
+	unsigned int events;
+	uint32_t checksum = ReplayTestsRecordGame(path, &frames, &events);
+
+	/*
+	 Play the whole file at full speed and check it against it's result.
+	 */
+	ReplayPlayer *player = ReplayPlayerOpen(path);
+	TestCheck(player != NULL);
+
+	if (player == NULL) {
+		return;
+	}
+
+	ReplayTestsEvents playedEvents = { 0, 0, 1 };
+	player->eventHandler = ReplayTestsCountEvent;
+	player->eventContext = &playedEvents;
+
+	TestCheck(player->hasEnd);
+	TestCheck(player->endFrame == frames);
+	TestCheck(player->endChecksum == checksum);
+	TestCheck(player->keyframeCount == (frames + kReplayFileKeyframeInterval - 1) / kReplayFileKeyframeInterval);
+
+	double start = BenchmarkTimerNow();
+	int verified = ReplayPlayerVerify(player);
+	double duration = BenchmarkTimerNow() - start;
+
+	TestCheck(verified);
+	TestCheck(player->simulation->tick == frames);
+	TestCheck(SimulationChecksum(player->simulation) == checksum);
+	TestCheck(player->keyframesChecked == player->keyframeCount);
+	TestCheck(player->keyframeMismatches == 0);
+	TestCheck(playedEvents.count == events);
+	TestCheck(playedEvents.inOrder);
+
+	printf("recorded %u frames (%.0f seconds of play) in %zu bytes, played back in %.1f ms, %.0f frames/s\n",
+		   frames, frames * kSimulationTimestep, player->length, duration * 1000.0, frames / duration);
+
+	/*
+	 Seeking forward, then back behind the simulation, then to the end gives the same game.
+	 */
+	uint32_t middle = frames / 2 + 7;
+	TestCheck(ReplayPlayerSeek(player, middle));
+	TestCheck(player->simulation->tick == middle);
+	TestCheck(ReplayPlayerSeek(player, 5));
+	TestCheck(player->simulation->tick == 5);
+	TestCheck(ReplayPlayerSeek(player, middle));
+	TestCheck(ReplayPlayerPlay(player) == frames - middle);
+	TestCheck(SimulationChecksum(player->simulation) == checksum);
+	TestCheck(!ReplayPlayerSeek(player, frames + 1));
+
+	ReplayPlayerClose(player);
+
+}
+
+static void TestChangedFiles(const char *path, const char *changedPath) {
+
+	size_t length;
+	uint8_t *bytes = ReplayTestsReadFile(path, &length);
+
+	TestCheck(bytes != NULL);
+
+	if (bytes == NULL) {
+		return;
+	}
+
+	/*
+	 A recording which was cut short plays up to the record before the cut, but has no result to verify.
+	 */
+	ReplayTestsWriteFile(changedPath, bytes, length / 2);
+	ReplayPlayer *player = ReplayPlayerOpen(changedPath);
+	TestCheck(player != NULL);
+
+	if (player != NULL) {
+
+		TestCheck(!player->hasEnd);
+		TestCheck(ReplayPlayerPlay(player) > 0);
+		TestCheck(!ReplayPlayerVerify(player));
+		ReplayPlayerClose(player);
+
+	}
+
+	/*
+	 A result which doesn't match the game played fails. The checksum is the last field of the file.
+	 */
+	bytes[length - 1] ^= 0x01;
+	ReplayTestsWriteFile(changedPath, bytes, length);
+	player = ReplayPlayerOpen(changedPath);
+	TestCheck(player != NULL);
+
+	if (player != NULL) {
+
+		TestCheck(!ReplayPlayerVerify(player));
+		ReplayPlayerClose(player);
+
+	}
+
+	bytes[length - 1] ^= 0x01;
+
+	//A file from another version of the format isn't played.
+	ReplayTestsWriteFile(changedPath, bytes, 0);
+	TestCheck(ReplayPlayerOpen(changedPath) == NULL);
+	TestCheck(ReplayPlayerOpen("/nonexistent/directory/game.replay") == NULL);
+
+	free(bytes);
+
+}
+
+/*
+ Plays and verifies each file given on the command line. Returns the exit status.
+ */
+static int ReplayTestsVerifyFiles(int count, char **paths) {
+
+	int failures = 0;
+
+	for (int i = 0; i < count; i++) {
+
+		ReplayPlayer *player = ReplayPlayerOpen(paths[i]);
+
+		if (player == NULL) {
+
+			printf("%s: not a replay file this version can play\n", paths[i]);
+			failures++;
+			continue;
+
+		}
+
+		double start = BenchmarkTimerNow();
+		int verified = ReplayPlayerVerify(player);
+		double duration = BenchmarkTimerNow() - start;
+		uint32_t frames = player->simulation->tick;
+
+		printf("%s: %s, %u frames in %.1f ms (%.0f frames/s), %lu keyframes checked, %lu mismatched, checksum %08x, expected %08x\n",
+			   paths[i], verified ? "verified" : (player->hasEnd ? "FAILED" : "no result to verify"),
+			   frames, duration * 1000.0, frames / duration, player->keyframesChecked, player->keyframeMismatches,
+			   SimulationChecksum(player->simulation), player->endChecksum);
+
+		if (!verified) {
+			failures++;
+		}
+
+		ReplayPlayerClose(player);
+
+	}
+
+	return (failures == 0) ? 0 : 1;
+
+}
+
+int main(int argc, char **argv) {
+
+	if (argc > 1) {
+		return ReplayTestsVerifyFiles(argc - 1, &argv[1]);
+	}
+
+	char path[] = "/tmp/replaytestsXXXXXX";
+	char changedPath[] = "/tmp/replaytestsXXXXXX";
+	int file = mkstemp(path);
+	int changedFile = mkstemp(changedPath);
+
+	TestCheck(file >= 0 && changedFile >= 0);
+	close(file);
+	close(changedFile);
+
+	TestRecordAndVerify(path);
+	TestChangedFiles(path, changedPath);
+
+	unlink(path);
+	unlink(changedPath);
+
+	return TestCheckResult();
+
+}
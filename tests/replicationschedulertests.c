@@ -0,0 +1,265 @@
+//
+//  ReplicationSchedulerTests.c
+//  AberFighter
+//
+//  Created by wde7 on 07/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the ReplicationScheduler's tick. Updates must be chosen from the highest priority to the lowest, the
+ highest must be chosen even when it is larger than the budget, and anything which doesn't fit must be
+ deferred with the priority it has built up while smaller updates behind it are still chosen. A newer update
+ for a pending entity keeps it's priority and the time it became pending, and a low weight update sharing the
+ link with a heavy one which is made again every tick must still be sent.
+ */
+
+#include "ReplicationScheduler.h"
+#include "TestCheck.h"
+
+/*
+ Time between the ticks of the tests, as the network heartbeat ticks.
+ */
+#define kReplicationSchedulerTestsTickInterval 0.05
+
+/*
+ Starts a scheduler and ticks it once with nothing pending, so that the first tick of a test builds up the
+ priorities over a whole tick interval.
+ */
+static void ReplicationSchedulerTestsInit(ReplicationScheduler *scheduler) {
+
+	int selected[kReplicationSchedulerMaximumEntities];
+
+	ReplicationSchedulerInit(scheduler);
+	TestCheck(ReplicationSchedulerTick(scheduler, 1000, 0.0, selected) == 0);
+
+}
+
+/*
+ Entities are chosen from the highest weight to the lowest when they became pending together.
+ */
+static void TestSendOrder(void) {
+
+	ReplicationScheduler scheduler;
+	int selected[kReplicationSchedulerMaximumEntities];
+
+	ReplicationSchedulerTestsInit(&scheduler);
+
+	ReplicationSchedulerUpdate(&scheduler, 3, 1.0f, 10, 0.0);
+	ReplicationSchedulerUpdate(&scheduler, 5, 10.0f, 10, 0.0);
+	ReplicationSchedulerUpdate(&scheduler, 7, 5.0f, 10, 0.0);
+	ReplicationSchedulerUpdate(&scheduler, 9, 2.0f, 10, 0.0);
+
+	TestCheck(ReplicationSchedulerTick(&scheduler, 100, kReplicationSchedulerTestsTickInterval, selected) == 4);
+	TestCheck(selected[0] == 5);
+	TestCheck(selected[1] == 7);
+	TestCheck(selected[2] == 9);
+	TestCheck(selected[3] == 3);
+
+	//Chosen entities are no longer pending and start again from no priority.
+	for (int i = 0; i < kReplicationSchedulerMaximumEntities; i++) {
+		TestCheck(!ReplicationSchedulerIsPending(&scheduler, i));
+	}
+
+	TestCheck(scheduler.entities[5].priority == 0.0f);
+	TestCheck(ReplicationSchedulerFindIdle(&scheduler, 0, kReplicationSchedulerMaximumEntities - 1) == 0);
+
+	/*
+	 A heavy update made later is still chosen after a light one which has waited long enough. The light one
+	 is held back by a heavier update using the whole budget and builds up 1 * 0.45, then the heavy one builds
+	 up 4 * 0.05 while the light one reaches 0.5.
+	 */
+	ReplicationSchedulerUpdate(&scheduler, 0, 100.0f, 100, kReplicationSchedulerTestsTickInterval);
+	ReplicationSchedulerUpdate(&scheduler, 1, 1.0f, 10, kReplicationSchedulerTestsTickInterval);
+	TestCheck(ReplicationSchedulerTick(&scheduler, 100, 0.45, selected) == 1);
+	TestCheck(selected[0] == 0);
+	ReplicationSchedulerUpdate(&scheduler, 2, 4.0f, 10, 0.45);
+
+	TestCheck(ReplicationSchedulerTick(&scheduler, 100, 0.5, selected) == 2);
+	TestCheck(selected[0] == 1);
+	TestCheck(selected[1] == 2);
+
+}
+
+/*
+ The highest priority update is always chosen, even when it is larger than the budget, and nothing else is
+ chosen once it has used up the budget. Updates which don't fit in what is left are skipped while smaller ones
+ after them are chosen.
+ */
+static void TestBudgetOverflow(void) {
+
+	ReplicationScheduler scheduler;
+	int selected[kReplicationSchedulerMaximumEntities];
+	double now = 0.0;
+
+	ReplicationSchedulerTestsInit(&scheduler);
+
+	ReplicationSchedulerUpdate(&scheduler, 0, 10.0f, 200, now);
+	ReplicationSchedulerUpdate(&scheduler, 1, 2.0f, 20, now);
+	ReplicationSchedulerUpdate(&scheduler, 2, 1.0f, 60, now);
+
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 50, now, selected) == 1);
+	TestCheck(selected[0] == 0);
+	TestCheck(ReplicationSchedulerIsPending(&scheduler, 1));
+	TestCheck(ReplicationSchedulerIsPending(&scheduler, 2));
+	TestCheck(scheduler.entities[1].statistics.deferrals == 1);
+	TestCheck(scheduler.entities[2].statistics.deferrals == 1);
+
+	//Entity 1 fits, leaving 30 bytes, which isn't enough for entity 2.
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 50, now, selected) == 1);
+	TestCheck(selected[0] == 1);
+	TestCheck(scheduler.entities[2].statistics.deferrals == 2);
+
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 50, now, selected) == 1);
+	TestCheck(selected[0] == 2);
+	TestCheck(ReplicationSchedulerFindIdle(&scheduler, 0, 2) == 0);
+
+	/*
+	 The second highest doesn't fit in the 20 bytes left by the first, but the third does.
+	 */
+	ReplicationSchedulerUpdate(&scheduler, 4, 3.0f, 30, now);
+	ReplicationSchedulerUpdate(&scheduler, 5, 2.0f, 40, now);
+	ReplicationSchedulerUpdate(&scheduler, 6, 1.0f, 10, now);
+
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 50, now, selected) == 2);
+	TestCheck(selected[0] == 4);
+	TestCheck(selected[1] == 6);
+	TestCheck(ReplicationSchedulerIsPending(&scheduler, 5));
+	TestCheck(ReplicationSchedulerFindIdle(&scheduler, 4, 6) == 4);
+
+	//Exactly filling the budget leaves nothing for an update of any size.
+	ReplicationSchedulerUpdate(&scheduler, 7, 0.5f, 1, now);
+
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 40, now, selected) == 1);
+	TestCheck(selected[0] == 5);
+	TestCheck(ReplicationSchedulerIsPending(&scheduler, 7));
+
+	//Cancelling forgets the update without counting it as sent.
+	ReplicationSchedulerCancel(&scheduler, 7);
+	TestCheck(!ReplicationSchedulerIsPending(&scheduler, 7));
+	TestCheck(scheduler.entities[7].statistics.updatesSent == 0);
+
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 40, now, selected) == 0);
+
+}
+
+/*
+ A deferred update keeps the priority it has built up and the time it became pending, through newer updates
+ for the same entity, and it's staleness is measured from that time when it is finally sent.
+ */
+static void TestDeferral(void) {
+
+	ReplicationScheduler scheduler;
+	int selected[kReplicationSchedulerMaximumEntities];
+	double now = 0.0;
+
+	ReplicationSchedulerTestsInit(&scheduler);
+
+	ReplicationSchedulerUpdate(&scheduler, 8, 1.0f, 100, now);
+
+	/*
+	 Entity 0 is updated every tick with a much larger weight and uses the whole budget, so entity 8 is
+	 deferred. Entity 8 is updated again part of the way through with a new size.
+	 */
+	for (int tick = 1; tick <= 10; tick++) {
+
+		ReplicationSchedulerUpdate(&scheduler, 0, 100.0f, 100, now);
+
+		if (tick == 5) {
+
+			float priority = scheduler.entities[8].priority;
+
+			ReplicationSchedulerUpdate(&scheduler, 8, 1.0f, 80, now);
+			TestCheck(scheduler.entities[8].priority == priority);
+			TestCheck(scheduler.entities[8].size == 80);
+
+		}
+
+		now += kReplicationSchedulerTestsTickInterval;
+		TestCheck(ReplicationSchedulerTick(&scheduler, 100, now, selected) == 1);
+		TestCheck(selected[0] == 0);
+
+	}
+
+	TestCheckClose(scheduler.entities[8].priority, 10 * kReplicationSchedulerTestsTickInterval, 1e-5);
+	TestCheck(scheduler.entities[8].statistics.deferrals == 10);
+	TestCheckClose(ReplicationSchedulerStaleness(&scheduler, 8, now), now, 1e-9);
+
+	//With entity 0 quiet, entity 8 goes next and it's staleness runs from it's first update.
+	now += kReplicationSchedulerTestsTickInterval;
+	TestCheck(ReplicationSchedulerTick(&scheduler, 100, now, selected) == 1);
+	TestCheck(selected[0] == 8);
+	TestCheck(scheduler.entities[8].statistics.updatesSent == 1);
+	TestCheckClose(scheduler.entities[8].statistics.maximumStaleness, now, 1e-9);
+	TestCheckClose(ReplicationStatisticsMeanStaleness(&scheduler.entities[8].statistics), now, 1e-9);
+	TestCheck(ReplicationSchedulerStaleness(&scheduler, 8, now) == 0.0);
+
+}
+
+/*
+ A light update shares a link with room for one update a tick with a heavy one which is made again every
+ tick. The light one's priority keeps growing while the heavy one's starts again each time it is sent, so the
+ light one is sent once it overtakes it, over and over.
+ */
+static void TestNoStarvation(void) {
+
+	ReplicationScheduler scheduler;
+	int selected[kReplicationSchedulerMaximumEntities];
+	double now = 0.0;
+	int ticks = 2000;
+	int longestWait = 0;
+	int wait = 0;
+
+	ReplicationSchedulerTestsInit(&scheduler);
+
+	for (int tick = 0; tick < ticks; tick++) {
+
+		ReplicationSchedulerUpdate(&scheduler, 0, 100.0f, 100, now);
+
+		if (!ReplicationSchedulerIsPending(&scheduler, 1)) {
+			ReplicationSchedulerUpdate(&scheduler, 1, 1.0f, 100, now);
+		}
+
+		now += kReplicationSchedulerTestsTickInterval;
+		TestCheck(ReplicationSchedulerTick(&scheduler, 100, now, selected) == 1);
+
+		wait = (selected[0] == 1) ? 0 : wait + 1;
+
+		if (wait > longestWait) {
+			longestWait = wait;
+		}
+
+	}
+
+	/*
+	 The heavy update builds up 5 a tick and the light one 0.05, so the light one is sent about every 101
+	 ticks.
+	 */
+	ReplicationStatistics total = { 0 };
+
+	ReplicationStatisticsAdd(&total, &scheduler.entities[0].statistics);
+	ReplicationStatisticsAdd(&total, &scheduler.entities[1].statistics);
+
+	TestCheck(longestWait <= 101);
+	TestCheck(scheduler.entities[1].statistics.updatesSent >= (unsigned long)(ticks / 102));
+	TestCheck(total.updatesSent == (unsigned long)ticks);
+	TestCheck(scheduler.entities[0].statistics.deferrals == scheduler.entities[1].statistics.updatesSent);
+	TestCheck(scheduler.entities[1].statistics.maximumStaleness <= 102 * kReplicationSchedulerTestsTickInterval);
+
+}
+
+int main(void) {
+
+	TestSendOrder();
+	TestBudgetOverflow();
+	TestDeferral();
+	TestNoStarvation();
+
+	return TestCheckResult();
+
+}
@@ -0,0 +1,336 @@
+//
+//  RollbackSessionTests.c
+//  AberFighter
+//
+//  Created by wde7 on 04/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the RollbackSession. Two sessions play a game against each other over a simulated link which
+ delays every message by a random number of frames and loses some of them, so both sessions predict, stall
+ and roll back. The state each saved at the start of every frame both have confirmed is checked to have the
+ same checksum on both. A rollback whose saved state can't be loaded is checked to be reported as a desync,
+ and the table the simulation takes it's sines and cosines from is checked against the maths library.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "RollbackSession.h"
+#include "Simulation.h"
+#include "TrigTable.h"
+#include "WireProtocol.h"
+#include "TestCheck.h"
+
+#define kRollbackSessionTestsMatchSeed 20110704
+#define kRollbackSessionTestsLinkSeed 7
+
+/*
+ Frames the game is played for, and the most frames and the percentage of messages the link delays and loses.
+ */
+#define kRollbackSessionTestsFrames 3000
+#define kRollbackSessionTestsMaximumDelay 12
+#define kRollbackSessionTestsLossPercentage 20
+
+/*
+ Messages in flight in one direction. Once it's full further messages are lost.
+ */
+#define kRollbackSessionTestsLinkCapacity 64
+
+typedef struct {
+
+	uint8_t bytes[256];
+	size_t length;
+	unsigned int deliveryFrame;
+
+} RollbackSessionTestsMessage;
+
+typedef struct {
+
+	RollbackSessionTestsMessage messages[kRollbackSessionTestsLinkCapacity];
+	unsigned int count;
+
+} RollbackSessionTestsLink;
+
+/*
+ One end of the game: the session, the player's input and the inputs it's script is drawn from.
+ */
+typedef struct {
+
+	RollbackSession *session;
+	SimulationRandom random;
+	SimulationInput input;
+
+} RollbackSessionTestsPlayer;
+
+/*
+ Changes the player's input every so often, as the replay tests do. The input is only moved on once the
+ session has taken it, so a stall doesn't change what the player does.
+ */
+static void RollbackSessionTestsNextInput(RollbackSessionTestsPlayer *player) {
+
+	if ((SimulationRandomNext(&player->random) % 20) == 0) {
+
+		player->input.heading = (float)(SimulationRandomNext(&player->random) % 360);
+		player->input.speed = (float)(SimulationRandomNext(&player->random) % 100);
+
+	}
+
+	player->input.fire = ((SimulationRandomNext(&player->random) % 8) == 0);
+
+}
+
+/*
+ Writes the session's message and puts it on the link, unless the link loses it.
+ */
+static void RollbackSessionTestsSend(RollbackSessionTestsLink *link, const RollbackSession *session, SimulationRandom *random, unsigned int frame) {
+
+	RollbackSessionTestsMessage message;
+	WireWriter writer;
+
+	WireWriterInit(&writer, message.bytes, sizeof(message.bytes));
+	TestCheck(RollbackSessionWriteMessage(session, &writer));
+
+	message.length = writer.length;
+	message.deliveryFrame = frame + 1 + (SimulationRandomNext(random) % kRollbackSessionTestsMaximumDelay);
+
+	if ((SimulationRandomNext(random) % 100) < kRollbackSessionTestsLossPercentage ||
+		link->count == kRollbackSessionTestsLinkCapacity) {
+		return;
+	}
+
+	link->messages[link->count] = message;
+	link->count++;
+
+}
+
+/*
+ Gives the session every message due by the frame specified. Messages with different delays arrive out of order.
+ */
+static void RollbackSessionTestsDeliver(RollbackSessionTestsLink *link, RollbackSession *session, unsigned int frame) {
+
+	unsigned int kept = 0;
+
+	for (unsigned int i = 0; i < link->count; i++) {
+
+		RollbackSessionTestsMessage *message = &link->messages[i];
+
+		if (message->deliveryFrame > frame) {
+
+			link->messages[kept] = *message;
+			kept++;
+			continue;
+
+		}
+
+		WireReader reader;
+		RollbackInputMessage inputs;
+
+		WireReaderInit(&reader, message->bytes, message->length);
+		TestCheck(RollbackSessionReadMessage(&reader, &inputs));
+		RollbackSessionAddMessage(session, &inputs);
+
+	}
+
+	link->count = kept;
+
+}
+
+/*
+ Returns the checksum of a saved state, loaded into the scratch simulation.
+ */
+static uint32_t RollbackSessionTestsStateChecksum(const RollbackSession *session, Simulation *scratch, uint32_t frame) {
+
+	size_t length;
+	const void *state = RollbackSessionSavedState(session, frame, &length);
+
+	TestCheck(state != NULL);
+
+	if (state == NULL || !SimulationLoadState(scratch, state, length)) {
+
+		TestCheck(0);
+		return 0;
+
+	}
+
+	return SimulationChecksum(scratch);
+
+}
+
+static void TestSessionsAgreeOverLossyLink(void) {
+
+	SimulationConfig config;
+	SimulationRandom linkRandom;
+	RollbackSessionTestsPlayer players[2];
+	RollbackSessionTestsLink links[2];
+	uint32_t checkedFrame = 0;
+	unsigned int mismatches = 0;
+
+	SimulationConfigDefaults(&config, 2);
+	SimulationRandomSeed(&linkRandom, kRollbackSessionTestsLinkSeed);
+	memset(players, 0, sizeof(players));
+	memset(links, 0, sizeof(links));
+
+	for (int p = 0; p < 2; p++) {
+
+		players[p].session = RollbackSessionNew(&config, kRollbackSessionTestsMatchSeed, p);
+		SimulationRandomSeed(&players[p].random, 100 + p);
+		RollbackSessionTestsNextInput(&players[p]);
+
+	}
+
+	Simulation *scratch = SimulationNew(&config, kRollbackSessionTestsMatchSeed);
+
+	TestCheck(players[0].session != NULL && players[1].session != NULL && scratch != NULL);
+
+	if (players[0].session == NULL || players[1].session == NULL || scratch == NULL) {
+		return;
+	}
+
+	for (unsigned int frame = 0; frame < kRollbackSessionTestsFrames; frame++) {
+
+		//Each link carries messages to the player with the same index.
+		for (int p = 0; p < 2; p++) {
+			RollbackSessionTestsDeliver(&links[p], players[p].session, frame);
+		}
+
+		for (int p = 0; p < 2; p++) {
+
+			if (RollbackSessionAdvance(players[p].session, &players[p].input)) {
+				RollbackSessionTestsNextInput(&players[p]);
+			}
+
+		}
+
+		/*
+		 Any rollback is done by Advance, so every state before the confirmed frame of both sessions is final.
+		 Each is checked as soon as both have confirmed it, while it's still in the history.
+		 */
+		uint32_t confirmedFrame = RollbackSessionConfirmedFrame(players[0].session);
+
+		if (RollbackSessionConfirmedFrame(players[1].session) < confirmedFrame) {
+			confirmedFrame = RollbackSessionConfirmedFrame(players[1].session);
+		}
+
+		for (; checkedFrame < confirmedFrame; checkedFrame++) {
+
+			uint32_t checksum = RollbackSessionTestsStateChecksum(players[0].session, scratch, checkedFrame);
+
+			if (checksum != RollbackSessionTestsStateChecksum(players[1].session, scratch, checkedFrame)) {
+				mismatches++;
+			}
+
+		}
+
+		for (int p = 0; p < 2; p++) {
+			RollbackSessionTestsSend(&links[1 - p], players[p].session, &linkRandom, frame);
+		}
+
+	}
+
+	TestCheck(mismatches == 0);
+
+	//The link mustn't have held the game up for long.
+	TestCheck(checkedFrame > kRollbackSessionTestsFrames / 2);
+
+	for (int p = 0; p < 2; p++) {
+
+		const RollbackStatistics *statistics = &players[p].session->statistics;
+
+		//The delays and losses must have made both sessions predict wrongly and stall.
+		TestCheck(statistics->rollbacks > 0);
+		TestCheck(statistics->stalls > 0);
+		TestCheck(!players[p].session->desynchronized);
+
+		RollbackSessionFree(players[p].session);
+
+	}
+
+	SimulationFree(scratch);
+
+}
+
+static void TestFailedRollbackIsDesync(void) {
+
+	SimulationConfig config;
+	SimulationInput input = {45.0f, 30.0f, 0};
+	RollbackInputMessage message;
+
+	SimulationConfigDefaults(&config, 2);
+
+	RollbackSession *session = RollbackSessionNew(&config, kRollbackSessionTestsMatchSeed, 0);
+
+	TestCheck(session != NULL);
+
+	if (session == NULL) {
+		return;
+	}
+
+	for (int i = 0; i < 4; i++) {
+		TestCheck(RollbackSessionAdvance(session, &input));
+	}
+
+	/*
+	 The peer's real input for the first frames after the input delay is different from the prediction, so
+	 the first of them must be rolled back to.
+	 */
+	memset(&message, 0, sizeof(message));
+	message.firstFrame = kRollbackSessionInputDelay;
+	message.count = 2;
+	message.inputs[0].heading = message.inputs[1].heading = 10;
+	message.inputs[0].speed = message.inputs[1].speed = 50;
+
+	RollbackSessionAddMessage(session, &message);
+	TestCheck(session->rollbackPending && session->rollbackFrame == kRollbackSessionInputDelay);
+
+	//A state of the wrong size can't be loaded.
+	session->savedStates[kRollbackSessionInputDelay].length = 1;
+
+	TestCheck(!RollbackSessionAdvance(session, &input));
+	TestCheck(session->desynchronized);
+	TestCheck(!RollbackSessionAdvance(session, &input));
+	TestCheck(session->statistics.framesAdvanced == 4);
+
+	RollbackSessionFree(session);
+
+}
+
+static void TestTrigTableMatchesLibrary(void) {
+
+	double largestError = 0.0;
+
+	for (int i = -7200; i <= 7200; i++) {
+
+		float degrees = (float)i * 0.1f;
+		double radians = (double)degrees * (3.14159265358979323846 / 180.0);
+		double sineError = fabs(TrigTableSine(degrees) - sin(radians));
+		double cosineError = fabs(TrigTableCosine(degrees) - cos(radians));
+
+		if (sineError > largestError) {
+			largestError = sineError;
+		}
+
+		if (cosineError > largestError) {
+			largestError = cosineError;
+		}
+
+	}
+
+	TestCheck(largestError < 1e-5);
+
+	//The quarters of the circle are exact.
+	TestCheck(TrigTableSine(0.0f) == 0.0f && TrigTableSine(90.0f) == 1.0f);
+	TestCheck(TrigTableSine(180.0f) == 0.0f && TrigTableSine(270.0f) == -1.0f);
+	TestCheck(TrigTableCosine(0.0f) == 1.0f && TrigTableCosine(-360.0f) == 1.0f);
+
+}
+
+int main(void) {
+
+	TestSessionsAgreeOverLossyLink();
+	TestFailedRollbackIsDesync();
+	TestTrigTableMatchesLibrary();
+
+	return TestCheckResult();
+
+}
@@ -0,0 +1,198 @@
+//
+//  SchedulerBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 07/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The host version of the app's SchedulerBenchmark. It measures how the cost of a scheduler tick grows with the
+ number of timers waiting to fire, both with every timer updated every tick, as CCTimer's update: was called
+ for each timer before, and with the ccTimerHeap the CCScheduler keeps it's running timers in now, where only
+ the timers which are due are looked at. Each timer is a one-shot timer which is scheduled again for the
+ furthest due time when it fires, like the ones a TargetShip or PlayerShip schedules, so
+ kSchedulerBenchmarkTimersPerTick fire every tick however many are pending. Both approaches must fire the
+ same timers.
+
+ The heap is ticked the way CCScheduler's tick: does it, without the timers scheduled from inside a selector,
+ which none of these are.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ccTimerHeap.h"
+#include "BenchmarkTimer.h"
+
+/*
+ The values from SchedulerBenchmark.h, which is an Objective-C header.
+ */
+#define kSchedulerBenchmarkTickInterval (1.0 / 60.0)
+#define kSchedulerBenchmarkTicks 600
+#define kSchedulerBenchmarkTimersPerTick 4
+
+static const int kSchedulerBenchmarkPendingTimers[] = { 100, 1000, 10000 };
+
+#define kSchedulerBenchmarkRuns (int)(sizeof(kSchedulerBenchmarkPendingTimers) / sizeof(kSchedulerBenchmarkPendingTimers[0]))
+
+typedef struct SchedulerBenchmarkTimer SchedulerBenchmarkTimer;
+
+/*
+ The parts of a CCTimer which the scheduler uses, with the selector called through a function pointer as it is
+ called through it's IMP.
+ */
+struct SchedulerBenchmarkTimer {
+
+	void (*fire)(SchedulerBenchmarkTimer *timer, double dt);
+	double elapsed;
+	double interval;
+	int heapIndex;
+	unsigned long timesFired;
+
+};
+
+//Interval every timer is scheduled again with when it fires.
+static double furthestInterval;
+
+static void SchedulerBenchmarkFire(SchedulerBenchmarkTimer *timer, double dt) {
+
+	timer->timesFired++;
+	timer->interval = furthestInterval;
+
+}
+
+/*
+ Each group of kSchedulerBenchmarkTimersPerTick timers is due a tick after the one before it, half way through
+ the tick so that rounding can't move a timer into a different tick with one approach than the other. A timer
+ fires at the end of the tick it is due in and is then due again half a tick before the group's next turn.
+ */
+static void SchedulerBenchmarkTimersInit(SchedulerBenchmarkTimer *timers, int pendingTimers) {
+
+	for (int i = 0; i < pendingTimers; i++) {
+
+		timers[i].fire = SchedulerBenchmarkFire;
+		timers[i].elapsed = 0.0;
+		timers[i].interval = (i / kSchedulerBenchmarkTimersPerTick + 0.5) * kSchedulerBenchmarkTickInterval;
+		timers[i].heapIndex = kCCTimerIdle;
+		timers[i].timesFired = 0;
+
+	}
+
+}
+
+/*
+ Every timer's elapsed time is increased, and those which have reached their interval fire and start again.
+ */
+static void SchedulerBenchmarkUpdateAll(SchedulerBenchmarkTimer *timers, int pendingTimers, double dt) {
+
+	for (int i = 0; i < pendingTimers; i++) {
+
+		SchedulerBenchmarkTimer *timer = &timers[i];
+
+		timer->elapsed += dt;
+
+		if (timer->elapsed >= timer->interval) {
+
+			timer->fire(timer, timer->elapsed);
+			timer->elapsed = 0.0;
+
+		}
+
+	}
+
+}
+
+/*
+ Only the timers at the top of the heap which are due are taken out, fired and put back in with their next due
+ time.
+ */
+static void SchedulerBenchmarkUpdateHeap(ccTimerHeap *heap, double *currentTime, double dt) {
+
+	*currentTime += dt;
+
+	while (heap->num > 0 && heap->entries[0].fireTime <= *currentTime) {
+
+		ccTimerHeapEntry entry = heap->entries[0];
+		SchedulerBenchmarkTimer *timer = entry.timer;
+
+		ccTimerHeapRemove(heap, 0);
+
+		timer->fire(timer, *currentTime - timer->elapsed);
+		timer->elapsed = *currentTime;
+
+		entry.fireTime = *currentTime + timer->interval;
+		ccTimerHeapPush(heap, entry);
+
+	}
+
+}
+
+int main(void) {
+
+	int failed = 0;
+
+	printf("Mean time of a scheduler tick in us, with %d timers firing each tick.\n", kSchedulerBenchmarkTimersPerTick);
+	printf("%s\n", "pending timers   update all     heap   speedup   timers fired");
+
+	for (int run = 0; run < kSchedulerBenchmarkRuns; run++) {
+
+		int pendingTimers = kSchedulerBenchmarkPendingTimers[run];
+		SchedulerBenchmarkTimer *timers = malloc(sizeof(SchedulerBenchmarkTimer) * pendingTimers);
+		unsigned long updateAllFired = 0;
+		unsigned long heapFired = 0;
+
+		furthestInterval = (pendingTimers / kSchedulerBenchmarkTimersPerTick - 0.5) * kSchedulerBenchmarkTickInterval;
+
+		SchedulerBenchmarkTimersInit(timers, pendingTimers);
+
+		double start = BenchmarkTimerNow();
+
+		for (int tick = 0; tick < kSchedulerBenchmarkTicks; tick++) {
+			SchedulerBenchmarkUpdateAll(timers, pendingTimers, kSchedulerBenchmarkTickInterval);
+		}
+
+		double updateAllTime = (BenchmarkTimerNow() - start) / kSchedulerBenchmarkTicks;
+
+		for (int i = 0; i < pendingTimers; i++) {
+			updateAllFired += timers[i].timesFired;
+		}
+
+		/*
+		 In the heap a timer's elapsed time is the scheduler time it last fired at, as CCTimer's startTime is.
+		 */
+		ccTimerHeap *heap = ccTimerHeapNew(64);
+		double currentTime = 0.0;
+
+		SchedulerBenchmarkTimersInit(timers, pendingTimers);
+
+		for (int i = 0; i < pendingTimers; i++) {
+
+			ccTimerHeapEntry entry = { timers[i].interval, &timers[i], NULL, &timers[i].heapIndex };
+			ccTimerHeapPush(heap, entry);
+
+		}
+
+		start = BenchmarkTimerNow();
+
+		for (int tick = 0; tick < kSchedulerBenchmarkTicks; tick++) {
+			SchedulerBenchmarkUpdateHeap(heap, &currentTime, kSchedulerBenchmarkTickInterval);
+		}
+
+		double heapTime = (BenchmarkTimerNow() - start) / kSchedulerBenchmarkTicks;
+
+		for (int i = 0; i < pendingTimers; i++) {
+			heapFired += timers[i].timesFired;
+		}
+
+		failed |= (updateAllFired != heapFired) || (heapFired != kSchedulerBenchmarkTicks * kSchedulerBenchmarkTimersPerTick);
+
+		printf("%14d   %10.2f   %6.2f   %6.1fx   %12lu%s\n", pendingTimers, updateAllTime * 1e6, heapTime * 1e6,
+			   updateAllTime / heapTime, heapFired, (updateAllFired == heapFired) ? "" : "  MISMATCH");
+
+		ccTimerHeapFree(heap);
+		free(timers);
+
+	}
+
+	return failed;
+
+}
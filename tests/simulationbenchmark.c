@@ -0,0 +1,170 @@
+//
+//  SimulationBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Runs whole games on the headless Simulation back to back, each with it's own seed and randomly steered
+ players, and reports how many games and ticks it gets through per second. This is the CPU cost of the game
+ rules without any drawing. Every game is then run again from the same seed and must finish with the same
+ checksum, scores and tick count, which is what makes the Simulation usable for balance and regression tests.
+
+ The Simulation is reset between games rather than created again, as it would be by a balance test, so the
+ games after the first don't allocate.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Simulation.h"
+#include "BenchmarkTimer.h"
+
+/*
+ Number of games run for each game length measured.
+ */
+#define kSimulationBenchmarkGames 300
+
+/*
+ Game lengths measured in seconds: the length used by the app and a short game.
+ */
+static const int kSimulationBenchmarkGameLengths[] = { 120, 30 };
+
+/*
+ World sizes measured in points: the app's screen and a larger one, as a tablet would have.
+ */
+static const float kSimulationBenchmarkWorldSizes[][2] = { { kGameScreenWidth, kGameScreenHeight }, { 1024.0f, 768.0f } };
+
+/*
+ The input of every player carries over from tick to tick and only changes every so often, as it does when
+ the device is tilted. The players fire once every eight ticks on average.
+ */
+typedef struct {
+
+	SimulationRandom random;
+	SimulationInput inputs[kSimulationMaximumPlayers];
+
+} SimulationBenchmarkPlayers;
+
+static void SimulationBenchmarkProvideInputs(const Simulation *simulation, SimulationInput *inputs, void *context) {
+
+	SimulationBenchmarkPlayers *players = (SimulationBenchmarkPlayers *)context;
+
+	for (int p = 0; p < simulation->config.numberOfPlayers; p++) {
+
+		SimulationInput *input = &players->inputs[p];
+
+		if ((SimulationRandomNext(&players->random) % 30) == 0) {
+
+			input->heading = (float)(SimulationRandomNext(&players->random) % 360);
+			input->speed = (float)(SimulationRandomNext(&players->random) % (int)simulation->config.playerMaximumSpeed);
+
+		}
+
+		input->fire = ((SimulationRandomNext(&players->random) % 8) == 0);
+		inputs[p] = *input;
+
+	}
+
+}
+
+/*
+ The result of a game, compared between the two runs of it.
+ */
+typedef struct {
+
+	uint32_t ticks;
+	uint32_t checksum;
+	int scores[kSimulationMaximumPlayers];
+
+} SimulationBenchmarkResult;
+
+static void SimulationBenchmarkRunGame(Simulation *simulation, uint32_t seed, SimulationBenchmarkResult *result) {
+
+	SimulationBenchmarkPlayers players;
+
+	memset(&players, 0, sizeof(players));
+	SimulationRandomSeed(&players.random, seed ^ 0x5EED);
+	SimulationReset(simulation, seed);
+
+	result->ticks = SimulationRunGame(simulation, SimulationBenchmarkProvideInputs, &players);
+	result->checksum = SimulationChecksum(simulation);
+
+	for (int p = 0; p < kSimulationMaximumPlayers; p++) {
+		result->scores[p] = simulation->players[p].score;
+	}
+
+}
+
+int main(void) {
+
+	int failed = 0;
+
+	for (size_t w = 0; w < sizeof(kSimulationBenchmarkWorldSizes) / sizeof(kSimulationBenchmarkWorldSizes[0]); w++) {
+
+		for (size_t l = 0; l < sizeof(kSimulationBenchmarkGameLengths) / sizeof(kSimulationBenchmarkGameLengths[0]); l++) {
+
+			for (int numberOfPlayers = 1; numberOfPlayers <= kSimulationMaximumPlayers; numberOfPlayers++) {
+
+				SimulationConfig config;
+				SimulationConfigDefaultsWithWorldSize(&config, numberOfPlayers, kSimulationBenchmarkWorldSizes[w][0],
+													  kSimulationBenchmarkWorldSizes[w][1]);
+				config.gameLength = kSimulationBenchmarkGameLengths[l];
+
+				Simulation *simulation = SimulationNew(&config, 0);
+				SimulationBenchmarkResult *results = calloc(kSimulationBenchmarkGames, sizeof(SimulationBenchmarkResult));
+				uint64_t ticks = 0;
+				int64_t totalScore = 0;
+
+				double start = BenchmarkTimerNow();
+
+				for (uint32_t game = 0; game < kSimulationBenchmarkGames; game++) {
+
+					SimulationBenchmarkRunGame(simulation, game, &results[game]);
+					ticks += results[game].ticks;
+					totalScore += results[game].scores[0];
+
+				}
+
+				double duration = BenchmarkTimerNow() - start;
+
+				/*
+				 Every game must come out the same the second time.
+				 */
+				unsigned int diverged = 0;
+
+				for (uint32_t game = 0; game < kSimulationBenchmarkGames; game++) {
+
+					SimulationBenchmarkResult rerun;
+					SimulationBenchmarkRunGame(simulation, game, &rerun);
+
+					if (memcmp(&rerun, &results[game], sizeof(rerun)) != 0) {
+						diverged++;
+					}
+
+				}
+
+				printf("%.0fx%.0f, %d player, %3d s games: %d games in %.2f s, %.0f games/s, %.2f million ticks/s, %.2f us/tick, "
+					   "average score %.0f, %u of %d reruns diverged\n",
+					   config.worldWidth, config.worldHeight, numberOfPlayers, config.gameLength, kSimulationBenchmarkGames,
+					   duration, kSimulationBenchmarkGames / duration, ticks / duration / 1e6, duration / ticks * 1e6, (double)totalScore / kSimulationBenchmarkGames,
+					   diverged, kSimulationBenchmarkGames);
+
+				if (diverged > 0) {
+					failed = 1;
+				}
+
+				free(results);
+				SimulationFree(simulation);
+
+			}
+
+		}
+
+	}
+
+	return failed;
+
+}
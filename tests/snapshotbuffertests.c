@@ -0,0 +1,227 @@
+//
+//  SnapshotBufferTests.c
+//  AberFighter
+//
+//  Created by wde7 on 07/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Tests of the SnapshotBuffer with an entity moving in a straight line at a steady speed, sent from a device
+ whose clock is far ahead of the local one. However much the packets are delayed, the entity must move by
+ the same distance every frame, drawn interpolationDelay behind it's quickest packet, and changing the
+ interpolation delay must never make it jump: from frame to frame it can only move as far as the time being
+ drawn has moved.
+ */
+
+#include "SnapshotBuffer.h"
+#include "Simulation.h"
+#include "WireProtocol.h"
+#include "TestCheck.h"
+
+#define kSnapshotBufferTestsFrameInterval (1.0 / 60.0)
+#define kSnapshotBufferTestsSendInterval 0.05
+#define kSnapshotBufferTestsSpeed 60.0
+
+//The sender's clock is this far ahead of the local clock.
+#define kSnapshotBufferTestsClockOffset 5000.0
+
+/*
+ The entity moves right along the bottom of the screen, starting at the left edge at local time 0.
+ */
+static double SnapshotBufferTestsPositionAt(double time) {
+
+	return kSnapshotBufferTestsSpeed * time;
+
+}
+
+typedef struct {
+
+	SnapshotBuffer buffer;
+	SimulationRandom random;
+	double nextSendTime;
+	double latency;
+	double jitter;
+
+	//Local times the snapshots in flight were sent at and arrive at.
+	double inFlightTimes[64];
+	double arrivalTimes[64];
+	unsigned int inFlight;
+
+} SnapshotBufferTestsLink;
+
+static void SnapshotBufferTestsLinkInit(SnapshotBufferTestsLink *link, double latency, double jitter) {
+
+	SnapshotBufferInit(&link->buffer, 0.1, 0.25, 0.1);
+	SimulationRandomSeed(&link->random, 7);
+	link->nextSendTime = 0.0;
+	link->latency = latency;
+	link->jitter = jitter;
+	link->inFlight = 0;
+
+}
+
+/*
+ Sends a snapshot when one is due and adds the snapshots which have arrived by the local time now, stamped
+ with the sender's time as it is sent on the wire.
+ */
+static void SnapshotBufferTestsLinkStep(SnapshotBufferTestsLink *link, double now) {
+
+	if (now >= link->nextSendTime && link->inFlight < 64) {
+
+		double fraction = SimulationRandomNext(&link->random) / 4294967296.0;
+
+		link->inFlightTimes[link->inFlight] = now;
+		link->arrivalTimes[link->inFlight] = now + link->latency + fraction * link->jitter;
+		link->inFlight++;
+		link->nextSendTime += kSnapshotBufferTestsSendInterval;
+
+	}
+
+	unsigned int kept = 0;
+
+	for (unsigned int i = 0; i < link->inFlight; i++) {
+
+		if (link->arrivalTimes[i] > now) {
+
+			link->inFlightTimes[kept] = link->inFlightTimes[i];
+			link->arrivalTimes[kept] = link->arrivalTimes[i];
+			kept++;
+			continue;
+
+		}
+
+		uint16_t sendTime = WireQuantizeTime(link->inFlightTimes[i] + kSnapshotBufferTestsClockOffset);
+		double sampleTime = WireDequantizeTime(sendTime, SnapshotBufferSenderTime(&link->buffer, link->arrivalTimes[i]));
+		Snapshot snapshot = { sampleTime, (float)SnapshotBufferTestsPositionAt(link->inFlightTimes[i]), 10.0f, 90.0f,
+							  kSnapshotBufferTestsSpeed, 90.0f };
+
+		SnapshotBufferAdd(&link->buffer, &snapshot, link->arrivalTimes[i], now);
+
+	}
+
+	link->inFlight = kept;
+
+}
+
+/*
+ Snapshots which spend anywhere from 50 to 110 ms on the way are drawn moving a steady point a frame, behind
+ where the entity is by the interpolation delay and the quickest trip, once the clock offset has settled.
+ Stamped with the time they arrived they would speed up and slow down with the jitter.
+ */
+static void TestJitterIsRemoved(void) {
+
+	SnapshotBufferTestsLink link;
+	double worstStepError = 0.0;
+	double smallestLag = 1.0;
+	double largestLag = 0.0;
+	float previousX = 0.0f;
+	float positionX, positionY, rotation;
+
+	SnapshotBufferTestsLinkInit(&link, 0.05, 0.06);
+
+	for (int frame = 0; frame < 600; frame++) {
+
+		double now = frame * kSnapshotBufferTestsFrameInterval;
+
+		SnapshotBufferTestsLinkStep(&link, now);
+
+		if (!SnapshotBufferSample(&link.buffer, now, kSnapshotBufferTestsFrameInterval, &positionX, &positionY, &rotation)) {
+			continue;
+		}
+
+		TestCheckClose(positionY, 10.0f, 1e-4);
+
+		if (frame >= 300) {
+
+			double stepError = fabs((positionX - previousX) - kSnapshotBufferTestsSpeed * kSnapshotBufferTestsFrameInterval);
+			double lag = (SnapshotBufferTestsPositionAt(now) - positionX) / kSnapshotBufferTestsSpeed;
+
+			if (stepError > worstStepError) {
+				worstStepError = stepError;
+			}
+
+			if (lag < smallestLag) {
+				smallestLag = lag;
+			}
+
+			if (lag > largestLag) {
+				largestLag = lag;
+			}
+
+		}
+
+		previousX = positionX;
+
+	}
+
+	/*
+	 The quickest trip is a little over the latency, and the clock offset creeps up between the quickest trips,
+	 by no more than 20 ms here. When a quicker trip brings it back down the time drawn slows by at most 10%,
+	 a tenth of the point moved each frame, where the jitter would have stopped the entity for whole frames.
+	 */
+	TestCheck(worstStepError < 0.1 * kSnapshotBufferTestsSpeed * kSnapshotBufferTestsFrameInterval + 0.001);
+	TestCheck(smallestLag >= 0.1 + 0.05 - 0.001);
+	TestCheck(largestLag < 0.1 + 0.05 + 0.02);
+	TestCheckClose(link.buffer.renderDelay, link.buffer.interpolationDelay + link.buffer.clockOffset, 1e-6);
+
+}
+
+/*
+ The interpolation delay is changed up and down, by small and large amounts. The entity only ever moves
+ forwards, and by no more than the time drawn could have moved in a frame plus the correction of a jump.
+ */
+static void TestDelayChangesDontJump(void) {
+
+	SnapshotBufferTestsLink link;
+	static const double delays[] = { 0.1, 0.2, 0.15, 0.6, 0.1 };
+	float previousX = 0.0f;
+	int hasPrevious = 0;
+	double largestStep = 0.0;
+	float positionX, positionY, rotation;
+
+	SnapshotBufferTestsLinkInit(&link, 0.02, 0.0);
+
+	for (int frame = 0; frame < 1500; frame++) {
+
+		double now = frame * kSnapshotBufferTestsFrameInterval;
+
+		link.buffer.interpolationDelay = delays[(frame / 300) % 5];
+		SnapshotBufferTestsLinkStep(&link, now);
+
+		if (!SnapshotBufferSample(&link.buffer, now, kSnapshotBufferTestsFrameInterval, &positionX, &positionY, &rotation)) {
+			continue;
+		}
+
+		if (hasPrevious) {
+
+			double step = positionX - previousX;
+
+			if (step > largestStep || -step > largestStep) {
+				largestStep = fabs(step);
+			}
+
+		}
+
+		previousX = positionX;
+		hasPrevious = 1;
+
+	}
+
+	/*
+	 The time drawn moves by a frame give or take 10%, which is 1.1 points. The jumps of 0.45 and 0.5 seconds are
+	 smoothed out over the correction time, adding 30 points * (1 - exp(-1/6)), about 4.6 points, to the first
+	 frame after each.
+	 */
+	TestCheck(largestStep < 1.2 + 4.7);
+	TestCheckClose(link.buffer.renderDelay, 0.1 + link.buffer.clockOffset, 1e-6);
+
+}
+
+int main(void) {
+
+	TestJitterIsRemoved();
+	TestDelayChangesDontJump();
+
+	return TestCheckResult();
+
+}
@@ -0,0 +1,493 @@
+//
+//  SyncBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 05/07/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Measures how closely and how late each device of a two player game draws the other's ship, end to end,
+ over links of several qualities. It covers the whole path a ship's movement takes in the app: the
+ DirectionalStream and WireProtocol batches of a NetworkLink on the way out, the simulated link, and on the
+ way in the NetworkLink again and a SnapshotBuffer set up and fed as the MultiplayerActionLayer does, which
+ is sampled every frame. Each device has it's own clock, as they were started at different times, and the
+ ship states are stamped with the sender's.
+
+ Each ship circles at a steady speed, so where it was at any moment is known exactly. For every frame drawn
+ the benchmark reports:
+
+   - the sync latency, how long ago the ship was where it's drawn
+   - the error, how far the drawn ship is from where the ship is now
+
+ It also reports the bytes per second each device sends, the updates applied per second and how long after
+ it was made each was applied, and how fast the host runs the whole path, in seconds of play per second,
+ leaving out the time spent measuring the sync latency.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "NetworkLink.h"
+#include "Simulation.h"
+#include "SnapshotBuffer.h"
+#include "BenchmarkTimer.h"
+
+/*
+ The MultiplayerActionLayer's snapshot settings, which are in an Objective-C header.
+ */
+#define kPeerSnapshotInterpolationDelay (2.0 / kLinkEstimatorInitialSendRate)
+#define kPeerSnapshotMaximumExtrapolation 0.25
+#define kPeerSnapshotCorrectionTime 0.1
+
+/*
+ The BluetoothCommsManager's heartbeat interval.
+ */
+#define kSyncBenchmarkHeartbeatInterval 0.1
+
+#define kSyncBenchmarkFrameRate 60
+#define kSyncBenchmarkDuration 60.0
+#define kSyncBenchmarkWarmUp 5.0
+
+/*
+ The circle each ship flies around, and how far back the sync latency is looked for.
+ */
+#define kSyncBenchmarkRadius 100.0
+#define kSyncBenchmarkLatencySearch 1.0
+#define kSyncBenchmarkLatencyStep 0.001
+
+#define kSyncBenchmarkShipHistorySize 256
+#define kSyncBenchmarkPacketsInFlight 256
+
+/*
+ The conditions of a link, the same in both directions.
+ */
+typedef struct {
+
+	const char *name;
+	double latency;
+	double jitter;
+	int lossPercent;
+	int reorderPercent;
+
+} SyncLinkConditions;
+
+static const SyncLinkConditions syncBenchmarkConditions[] = {
+
+	{ "perfect", 0.0, 0.0, 0, 0 },
+	{ "good", 0.02, 0.005, 2, 1 },
+	{ "busy", 0.05, 0.015, 5, 5 },
+	{ "poor", 0.1, 0.03, 10, 5 }
+
+};
+
+typedef struct {
+
+	double time;
+	int16_t positionX;
+	int16_t positionY;
+
+} SyncShipState;
+
+struct SyncGame;
+
+typedef struct {
+
+	struct SyncGame *game;
+	int player;
+
+	NetworkLink link;
+	NetworkTrafficStatistics traffic;
+	NetworkTrafficStatistics warmUpTraffic;
+
+	PlayerShipDirectionalInformation ship;
+	SyncShipState shipHistory[kSyncBenchmarkShipHistorySize];
+	unsigned int shipHistoryCount;
+	double lastDirectionalTime;
+	double lastHeartbeatTime;
+
+	//The other device's ship as this one draws it.
+	SnapshotBuffer peerSnapshots;
+
+	//The device's own clock is this far ahead of the game's, as the devices were started at different times.
+	double clockBase;
+
+} SyncDevice;
+
+typedef struct {
+
+	int inUse;
+	int to;
+	double deliveryTime;
+	uint8_t bytes[kNetworkDataPacketSize];
+	size_t length;
+
+} SyncPacket;
+
+typedef struct SyncGame {
+
+	const SyncLinkConditions *conditions;
+	SyncDevice devices[2];
+	SyncPacket packets[kSyncBenchmarkPacketsInFlight];
+	SimulationRandom random;
+	double now;
+	int measuring;
+
+	unsigned long updates;
+	double totalUpdateLatency;
+	double maximumUpdateLatency;
+	unsigned long framesDrawn;
+	double totalSyncLatency;
+	double maximumSyncLatency;
+	double totalError;
+	double maximumError;
+
+	//Time the host spent searching for the sync latency, which isn't part of the path being measured.
+	double searchTime;
+
+} SyncGame;
+
+static double SyncRandomFraction(SyncGame *game) {
+
+	return SimulationRandomNext(&game->random) / 4294967296.0;
+
+}
+
+/*
+ Where a player's ship is at a moment in time. Heading 0 is up the screen and headings increase clockwise.
+ */
+static void SyncShipAt(int player, double time, PlayerShipDirectionalInformation *ship) {
+
+	double angularSpeed = 0.4 + 0.1 * player;
+	double angle = time * angularSpeed + player;
+	double heading = atan2(-sin(angle), cos(angle)) * (180.0 / 3.14159265358979323846);
+
+	ship->newHeading = (float)((heading < 0.0) ? heading + 360.0 : heading);
+	ship->newSpeed = (float)(kSyncBenchmarkRadius * angularSpeed);
+	ship->currentPositionX = (float)(240.0 + kSyncBenchmarkRadius * cos(angle));
+	ship->currentPositionY = (float)(160.0 + kSyncBenchmarkRadius * sin(angle));
+	ship->currentRotation = ship->newHeading;
+
+}
+
+static void SyncTransmit(NetworkLink *link, const uint8_t *bytes, size_t length, void *context) {
+
+	SyncDevice *device = context;
+	SyncGame *game = device->game;
+	const SyncLinkConditions *conditions = game->conditions;
+	SyncPacket *packet = NULL;
+
+	for (int i = 0; i < kSyncBenchmarkPacketsInFlight && packet == NULL; i++) {
+
+		if (!game->packets[i].inUse) {
+			packet = &game->packets[i];
+		}
+
+	}
+
+	if (packet == NULL || (int)(SimulationRandomNext(&game->random) % 100) < conditions->lossPercent) {
+		return;
+	}
+
+	double delay = conditions->latency + ((SyncRandomFraction(game) * 2.0) - 1.0) * conditions->jitter;
+
+	if ((int)(SimulationRandomNext(&game->random) % 100) < conditions->reorderPercent) {
+		delay += conditions->latency + conditions->jitter;
+	}
+
+	packet->inUse = 1;
+	packet->to = 2 - device->player;
+	packet->deliveryTime = game->now + delay;
+	memcpy(packet->bytes, bytes, length);
+	packet->length = length;
+
+}
+
+/*
+ Adds a state of the peer's ship to the snapshots, as addPeerSnapshotWithHeading: does, and records how long
+ after it was made it arrived.
+ */
+static void SyncApplyShip(SyncGame *game, SyncDevice *device, const PlayerShipDirectionalInformation *information) {
+
+	SyncDevice *origin = &game->devices[2 - device->player];
+	SnapshotBuffer *snapshots = &device->peerSnapshots;
+	float peerSendRate = device->link.linkEstimator.statistics.peerSendRate;
+	double now = game->now + device->clockBase;
+
+	if (peerSendRate > 0.0f) {
+		snapshots->interpolationDelay = 2.0 / peerSendRate;
+	}
+
+	double sendTime = WireDequantizeTime(information->sendTime, SnapshotBufferSenderTime(snapshots, now));
+	Snapshot snapshot = { sendTime, information->currentPositionX, information->currentPositionY,
+						  information->newHeading, information->newSpeed, information->currentRotation };
+
+	SnapshotBufferAdd(snapshots, &snapshot, now, now);
+
+	if (!game->measuring) {
+		return;
+	}
+
+	int16_t positionX = WireQuantizePosition(information->currentPositionX);
+	int16_t positionY = WireQuantizePosition(information->currentPositionY);
+
+	for (unsigned int i = 0; i < origin->shipHistoryCount && i < kSyncBenchmarkShipHistorySize; i++) {
+
+		const SyncShipState *state = &origin->shipHistory[(origin->shipHistoryCount - 1 - i) % kSyncBenchmarkShipHistorySize];
+
+		if (state->positionX == positionX && state->positionY == positionY) {
+
+			double latency = game->now - state->time;
+
+			game->updates++;
+			game->totalUpdateLatency += latency;
+
+			if (latency > game->maximumUpdateLatency) {
+				game->maximumUpdateLatency = latency;
+			}
+
+			return;
+
+		}
+
+	}
+
+}
+
+static void SyncReceive(SyncGame *game, SyncDevice *device, const SyncPacket *packet) {
+
+	NetworkLink *link = &device->link;
+	WireReader reader;
+	WirePacketHeader header;
+
+	WireReaderInit(&reader, packet->bytes, packet->length);
+
+	if (!WireReadHeader(&reader, &header)) {
+		return;
+	}
+
+	int outOfDate = !NetworkLinkPacketReceived(link, &header, WireReaderRemaining(&reader), game->now);
+	uint8_t messageType;
+	WireReader message;
+
+	if (header.packetType != kPacketTypeBatch) {
+		return;
+	}
+
+	while (WireReadMessage(&reader, &messageType, &message)) {
+
+		if (messageType == kPacketTypeReliableChannel) {
+
+			ReliableChannelRead(&link->reliableChannel, &message, game->now);
+
+		} else if (messageType == kPacketTypeLinkReport) {
+
+			LinkEstimatorReadReport(&link->linkEstimator, &message, game->now);
+
+		} else if (messageType == kPacketTypeDirectionalDataAcknowledgement) {
+
+			NetworkLinkReceiveDirectionalAcknowledgement(link, &message);
+
+		} else if (messageType == kPacketTypePeerPlayerShipDirectionalData && !outOfDate) {
+
+			PlayerShipDirectionalInformation information;
+
+			if (NetworkLinkReceiveDirectionalData(link, &message, &information)) {
+				SyncApplyShip(game, device, &information);
+			}
+
+		}
+
+	}
+
+}
+
+/*
+ Draws the peer's ship from the snapshots and measures it against the ship's real path.
+ */
+static void SyncDrawPeer(SyncGame *game, SyncDevice *device) {
+
+	int peer = 3 - device->player;
+	PlayerShipDirectionalInformation ship;
+	float positionX, positionY, rotation;
+
+	if (!SnapshotBufferSample(&device->peerSnapshots, game->now + device->clockBase, 1.0 / kSyncBenchmarkFrameRate,
+							  &positionX, &positionY, &rotation) || !game->measuring) {
+		return;
+	}
+
+	SyncShipAt(peer, game->now, &ship);
+
+	double error = hypot(positionX - ship.currentPositionX, positionY - ship.currentPositionY);
+	double latency = 0.0;
+	double closest = error;
+	double searchStart = BenchmarkTimerNow();
+
+	for (double age = kSyncBenchmarkLatencyStep; age <= kSyncBenchmarkLatencySearch; age += kSyncBenchmarkLatencyStep) {
+
+		SyncShipAt(peer, game->now - age, &ship);
+
+		double distance = hypot(positionX - ship.currentPositionX, positionY - ship.currentPositionY);
+
+		if (distance < closest) {
+
+			closest = distance;
+			latency = age;
+
+		}
+
+	}
+
+	game->searchTime += BenchmarkTimerNow() - searchStart;
+	game->framesDrawn++;
+	game->totalSyncLatency += latency;
+	game->totalError += error;
+
+	if (latency > game->maximumSyncLatency) {
+		game->maximumSyncLatency = latency;
+	}
+
+	if (error > game->maximumError) {
+		game->maximumError = error;
+	}
+
+}
+
+static void SyncStepDevice(SyncGame *game, SyncDevice *device) {
+
+	int localShip = device->player - 1;
+
+	for (int i = 0; i < kSyncBenchmarkPacketsInFlight; i++) {
+
+		SyncPacket *packet = &game->packets[i];
+
+		if (packet->inUse && packet->to == device->player - 1 && packet->deliveryTime <= game->now) {
+
+			SyncReceive(game, device, packet);
+			packet->inUse = 0;
+
+		}
+
+	}
+
+	if (game->now - device->lastHeartbeatTime >= kSyncBenchmarkHeartbeatInterval) {
+
+		device->lastHeartbeatTime = game->now;
+		LinkEstimatorUpdate(&device->link.linkEstimator, game->now);
+
+	}
+
+	if (game->now - device->lastDirectionalTime >= LinkEstimatorSendInterval(&device->link.linkEstimator)) {
+
+		SyncShipState *state = &device->shipHistory[device->shipHistoryCount % kSyncBenchmarkShipHistorySize];
+
+		device->lastDirectionalTime = game->now;
+		SyncShipAt(device->player, game->now, &device->ship);
+		device->ship.sendTime = WireQuantizeTime(game->now + device->clockBase);
+
+		state->time = game->now;
+		state->positionX = WireQuantizePosition(device->ship.currentPositionX);
+		state->positionY = WireQuantizePosition(device->ship.currentPositionY);
+		device->shipHistoryCount++;
+
+		NetworkLinkLocalShipChanged(&device->link, localShip, game->now);
+
+	}
+
+	NetworkLinkFlush(&device->link, localShip, &device->ship, NULL, 1, game->now);
+
+	SyncDrawPeer(game, device);
+
+}
+
+static void SyncRunGame(SyncGame *game, const SyncLinkConditions *conditions) {
+
+	memset(game, 0, sizeof(SyncGame));
+	game->conditions = conditions;
+	SimulationRandomSeed(&game->random, 23);
+
+	for (int d = 0; d < 2; d++) {
+
+		SyncDevice *device = &game->devices[d];
+
+		device->game = game;
+		device->player = d + 1;
+		device->clockBase = 1000.0 + 4321.5 * d;
+		SyncShipAt(device->player, 0.0, &device->ship);
+		NetworkLinkInit(&device->link, SyncTransmit, device, &device->traffic, 0.0);
+		SnapshotBufferInit(&device->peerSnapshots, kPeerSnapshotInterpolationDelay,
+						   kPeerSnapshotMaximumExtrapolation, kPeerSnapshotCorrectionTime);
+
+	}
+
+	int frames = (int)(kSyncBenchmarkDuration * kSyncBenchmarkFrameRate);
+
+	for (int frame = 0; frame < frames; frame++) {
+
+		game->now = (double)frame / kSyncBenchmarkFrameRate;
+
+		if (!game->measuring && game->now >= kSyncBenchmarkWarmUp) {
+
+			game->measuring = 1;
+
+			for (int d = 0; d < 2; d++) {
+				game->devices[d].warmUpTraffic = game->devices[d].traffic;
+			}
+
+		}
+
+		for (int d = 0; d < 2; d++) {
+			SyncStepDevice(game, &game->devices[d]);
+		}
+
+	}
+
+}
+
+static void SyncReport(const SyncGame *game, double hostSeconds) {
+
+	double seconds = kSyncBenchmarkDuration - kSyncBenchmarkWarmUp;
+	double sent = 0.0;
+
+	for (int d = 0; d < 2; d++) {
+
+		const SyncDevice *device = &game->devices[d];
+		sent += (device->traffic.totalPacketBytes - device->warmUpTraffic.totalPacketBytes) / seconds / 2.0;
+
+	}
+
+	printf("%-8s %4.0f %3.0f %3d%% %3d%%   %5.0f   %5.1f   %5.1f %5.1f   %5.1f %5.1f   %5.1f %5.1f   %6.0f\n",
+		   game->conditions->name, game->conditions->latency * 1000.0, game->conditions->jitter * 1000.0,
+		   game->conditions->lossPercent, game->conditions->reorderPercent, sent, game->updates / seconds / 2.0,
+		   game->totalUpdateLatency / game->updates * 1000.0, game->maximumUpdateLatency * 1000.0,
+		   game->totalSyncLatency / game->framesDrawn * 1000.0, game->maximumSyncLatency * 1000.0,
+		   game->totalError / game->framesDrawn, game->maximumError,
+		   kSyncBenchmarkDuration / (hostSeconds - game->searchTime));
+
+}
+
+int main(void) {
+
+	static SyncGame game;
+
+	printf("%.0f s of play after %.0f s of warm up, two ships circling at %.0f and %.0f points/s.\n",
+		   kSyncBenchmarkDuration - kSyncBenchmarkWarmUp, kSyncBenchmarkWarmUp,
+		   kSyncBenchmarkRadius * 0.5, kSyncBenchmarkRadius * 0.6);
+	printf("Bytes/s sent by each device, ship updates/s applied by each and their latency in ms, how long ago\n"
+		   "the drawn ship was where it's drawn in ms, how far it's drawn from where it is in points, and seconds\n"
+		   "of play run by the host per second.\n");
+	printf("%s\n", "                 link             sent   ship    update latency  sync latency    error          host");
+	printf("%s\n", "           ms  jit loss reord   B/s   upd/s    mean   max    mean   max    mean   max       x");
+
+	for (size_t i = 0; i < sizeof(syncBenchmarkConditions) / sizeof(syncBenchmarkConditions[0]); i++) {
+
+		double start = BenchmarkTimerNow();
+
+		SyncRunGame(&game, &syncBenchmarkConditions[i]);
+		SyncReport(&game, BenchmarkTimerNow() - start);
+
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,59 @@
+//
+//  TestCheck.h
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ The checks used by the tests of the plain C modules. Each test is a program whose main function calls
+ it's test functions then returns TestCheckResult(), so that make check stops at the first program with
+ a failed check. A failed check is reported with it's file and line and the test carries on.
+ */
+
+#ifndef __TEST_CHECK_H__
+#define __TEST_CHECK_H__
+
+#include <stdio.h>
+#include <math.h>
+
+/*
+ Number of checks made and failed by the program so far.
+ */
+static unsigned int testChecksMade = 0;
+static unsigned int testChecksFailed = 0;
+
+static int TestCheckCondition(int condition, const char *expression, const char *file, int line) {
+
+	testChecksMade++;
+
+	if (!condition) {
+		testChecksFailed++;
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+	}
+
+	return condition;
+
+}
+
+/*
+ Checks that the condition is true.
+ */
+#define TestCheck(__CONDITION__) TestCheckCondition((__CONDITION__) ? 1 : 0, #__CONDITION__, __FILE__, __LINE__)
+
+/*
+ Checks that two floats are within the tolerance of each other.
+ */
+#define TestCheckClose(__A__, __B__, __TOLERANCE__) TestCheckCondition(fabs((double)(__A__) - (double)(__B__)) <= (__TOLERANCE__), #__A__ " == " #__B__, __FILE__, __LINE__)
+
+/*
+ Prints a summary of the checks and returns the program's exit status.
+ */
+static inline int TestCheckResult(void) {
+
+	printf("%u checks, %u failed\n", testChecksMade, testChecksFailed);
+	return (testChecksFailed == 0) ? 0 : 1;
+
+}
+
+#endif // __TEST_CHECK_H__
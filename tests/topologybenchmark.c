@@ -0,0 +1,710 @@
+//
+//  TopologyBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 17/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Measures the traffic and latency of a game of two to four players connected as a mesh or as a star, on the
+ host rather than the device. The TopologyBenchmark in the app does the same with BluetoothCommsManagers
+ over LoopbackTransports, but needs the director running. Each device here has a NetworkLink for each
+ device it is connected to, which are what the BluetoothCommsManager keeps for it's peers, so the sending,
+ batching, scheduling and relaying measured are the manager's own. Each device plays the part of the
+ manager around them as it does during a game:
+
+   - the local ship at the rate chosen by the LinkEstimators, marked as changed on every link
+   - a projectile every kTopologyBenchmarkProjectileInterval, sent with NetworkLinkSendProjectile
+   - a ping to every other player every kPlayerPingInterval, and a reply to each ping received
+   - NetworkLinkFlush on every link every frame, with link reports on
+
+ In a star the first device is the hub. It relays everything a leaf sends to the others, as
+ processMessageWithType: does.
+
+ Every packet goes over a link with the conditions the app's TopologyBenchmark uses: 20 ms latency, 5 ms of
+ jitter, 2% loss and 1% held back. The bytes each device sends and receives, the messages relayed, the round
+ trip times of the pings between players and the time from a ship's state being made to it being applied by
+ each other player are reported.
+
+ Nothing is sent reliably during play, so the reliable channel carries only it's acknowledgements.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "NetworkLink.h"
+#include "Simulation.h"
+
+/*
+ The BluetoothCommsManager's ping and heartbeat intervals, which are in an Objective-C header.
+ */
+#define kPlayerPingInterval 0.5
+#define kTopologyBenchmarkHeartbeatInterval 0.1
+
+/*
+ The imitated game: frames per second, seconds between the projectiles fired by each player, how long it
+ runs and how long it runs before anything is measured, so that the LinkEstimators have settled.
+ */
+#define kTopologyBenchmarkFrameRate 60
+#define kTopologyBenchmarkProjectileInterval 0.5
+#define kTopologyBenchmarkDuration 60.0
+#define kTopologyBenchmarkWarmUp 5.0
+
+/*
+ The link conditions.
+ */
+#define kTopologyBenchmarkLatency 0.02
+#define kTopologyBenchmarkJitter 0.005
+#define kTopologyBenchmarkLossPercent 2
+#define kTopologyBenchmarkReorderPercent 1
+
+/*
+ Ship states remembered by each device, so that the time a state was made can be found when another device
+ applies it. A ship's position changes with every state, so the position identifies it.
+ */
+#define kTopologyBenchmarkShipHistorySize 256
+
+typedef enum {
+
+	kTopologyMesh,
+	kTopologyStar
+
+} Topology;
+
+typedef struct {
+
+	double time;
+	int16_t positionX;
+	int16_t positionY;
+
+} TopologyShipState;
+
+struct TopologyGame;
+
+/*
+ A device and it's links. Players are numbered from 1 as PlayerIDs are, so device d is player d + 1 and the
+ ship of player p is entity p - 1 of every scheduler.
+ */
+typedef struct {
+
+	struct TopologyGame *game;
+	int player;
+
+	NetworkLink links[kNetworkLinkMaximumPlayers - 1];
+	int linkDevices[kNetworkLinkMaximumPlayers - 1];
+	int linkCount;
+	NetworkTrafficStatistics traffic;
+
+	//The latest position of every ship, which the updates to each peer are weighted by.
+	NetworkPoint shipPositions[kNetworkLinkMaximumPlayers];
+	int shipPositionKnown[kNetworkLinkMaximumPlayers];
+
+	PlayerShipDirectionalInformation ship;
+	TopologyShipState shipHistory[kTopologyBenchmarkShipHistorySize];
+	unsigned int shipHistoryCount;
+	double lastDirectionalTime;
+	double lastProjectileTime;
+	double lastHeartbeatTime;
+	uint32_t pingNumber;
+	double pingSendTime;
+
+	//The traffic counters when the warm up finished.
+	NetworkTrafficStatistics warmUpTraffic;
+
+} TopologyDevice;
+
+/*
+ A packet on it's way from one device to another.
+ */
+typedef struct {
+
+	int inUse;
+	int from;
+	int to;
+	double deliveryTime;
+	uint8_t bytes[kNetworkDataPacketSize];
+	size_t length;
+
+} TopologyPacket;
+
+#define kTopologyBenchmarkPacketsInFlight 256
+
+typedef struct TopologyGame {
+
+	Topology topology;
+	int numberOfPlayers;
+	TopologyDevice devices[kNetworkLinkMaximumPlayers];
+	TopologyPacket packets[kTopologyBenchmarkPacketsInFlight];
+	SimulationRandom random;
+	double now;
+	int measuring;
+
+	//Ship updates applied and pings answered between every pair of players.
+	unsigned long shipUpdates;
+	double totalShipLatency;
+	double maximumShipLatency;
+	unsigned long pingReplies;
+	double totalRoundTripTime;
+	double maximumRoundTripTime;
+
+} TopologyGame;
+
+static double TopologyRandomFraction(TopologyGame *game) {
+
+	return SimulationRandomNext(&game->random) / 4294967296.0;
+
+}
+
+static int TopologyLinkIndex(const TopologyDevice *device, const NetworkLink *link) {
+
+	for (int i = 0; i < device->linkCount; i++) {
+
+		if (&device->links[i] == link) {
+			return i;
+		}
+
+	}
+
+	return -1;
+
+}
+
+static NetworkLink *TopologyLinkToDevice(TopologyDevice *device, int other) {
+
+	for (int i = 0; i < device->linkCount; i++) {
+
+		if (device->linkDevices[i] == other) {
+			return &device->links[i];
+		}
+
+	}
+
+	return NULL;
+
+}
+
+/*
+ The link a device sends a player's messages over: straight to it in a mesh or from the hub, and through
+ the hub from a leaf, as peerIndexForPlayer: decides.
+ */
+static NetworkLink *TopologyLinkToPlayer(TopologyGame *game, TopologyDevice *device, int player) {
+
+	NetworkLink *link = TopologyLinkToDevice(device, player - 1);
+
+	if (link == NULL && game->topology == kTopologyStar) {
+		link = TopologyLinkToDevice(device, 0);
+	}
+
+	return link;
+
+}
+
+/*
+ The position of the ship of the player at the other end of a link, as receiverShipOfPeer: finds it.
+ */
+static const NetworkPoint *TopologyReceiverShip(const TopologyDevice *device, int linkIndex) {
+
+	int other = device->linkDevices[linkIndex];
+
+	return device->shipPositionKnown[other] ? &device->shipPositions[other] : NULL;
+
+}
+
+/*
+ The transmit function of every link, which puts the packet on the simulated link to the other device.
+ */
+static void TopologyTransmit(NetworkLink *link, const uint8_t *bytes, size_t length, void *context) {
+
+	TopologyDevice *device = context;
+	TopologyGame *game = device->game;
+	TopologyPacket *packet = NULL;
+
+	for (int i = 0; i < kTopologyBenchmarkPacketsInFlight && packet == NULL; i++) {
+
+		if (!game->packets[i].inUse) {
+			packet = &game->packets[i];
+		}
+
+	}
+
+	if (packet == NULL || (SimulationRandomNext(&game->random) % 100) < kTopologyBenchmarkLossPercent) {
+		return;
+	}
+
+	double delay = kTopologyBenchmarkLatency + ((TopologyRandomFraction(game) * 2.0) - 1.0) * kTopologyBenchmarkJitter;
+
+	if ((SimulationRandomNext(&game->random) % 100) < kTopologyBenchmarkReorderPercent) {
+		delay += kTopologyBenchmarkLatency + kTopologyBenchmarkJitter;
+	}
+
+	packet->inUse = 1;
+	packet->from = device->player - 1;
+	packet->to = device->linkDevices[TopologyLinkIndex(device, link)];
+	packet->deliveryTime = game->now + delay;
+	memcpy(packet->bytes, bytes, length);
+	packet->length = length;
+
+}
+
+/*
+ Records a ship state of the player specified being applied, and how long after it was made.
+ */
+static void TopologyApplyShip(TopologyGame *game, TopologyDevice *device, int player, const PlayerShipDirectionalInformation *information) {
+
+	if (player < 1 || player > game->numberOfPlayers) {
+		return;
+	}
+
+	TopologyDevice *origin = &game->devices[player - 1];
+	int16_t positionX = WireQuantizePosition(information->currentPositionX);
+	int16_t positionY = WireQuantizePosition(information->currentPositionY);
+
+	device->shipPositions[player - 1].x = information->currentPositionX;
+	device->shipPositions[player - 1].y = information->currentPositionY;
+	device->shipPositionKnown[player - 1] = 1;
+
+	if (!game->measuring) {
+		return;
+	}
+
+	for (unsigned int i = 0; i < origin->shipHistoryCount && i < kTopologyBenchmarkShipHistorySize; i++) {
+
+		const TopologyShipState *state = &origin->shipHistory[(origin->shipHistoryCount - 1 - i) % kTopologyBenchmarkShipHistorySize];
+
+		if (state->positionX == positionX && state->positionY == positionY) {
+
+			double latency = game->now - state->time;
+
+			game->shipUpdates++;
+			game->totalShipLatency += latency;
+
+			if (latency > game->maximumShipLatency) {
+				game->maximumShipLatency = latency;
+			}
+
+			return;
+
+		}
+
+	}
+
+}
+
+/*
+ Handles a message which came from a player, either straight from it or relayed by the hub, as
+ processPlayerMessageWithType: does for pings.
+ */
+static void TopologyProcessPlayerMessage(TopologyGame *game, TopologyDevice *device, uint8_t messageType,
+										 WireReader *reader, int player) {
+
+	if (messageType == kPacketTypePlayerPing) {
+
+		uint32_t number = WireReadVarUInt(reader);
+		NetworkLink *link = TopologyLinkToPlayer(game, device, player);
+		uint8_t data[16];
+		WireWriter writer;
+
+		if (reader->error || link == NULL) {
+			return;
+		}
+
+		WireWriterInit(&writer, data, sizeof(data));
+		WireWriteVarUInt(&writer, (uint32_t)player);
+		WireWriteVarUInt(&writer, number);
+		NetworkLinkSendMessage(link, kPacketTypePlayerPingReply, data, writer.length, 0);
+
+	} else if (messageType == kPacketTypePlayerPingReply) {
+
+		uint32_t pinger = WireReadVarUInt(reader);
+		uint32_t number = WireReadVarUInt(reader);
+
+		if (reader->error || (int)pinger != device->player || number != device->pingNumber || !game->measuring) {
+			return;
+		}
+
+		double roundTripTime = game->now - device->pingSendTime;
+
+		game->pingReplies++;
+		game->totalRoundTripTime += roundTripTime;
+
+		if (roundTripTime > game->maximumRoundTripTime) {
+			game->maximumRoundTripTime = roundTripTime;
+		}
+
+	}
+
+}
+
+/*
+ Handles a single message from the device at the other end of a link, as processMessageWithType: does.
+ */
+static void TopologyProcessMessage(TopologyGame *game, TopologyDevice *device, int linkIndex, uint8_t messageType, WireReader *reader) {
+
+	NetworkLink *link = &device->links[linkIndex];
+	int source = device->linkDevices[linkIndex];
+	int isHub = (game->topology == kTopologyStar && device->player == 1);
+
+	switch (messageType) {
+
+		case kPacketTypePeerPlayerShipDirectionalData: {
+
+			PlayerShipDirectionalInformation information;
+
+			if (NetworkLinkReceiveDirectionalData(link, reader, &information)) {
+
+				TopologyApplyShip(game, device, source + 1, &information);
+
+				for (int i = 0; isHub && i < device->linkCount; i++) {
+
+					if (i != linkIndex) {
+						NetworkLinkRelayDirectionalData(&device->links[i], source + 1, &information, TopologyReceiverShip(device, i), game->now);
+					}
+
+				}
+
+			}
+
+		}
+		break;
+
+		case kPacketTypeDirectionalDataAcknowledgement:
+			NetworkLinkReceiveDirectionalAcknowledgement(link, reader);
+			break;
+
+		case kPacketTypeLinkReport:
+			LinkEstimatorReadReport(&link->linkEstimator, reader, game->now);
+			break;
+
+		case kPacketTypeRelayed: {
+
+			uint32_t player = WireReadVarUInt(reader);
+			uint8_t relayedType = WireReadUInt8(reader);
+
+			if (!reader->error) {
+				TopologyProcessPlayerMessage(game, device, relayedType, reader, (int)player);
+			}
+
+		}
+		break;
+
+		case kPacketTypeRelayedDirectionalData: {
+
+			uint32_t player = WireReadVarUInt(reader);
+			PlayerShipDirectionalInformation information;
+
+			if (WireReadDirectionalInformation(reader, &information) && !reader->error) {
+				TopologyApplyShip(game, device, (int)player, &information);
+			}
+
+		}
+		break;
+
+		default:
+
+			for (int i = 0; isHub && i < device->linkCount; i++) {
+
+				if (i != linkIndex) {
+					NetworkLinkRelayMessage(&device->links[i], source + 1, messageType, reader, 0, TopologyReceiverShip(device, i), game->now);
+				}
+
+			}
+
+			TopologyProcessPlayerMessage(game, device, messageType, reader, source + 1);
+			break;
+
+	}
+
+}
+
+/*
+ Applies a packet as processReceivedPacket: does.
+ */
+static void TopologyReceive(TopologyGame *game, TopologyDevice *device, const TopologyPacket *packet) {
+
+	NetworkLink *link = TopologyLinkToDevice(device, packet->from);
+	WireReader reader;
+	WirePacketHeader header;
+
+	WireReaderInit(&reader, packet->bytes, packet->length);
+
+	if (link == NULL || !WireReadHeader(&reader, &header)) {
+		return;
+	}
+
+	int linkIndex = TopologyLinkIndex(device, link);
+	int outOfDate = !NetworkLinkPacketReceived(link, &header, WireReaderRemaining(&reader), game->now);
+	uint8_t messageType;
+	WireReader message;
+
+	if (header.packetType != kPacketTypeBatch) {
+		return;
+	}
+
+	while (WireReadMessage(&reader, &messageType, &message)) {
+
+		if (messageType == kPacketTypeReliableChannel) {
+			ReliableChannelRead(&link->reliableChannel, &message, game->now);
+		} else if (messageType != kPacketTypeBatch && !outOfDate) {
+			TopologyProcessMessage(game, device, linkIndex, messageType, &message);
+		}
+
+	}
+
+}
+
+/*
+ Moves the local ship. Each ship circles the screen at it's own speed, so it's position changes every update
+ and it's heading changes now and then.
+ */
+static void TopologyMoveShip(TopologyDevice *device, double now) {
+
+	double angle = now * (0.4 + 0.1 * device->player) + device->player;
+
+	device->ship.newHeading = (float)fmod(floor(angle * 4.0) * 45.0, 360.0);
+	device->ship.newSpeed = 60.0f;
+	device->ship.currentPositionX = (float)(240.0 + 150.0 * cos(angle));
+	device->ship.currentPositionY = (float)(160.0 + 100.0 * sin(angle));
+	device->ship.currentRotation = device->ship.newHeading;
+
+	TopologyShipState *state = &device->shipHistory[device->shipHistoryCount % kTopologyBenchmarkShipHistorySize];
+
+	state->time = now;
+	state->positionX = WireQuantizePosition(device->ship.currentPositionX);
+	state->positionY = WireQuantizePosition(device->ship.currentPositionY);
+	device->shipHistoryCount++;
+
+	device->shipPositions[device->player - 1].x = device->ship.currentPositionX;
+	device->shipPositions[device->player - 1].y = device->ship.currentPositionY;
+	device->shipPositionKnown[device->player - 1] = 1;
+
+}
+
+/*
+ One frame of a device: packets which have arrived are handled, then the game sends it's ship, projectiles
+ and pings when they are due and every link's batch is flushed.
+ */
+static void TopologyStepDevice(TopologyGame *game, TopologyDevice *device) {
+
+	int localShip = device->player - 1;
+
+	for (int i = 0; i < kTopologyBenchmarkPacketsInFlight; i++) {
+
+		TopologyPacket *packet = &game->packets[i];
+
+		if (packet->inUse && packet->to == device->player - 1 && packet->deliveryTime <= game->now) {
+
+			TopologyReceive(game, device, packet);
+			packet->inUse = 0;
+
+		}
+
+	}
+
+	if (game->now - device->lastHeartbeatTime >= kTopologyBenchmarkHeartbeatInterval) {
+
+		device->lastHeartbeatTime = game->now;
+
+		for (int i = 0; i < device->linkCount; i++) {
+			LinkEstimatorUpdate(&device->links[i].linkEstimator, game->now);
+		}
+
+	}
+
+	//Directional data is sent at the rate of the slowest link, as directionalDataSendInterval decides.
+	double sendInterval = 0.0;
+
+	for (int i = 0; i < device->linkCount; i++) {
+
+		double interval = LinkEstimatorSendInterval(&device->links[i].linkEstimator);
+
+		if (interval > sendInterval) {
+			sendInterval = interval;
+		}
+
+	}
+
+	if (game->now - device->lastDirectionalTime >= sendInterval) {
+
+		device->lastDirectionalTime = game->now;
+		TopologyMoveShip(device, game->now);
+
+		for (int i = 0; i < device->linkCount; i++) {
+			NetworkLinkLocalShipChanged(&device->links[i], localShip, game->now);
+		}
+
+	}
+
+	if (game->now - device->lastProjectileTime >= kTopologyBenchmarkProjectileInterval) {
+
+		ProjectileDetails details = { device->ship.currentPositionX, device->ship.currentPositionY, 240.0f, 160.0f };
+
+		device->lastProjectileTime = game->now;
+
+		for (int i = 0; i < device->linkCount; i++) {
+			NetworkLinkSendProjectile(&device->links[i], &details, TopologyReceiverShip(device, i), game->now);
+		}
+
+	}
+
+	if (game->now - device->pingSendTime >= kPlayerPingInterval) {
+
+		uint8_t data[8];
+		WireWriter writer;
+
+		device->pingNumber++;
+		device->pingSendTime = game->now;
+		WireWriterInit(&writer, data, sizeof(data));
+		WireWriteVarUInt(&writer, device->pingNumber);
+
+		for (int i = 0; i < device->linkCount; i++) {
+			NetworkLinkSendMessage(&device->links[i], kPacketTypePlayerPing, data, writer.length, 0);
+		}
+
+	}
+
+	for (int i = 0; i < device->linkCount; i++) {
+		NetworkLinkFlush(&device->links[i], localShip, &device->ship, TopologyReceiverShip(device, i), 1, game->now);
+	}
+
+}
+
+static void TopologyConnect(TopologyGame *game, int first, int second) {
+
+	int devices[2] = { first, second };
+
+	for (int d = 0; d < 2; d++) {
+
+		TopologyDevice *device = &game->devices[devices[d]];
+
+		device->linkDevices[device->linkCount] = devices[1 - d];
+		NetworkLinkInit(&device->links[device->linkCount], TopologyTransmit, device, &device->traffic, game->now);
+		device->linkCount++;
+
+	}
+
+}
+
+static void TopologyRunGame(TopologyGame *game, Topology topology, int numberOfPlayers) {
+
+	memset(game, 0, sizeof(TopologyGame));
+	game->topology = topology;
+	game->numberOfPlayers = numberOfPlayers;
+	SimulationRandomSeed(&game->random, 17);
+
+	for (int d = 0; d < numberOfPlayers; d++) {
+
+		game->devices[d].game = game;
+		game->devices[d].player = d + 1;
+		//Staggered, so that the players don't all fire and ping in the same frame.
+		game->devices[d].lastProjectileTime = -0.1 * d;
+		game->devices[d].pingSendTime = -0.13 * d;
+		TopologyMoveShip(&game->devices[d], 0.0);
+
+	}
+
+	for (int d = 0; d < numberOfPlayers; d++) {
+
+		for (int e = d + 1; e < numberOfPlayers; e++) {
+
+			if (topology == kTopologyMesh || d == 0) {
+				TopologyConnect(game, d, e);
+			}
+
+		}
+
+	}
+
+	int frames = (int)(kTopologyBenchmarkDuration * kTopologyBenchmarkFrameRate);
+
+	for (int frame = 0; frame < frames; frame++) {
+
+		game->now = (double)frame / kTopologyBenchmarkFrameRate;
+
+		if (!game->measuring && game->now >= kTopologyBenchmarkWarmUp) {
+
+			game->measuring = 1;
+
+			for (int d = 0; d < numberOfPlayers; d++) {
+				game->devices[d].warmUpTraffic = game->devices[d].traffic;
+			}
+
+		}
+
+		for (int d = 0; d < numberOfPlayers; d++) {
+			TopologyStepDevice(game, &game->devices[d]);
+		}
+
+	}
+
+}
+
+static void TopologyReport(const TopologyGame *game) {
+
+	double seconds = kTopologyBenchmarkDuration - kTopologyBenchmarkWarmUp;
+	double meanSent = 0.0;
+	double maximumSent = 0.0;
+	double meanReceived = 0.0;
+	double maximumReceived = 0.0;
+	unsigned long relayed = 0;
+	ReplicationStatistics replication;
+
+	memset(&replication, 0, sizeof(replication));
+
+	for (int d = 0; d < game->numberOfPlayers; d++) {
+
+		const TopologyDevice *device = &game->devices[d];
+		double sent = (device->traffic.totalPacketBytes - device->warmUpTraffic.totalPacketBytes) / seconds;
+		double received = (device->traffic.totalPacketBytesReceived - device->warmUpTraffic.totalPacketBytesReceived) / seconds;
+
+		meanSent += sent / game->numberOfPlayers;
+		meanReceived += received / game->numberOfPlayers;
+		maximumSent = (sent > maximumSent) ? sent : maximumSent;
+		maximumReceived = (received > maximumReceived) ? received : maximumReceived;
+		relayed += device->traffic.totalMessagesRelayed - device->warmUpTraffic.totalMessagesRelayed;
+
+		for (int i = 0; i < device->linkCount; i++) {
+
+			for (int entity = 0; entity < kReplicationSchedulerMaximumEntities; entity++) {
+				ReplicationStatisticsAdd(&replication, &device->links[i].replication.entities[entity].statistics);
+			}
+
+		}
+
+	}
+
+	printf("%-4s %d   %6.0f %6.0f   %6.0f %6.0f   %7.1f   %6.1f   %6.1f %6.1f   %6.1f %6.1f   %8.1f\n",
+		   (game->topology == kTopologyMesh) ? "mesh" : "star", game->numberOfPlayers,
+		   meanSent, maximumSent, meanReceived, maximumReceived, relayed / seconds,
+		   game->shipUpdates / seconds / (game->numberOfPlayers * (game->numberOfPlayers - 1)),
+		   game->totalShipLatency / game->shipUpdates * 1000.0, game->maximumShipLatency * 1000.0,
+		   game->totalRoundTripTime / game->pingReplies * 1000.0, game->maximumRoundTripTime * 1000.0,
+		   replication.deferrals / kTopologyBenchmarkDuration);
+
+}
+
+int main(void) {
+
+	static TopologyGame game;
+
+	printf("%.0f s of play after %.0f s of warm up, links with %.0f ms latency, %.0f ms jitter, %d%% loss.\n",
+		   kTopologyBenchmarkDuration - kTopologyBenchmarkWarmUp, kTopologyBenchmarkWarmUp,
+		   kTopologyBenchmarkLatency * 1000.0, kTopologyBenchmarkJitter * 1000.0, kTopologyBenchmarkLossPercent);
+	printf("Bytes/s per device, messages/s relayed by the hub, ship updates/s applied by each player from each other\n"
+		   "player and their latency in ms, ping round trip between players in ms, updates/s left out of a batch over\n"
+		   "the whole run.\n");
+	printf("%s\n", "          sent B/s        recv B/s    relayed     ship   ship latency     round trip   deferred");
+	printf("%s\n", "     n    mean    max     mean    max    msg/s    upd/s     mean    max     mean    max      upd/s");
+
+	for (int numberOfPlayers = 2; numberOfPlayers <= kNetworkLinkMaximumPlayers; numberOfPlayers++) {
+
+		TopologyRunGame(&game, kTopologyMesh, numberOfPlayers);
+		TopologyReport(&game);
+		TopologyRunGame(&game, kTopologyStar, numberOfPlayers);
+		TopologyReport(&game);
+
+	}
+
+	return 0;
+
+}
@@ -0,0 +1,161 @@
+//
+//  WireProtocolBenchmark.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Measures the size of each message in a batch packet, compared with copying the struct into the packet as
+ the protocol used to, and how many messages per second are encoded into and decoded from batch packets
+ the size that the BluetoothCommsManager sends.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "WireProtocol.h"
+#include "BenchmarkTimer.h"
+
+/*
+ Size of the batch packets, the same as kNetworkDataPacketSize.
+ */
+#define kWireProtocolBenchmarkPacketSize 1024
+
+/*
+ Number of messages encoded and decoded by each run.
+ */
+#define kWireProtocolBenchmarkMessages 10000000
+
+/*
+ Message type of the directional messages in the batches. The value doesn't matter to the protocol.
+ */
+#define kWireProtocolBenchmarkDirectionalType 1
+
+/*
+ The data of every message made by the benchmark, varied so that every field changes between messages.
+ */
+static void WireProtocolBenchmarkInformation(unsigned int i, PlayerShipDirectionalInformation *information) {
+
+	information->newHeading = (float)(i % 360);
+	information->newSpeed = (float)(i % 100);
+	information->currentPositionX = (float)(i % 480);
+	information->currentPositionY = (float)(i % 320);
+	information->currentRotation = (float)((i * 7) % 360);
+
+}
+
+static void WireProtocolBenchmarkSizes(void) {
+
+	uint8_t bytes[64];
+	WireWriter writer;
+	PlayerShipDirectionalInformation information;
+	ProjectileDetails details = { 240.0f, 160.0f, 700.0f, -300.0f };
+
+	WireProtocolBenchmarkInformation(12345, &information);
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteDirectionalInformation(&writer, &information);
+	size_t directionalSize = writer.length;
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteProjectileDetails(&writer, &details);
+	size_t projectileSize = writer.length;
+
+	printf("directional information: %zu bytes as a struct, %zu bytes encoded, %zu bytes as a message in a batch\n",
+		   sizeof(PlayerShipDirectionalInformation), directionalSize, WireMessageSize(directionalSize));
+	printf("projectile details: %zu bytes as a struct, %zu bytes encoded, %zu bytes as a message in a batch\n",
+		   sizeof(ProjectileDetails), projectileSize, WireMessageSize(projectileSize));
+	printf("header: up to %d bytes, %zu bytes for packet number 1000\n",
+		   kWireProtocolMaximumHeaderSize, 2 + WireVarUIntSize(1000));
+
+}
+
+static void WireProtocolBenchmarkThroughput(void) {
+
+	static uint8_t packet[kWireProtocolBenchmarkPacketSize];
+	uint8_t message[16];
+	WireWriter writer;
+	WireWriter messageWriter;
+	WireReader reader;
+	WireReader messageReader;
+	WirePacketHeader header;
+	PlayerShipDirectionalInformation information;
+	uint8_t messageType;
+	unsigned int packets = 0;
+	unsigned int messagesDecoded = 0;
+	size_t bytesEncoded = 0;
+	double encodeTime = 0.0;
+	double decodeTime = 0.0;
+	//Summed so that the compiler can't skip the decoding.
+	double checksum = 0.0;
+
+	unsigned int i = 0;
+
+	while (i < kWireProtocolBenchmarkMessages) {
+
+		/*
+		 Fill a packet with as many messages as fit, as the BluetoothCommsManager does, then read them back.
+		 */
+		double start = BenchmarkTimerNow();
+
+		WireWriterInit(&writer, packet, sizeof(packet));
+		WireWriteHeader(&writer, 0, packets);
+
+		while (i < kWireProtocolBenchmarkMessages) {
+
+			WireProtocolBenchmarkInformation(i, &information);
+			WireWriterInit(&messageWriter, message, sizeof(message));
+			WireWriteDirectionalInformation(&messageWriter, &information);
+
+			if (WireWriterRemaining(&writer) < WireMessageSize(messageWriter.length)) {
+				break;
+			}
+
+			WireWriteMessage(&writer, kWireProtocolBenchmarkDirectionalType, message, messageWriter.length);
+			i++;
+
+		}
+
+		double encoded = BenchmarkTimerNow();
+
+		WireReaderInit(&reader, packet, writer.length);
+		WireReadHeader(&reader, &header);
+
+		while (WireReadMessage(&reader, &messageType, &messageReader)) {
+
+			if (WireReadDirectionalInformation(&messageReader, &information)) {
+
+				checksum += information.currentPositionX;
+				messagesDecoded++;
+
+			}
+
+		}
+
+		double decoded = BenchmarkTimerNow();
+
+		encodeTime += encoded - start;
+		decodeTime += decoded - encoded;
+		bytesEncoded += writer.length;
+		packets++;
+
+	}
+
+	printf("%u directional messages in %u packets of up to %d bytes, %.2f bytes per message including headers\n",
+		   kWireProtocolBenchmarkMessages, packets, kWireProtocolBenchmarkPacketSize,
+		   (double)bytesEncoded / kWireProtocolBenchmarkMessages);
+	printf("encode: %.3f s, %.1f million messages/s, %.1f MB/s\n",
+		   encodeTime, kWireProtocolBenchmarkMessages / encodeTime / 1e6, bytesEncoded / encodeTime / 1e6);
+	printf("decode: %.3f s, %.1f million messages/s, %.1f MB/s (%u decoded, checksum %.0f)\n",
+		   decodeTime, messagesDecoded / decodeTime / 1e6, bytesEncoded / decodeTime / 1e6, messagesDecoded, checksum);
+
+}
+
+int main(void) {
+
+	WireProtocolBenchmarkSizes();
+	WireProtocolBenchmarkThroughput();
+
+	return 0;
+
+}
@@ -0,0 +1,490 @@
+//
+//  WireProtocolTests.c
+//  AberFighter
+//
+//  Created by wde7 on 27/06/2011.
+//  Copyright 2011 William Darius Elphick. All rights reserved.
+//
+/*
+ Round trip tests of the WireProtocol: variable length integers at the edges of their ranges, reads and
+ writes which run past the end of the buffer, clamping of quantized fields, headers and batch framing.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "WireProtocol.h"
+#include "TestCheck.h"
+
+/*
+ Writes the value as a variable length integer and checks that it reads back the same using the number of
+ bytes expected.
+ */
+static void TestCheckVarUIntRoundTrip(uint32_t value, size_t expectedSize) {
+
+	uint8_t bytes[8];
+	WireWriter writer;
+	WireReader reader;
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteVarUInt(&writer, value);
+
+	TestCheck(!writer.overflow);
+	TestCheck(writer.length == expectedSize);
+	TestCheck(WireVarUIntSize(value) == expectedSize);
+
+	WireReaderInit(&reader, bytes, writer.length);
+
+	TestCheck(WireReadVarUInt(&reader) == value);
+	TestCheck(!reader.error);
+	TestCheck(WireReaderRemaining(&reader) == 0);
+
+}
+
+static void TestCheckVarIntRoundTrip(int32_t value, size_t expectedSize) {
+
+	uint8_t bytes[8];
+	WireWriter writer;
+	WireReader reader;
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteVarInt(&writer, value);
+
+	TestCheck(!writer.overflow);
+	TestCheck(writer.length == expectedSize);
+
+	WireReaderInit(&reader, bytes, writer.length);
+
+	TestCheck(WireReadVarInt(&reader) == value);
+	TestCheck(!reader.error);
+
+}
+
+static void TestVarInts(void) {
+
+	/*
+	 Each byte holds 7 bits, so the size steps up at each power of 128.
+	 */
+	TestCheckVarUIntRoundTrip(0, 1);
+	TestCheckVarUIntRoundTrip(1, 1);
+	TestCheckVarUIntRoundTrip(127, 1);
+	TestCheckVarUIntRoundTrip(128, 2);
+	TestCheckVarUIntRoundTrip(16383, 2);
+	TestCheckVarUIntRoundTrip(16384, 3);
+	TestCheckVarUIntRoundTrip(2097151, 3);
+	TestCheckVarUIntRoundTrip(2097152, 4);
+	TestCheckVarUIntRoundTrip(268435455, 4);
+	TestCheckVarUIntRoundTrip(268435456, 5);
+	TestCheckVarUIntRoundTrip(UINT32_MAX, 5);
+
+	/*
+	 Zigzag encoding interleaves negative and positive values, so -64 to 63 take one byte.
+	 */
+	TestCheckVarIntRoundTrip(0, 1);
+	TestCheckVarIntRoundTrip(-1, 1);
+	TestCheckVarIntRoundTrip(1, 1);
+	TestCheckVarIntRoundTrip(-64, 1);
+	TestCheckVarIntRoundTrip(63, 1);
+	TestCheckVarIntRoundTrip(-65, 2);
+	TestCheckVarIntRoundTrip(64, 2);
+	TestCheckVarIntRoundTrip(INT32_MAX, 5);
+	TestCheckVarIntRoundTrip(INT32_MIN, 5);
+	TestCheckVarIntRoundTrip(INT32_MIN + 1, 5);
+
+	//The zigzag encoding of -1 is 1 and of 1 is 2.
+	uint8_t bytes[8];
+	WireWriter writer;
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteVarInt(&writer, -1);
+	WireWriteVarInt(&writer, 1);
+	WireWriteVarInt(&writer, INT32_MIN);
+	TestCheck(bytes[0] == 1);
+	TestCheck(bytes[1] == 2);
+	TestCheck(bytes[2] == 0xFF && bytes[3] == 0xFF && bytes[4] == 0xFF && bytes[5] == 0xFF && bytes[6] == 0x0F);
+
+}
+
+static void TestCorruptVarInts(void) {
+
+	WireReader reader;
+
+	//A value which still has more bytes to follow after the fifth is longer than any 32 bit value.
+	const uint8_t tooLong[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+	WireReaderInit(&reader, tooLong, sizeof(tooLong));
+	TestCheck(WireReadVarUInt(&reader) == 0);
+	TestCheck(reader.error);
+
+	//A value whose last byte is missing.
+	const uint8_t truncated[] = { 0xFF, 0xFF };
+	WireReaderInit(&reader, truncated, sizeof(truncated));
+	TestCheck(WireReadVarUInt(&reader) == 0);
+	TestCheck(reader.error);
+
+	WireReaderInit(&reader, truncated, 0);
+	TestCheck(WireReadVarInt(&reader) == 0);
+	TestCheck(reader.error);
+
+	/*
+	 A fifth byte with any of the bits above the lowest 4 set holds a value larger than 32 bits, which would
+	 otherwise be read as the value with those bits dropped.
+	 */
+	const uint8_t tooLarge[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x1F };
+	WireReaderInit(&reader, tooLarge, sizeof(tooLarge));
+	TestCheck(WireReadVarUInt(&reader) == 0);
+	TestCheck(reader.error);
+
+	const uint8_t highestBit[] = { 0x80, 0x80, 0x80, 0x80, 0x40 };
+	WireReaderInit(&reader, highestBit, sizeof(highestBit));
+	TestCheck(WireReadVarUInt(&reader) == 0);
+	TestCheck(reader.error);
+
+	const uint8_t largest[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0x0F };
+	WireReaderInit(&reader, largest, sizeof(largest));
+	TestCheck(WireReadVarUInt(&reader) == UINT32_MAX);
+	TestCheck(!reader.error);
+
+}
+
+static void TestPrimitives(void) {
+
+	uint8_t bytes[16];
+	WireWriter writer;
+	WireReader reader;
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteUInt8(&writer, 0xAB);
+	WireWriteUInt16(&writer, 0x1234);
+	WireWriteUInt32(&writer, 0xDEADBEEF);
+	WireWriteBytes(&writer, "abc", 3);
+
+	TestCheck(writer.length == 10);
+	TestCheck(WireWriterRemaining(&writer) == 6);
+
+	//Multi-byte values are little endian whatever the host is.
+	TestCheck(bytes[1] == 0x34 && bytes[2] == 0x12);
+	TestCheck(bytes[3] == 0xEF && bytes[4] == 0xBE && bytes[5] == 0xAD && bytes[6] == 0xDE);
+
+	char text[3];
+	WireReaderInit(&reader, bytes, writer.length);
+	TestCheck(WireReadUInt8(&reader) == 0xAB);
+	TestCheck(WireReadUInt16(&reader) == 0x1234);
+	TestCheck(WireReadUInt32(&reader) == 0xDEADBEEF);
+	WireReadBytes(&reader, text, 3);
+	TestCheck(memcmp(text, "abc", 3) == 0);
+	TestCheck(!reader.error);
+	TestCheck(WireReaderRemaining(&reader) == 0);
+
+}
+
+static void TestTruncatedReads(void) {
+
+	const uint8_t bytes[] = { 0x01, 0x02, 0x03 };
+	WireReader reader;
+
+	/*
+	 A read which runs past the end sets error and returns 0, and every read after it returns 0 even if it
+	 would have fitted.
+	 */
+	WireReaderInit(&reader, bytes, sizeof(bytes));
+	TestCheck(WireReadUInt16(&reader) == 0x0201);
+	TestCheck(WireReadUInt16(&reader) == 0);
+	TestCheck(reader.error);
+	TestCheck(WireReadUInt8(&reader) == 0);
+	TestCheck(WireReaderRemaining(&reader) == 0);
+
+	WireReaderInit(&reader, bytes, sizeof(bytes));
+	TestCheck(WireReadUInt32(&reader) == 0);
+	TestCheck(reader.error);
+
+	WireReaderInit(&reader, bytes, sizeof(bytes));
+	WireReaderSkip(&reader, 4);
+	TestCheck(reader.error);
+
+	uint8_t copy[4] = { 9, 9, 9, 9 };
+	WireReaderInit(&reader, bytes, sizeof(bytes));
+	WireReadBytes(&reader, copy, 4);
+	TestCheck(reader.error);
+	TestCheck(copy[0] == 9);
+
+	//Every struct needs all of it's fields.
+	uint8_t packet[16];
+	WireWriter writer;
+	PlayerShipDirectionalInformation information = { 90.0f, 40.0f, 100.0f, 200.0f, 45.0f };
+	PlayerShipDirectionalInformation received;
+	WireWriterInit(&writer, packet, sizeof(packet));
+	WireWriteDirectionalInformation(&writer, &information);
+
+	for (size_t length = 0; length < writer.length; length++) {
+
+		WireReaderInit(&reader, packet, length);
+		TestCheck(!WireReadDirectionalInformation(&reader, &received));
+
+	}
+
+	WireReaderInit(&reader, packet, writer.length);
+	TestCheck(WireReadDirectionalInformation(&reader, &received));
+
+}
+
+static void TestOverrunWrites(void) {
+
+	uint8_t bytes[8];
+	WireWriter writer;
+
+	/*
+	 A write which doesn't fit sets overflow and writes nothing, and nothing is written after it even if it
+	 would have fitted.
+	 */
+	memset(bytes, 0, sizeof(bytes));
+	WireWriterInit(&writer, bytes, 3);
+	WireWriteUInt16(&writer, 0xFFFF);
+	WireWriteUInt16(&writer, 0xFFFF);
+	TestCheck(writer.overflow);
+	TestCheck(writer.length == 2);
+	TestCheck(bytes[2] == 0);
+	WireWriteUInt8(&writer, 0xFF);
+	TestCheck(writer.length == 2);
+	TestCheck(bytes[2] == 0);
+	TestCheck(WireWriterRemaining(&writer) == 0);
+
+	WireWriterInit(&writer, bytes, 4);
+	WireWriteVarUInt(&writer, UINT32_MAX);
+	TestCheck(writer.overflow);
+
+	WireWriterInit(&writer, bytes, 2);
+	WireWriteBytes(&writer, "abc", 3);
+	TestCheck(writer.overflow);
+	TestCheck(writer.length == 0);
+
+	//A message whose data doesn't fit overflows the batch.
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteMessage(&writer, 1, "0123456789", 10);
+	TestCheck(writer.overflow);
+
+}
+
+static void TestQuantization(void) {
+
+	/*
+	 Positions keep 1/32 of a point and are clamped to the 16 bit range.
+	 */
+	TestCheck(WireQuantizePosition(0.0f) == 0);
+	TestCheck(WireQuantizePosition(1.0f) == 32);
+	TestCheck(WireQuantizePosition(-1.0f) == -32);
+	TestCheckClose(WireDequantizePosition(WireQuantizePosition(123.40625f)), 123.40625f, 0.0);
+	TestCheckClose(WireDequantizePosition(WireQuantizePosition(-480.3f)), -480.3f, 1.0 / 64.0);
+	TestCheck(WireQuantizePosition(1023.96875f) == INT16_MAX);
+	TestCheck(WireQuantizePosition(5000.0f) == INT16_MAX);
+	TestCheck(WireQuantizePosition(-1024.0f) == INT16_MIN);
+	TestCheck(WireQuantizePosition(-5000.0f) == INT16_MIN);
+	TestCheck(WireQuantizePosition(INFINITY) == INT16_MAX);
+	TestCheck(WireQuantizePosition(-INFINITY) == INT16_MIN);
+	TestCheck(WireQuantizePosition(NAN) == 0);
+
+	/*
+	 Headings wrap around, so 360 degrees and -360 degrees are both stored as 0.
+	 */
+	TestCheck(WireQuantizeHeading(0.0f) == 0);
+	TestCheck(WireQuantizeHeading(360.0f) == 0);
+	TestCheck(WireQuantizeHeading(-360.0f) == 0);
+	TestCheck(WireQuantizeHeading(90.0f) == 64);
+	TestCheck(WireQuantizeHeading(-90.0f) == 192);
+	TestCheck(WireQuantizeHeading(450.0f) == 64);
+	TestCheck(WireQuantizeHeading(3600090.0f) == 64);
+	TestCheck(WireQuantizeHeading(-3600090.0f) == 192);
+	//A heading this large can't hold a fraction of a turn.
+	TestCheck(WireQuantizeHeading(3.0e38f) == 0);
+	TestCheck(WireQuantizeHeading(INFINITY) == 0);
+	TestCheck(WireQuantizeHeading(NAN) == 0);
+	TestCheckClose(WireDequantizeHeading(WireQuantizeHeading(123.0f)), 123.0f, 360.0 / 512.0);
+
+	/*
+	 Speeds keep half a point per second and are clamped to a byte.
+	 */
+	TestCheck(WireQuantizeSpeed(0.0f) == 0);
+	TestCheck(WireQuantizeSpeed(-10.0f) == 0);
+	TestCheck(WireQuantizeSpeed(127.5f) == 255);
+	TestCheck(WireQuantizeSpeed(1000.0f) == 255);
+	TestCheck(WireQuantizeSpeed(INFINITY) == 255);
+	TestCheck(WireQuantizeSpeed(-INFINITY) == 0);
+	TestCheck(WireQuantizeSpeed(NAN) == 0);
+	TestCheckClose(WireDequantizeSpeed(WireQuantizeSpeed(42.5f)), 42.5f, 0.0);
+
+	/*
+	 Times wrap around every 65.536 seconds and are read back as the time nearest the reference, either side
+	 of it and across the wrap.
+	 */
+	TestCheck(WireQuantizeTime(0.0) == 0);
+	TestCheck(WireQuantizeTime(1.2345) == 1234);
+	TestCheck(WireQuantizeTime(65.536) == 0);
+	TestCheck(WireQuantizeTime(65.537) == 1);
+	TestCheck(WireQuantizeTime(-0.001) == 65535);
+	TestCheck(WireQuantizeTime(1.0e30) == WireQuantizeTime(1.0e30 + 65.536));
+	TestCheck(WireQuantizeTime(INFINITY) == 0);
+	TestCheck(WireQuantizeTime(-INFINITY) == 0);
+	TestCheck(WireQuantizeTime(NAN) == 0);
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(-1.5), -1.0), -1.5, 1e-9);
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(1000.25), 1000.0), 1000.25, 1e-9);
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(1000.25), 1020.0), 1000.25, 1e-9);
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(1000.25), 980.5), 1000.25, 1e-9);
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(65.54), 65.53), 65.54, 1e-9);
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(65.53), 65.54), 65.53, 1e-9);
+	//A time more than 32.768 seconds from the reference is mistaken for one a wrap the other way.
+	TestCheckClose(WireDequantizeTime(WireQuantizeTime(5000.0), 5040.0), 5000.0 + 65.536, 1e-9);
+
+	/*
+	 The structs round trip to the precision of their fields.
+	 */
+	uint8_t bytes[32];
+	WireWriter writer;
+	WireReader reader;
+	PlayerShipDirectionalInformation information = { 271.0f, 63.3f, 240.1f, -12.7f, 359.0f, 54321 };
+	PlayerShipDirectionalInformation receivedInformation;
+	ProjectileDetails details = { 10.0f, 20.0f, -900.0f, 2000.0f };
+	ProjectileDetails receivedDetails;
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteDirectionalInformation(&writer, &information);
+	WireWriteProjectileDetails(&writer, &details);
+	TestCheck(writer.length == 9 + 8);
+
+	WireReaderInit(&reader, bytes, writer.length);
+	TestCheck(WireReadDirectionalInformation(&reader, &receivedInformation));
+	TestCheck(WireReadProjectileDetails(&reader, &receivedDetails));
+
+	TestCheckClose(receivedInformation.newHeading, 271.0f, 360.0 / 512.0);
+	TestCheckClose(receivedInformation.newSpeed, 63.5f, 0.0);
+	TestCheckClose(receivedInformation.currentPositionX, 240.1f, 1.0 / 64.0);
+	TestCheckClose(receivedInformation.currentPositionY, -12.7f, 1.0 / 64.0);
+	//359 degrees is closest to the step at 358.59375 degrees.
+	TestCheckClose(receivedInformation.currentRotation, 358.59375f, 0.0);
+	TestCheck(receivedInformation.sendTime == 54321);
+	TestCheckClose(receivedDetails.startingPositionX, 10.0f, 0.0);
+	TestCheckClose(receivedDetails.startingPositionY, 20.0f, 0.0);
+	TestCheckClose(receivedDetails.destinationPointX, -900.0f, 0.0);
+	TestCheckClose(receivedDetails.destinationPointY, WireDequantizePosition(INT16_MAX), 0.0);
+
+}
+
+static void TestHeader(void) {
+
+	uint8_t bytes[kWireProtocolMaximumHeaderSize];
+	WireWriter writer;
+	WireReader reader;
+	WirePacketHeader header;
+
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteHeader(&writer, 7, UINT32_MAX);
+	TestCheck(!writer.overflow);
+	TestCheck(writer.length == kWireProtocolMaximumHeaderSize);
+
+	WireReaderInit(&reader, bytes, writer.length);
+	TestCheck(WireReadHeader(&reader, &header));
+	TestCheck(header.version == kWireProtocolVersion);
+	TestCheck(header.packetType == 7);
+	TestCheck(header.packetNumber == UINT32_MAX);
+
+	//Packets from another version of the protocol are rejected.
+	bytes[0] = kWireProtocolVersion + 1;
+	WireReaderInit(&reader, bytes, writer.length);
+	TestCheck(!WireReadHeader(&reader, &header));
+
+	//As are packets which end part way through the header.
+	bytes[0] = kWireProtocolVersion;
+	for (size_t length = 0; length < writer.length; length++) {
+
+		WireReaderInit(&reader, bytes, length);
+		TestCheck(!WireReadHeader(&reader, &header));
+
+	}
+
+}
+
+static void TestBatchFraming(void) {
+
+	uint8_t bytes[512];
+	uint8_t large[200];
+	WireWriter writer;
+	WireReader reader;
+	WireReader message;
+	uint8_t messageType;
+
+	for (size_t i = 0; i < sizeof(large); i++) {
+		large[i] = (uint8_t)i;
+	}
+
+	/*
+	 Messages with no data, a short length and a length which needs two bytes.
+	 */
+	WireWriterInit(&writer, bytes, sizeof(bytes));
+	WireWriteMessage(&writer, 1, NULL, 0);
+	WireWriteMessage(&writer, 2, "abc", 3);
+	WireWriteMessage(&writer, 3, large, sizeof(large));
+
+	TestCheck(!writer.overflow);
+	TestCheck(WireMessageSize(0) == 2);
+	TestCheck(WireMessageSize(3) == 5);
+	TestCheck(WireMessageSize(sizeof(large)) == 3 + sizeof(large));
+	TestCheck(writer.length == WireMessageSize(0) + WireMessageSize(3) + WireMessageSize(sizeof(large)));
+
+	WireReaderInit(&reader, bytes, writer.length);
+
+	TestCheck(WireReadMessage(&reader, &messageType, &message));
+	TestCheck(messageType == 1);
+	TestCheck(WireReaderRemaining(&message) == 0);
+
+	TestCheck(WireReadMessage(&reader, &messageType, &message));
+	TestCheck(messageType == 2);
+	TestCheck(WireReaderRemaining(&message) == 3);
+	TestCheck(memcmp(message.bytes, "abc", 3) == 0);
+
+	TestCheck(WireReadMessage(&reader, &messageType, &message));
+	TestCheck(messageType == 3);
+	TestCheck(WireReaderRemaining(&message) == sizeof(large));
+	TestCheck(memcmp(message.bytes, large, sizeof(large)) == 0);
+
+	//Reading the data of a message can't run into the next one.
+	WireReaderSkip(&message, sizeof(large) + 1);
+	TestCheck(message.error);
+
+	TestCheck(!WireReadMessage(&reader, &messageType, &message));
+	TestCheck(!reader.error);
+
+	/*
+	 A batch which ends part way through it's last message gives up the messages before it.
+	 */
+	for (size_t length = WireMessageSize(0) + WireMessageSize(3) + 1; length < writer.length; length++) {
+
+		unsigned int count = 0;
+
+		WireReaderInit(&reader, bytes, length);
+
+		while (WireReadMessage(&reader, &messageType, &message)) {
+			count++;
+		}
+
+		TestCheck(count == 2);
+
+	}
+
+	//A length longer than the rest of the batch.
+	const uint8_t corrupt[] = { 1, 0x7F, 0, 0 };
+	WireReaderInit(&reader, corrupt, sizeof(corrupt));
+	TestCheck(!WireReadMessage(&reader, &messageType, &message));
+	TestCheck(reader.error);
+
+}
+
+int main(void) {
+
+	TestVarInts();
+	TestCorruptVarInts();
+	TestPrimitives();
+	TestTruncatedReads();
+	TestOverrunWrites();
+	TestQuantization();
+	TestHeader();
+	TestBatchFraming();
+
+	return TestCheckResult();
+
+}